@@ -16,6 +16,7 @@
 #include "Config.h"
 #include "ScriptableObjects.h"
 #include "BrainScriptEvaluator.h"
+#include "MPIWrapper.h"
 
 #include <string>
 #include <chrono>
@@ -563,3 +564,77 @@ void DoTopologyPlot(const ConfigParameters& config)
 
 template void DoTopologyPlot<float>(const ConfigParameters& config);
 template void DoTopologyPlot<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoAllReduceBenchmark() - implements CNTK "allReduceBenchmark" command
+// ===========================================================================
+
+// Measures the all-reduce algorithms of MPIWrapper on buffers of the given sizes. Run it with all ranks that are to
+// train, e.g. mpiexec -n 16 cntk command=bench bench=[action=allReduceBenchmark;sizesInMB=1:16:128;algorithms=mpi:ring:hierarchical].
+// Prints the algorithm bandwidth (buffer size / time) and the bus bandwidth (algorithm bandwidth * 2(N-1)/N), which
+// does not depend on the number of ranks N for an optimal algorithm and can be compared with the link bandwidth.
+template <typename ElemType>
+void DoAllReduceBenchmark(const ConfigParameters& config)
+{
+    auto mpi = MPIWrapper::GetInstance();
+    if (mpi == nullptr)
+        InvalidArgument("allReduceBenchmark: this command needs MPI; run it under mpiexec with parallelTrain=true.");
+
+    floatargvector sizesInMB = config(L"sizesInMB", ConfigParameters::Array(floatargvector(vector<float>{ 1, 16, 128 })));
+    stringargvector algorithms = config(L"algorithms", ConfigParameters::Array(stringargvector(vector<wstring>{ L"mpi", L"ring", L"hierarchical" })));
+    size_t numIterations = config(L"iterations", (size_t)10);
+    size_t numWarmupIterations = config(L"warmupIterations", (size_t)2);
+
+    size_t numRanks = mpi->NumNodesInUse();
+    size_t rank = mpi->CurrentNodeRank();
+    if (mpi->IsMainNode())
+        fprintf(stderr, "allReduceBenchmark: %d ranks, %s, %d iterations\n", (int)numRanks, mpi->IsMultiHost() ? "multiple hosts" : "a single host", (int)numIterations);
+
+    for (size_t i = 0; i < sizesInMB.size(); i++)
+    {
+        size_t numElements = max<size_t>(1, (size_t)(sizesInMB[i] * 1024 * 1024 / sizeof(ElemType)));
+        vector<ElemType> buffer(numElements);
+
+        for (size_t j = 0; j < algorithms.size(); j++)
+        {
+            auto algorithm = ParseMPIAllReduceAlgorithm(algorithms[j]);
+            double seconds = 0;
+            for (size_t iteration = 0; iteration < numWarmupIterations + numIterations; iteration++)
+            {
+                for (size_t k = 0; k < numElements; k++)
+                    buffer[k] = (ElemType)((rank + 1) * (k % 7));
+
+                mpi->WaitAll();
+                auto start = chrono::steady_clock::now();
+                mpi->AllReduce(static_cast<ElemType*>(MPI_IN_PLACE), buffer.data(), numElements, MPI_SUM, algorithm);
+                if (iteration >= numWarmupIterations)
+                    seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            }
+
+            // every rank contributed (rank + 1) times the same pattern
+            ElemType sumOfRanks = (ElemType)(numRanks * (numRanks + 1) / 2);
+            size_t numWrong = 0;
+            for (size_t k = 0; k < numElements; k++)
+            {
+                if (buffer[k] != sumOfRanks * (ElemType)(k % 7))
+                    numWrong++;
+            }
+            if (numWrong > 0)
+                RuntimeError("allReduceBenchmark: %ls all-reduce of %.2f MB produced %d wrong elements on rank %d.", algorithms[j].c_str(), (double)sizesInMB[i], (int)numWrong, (int)rank);
+
+            // the slowest rank determines the time of a collective
+            mpi->AllReduce(&seconds, 1, MPI_MAX);
+            if (mpi->IsMainNode())
+            {
+                double secondsPerCall = seconds / max<size_t>(1, numIterations);
+                double algorithmGBps = numElements * sizeof(ElemType) / secondsPerCall / 1e9;
+                double busGBps = algorithmGBps * 2 * (numRanks - 1) / numRanks;
+                fprintf(stderr, "allReduceBenchmark: %10.2f MB %-13ls %10.3f ms   algorithm bandwidth %8.3f GB/s   bus bandwidth %8.3f GB/s\n",
+                        (double)sizesInMB[i], algorithms[j].c_str(), secondsPerCall * 1000, algorithmGBps, busGBps);
+            }
+        }
+    }
+}
+
+template void DoAllReduceBenchmark<float>(const ConfigParameters& config);
+template void DoAllReduceBenchmark<double>(const ConfigParameters& config);
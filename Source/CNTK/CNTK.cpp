@@ -333,6 +333,10 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
                 {
                     DoParameterSVD<ElemType>(commandParams);
                 }
+                else if (thisAction == "allReduceBenchmark")
+                {
+                    DoAllReduceBenchmark<ElemType>(commandParams);
+                }
                 else
                 {
                     RuntimeError("unknown action: %s  in command set: %s", thisAction.c_str(), command[i].c_str());
@@ -504,6 +508,10 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetMinibatchSizeAwareMemorySharing(config(L"minibatchSizeAwareMemorySharing", true));
+    Globals::SetContiguousParameterGradients(config(L"contiguousParameterGradients", false));
+    Globals::SetElementwiseNodeFusion(config(L"fuseElementwiseNodes", false));
+    Globals::SetConvolutionAutotuning(config(L"autotuneConvolutions", false));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -656,6 +664,10 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetMinibatchSizeAwareMemorySharing(config(L"minibatchSizeAwareMemorySharing", true));
+    Globals::SetContiguousParameterGradients(config(L"contiguousParameterGradients", false));
+    Globals::SetElementwiseNodeFusion(config(L"fuseElementwiseNodes", false));
+    Globals::SetConvolutionAutotuning(config(L"autotuneConvolutions", false));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -670,6 +670,7 @@ namespace CNTK
         friend class BlockMomentumDistributedLearner;
         friend class Internal::VariableResolver;
         friend class Trainer;
+        friend class Serializer;
 
         template <typename T, typename ...CtorArgTypes>
         friend inline std::shared_ptr<T> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
@@ -1024,6 +1025,7 @@ namespace CNTK
         NDShape m_viewShape;
         bool m_isReadOnly;
 
+        std::shared_ptr<void> m_externalStorage; // keeps storage that the view does not own alive (e.g. a memory-mapped model file); shared by aliases and slices
         std::shared_ptr<void> m_tensorView; // Microsoft::MSR::CNTK::TensorView<ElemType>*
     };
 
@@ -3267,6 +3269,13 @@ namespace CNTK
 
         CNTK_API virtual void PrintNodeTiming() {}
 
+        ///
+        /// Prints the per-node cost report (time, estimated FLOPs and bytes, and their roofline if the peaks of the device are given)
+        /// gathered while Internal::EnableNodeCostProfiling() was in effect, and resets the statistics.
+        /// If filePath is not empty, the report is also written to it as JSON.
+        ///
+        CNTK_API virtual void PrintNodeCostReport(const std::wstring& /*filePath*/ = L"", double /*peakGFlops*/ = 0, double /*peakGBps*/ = 0) {}
+
     protected:
         ///
         /// Computes and stores the values of specified variables in the 'outputs' map, using provided 'inputs' values for each input of the Function.
@@ -3387,6 +3396,14 @@ namespace CNTK
         ///
         CNTK_API FunctionPtr CloneFlattened(ParameterCloningMethod parameterCloneMethod = ParameterCloningMethod::Share) const;
 
+        ///
+        /// Clones 'this' Function for evaluation only, with a graph that is faster to evaluate: blocks are inlined, Parameters become Constants,
+        /// Dropout and other operations that do nothing outside of training are removed, BatchNormalization following a Convolution or Times
+        /// is folded into its weights, and operations whose inputs are all Constants are replaced by their results, computed on 'computeDevice'.
+        /// The outputs of the clone are those of 'this' Function in evaluation mode.
+        ///
+        CNTK_API FunctionPtr CloneForInference(const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice()) const;
+
         ///
         /// Deserializes a Function from the model dictionary, using the specified UDF deserializer to
         //  reconstruct user defined functions if the model contains any (in which case an exception will be raised
@@ -5459,6 +5476,21 @@ namespace CNTK
 
     CNTK_API DistributedLearnerPtr CreateQuantizedDataParallelDistributedLearner(QuantizedDistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, bool useAsyncBufferedParameterUpdate = false);
 
+    ///
+    /// Creates a data parallel distributed learner that exchanges only the largest gradient entries.
+    /// From every bucket of 'bucketSize' gradient elements, each worker sends the ceil('density' * 'bucketSize') entries
+    /// of largest magnitude that are at least 'threshold'; the entries not sent are accumulated locally and added to the
+    /// next gradient, as with 1-bit SGD.
+    ///
+    CNTK_API DistributedLearnerPtr CreateSparsifiedDataParallelDistributedLearner(
+        DistributedCommunicatorPtr communicator,
+        LearnerPtr learner,
+        size_t distributeAfterSamples,
+        double density,
+        size_t bucketSize = 65536,
+        double threshold = 0,
+        bool useAsyncBufferedParameterUpdate = false);
+
     CNTK_API DistributedLearnerPtr CreateBlockMomentumDistributedLearner(
         DistributedCommunicatorPtr communicator,
         LearnerPtr learner,
@@ -5693,6 +5725,11 @@ namespace CNTK
         ///
         CNTK_API virtual void PrintNodeTiming();
 
+        ///
+        /// Prints the per-node cost report of the training function, see Function::PrintNodeCostReport()
+        ///
+        CNTK_API virtual void PrintNodeCostReport(const std::wstring& filePath = L"", double peakGFlops = 0, double peakGBps = 0);
+
     private:
         template <typename T1, typename ...CtorArgTypes>
         friend std::shared_ptr<T1> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
@@ -5713,8 +5750,10 @@ namespace CNTK
         bool TrainLocalMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
         bool TrainDistributedMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
 
-        void Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState,
-            const Dictionary& externalState, const Dictionary& distributedState = {});
+        // Takes a snapshot of the model and trainer state and returns the function that writes it to modelFilePath,
+        // which can run on another thread. In distributed mode all workers have to call this; the returned function
+        // is empty on all but the main worker.
+        std::function<void()> SnapshotCheckpoint(const std::wstring& modelFilePath, const Dictionary& externalState, bool syncToDisk);
 
         void UpdateTrainingProgress(size_t numSamples, const ValuePtr& loss, const ValuePtr& evalCriterion, const DeviceDescriptor& computeDevice);
         void AddProgressWriters(const std::vector<ProgressWriterPtr>& progressWriters);
@@ -6295,19 +6334,24 @@ namespace CNTK
         /// checkpointFrequencyInSamples: frequency in samples when to perform checkpointing.
         /// restoreFromCheckpointIfExists: if flag is set, the training session will try to restore before training.
         /// preserveAllCheckpoints: if flag is set, all checkpoints will be preserved.
+        /// asyncCheckpointing: if flag is set, checkpoints are written and synced to disk on a background thread
+        ///     while the training continues. At most one checkpoint is written at a time; OnCheckpointEnd is called
+        ///     on the training thread once it has been written.
         ///
         CNTK_API CheckpointConfig(
             const std::wstring& checkPointFileName,
             size_t checkpointFrequency = std::numeric_limits<size_t>::max(),
             DataUnit checkpointFrequencyUnit = DataUnit::Sample,
             bool restoreFromCheckpointIfExists = true,
-            bool preserveAllCheckpoints = false);
+            bool preserveAllCheckpoints = false,
+            bool asyncCheckpointing = false);
 
     private:
         friend class TrainingSession;
         const std::wstring m_fileName;
         const bool m_restore;
         const bool m_preserveAll;
+        const bool m_async;
         const size_t m_frequency;
         const DataUnit m_frequencyUnit;
     };
@@ -6410,6 +6454,7 @@ namespace CNTK
 
         ///
         /// Optionally overridable callback that is invoked after each checkpoint.
+        /// With asynchronous checkpointing it is invoked once the checkpoint has been written.
         ///
         CNTK_API virtual void OnCheckpointEnd(size_t /*checkpointIndex*/) {};
 
@@ -6449,6 +6494,7 @@ namespace CNTK
         void RestoreFromCheckpoint();
         void SaveCheckpoint(size_t currentIndex);
         void SaveFinalCheckpoint();
+        void CompletePendingCheckpoint(bool wait);
 
         bool CrossValidate(size_t currentIndex, const DeviceDescriptor& computeDevice);
         void ReportProgress(size_t currentIndex);
@@ -6476,6 +6522,10 @@ namespace CNTK
         CheckpointConfig m_checkpoint;
         CrossValidationConfig m_cv;
         TestConfig m_test;
+
+        // Checkpoint that is being written in the background, see CheckpointConfig.
+        std::future<void> m_pendingCheckpoint;
+        size_t m_pendingCheckpointIndex;
     };
 
     ///
@@ -144,6 +144,40 @@ CNTK_API CNTK_StatusCode CNTK_CloneModel(
     /*[in]*/ bool flattened,
     /*[out]*/ CNTK_ModelHandle* cloned);
 
+//
+// Evaluates the products of the weight matrices of the model with data in integer arithmetic on the CPU,
+// which is faster at a small loss of accuracy. The weights are quantized once, when the model is first evaluated,
+// and how much that changed each of them is printed to stderr. Has no effect on GPU devices.
+// Must not be called while the model is being evaluated.
+//
+// Parameters:
+//    model [in]: model to evaluate in integer arithmetic
+//    precision [in]: a null-terminated "int8" or "int16"
+//
+CNTK_API CNTK_StatusCode CNTK_EnableQuantizedTimes(
+    /*[in]*/ CNTK_ModelHandle model,
+    /*[in]*/ const char* precision);
+
+//
+// Evaluates concurrent CNTK_EvaluateSequence calls on the model in batches. Calls that start new sequences
+// (all input reset flags true) and have the same inputs, with the same sample shapes, and the same outputs
+// wait up to maxLatencyMicroseconds for other such calls, or until maxBatchSize of them have arrived,
+// and are then evaluated together as one minibatch with a sequence per call. This is much more efficient
+// than evaluating small requests one by one, at the cost of the waiting time. Each call still gets only
+// its own outputs. Calls that continue a sequence are not batched, and cannot continue a sequence that
+// was started in a batch. A maxBatchSize of 0 or 1 disables batching, which is the default.
+// Must not be called while the model is being evaluated.
+//
+// Parameters:
+//    model [in]: model to evaluate in batches
+//    maxBatchSize [in]: maximal number of calls evaluated together
+//    maxLatencyMicroseconds [in]: how long a call waits for other calls to join its batch
+//
+CNTK_API CNTK_StatusCode CNTK_EnableRequestBatching(
+    /*[in]*/ CNTK_ModelHandle model,
+    /*[in]*/ uint32_t maxBatchSize,
+    /*[in]*/ uint32_t maxLatencyMicroseconds);
+
 //
 // Releases all resources associated with the model.
 //
@@ -208,7 +242,17 @@ typedef struct CNTK_Value
 } CNTK_Value;
 
 //
-// Represents a value.
+// Evaluates the model on a sequence of inputs.
+//
+// Can be called from several threads at once on the same model handle. Every concurrent call evaluates on
+// its own execution context (activations and workspace), while the parameters of the model are shared, so
+// there is no need to clone the model per thread. Contexts stay allocated for later calls; their number
+// is the largest number of calls that ran at the same time.
+// A call whose input reset flag is false continues the sequence of the previous call of the same thread.
+// From a thread without a previous call of its own, e.g. when a caller moves between the threads of a pool,
+// it continues the sequence of the last finished call; it fails if that context is in use by another call.
+// With several concurrent callers, sequences that span several calls should therefore be evaluated on a
+// model handle of their own (see CNTK_CloneModel).
 //
 CNTK_API CNTK_StatusCode CNTK_EvaluateSequence(CNTK_ModelHandle model,
     /*[in]*/const CNTK_Variable* inputs,
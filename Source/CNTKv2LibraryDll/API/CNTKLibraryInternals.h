@@ -324,12 +324,59 @@ namespace CNTK
         CNTK_API void EnableNodeTiming();
         CNTK_API void DisableNodeTimeing();
 
+        // Per-node cost profiling: time, estimated FLOPs and bytes of every node, for Function::PrintNodeCostReport().
+        // The device is synchronized around every node, which slows down GPU training.
+        CNTK_API void EnableNodeCostProfiling();
+        CNTK_API void DisableNodeCostProfiling();
+
+        // Learners update all their dense CPU parameters in a single fused pass where they can (on by default).
+        CNTK_API void SetFusedLearnerUpdates(bool enable);
+        CNTK_API bool AreFusedLearnerUpdatesEnabled();
+
         CNTK_API void EnableCPUEvalOptimization();
         CNTK_API void DisableCPUEvalOptimization();
 
+        // Evaluates the products of the weight matrices of 'model' with data (Times) in "int8" or "int16" arithmetic on the CPU.
+        // The weights are quantized once, when the model is compiled for evaluation, and how much that changed them is
+        // printed to stderr. bitShiftA and bitShiftB narrow the quantization range of the weights and the data (see SymmetricQuantizer).
+        // Gradients cannot be computed through the quantized products.
+        CNTK_API void EnableQuantizedTimesInference(const FunctionPtr& model, const std::wstring& precision, size_t bitShiftA = 0, size_t bitShiftB = 0);
+
+        // Saves models of any size the way models over 2GB are always saved: the values of the NDArrayViews follow the
+        // protobuf message instead of being part of it. Such files can be memory-mapped on load.
+        CNTK_API void EnableMappableModelSaving();
+        CNTK_API void DisableMappableModelSaving();
+        CNTK_API bool IsMappableModelSavingEnabled();
+
+        // Memory-maps model files whose NDArrayView values follow the protobuf message (see EnableMappableModelSaving)
+        // when they are loaded with Function::Load or Dictionary::Load. Constants loaded on the CPU then use the mapped
+        // (copy-on-write) file as their storage, which loads large models without copying and shares their pages
+        // between processes; all other values are copied out of the mapping.
+        CNTK_API void EnableMemoryMappedModelLoading();
+        CNTK_API void DisableMemoryMappedModelLoading();
+        CNTK_API bool IsMemoryMappedModelLoadingEnabled();
+
         CNTK_API void SetMPIPackThreshold(size_t packThesholdInBytes);
         CNTK_API size_t GetMPIPackThreshold();
 
+        // Allocates the gradients of all parameters of a network in one contiguous buffer, so that the distributed
+        // communicator can aggregate runs of adjacent gradients of up to the bucket size with a single MPI call, in place.
+        CNTK_API void EnableContiguousParameterGradients();
+        CNTK_API void DisableContiguousParameterGradients();
+        CNTK_API void SetMPIGradientBucketSize(size_t bucketSizeInBytes);
+        CNTK_API size_t GetMPIGradientBucketSize();
+
+        // Lets convolutions on the CPU time the GEMM, Winograd and direct engines on the first minibatch and keep the
+        // fastest one. The engines round differently, so results can change with the machine; off by default.
+        CNTK_API void EnableConvolutionAutotuning();
+        CNTK_API void DisableConvolutionAutotuning();
+
+        // Algorithm of the MPI all-reduce of dense values on the CPU: "mpi" (the MPI library's MPI_Allreduce, default),
+        // "ring" (chunked, pipelined ring) or "hierarchical" (within hosts first, then a ring across hosts).
+        // The ring and hierarchical all-reduces are blocking. All workers must use the same algorithm.
+        CNTK_API void SetMPIAllReduceAlgorithm(const std::wstring& algorithm);
+        CNTK_API std::wstring GetMPIAllReduceAlgorithm();
+
         CNTK_API bool AreEquivalent(const ::CNTK::FunctionPtr& f1, const ::CNTK::FunctionPtr& f2);
         CNTK_API bool AreEquivalent(const ::CNTK::Variable& v1, const ::CNTK::Variable& v2, bool allowParameterAndConstantsEquivalence = false);
 
@@ -7,7 +7,12 @@
 
 #include <algorithm>
 #include <boost/noncopyable.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <functional>
 #include <codecvt>
@@ -16,6 +21,10 @@
 #include "CNTKLibrary.h"
 #include "CNTKLibraryC.h"
 
+namespace Microsoft { namespace MSR { namespace CNTK {
+    class QuantizedWeightsCache;
+} } }
+
 namespace CNTK
 {
     // Helper functions.
@@ -102,6 +111,8 @@ namespace CNTK
         virtual void GetModelOutputsInfo(CNTK_Variable** outputs, uint32_t* numOutputs) = 0;
 
         virtual std::unique_ptr<EvaluatorWrapper> Clone(CNTK_ParameterCloningMethod method, bool flatten) = 0;
+        virtual void EnableQuantizedTimes(const char* precision) = 0;
+        virtual void EnableRequestBatching(size_t maxBatchSize, std::chrono::microseconds maxLatency) = 0;
         virtual void EvaluateSequence(
             const CNTK_Variable* inputs,
             const CNTK_Value* inputValues,
@@ -146,6 +157,12 @@ namespace CNTK
 
     //
     // A wrapper for evaluation functionality of the library exposed in C interface.
+    // EvaluateSequence can be called from several threads at once: every concurrent call leases an evaluation
+    // context, a clone of the model that shares its parameters but has its own network, i.e. its own activations
+    // and workspace. Contexts are kept (and stay allocated) for later calls, so there are only as many of them
+    // as there were concurrent calls at the peak.
+    // With request batching enabled, concurrent calls that start new sequences are instead collected for a while
+    // and evaluated together, as one minibatch with a sequence per call, on a single context.
     //
     class CNTKEvaluatorWrapper : public EvaluatorWrapper
     {
@@ -158,6 +175,8 @@ namespace CNTK
         void GetModelOutputsInfo(CNTK_Variable** outputs, uint32_t* numOutputs) override;
 
         std::unique_ptr<EvaluatorWrapper> Clone(CNTK_ParameterCloningMethod method, bool flatten) override;
+        void EnableQuantizedTimes(const char* precision) override;
+        void EnableRequestBatching(size_t maxBatchSize, std::chrono::microseconds maxLatency) override;
 
         void EvaluateSequence(
             const CNTK_Variable* inputs,
@@ -169,10 +188,68 @@ namespace CNTK
             CNTK_Value** outputValues) override;
 
     private:
+        struct EvaluationContext
+        {
+            FunctionPtr m_func;
+            std::unordered_map<std::string, Variable> m_arguments;
+            std::unordered_map<std::string, Variable> m_outputs;
+            std::thread::id m_lastUser;  // thread of the last call, whose sequences the network may continue
+        };
+        typedef std::shared_ptr<EvaluationContext> EvaluationContextPtr;
+
+        EvaluationContextPtr LeaseContext(bool continuesSequence);
+        void ReturnContext(const EvaluationContextPtr& context);
+        void EnableQuantizedTimesInference(const FunctionPtr& func);
+
+        void EvaluateSequence(
+            EvaluationContext& context,
+            const CNTK_Variable* inputs,
+            const CNTK_Value* inputValues,
+            const bool* inputResetFlags,
+            uint32_t numInputs,
+            const CNTK_Variable* outputs,
+            uint32_t numOutputs,
+            CNTK_Value** outputValues);
+
+        // A call that starts new sequences, waiting to be evaluated in a batch with other calls.
+        struct BatchedRequest
+        {
+            const CNTK_Variable* m_inputs;
+            const CNTK_Value* m_inputValues;
+            uint32_t m_numInputs;
+            const CNTK_Variable* m_outputs;
+            uint32_t m_numOutputs;
+
+            std::vector<std::vector<float>> m_results;   // per output, the frames of the sequence of this call
+            std::vector<NDShape> m_resultShapes;
+            std::exception_ptr m_error;
+            bool m_taken = false;                        // part of a batch that is being evaluated
+            bool m_done = false;
+        };
+
+        void EvaluateBatched(BatchedRequest& request, CNTK_Value** outputValues);
+        void EvaluateBatch(const std::vector<BatchedRequest*>& batch);
+        bool CanBatch(const BatchedRequest& first, const BatchedRequest& other) const;
+
+        // The loaded model; it is only cloned into contexts and never evaluated itself.
         FunctionPtr m_func;
         DeviceDescriptor m_device;
-        std::unordered_map<std::string, Variable> m_arguments;
-        std::unordered_map<std::string, Variable> m_outputs;
+        std::wstring m_quantizedTimesPrecision;
+        std::shared_ptr<Microsoft::MSR::CNTK::QuantizedWeightsCache> m_quantizedWeights; // shared by the contexts, which share the parameters
+        std::unordered_map<std::string, size_t> m_argumentRanks;
+
+        std::mutex m_contextsLock;
+        std::vector<EvaluationContextPtr> m_contexts;
+        std::vector<EvaluationContextPtr> m_idleContexts;
+        EvaluationContextPtr m_lastReturnedContext;  // context of the last finished call, for a caller that continues on another thread
+
+        // Request batching; a maximal batch size below 2 disables it.
+        size_t m_maxBatchSize;
+        std::chrono::microseconds m_maxBatchLatency;
+        std::mutex m_batchLock;
+        std::condition_variable m_batchCondition;
+        std::vector<BatchedRequest*> m_pendingRequests;
+        bool m_collectingBatch;
     };
 }
 
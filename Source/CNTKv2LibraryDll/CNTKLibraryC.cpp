@@ -115,6 +115,26 @@ CNTK_StatusCode CNTK_CloneModel(CNTK_ModelHandle model, CNTK_ParameterCloningMet
     return ExceptionCatcher::Call([&]() { *cloned = ((EvaluatorWrapper*)model)->Clone(method, flatten).release(); });
 }
 
+CNTK_StatusCode CNTK_EnableQuantizedTimes(CNTK_ModelHandle model, const char* precision)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    if (!precision)
+        return StatusCode(CNTK_ERROR_NULL_POINTER, "'precision' parameter is not allowed to be null");
+
+    return ExceptionCatcher::Call([&]() { ((EvaluatorWrapper*)model)->EnableQuantizedTimes(precision); });
+}
+
+CNTK_StatusCode CNTK_EnableRequestBatching(CNTK_ModelHandle model, uint32_t maxBatchSize, uint32_t maxLatencyMicroseconds)
+{
+    if (model == CNTK_INVALID_MODEL_HANDLE)
+        return StatusCode(CNTK_INVALID_MODEL_HANDLE, "Invalid model handle");
+
+    return ExceptionCatcher::Call(
+        [&]() { ((EvaluatorWrapper*)model)->EnableRequestBatching(maxBatchSize, std::chrono::microseconds(maxLatencyMicroseconds)); });
+}
+
 void CNTK_ReleaseModel(CNTK_ModelHandle model)
 {
     delete (EvaluatorWrapper*)model;
@@ -220,12 +220,33 @@ namespace CNTK
             Microsoft::MSR::CNTK::Globals::SetNodeTiming(false);
         }
 
+        void EnableNodeCostProfiling()
+        {
+            Microsoft::MSR::CNTK::Globals::SetNodeCostProfiling(true);
+        }
+
+        void DisableNodeCostProfiling()
+        {
+            Microsoft::MSR::CNTK::Globals::SetNodeCostProfiling(false);
+        }
+
+        std::atomic<bool> s_fusedLearnerUpdates(true);
+        void SetFusedLearnerUpdates(bool enable)
+        {
+            s_fusedLearnerUpdates.store(enable);
+        }
+
+        bool AreFusedLearnerUpdatesEnabled()
+        {
+            return s_fusedLearnerUpdates.load();
+        }
+
         void EnableCPUEvalOptimization()
         {
             // optimization is only for float
             int flags = Microsoft::MSR::CNTK::CPUMatrix<float>::GetOptimizationFlags();
             flags |= Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL;
-            Microsoft::MSR::CNTK::CPUMatrix<float>::SetOptimizationFlags(Microsoft::MSR::CNTK::CPUMatrix<float>::OPT_EVAL_WITH_MKL);
+            Microsoft::MSR::CNTK::CPUMatrix<float>::SetOptimizationFlags(flags);
         }
 
         void DisableCPUEvalOptimization()
@@ -235,6 +256,38 @@ namespace CNTK
             Microsoft::MSR::CNTK::CPUMatrix<float>::SetOptimizationFlags(flags);
         }
 
+        std::atomic<bool> s_mappableModelSaving(false);
+        void EnableMappableModelSaving()
+        {
+            s_mappableModelSaving.store(true);
+        }
+
+        void DisableMappableModelSaving()
+        {
+            s_mappableModelSaving.store(false);
+        }
+
+        bool IsMappableModelSavingEnabled()
+        {
+            return s_mappableModelSaving.load();
+        }
+
+        std::atomic<bool> s_memoryMappedModelLoading(false);
+        void EnableMemoryMappedModelLoading()
+        {
+            s_memoryMappedModelLoading.store(true);
+        }
+
+        void DisableMemoryMappedModelLoading()
+        {
+            s_memoryMappedModelLoading.store(false);
+        }
+
+        bool IsMemoryMappedModelLoadingEnabled()
+        {
+            return s_memoryMappedModelLoading.load();
+        }
+
         void SetMPIPackThreshold(size_t packThesholdInBytes)
         {
             Microsoft::MSR::CNTK::Globals::SetMPIPackThreshold(packThesholdInBytes);
@@ -245,6 +298,47 @@ namespace CNTK
             return Microsoft::MSR::CNTK::Globals::GetMPIPackThreshold();
         }
 
+        void EnableContiguousParameterGradients()
+        {
+            Microsoft::MSR::CNTK::Globals::SetContiguousParameterGradients(/* enable = */ true);
+        }
+
+        void DisableContiguousParameterGradients()
+        {
+            Microsoft::MSR::CNTK::Globals::SetContiguousParameterGradients(/* enable = */ false);
+        }
+
+        void SetMPIGradientBucketSize(size_t bucketSizeInBytes)
+        {
+            Microsoft::MSR::CNTK::Globals::SetMPIGradientBucketSize(bucketSizeInBytes);
+        }
+
+        size_t GetMPIGradientBucketSize()
+        {
+            return Microsoft::MSR::CNTK::Globals::GetMPIGradientBucketSize();
+        }
+
+        void EnableConvolutionAutotuning()
+        {
+            Microsoft::MSR::CNTK::Globals::SetConvolutionAutotuning(/* enable = */ true);
+        }
+
+        void DisableConvolutionAutotuning()
+        {
+            Microsoft::MSR::CNTK::Globals::SetConvolutionAutotuning(/* enable = */ false);
+        }
+
+        std::atomic<int> s_mpiAllReduceAlgorithm((int)Microsoft::MSR::CNTK::MPIAllReduceAlgorithm::Default);
+        void SetMPIAllReduceAlgorithm(const std::wstring& algorithm)
+        {
+            s_mpiAllReduceAlgorithm.store((int)Microsoft::MSR::CNTK::ParseMPIAllReduceAlgorithm(algorithm));
+        }
+
+        std::wstring GetMPIAllReduceAlgorithm()
+        {
+            return Microsoft::MSR::CNTK::MPIAllReduceAlgorithmName((Microsoft::MSR::CNTK::MPIAllReduceAlgorithm)s_mpiAllReduceAlgorithm.load());
+        }
+
         bool AreEquivalent(const Variable& var1, const Variable& var2, bool allowParameterAndConstantsEquivalence)
         {
             bool areDynamicAxesCompatible = (var1.DynamicAxes().size() == var2.DynamicAxes().size());
@@ -1776,6 +1776,9 @@ namespace CNTK
 
             std::tie(m_computationNetwork, m_variableToNodeMap) = CreateComputationNetwork<ElementType>(this->shared_from_this(), device, outputs, m_fullyDefinedArgumentsMap, m_inputsExcludedFromGradientComputation, /*useMangledNamesForComputationNodes =*/ false);
 
+            if (m_quantizedTimesInference && m_currentBackpropRoots.empty())
+                m_computationNetwork->EnableQuantizedTimesInference(m_quantizedTimesPrecision, m_quantizedTimesBitShiftA, m_quantizedTimesBitShiftB, m_quantizedWeights);
+
             // Record the timestamps of Parameters and Constants
             assert(m_lastRecordedTimeStamps.empty());
             auto functionParameters = Parameters();
@@ -52,6 +52,8 @@ namespace CNTK
         friend inline std::shared_ptr<T> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
 
         friend void Internal::SaveAsLegacyModel(const FunctionPtr& rootFunction, const std::wstring& modelFile);
+        friend void Internal::EnableQuantizedTimesInference(const FunctionPtr& model, const std::wstring& precision, size_t bitShiftA, size_t bitShiftB);
+        friend class CNTKEvaluatorWrapper;
 
         friend void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
                                                          std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
@@ -134,6 +136,20 @@ namespace CNTK
             }
         }
 
+        void PrintNodeCostReport(const std::wstring& filePath, double peakGFlops, double peakGBps) override
+        {
+            if (m_computationNetwork)
+            {
+                Microsoft::MSR::CNTK::NodeCostRoofline roofline;
+                roofline.m_peakGFlops = peakGFlops;
+                roofline.m_peakGBps = peakGBps;
+                m_computationNetwork->PrintNodeCostReport(roofline);
+                if (!filePath.empty())
+                    m_computationNetwork->WriteNodeCostReport(filePath, roofline);
+                m_computationNetwork->ResetNodeCostStatistics();
+            }
+        }
+
         template <typename FunctionType>
         static void PreorderTraverseVariables(const FunctionPtr& rootFunction, const FunctionType& functor, bool pythonOperandOrder = false)
         {
@@ -223,7 +239,7 @@ namespace CNTK
 
         CompositeFunction(const FunctionPtr& rootFunction, std::unordered_set<FunctionPtr>&& allPrimitiveFunctions, const std::wstring& name, const std::wstring& uid = Internal::GenerateUid(L"CompositeFunction"))
             : Function({}, Dictionary(), rootFunction, name, uid),
-            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false)
+            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false), m_quantizedTimesInference(false)
         {}
 
         std::vector<Variable> DetermineInputs(bool pythonOperandOrder = false) const
@@ -362,6 +378,21 @@ namespace CNTK
             m_computationNetwork = nullptr;
         }
 
+        // Evaluates the products of weight matrices with data in integer arithmetic on the CPU; applies to the computation
+        // network compiled for evaluation (not for gradient computation), now or when it is created.
+        // Functions that share their parameters can pass the same cache to quantize the weights once for all of them.
+        void EnableQuantizedTimesInference(Microsoft::MSR::CNTK::QuantizedPrecision precision, size_t bitShiftA, size_t bitShiftB,
+                                           const std::shared_ptr<Microsoft::MSR::CNTK::QuantizedWeightsCache>& quantizedWeights = nullptr)
+        {
+            m_quantizedTimesInference = true;
+            m_quantizedTimesPrecision = precision;
+            m_quantizedTimesBitShiftA = bitShiftA;
+            m_quantizedTimesBitShiftB = bitShiftB;
+            m_quantizedWeights = quantizedWeights;
+            if (m_computationNetwork && m_currentBackpropRoots.empty())
+                m_computationNetwork->EnableQuantizedTimesInference(precision, bitShiftA, bitShiftB, quantizedWeights);
+        }
+
         void RecordRefVariableUpdates()
         {
             for (auto refVar : m_refVariables)
@@ -413,6 +444,13 @@ namespace CNTK
 
         std::unordered_set<Variable> m_inputsExcludedFromGradientComputation;
 
+        // Settings of EnableQuantizedTimesInference()
+        bool m_quantizedTimesInference;
+        Microsoft::MSR::CNTK::QuantizedPrecision m_quantizedTimesPrecision;
+        size_t m_quantizedTimesBitShiftA;
+        size_t m_quantizedTimesBitShiftB;
+        std::shared_ptr<Microsoft::MSR::CNTK::QuantizedWeightsCache> m_quantizedWeights;
+
         // Version history:
         // 1 -- initial version.
         // 2 -- add support for stateful functions (with corresponding nodes inheriting from RngUser).
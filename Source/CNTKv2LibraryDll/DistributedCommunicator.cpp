@@ -12,6 +12,9 @@
 #include "CUDAPageLockedMemAllocator.h"
 #include "MatrixQuantizerImpl.h"
 #include "GPUDataTransferer.h"
+#include "GradientBuckets.h"
+#include "Globals.h"
+#include <map>
 #include <numeric>
 #include "Utils.h"
 
@@ -311,8 +314,17 @@ namespace CNTK
         size_t packedDoubleGradientsSizeInBytes = 0;
         std::vector<size_t> packedFloatGradientsIndex;
         std::vector<size_t> packedDoubleGradientsIndex;
+
+        // Values that are adjacent in memory are aggregated in place in buckets, without packing them.
+        std::vector<bool> isInBucket(numValues, false);
+        if (inputValues == outputValues)
+            AddGradientBuckets(inputValues, isInBucket, valuesToAggregate, valuesAfterAggregate);
+
         for (auto i = 0; i < numValues; i++)
         {
+            if (isInBucket[i])
+                continue;
+
             // Push index to packing queue if the gradient's size is less than threshold size
             if (!inputValues[i]->IsSliceView() && GetBufferSize(inputValues[i]) < m_packThresholdSizeInBytes && (inputValues[i]->GetDataType() == DataType::Float))
             {
@@ -366,6 +378,8 @@ namespace CNTK
         // For all values residing on GPU initiate async transfer to CPU buffers if needed
         CopyDataFromGPUToCPU(valuesToAggregate);
 
+        auto allReduceAlgorithm = ParseMPIAllReduceAlgorithm(Internal::GetMPIAllReduceAlgorithm());
+
         std::vector<MPI_Request> allReduceRequests;
         for (auto i = 0; i < numValues; ++i)
         {
@@ -389,7 +403,21 @@ namespace CNTK
             void* inputData = (ShouldCopyDataToCPU(inputValue)) ? m_intermediateCPUBuffers[i].data.get() : GetDataBuffer(inputValue);
             void* outputData = (ShouldCopyDataToCPU(inputValue)) ? m_intermediateCPUBuffers[i].data.get() : GetDataBuffer(outputValue);
 
-            if (dataType == DataType::Float)
+            // The ring and hierarchical all-reduces are blocking and work on CPU memory only; their values have no request to wait for.
+            bool useAllReduceAlgorithm = (allReduceAlgorithm != MPIAllReduceAlgorithm::Default) &&
+                                         (inputValue->Device() == DeviceDescriptor::CPUDevice() || ShouldCopyDataToCPU(inputValue));
+
+            if (dataType == DataType::Float && useAllReduceAlgorithm)
+            {
+                m_mpi->AllReduce(static_cast<float*>(inputData == outputData ? MPI_IN_PLACE : inputData), static_cast<float*>(outputData), numElements, MPI_SUM, allReduceAlgorithm);
+                allReduceRequests.push_back(MPI_REQUEST_NULL);
+            }
+            else if (dataType == DataType::Double && useAllReduceAlgorithm)
+            {
+                m_mpi->AllReduce(static_cast<double*>(inputData == outputData ? MPI_IN_PLACE : inputData), static_cast<double*>(outputData), numElements, MPI_SUM, allReduceAlgorithm);
+                allReduceRequests.push_back(MPI_REQUEST_NULL);
+            }
+            else if (dataType == DataType::Float)
             {
                 AllReduceData(static_cast<float*>(inputData), static_cast<float*>(outputData), numElements,
                     &allReduceRequests, (inputValue->Device() == DeviceDescriptor::CPUDevice()));
@@ -415,18 +443,8 @@ namespace CNTK
 
         // wait for async all reduce to complete. As soon as one of the requests is finished,
         // check if corresponding value is gpu bound and, if it is the case, initiate a cpu-to-gpu transfer.
-        size_t numAllReduceRequestsCompleted = 0;
-        while (numAllReduceRequestsCompleted < allReduceRequests.size())
+        auto copyAggregatedValueToGPU = [&](size_t idx)
         {
-            int idx = MPI_UNDEFINED;
-            m_mpi->WaitAny(allReduceRequests.data(), (int)allReduceRequests.size(), &idx);
-            if (idx == MPI_UNDEFINED)
-            {
-                break;
-            }
-
-            numAllReduceRequestsCompleted++;
-
             assert(idx < valuesToAggregate.size());
             auto value = valuesToAggregate[idx];
 
@@ -438,6 +456,30 @@ namespace CNTK
                 auto& buffer = m_intermediateCPUBuffers[idx];
                 transferer->CopyCPUToGPUAsync(buffer.data.get(), size, GetDataBuffer(view));
             }
+        };
+
+        // values that were reduced with a blocking call are complete already
+        size_t numAllReduceRequestsCompleted = 0;
+        for (size_t idx = 0; idx < allReduceRequests.size(); idx++)
+        {
+            if (allReduceRequests[idx] == MPI_REQUEST_NULL)
+            {
+                copyAggregatedValueToGPU(idx);
+                numAllReduceRequestsCompleted++;
+            }
+        }
+
+        while (numAllReduceRequestsCompleted < allReduceRequests.size())
+        {
+            int idx = MPI_UNDEFINED;
+            m_mpi->WaitAny(allReduceRequests.data(), (int)allReduceRequests.size(), &idx);
+            if (idx == MPI_UNDEFINED)
+            {
+                break;
+            }
+
+            numAllReduceRequestsCompleted++;
+            copyAggregatedValueToGPU(idx);
         }
 
         // TODO: Should not wait, simply publishing event on the compute stream should be sufficient
@@ -632,6 +674,37 @@ namespace CNTK
         }
     }
 
+    void MPICommunicatorImpl::AddGradientBuckets(const std::vector<NDArrayViewPtr>& values, std::vector<bool>& isInBucket,
+        std::vector<NDArrayViewPtr>& valuesToAggregate, std::vector<NDArrayViewPtr>& valuesAfterAggregate)
+    {
+        // Buckets are formed per data type and device, in the same order on all workers, so that all workers issue the same reductions.
+        std::map<std::pair<DataType, int>, std::vector<size_t>> valuesOfType;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (values[i]->GetStorageFormat() == StorageFormat::Dense)
+                valuesOfType[std::make_pair(values[i]->GetDataType(), AsCNTKImplDeviceId(values[i]->Device()))].push_back(i);
+        }
+
+        for (const auto& group : valuesOfType)
+        {
+            const auto& indices = group.second;
+            std::vector<std::pair<const void*, size_t>> buffers;
+            for (size_t i : indices)
+                buffers.push_back(std::make_pair(GetDataBuffer(values[i]), GetBufferSize(values[i])));
+
+            for (const auto& bucket : FormGradientBuckets(buffers, Globals::GetMPIGradientBucketSize()))
+            {
+                const auto& first = values[indices[bucket.m_items.front()]];
+                NDShape shape{ bucket.m_sizeInBytes / DataTypeSize(first->GetDataType()) };
+                auto data = MakeSharedObject<NDArrayView>(first->GetDataType(), shape, const_cast<char*>(bucket.m_data), bucket.m_sizeInBytes, first->Device());
+                valuesToAggregate.push_back(data);
+                valuesAfterAggregate.push_back(data);
+                for (size_t item : bucket.m_items)
+                    isInBucket[indices[item]] = true;
+            }
+        }
+    }
+
     template <typename ElemType>
     std::unique_ptr<Matrix<ElemType>> MPICommunicatorImpl::SetContinuousBuffer(std::vector<size_t>& packedGradientsIndex, size_t packedGradientsSizeInBytes,
         const std::vector<NDArrayViewPtr>& inputValues, const std::vector<NDArrayViewPtr>& outputValues,
@@ -129,6 +129,11 @@ namespace CNTK
         bool ShouldCopyDataToCPU(NDArrayViewPtr inputValue);
         void CopyDataFromGPUToCPU(std::vector<NDArrayViewPtr>& inputValues);
 
+        // Adds a view over each run of values that are adjacent in memory (see FormGradientBuckets) to the values
+        // to aggregate, and marks the values of the runs.
+        void AddGradientBuckets(const std::vector<NDArrayViewPtr>& values, std::vector<bool>& isInBucket,
+            std::vector<NDArrayViewPtr>& valuesToAggregate, std::vector<NDArrayViewPtr>& valuesAfterAggregate);
+
         template <typename ElemType>
         std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> SetContinuousBuffer(std::vector<size_t>& packedGradientsIndex, size_t packedGradientsSizeInBytes,
             const std::vector<NDArrayViewPtr>& inputValues, const std::vector<NDArrayViewPtr>& outputValues,
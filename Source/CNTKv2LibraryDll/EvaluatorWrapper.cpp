@@ -7,6 +7,7 @@
 
 #include "stdafx.h"
 #include "EvaluatorWrapper.h"
+#include "CompositeFunction.h"
 
 namespace CNTK
 {
@@ -15,13 +16,10 @@ namespace CNTK
 
     // Main interface
     CNTKEvaluatorWrapper::CNTKEvaluatorWrapper(FunctionPtr model, DeviceDescriptor device)
-        : m_func(model), m_device(device)
+        : m_func(model), m_device(device), m_maxBatchSize(0), m_maxBatchLatency(0), m_collectingBatch(false)
     {
-        for (const auto arg : m_func->Arguments())
-            m_arguments.insert(make_pair(WStringToString(arg.Name()), arg));
-
-        for (const auto arg : m_func->Outputs())
-            m_outputs.insert(make_pair(WStringToString(arg.Name()), arg));
+        for (const auto& arg : m_func->Arguments())
+            m_argumentRanks.insert(make_pair(WStringToString(arg.Name()), arg.Shape().Rank()));
     }
 
     CNTKEvaluatorWrapper::CNTKEvaluatorWrapper(const char* modelFilePath, DeviceDescriptor device) :
@@ -54,13 +52,118 @@ namespace CNTK
         const CNTK_Variable* outputs,
         uint32_t numOutputs,
         CNTK_Value** outputValues)
+    {
+        bool continuesSequence = any_of(inputResetFlags, inputResetFlags + numInputs, [](bool reset) { return !reset; });
+        if (!continuesSequence && m_maxBatchSize > 1)
+        {
+            BatchedRequest request;
+            request.m_inputs = inputs;
+            request.m_inputValues = inputValues;
+            request.m_numInputs = numInputs;
+            request.m_outputs = outputs;
+            request.m_numOutputs = numOutputs;
+            EvaluateBatched(request, outputValues);
+            return;
+        }
+
+        auto context = LeaseContext(continuesSequence);
+        try
+        {
+            EvaluateSequence(*context, inputs, inputValues, inputResetFlags, numInputs, outputs, numOutputs, outputValues);
+        }
+        catch (...)
+        {
+            ReturnContext(context);
+            throw;
+        }
+        ReturnContext(context);
+    }
+
+    // Returns an idle context, preferably the one the calling thread used last: its buffers are already sized for
+    // the requests of this thread and, unless another thread has used it since, it still holds the state of the
+    // sequences of this thread. A call that continues a sequence needs that state. If the calling thread has no
+    // context of its own, the caller may have moved to another thread (e.g. a thread pool), so it continues on the
+    // context of the last finished call, as long as no other call has taken that context since.
+    CNTKEvaluatorWrapper::EvaluationContextPtr CNTKEvaluatorWrapper::LeaseContext(bool continuesSequence)
+    {
+        auto self = this_thread::get_id();
+        lock_guard<mutex> lock(m_contextsLock);
+
+        auto own = find_if(m_idleContexts.begin(), m_idleContexts.end(), [self](const EvaluationContextPtr& c) { return c->m_lastUser == self; });
+        if (own != m_idleContexts.end())
+        {
+            auto context = *own;
+            m_idleContexts.erase(own);
+            return context;
+        }
+
+        if (continuesSequence && !m_contexts.empty())
+        {
+            auto last = find(m_idleContexts.begin(), m_idleContexts.end(), m_lastReturnedContext);
+            if (!m_lastReturnedContext || last == m_idleContexts.end())
+                InvalidArgument("The state of the sequence to continue is lost: another call is evaluating on it, or it was overwritten by a batch. "
+                                "Sequences that span several calls of concurrent callers must be evaluated on a model handle of their own (see CNTK_CloneModel).");
+
+            auto context = *last;
+            m_idleContexts.erase(last);
+            context->m_lastUser = self;
+            return context;
+        }
+
+        EvaluationContextPtr context;
+        if (!m_idleContexts.empty())
+        {
+            context = m_idleContexts.back();
+            m_idleContexts.pop_back();
+        }
+        else
+        {
+            context = make_shared<EvaluationContext>();
+            context->m_func = m_func->Clone(ParameterCloningMethod::Share);
+            if (!m_quantizedTimesPrecision.empty())
+                EnableQuantizedTimesInference(context->m_func);
+
+            for (const auto arg : context->m_func->Arguments())
+                context->m_arguments.insert(make_pair(WStringToString(arg.Name()), arg));
+
+            for (const auto arg : context->m_func->Outputs())
+                context->m_outputs.insert(make_pair(WStringToString(arg.Name()), arg));
+
+            m_contexts.push_back(context);
+        }
+
+        context->m_lastUser = self;
+        return context;
+    }
+
+    void CNTKEvaluatorWrapper::ReturnContext(const EvaluationContextPtr& context)
+    {
+        lock_guard<mutex> lock(m_contextsLock);
+        m_idleContexts.push_back(context);
+
+        // A context that evaluated a batch has no last user: its state is no sequence that a call can continue.
+        if (context->m_lastUser != thread::id())
+            m_lastReturnedContext = context;
+        else if (m_lastReturnedContext == context)
+            m_lastReturnedContext = nullptr;
+    }
+
+    void CNTKEvaluatorWrapper::EvaluateSequence(
+        EvaluationContext& context,
+        const CNTK_Variable* inputs,
+        const CNTK_Value* inputValues,
+        const bool* inputResetFlags,
+        uint32_t numInputs,
+        const CNTK_Variable* outputs,
+        uint32_t numOutputs,
+        CNTK_Value** outputValues)
     {
         // Prepare inputs.
         unordered_map<Variable, ValuePtr> preparedInputs;
         for (uint32_t i = 0; i < numInputs; ++i)
         {
-            auto var = m_arguments.find(inputs[i].name);
-            if (var == m_arguments.end())
+            auto var = context.m_arguments.find(inputs[i].name);
+            if (var == context.m_arguments.end())
                 InvalidArgument("Unexpected argument.");
 
             auto inputValue = inputValues[i];
@@ -75,8 +178,8 @@ namespace CNTK
         unordered_map<Variable, ValuePtr> preparedOutputs;
         for (uint32_t i = 0; i < numOutputs; ++i)
         {
-            auto var = m_outputs.find(outputs[i].name);
-            if (var == m_outputs.end())
+            auto var = context.m_outputs.find(outputs[i].name);
+            if (var == context.m_outputs.end())
                 InvalidArgument("Unexpected output.");
 
             ValuePtr value = nullptr;
@@ -91,7 +194,7 @@ namespace CNTK
             preparedOutputs[var->second] = value;
         }
 
-        m_func->Evaluate(preparedInputs, preparedOutputs, m_device);
+        context.m_func->Evaluate(preparedInputs, preparedOutputs, m_device);
 
         if (preparedOutputs.size() != numOutputs)
             RuntimeError("Number of evaluated outputs '%d' does not match passed value '%d'.",
@@ -106,8 +209,8 @@ namespace CNTK
         memset(result.get(), 0, sizeof(CNTK_Value) * preparedOutputs.size());
         for (uint32_t i = 0; i < numOutputs; ++i)
         {
-            auto var = m_outputs.find(outputs[i].name);
-            assert(var != m_outputs.end());
+            auto var = context.m_outputs.find(outputs[i].name);
+            assert(var != context.m_outputs.end());
 
             auto varToValue = preparedOutputs.find(var->second);
             if (varToValue == preparedOutputs.end())
@@ -137,6 +240,205 @@ namespace CNTK
         *outputValues = result.release();
     }
 
+    // Evaluates the request in a batch with other concurrent requests. The thread of a waiting request whose batch is not
+    // being collected yet collects it: it waits for requests that can join until the batch is full or the latency budget
+    // is spent, and then evaluates the batch while the threads of the next requests collect the next batches.
+    void CNTKEvaluatorWrapper::EvaluateBatched(BatchedRequest& request, CNTK_Value** outputValues)
+    {
+        {
+            unique_lock<mutex> lock(m_batchLock);
+            m_pendingRequests.push_back(&request);
+            m_batchCondition.notify_all();
+
+            while (!request.m_done)
+            {
+                if (request.m_taken || m_collectingBatch)
+                {
+                    m_batchCondition.wait(lock);
+                    continue;
+                }
+
+                m_collectingBatch = true;
+                auto batchIsFull = [this, &request]()
+                {
+                    return (size_t)count_if(m_pendingRequests.begin(), m_pendingRequests.end(),
+                        [this, &request](const BatchedRequest* other) { return other == &request || CanBatch(request, *other); }) >= m_maxBatchSize;
+                };
+                m_batchCondition.wait_until(lock, chrono::steady_clock::now() + m_maxBatchLatency, batchIsFull);
+
+                vector<BatchedRequest*> batch{ &request };
+                m_pendingRequests.erase(find(m_pendingRequests.begin(), m_pendingRequests.end(), &request));
+                for (auto other = m_pendingRequests.begin(); other != m_pendingRequests.end() && batch.size() < m_maxBatchSize;)
+                {
+                    if (CanBatch(request, **other))
+                    {
+                        batch.push_back(*other);
+                        other = m_pendingRequests.erase(other);
+                    }
+                    else
+                        ++other;
+                }
+
+                for (auto r : batch)
+                    r->m_taken = true;
+                m_collectingBatch = false;
+                m_batchCondition.notify_all();
+
+                lock.unlock();
+                EvaluateBatch(batch);
+                lock.lock();
+
+                for (auto r : batch)
+                    r->m_done = true;
+                m_batchCondition.notify_all();
+            }
+        }
+
+        if (request.m_error)
+            rethrow_exception(request.m_error);
+
+        if (*outputValues != nullptr) // Buffers have been preallocated.
+        {
+            for (uint32_t i = 0; i < request.m_numOutputs; ++i)
+            {
+                auto& buffer = (*outputValues)[i];
+                const auto& result = request.m_results[i];
+                if (ToNDShape(buffer.shape).TotalSize() != result.size())
+                    RuntimeError("Size of the buffer for output '%s' (%d) does not match the size of the output (%d).",
+                        request.m_outputs[i].name, (int)ToNDShape(buffer.shape).TotalSize(), (int)result.size());
+                std::copy(result.begin(), result.end(), buffer.data);
+            }
+            return;
+        }
+
+        auto arrayValueCleaner = std::bind(CleanAndDestroyValues, _1, request.m_numOutputs);
+        unique_ptr<CNTK_Value, decltype(arrayValueCleaner)> result(new CNTK_Value[request.m_numOutputs], arrayValueCleaner);
+        memset(result.get(), 0, sizeof(CNTK_Value) * request.m_numOutputs);
+        for (uint32_t i = 0; i < request.m_numOutputs; ++i)
+        {
+            // Making sure with cleaners we do not leak anything on exception.
+            CNTK_Value v{ {0, 0}, 0 };
+            unique_ptr<CNTK_Value, decltype(&CNTK_CleanValue)> valCleaner(&v, CNTK_CleanValue);
+            v.shape = FromNDShape(request.m_resultShapes[i]);
+            v.data = new float[request.m_results[i].size()];
+            std::copy(request.m_results[i].begin(), request.m_results[i].end(), v.data);
+            result.get()[i] = v;
+            valCleaner.release();
+        }
+
+        *outputValues = result.release();
+    }
+
+    // Evaluates the requests as one minibatch with a sequence per request and stores the outputs, or the error, in the requests.
+    void CNTKEvaluatorWrapper::EvaluateBatch(const vector<BatchedRequest*>& batch)
+    {
+        EvaluationContextPtr context;
+        try
+        {
+            context = LeaseContext(/*continuesSequence =*/ false);
+            const auto& first = *batch.front();
+
+            unordered_map<Variable, ValuePtr> preparedInputs;
+            vector<bool> sequenceStartFlags(batch.size(), true);
+            vector<vector<float>> sequences(batch.size());
+            for (uint32_t i = 0; i < first.m_numInputs; ++i)
+            {
+                auto var = context->m_arguments.find(first.m_inputs[i].name);
+                if (var == context->m_arguments.end())
+                    InvalidArgument("Unexpected argument.");
+
+                for (size_t j = 0; j < batch.size(); ++j)
+                {
+                    const auto& inputValue = batch[j]->m_inputValues[i];
+                    sequences[j].assign(inputValue.data, inputValue.data + ToNDShape(inputValue.shape).TotalSize());
+                }
+
+                auto sampleShape = ToNDShape(first.m_inputValues[i].shape).SubShape(0, var->second.Shape().Rank());
+                preparedInputs[var->second] = Value::Create(sampleShape, sequences, sequenceStartFlags, m_device);
+            }
+
+            unordered_map<Variable, ValuePtr> preparedOutputs;
+            vector<Variable> outputVars;
+            for (uint32_t i = 0; i < first.m_numOutputs; ++i)
+            {
+                auto var = context->m_outputs.find(first.m_outputs[i].name);
+                if (var == context->m_outputs.end())
+                    InvalidArgument("Unexpected output.");
+
+                outputVars.push_back(var->second);
+                preparedOutputs[var->second] = nullptr;
+            }
+
+            context->m_func->Evaluate(preparedInputs, preparedOutputs, m_device);
+
+            for (auto request : batch)
+            {
+                request->m_results.resize(outputVars.size());
+                request->m_resultShapes.resize(outputVars.size());
+            }
+
+            for (size_t i = 0; i < outputVars.size(); ++i)
+            {
+                auto value = preparedOutputs.at(outputVars[i]);
+                value->CopyVariableValueTo(outputVars[i], sequences);
+                if (sequences.size() != batch.size())
+                    RuntimeError("Number of evaluated sequences '%d' does not match the number of batched requests '%d'.",
+                        (int)sequences.size(), (int)batch.size());
+
+                // The same layout as the output of a single call: a sequence axis and a batch axis of 1.
+                auto sampleShape = value->Shape().SubShape(0, outputVars[i].Shape().Rank());
+                for (size_t j = 0; j < batch.size(); ++j)
+                {
+                    batch[j]->m_results[i].swap(sequences[j]);
+                    batch[j]->m_resultShapes[i] = sampleShape.AppendShape({ batch[j]->m_results[i].size() / sampleShape.TotalSize(), 1 });
+                }
+            }
+        }
+        catch (...)
+        {
+            auto error = current_exception();
+            for (auto request : batch)
+                request->m_error = error;
+        }
+
+        if (context)
+        {
+            // The network holds the state of the whole batch, which no call can continue.
+            context->m_lastUser = thread::id();
+            ReturnContext(context);
+        }
+    }
+
+    // Requests can be evaluated together if they have the same inputs, with the same sample shapes, and the same outputs.
+    bool CNTKEvaluatorWrapper::CanBatch(const BatchedRequest& first, const BatchedRequest& other) const
+    {
+        if (first.m_numInputs != other.m_numInputs || first.m_numOutputs != other.m_numOutputs)
+            return false;
+
+        for (uint32_t i = 0; i < first.m_numInputs; ++i)
+        {
+            if (strcmp(first.m_inputs[i].name, other.m_inputs[i].name) != 0)
+                return false;
+
+            auto rank = m_argumentRanks.find(first.m_inputs[i].name);
+            if (rank == m_argumentRanks.end())
+                return false;
+
+            const auto& a = first.m_inputValues[i].shape;
+            const auto& b = other.m_inputValues[i].shape;
+            if (a.size < rank->second || b.size < rank->second || !std::equal(a.value, a.value + rank->second, b.value))
+                return false;
+        }
+
+        for (uint32_t i = 0; i < first.m_numOutputs; ++i)
+        {
+            if (strcmp(first.m_outputs[i].name, other.m_outputs[i].name) != 0)
+                return false;
+        }
+
+        return true;
+    }
+
     unique_ptr<EvaluatorWrapper> CNTKEvaluatorWrapper::Clone(CNTK_ParameterCloningMethod method, bool flatten)
     {
         FunctionPtr cloned;
@@ -146,4 +448,33 @@ namespace CNTK
             cloned = m_func->Clone(ToNative(method));
         return unique_ptr<EvaluatorWrapper>(new CNTKEvaluatorWrapper(cloned, m_device));
     }
+
+    void CNTKEvaluatorWrapper::EnableQuantizedTimes(const char* precision)
+    {
+        assert(precision != nullptr);
+        auto wprecision = StringToWString(precision);
+        Microsoft::MSR::CNTK::QuantizedPrecisionFromString(wprecision); // validates it before any context is changed
+
+        lock_guard<mutex> lock(m_contextsLock);
+        m_quantizedTimesPrecision = wprecision;
+        m_quantizedWeights = make_shared<Microsoft::MSR::CNTK::QuantizedWeightsCache>();
+        EnableQuantizedTimesInference(m_func);
+        for (const auto& context : m_contexts)
+            EnableQuantizedTimesInference(context->m_func);
+    }
+
+    // The contexts are clones that share the parameters of the model, so they also share the quantized weights.
+    void CNTKEvaluatorWrapper::EnableQuantizedTimesInference(const FunctionPtr& func)
+    {
+        auto compositeFunction = dynamic_cast<CompositeFunction*>(func.get());
+        if (compositeFunction == nullptr)
+            LogicError("EnableQuantizedTimes: Function '%S' is not a composite Function (a model).", func->AsString().c_str());
+        compositeFunction->EnableQuantizedTimesInference(Microsoft::MSR::CNTK::QuantizedPrecisionFromString(m_quantizedTimesPrecision), 0, 0, m_quantizedWeights);
+    }
+
+    void CNTKEvaluatorWrapper::EnableRequestBatching(size_t maxBatchSize, chrono::microseconds maxLatency)
+    {
+        m_maxBatchSize = maxBatchSize;
+        m_maxBatchLatency = maxLatency;
+    }
 }
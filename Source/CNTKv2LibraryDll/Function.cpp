@@ -513,7 +513,10 @@ namespace CNTK
             if (!Internal::IsLegacyModel(*stream))
             {
                 Dictionary model;
-                *stream >> model;
+                if (Internal::IsMemoryMappedModelLoadingEnabled())
+                    model = Dictionary::Load(filepath);
+                else
+                    *stream >> model;
                 return Function::Deserialize(model, computeDevice);
             }
             else
@@ -3904,5 +3907,14 @@ namespace CNTK
 
             return AsBlock(std::move(result), {{operandPlaceholder, operand}}, std::move(attributes), L"Unsqueeze", name);
         }
+
+        void EnableQuantizedTimesInference(const FunctionPtr& model, const std::wstring& precision, size_t bitShiftA, size_t bitShiftB)
+        {
+            auto compositeFunction = dynamic_cast<CompositeFunction*>(model.get());
+            if (compositeFunction == nullptr)
+                InvalidArgument("EnableQuantizedTimesInference: Function '%S' is not a composite Function (a model).", model->AsString().c_str());
+
+            compositeFunction->EnableQuantizedTimesInference(Microsoft::MSR::CNTK::QuantizedPrecisionFromString(precision), bitShiftA, bitShiftB);
+        }
     }
 }
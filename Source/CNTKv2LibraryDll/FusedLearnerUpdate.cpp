@@ -0,0 +1,322 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "FusedLearnerUpdate.h"
+#include "Basics.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+namespace CNTK
+{
+    // Number of elements that a thread updates at a time: big enough to amortize the scheduling,
+    // small enough to balance the load and to stay in the cache between the update and the L1 step.
+    static const size_t s_blockSize = 16 * 1024;
+
+    // A contiguous range of the elements of a segment.
+    struct FusedUpdatePiece
+    {
+        size_t m_segment;
+        size_t m_begin;
+        size_t m_end;
+    };
+
+    // Cuts the segments into pieces of at most s_blockSize elements, and groups consecutive pieces
+    // into blocks of about s_blockSize elements. blockBegins[b] is the index of the first piece of block b.
+    template <typename ElementType>
+    static void PartitionSegments(const vector<FusedUpdateSegment<ElementType>>& segments, vector<FusedUpdatePiece>& pieces, vector<size_t>& blockBegins)
+    {
+        size_t blockElements = s_blockSize;
+        for (size_t s = 0; s < segments.size(); s++)
+        {
+            for (size_t begin = 0; begin < segments[s].m_size;)
+            {
+                if (blockElements >= s_blockSize)
+                {
+                    blockBegins.push_back(pieces.size());
+                    blockElements = 0;
+                }
+                size_t end = min(segments[s].m_size, begin + s_blockSize - blockElements);
+                pieces.push_back({ s, begin, end });
+                blockElements += end - begin;
+                begin = end;
+            }
+        }
+        blockBegins.push_back(pieces.size());
+    }
+
+    // Turns a raw gradient element into the one that the update rule sees: scaled to the mean gradient
+    // if needed, clipped, and with the L2 regularization term added, like LearnerBase::PreProcess().
+    template <typename ElementType>
+    struct GradientProcessor
+    {
+        ElementType m_scale;
+        ElementType m_truncation;
+        ElementType m_l2Weight;
+
+        ElementType operator()(ElementType g, ElementType w) const
+        {
+            g *= m_scale;
+            g = max(min(g, m_truncation), -m_truncation);
+            return g + m_l2Weight * w;
+        }
+    };
+
+    template <typename ElementType>
+    static void ApplyL1(ElementType* w, size_t begin, size_t end, ElementType threshold)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (w[i] > threshold)
+                w[i] -= threshold;
+            else if (w[i] < -threshold)
+                w[i] += threshold;
+            else
+                w[i] = 0;
+        }
+    }
+
+    // The update rules, one element at a time. They follow the CPU implementations in CPUMatrix.
+
+    template <typename ElementType>
+    static void UpdateSGD(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const auto learningRate = ElementType(rule.m_learningRate);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        for (size_t i = begin; i < end; i++)
+            w[i] -= learningRate * p(g[i], w[i]);
+    }
+
+    template <typename ElementType>
+    static void UpdateMomentumSGD(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const auto momentum = ElementType(rule.m_momentum);
+        const auto scaledLearningRate = ElementType(rule.m_unitGainFactor) * ElementType(rule.m_learningRate);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        ElementType* sg = s.m_state;
+        for (size_t i = begin; i < end; i++)
+        {
+            sg[i] = momentum * sg[i] + scaledLearningRate * p(g[i], w[i]);
+            w[i] -= sg[i];
+        }
+    }
+
+    template <typename ElementType>
+    static void UpdateNesterov(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const auto momentum = ElementType(rule.m_momentum);
+        const auto scaledLearningRate = ElementType(rule.m_unitGainFactor) * ElementType(rule.m_learningRate);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        ElementType* sg = s.m_state;
+        for (size_t i = begin; i < end; i++)
+        {
+            ElementType gi = p(g[i], w[i]);
+            sg[i] = momentum * sg[i] + scaledLearningRate * gi;
+            w[i] -= momentum * sg[i] + scaledLearningRate * gi;
+        }
+    }
+
+    template <typename ElementType>
+    static void UpdateAdaGrad(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const ElementType floor = 1e-16f;
+        const auto learningRate = ElementType(rule.m_learningRate);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        ElementType* accumulator = s.m_state;
+        for (size_t i = begin; i < end; i++)
+        {
+            ElementType gi = p(g[i], w[i]);
+            accumulator[i] += gi * gi;
+            w[i] -= learningRate * (gi / sqrt(accumulator[i] + floor));
+        }
+    }
+
+    template <typename ElementType>
+    static void UpdateRMSProp(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const ElementType floor = 1e-6f;
+        const auto learningRate = ElementType(rule.m_learningRate);
+        const auto gamma = ElementType(rule.m_gamma);
+        const auto oneMinusGamma = ElementType(1.0) - gamma;
+        const auto inc = ElementType(rule.m_inc), dec = ElementType(rule.m_dec);
+        const auto maxStep = ElementType(rule.m_max), minStep = ElementType(rule.m_min);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        ElementType* avars = s.m_state;              // accumulated variances for RMS scaling
+        ElementType* signs = s.m_state + s.m_size;   // sign of previous gradient
+        ElementType* steps = s.m_state + 2 * s.m_size; // current step size
+        for (size_t i = begin; i < end; i++)
+        {
+            ElementType gi = p(g[i], w[i]);
+            if (!rule.m_initialized)
+            {
+                avars[i] = gi * gi;
+                signs[i] = 0;
+                steps[i] = ElementType(0.02);
+            }
+
+            avars[i] = gamma * avars[i] + oneMinusGamma * (gi * gi);
+            const int gradSign = (ElementType(0) < gi) - (gi < ElementType(0));
+
+            if (signs[i] * gradSign > 0)
+                steps[i] = min(steps[i] * inc, maxStep);
+            else
+                steps[i] = max(steps[i] * dec, minStep);
+
+            signs[i] = (ElementType)gradSign;
+            w[i] -= learningRate * (gi * (steps[i] / sqrt(avars[i] + floor)));
+        }
+    }
+
+    template <typename ElementType>
+    static void UpdateFSAdaGrad(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const auto learningRate = ElementType(rule.m_learningRate);
+        const auto momentum = ElementType(rule.m_momentum);
+        const auto adaWeight = ElementType(rule.m_varianceMomentum);
+        const auto adaMul = ElementType(rule.m_adaMultiplier);
+        const auto unitGainFactor = ElementType(rule.m_unitGainFactor);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        ElementType* smoothAda = s.m_state;
+        ElementType* smoothMom = s.m_state + s.m_size;
+        for (size_t i = begin; i < end; i++)
+        {
+            ElementType gi = p(g[i], w[i]);
+            ElementType adaSqr = adaWeight * smoothAda[i] + (ElementType(1.0) - adaWeight) * gi * gi;
+            smoothAda[i] = adaSqr;
+            if (adaSqr != 0)
+            {
+                ElementType weight = min(adaMul * (ElementType(1.0) / sqrt(adaSqr)), ElementType(10.0));
+                gi *= weight;
+            }
+
+            if (momentum > 0)
+            {
+                gi = momentum * smoothMom[i] + unitGainFactor * gi;
+                smoothMom[i] = gi;
+            }
+
+            w[i] -= gi * learningRate;
+        }
+    }
+
+    template <typename ElementType>
+    static void UpdateAdam(const FusedUpdateRule& rule, const FusedUpdateSegment<ElementType>& s, size_t begin, size_t end, const GradientProcessor<ElementType>& p)
+    {
+        const auto learningRate = ElementType(rule.m_learningRate);
+        const auto momentum = ElementType(rule.m_momentum);
+        const auto adaWeight = ElementType(rule.m_varianceMomentum);
+        const auto adaMul = ElementType(rule.m_adaMultiplier);
+        const auto epsilon = ElementType(rule.m_epsilon);
+        const auto unitGainFactor = ElementType(rule.m_unitGainFactor);
+        ElementType* w = s.m_value;
+        const ElementType* g = s.m_gradient;
+        ElementType* smoothAda = s.m_state;
+        ElementType* smoothMom = s.m_state + s.m_size;
+        for (size_t i = begin; i < end; i++)
+        {
+            ElementType gi = p(g[i], w[i]);
+            ElementType ada;
+            if (!rule.m_adamax)
+            {
+                ElementType adaSqr = adaWeight * smoothAda[i] + (ElementType(1.0) - adaWeight) * gi * gi;
+                smoothAda[i] = adaSqr;
+                ada = sqrt(adaSqr);
+            }
+            else
+                ada = smoothAda[i] = max(adaWeight * smoothAda[i], (ElementType)fabs(gi));
+
+            ElementType weight = adaMul * (ElementType(1.0) / (ada + epsilon));
+            gi = momentum * smoothMom[i] + unitGainFactor * gi;
+            smoothMom[i] = gi;
+            w[i] -= gi * weight * learningRate;
+        }
+    }
+
+    template <typename ElementType>
+    void FusedLearnerUpdate(const FusedUpdateRule& rule, const FusedGradientProcessing& processing, const vector<FusedUpdateSegment<ElementType>>& segments)
+    {
+        typedef void (*UpdateFunction)(const FusedUpdateRule&, const FusedUpdateSegment<ElementType>&, size_t, size_t, const GradientProcessor<ElementType>&);
+        UpdateFunction update;
+        switch (rule.m_kind)
+        {
+        case FusedUpdateKind::SGD:         update = UpdateSGD<ElementType>; break;
+        case FusedUpdateKind::MomentumSGD: update = UpdateMomentumSGD<ElementType>; break;
+        case FusedUpdateKind::Nesterov:    update = UpdateNesterov<ElementType>; break;
+        case FusedUpdateKind::AdaGrad:     update = UpdateAdaGrad<ElementType>; break;
+        case FusedUpdateKind::RMSProp:     update = UpdateRMSProp<ElementType>; break;
+        case FusedUpdateKind::FSAdaGrad:   update = UpdateFSAdaGrad<ElementType>; break;
+        case FusedUpdateKind::Adam:        update = UpdateAdam<ElementType>; break;
+        default:
+            LogicError("FusedLearnerUpdate: unknown update kind %d.", (int)rule.m_kind);
+        }
+
+        vector<FusedUpdatePiece> pieces;
+        vector<size_t> blockBegins;
+        PartitionSegments(segments, pieces, blockBegins);
+        long numBlocks = (long)blockBegins.size() - 1;
+
+        // Per-segment gradient processing. Clipping by the norm needs the norm of each gradient first.
+        const bool clipping = processing.m_clippingThreshold != numeric_limits<double>::infinity();
+        GradientProcessor<ElementType> processor;
+        processor.m_scale = ElementType(processing.m_gradientScale);
+        processor.m_truncation = clipping && processing.m_clippingWithTruncation ? ElementType(processing.m_clippingThreshold) : numeric_limits<ElementType>::infinity();
+        processor.m_l2Weight = ElementType(processing.m_l2Weight);
+        vector<GradientProcessor<ElementType>> processors(segments.size(), processor);
+
+        if (clipping && !processing.m_clippingWithTruncation)
+        {
+            vector<double> pieceSquares(pieces.size());
+#pragma omp parallel for
+            for (long b = 0; b < numBlocks; b++)
+            {
+                for (size_t k = blockBegins[b]; k < blockBegins[b + 1]; k++)
+                {
+                    const auto& piece = pieces[k];
+                    const ElementType* g = segments[piece.m_segment].m_gradient;
+                    double sum = 0;
+                    for (size_t i = piece.m_begin; i < piece.m_end; i++)
+                        sum += (double)g[i] * g[i];
+                    pieceSquares[k] = sum;
+                }
+            }
+
+            vector<double> segmentSquares(segments.size(), 0.0);
+            for (size_t k = 0; k < pieces.size(); k++)
+                segmentSquares[pieces[k].m_segment] += pieceSquares[k];
+
+            for (size_t s = 0; s < segments.size(); s++)
+            {
+                double gradientNorm = fabs(processing.m_gradientScale) * sqrt(segmentSquares[s]);
+                if (gradientNorm > processing.m_clippingThreshold)
+                    processors[s].m_scale = ElementType(processing.m_gradientScale * (processing.m_clippingThreshold / gradientNorm));
+            }
+        }
+
+        const auto l1Threshold = ElementType(processing.m_l1Threshold);
+#pragma omp parallel for
+        for (long b = 0; b < numBlocks; b++)
+        {
+            for (size_t k = blockBegins[b]; k < blockBegins[b + 1]; k++)
+            {
+                const auto& piece = pieces[k];
+                const auto& segment = segments[piece.m_segment];
+                update(rule, segment, piece.m_begin, piece.m_end, processors[piece.m_segment]);
+                if (processing.m_l1Threshold > 0)
+                    ApplyL1(segment.m_value, piece.m_begin, piece.m_end, l1Threshold);
+            }
+        }
+    }
+
+    template void FusedLearnerUpdate<float>(const FusedUpdateRule&, const FusedGradientProcessing&, const vector<FusedUpdateSegment<float>>&);
+    template void FusedLearnerUpdate<double>(const FusedUpdateRule&, const FusedGradientProcessing&, const vector<FusedUpdateSegment<double>>&);
+}
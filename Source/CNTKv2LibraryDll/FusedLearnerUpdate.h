@@ -0,0 +1,77 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <limits>
+#include <vector>
+
+namespace CNTK
+{
+    // Update rules that LearnerBase can apply to all dense CPU parameters of a learner in a single pass,
+    // instead of running several Matrix operations per parameter.
+    enum class FusedUpdateKind
+    {
+        SGD,
+        MomentumSGD,
+        Nesterov,
+        AdaGrad,
+        RMSProp,
+        FSAdaGrad,
+        Adam,
+    };
+
+    // Hyper-parameters of the update for the current minibatch. Which of them are used depends on the kind;
+    // they have the same meaning as the arguments of the corresponding Matrix update methods.
+    struct FusedUpdateRule
+    {
+        FusedUpdateKind m_kind = FusedUpdateKind::SGD;
+        size_t m_stateFactor = 0;       // number of elements of smoothed gradient state per parameter element
+
+        double m_learningRate = 0;
+        double m_momentum = 0;
+        double m_unitGainFactor = 1;
+        double m_varianceMomentum = 0;  // FSAdaGrad, Adam
+        double m_adaMultiplier = 1;     // FSAdaGrad: target denominator; Adam: bias correction
+        double m_epsilon = 0;           // Adam
+        bool m_adamax = false;          // Adam
+
+        // RMSProp
+        double m_gamma = 0;
+        double m_inc = 0;
+        double m_dec = 0;
+        double m_max = 0;
+        double m_min = 0;
+        bool m_initialized = true;
+    };
+
+    // The gradient preprocessing and the L1 postprocessing of LearnerBase, folded into the update.
+    struct FusedGradientProcessing
+    {
+        double m_gradientScale = 1;     // 1 / minibatch size in compatible mode
+        double m_clippingThreshold = std::numeric_limits<double>::infinity();
+        bool m_clippingWithTruncation = true;
+        double m_l2Weight = 0;
+        double m_l1Threshold = 0;       // soft threshold applied to the parameters after the update
+    };
+
+    // A parameter to update: its value, gradient and smoothed gradient buffers, all dense and on the CPU.
+    // The state holds m_stateFactor consecutive blocks of m_size elements.
+    template <typename ElementType>
+    struct FusedUpdateSegment
+    {
+        ElementType* m_value;
+        const ElementType* m_gradient;
+        ElementType* m_state;
+        size_t m_size;
+    };
+
+    // Updates all segments. The elements of all segments are treated as one flat range, which is cut into
+    // blocks of similar size that are processed in parallel; small parameters share a block, so the cost
+    // per parameter is a few instructions rather than several kernel calls. The gradients are not modified.
+    template <typename ElementType>
+    void FusedLearnerUpdate(const FusedUpdateRule& rule, const FusedGradientProcessing& processing, const std::vector<FusedUpdateSegment<ElementType>>& segments);
+}
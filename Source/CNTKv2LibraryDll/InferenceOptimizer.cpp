@@ -0,0 +1,262 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// InferenceOptimizer.cpp -- simplification of a Function graph that is only used for evaluation (see Function::CloneForInference())
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "PrimitiveFunction.h"
+#include "PrimitiveFunctionAttribute.h"
+#include "CompositeFunction.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace CNTK
+{
+    // The values of a Constant, converted to double.
+    static std::vector<double> ValuesOf(const Variable& constant)
+    {
+        auto value = Constant(constant).Value()->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly=*/true);
+        auto size = value->Shape().TotalSize();
+        std::vector<double> values(size);
+        if (value->GetDataType() == DataType::Float)
+        {
+            auto data = value->DataBuffer<float>();
+            std::copy(data, data + size, values.begin());
+        }
+        else if (value->GetDataType() == DataType::Double)
+        {
+            auto data = value->DataBuffer<double>();
+            std::copy(data, data + size, values.begin());
+        }
+        else
+            LogicError("CloneForInference: Unexpected DataType '%s'.", DataTypeName(value->GetDataType()));
+
+        return values;
+    }
+
+    static Constant ConstantFromValues(const std::vector<double>& values, const NDShape& shape, DataType dataType, const DeviceDescriptor& device, const std::wstring& name)
+    {
+        auto value = MakeSharedObject<NDArrayView>(dataType, shape, DeviceDescriptor::CPUDevice());
+        if (dataType == DataType::Float)
+            std::copy(values.begin(), values.end(), value->WritableDataBuffer<float>());
+        else if (dataType == DataType::Double)
+            std::copy(values.begin(), values.end(), value->WritableDataBuffer<double>());
+        else
+            LogicError("CloneForInference: Unexpected DataType '%s'.", DataTypeName(dataType));
+
+        return Constant(value->DeepClone(device, /*readOnly=*/false), name);
+    }
+
+    static bool IsDenseConstantOfType(const Variable& variable, DataType dataType)
+    {
+        return variable.IsConstant() && (variable.GetDataType() == dataType) && !variable.IsSparse();
+    }
+
+    // Operations that pass their input through unchanged when not training.
+    static bool IsIdentityForInference(PrimitiveOpType op)
+    {
+        return (op == PrimitiveOpType::Dropout) ||
+               (op == PrimitiveOpType::StopGradient) ||
+               (op == PrimitiveOpType::Pass) ||
+               (op == PrimitiveOpType::NoOp);
+    }
+
+    // Removes operations that are the identity during evaluation, and replaces operations whose inputs are all Constants
+    // by Constants holding their outputs, computed on 'computeDevice'. Functions that compute one of the 'modelOutputs'
+    // are kept, so that the outputs keep their names.
+    static FunctionPtr RemoveIdentitiesAndFoldConstants(const FunctionPtr& clonee, const std::vector<Variable>& clonedInputs,
+                                                        const std::unordered_set<Variable>& modelOutputs, const DeviceDescriptor& computeDevice)
+    {
+        auto primitiveFunction = dynamic_cast<const PrimitiveFunction*>(clonee.get());
+        auto cloneeOutputs = clonee->Outputs();
+        if (!primitiveFunction || std::any_of(cloneeOutputs.begin(), cloneeOutputs.end(), [&modelOutputs](const Variable& output) { return modelOutputs.find(output) != modelOutputs.end(); }))
+            return clonee->Clone(clonedInputs);
+
+        auto op = primitiveFunction->OpType();
+        if (IsIdentityForInference(op) && !clonedInputs[0].IsPlaceholder())
+            return Combine({ clonedInputs[0] }); // (the outputs of a Combine are its inputs)
+
+        bool allInputsConstant = !clonedInputs.empty() &&
+            std::all_of(clonedInputs.begin(), clonedInputs.end(), [](const Variable& input) { return input.IsConstant(); });
+        if (!allInputsConstant || primitiveFunction->IsStateful() || (op == PrimitiveOpType::Combine) || (op == PrimitiveOpType::Assign))
+            return clonee->Clone(clonedInputs);
+
+        auto clonedFunction = AsComposite(clonee->Clone(clonedInputs));
+        auto outputVariables = clonedFunction->Outputs();
+        std::unordered_map<Variable, ValuePtr> outputs;
+        for (const auto& output : outputVariables)
+        {
+            if (!output.DynamicAxes().empty() || output.Shape().HasUnboundDimension())
+                return clonedFunction->RootFunction();
+            outputs[output] = nullptr;
+        }
+
+        clonedFunction->Evaluate({}, outputs, computeDevice);
+
+        std::vector<Variable> constants;
+        for (const auto& output : outputVariables)
+        {
+            auto value = outputs.at(output)->Data();
+            if (value->Shape().TotalSize() != output.Shape().TotalSize())
+                return clonedFunction->RootFunction();
+            constants.push_back(Constant(value->AsShape(output.Shape())->DeepClone(value->Device(), /*readOnly=*/false), output.Name()));
+        }
+
+        return Combine(constants);
+    }
+
+    // Replaces BatchNormalization(Convolution(W, x)) and BatchNormalization(Times(W, x)), optionally with a Constant added
+    // before the normalization, by the Convolution or Times with scaled weights plus a Constant. In inference mode,
+    // BatchNormalization computes scale * (z - mean) / sqrt(variance + epsilon) + bias with its running statistics,
+    // which is a per-channel affine function. 'clonee' is in the graph whose 'consumers' were counted.
+    static FunctionPtr FoldBatchNormalization(const FunctionPtr& clonee, const std::vector<Variable>& clonedInputs,
+                                              const std::unordered_map<Variable, size_t>& consumers)
+    {
+        auto primitiveFunction = dynamic_cast<const PrimitiveFunction*>(clonee.get());
+        if (!primitiveFunction || (primitiveFunction->OpType() != PrimitiveOpType::BatchNormalization))
+            return clonee->Clone(clonedInputs);
+
+        auto numConsumers = [&consumers](const Variable& variable) {
+            auto iter = consumers.find(variable);
+            return (iter == consumers.end()) ? 0 : iter->second;
+        };
+        auto opTypeOf = [](const FunctionPtr& function) {
+            auto primitive = dynamic_cast<const PrimitiveFunction*>(function.get());
+            return primitive ? primitive->OpType() : PrimitiveOpType::Block;
+        };
+
+        // Find the Convolution or Times, in the original graph (to count consumers) and in the clone (to build upon).
+        auto normalized = clonee->Inputs()[0];
+        auto clonedNormalized = clonedInputs[0];
+        auto dataType = clonedNormalized.GetDataType();
+        if (!clonedNormalized.IsOutput() || (numConsumers(normalized) != 1) || ((dataType != DataType::Float) && (dataType != DataType::Double)))
+            return clonee->Clone(clonedInputs);
+
+        auto linear = normalized.Owner();
+        auto clonedLinear = clonedNormalized.Owner();
+        Variable shift; // a Constant added to the output of the Convolution or Times, if any
+        if (opTypeOf(linear) == PrimitiveOpType::Plus)
+        {
+            auto plusInputs = clonedLinear->Inputs();
+            size_t linearIndex = plusInputs[0].IsOutput() ? 0 : 1;
+            if (!IsDenseConstantOfType(plusInputs[1 - linearIndex], dataType) || !plusInputs[linearIndex].IsOutput() || (numConsumers(linear->Inputs()[linearIndex]) != 1))
+                return clonee->Clone(clonedInputs);
+
+            shift = plusInputs[1 - linearIndex];
+            linear = linear->Inputs()[linearIndex].Owner();
+            clonedLinear = plusInputs[linearIndex].Owner();
+        }
+
+        auto linearOp = opTypeOf(clonedLinear);
+        if (((linearOp != PrimitiveOpType::Convolution) && (linearOp != PrimitiveOpType::Times)) || (clonedLinear->Output().Shape() != clonedNormalized.Shape()))
+            return clonee->Clone(clonedInputs);
+
+        auto weights = clonedLinear->Inputs()[0];
+        auto operand = clonedLinear->Inputs()[1];
+        if (!IsDenseConstantOfType(weights, dataType) || (weights.Shape().Rank() < 1))
+            return clonee->Clone(clonedInputs);
+
+        for (size_t i = 1; i <= 4; ++i)
+        {
+            if (!IsDenseConstantOfType(clonedInputs[i], dataType))
+                return clonee->Clone(clonedInputs);
+        }
+
+        // The weights of output channel c are the elements e with (e / channelStride) % numChannels == c.
+        const auto& attributes = primitiveFunction->Attributes();
+        const auto& linearAttributes = clonedLinear->Attributes();
+        bool spatial = attributes[PrimitiveFunctionAttribute::AttributeNameSpatial].Value<bool>();
+        auto outputShape = clonedNormalized.Shape();
+        size_t numChannels, channelStride;
+        NDShape shiftShape;
+        if (linearOp == PrimitiveOpType::Convolution)
+        {
+            // The kernel is [kernel dimensions x input channels x output channels], the output is [spatial dimensions x output channels].
+            bool transpose = linearAttributes.Contains(PrimitiveFunctionAttribute::AttributeNameTranspose) && linearAttributes[PrimitiveFunctionAttribute::AttributeNameTranspose].Value<bool>();
+            bool sequential = linearAttributes.Contains(PrimitiveFunctionAttribute::AttributeNameSequential) && linearAttributes[PrimitiveFunctionAttribute::AttributeNameSequential].Value<bool>();
+            numChannels = weights.Shape()[weights.Shape().Rank() - 1];
+            if (!spatial || transpose || sequential || (outputShape.Rank() < 1) || (outputShape[outputShape.Rank() - 1] != numChannels))
+                return clonee->Clone(clonedInputs);
+
+            channelStride = weights.Shape().TotalSize() / numChannels;
+            shiftShape = NDShape(outputShape.Rank(), 1);
+            shiftShape[shiftShape.Rank() - 1] = numChannels;
+        }
+        else
+        {
+            // The weights are [output dimensions x input dimensions].
+            auto outputRank = linearAttributes[PrimitiveFunctionAttribute::AttributeNameOutputRank].Value<size_t>();
+            numChannels = weights.Shape().SubShape(0, outputRank).TotalSize();
+            if (spatial || (outputShape.TotalSize() != numChannels))
+                return clonee->Clone(clonedInputs);
+
+            channelStride = 1;
+            shiftShape = outputShape;
+        }
+
+        // the shift must be a scalar or have one value per channel, laid out like the channels of the output
+        std::vector<double> shiftValues;
+        if (shift != Variable())
+        {
+            bool isScalar = (shift.Shape().TotalSize() == 1) && (shift.Shape().Rank() <= outputShape.Rank());
+            if (!isScalar && (shift.Shape() != shiftShape))
+                return clonee->Clone(clonedInputs);
+            shiftValues = ValuesOf(shift);
+        }
+
+        auto scale = ValuesOf(clonedInputs[1]);
+        auto bias = ValuesOf(clonedInputs[2]);
+        auto mean = ValuesOf(clonedInputs[3]);
+        auto variance = ValuesOf(clonedInputs[4]);
+        if ((scale.size() != numChannels) || (bias.size() != numChannels) || (mean.size() != numChannels) || (variance.size() != numChannels))
+            return clonee->Clone(clonedInputs);
+
+        auto epsilon = attributes[PrimitiveFunctionAttribute::AttributeNameEpsilon].Value<double>();
+        std::vector<double> factor(numChannels), offset(numChannels);
+        for (size_t c = 0; c < numChannels; ++c)
+        {
+            factor[c] = scale[c] / std::sqrt(variance[c] + epsilon);
+            double shiftValue = shiftValues.empty() ? 0 : shiftValues[(shiftValues.size() == 1) ? 0 : c];
+            offset[c] = bias[c] + factor[c] * (shiftValue - mean[c]);
+        }
+
+        auto weightValues = ValuesOf(weights);
+        for (size_t e = 0; e < weightValues.size(); ++e)
+            weightValues[e] *= factor[(e / channelStride) % numChannels];
+
+        auto device = Constant(weights).Value()->Device();
+        auto foldedWeights = ConstantFromValues(weightValues, weights.Shape(), dataType, device, weights.Name());
+        auto foldedLinear = clonedLinear->Clone({ foldedWeights, operand });
+        auto foldedOffset = ConstantFromValues(offset, shiftShape, dataType, device, clonee->Name() + L"_offset");
+        return Plus(foldedLinear->Output(), foldedOffset, clonee->Name());
+    }
+
+    FunctionPtr Function::CloneForInference(const DeviceDescriptor& computeDevice) const
+    {
+        // Blocks are inlined so that their insides can be optimized, and Parameters become Constants.
+        auto flattened = CloneFlattened(ParameterCloningMethod::Freeze);
+
+        auto outputs = flattened->Outputs();
+        std::unordered_set<Variable> modelOutputs(outputs.begin(), outputs.end());
+        auto simplified = flattened->CloneImpl(ParameterCloningMethod::Share, {}, [&modelOutputs, &computeDevice](const FunctionPtr& clonee, const std::vector<Variable>& clonedInputs) {
+            return RemoveIdentitiesAndFoldConstants(clonee, clonedInputs, modelOutputs, computeDevice);
+        });
+
+        // BatchNormalization can only be folded into a Convolution or Times whose output is used by nothing else.
+        std::unordered_map<Variable, size_t> consumers;
+        PreorderTraverseFunctions(simplified->RootFunction(), [&consumers](const FunctionPtr& function) {
+            for (const auto& input : function->Inputs())
+                consumers[input]++;
+        });
+        for (const auto& output : simplified->Outputs())
+            consumers[output]++;
+
+        return simplified->CloneImpl(ParameterCloningMethod::Share, {}, [&consumers](const FunctionPtr& clonee, const std::vector<Variable>& clonedInputs) {
+            return FoldBatchNormalization(clonee, clonedInputs, consumers);
+        });
+    }
+}
@@ -293,9 +293,20 @@ namespace CNTK
 
         UpdateOnMinibatch(trainingSampleCount);
 
+        // Dense CPU parameters are updated together if the learner supports it; the loop below does the rest.
+        std::vector<bool> fused;
+        FusedUpdateRule fusedUpdateRule;
+        if (Internal::AreFusedLearnerUpdatesEnabled() && GetFusedUpdateRule(trainingSampleCount, fusedUpdateRule))
+            fused = FusedUpdate(fusedUpdateRule, gradientValues, trainingSampleCount);
+
         bool needUpdateMasterParameter = !m_masterParameterUpdated;
-        for (const auto& parameter : Parameters())
+        const auto& parameters = Parameters();
+        for (size_t i = 0; i < parameters.size(); i++)
         {
+            if (!fused.empty() && fused[i])
+                continue;
+
+            const auto& parameter = parameters[i];
             const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
             const auto& gradientValue = gradientValues.at(parameter);
 
@@ -381,6 +392,88 @@ namespace CNTK
         paramRef.RecordValueUpdate();
     }
 
+    std::vector<bool> LearnerBase::FusedUpdate(const FusedUpdateRule& rule, unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount)
+    {
+        const auto& parameters = Parameters();
+        std::vector<bool> fused(parameters.size(), false);
+
+        // Noise injection draws its random numbers per parameter matrix; leave it to the per-parameter path.
+        if (GetCurrentTrainingParameterValue(m_additionalOptions.gaussianNoiseInjectionStdDev) > 0)
+            return fused;
+
+        // The same preprocessing as PreProcess() and the L1 step of PostProcess().
+        FusedGradientProcessing processing;
+        if (IsCompatibleMode())
+            processing.m_gradientScale = 1.0 / trainingSampleCount;
+        if (m_additionalOptions.gradientClippingThresholdPerSample != numeric_limits<double>::infinity())
+        {
+            double gradientClippingThresholdPerSample = m_additionalOptions.gradientClippingThresholdPerSample;
+            processing.m_clippingThreshold = IsCompatibleMode() ? gradientClippingThresholdPerSample : gradientClippingThresholdPerSample * trainingSampleCount;
+            processing.m_clippingWithTruncation = m_additionalOptions.gradientClippingWithTruncation;
+        }
+        if (m_additionalOptions.l2RegularizationWeight > 0)
+            processing.m_l2Weight = m_additionalOptions.l2RegularizationWeight * (IsCompatibleMode() ? 1 : trainingSampleCount);
+        if (m_additionalOptions.l1RegularizationWeight > 0)
+            processing.m_l1Threshold = LearningRate(trainingSampleCount) * m_additionalOptions.l1RegularizationWeight * (IsCompatibleMode() ? 1 : trainingSampleCount);
+
+        std::vector<FusedUpdateSegment<float>> floatSegments;
+        std::vector<FusedUpdateSegment<double>> doubleSegments;
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            const auto& parameter = parameters[i];
+            const auto& gradientValue = gradientValues.at(parameter);
+            const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
+            if (parameter.GetDataType() == DataType::Float)
+                fused[i] = AddFusedUpdateSegment<float>(rule, parameter, gradientValue, smoothedGradientValue, floatSegments);
+            else if (parameter.GetDataType() == DataType::Double)
+                fused[i] = AddFusedUpdateSegment<double>(rule, parameter, gradientValue, smoothedGradientValue, doubleSegments);
+        }
+
+        if (!floatSegments.empty())
+            FusedLearnerUpdate(rule, processing, floatSegments);
+        if (!doubleSegments.empty())
+            FusedLearnerUpdate(rule, processing, doubleSegments);
+
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            if (fused[i])
+            {
+                auto paramRef = parameters[i];
+                paramRef.RecordValueUpdate();
+            }
+        }
+        return fused;
+    }
+
+    template <typename ElementType>
+    /*static*/ bool LearnerBase::AddFusedUpdateSegment(const FusedUpdateRule& rule, const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue,
+                                                       std::vector<FusedUpdateSegment<ElementType>>& segments)
+    {
+        const auto& parameterValue = parameter.Value();
+        if (gradientValue->GetDataType() != parameter.GetDataType() || gradientValue->IsSparse() || parameterValue->IsSparse() ||
+            gradientValue->Device().Type() != DeviceKind::CPU || parameterValue->Device().Type() != DeviceKind::CPU)
+            return false;
+
+        const auto& parameterMatrix = GetWritableMatrix<ElementType>(parameterValue);
+        const auto& gradientMatrix = GetMatrix<ElementType>(gradientValue);
+        size_t size = parameterMatrix->GetNumElements();
+        if (gradientMatrix->GetNumElements() != size)
+            return false;
+
+        ElementType* state = nullptr;
+        if (rule.m_stateFactor > 0)
+        {
+            // Some learners use a different layout of the smoothed gradients on the GPU or with some options.
+            const auto& smoothedGradientMatrix = GetWritableMatrix<ElementType>(smoothedGradientValue);
+            if (smoothedGradientMatrix->GetNumElements() != rule.m_stateFactor * size)
+                return false;
+            state = smoothedGradientMatrix->Data();
+        }
+
+        segments.push_back({ parameterMatrix->Data(), gradientMatrix->Data(), state, size });
+        return true;
+    }
+
     string LearnerBase::LearnerType() const
     {
         return Typename(this);
@@ -531,6 +624,14 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ bool LearnerSGD::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        rule.m_kind = FusedUpdateKind::SGD;
+        rule.m_stateFactor = 0;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerSGD::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                             const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -574,6 +675,18 @@ namespace CNTK
         }
     }
 
+    /*virtual*/ bool LearnerMomentumSGD::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        ReportTrainingParameterValue(m_momentumSchedule, L"Momentum");
+
+        rule.m_kind = FusedUpdateKind::MomentumSGD;
+        rule.m_stateFactor = 1;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        rule.m_momentum = MomentumValueForMB(trainingSampleCount);
+        rule.m_unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerMomentumSGD::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                     const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -650,6 +763,16 @@ namespace CNTK
         }
     }
 
+    /*virtual*/ bool LearnerNesterov::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        rule.m_kind = FusedUpdateKind::Nesterov;
+        rule.m_stateFactor = 1;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        rule.m_momentum = MomentumValueForMB(trainingSampleCount);
+        rule.m_unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerNesterov::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                  const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -711,6 +834,18 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ bool LearnerAdaGrad::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        // The average multiplier is a reduction over each parameter, which the single pass cannot provide.
+        if (m_needAveMultiplier)
+            return false;
+
+        rule.m_kind = FusedUpdateKind::AdaGrad;
+        rule.m_stateFactor = 1;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerAdaGrad::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                 const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -916,6 +1051,18 @@ namespace CNTK
         m_targetAdagradAvDenom_x_sqrtAdagradSqrFrames = s_targetAdagradAvDenom * sqrt(m_smoothedCount);
     }
 
+    /*virtual*/ bool LearnerFSAdaGrad::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        rule.m_kind = FusedUpdateKind::FSAdaGrad;
+        rule.m_stateFactor = 2;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        rule.m_momentum = MomentumValueForMB(trainingSampleCount);
+        rule.m_varianceMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+        rule.m_unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        rule.m_adaMultiplier = m_targetAdagradAvDenom_x_sqrtAdagradSqrFrames;
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerFSAdaGrad::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                   const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -985,6 +1132,23 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ bool LearnerAdam::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        rule.m_kind = FusedUpdateKind::Adam;
+        rule.m_stateFactor = 2;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        rule.m_momentum = MomentumValueForMB(trainingSampleCount);
+        rule.m_varianceMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+        rule.m_unitGainFactor = UnitGainFactor<double>(trainingSampleCount);
+        rule.m_epsilon = m_epsilon;
+        rule.m_adamax = m_adamax;
+
+        // bias correction, as in Matrix::AdamUpdate()
+        const double meanCorrection = 1 - pow(rule.m_momentum, m_smoothedCount);
+        rule.m_adaMultiplier = m_adamax ? 1 / meanCorrection : sqrt(1 - pow(rule.m_varianceMomentum, m_smoothedCount)) / meanCorrection;
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerAdam::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
         const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -1072,6 +1236,24 @@ namespace CNTK
         m_smoothedCount += 1.0;
     }
 
+    /*virtual*/ bool LearnerRMSProp::GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const /*override*/
+    {
+        // The average multiplier is a reduction over each parameter, which the single pass cannot provide.
+        if (m_needAveMultiplier)
+            return false;
+
+        rule.m_kind = FusedUpdateKind::RMSProp;
+        rule.m_stateFactor = 3;
+        rule.m_learningRate = LearningRate(trainingSampleCount);
+        rule.m_gamma = m_gamma;
+        rule.m_inc = m_inc;
+        rule.m_dec = m_dec;
+        rule.m_max = m_max;
+        rule.m_min = m_min;
+        rule.m_initialized = m_smoothedCount > 1;
+        return true;
+    }
+
     template <typename ElementType>
     void LearnerRMSProp::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                 const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
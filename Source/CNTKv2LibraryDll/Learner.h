@@ -7,6 +7,7 @@
 
 #include "stdafx.h"
 #include "CNTKLibrary.h"
+#include "FusedLearnerUpdate.h"
 #include <numeric>
 #include <functional>
 
@@ -41,6 +42,11 @@ namespace CNTK
         // Allows derived class may override this to perform per-minibatch update actions
         virtual void UpdateOnMinibatch(size_t /*trainingSampleCount*/) {}
 
+        // Describes the update of the current minibatch, so that all dense CPU parameters can be updated in a single pass
+        // by FusedLearnerUpdate(). Returns false if the learner, with its current options, has no fused implementation;
+        // then each parameter is updated by the virtual Update() above.
+        virtual bool GetFusedUpdateRule(size_t /*trainingSampleCount*/, FusedUpdateRule& /*rule*/) const { return false; }
+
         std::string LearnerType() const;
 
         // Returns current learning rate.
@@ -123,6 +129,13 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount);
 
+        // Updates the parameters that the fused update supports in a single pass, and returns which ones it updated.
+        std::vector<bool> FusedUpdate(const FusedUpdateRule& rule, std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount);
+
+        template <typename ElementType>
+        static bool AddFusedUpdateSegment(const FusedUpdateRule& rule, const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue,
+                                          std::vector<FusedUpdateSegment<ElementType>>& segments);
+
         // TODO: make these functions friends of NDViewArray and move to Utils?
         static bool HasNan(const NDArrayViewPtr& value, const char* name);
         static void Print(const NDArrayViewPtr& value, const char* msg);
@@ -150,6 +163,7 @@ namespace CNTK
     protected:
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -180,6 +194,7 @@ namespace CNTK
 
     protected:
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElemType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -227,6 +242,7 @@ namespace CNTK
 
     protected:
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -245,6 +261,7 @@ namespace CNTK
         bool m_needAveMultiplier;
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -303,6 +320,7 @@ namespace CNTK
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -344,6 +362,7 @@ namespace CNTK
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -391,6 +410,7 @@ namespace CNTK
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) override;
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
+        virtual bool GetFusedUpdateRule(size_t trainingSampleCount, FusedUpdateRule& rule) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
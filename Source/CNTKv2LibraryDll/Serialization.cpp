@@ -14,6 +14,14 @@
 
 #ifdef _MSC_VER
 #include <io.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #pragma warning(push)
@@ -31,6 +39,21 @@ namespace CNTK
     static const uint32 MAGIC_NUMBER = 0x636e746bU;
     static const uint32 BLOCK_SIZE = 8 << 10; // 8Kb;
 
+    // When the NDArrayView values follow the protobuf message, the message is padded so that they start at a file offset
+    // that is a multiple of PAYLOAD_ALIGNMENT, which lets a memory-mapped file be used in place (see MappedModelFile).
+    // The padding is a length-delimited field (number 15) that neither Dictionary nor DictionaryValue define, so it is
+    // skipped when the message is parsed.
+    static const size_t PAYLOAD_ALIGNMENT = 64;
+    static const uint8 PADDING_FIELD_TAG = (15 << 3) | 2;
+
+    // Size of the padding field that moves 'offset' to the next multiple of PAYLOAD_ALIGNMENT.
+    // The smallest field is two bytes long (tag and length), so a single byte becomes a whole alignment unit more.
+    static size_t PaddingSize(size_t offset)
+    {
+        size_t paddingSize = (PAYLOAD_ALIGNMENT - offset % PAYLOAD_ALIGNMENT) % PAYLOAD_ALIGNMENT;
+        return (paddingSize == 1) ? paddingSize + PAYLOAD_ALIGNMENT : paddingSize;
+    }
+
     static void SetUTF8Locale()
     {
 #ifndef _MSC_VER
@@ -100,6 +123,31 @@ namespace CNTK
             return false;
         }
 
+        inline bool ReadVarint32(uint32* value)
+        {
+            const int maxVarintSize = 10;
+            if (m_codedInputPtr->CurrentPosition() > INT_MAX - maxVarintSize)
+                Renew();
+
+            return m_codedInputPtr->ReadVarint32(value);
+        }
+
+        inline bool ReadRaw(void* buffer, size_t size)
+        {
+            auto bytes = static_cast<char*>(buffer);
+            while (size > 0)
+            {
+                int chunkSize = (int)std::min(size, (size_t)BLOCK_SIZE);
+                if (m_codedInputPtr->CurrentPosition() > INT_MAX - chunkSize)
+                    Renew();
+                if (!m_codedInputPtr->ReadRaw(bytes, chunkSize))
+                    return false;
+                bytes += chunkSize;
+                size -= chunkSize;
+            }
+            return true;
+        }
+
     private:
         void Renew()
         {
@@ -113,6 +161,63 @@ namespace CNTK
     };
 
 
+    // A copy-on-write mapping of a whole model file. NDArrayViews that use the mapped file as their storage keep it alive.
+    class MappedModelFile
+    {
+    public:
+        MappedModelFile(const std::wstring& filename)
+            : m_data(nullptr), m_size(0)
+        {
+            auto fd = GetFileDescriptor(filename, true);
+#ifdef _MSC_VER
+            struct _stat64 fileInfo;
+            if (_fstat64(fd, &fileInfo) == 0 && fileInfo.st_size > 0)
+            {
+                m_size = (size_t)fileInfo.st_size;
+                HANDLE mapping = CreateFileMappingW((HANDLE)_get_osfhandle(fd), NULL, PAGE_WRITECOPY, 0, 0, NULL);
+                if (mapping != NULL)
+                {
+                    m_data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, m_size));
+                    CloseHandle(mapping); // the view keeps the mapping alive
+                }
+            }
+            _close(fd);
+#else
+            struct stat fileInfo;
+            if (fstat(fd, &fileInfo) == 0 && fileInfo.st_size > 0)
+            {
+                m_size = (size_t)fileInfo.st_size;
+                void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                    m_data = static_cast<char*>(data);
+            }
+            close(fd);
+#endif
+            if (m_size > 0 && m_data == nullptr)
+                RuntimeError("Failed to memory-map the model file '%S'.", filename.c_str());
+        }
+
+        ~MappedModelFile()
+        {
+            if (m_data == nullptr)
+                return;
+#ifdef _MSC_VER
+            UnmapViewOfFile(m_data);
+#else
+            munmap(m_data, m_size);
+#endif
+        }
+
+        char* Data() const { return m_data; }
+        size_t Size() const { return m_size; }
+
+    private:
+        MappedModelFile(const MappedModelFile&) = delete; MappedModelFile& operator=(const MappedModelFile&) = delete;
+
+        char* m_data;
+        size_t m_size;
+    };
+
     class Serializer
     {
         friend std::ostream& operator<<(std::ostream&, const Dictionary&);
@@ -141,6 +246,7 @@ namespace CNTK
 
         void CopyNDArrayViewDataToProtos();
         void WriteNDArrayViewData(io::CodedOutputStream& output);
+        void WritePadding(io::CodedOutputStream& output, size_t paddingSize);
 
         std::ostream& Write(std::ostream& stream);
         void Write(const std::wstring& filename);
@@ -155,8 +261,10 @@ namespace CNTK
 
         bool Read(std::wstring filename, const std::function<bool(io::ZeroCopyInputStream& input)>& callback);
         bool Read(std::istream& stream, const std::function<bool(io::ZeroCopyInputStream& input)>& callback);
+        bool Read(const std::shared_ptr<MappedModelFile>& file, const std::function<bool(io::ZeroCopyInputStream& input)>& callback);
 
         bool ReadNDArrayViewData(io::ZeroCopyInputStream& input);
+        NDArrayView* CreateFromMappedFile(DataType dataType, StorageFormat storageFormat, const NDShape& shape);
 
         size_t GetTotalByteSize()
         {
@@ -274,7 +382,8 @@ namespace CNTK
                 auto value = buffer[i];
                 if (tSize <= sizeof(uint32))
                 {
-                    output.WriteLittleEndian32(Encode<T, uint32>((float)value));
+                    // float16 values are written as floats, which is how ReadData() reads them back.
+                    output.WriteLittleEndian32(Encode<float, uint32>((float)value));
                 }
                 else
                 {
@@ -298,26 +407,25 @@ namespace CNTK
             return true;
         }
 
-        static bool ReadInt8Data(io::ZeroCopyInputStream& input, NDArrayView& dst)
+        static bool ReadInt8Data(RenewableCodedStream& input, NDArrayView& dst)
         {
-            const void* temp;
-            int readSize;
-            size_t totalSize = 0;
-            bool success;
-            do {
-                success = input.Next(&temp, &readSize);
-                totalSize += readSize;
-            } while (success && readSize == 0);
-
-            if (!success)
-                return false;
-            
             auto size = dst.Shape().TotalSize();
-            if (totalSize != size)
-                return false;
-
             int8_t* buffer = dst.WritableDataBuffer<int8_t>();
-            memcpy(buffer, temp, size);
+            return input.ReadRaw(buffer, size);
+        }
+
+        static bool ReadInt16Data(RenewableCodedStream& input, NDArrayView& dst)
+        {
+            // The values are written with WriteVarint32SignExtended().
+            auto size = dst.Shape().TotalSize();
+            int16_t* buffer = dst.WritableDataBuffer<int16_t>();
+            for (size_t i = 0; i < size; i++)
+            {
+                uint32 value;
+                if (!input.ReadVarint32(&value))
+                    return false;
+                buffer[i] = (int16_t)value;
+            }
             return true;
         }
 
@@ -349,6 +457,10 @@ namespace CNTK
         Message* m_proto;
         std::vector<std::pair<NDArrayView*, proto::NDArrayView*>> m_arrayViews;
         size_t m_byteSize {0};
+
+        // While reading from a memory-mapped file: the file, and the offset of the values of the next NDArrayView in it.
+        std::shared_ptr<MappedModelFile> m_mappedFile;
+        size_t m_payloadOffset {0};
     };
 
 
@@ -422,6 +534,17 @@ namespace CNTK
         }
     }
 
+    void Serializer::WritePadding(io::CodedOutputStream& output, size_t paddingSize)
+    {
+        if (paddingSize == 0)
+            return;
+
+        output.WriteTag(PADDING_FIELD_TAG);
+        output.WriteVarint32((uint32)(paddingSize - 2));
+        static const char zeros[PAYLOAD_ALIGNMENT] = {};
+        output.WriteRaw(zeros, (int)(paddingSize - 2));
+    }
+
     bool Serializer::ReadNDArrayViewData(io::ZeroCopyInputStream& input)
     {
         if (m_arrayViews.size() == 0)
@@ -448,13 +571,13 @@ namespace CNTK
             }
             else if (dst.GetDataType() == DataType::Int8)
             {
-                if (!ReadInt8Data(input, dst))
+                if (!ReadInt8Data(wrapper, dst))
                     return false;
             }
             else if (dst.GetDataType() == DataType::Int16)
             {
-                if (!ReadData<int16_t, int16_t>(wrapper, dst))
-                     return false;
+                if (!ReadInt16Data(wrapper, dst))
+                    return false;
             }
         }
         return true;
@@ -536,6 +659,9 @@ namespace CNTK
         std::unique_ptr<NDShape> shape(CreateFromProto(src.shape()));
         auto dataType = FromProtoType(src.data_type());
         auto storageFormat = FromProtoType(src.storage_format());
+        if (m_mappedFile && shape->TotalSize() > 0)
+            return CreateFromMappedFile(dataType, storageFormat, *shape);
+
         NDArrayView* dst = new NDArrayView(dataType, storageFormat, *shape, DeviceDescriptor::CPUDevice());
 
         if (dataType == DataType::Float)
@@ -576,6 +702,72 @@ namespace CNTK
         return dst;
     }
 
+    // Creates the NDArrayView whose values are at m_payloadOffset in the mapped file, and moves the offset past them.
+    // The values are stored as written by WriteNDArrayViewData(). Dense float, double and int8 values that are aligned
+    // in the file are used in place, all others are copied.
+    NDArrayView* Serializer::CreateFromMappedFile(DataType dataType, StorageFormat storageFormat, const NDShape& shape)
+    {
+        char* values = m_mappedFile->Data() + m_payloadOffset;
+        size_t bytesLeft = m_mappedFile->Size() - m_payloadOffset;
+        auto numElements = shape.TotalSize();
+
+        if (dataType == DataType::Int16)
+        {
+            // int16 values are varint-encoded.
+            io::CodedInputStream input(reinterpret_cast<const uint8*>(values), (int)std::min(bytesLeft, (size_t)INT_MAX));
+            std::unique_ptr<NDArrayView> dst(new NDArrayView(dataType, storageFormat, shape, DeviceDescriptor::CPUDevice()));
+            int16_t* buffer = dst->WritableDataBuffer<int16_t>();
+            for (size_t i = 0; i < numElements; i++)
+            {
+                uint32 value;
+                if (!input.ReadVarint32(&value))
+                    RuntimeError("The memory-mapped model file ends within the values of an NDArrayView.");
+                buffer[i] = (int16_t)value;
+            }
+            m_payloadOffset += input.CurrentPosition();
+            return dst.release();
+        }
+
+        // float16 values are written as 32-bit floats.
+        size_t elementSize = (dataType == DataType::Float16) ? sizeof(float) : DataTypeSize(dataType);
+        if (numElements > bytesLeft / elementSize)
+            RuntimeError("The memory-mapped model file ends within the values of an NDArrayView.");
+        size_t byteSize = numElements * elementSize;
+
+        NDArrayView* dst;
+        bool usableInPlace = (storageFormat == StorageFormat::Dense) &&
+                             (dataType == DataType::Float || dataType == DataType::Double || dataType == DataType::Int8) &&
+                             (m_payloadOffset % elementSize == 0);
+        if (usableInPlace)
+        {
+            dst = new NDArrayView(dataType, shape, values, byteSize, DeviceDescriptor::CPUDevice());
+            dst->m_externalStorage = m_mappedFile;
+        }
+        else
+        {
+            dst = new NDArrayView(dataType, storageFormat, shape, DeviceDescriptor::CPUDevice());
+            if (dataType == DataType::Float16)
+            {
+                float16* buffer = dst->WritableDataBuffer<float16>();
+                for (size_t i = 0; i < numElements; i++)
+                {
+                    uint32 value;
+                    io::CodedInputStream::ReadLittleEndian32FromArray(reinterpret_cast<const uint8*>(values) + i * sizeof(float), &value);
+                    buffer[i] = float16(Encode<uint32, float>(value));
+                }
+            }
+            else if (dataType == DataType::Float)
+                memcpy(dst->WritableDataBuffer<float>(), values, byteSize);
+            else if (dataType == DataType::Double)
+                memcpy(dst->WritableDataBuffer<double>(), values, byteSize);
+            else if (dataType == DataType::Int8)
+                memcpy(dst->WritableDataBuffer<int8_t>(), values, byteSize);
+        }
+
+        m_payloadOffset += byteSize;
+        return dst;
+    }
+
     proto::Vector* Serializer::CreateProto(const std::vector<DictionaryValue>& src, Arena* arena)
     {
         proto::Vector* dst = (arena != nullptr) ? 
@@ -740,7 +932,7 @@ namespace CNTK
 
         // Protobufs have a hard limit on the maximum message size(INT_MAX = 2GBs). 
         // Check if we fit into a single protobuf message.
-        if (FitsIntoProtobuf())
+        if (FitsIntoProtobuf() && !Internal::IsMappableModelSavingEnabled())
         {
             CopyNDArrayViewDataToProtos();
             m_proto->SerializeToCodedStream(&output);
@@ -750,9 +942,13 @@ namespace CNTK
             // If we don't, pull the metadata apart from the actual payload (NDArrayView content)
             // and store the payload separately, outside of the protobuf.
             // Prefix the metadata protobuf with a magic number and its bytes size.
+            // The padding that aligns the payload counts towards the size of the message.
+            auto messageSize = m_proto->ByteSizeLong();
+            auto paddingSize = PaddingSize(output.ByteCount() + 2 * sizeof(uint32) + messageSize);
             output.WriteLittleEndian32(MAGIC_NUMBER);
-            output.WriteLittleEndian32(m_proto->ByteSize());
+            output.WriteLittleEndian32((uint32)(messageSize + paddingSize));
             m_proto->SerializeToCodedStream(&output);
+            WritePadding(output, paddingSize);
             WriteNDArrayViewData(output);
         }
     }
@@ -808,8 +1004,10 @@ namespace CNTK
         else 
             input.BackUp(size);
 
+        // The message ends at the limit, and the payload that follows it is left in the input.
         io::CodedInputStream codedInput(&input);
-        codedInput.SetTotalBytesLimit(limit, limit);
+        codedInput.SetTotalBytesLimit(INT_MAX, INT_MAX);
+        codedInput.PushLimit((int)limit);
         return msg.ParseFromCodedStream(&codedInput) && codedInput.ConsumedEntireMessage();
     }
 
@@ -851,6 +1049,17 @@ namespace CNTK
 
     bool Serializer::Read(std::wstring filename, const std::function<bool(io::ZeroCopyInputStream& input)>& callback)
     {
+        if (Internal::IsMemoryMappedModelLoadingEnabled())
+        {
+            // Only files whose payload follows the message can be used in place, the others are read as usual.
+            auto file = std::make_shared<MappedModelFile>(filename);
+            uint32 prefix = 0;
+            if (file->Size() >= 2 * sizeof(uint32))
+                io::CodedInputStream::ReadLittleEndian32FromArray(reinterpret_cast<const uint8*>(file->Data()), &prefix);
+            if (prefix == MAGIC_NUMBER)
+                return Read(file, callback);
+        }
+
         bool result;
         auto fd = GetFileDescriptor(filename, true);
         {
@@ -866,6 +1075,24 @@ namespace CNTK
         return result;
     }
 
+    bool Serializer::Read(const std::shared_ptr<MappedModelFile>& file, const std::function<bool(io::ZeroCopyInputStream& input)>& callback)
+    {
+        uint32 messageSize;
+        io::CodedInputStream::ReadLittleEndian32FromArray(reinterpret_cast<const uint8*>(file->Data()) + sizeof(uint32), &messageSize);
+        size_t messageEnd = 2 * sizeof(uint32) + messageSize;
+        if (messageEnd > file->Size() || messageEnd > (size_t)INT_MAX)
+            return false;
+
+        // The NDArrayViews are created over the mapped payload while the message is copied (see CreateFromProto()),
+        // which leaves nothing for ReadNDArrayViewData() to read.
+        io::ArrayInputStream input(file->Data(), (int)messageEnd);
+        m_mappedFile = file;
+        m_payloadOffset = messageEnd;
+        bool result = ParseMessage(input, *m_proto) && callback(input);
+        m_mappedFile.reset();
+        return result;
+    }
+
     bool Serializer::Read(std::istream& stream, const std::function<bool(io::ZeroCopyInputStream& input)>& callback)
     {
         io::IstreamInputStream input(&stream, BLOCK_SIZE);
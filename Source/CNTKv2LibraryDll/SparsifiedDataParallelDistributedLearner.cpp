@@ -0,0 +1,247 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "SparsifiedDataParallelDistributedLearner.h"
+#include "DistributedCommunicator.h"
+#include "Learner.h"
+#include "PerformanceProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace CNTK
+{
+    // Indices are sent as elements of the gradient type; float represents all integers up to 2^24 exactly.
+    static const size_t MaxSparsifiedBucketSize = 1 << 24;
+
+    DistributedLearnerPtr CreateSparsifiedDataParallelDistributedLearner(
+        DistributedCommunicatorPtr communicator,
+        LearnerPtr learner,
+        size_t distributeAfterSamples,
+        double density,
+        size_t bucketSize,
+        double threshold,
+        bool useAsyncBufferedParameterUpdate)
+    {
+        return MakeSharedObject<SparsifiedDataParallelDistributedLearner>(communicator, learner, distributeAfterSamples, density, bucketSize, threshold, useAsyncBufferedParameterUpdate);
+    }
+
+    SparsifiedDataParallelDistributedLearner::SparsifiedDataParallelDistributedLearner(DistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, double density, size_t bucketSize, double threshold, bool useAsyncBufferedParameterUpdate)
+        : DistributedLearnerBase(communicator, learner, distributeAfterSamples),
+          m_density(density),
+          m_bucketSize(bucketSize),
+          m_threshold(threshold)
+    {
+        if (useAsyncBufferedParameterUpdate)
+            LogicError("Asynchronous parameter update is not yet supported for the SparsifiedDataParallelDistributedLearner.");
+
+        if (!(density > 0 && density <= 1))
+            InvalidArgument("SparsifiedDataParallelDistributedLearner: density (%g) must be in (0, 1].", density);
+
+        if (bucketSize == 0 || bucketSize > MaxSparsifiedBucketSize)
+            InvalidArgument("SparsifiedDataParallelDistributedLearner: bucket size (%zu) must be between 1 and %zu.", bucketSize, MaxSparsifiedBucketSize);
+
+        if (threshold < 0)
+            InvalidArgument("SparsifiedDataParallelDistributedLearner: threshold (%g) must not be negative.", threshold);
+    }
+
+    size_t SparsifiedDataParallelDistributedLearner::SelectedPerBucket(size_t bucketLength) const
+    {
+        auto k = static_cast<size_t>(std::ceil(m_density * bucketLength));
+        return std::min(std::max<size_t>(k, 1), bucketLength);
+    }
+
+    bool SparsifiedDataParallelDistributedLearner::Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, MinibatchInfo& info)
+    {
+        // sparse gradients are converted to dense for aggregation
+        std::unordered_map<Parameter, NDArrayViewPtr> convertedGradientValues = gradientValues;
+
+        if (m_sampleCount >= m_distributeAfterSamples && m_communicator->Workers().size() > 1)
+        {
+#ifndef  CNTK_UWP
+            auto profGradientAgg = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainGradient);
+#endif
+
+            if (info.IsEmpty())
+                PrepaireZeroGradients(gradientValues);
+
+            ConvertToOrdered(gradientValues, m_gradientBuffer, &convertedGradientValues);
+
+            std::vector<NDArrayViewPtr> headerToAggregate;
+            headerToAggregate.push_back(info.evalCriterionValue);
+            headerToAggregate.push_back(info.trainingLossValue);
+
+            auto value = MakeSharedObject<NDArrayView>(static_cast<double>(info.numberOfSamples), NDShape{}, DeviceDescriptor::CPUDevice());
+            headerToAggregate.push_back(value);
+
+            m_communicator->AggregateInPlace(headerToAggregate, m_communicator->Workers());
+            info.numberOfSamples = static_cast<size_t>(*headerToAggregate.back()->DataBuffer<double>());
+
+            // Selection and error feedback run on the CPU; gradients on other devices are copied over and back.
+            m_residuals.resize(m_gradientBuffer.size());
+            m_cpuGradients.resize(m_gradientBuffer.size());
+
+            std::vector<NDArrayViewPtr> floatGradients, floatResiduals;
+            std::vector<NDArrayViewPtr> doubleGradients, doubleResiduals;
+            for (size_t i = 0; i < m_gradientBuffer.size(); ++i)
+            {
+                auto gradient = m_gradientBuffer[i].second;
+                auto dataType = gradient->GetDataType();
+                if (dataType != DataType::Float && dataType != DataType::Double)
+                    LogicError("SparsifiedDataParallelDistributedLearner: gradient DataType is not supported.");
+
+                if (!m_residuals[i] || m_residuals[i]->Shape() != gradient->Shape() || m_residuals[i]->GetDataType() != dataType)
+                    m_residuals[i] = MakeSharedObject<NDArrayView>(0, dataType, gradient->Shape(), DeviceDescriptor::CPUDevice());
+
+                if (gradient->Device() != DeviceDescriptor::CPUDevice())
+                {
+                    if (!m_cpuGradients[i] || m_cpuGradients[i]->Shape() != gradient->Shape() || m_cpuGradients[i]->GetDataType() != dataType)
+                        m_cpuGradients[i] = MakeSharedObject<NDArrayView>(dataType, gradient->Shape(), DeviceDescriptor::CPUDevice());
+                    m_cpuGradients[i]->CopyFrom(*gradient);
+                    gradient = m_cpuGradients[i];
+                }
+
+                if (dataType == DataType::Float)
+                {
+                    floatGradients.push_back(gradient);
+                    floatResiduals.push_back(m_residuals[i]);
+                }
+                else
+                {
+                    doubleGradients.push_back(gradient);
+                    doubleResiduals.push_back(m_residuals[i]);
+                }
+            }
+
+            AggregateSparsified<float>(floatGradients, floatResiduals, m_packedFloat, m_gatheredFloat);
+            AggregateSparsified<double>(doubleGradients, doubleResiduals, m_packedDouble, m_gatheredDouble);
+
+            for (size_t i = 0; i < m_gradientBuffer.size(); ++i)
+            {
+                if (m_gradientBuffer[i].second->Device() != DeviceDescriptor::CPUDevice())
+                    m_gradientBuffer[i].second->CopyFrom(*m_cpuGradients[i]);
+            }
+        }
+
+#ifndef  CNTK_UWP
+        auto profWeights = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainWeights);
+#endif
+
+        m_sampleCount += info.numberOfSamples;
+        m_gradientBuffer.clear();
+
+        if (info.IsEmpty())
+            return false;
+
+        return m_learner->Update(convertedGradientValues, info.numberOfSamples, info.atEndOfSweep);
+    }
+
+    // Adds the gradients to their residuals, sends the largest entries of every bucket to all workers as
+    // (index, value) pairs and replaces the gradients with the sum of the entries sent by all workers.
+    // Every worker sends the same number of pairs, so that they can be exchanged with one all-gather;
+    // slots of entries dropped by the threshold are sent with index -1.
+    template <typename ElementType>
+    void SparsifiedDataParallelDistributedLearner::AggregateSparsified(const std::vector<NDArrayViewPtr>& gradients, const std::vector<NDArrayViewPtr>& residuals, NDArrayViewPtr& packed, NDArrayViewPtr& gathered)
+    {
+        if (gradients.empty())
+            return;
+
+        size_t numPacked = 0;
+        for (const auto& gradient : gradients)
+        {
+            auto size = gradient->Shape().TotalSize();
+            for (size_t begin = 0; begin < size; begin += m_bucketSize)
+                numPacked += 2 * SelectedPerBucket(std::min(m_bucketSize, size - begin));
+        }
+
+        if (!packed || packed->Shape().TotalSize() != numPacked)
+            packed = MakeSharedObject<NDArrayView>(AsDataType<ElementType>(), NDShape{ numPacked }, DeviceDescriptor::CPUDevice());
+
+        // Select the entries to send.
+        ElementType* out = packed->WritableDataBuffer<ElementType>();
+        std::vector<size_t> order;
+        for (size_t i = 0; i < gradients.size(); ++i)
+        {
+            ElementType* gradient = gradients[i]->WritableDataBuffer<ElementType>();
+            ElementType* residual = residuals[i]->WritableDataBuffer<ElementType>();
+            auto size = gradients[i]->Shape().TotalSize();
+            for (size_t begin = 0; begin < size; begin += m_bucketSize)
+            {
+                auto length = std::min(m_bucketSize, size - begin);
+                auto k = SelectedPerBucket(length);
+                ElementType* accumulated = residual + begin;
+                for (size_t j = 0; j < length; ++j)
+                    accumulated[j] += gradient[begin + j];
+
+                order.resize(length);
+                std::iota(order.begin(), order.end(), 0);
+                if (k < length)
+                    std::nth_element(order.begin(), order.begin() + k, order.end(),
+                        [accumulated](size_t a, size_t b) { return std::abs(accumulated[a]) > std::abs(accumulated[b]); });
+
+                for (size_t j = 0; j < k; ++j)
+                {
+                    auto index = order[j];
+                    auto v = accumulated[index];
+                    if (v == 0 || std::abs(v) < m_threshold)
+                    {
+                        out[0] = -1;
+                        out[1] = 0;
+                    }
+                    else
+                    {
+                        out[0] = static_cast<ElementType>(index);
+                        out[1] = v;
+                        accumulated[index] = 0;
+                    }
+                    out += 2;
+                }
+            }
+            std::fill(gradient, gradient + size, (ElementType)0);
+        }
+
+        std::vector<NDArrayViewPtr> output{ gathered };
+        m_communicator->Concatenate(std::vector<NDArrayViewPtr>{ packed }, output, m_communicator->Workers());
+        gathered = output[0];
+
+        // Sum the entries of all workers; their pairs follow the same bucket layout.
+        const ElementType* in = gathered->DataBuffer<ElementType>();
+        auto numWorkers = gathered->Shape().TotalSize() / numPacked;
+        for (size_t worker = 0; worker < numWorkers; ++worker)
+        {
+            for (const auto& g : gradients)
+            {
+                ElementType* gradient = g->WritableDataBuffer<ElementType>();
+                auto size = g->Shape().TotalSize();
+                for (size_t begin = 0; begin < size; begin += m_bucketSize)
+                {
+                    auto k = SelectedPerBucket(std::min(m_bucketSize, size - begin));
+                    for (size_t j = 0; j < k; ++j, in += 2)
+                    {
+                        if (in[0] >= 0)
+                            gradient[begin + static_cast<size_t>(in[0])] += in[1];
+                    }
+                }
+            }
+        }
+    }
+
+    Dictionary SparsifiedDataParallelDistributedLearner::CreateCheckpoint()
+    {
+        // Resetting the residuals, since they are not checkpointed; this keeps the in-memory state consistent with the checkpoint.
+        for (auto& residual : m_residuals)
+        {
+            if (!residual)
+                continue;
+            if (residual->GetDataType() == DataType::Double)
+                residual->SetValue(0.0);
+            else
+                residual->SetValue(0.0f);
+        }
+
+        return DistributedLearnerBase::CreateCheckpoint();
+    }
+}
@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma  once
+
+#include <vector>
+#include "CNTKLibrary.h"
+#include "DistributedLearnerBase.h"
+
+namespace CNTK
+{
+    ///
+    /// Data parallel distributed learner that exchanges only the largest gradient entries.
+    /// The gradients are cut into buckets of bucketSize elements; from each bucket a worker sends the
+    /// ceil(density * bucketSize) entries of largest magnitude as (index, value) pairs, optionally dropping
+    /// those below threshold. The entries that are not sent are kept in a residual that is added to the next
+    /// gradient (error feedback), as with 1-bit SGD, so no part of the gradient is lost, only delayed.
+    ///
+    class SparsifiedDataParallelDistributedLearner : public DistributedLearnerBase
+    {
+    public:
+        SparsifiedDataParallelDistributedLearner(DistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, double density, size_t bucketSize, double threshold, bool useAsyncBufferedParameterUpdate);
+
+        // Optional override that gets called per minibatch after finishing gradient computation but before updating model parameters
+        bool Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, MinibatchInfo& info) override;
+
+        // Optionally overridable method to get checkpoint state associated with this Distributed train method
+        Dictionary CreateCheckpoint() override;
+
+    private:
+        template <typename ElementType>
+        void AggregateSparsified(const std::vector<NDArrayViewPtr>& gradients, const std::vector<NDArrayViewPtr>& residuals, NDArrayViewPtr& packed, NDArrayViewPtr& gathered);
+
+        // Number of entries sent per bucket of the given length.
+        size_t SelectedPerBucket(size_t bucketLength) const;
+
+        const double m_density;
+        const size_t m_bucketSize;
+        const double m_threshold;
+
+        // Residuals of the gradients (on the CPU), in the order of m_gradientBuffer.
+        std::vector<NDArrayViewPtr> m_residuals;
+
+        // Dense CPU copies of the gradients that are not on the CPU.
+        std::vector<NDArrayViewPtr> m_cpuGradients;
+
+        // (index, value) pairs sent by this worker and gathered from all workers, per element type.
+        NDArrayViewPtr m_packedFloat, m_gatheredFloat;
+        NDArrayViewPtr m_packedDouble, m_gatheredDouble;
+    };
+}
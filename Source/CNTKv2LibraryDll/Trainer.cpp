@@ -348,6 +348,14 @@ namespace CNTK
         }
     }
 
+    void Trainer::PrintNodeCostReport(const std::wstring& filePath, double peakGFlops, double peakGBps)
+    {
+        if (m_combinedTrainingFunction)
+        {
+            m_combinedTrainingFunction->PrintNodeCostReport(filePath, peakGFlops, peakGBps);
+        }
+    }
+
 
     void Trainer::ExecuteForwardBackward(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, const DeviceDescriptor& computeDevice, std::unordered_map<Variable, ValuePtr>& parameterGradients)
     {
@@ -407,53 +415,44 @@ namespace CNTK
 
     void Trainer::SaveCheckpoint(const std::wstring& modelFilePath, Dictionary externalState)
     {
-        auto learnersState = m_parameterLearners->CreateCheckpoint();
-
-        if (!m_distributed)
-            return Save(modelFilePath, learnersState, externalState);
-
-        auto compositeFunction = dynamic_cast<CompositeFunction*>(m_combinedTrainingFunction.get());
-
-        Dictionary state;
-        state[internalWorkerStateKey] = compositeFunction->GetInternalState(); // this is the local worker's state.
-        state[externalWorkerStateKey] = externalState;
-
-        // Collect distributed external state.
-        DistributedCommunicatorPtr communicator = MPICommunicator();
-        communicator->Barrier();
-
-        std::vector<DictionaryPtr> remoteState;
-        communicator->Gather(state, remoteState, communicator->Workers());
-
-        Dictionary aggregatedState;
-        for (const auto& w : communicator->Workers())
-        {
-            aggregatedState[std::to_wstring(w.m_globalRank)] = *remoteState[w.m_globalRank];
-        }
-
-        if (communicator->CurrentWorker().IsMain())
-            Save(modelFilePath, learnersState, externalState, aggregatedState);
+        auto writeCheckpoint = SnapshotCheckpoint(modelFilePath, externalState, /*syncToDisk=*/false);
+        if (writeCheckpoint)
+            writeCheckpoint();
 
         // all workers need to sync up after saving model to avoid read-after-write hazard
         // i.e. one worker is in the middle of write while another tries to read
-        communicator->Barrier();
+        if (m_distributed)
+            MPICommunicator()->Barrier();
+    }
+
+    // Flushes the file from the OS caches to the disk.
+    static void SyncFileToDisk(const std::wstring& filePath)
+    {
+        FILE* f = fopenOrDie(filePath, L"r+b");
+        fsyncOrDie(f);
+        fcloseOrDie(f);
     }
 
-    void Trainer::Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState, const Dictionary& externalState, const Dictionary& distributedState)
+    static void WriteCheckpoint(const std::wstring& modelFilePath, const Dictionary& model, Dictionary& state, bool syncToDisk)
     {
         std::wstring tempModelFile = modelFilePath + L".tmp";
-        Dictionary state;
-        state[versionPropertyName] = trainerCheckpointVersion;
-        state[learnersPropertyName] = learnerState;
-        state[externalStatePropertyName] = externalState;
-        state[distributedStatePropertyName] = distributedState;
+        {
+            auto stream = GetFstream(tempModelFile, false);
+            *stream << model;
+            stream->flush();
+        }
 
-        m_combinedTrainingFunction->Save(tempModelFile);
         std::wstring trainerStateCheckpointFilePath = GetTrainerStateCheckpointFilePath(modelFilePath);
         std::wstring tempCheckpointFile = trainerStateCheckpointFilePath + L".tmp";
 
         state.Save(tempCheckpointFile);
 
+        if (syncToDisk)
+        {
+            SyncFileToDisk(tempModelFile);
+            SyncFileToDisk(tempCheckpointFile);
+        }
+
         // The return value is ignored here.
         _wunlink(modelFilePath.c_str());
         _wunlink(trainerStateCheckpointFilePath.c_str());
@@ -462,6 +461,51 @@ namespace CNTK
         renameOrDie(tempCheckpointFile, trainerStateCheckpointFilePath);
     }
 
+    std::function<void()> Trainer::SnapshotCheckpoint(const std::wstring& modelFilePath, const Dictionary& externalState, bool syncToDisk)
+    {
+        auto learnersState = m_parameterLearners->CreateCheckpoint();
+
+        Dictionary distributedState;
+        if (m_distributed)
+        {
+            auto compositeFunction = dynamic_cast<CompositeFunction*>(m_combinedTrainingFunction.get());
+
+            Dictionary state;
+            state[internalWorkerStateKey] = compositeFunction->GetInternalState(); // this is the local worker's state.
+            state[externalWorkerStateKey] = externalState;
+
+            // Collect distributed external state.
+            DistributedCommunicatorPtr communicator = MPICommunicator();
+            communicator->Barrier();
+
+            std::vector<DictionaryPtr> remoteState;
+            communicator->Gather(state, remoteState, communicator->Workers());
+
+            for (const auto& w : communicator->Workers())
+            {
+                distributedState[std::to_wstring(w.m_globalRank)] = *remoteState[w.m_globalRank];
+            }
+
+            if (!communicator->CurrentWorker().IsMain())
+                return nullptr;
+        }
+
+        auto state = std::make_shared<Dictionary>();
+        (*state)[versionPropertyName] = trainerCheckpointVersion;
+        (*state)[learnersPropertyName] = learnersState;
+        (*state)[externalStatePropertyName] = externalState;
+        (*state)[distributedStatePropertyName] = distributedState;
+
+        // Serializing copies the parameter values to the CPU (as creating the learner checkpoint does for the
+        // smoothed gradients), so the snapshot is not affected by the training that continues while it is written.
+        auto model = std::make_shared<Dictionary>(m_combinedTrainingFunction->Serialize());
+
+        return [modelFilePath, model, state, syncToDisk]()
+        {
+            WriteCheckpoint(modelFilePath, *model, *state, syncToDisk);
+        };
+    }
+
     Dictionary Trainer::RestoreFromCheckpoint(const std::wstring& modelFilePath)
     {
         // Restore the model's parameters
@@ -35,9 +35,11 @@ namespace CNTK
         size_t checkpointFrequency,
         DataUnit checkpointFrequencyUnit,
         bool restoreFromCheckpointIfExists,
-        bool preserveAllCheckpoints) :
+        bool preserveAllCheckpoints,
+        bool asyncCheckpointing) :
         m_preserveAll(preserveAllCheckpoints),
         m_restore(restoreFromCheckpointIfExists),
+        m_async(asyncCheckpointing),
         m_fileName(checkPointFileName),
         m_frequency(checkpointFrequency),
         m_frequencyUnit(checkpointFrequencyUnit)
@@ -126,7 +128,8 @@ namespace CNTK
         m_workerRank(0),
         m_numberOfWorkers(1),
         m_test(test),
-        m_mbSizeScaleFactor(1)
+        m_mbSizeScaleFactor(1),
+        m_pendingCheckpointIndex(0)
     {
         if (!m_trainer)
             InvalidArgument("Trainer must not be null.");
@@ -238,6 +241,8 @@ namespace CNTK
                     action.unitCountWhenLastCalled = totalNumberOfUnitCounts;
                 }
             }
+
+            CompletePendingCheckpoint(/*wait=*/false);
         }
 
         if (restoredNumberOfSamples != Trainer()->TotalNumberOfSamplesSeen())
@@ -252,6 +257,8 @@ namespace CNTK
             }
         }
 
+        CompletePendingCheckpoint(/*wait=*/true);
+
         // In case of incremental - save final checkpoint.
         // This is required only when we keep all existing checkpoints, otherwise 
         // The checkpoint was already saved with the proper name.
@@ -402,6 +409,8 @@ namespace CNTK
 
     void TrainingSession::RestoreFromCheckpoint(const std::wstring& checkpointFileName)
     {
+        CompletePendingCheckpoint(/*wait=*/true);
+
         Dictionary externalState = Trainer()->RestoreFromCheckpoint(checkpointFileName);
         m_source->RestoreFromCheckpoint(externalState[s_trainingMinibatchSource].Value<Dictionary>());
     }
@@ -415,8 +424,41 @@ namespace CNTK
         wstring checkpointFile = m_checkpoint.m_fileName;
         if (m_checkpoint.m_preserveAll)
             checkpointFile += std::to_wstring(currentIndex);
-        Trainer()->SaveCheckpoint(checkpointFile, externalState);
-        OnCheckpointEnd(currentIndex);
+
+        if (!m_checkpoint.m_async)
+        {
+            Trainer()->SaveCheckpoint(checkpointFile, externalState);
+            OnCheckpointEnd(currentIndex);
+            return;
+        }
+
+        // Only one checkpoint is written at a time.
+        CompletePendingCheckpoint(/*wait=*/true);
+
+        // The snapshot is taken here; writing it to disk overlaps with the following minibatches.
+        auto writeCheckpoint = Trainer()->SnapshotCheckpoint(checkpointFile, externalState, /*syncToDisk=*/true);
+        if (!writeCheckpoint) // Not the main worker, nothing to write.
+        {
+            OnCheckpointEnd(currentIndex);
+            return;
+        }
+
+        m_pendingCheckpointIndex = currentIndex;
+        m_pendingCheckpoint = std::async(std::launch::async, writeCheckpoint);
+    }
+
+    // Reports the end of the checkpoint written in the background, if any, rethrowing the error of the writer.
+    // Returns immediately if the checkpoint is still being written, unless 'wait' is set.
+    void TrainingSession::CompletePendingCheckpoint(bool wait)
+    {
+        if (!m_pendingCheckpoint.valid())
+            return;
+
+        if (!wait && m_pendingCheckpoint.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+
+        m_pendingCheckpoint.get();
+        OnCheckpointEnd(m_pendingCheckpointIndex);
     }
 
     void TrainingSession::SaveFinalCheckpoint()
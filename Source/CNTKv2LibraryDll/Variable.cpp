@@ -548,7 +548,10 @@ namespace CNTK
 
             // TODO: this copying here is redundant, value should be moved from the dictionary to the variable.
             // Also, the correct device should be used upfront when deserializing NDArrayView.
-            Variable var(shape, kind, dataType, value.DeepClone(device, value.IsReadOnly()), needsGradient, dynamicAxis, isSparse, name, uid);
+            // Constants that are stored in a memory-mapped model file (see Internal::EnableMemoryMappedModelLoading) keep using it on the CPU.
+            bool useMappedValue = (kind == VariableKind::Constant) && (value.m_externalStorage != nullptr) && (device.Type() == DeviceKind::CPU);
+            auto varValue = useMappedValue ? value.Alias(value.IsReadOnly()) : value.DeepClone(device, value.IsReadOnly());
+            Variable var(shape, kind, dataType, varValue, needsGradient, dynamicAxis, isSparse, name, uid);
             if (var.IsParameter())
                 return Parameter(var);
             else
@@ -16,6 +16,12 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     std::atomic<bool> Globals::m_enableShareNodeValueMatrices(true);
     std::atomic<bool> Globals::m_optimizeGradientAccumulation(true);
+    std::atomic<bool> Globals::m_enableMinibatchSizeAwareMemorySharing(true);
     std::atomic<bool> Globals::m_enableNodeTiming(false);
+    std::atomic<bool> Globals::m_enableNodeCostProfiling(false);
     std::atomic<std::size_t> Globals::m_mpiPackThresholdInBytes(DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES);
+    std::atomic<bool> Globals::m_enableContiguousParameterGradients(false);
+    std::atomic<std::size_t> Globals::m_mpiGradientBucketSizeInBytes(DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES);
+    std::atomic<bool> Globals::m_enableElementwiseNodeFusion(false);
+    std::atomic<bool> Globals::m_enableConvolutionAutotuning(false);
 }}}
@@ -10,5 +10,8 @@
 // The default threshold size to pack a gradient into a continuous buffer during aggregation for less MPI ops.
 const std::size_t DEFAULT_PACK_THRESHOLD_SIZE_IN_KB = 32 * 1024;
 const std::size_t DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES = DEFAULT_PACK_THRESHOLD_SIZE_IN_KB * 1024;
+// The default maximum size of a run of gradients that are adjacent in memory and reduced with a single MPI op.
+const std::size_t DEFAULT_GRADIENT_BUCKET_SIZE_IN_KB = 32 * 1024;
+const std::size_t DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES = DEFAULT_GRADIENT_BUCKET_SIZE_IN_KB * 1024;
 
 #endif
@@ -42,6 +42,8 @@ public:
 
     //
     // Create a network based on an (NDL) network description.
+    // quantizedTimes=int8 or quantizedTimes=int16 evaluates the products with weight matrices in integer arithmetic
+    // on the CPU (see ComputationNetwork::EnableQuantizedTimesInference()).
     //
     virtual void CreateNetwork(const std::string& networkDescription) = 0;
 
@@ -28,18 +28,47 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void SetShareNodeValueMatrices(bool enable) { m_enableShareNodeValueMatrices = enable; }
         static bool ShouldEnableShareNodeValueMatrices() { return m_enableShareNodeValueMatrices; }
 
+        static void SetMinibatchSizeAwareMemorySharing(bool enable) { m_enableMinibatchSizeAwareMemorySharing = enable; }
+        static bool ShouldEnableMinibatchSizeAwareMemorySharing() { return m_enableMinibatchSizeAwareMemorySharing; }
+
         static void SetNodeTiming(bool enable) { m_enableNodeTiming = enable; }
         static bool ShouldEnableNodeTiming() { return m_enableNodeTiming; }
 
+        static void SetNodeCostProfiling(bool enable) { m_enableNodeCostProfiling = enable; }
+        static bool ShouldProfileNodeCost() { return m_enableNodeCostProfiling; }
+
         static void SetMPIPackThreshold(std::size_t packThreholdInBytes) { m_mpiPackThresholdInBytes = packThreholdInBytes; }
         static std::size_t GetMPIPackThreshold() { return m_mpiPackThresholdInBytes; }
+
+        static void SetContiguousParameterGradients(bool enable) { m_enableContiguousParameterGradients = enable; }
+        static bool ShouldUseContiguousParameterGradients() { return m_enableContiguousParameterGradients; }
+
+        static void SetElementwiseNodeFusion(bool enable) { m_enableElementwiseNodeFusion = enable; }
+        static bool ShouldFuseElementwiseNodes() { return m_enableElementwiseNodeFusion; }
+
+        static void SetMPIGradientBucketSize(std::size_t bucketSizeInBytes) { m_mpiGradientBucketSizeInBytes = bucketSizeInBytes; }
+        static std::size_t GetMPIGradientBucketSize() { return m_mpiGradientBucketSizeInBytes; }
+
+        static void SetConvolutionAutotuning(bool enable) { m_enableConvolutionAutotuning = enable; }
+        static bool ShouldAutotuneConvolutions() { return m_enableConvolutionAutotuning; }
     private:
         static std::atomic<bool> m_forceDeterministicAlgorithms;
         // The global flag to enable matrices values in forward and backward prop
         static std::atomic<bool> m_enableShareNodeValueMatrices;
         static std::atomic<bool> m_forceConstantRandomSeed;
         static std::atomic<bool> m_optimizeGradientAccumulation;
+        // The global flag to re-plan memory sharing once the actual minibatch size is known
+        static std::atomic<bool> m_enableMinibatchSizeAwareMemorySharing;
         static std::atomic<bool> m_enableNodeTiming;
+        // The global flag to accumulate per-node cost statistics (see NodeCostReport.h)
+        static std::atomic<bool> m_enableNodeCostProfiling;
         static std::atomic<std::size_t> m_mpiPackThresholdInBytes;
+        // The global flag to allocate the gradients of all learnable parameters in one buffer (see MatrixPool::RequestContiguousAllocate())
+        static std::atomic<bool> m_enableContiguousParameterGradients;
+        static std::atomic<std::size_t> m_mpiGradientBucketSizeInBytes;
+        // The global flag to replace groups of elementwise nodes by FusedElementwiseNodes when compiling a network on the CPU
+        static std::atomic<bool> m_enableElementwiseNodeFusion;
+        // The global flag to let CPU convolutions pick the fastest of the GEMM, Winograd and direct engines, which round differently
+        static std::atomic<bool> m_enableConvolutionAutotuning;
     };
 }}}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GradientBuckets.h -- grouping of gradient buffers that are adjacent in memory, so that they can be
+// aggregated with a single MPI call and without copying them into a packing buffer first. Gradients are
+// adjacent if the network allocated them in one contiguous buffer (see Globals::SetContiguousParameterGradients()).
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// A run of gradients that directly follow each other in memory.
+struct GradientBucket
+{
+    const char* m_data;          // start of the first gradient
+    size_t m_sizeInBytes;        // total size of all gradients of the bucket
+    std::vector<size_t> m_items; // the gradients, as positions in the list passed to FormGradientBuckets(), in memory order
+};
+
+// Groups buffers (start address and size in bytes) into buckets of adjacent buffers of at most maxBucketSizeInBytes.
+// A buffer that is larger than the limit forms a bucket of its own. Only buckets with at least two buffers are returned;
+// the other buffers are not adjacent to any other and are aggregated as before.
+// The buckets are ordered by address, which is the same on all workers, so they can be reduced in this order.
+// All buffers must be in the same address space, i.e. on the same device.
+inline std::vector<GradientBucket> FormGradientBuckets(const std::vector<std::pair<const void*, size_t>>& buffers, size_t maxBucketSizeInBytes)
+{
+    std::vector<size_t> order;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        if (buffers[i].first != nullptr && buffers[i].second > 0)
+            order.push_back(i);
+    }
+
+    std::sort(order.begin(), order.end(), [&buffers](size_t a, size_t b) { return buffers[a].first < buffers[b].first; });
+
+    std::vector<GradientBucket> buckets;
+    GradientBucket current = { nullptr, 0, {} };
+    auto flush = [&buckets, &current]()
+    {
+        if (current.m_items.size() > 1)
+            buckets.push_back(current);
+        current = { nullptr, 0, {} };
+    };
+
+    for (size_t i : order)
+    {
+        auto data = static_cast<const char*>(buffers[i].first);
+        auto size = buffers[i].second;
+        bool adjacent = !current.m_items.empty() && (current.m_data + current.m_sizeInBytes == data);
+        if (!adjacent || current.m_sizeInBytes + size > maxBucketSizeInBytes)
+            flush();
+
+        if (current.m_items.empty())
+            current.m_data = data;
+        current.m_sizeInBytes += size;
+        current.m_items.push_back(i);
+    }
+    flush();
+
+    return buckets;
+}
+
+}}}
@@ -32,6 +32,7 @@ typedef enum _MPI_Datatype { MPI_CHAR, MPI_INT, MPI_FLOAT, MPI_DOUBLE, MPI_UNSIG
 #define MPI_STATUSES_IGNORE  (MPI_Status*)1
 #define MPI_STATUS_IGNORE    (MPI_Status*)1
 #define MPI_UNDEFINED        (-32766)
+#define MPI_REQUEST_NULL     ((MPI_Request)0)
 
 typedef int MPI_Op;
 typedef int MPI_Request;
@@ -61,6 +62,18 @@ extern int operator||(int rc, const MpiFail &what);
 class MPIWrapper;
 typedef std::shared_ptr<MPIWrapper> MPIWrapperPtr;
 
+// Algorithm of an all-reduce, selected by the caller of MPIWrapper::AllReduce().
+enum class MPIAllReduceAlgorithm
+{
+    Default,      // MPI_Allreduce of the MPI library
+    Ring,         // chunked, pipelined ring: reduce-scatter followed by all-gather, each rank sends 2(N-1)/N of the data
+    Hierarchical, // reduce within each host, ring across the hosts, broadcast within each host
+};
+
+// "mpi" (or "default"), "ring" or "hierarchical"
+MPIAllReduceAlgorithm ParseMPIAllReduceAlgorithm(const std::wstring& name);
+const wchar_t* MPIAllReduceAlgorithmName(MPIAllReduceAlgorithm algorithm);
+
 extern "C" void GetMpiWrapper(MPIWrapper **mpi);
 
 // Note: This is now a pure interface, so please don't add
@@ -132,6 +145,10 @@ public:
     virtual void AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op = MPI_SUM) const = 0;
     virtual void AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op = MPI_SUM) const = 0;
 
+    // all-reduce with the given algorithm; sendData may be MPI_IN_PLACE. The algorithm must be the same on all ranks.
+    virtual void AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const = 0;
+    virtual void AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const = 0;
+
     virtual void AllReduceAsync(size_t* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const = 0;
     virtual void AllReduceAsync(int* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const = 0;
     virtual void AllReduceAsync(double* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const = 0;
@@ -61,6 +61,22 @@ private:
 
     void RequestNodes(const char *msg, size_t requestednodes = SIZE_MAX /*default: all*/);
 
+    // all-reduce algorithms built from point-to-point messages, see MPIAllReduceAlgorithm
+    template <class ElemType>
+    void AllReduceWithAlgorithm(ElemType* sendData, ElemType* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const;
+    template <class ElemType>
+    void RingAllReduce(ElemType* data, size_t numElements, MPI_Op op, MPI_Comm comm) const;
+    void CreateAllReduceCommunicators() const;
+    void FreeAllReduceCommunicators();
+
+    // communicators of the all-reduce algorithms, created collectively from the current communicator on first use,
+    // and freed by RequestNodes() when the current communicator changes
+    mutable bool m_allReduceCommsCreated;
+    mutable MPI_Comm m_ringComm;        // duplicate of the current communicator, so ring messages never match other messages
+    mutable MPI_Comm m_hostComm;        // the ranks on this host
+    mutable MPI_Comm m_hostLeadersComm; // the first rank of each host (MPI_COMM_NULL on all other ranks)
+    mutable std::vector<char> m_ringReceiveBuffer;
+
 public:
 
     size_t NumNodesInUse() const;
@@ -107,6 +123,9 @@ public:
     virtual void AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op = MPI_SUM) const;
     virtual void AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op = MPI_SUM) const;
 
+    virtual void AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const;
+    virtual void AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const;
+
     virtual void AllReduceAsync(size_t* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const;
     virtual void AllReduceAsync(int* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const;
     virtual void AllReduceAsync(double* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const;
@@ -204,6 +223,9 @@ public:
     virtual void AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op = MPI_SUM) const;
     virtual void AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op = MPI_SUM) const;
 
+    virtual void AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const;
+    virtual void AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const;
+
     virtual void AllReduceAsync(size_t* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const;
     virtual void AllReduceAsync(int* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const;
     virtual void AllReduceAsync(double* sendData, size_t numElements, MPI_Request* request, MPI_Op op = MPI_SUM) const;
@@ -365,6 +387,29 @@ MPI_Datatype MPIWrapper::GetDataType(size_t *)
     return sizeof(size_t) == 4 ? MPI_UNSIGNED : MPI_LONG_LONG_INT;
 }
 
+MPIAllReduceAlgorithm ParseMPIAllReduceAlgorithm(const std::wstring& name)
+{
+    if (name == L"mpi" || name == L"default")
+        return MPIAllReduceAlgorithm::Default;
+    if (name == L"ring")
+        return MPIAllReduceAlgorithm::Ring;
+    if (name == L"hierarchical")
+        return MPIAllReduceAlgorithm::Hierarchical;
+
+    InvalidArgument("Unknown all-reduce algorithm '%ls'; expected 'mpi', 'ring' or 'hierarchical'.", name.c_str());
+}
+
+const wchar_t* MPIAllReduceAlgorithmName(MPIAllReduceAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case MPIAllReduceAlgorithm::Default:      return L"mpi";
+    case MPIAllReduceAlgorithm::Ring:         return L"ring";
+    case MPIAllReduceAlgorithm::Hierarchical: return L"hierarchical";
+    default:                                  LogicError("Unknown all-reduce algorithm %d.", (int)algorithm);
+    }
+}
+
 #if HAS_MPI
 // -----------------------------------------------------------------------
 // MPIWrapper that actually calls into msmpi.dll
@@ -373,7 +418,7 @@ MPI_Datatype MPIWrapper::GetDataType(size_t *)
 int MPIWrapperMpi::s_myRank = -1;
 
 MPIWrapperMpi::MPIWrapperMpi()
-    : m_currentComm(MPI_COMM_WORLD)
+    : m_currentComm(MPI_COMM_WORLD), m_allReduceCommsCreated(false), m_ringComm(MPI_COMM_NULL), m_hostComm(MPI_COMM_NULL), m_hostLeadersComm(MPI_COMM_NULL)
 {
     static bool initialized = false;
     if (initialized)
@@ -515,6 +560,9 @@ void MPIWrapperMpi::RequestNodes(const char *msg, size_t requestednodes /*defaul
 {
     Ping("requestnodes (before change)");
 
+    // the all-reduce communicators are derived from the current communicator, and are created again from the new one
+    FreeAllReduceCommunicators();
+
     // undo current split
 #ifdef USE2NDCOMM
     if (m_currentComm != MPI_COMM_WORLD /*no subset*/ && m_currentComm != MPI_COMM_NULL /*idle nodes*/)
@@ -780,6 +828,163 @@ void MPIWrapperMpi::AllReduce(float* sendData, float* receiveData, size_t numEle
     MPI_Allreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator()) || MpiFail("Allreduce: MPI_Allreduce");
 }
 
+void MPIWrapperMpi::AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const
+{
+    AllReduceWithAlgorithm(sendData, receiveData, numElements, op, algorithm);
+}
+
+void MPIWrapperMpi::AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const
+{
+    AllReduceWithAlgorithm(sendData, receiveData, numElements, op, algorithm);
+}
+
+// size of the messages of the ring all-reduce; a rank forwards each chunk as soon as it has received (and reduced) it
+static const size_t s_ringAllReduceChunkSizeInBytes = 1024 * 1024;
+
+template <class ElemType>
+void MPIWrapperMpi::AllReduceWithAlgorithm(ElemType* sendData, ElemType* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const
+{
+    if (algorithm == MPIAllReduceAlgorithm::Default)
+        return AllReduce(sendData, receiveData, numElements, op);
+
+    if (sendData != static_cast<ElemType*>(MPI_IN_PLACE) && sendData != receiveData)
+        memcpy(receiveData, sendData, numElements * sizeof(ElemType));
+
+    if (NumNodesInUse() == 1 || numElements == 0)
+        return;
+
+    CreateAllReduceCommunicators();
+    if (algorithm == MPIAllReduceAlgorithm::Ring)
+    {
+        RingAllReduce(receiveData, numElements, op, m_ringComm);
+    }
+    else if (algorithm == MPIAllReduceAlgorithm::Hierarchical)
+    {
+        // The ranks of a host exchange data through shared memory, so only one rank per host takes part in the ring.
+        int hostRank;
+        MPI_Comm_rank(m_hostComm, &hostRank) || MpiFail("AllReduce: MPI_Comm_rank");
+        auto dataType = GetDataType(receiveData);
+        if (hostRank == 0)
+        {
+            MPI_Reduce(MPI_IN_PLACE, receiveData, (int)numElements, dataType, op, 0, m_hostComm) || MpiFail("AllReduce: MPI_Reduce");
+            RingAllReduce(receiveData, numElements, op, m_hostLeadersComm);
+        }
+        else
+        {
+            MPI_Reduce(receiveData, nullptr, (int)numElements, dataType, op, 0, m_hostComm) || MpiFail("AllReduce: MPI_Reduce");
+        }
+        MPI_Bcast(receiveData, (int)numElements, dataType, 0, m_hostComm) || MpiFail("AllReduce: MPI_Bcast");
+    }
+    else
+        LogicError("AllReduce: unknown all-reduce algorithm %d.", (int)algorithm);
+}
+
+// Ring all-reduce of the N ranks of 'comm'. The data is cut into N segments. In the reduce-scatter phase, rank r sends
+// segment r to its right neighbor and, in each of the N-1 steps, receives the segment that the left neighbor sends,
+// adds its own part and passes the sum on in the next step, so that it ends up with the complete sum of segment r+1.
+// The all-gather phase circulates the complete segments the same way. Segments are sent in chunks, and every chunk is
+// passed on as soon as it has arrived, so that the steps overlap.
+template <class ElemType>
+void MPIWrapperMpi::RingAllReduce(ElemType* data, size_t numElements, MPI_Op op, MPI_Comm comm) const
+{
+    int numRanks, rank;
+    MPI_Comm_size(comm, &numRanks) || MpiFail("RingAllReduce: MPI_Comm_size");
+    MPI_Comm_rank(comm, &rank) || MpiFail("RingAllReduce: MPI_Comm_rank");
+    if (numRanks == 1)
+        return;
+
+    const int tag = 0;
+    const int left = (rank + numRanks - 1) % numRanks;
+    const int right = (rank + 1) % numRanks;
+    const auto dataType = GetDataType(data);
+    const size_t chunkSize = std::max<size_t>(1, s_ringAllReduceChunkSizeInBytes / sizeof(ElemType));
+
+    auto segmentBegin = [=](int segment) { return numElements * (size_t)segment / numRanks; };
+    auto segmentEnd = [=](int segment) { return numElements * (size_t)(segment + 1) / numRanks; };
+    auto wrap = [=](int segment) { return ((segment % numRanks) + numRanks) % numRanks; };
+
+    size_t maxSegmentSize = (numElements + numRanks - 1) / numRanks;
+    if (m_ringReceiveBuffer.size() < maxSegmentSize * sizeof(ElemType))
+        m_ringReceiveBuffer.resize(maxSegmentSize * sizeof(ElemType));
+    auto receiveBuffer = reinterpret_cast<ElemType*>(m_ringReceiveBuffer.data());
+
+    std::vector<MPI_Request> sendRequests;
+    std::vector<MPI_Request> receiveRequests;
+    auto send = [&](size_t begin, size_t end)
+    {
+        for (size_t offset = begin; offset < end; offset += chunkSize)
+        {
+            sendRequests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(data + offset, (int)std::min(chunkSize, end - offset), dataType, right, tag, comm, &sendRequests.back()) || MpiFail("RingAllReduce: MPI_Isend");
+        }
+    };
+
+    // In step s of a phase, this rank sends segment firstSegment - s and receives segment firstSegment - s - 1.
+    auto runPhase = [&](int firstSegment, bool reduce)
+    {
+        firstSegment = wrap(firstSegment);
+        send(segmentBegin(firstSegment), segmentEnd(firstSegment));
+        for (int step = 0; step < numRanks - 1; step++)
+        {
+            int segment = wrap(firstSegment - step - 1);
+            size_t begin = segmentBegin(segment);
+            size_t end = segmentEnd(segment);
+
+            receiveRequests.clear();
+            for (size_t offset = begin; offset < end; offset += chunkSize)
+            {
+                ElemType* target = reduce ? receiveBuffer + (offset - begin) : data + offset;
+                receiveRequests.push_back(MPI_REQUEST_NULL);
+                MPI_Irecv(target, (int)std::min(chunkSize, end - offset), dataType, left, tag, comm, &receiveRequests.back()) || MpiFail("RingAllReduce: MPI_Irecv");
+            }
+
+            for (size_t chunk = 0; chunk < receiveRequests.size(); chunk++)
+            {
+                size_t offset = begin + chunk * chunkSize;
+                size_t count = std::min(chunkSize, end - offset);
+                MPI_Wait(&receiveRequests[chunk], MPI_STATUS_IGNORE) || MpiFail("RingAllReduce: MPI_Wait");
+                if (reduce)
+                    MPI_Reduce_local(receiveBuffer + (offset - begin), data + offset, (int)count, dataType, op) || MpiFail("RingAllReduce: MPI_Reduce_local");
+                if (step + 1 < numRanks - 1)
+                    send(offset, offset + count);
+            }
+        }
+        MPI_Waitall((int)sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("RingAllReduce: MPI_Waitall");
+        sendRequests.clear();
+    };
+
+    runPhase(rank, /*reduce=*/true);      // afterwards, segment rank + 1 holds the complete sum
+    runPhase(rank + 1, /*reduce=*/false);
+}
+
+void MPIWrapperMpi::CreateAllReduceCommunicators() const
+{
+    if (m_allReduceCommsCreated)
+        return;
+
+    MPI_Comm_dup(Communicator(), &m_ringComm) || MpiFail("CreateAllReduceCommunicators: MPI_Comm_dup");
+    MPI_Comm_split_type(Communicator(), MPI_COMM_TYPE_SHARED, m_myRank, MPI_INFO_NULL, &m_hostComm) || MpiFail("CreateAllReduceCommunicators: MPI_Comm_split_type");
+
+    int hostRank;
+    MPI_Comm_rank(m_hostComm, &hostRank) || MpiFail("CreateAllReduceCommunicators: MPI_Comm_rank");
+    MPI_Comm_split(Communicator(), hostRank == 0 ? 0 : MPI_UNDEFINED, m_myRank, &m_hostLeadersComm) || MpiFail("CreateAllReduceCommunicators: MPI_Comm_split");
+
+    m_allReduceCommsCreated = true;
+}
+
+void MPIWrapperMpi::FreeAllReduceCommunicators()
+{
+    if (!m_allReduceCommsCreated)
+        return;
+
+    MPI_Comm_free(&m_ringComm) || MpiFail("FreeAllReduceCommunicators: MPI_Comm_free");
+    MPI_Comm_free(&m_hostComm) || MpiFail("FreeAllReduceCommunicators: MPI_Comm_free");
+    if (m_hostLeadersComm != MPI_COMM_NULL)
+        MPI_Comm_free(&m_hostLeadersComm) || MpiFail("FreeAllReduceCommunicators: MPI_Comm_free");
+
+    m_allReduceCommsCreated = false;
+}
+
 void MPIWrapperMpi::Bcast(size_t* sendData, size_t numElements, size_t srcRank)
 {
     MPI_Bcast(sendData, (int)numElements, GetDataType(sendData), (int)srcRank, Communicator()) || MpiFail("Bcast: MPI_Bcast");
@@ -1130,6 +1335,14 @@ void MPIWrapperEmpty::AllReduce(float* sendData, float* receiveData, size_t numE
 {
 }
 
+void MPIWrapperEmpty::AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const
+{
+}
+
+void MPIWrapperEmpty::AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op, MPIAllReduceAlgorithm algorithm) const
+{
+}
+
 void MPIWrapperEmpty::AllReduceAsync(size_t* sendData, size_t numElements, MPI_Request* request, MPI_Op op) const
 {
 }
@@ -19,6 +19,7 @@
 #include "PreComputeNodes.h"
 #include "EvaluationNodes.h"
 #include "SpecialPurposeNodes.h"
+#include "FusedElementwiseNode.h"
 #include "DeprecatedNodes.h" // (for SaveToDbnFile(), which is also deprecated)
 #include "MPIWrapper.h" // TODO: does not belong here
 #include <string>
@@ -53,6 +54,24 @@ vector<MemRequestInfo<half>>& MatrixPool::GetMemRequestInfoVec<half>()
     return m_memRequestInfoHalfVec;
 }
 
+template <>
+vector<ContiguousRequestInfo<float>>& MatrixPool::GetContiguousRequestInfoVec<float>()
+{
+    return m_contiguousRequestInfoFloatVec;
+}
+
+template <>
+vector<ContiguousRequestInfo<double>>& MatrixPool::GetContiguousRequestInfoVec<double>()
+{
+    return m_contiguousRequestInfoDoubleVec;
+}
+
+template <>
+vector<ContiguousRequestInfo<half>>& MatrixPool::GetContiguousRequestInfoVec<half>()
+{
+    return m_contiguousRequestInfoHalfVec;
+}
+
 // -----------------------------------------------------------------------
 // construction
 // -----------------------------------------------------------------------
@@ -98,6 +117,53 @@ void ComputationNetwork::PrintNodeTiming()
     }
 }
 
+void ComputationNetwork::ResetNodeCostStatistics()
+{
+    for (auto& iter : m_nameToNodeMap)
+        iter.second->ResetCostStatistics();
+}
+
+std::vector<NodeCostReportEntry> ComputationNetwork::GetNodeCostReportEntries() const
+{
+    std::vector<NodeCostReportEntry> entries;
+    for (auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (node->GetCostStatistics(false).m_calls == 0 && node->GetCostStatistics(true).m_calls == 0)
+            continue;
+
+        NodeCostReportEntry entry;
+        entry.m_nodeName = node->NodeName();
+        entry.m_operationName = node->OperationName();
+        entry.m_forward = node->GetCostStatistics(false);
+        entry.m_backward = node->GetCostStatistics(true);
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+// Nodes outside of loops are called once per minibatch, nodes in loops once per time step.
+size_t ComputationNetwork::GetNumNodeCostMinibatches() const
+{
+    size_t numMinibatches = 0;
+    for (auto& iter : m_nameToNodeMap)
+    {
+        if (!iter.second->IsPartOfLoop())
+            numMinibatches = max(numMinibatches, iter.second->GetCostStatistics(false).m_calls);
+    }
+    return numMinibatches;
+}
+
+void ComputationNetwork::PrintNodeCostReport(const NodeCostRoofline& roofline)
+{
+    ::Microsoft::MSR::CNTK::PrintNodeCostReport(stderr, GetNodeCostReportEntries(), GetNumNodeCostMinibatches(), roofline);
+}
+
+void ComputationNetwork::WriteNodeCostReport(const wstring& fileName, const NodeCostRoofline& roofline)
+{
+    ::Microsoft::MSR::CNTK::WriteNodeCostReport(fileName, GetNodeCostReportEntries(), GetNumNodeCostMinibatches(), roofline);
+}
+
 // -----------------------------------------------------------------------
 // serialization
 // -----------------------------------------------------------------------
@@ -133,13 +199,23 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
     fstream << (size_t) CURRENT_CNTK_MODEL_VERSION;
     fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
 
-    fstream << (size_t) m_nameToNodeMap.size();
+    // fused nodes are saved as the nodes they replace (see FuseElementwiseNodes())
+    vector<ComputationNodeBasePtr> nodesToSave;
+    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    {
+        auto fusedNode = dynamic_cast<const IFusedElementwiseNode*>(nodeIter->second.get());
+        if (fusedNode && !fusedNode->UnfusedNodes().empty())
+            nodesToSave.insert(nodesToSave.end(), fusedNode->UnfusedNodes().begin(), fusedNode->UnfusedNodes().end());
+        else
+            nodesToSave.push_back(nodeIter->second);
+    }
+
+    fstream << (size_t) nodesToSave.size();
 
     // put all node info first
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BNodeList");
-    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    for (const auto& nodePtr : nodesToSave)
     {
-        ComputationNodeBasePtr nodePtr = nodeIter->second;
         // type
 #if CURRENT_CNTK_MODEL_VERSION >= CNTK_MODEL_VERSION_7
         wstring precision;
@@ -163,9 +239,8 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
 
     // put relationship
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BRelation");
-    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    for (const auto& nodePtr : nodesToSave)
     {
-        ComputationNodeBasePtr nodePtr = nodeIter->second;
         fstream << nodePtr->NodeName() << nodePtr->GetNumInputs();
         for (size_t i = 0; i < nodePtr->GetNumInputs(); i++)
         {
@@ -697,6 +772,38 @@ void ComputationNetwork::SetSeqParam(ComputationNetworkPtr net,
     }
 }
 
+vector<pair<wstring, QuantizationError>> ComputationNetwork::EnableQuantizedTimesInference(QuantizedPrecision precision, size_t bitShiftA, size_t bitShiftB,
+                                                                                          const shared_ptr<QuantizedWeightsCache>& cache)
+{
+    VerifyIsCompiled("EnableQuantizedTimesInference");
+
+    vector<pair<wstring, QuantizationError>> report;
+    list<ComputationNodeBasePtr> timesNodes = GetNodesWithType(OperationNameOf(TimesNode));
+    for (auto& node : timesNodes)
+    {
+        // only float and double products can be quantized
+        QuantizationError error;
+        bool enabled = false;
+        if (auto nodef = dynamic_pointer_cast<TimesNode<float>>(node))
+            enabled = nodef->EnableQuantizedInference(precision, bitShiftA, bitShiftB, error, cache);
+        else if (auto noded = dynamic_pointer_cast<TimesNode<double>>(node))
+            enabled = noded->EnableQuantizedInference(precision, bitShiftA, bitShiftB, error, cache);
+        if (enabled)
+            report.push_back(make_pair(node->NodeName(), error));
+    }
+
+    fprintf(stderr, "Quantized inference: %d of %d Times operations use %s arithmetic.\n",
+            (int)report.size(), (int)timesNodes.size(), precision == QuantizedPrecision::Int8 ? "int8" : "int16");
+    for (const auto& entry : report)
+    {
+        const auto& weights = GetNodeFromName(entry.first)->Input(0);
+        fprintf(stderr, "\t%ls: weights %ls [%s], max |w| = %.6g, max abs error = %.6g, relative RMS error = %.4f%%\n",
+                entry.first.c_str(), weights->NodeName().c_str(), string(weights->GetSampleLayout()).c_str(),
+                entry.second.maxAbsValue, entry.second.maxAbsError, 100 * entry.second.relativeRmsError);
+    }
+    return report;
+}
+
 // -----------------------------------------------------------------------
 // unit test
 // -----------------------------------------------------------------------
@@ -51,6 +51,9 @@ class ComputationNetwork :
 public:
     typedef shared_ptr<ComputationNetwork> ComputationNetworkPtr;
 
+    // called during backprop with a learnable parameter whose gradient is final
+    typedef std::function<void(const ComputationNodeBasePtr&)> ParameterGradientReadyCallback;
+
     // -----------------------------------------------------------------------
     // construction
     // -----------------------------------------------------------------------
@@ -89,6 +92,13 @@ public:
 
     void PrintNodeTiming();
 
+    // per-node cost report, from the statistics gathered while Globals::ShouldProfileNodeCost() is set
+    void ResetNodeCostStatistics();
+    std::vector<NodeCostReportEntry> GetNodeCostReportEntries() const;
+    size_t GetNumNodeCostMinibatches() const;
+    void PrintNodeCostReport(const NodeCostRoofline& roofline = NodeCostRoofline());
+    void WriteNodeCostReport(const std::wstring& fileName, const NodeCostRoofline& roofline = NodeCostRoofline());
+
 protected:
     void ConstructFromRoots(DEVICEID_TYPE deviceId, std::deque<ComputationNodeBasePtr>&& roots, const map<ComputationNodeBasePtr, ComputationNodeBasePtr>& replacements);
     void ProcessSpecialNodes(const ScriptableObjects::IConfigRecord& config, std::deque<ComputationNodeBasePtr>& roots);
@@ -150,6 +160,11 @@ public:
     // main entry point for backprop
     void Backprop(const ComputationNodeBasePtr rootNode);
 
+    // Sets a function that Backprop() calls for every leaf that needs a gradient, as soon as all nodes that
+    // contribute to its gradient have been processed. This allows to start aggregating the gradients of the
+    // parameters while backprop is still running. Pass an empty function to remove it.
+    void SetParameterGradientReadyCallback(const ParameterGradientReadyCallback& callback);
+
     template <class NODESET> // version that takes multiple nodes
     void TravserseInSortedGlobalEvalOrder(const NODESET& nodes, const std::function<void(const ComputationNodeBasePtr&)>& action)
     {
@@ -256,6 +271,7 @@ private:
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
     void ChangeNodeInputs(ComputationNodeBasePtr fromNode, ComputationNodeBasePtr toNode);
+    bool FuseElementwiseNodes();
 
 private:
     void DetermineSetOfAllRoots();
@@ -273,6 +289,7 @@ public:
 
 private:
     void PrintMemorySharingStructure(const std::vector<ComputationNodeBasePtr>& nodes);
+    void UpdateMemorySharingForMinibatchSize();
     void ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap);
 
 public:
@@ -557,6 +574,17 @@ public:
                             const bool& sMBR = false);
     static void SetMaxTempMemSizeForCNN(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const size_t maxTempMemSizeInSamples);
 
+    // -----------------------------------------------------------------------
+    // inference options
+    // -----------------------------------------------------------------------
+
+    // Switches all Times operations that multiply a weight matrix with data to int8 or int16 arithmetic for inference on the
+    // CPU (see TimesNodeBase::EnableQuantizedInference()). Prints, and returns, how much quantization changed the weights of
+    // each switched node, as a measure of the accuracy drift to expect. Networks that share their weights can pass the same
+    // cache, so that each weight matrix is quantized once for all of them.
+    std::vector<std::pair<std::wstring, QuantizationError>> EnableQuantizedTimesInference(QuantizedPrecision precision, size_t bitShiftA = 0, size_t bitShiftB = 0,
+                                                                                          const std::shared_ptr<QuantizedWeightsCache>& cache = nullptr);
+
     // -----------------------------------------------------------------------
     // node-group access
     // -----------------------------------------------------------------------
@@ -1212,6 +1240,8 @@ protected:
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
         PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+
+        ParameterGradientReadyCallback m_parameterGradientReadyCallback; // see ComputationNetwork::SetParameterGradientReadyCallback()
     };
 
 public:
@@ -1276,6 +1306,7 @@ private:
     // cached network iterations
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_evalOrders; // [out node] flat depth-first traversal starting from out node
     std::map<const ComputationNodeBasePtr, ComputationNodeBasePtr> m_nestedNetworks;        // [out node] network rewritten as recursive traveral, potentially optimized; execution plan
+    ParameterGradientReadyCallback m_parameterGradientReadyCallback;
 
     // cached quick-access list for inputs and parameters
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_inputValues;         // [out node] -> all input nodes feeding into out node
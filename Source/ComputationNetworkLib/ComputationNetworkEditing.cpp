@@ -10,9 +10,14 @@
 #include "ComputationNetwork.h"
 #include "InputAndParamNodes.h"
 #include "TrainingNodes.h"
+#include "FusedElementwiseNode.h"
+#include "Globals.h"
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
+#include <functional>
 
 using namespace std;
 
@@ -367,4 +372,160 @@ void ComputationNetwork::SetLearnableNodesBelowLearningRateMultiplier(const floa
     }
 }
 
+// -----------------------------------------------------------------------
+// elementwise node fusion
+// -----------------------------------------------------------------------
+
+// Replaces groups of elementwise nodes (those implementing IElementwiseOperation) by FusedElementwiseNodes, so that
+// each group makes one pass over memory instead of one per node. A group is a tree of nodes of equal shape and
+// MBLayout whose inner nodes are used only by their parent in the tree; the root keeps its name, so that it can
+// still be referenced, while the inner nodes disappear from the network. The fused node keeps the nodes of its group,
+// which are what Save() writes, so fusion never shows up in a saved model. Nodes in node groups, in recurrent loops,
+// and with sparse or broadcast inputs are not fused. This is done only on the CPU, for which the fused node is implemented.
+// Called from CompileNetwork() after validation. Returns true if the network has been changed.
+bool ComputationNetwork::FuseElementwiseNodes()
+{
+    if (!Globals::ShouldFuseElementwiseNodes() || m_deviceId != CPUDEVICE || AreMatricesAllocated())
+        return false;
+
+    // nodes that can be computed as a step of a fused program
+    auto isFusable = [](const ComputationNodeBasePtr& node)
+    {
+        auto op = dynamic_cast<const IElementwiseOperation*>(node.get());
+        if (!op || op->ElementwiseForwardOp() == ElementWiseOperator::opCopy || // (pass-through nodes are left alone)
+            node->GetNumInputs() < 1 || node->GetNumInputs() > 2 || node->IsPartOfLoop() || node->IsValueSparse())
+            return false;
+        for (const auto& input : node->GetInputs())
+        {
+            if (!input || input->IsValueSparse() || input->GetMBLayout() != node->GetMBLayout() ||
+                input->GetSampleLayout().GetDims() != node->GetSampleLayout().GetDims())
+                return false;
+        }
+        return true;
+    };
+
+    map<ComputationNodeBasePtr, set<ComputationNodeBasePtr>> consumers;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+            consumers[input].insert(iter.second);
+    }
+
+    // nodes in node groups are accessed from outside and must keep their values
+    set<ComputationNodeBasePtr> groupNodes;
+    for (auto group : GetAllNodeGroups())
+        groupNodes.insert(group->begin(), group->end());
+
+    // Determine the groups before changing anything: inner nodes are computed inside the group of their only consumer,
+    // and every other fusable node is the root of a group.
+    set<ComputationNodeBasePtr> innerNodes;
+    vector<ComputationNodeBasePtr> roots;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (!isFusable(node))
+            continue;
+        const auto& nodeConsumers = consumers[node];
+        if (nodeConsumers.size() == 1 && isFusable(*nodeConsumers.begin()) && groupNodes.find(node) == groupNodes.end())
+            innerNodes.insert(node);
+        else
+            roots.push_back(node);
+    }
+
+    bool changed = false;
+    for (const auto& root : roots)
+    {
+        // the inputs of the group become the inputs of the fused node
+        vector<ComputationNodeBasePtr> leaves;
+        map<ComputationNodeBasePtr, size_t> leafSlots;
+        set<ComputationNodeBasePtr> visited;
+        function<void(const ComputationNodeBasePtr&)> collectLeaves = [&](const ComputationNodeBasePtr& node)
+        {
+            if (!visited.insert(node).second)
+                return;
+            for (const auto& input : node->GetInputs())
+            {
+                if (innerNodes.find(input) != innerNodes.end())
+                    collectLeaves(input);
+                else if (leafSlots.insert(make_pair(input, leaves.size())).second)
+                    leaves.push_back(input);
+            }
+        };
+        collectLeaves(root);
+
+        // emit the steps in evaluation order; slots 0..leaves.size()-1 are the leaves
+        vector<FusedElementwiseStep> program;
+        vector<ComputationNodeBasePtr> groupNodesToRemove;
+        map<ComputationNodeBasePtr, size_t> stepSlots;
+        function<size_t(const ComputationNodeBasePtr&)> emit = [&](const ComputationNodeBasePtr& node) -> size_t
+        {
+            if (node != root && innerNodes.find(node) == innerNodes.end())
+                return leafSlots[node];
+            auto iter = stepSlots.find(node);
+            if (iter != stepSlots.end())
+                return iter->second;
+
+            FusedElementwiseStep step;
+            auto op = dynamic_cast<const IElementwiseOperation*>(node.get());
+            step.m_op = op->ElementwiseForwardOp();
+            step.m_numArgs = node->GetNumInputs();
+            for (size_t j = 0; j < 2; j++)
+            {
+                step.m_args[j] = j < step.m_numArgs ? emit(node->GetInputs()[j]) : 0;
+                step.m_gradientOps[j] = ElementWiseOperator::opNone;
+                step.m_gradientOperands[j] = FusedElementwiseStep::NoOperand;
+            }
+
+            size_t slot = leaves.size() + program.size();
+            for (size_t j = 0; j < step.m_numArgs; j++)
+            {
+                int operand;
+                step.m_gradientOps[j] = op->ElementwiseGradientOp(j, operand);
+                if (operand == IElementwiseOperation::OutputOperand)
+                    step.m_gradientOperands[j] = slot;
+                else if (operand != IElementwiseOperation::NoOperand)
+                    step.m_gradientOperands[j] = step.m_args[operand];
+            }
+
+            program.push_back(step);
+            groupNodesToRemove.push_back(node);
+            stepSlots[node] = slot;
+            return slot;
+        };
+        emit(root);
+
+        if (program.size() < 2) // a single node is not worth replacing
+            continue;
+
+        ComputationNodeBasePtr fusedNode;
+        if (root->Is<ComputationNode<float>>())
+            fusedNode = New<FusedElementwiseNode<float>>(m_deviceId, root->NodeName(), program, groupNodesToRemove);
+        else if (root->Is<ComputationNode<double>>())
+            fusedNode = New<FusedElementwiseNode<double>>(m_deviceId, root->NodeName(), program, groupNodesToRemove);
+        else if (root->Is<ComputationNode<half>>())
+            fusedNode = New<FusedElementwiseNode<half>>(m_deviceId, root->NodeName(), program, groupNodesToRemove);
+        else
+            LogicError("FuseElementwiseNodes: Unexpected node type.");
+
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FuseElementwiseNodes: Fusing %d nodes with %d inputs into %ls.\n", (int)program.size(), (int)leaves.size(), root->NodeName().c_str());
+
+        // the removed nodes keep their inputs, for saving the unfused graph
+        ChangeNodeInputs(root, fusedNode);
+        for (const auto& node : groupNodesToRemove)
+            RemoveNodeFromNet(node);
+        fusedNode->AttachInputs(leaves);
+        AddNodeToNet(fusedNode);
+
+        for (auto groupIter : GetAllNodeGroups())
+            replace(groupIter->begin(), groupIter->end(), root, fusedNode);
+
+        changed = true;
+    }
+
+    if (changed)
+        InvalidateCompiledNetwork();
+    return changed;
+}
+
 }}}
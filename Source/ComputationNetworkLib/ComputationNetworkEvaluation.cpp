@@ -41,6 +41,10 @@ void ComputationNetwork::ForwardProp(const ComputationNodeBasePtr rootNode)
 {
     VerifyIsCompiled("ForwardProp");
 
+    // the first ForwardProp() of a minibatch is where we first see its actual size
+    if (AreMatricesAllocated() && Globals::ShouldEnableMinibatchSizeAwareMemorySharing())
+        UpdateMemorySharingForMinibatchSize();
+
     // traverse all nodes in the pre-determined evaluation order
     GetNestedNetwork(rootNode)->ForwardProp(FrameRange(nullptr));
 }
@@ -94,7 +98,16 @@ void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNod
     if (m_nestedNetworks.find(rootNode) != m_nestedNetworks.end())
         fprintf(stderr, "FormNestedNetwork: WARNING: Was called twice for %ls %ls operation\n", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
 
-    m_nestedNetworks[rootNode] = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode));
+    auto nestedNetwork = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode));
+    nestedNetwork->m_parameterGradientReadyCallback = m_parameterGradientReadyCallback;
+    m_nestedNetworks[rootNode] = nestedNetwork;
+}
+
+void ComputationNetwork::SetParameterGradientReadyCallback(const ParameterGradientReadyCallback& callback)
+{
+    m_parameterGradientReadyCallback = callback;
+    for (auto& nestedNetwork : m_nestedNetworks)
+        dynamic_pointer_cast<PARTraversalFlowControlNode>(nestedNetwork.second)->m_parameterGradientReadyCallback = callback;
 }
 
 ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -148,7 +161,7 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         node->BeginForwardProp();
         node->BeginTiming(false /*backward*/);
         node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
-        node->EndTiming(false /*backward*/);
+        node->EndTiming(false /*backward*/, fr.WithLayout(node->GetMBLayout()));
         node->EndForwardProp();
 
         node->BumpEvalTimeStamp();
@@ -188,12 +201,16 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         node->BeginBackprop();
         node->BeginTiming(true /*backward*/);
         node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
-        node->EndTiming(true /*backward*/);
+        node->EndTiming(true /*backward*/, fr.WithLayout(node->GetMBLayout()));
         node->EndBackprop();
 
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
             DumpNode(node, /*dumpGradient=*/true);
+
+        // All parents of a leaf come before it in the backward order, so its gradient is final now.
+        if (m_parameterGradientReadyCallback && node->IsLeaf() && node->NeedsGradient())
+            m_parameterGradientReadyCallback(node);
     }
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
@@ -287,7 +304,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
         {
             node->BeginTiming(false /*backward*/);
             node->ForwardProp(t);
-            node->EndTiming(false /*backward*/);
+            node->EndTiming(false /*backward*/, t);
             node->BumpEvalTimeStamp();
         }
     }
@@ -329,7 +346,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
             auto& node2 = *nodeIter2;
             node2->BeginTiming(true /*backward*/);
             node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
-            node2->EndTiming(true /*backward*/);
+            node2->EndTiming(true /*backward*/, t);
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
         }
@@ -549,7 +566,12 @@ void ComputationNetwork::CompileNetwork()
     ValidateNetwork();
 
     // STEP: Optimize the network.
-    // :)
+    // Fusing nodes changes the graph, so everything above has to be redone for the new one.
+    if (FuseElementwiseNodes())
+    {
+        CompileNetwork();
+        return;
+    }
 
     // STEP: Some final details.
     ResetEvalTimeStamps(); // invalidate all m_value fields. Really belongs into StartEvaluateMinibatchLoop()
@@ -1120,6 +1142,15 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         }
     }
 
+    // The gradients of the learnable parameters optionally live in one contiguous buffer, so that gradient aggregation
+    // can reduce them in a few large MPI calls. They are not aliased with the gradients of their parents then.
+    bool contiguousParameterGradients = performingBackPropagation && Globals::ShouldUseContiguousParameterGradients();
+    for (auto& node : uniqueForwardPropEvalNodes)
+    {
+        node->m_gradientInContiguousBuffer = contiguousParameterGradients && node->NeedsGradient() &&
+                                             node->OperationName() == OperationNameOf(LearnableParameter);
+    }
+
     // gradient reuse maps
     std::unordered_map<MatrixPool::AliasNodePtr, std::unordered_set<MatrixPool::AliasNodePtr>> gradientReuseChildrenMap;
     std::unordered_map<MatrixPool::AliasNodePtr, MatrixPool::AliasNodePtr> gradientReuseParentMap;
@@ -1133,6 +1164,9 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         {
             auto parent = *keyValue.second.begin();
             auto opt = parent->ImplementsGradientOptimization(keyValue.first.get());
+            if (opt == ParentGradientOptimization::Reuse && keyValue.first->IsGradientInContiguousBuffer())
+                opt = ParentGradientOptimization::None;
+
             if (opt != ParentGradientOptimization::None && trainRootNode != parent)
             {
                 // We cannot enable the gradient overwrite/reuse optimization if this node's (lone) parent
@@ -1269,11 +1303,12 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
     }
 
     m_matrixPool.OptimizedMemoryAllocation(); 
+    m_matrixPool.AllocateContiguousMatrices();
     m_areMatricesAllocated = true;
 
-    // TO DO: At the time of AllocateAllMatrices we don't know the minibatch size. In theory one may allocate memory again once we start to receive
-    // data from the reader (and the minibatch size is known). For some problems, minibatch size can change constantly, and there needs to be a 
-    // tradeoff in deciding how frequent to run optimized memory allocation. For now, we do it only once at the very beginning for speed concerns. 
+    // At the time of AllocateAllMatrices we don't know the minibatch size. The matrix pool is asked to plan again once
+    // we start to receive data from the reader, and whenever the minibatch grows (see UpdateMemorySharingForMinibatchSize()).
+    // Since the minibatch size can change constantly, we don't re-plan when it shrinks.
 
     // TO DO: when some matrices are sparse, the memory size request may be wrong. One may need to call OptimizedMemoryAllocation later again 
     // if the requests of sparse allocation and release are re-processed correctly. Future work. 
@@ -1283,6 +1318,30 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         PrintMemorySharingStructure(GetAllNodes());
 }
 
+// re-plan memory sharing if the current minibatch is larger than any before
+// This is called from ForwardProp(). A minibatch that is larger than all previous ones must be a new one, so at this point
+// no node has been evaluated on it yet, and the content of the pooled matrices is not needed anymore.
+void ComputationNetwork::UpdateMemorySharingForMinibatchSize()
+{
+    // all inputs are populated before the first ForwardProp() of a minibatch, so this finds the same size for every root
+    size_t mbNumCols = 0;
+    for (const auto& rootAndInputs : m_inputValues)
+    {
+        for (const auto& input : rootAndInputs.second)
+        {
+            if (input->HasMBLayout())
+                mbNumCols = max(mbNumCols, input->GetMBLayout()->GetNumCols());
+        }
+    }
+
+    if (mbNumCols == 0 || !m_matrixPool.UpdateMinibatchSize(mbNumCols))
+        return;
+
+    if (TraceLevel() > 0)
+        fprintf(stderr, "\nMemory Sharing: Re-planned for minibatches of up to %d columns, %.1f MB in shared buffers.\n",
+                (int)mbNumCols, m_matrixPool.GetPlannedBytes() / (1024.0 * 1024.0));
+}
+
 void ComputationNetwork::ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap)
 {
     for (int i = 0; i < n->GetNumInputs(); i++)
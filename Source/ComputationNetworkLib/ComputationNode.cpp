@@ -780,10 +780,18 @@ template <class ElemType>
 template <class ElemType>
 /*virtual*/ void ComputationNode<ElemType>::BeginTiming(bool backward)
 {
-    if (!Globals::ShouldEnableNodeTiming()) return;
-
     int phase = (backward ? (int)TimingPhase_Backward : (int)TimingPhase_Forward);
     auto& timing = m_timing[phase];
+
+    if (Globals::ShouldProfileNodeCost())
+    {
+        // wait for the work of the previous nodes, so that it is not attributed to this one
+        SynchronizeDeviceForNodeCost(m_deviceId);
+        timing.costBeginTime = std::chrono::steady_clock::now();
+    }
+
+    if (!Globals::ShouldEnableNodeTiming()) return;
+
     timing.beginTime = std::chrono::system_clock::now();
     timing.count++;
 #ifndef  CNTK_UWP
@@ -792,12 +800,28 @@ template <class ElemType>
 }
 
 template <class ElemType>
-/*virtual*/ void ComputationNode<ElemType>::EndTiming(bool backward)
+/*virtual*/ void ComputationNode<ElemType>::EndTiming(bool backward, const FrameRange& fr)
 {
-    if (!Globals::ShouldEnableNodeTiming()) return;
-
     int phase = (backward ? (int)TimingPhase_Backward : (int)TimingPhase_Forward);
     auto& timing = m_timing[phase];
+
+    if (Globals::ShouldProfileNodeCost())
+    {
+        SynchronizeDeviceForNodeCost(m_deviceId);
+        auto& statistics = m_costStatistics[phase];
+        statistics.m_calls++;
+        statistics.m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - timing.costBeginTime).count();
+
+        auto estimate = EstimateNodeCost(*this, fr, backward, sizeof(ElemType));
+        statistics.m_flops += estimate.m_flops;
+        statistics.m_bytes += estimate.m_bytes;
+
+        size_t matrixBytes = (m_value ? m_value->BufferSize() : 0) + (m_gradient ? m_gradient->BufferSize() : 0);
+        statistics.m_matrixBytes = max(statistics.m_matrixBytes, matrixBytes);
+    }
+
+    if (!Globals::ShouldEnableNodeTiming()) return;
+
     timing.duration += (std::chrono::system_clock::now() - timing.beginTime);
 
 #ifndef  CNTK_UWP
@@ -808,13 +832,15 @@ template <class ElemType>
         "Backward",
     };
 
-    if (timing.profilerName.length() != m_nodeName.length() + strlen(postfixes[phase]))
+    // Nodes can be renamed, so the event is registered again if the name changed.
+    if (timing.profilerEventId < 0 || timing.profilerNodeName != m_nodeName)
     {
-        static char name[256];
-        sprintf_s(name, _countof(name), "%S%s", m_nodeName.c_str(), postfixes[phase]);
-        timing.profilerName = name;
+        char name[256];
+        sprintf_s(name, _countof(name), "%S.%s", m_nodeName.c_str(), postfixes[phase]);
+        timing.profilerEventId = ProfilerRegisterEvent(name);
+        timing.profilerNodeName = m_nodeName;
     }
-    ProfilerTimeEnd(timing.profilerId, timing.profilerName.c_str());
+    ProfilerTimeEnd(timing.profilerId, timing.profilerEventId);
 #endif
 }
 
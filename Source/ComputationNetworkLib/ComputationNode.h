@@ -13,6 +13,7 @@
 #include "MatrixPool.h"
 #include "ComputationEnvironment.h"
 #include "Globals.h"
+#include "NodeCostReport.h"
 
 #include <unordered_set>
 #include <map>
@@ -103,7 +104,7 @@ struct /*interface*/ IComputationNode
     virtual void EndForwardProp() = 0;               // called after last iteration step of ForwardProp()
 
     virtual void BeginTiming(bool backward) = 0;      // called before Forward/Backward for node timing
-    virtual void EndTiming(bool backward) = 0;        // called after Foward/Backward for node timing   
+    virtual void EndTiming(bool backward, const FrameRange& fr) = 0; // called after Foward/Backward for node timing and cost profiling
 
     virtual void PostForwardAndBackProp() {} // Optional: Post forward and backprop prop for one minibatch, this will be called in a second 
                                              //           looping on the graph, after the backward pass finish. Or after forward pass in inference
@@ -183,7 +184,7 @@ struct ComputationNetworkOwnedNodeState
 
     ComputationNetworkOwnedNodeState()
         : m_needsGradient(false), m_needsDynamicValidation(false), m_valueSharable(true), m_parentGradientOptimization(ParentGradientOptimization::None),
-          m_isPartOfLoop{false}
+          m_gradientInContiguousBuffer(false), m_isPartOfLoop{false}
     {
     }
 
@@ -207,6 +208,8 @@ struct ComputationNetworkOwnedNodeState
     bool ParentGradientOptimized() const { return m_parentGradientOptimization != ParentGradientOptimization::None; }
     bool ParentGradientReused() const { return m_parentGradientOptimization == ParentGradientOptimization::Reuse; }
 
+    bool IsGradientInContiguousBuffer() const { return m_gradientInContiguousBuffer; }
+
     virtual void MarkValueNonSharable() { m_valueSharable = false; }
     virtual void MarkValueSharable() { m_valueSharable = true; }
     bool IsValueSharable() const { return m_valueSharable; }
@@ -233,6 +236,8 @@ protected:                // TODO: should be fully encapsulated here
 
     ParentGradientOptimization m_parentGradientOptimization; // flag indicating whether the parent of this node overwrites the gradient of this node instead of accumulating to it
 
+    bool m_gradientInContiguousBuffer; // the gradient is a view into the buffer shared by the gradients of all learnable parameters (see MatrixPool::RequestContiguousAllocate())
+
 private:
     bool m_isPartOfLoop; // true if this loop is part of a recurrent loop
 
@@ -791,7 +796,7 @@ public:
     }
 
     virtual void /*IComputationNode::*/ BeginTiming(bool) override {}
-    virtual void /*IComputationNode::*/ EndTiming(bool) override {}
+    virtual void /*IComputationNode::*/ EndTiming(bool, const FrameRange&) override {}
 
     // check whether a node is out of date w.r.t. its children, for lazy evaluation
     // If this returns true, node must be evaluated to update m_value.
@@ -944,6 +949,10 @@ public:
 
     bool IsValueSparse() const { return m_isValueSparse; }
 
+    // costs accumulated while Globals::ShouldProfileNodeCost() is set, see NodeCostReport.h
+    const NodeCostStatistics& GetCostStatistics(bool backward) const { return m_costStatistics[backward ? 1 : 0]; }
+    void ResetCostStatistics() { m_costStatistics[0] = m_costStatistics[1] = NodeCostStatistics(); }
+
     // debugging helper
     size_t m_uniqueNumericId; // (a unique handle for debugging)
 protected:
@@ -978,6 +987,9 @@ protected:
     float m_learningRateMultiplier;    // update parameters? Only used for LearnableParameters.    --TODO: Should we make this a member of LearnableParameters actually? And require a type cast? Currently it is read out for all leaves.
     const ComputationNodeBase* m_gradientInitializedBy; // indicates which node initialized the gradient matrix
     bool m_outputNeededDuringBackprop; // indicates whether the output value of the node is needed during backprop
+
+    // cost profiling, [0] for forward and [1] for backward
+    NodeCostStatistics m_costStatistics[2];
 };
 typedef ComputationNodeBase::ComputationNodeBasePtr ComputationNodeBasePtr;
 
@@ -1216,6 +1228,24 @@ struct ITakesDynamicAxis
     virtual const std::wstring GetRequestedDynamicAxis() const = 0;
 };
 
+// =======================================================================
+// Nodes that compute each output element from the input elements at the
+// same position with a single ElementWiseOperator implement this, so that
+// chains of them can be fused into one node (see FuseElementwiseNodes()).
+// =======================================================================
+struct IElementwiseOperation
+{
+    static const int NoOperand = -2;
+    static const int OutputOperand = -1;
+
+    // the operator that computes the output from the inputs, in the order of the inputs
+    virtual ElementWiseOperator ElementwiseForwardOp() const = 0;
+
+    // The gradient of input 'inputIndex' is op(outputGradient) if 'operand' is set to NoOperand, op(outputGradient, output)
+    // for OutputOperand, and op(outputGradient, input 'operand') otherwise. opNone means that no gradient flows to the input.
+    virtual ElementWiseOperator ElementwiseGradientOp(size_t inputIndex, int& operand) const = 0;
+};
+
 // =======================================================================
 // Nodes that have multiple outputs must derive from this.
 // =======================================================================
@@ -1786,7 +1816,7 @@ public:
 
     virtual void /*IComputationNode::*/ BeginTiming(bool) override;
 
-    virtual void /*IComputationNode::*/ EndTiming(bool) override;
+    virtual void /*IComputationNode::*/ EndTiming(bool, const FrameRange&) override;
 
     // this is the entry point from Network; while it will call virtual BackpropTo() into the actual node implementation
     // TODO: move to -Base (or -Network?)
@@ -1884,6 +1914,18 @@ public:
     // request matrices that are needed for gradient computation
     virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
     {
+        if (IsGradientInContiguousBuffer())
+        {
+            // requested once per parent; a parameter shared by several parents must only get one slot
+            if (m_gradient == nullptr)
+            {
+                size_t rows, cols;
+                DetermineDataSize(rows, cols);
+                matrixPool.RequestContiguousAllocate(m_deviceId, &m_gradient, rows, cols);
+            }
+            return;
+        }
+
         size_t matrixSize = m_sampleLayout.GetNumElements();
         RequestMatrixFromPool(m_gradient, matrixPool, matrixSize, HasMBLayout(), /*isWorkSpace*/false, ParentGradientReused() || IsGradientReused());
 
@@ -2186,7 +2228,9 @@ protected:
         int count = 0;
         std::chrono::duration<float> duration = std::chrono::duration<float>(0);
         long long profilerId;
-        std::string profilerName;
+        int profilerEventId = -1;       // profiler event of this node and phase, registered on first use
+        std::wstring profilerNodeName;  // node name the event was registered for
+        std::chrono::steady_clock::time_point costBeginTime; // for cost profiling
 
         void Reset()
         {
@@ -0,0 +1,169 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "Basics.h"
+#include "ComputationNode.h"
+#include "Matrix.h"
+#include "CPUFusedElementwise.h"
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// The nodes that a FusedElementwiseNode was created from, with their original inputs, the last one being the root
+// of the group. ComputationNetwork::Save() writes these instead of the fused node, so that fusion stays a
+// transformation of the compiled network: the saved model can be loaded on the GPU, by the V2 library and by older builds.
+struct IFusedElementwiseNode
+{
+    virtual const std::vector<ComputationNodeBasePtr>& UnfusedNodes() const = 0;
+};
+
+// -----------------------------------------------------------------------
+// FusedElementwiseNode (input1, input2, ...)
+// Computes a group of elementwise operations in one pass over memory. The operations are given as a
+// program of FusedElementwiseStep (see CPUFusedElementwise.h) over the inputs, which all have the shape
+// and MBLayout of the output. The node is not created by users; ComputationNetwork::FuseElementwiseNodes()
+// replaces groups of elementwise nodes by it when compiling a network on the CPU.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class FusedElementwiseNode : public ComputationNode<ElemType>, public IFusedElementwiseNode // takes a variable number of inputs
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"FusedElementwise"; }
+
+public:
+    DeclareConstructorFromConfig(FusedElementwiseNode);
+    FusedElementwiseNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+    FusedElementwiseNode(DEVICEID_TYPE deviceId, const wstring& name, const std::vector<FusedElementwiseStep>& program,
+                         const std::vector<ComputationNodeBasePtr>& unfusedNodes)
+        : Base(deviceId, name), m_program(program), m_unfusedNodes(unfusedNodes)
+    {
+    }
+
+    const std::vector<FusedElementwiseStep>& Program() const { return m_program; }
+
+    // empty if the node has been loaded from a model that was saved with fused nodes
+    virtual const std::vector<ComputationNodeBasePtr>& UnfusedNodes() const override { return m_unfusedNodes; }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        auto result = ValueFor(fr);
+        std::vector<Matrix<ElemType>> inputs;
+        auto inputData = InputDataFor(fr, inputs);
+        CPUFusedElementwiseForward(m_program, result.GetNumElements(), inputData, CPUDataOf(result));
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        auto gradient = GradientFor(fr);
+        auto inputGradient = InputRef(inputIndex).GradientFor(fr);
+        std::vector<Matrix<ElemType>> inputs;
+        auto inputData = InputDataFor(fr, inputs);
+        ElemType beta = InputRef(inputIndex).IsGradientInitializedBy(this) ? (ElemType)0 : (ElemType)1;
+        CPUFusedElementwiseBackward(m_program, gradient.GetNumElements(), inputData, CPUDataOf(gradient), inputIndex, beta, CPUDataOf(inputGradient));
+    }
+
+    // the gradients are recomputed from the inputs
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
+
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override
+    {
+        return ParentGradientOptimization::Overwrite;
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        ValidateNaryZip(isFinalValidationPass, /*allowBroadcast=*/ false, GetNumInputs());
+
+        if (isFinalValidationPass)
+        {
+            ValidateFusedElementwiseProgram(m_program, GetNumInputs());
+            for (size_t i = 0; i < GetNumInputs(); i++)
+            {
+                if (Input(i)->GetSampleLayout().GetDims() != GetSampleLayout().GetDims() || Input(i)->GetMBLayout() != GetMBLayout())
+                    InvalidArgument("%ls: Input %d must have the shape and minibatch layout of the output.", NodeDescription().c_str(), (int)i);
+            }
+        }
+    }
+
+    virtual void Save(File& fstream) const override
+    {
+        Base::Save(fstream);
+        fstream << m_program.size();
+        for (const auto& step : m_program)
+        {
+            fstream << (int)step.m_op << step.m_numArgs;
+            for (size_t j = 0; j < 2; j++)
+                fstream << step.m_args[j] << (int)step.m_gradientOps[j] << step.m_gradientOperands[j];
+        }
+    }
+
+    virtual void Load(File& fstream, size_t modelVersion) override
+    {
+        Base::Load(fstream, modelVersion);
+        size_t numSteps;
+        fstream >> numSteps;
+        m_program.resize(numSteps);
+        for (auto& step : m_program)
+        {
+            int op;
+            fstream >> op >> step.m_numArgs;
+            step.m_op = (ElementWiseOperator)op;
+            for (size_t j = 0; j < 2; j++)
+            {
+                int gradientOp;
+                fstream >> step.m_args[j] >> gradientOp >> step.m_gradientOperands[j];
+                step.m_gradientOps[j] = (ElementWiseOperator)gradientOp;
+            }
+        }
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<FusedElementwiseNode<ElemType>>(nodeP);
+            node->m_program = m_program;
+            node->m_unfusedNodes = m_unfusedNodes;
+        }
+    }
+
+private:
+    static ElemType* CPUDataOf(const Matrix<ElemType>& m)
+    {
+        if (m.GetDeviceId() != CPUDEVICE || m.GetMatrixType() != MatrixType::DENSE)
+            LogicError("FusedElementwise: Only dense matrices on the CPU are supported.");
+        return m.Data();
+    }
+
+    // collects the input slices; 'inputs' keeps the slice views alive
+    std::vector<const ElemType*> InputDataFor(const FrameRange& fr, std::vector<Matrix<ElemType>>& inputs)
+    {
+        std::vector<const ElemType*> inputData;
+        inputs.reserve(GetNumInputs());
+        for (size_t i = 0; i < GetNumInputs(); i++)
+        {
+            inputs.push_back(InputRef(i).ValueFor(fr));
+            inputData.push_back(CPUDataOf(inputs.back()));
+        }
+        return inputData;
+    }
+
+    std::vector<FusedElementwiseStep> m_program;
+    std::vector<ComputationNodeBasePtr> m_unfusedNodes;
+};
+
+template class FusedElementwiseNode<float>;
+template class FusedElementwiseNode<double>;
+template class FusedElementwiseNode<half>;
+
+}}}
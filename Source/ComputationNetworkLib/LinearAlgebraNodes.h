@@ -30,7 +30,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class PlusNode : public BinaryElementWiseNode<ElemType>
+class PlusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseOperation
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Plus"; }
@@ -87,6 +87,9 @@ public:
 
         return this->InputMatchesOutput(i) ? ParentGradientOptimization::Reuse : ParentGradientOptimization::Overwrite;
     }
+
+    virtual ElementWiseOperator ElementwiseForwardOp() const override { return opSum; }
+    virtual ElementWiseOperator ElementwiseGradientOp(size_t /*inputIndex*/, int& operand) const override { operand = NoOperand; return opCopy; }
 };
 
 template class PlusNode<float>;
@@ -235,7 +238,7 @@ template class PowNode<half>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class MinusNode : public BinaryElementWiseNode<ElemType>
+class MinusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseOperation
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Minus"; }
@@ -286,6 +289,9 @@ public:
         // only left operand can use gradient overwrite optimization
         return (Input(0).get() == input && this->InputMatchesOutput(0)) ? ParentGradientOptimization::Reuse : ParentGradientOptimization::Overwrite;
     }
+
+    virtual ElementWiseOperator ElementwiseForwardOp() const override { return opDifference; }
+    virtual ElementWiseOperator ElementwiseGradientOp(size_t inputIndex, int& operand) const override { operand = NoOperand; return inputIndex == 0 ? opCopy : opNegate; }
 };
 
 template class MinusNode<float>;
@@ -299,7 +305,7 @@ template class MinusNode<half>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ElementTimesNode : public BinaryElementWiseNode<ElemType>
+class ElementTimesNode : public BinaryElementWiseNode<ElemType>, public IElementwiseOperation
 {
     typedef BinaryElementWiseNode<ElemType> Base;
     UsingBinaryElementwiseNodeBaseMembers;
@@ -331,6 +337,9 @@ public:
         return ParentGradientOptimization::Overwrite;
     }
 
+    virtual ElementWiseOperator ElementwiseForwardOp() const override { return opElementwiseProduct; }
+    virtual ElementWiseOperator ElementwiseGradientOp(size_t inputIndex, int& operand) const override { operand = (int)(1 - inputIndex); return opElementwiseProduct; }
+
     template <typename classType>
     static void ForwardPropImpl(classType& c, const FrameRange& fr, bool allowBroadcast)
     {
@@ -393,7 +402,8 @@ public:
 
 public:
     TimesNodeBase(DEVICEID_TYPE deviceId, const wstring& name, size_t outputRank = 1, int inferInputRankToMap = NoInferredInputRank)
-        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_beingUnrolled(false)
+        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_beingUnrolled(false),
+          m_quantizedInference(false), m_quantizedWeightsTimeStamp(0)
     {
     }
 
@@ -713,11 +723,17 @@ public:
         auto input0 = OneSampleTensorFor(0,  /*gradient=*/false, fr.AllowBroadcast());
         auto input1 = OneSampleTensorFor(1,  /*gradient=*/false, fr.AllowBroadcast());
         auto output = OneSampleTensorFor(-1, /*gradient=*/false, fr);
+        // Like all node state, the quantized weights belong to this network and are updated here without synchronization.
+        if (m_quantizedInference && InputRef(0).GetEvalTimeStamp() != m_quantizedWeightsTimeStamp)
+            QuantizeWeights(); // weights have changed since they were quantized
         output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/, 1.0f, this->m_pQuantizedMultiplier);
     }
 
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
+        if (m_quantizedInference)
+            LogicError("%ls %ls operation: Gradients cannot be computed once quantized inference has been enabled.", NodeName().c_str(), OperationName().c_str());
+
         // special treatment if A is minibatch data; see Forward() for comment
         if (!fr.IsOneColumnWrt(InputRef(0).GetMBLayout()))
         {
@@ -1065,6 +1081,58 @@ public:
     size_t OutputRank() const { return m_outputRank; }
     int InferInputRankToMap() const { return m_inferInputRankToMap; }
 
+    // Switches this product to integer arithmetic for inference on the CPU (see QuantizedMultiplier).
+    // The weights (first input) are quantized right away, and again only if their values change;
+    // the data (second input) is quantized on the fly in each ForwardProp().
+    // Only dense, non-transposed products of a LearnableParameter with data on the CPU can be switched. Returns false,
+    // leaving the node unchanged, for any other product, and otherwise how much quantization changed the weights.
+    // Gradients cannot be computed afterwards.
+    // With a cache, networks that share the weights (e.g. clones with shared parameters) also share their quantized copy;
+    // should the weights of this network change, it quantizes them into a copy of its own.
+    bool EnableQuantizedInference(QuantizedPrecision precision, size_t bitShiftA, size_t bitShiftB, QuantizationError& weightError,
+                                  const shared_ptr<QuantizedWeightsCache>& cache = nullptr)
+    {
+        if (m_transpose || m_pQuantizedMultiplier || m_inferInputRankToMap == ReduceSequenceAxisWithoutInferredInputRank ||
+            Base::GetDeviceId() != CPUDEVICE || !dynamic_pointer_cast<LearnableParameter<ElemType>>(Input(0)) ||
+            InputRef(0).Value().GetMatrixType() != MatrixType::DENSE)
+            return false;
+
+        m_quantizedInference = true;
+        if (!cache)
+        {
+            m_pQuantizedMultiplier = make_shared<QuantizedMultiplier<ElemType>>(precision, bitShiftA, bitShiftB);
+            weightError = QuantizeWeights();
+            return true;
+        }
+
+        const auto& weights = InputRef(0).Value();
+        const size_t numRows = NumQuantizedWeightRows();
+        m_quantizedWeightsTimeStamp = InputRef(0).GetEvalTimeStamp();
+        m_pQuantizedMultiplier = cache->CreateMultiplier(precision, bitShiftA, bitShiftB, (int)numRows, (int)(weights.GetNumElements() / numRows), weights.Data(), weightError);
+        return true;
+    }
+
+    bool IsQuantizedInferenceEnabled() const { return m_quantizedInference; }
+
+private:
+    // The product flattens the weights into a matrix of [output dims x reduced dims], see TensorView::DoMatrixProductOf().
+    size_t NumQuantizedWeightRows() const
+    {
+        const auto& weightShape = InputRef(0).GetSampleLayout();
+        size_t numRows = 1;
+        for (size_t i = 0; i < m_outputRank && i < weightShape.GetRank(); i++)
+            numRows *= weightShape[i];
+        return numRows;
+    }
+
+    QuantizationError QuantizeWeights()
+    {
+        const auto& weights = InputRef(0).Value();
+        const size_t numRows = NumQuantizedWeightRows();
+        m_quantizedWeightsTimeStamp = InputRef(0).GetEvalTimeStamp();
+        return m_pQuantizedMultiplier->SetConstantA((int)numRows, (int)(weights.GetNumElements() / numRows), weights.Data());
+    }
+
 protected: 
     shared_ptr<QuantizedMultiplier<ElemType>> m_pQuantizedMultiplier;
 
@@ -1073,6 +1141,8 @@ private:
     int m_inferInputRankToMap;  // -1 (not specified) or says how to expand shape of W, to keep this many mapping dims
     bool m_beingUnrolled;
     std::once_flag m_unrollWarningOnceFlag;
+    bool m_quantizedInference;             // set by EnableQuantizedInference()
+    uint64_t m_quantizedWeightsTimeStamp;  // eval time stamp of the weights when they were last quantized (per network, not thread-safe)
 
     bool ReduceSequenceAxis() const { return m_inferInputRankToMap == ReduceSequenceAxisWithoutInferredInputRank; }
 
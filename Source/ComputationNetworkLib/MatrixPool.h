@@ -38,6 +38,7 @@ struct MemRequestInfo
         pMatrixPtrs.push_back(pMatrixPtr);
     }
     void SetReleaseStep(int step) { releaseStep = step; }
+    size_t GetSize(size_t mbNumCols) const { return mbScale ? matrixSize * mbNumCols : matrixSize; } // number of elements for a given minibatch size
     void SetMemoryId(int id) { memoryId = id;  }
 };
 
@@ -50,6 +51,16 @@ struct greater_than_mem_req_size
     }
 };
 
+// a matrix that is placed in the contiguous buffer of its element type and device, see MatrixPool::RequestContiguousAllocate()
+template <class ElemType>
+struct ContiguousRequestInfo
+{
+    DEVICEID_TYPE deviceId;
+    shared_ptr<Matrix<ElemType>>* pMatrixPtr;
+    size_t numRows;
+    size_t numCols;
+};
+
 struct MemAllocInfo
 {
     int memoryId; 
@@ -73,11 +84,18 @@ protected:
     vector<MemRequestInfo<float>> m_memRequestInfoFloatVec; 
     vector<MemRequestInfo<double>> m_memRequestInfoDoubleVec;
     vector<MemRequestInfo<half>> m_memRequestInfoHalfVec;
+    vector<ContiguousRequestInfo<float>> m_contiguousRequestInfoFloatVec;
+    vector<ContiguousRequestInfo<double>> m_contiguousRequestInfoDoubleVec;
+    vector<ContiguousRequestInfo<half>> m_contiguousRequestInfoHalfVec;
     set<DEVICEID_TYPE> m_deviceIDSet; 
     int m_stepCounter; 
+    size_t m_plannedMBNumCols;  // minibatch size (in columns) the current sharing plan was made for; 0 if the plan only used estimates
+    size_t m_plannedBytes;      // total size of all buffers of the current plan, only meaningful if m_plannedMBNumCols > 0
 
     template <class ElemType>
     vector<MemRequestInfo<ElemType>>& GetMemRequestInfoVec();
+    template <class ElemType>
+    vector<ContiguousRequestInfo<ElemType>>& GetContiguousRequestInfoVec();
 
     // MatrixPool allows a bunch of node to share one matrix
 
@@ -97,9 +115,23 @@ protected:
 
 public:
 
+    MatrixPool()
+        : m_stepCounter(0), m_plannedMBNumCols(0), m_plannedBytes(0)
+    {
+    }
+
     void Reset()
     {
         m_stepCounter = 0;
+        m_plannedMBNumCols = 0;
+        m_plannedBytes = 0;
+        m_memRequestInfoFloatVec.clear();
+        m_memRequestInfoDoubleVec.clear();
+        m_memRequestInfoHalfVec.clear();
+        m_contiguousRequestInfoFloatVec.clear();
+        m_contiguousRequestInfoDoubleVec.clear();
+        m_contiguousRequestInfoHalfVec.clear();
+        m_deviceIDSet.clear();
         m_aliasGroups.clear();
         m_aliasLookup.clear();
     };
@@ -147,6 +179,34 @@ public:
         *pMatrixPtr = make_shared<Matrix<ElemType>>(deviceId);
     }
 
+    // Requests a matrix of fixed size that does not take part in memory sharing. Instead, all such matrices of the same element type
+    // and device are placed one after the other, in the order of the requests, in a single buffer, and each matrix is a view into it.
+    // This is used for the gradients of learnable parameters: gradient aggregation can then reduce runs of them with one MPI call each
+    // (see FormGradientBuckets()). The matrices must never be resized. Repeated requests for the same matrix are ignored.
+    template <class ElemType>
+    void RequestContiguousAllocate(DEVICEID_TYPE deviceId, shared_ptr<Matrix<ElemType>>* pMatrixPtr, size_t numRows, size_t numCols)
+    {
+        auto& requests = GetContiguousRequestInfoVec<ElemType>();
+        if (find_if(requests.begin(), requests.end(), [pMatrixPtr](const ContiguousRequestInfo<ElemType>& r) { return r.pMatrixPtr == pMatrixPtr; }) != requests.end())
+            return;
+
+        requests.push_back({ deviceId, pMatrixPtr, numRows, numCols });
+        m_deviceIDSet.insert(deviceId);
+        m_stepCounter++;
+
+        // assign a temporary pointer, it will be replaced by AllocateContiguousMatrices()
+        *pMatrixPtr = make_shared<Matrix<ElemType>>(deviceId);
+    }
+
+    // Allocates the buffers for the requests made through RequestContiguousAllocate(). Unlike the shared buffers, they are allocated
+    // only once, since their sizes do not depend on the minibatch size.
+    void AllocateContiguousMatrices()
+    {
+        AllocateContiguousMatricesFunc<float>();
+        AllocateContiguousMatricesFunc<double>();
+        AllocateContiguousMatricesFunc<half>();
+    }
+
     void OptimizedMemoryAllocation()
     {
         // MatrixPool is not templated, so we call both float and double versions here 
@@ -156,6 +216,27 @@ public:
         return; 
     }
 
+    // Re-plans memory sharing once the actual minibatch size is known, i.e. when the first minibatch arrives,
+    // and again whenever a larger minibatch shows up. mbNumCols is the largest number of columns over all
+    // MBLayouts fed into the network. With the minibatch size known, the sizes of all mbScale requests are
+    // exact, so their [allocStep, releaseStep] lifetimes can be packed into the shared buffers by best fit
+    // rather than by the per-sample size estimates used by the initial plan.
+    // Must only be called between minibatches, since pooled matrices are rebound and their content is lost.
+    // Returns true if a new plan was made.
+    bool UpdateMinibatchSize(size_t mbNumCols)
+    {
+        if (mbNumCols <= m_plannedMBNumCols)
+            return false;
+
+        m_plannedMBNumCols = mbNumCols;
+        m_plannedBytes = 0;
+        OptimizedMemoryAllocation();
+        return true;
+    }
+
+    size_t GetPlannedMinibatchNumCols() const { return m_plannedMBNumCols; }
+    size_t GetPlannedBytes() const { return m_plannedBytes; }
+
     void SetAliasInfo(
         const unordered_map<AliasNodePtr, unordered_set<AliasNodePtr>>& groupMap,
         const unordered_map<AliasNodePtr, AliasNodePtr>& rootLookupMap)
@@ -247,6 +328,41 @@ private:
         return bRet;
     }
 
+    template <class ElemType>
+    void AllocateContiguousMatricesFunc()
+    {
+        const auto& requests = GetContiguousRequestInfoVec<ElemType>();
+        for (auto& devId : m_deviceIDSet)
+        {
+            size_t totalSize = 0;
+            for (const auto& request : requests)
+            {
+                if (request.deviceId == devId)
+                    totalSize += request.numRows * request.numCols;
+            }
+
+            if (totalSize == 0)
+                continue;
+
+            Matrix<ElemType> buffer(1, totalSize, devId);
+            buffer.SetValue(0);
+
+            // the views share the storage of the buffer, which lives as long as any of them
+            size_t offset = 0;
+            for (const auto& request : requests)
+            {
+                if (request.deviceId != devId)
+                    continue;
+
+                size_t size = request.numRows * request.numCols;
+                auto view = make_shared<Matrix<ElemType>>(buffer.ColumnSlice(offset, size));
+                view->Reshape(request.numRows, request.numCols);
+                *request.pMatrixPtr = view;
+                offset += size;
+            }
+        }
+    }
+
     template <class ElemType>
     void OptimizedMemoryAllocationFunc()
     {
@@ -268,110 +384,41 @@ private:
             }
 
             if (hasSparse)
-                memInfoVec.erase(iter);
+                iter = memInfoVec.erase(iter);
             else
                 iter++; 
         }
 
-        // sort the memory request from largest size to smallest 
-        std::sort(memInfoVec.begin(), memInfoVec.end(), greater_than_mem_req_size<ElemType>());
+        if (m_plannedMBNumCols == 0)
+        {
+            // sort the memory request from largest size to smallest 
+            std::sort(memInfoVec.begin(), memInfoVec.end(), greater_than_mem_req_size<ElemType>());
+        }
+        else
+        {
+            // same, but by the actual size for the planned minibatch size
+            const size_t mbNumCols = m_plannedMBNumCols;
+            std::stable_sort(memInfoVec.begin(), memInfoVec.end(), [mbNumCols](const MemRequestInfo<ElemType>& info1, const MemRequestInfo<ElemType>& info2)
+            {
+                return info1.GetSize(mbNumCols) > info2.GetSize(mbNumCols);
+            });
+        }
 
         std::vector<bool> workspaceFlagVec = {true, false};
         for (auto& devId : m_deviceIDSet)
         {
             for (auto wsFlag : workspaceFlagVec)   // we allocate the workspace memory pointers first, and they are not shared with the non-workspace memory requests
             {
-                // memAllocInfoVec is a sorted list of memory allocations from smallest to largest in memory size 
-                vector<MemAllocInfo> memAllocInfoVec;
-                int memoryCounter = 0;
-                // we start with memory request that is scalable with minibatch size(usually those require larger memory size)
-                for (auto& memInfo : memInfoVec)
-                {
-                    // check if it's the proper device
-                    if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || !memInfo.mbScale)
-                        continue;
-
-                    if (!memAllocInfoVec.empty())
-                    {
-                        // since we assign from highest memory to lowest, every memory that has been allocated can accommodate the 
-                        // current memory request, unless there is a conflict (overlap) 
-                        auto iter = memAllocInfoVec.begin();
-                        while (iter != memAllocInfoVec.end() && CheckOverlap(make_pair(memInfo.allocStep, memInfo.releaseStep), iter->occupancy))
-                            iter++;
-                        if (iter == memAllocInfoVec.end())
-                        {
-                            // no current memory can be assigned, need to create a new one 
-                            vector<pair<int, int>> occ;
-                            occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                            MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
-                            // insert in the front of the vector to maintain sorted order 
-                            memAllocInfoVec.insert(memAllocInfoVec.begin(), ma);
-                            memInfo.SetMemoryId(memoryCounter);
-                            memoryCounter++;
-                        }
-                        else
-                        {
-                            iter->occupancy.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                            memInfo.SetMemoryId(iter->memoryId);
-                        }
-                    }
-                    else
-                    {
-                        vector<pair<int, int>> occ;
-                        occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                        MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
-                        memAllocInfoVec.push_back(ma);
-                        memInfo.SetMemoryId(memoryCounter);
-                        memoryCounter++;
-                    }
-                }
-
-                // rescan the request list and this time allocate for those that doesn't depend on minibatch size 
-                for (auto& memInfo : memInfoVec)
-                {
-                    // check if it's the proper device
-                    if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || memInfo.mbScale)
-                        continue;
-
-                    if (!memAllocInfoVec.empty())
-                    {
-                        // the memory allocation vector is sorted by size. We find the largest available buffer that doesn't have time overlap
-                        auto workingAlloc = memAllocInfoVec.end();
-                        for (auto iter = memAllocInfoVec.begin(); iter != memAllocInfoVec.end(); iter++)
-                        {
-                            if (!CheckOverlap(make_pair(memInfo.allocStep, memInfo.releaseStep), iter->occupancy))
-                                workingAlloc = iter;
-                        }
-                        if (workingAlloc == memAllocInfoVec.end())  // nothing works 
-                        {
-                            vector<pair<int, int>> occ;
-                            occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                            MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
-                            memAllocInfoVec.push_back(ma);  // add as the last one 
-                            memInfo.SetMemoryId(memoryCounter);
-                            memoryCounter++;
-                        }
-                        else
-                        {
-                            workingAlloc->occupancy.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                            memInfo.SetMemoryId(workingAlloc->memoryId);
-                        }
-                    }
-                    else
-                    {
-                        vector<pair<int, int>> occ;
-                        occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                        MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
-                        memAllocInfoVec.push_back(ma);
-                        memInfo.SetMemoryId(memoryCounter);
-                        memoryCounter++;
-                    }
-                }
+                // matrices that stay bound to a buffer (indexed by memory id), instead of getting a fresh one
+                vector<shared_ptr<Matrix<ElemType>>> pinnedMatrices;
+                int memoryCounter = (m_plannedMBNumCols == 0)
+                                  ? AssignMemoryIdsFromEstimates(memInfoVec, devId, wsFlag)
+                                  : AssignMemoryIdsBestFit(memInfoVec, devId, wsFlag, pinnedMatrices);
 
                 // now assign the actual pointers 
                 for (int i = 0; i < memoryCounter; i++)
                 {
-                    auto matrixPtr = make_shared<Matrix<ElemType>>(devId);
+                    auto matrixPtr = (i < pinnedMatrices.size() && pinnedMatrices[i]) ? pinnedMatrices[i] : make_shared<Matrix<ElemType>>(devId);
                     if (!matrixPtr) // this can't really happen, because we haven't started allocating memory yet
                         LogicError("MatrixPool: failed to get a valid matrix.");
                     for (auto& memInfo : memInfoVec)
@@ -388,6 +435,173 @@ private:
             }
         }
     }
+
+    // initial plan, made before the minibatch size is known: matrixSize is only a per-sample estimate, so the requests that scale with
+    // the minibatch size are assumed to be the larger ones and are assigned first
+    // Returns the number of buffers; memory ids are stored in the requests.
+    template <class ElemType>
+    int AssignMemoryIdsFromEstimates(vector<MemRequestInfo<ElemType>>& memInfoVec, DEVICEID_TYPE devId, bool wsFlag)
+    {
+        // memAllocInfoVec is a sorted list of memory allocations from smallest to largest in memory size 
+        vector<MemAllocInfo> memAllocInfoVec;
+        int memoryCounter = 0;
+        // we start with memory request that is scalable with minibatch size(usually those require larger memory size)
+        for (auto& memInfo : memInfoVec)
+        {
+            // check if it's the proper device
+            if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || !memInfo.mbScale)
+                continue;
+
+            if (!memAllocInfoVec.empty())
+            {
+                // since we assign from highest memory to lowest, every memory that has been allocated can accommodate the 
+                // current memory request, unless there is a conflict (overlap) 
+                auto iter = memAllocInfoVec.begin();
+                while (iter != memAllocInfoVec.end() && CheckOverlap(make_pair(memInfo.allocStep, memInfo.releaseStep), iter->occupancy))
+                    iter++;
+                if (iter == memAllocInfoVec.end())
+                {
+                    // no current memory can be assigned, need to create a new one 
+                    vector<pair<int, int>> occ;
+                    occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                    MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                    // insert in the front of the vector to maintain sorted order 
+                    memAllocInfoVec.insert(memAllocInfoVec.begin(), ma);
+                    memInfo.SetMemoryId(memoryCounter);
+                    memoryCounter++;
+                }
+                else
+                {
+                    iter->occupancy.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                    memInfo.SetMemoryId(iter->memoryId);
+                }
+            }
+            else
+            {
+                vector<pair<int, int>> occ;
+                occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                memAllocInfoVec.push_back(ma);
+                memInfo.SetMemoryId(memoryCounter);
+                memoryCounter++;
+            }
+        }
+
+        // rescan the request list and this time allocate for those that doesn't depend on minibatch size 
+        for (auto& memInfo : memInfoVec)
+        {
+            // check if it's the proper device
+            if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || memInfo.mbScale)
+                continue;
+
+            if (!memAllocInfoVec.empty())
+            {
+                // the memory allocation vector is sorted by size. We find the largest available buffer that doesn't have time overlap
+                auto workingAlloc = memAllocInfoVec.end();
+                for (auto iter = memAllocInfoVec.begin(); iter != memAllocInfoVec.end(); iter++)
+                {
+                    if (!CheckOverlap(make_pair(memInfo.allocStep, memInfo.releaseStep), iter->occupancy))
+                        workingAlloc = iter;
+                }
+                if (workingAlloc == memAllocInfoVec.end())  // nothing works 
+                {
+                    vector<pair<int, int>> occ;
+                    occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                    MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                    memAllocInfoVec.push_back(ma);  // add as the last one 
+                    memInfo.SetMemoryId(memoryCounter);
+                    memoryCounter++;
+                }
+                else
+                {
+                    workingAlloc->occupancy.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                    memInfo.SetMemoryId(workingAlloc->memoryId);
+                }
+            }
+            else
+            {
+                vector<pair<int, int>> occ;
+                occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                memAllocInfoVec.push_back(ma);
+                memInfo.SetMemoryId(memoryCounter);
+                memoryCounter++;
+            }
+        }
+
+        return memoryCounter;
+    }
+
+    // plan for a known minibatch size: best-fit packing of the request lifetimes into buffers
+    // Requests are visited from largest to smallest actual size. Each one goes into the smallest buffer that is large enough
+    // and whose occupancy doesn't overlap with the request's [allocStep, releaseStep]; if none is large enough, the largest
+    // non-overlapping buffer is grown. Requests that are never released (e.g. gradients of learnable parameters, outputs of root nodes)
+    // keep their current matrix, since other components (learners, aggregators, readers of the outputs) may hold on to it.
+    // Returns the number of buffers; memory ids are stored in the requests.
+    template <class ElemType>
+    int AssignMemoryIdsBestFit(vector<MemRequestInfo<ElemType>>& memInfoVec, DEVICEID_TYPE devId, bool wsFlag, vector<shared_ptr<Matrix<ElemType>>>& pinnedMatrices)
+    {
+        vector<MemAllocInfo> memAllocInfoVec; // indexed by memory id
+        pinnedMatrices.clear();
+
+        // the pinned buffers come first
+        for (auto& memInfo : memInfoVec)
+        {
+            if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || memInfo.releaseStep != INT_MAX)
+                continue;
+
+            vector<pair<int, int>> occ;
+            occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+            memAllocInfoVec.push_back(MemAllocInfo((int)memAllocInfoVec.size(), memInfo.GetSize(m_plannedMBNumCols), occ));
+            pinnedMatrices.push_back(*memInfo.pMatrixPtrs[0]);
+            memInfo.SetMemoryId(memAllocInfoVec.back().memoryId);
+        }
+
+        for (auto& memInfo : memInfoVec)
+        {
+            if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || memInfo.releaseStep == INT_MAX)
+                continue;
+
+            auto occ = make_pair(memInfo.allocStep, memInfo.releaseStep);
+            size_t size = memInfo.GetSize(m_plannedMBNumCols);
+
+            MemAllocInfo* bestFit = nullptr;
+            for (auto& memAlloc : memAllocInfoVec)
+            {
+                if (CheckOverlap(occ, memAlloc.occupancy))
+                    continue;
+
+                if (bestFit == nullptr)
+                    bestFit = &memAlloc;
+                else if (bestFit->memorySize < size) // nothing large enough yet: prefer a larger one
+                {
+                    if (memAlloc.memorySize > bestFit->memorySize)
+                        bestFit = &memAlloc;
+                }
+                else if (memAlloc.memorySize >= size && memAlloc.memorySize < bestFit->memorySize) // prefer the tightest fit
+                    bestFit = &memAlloc;
+            }
+
+            if (bestFit == nullptr) // nothing works
+            {
+                vector<pair<int, int>> newOcc;
+                newOcc.push_back(occ);
+                memAllocInfoVec.push_back(MemAllocInfo((int)memAllocInfoVec.size(), size, newOcc));
+                memInfo.SetMemoryId(memAllocInfoVec.back().memoryId);
+            }
+            else
+            {
+                bestFit->occupancy.push_back(occ);
+                bestFit->memorySize = max(bestFit->memorySize, size);
+                memInfo.SetMemoryId(bestFit->memoryId);
+            }
+        }
+
+        for (const auto& memAlloc : memAllocInfoVec)
+            m_plannedBytes += memAlloc.memorySize * sizeof(ElemType);
+
+        return (int)memAllocInfoVec.size();
+    }
 };
 
 }}}
@@ -0,0 +1,368 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "stdafx.h"
+#include "NodeCostReport.h"
+#include "ComputationNode.h"
+#include <algorithm>
+#include <map>
+#include <math.h>
+#ifndef CPUONLY
+#include <cuda_runtime_api.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// How the cost of an operation scales with the shapes of its inputs and output.
+enum class NodeCostKind
+{
+    Elementwise,     // a few operations per output element
+    Transcendental,  // elementwise, with a transcendental function per output element
+    MatrixProduct,   // 2 operations per multiply-add of an inner product
+    Convolution,     // 2 operations per multiply-add of the kernel
+    Reduction,       // an operation per input element
+    Normalization,   // a few passes over the input elements
+    DataMovement     // no arithmetic, only copies
+};
+
+static NodeCostKind GetNodeCostKind(const std::wstring& operationName)
+{
+    static const std::map<std::wstring, NodeCostKind> kinds =
+    {
+        { L"Times", NodeCostKind::MatrixProduct },
+        { L"TransposeTimes", NodeCostKind::MatrixProduct },
+        { L"OptimizedRNNStack", NodeCostKind::MatrixProduct },
+        { L"Convolution", NodeCostKind::Convolution },
+
+        { L"Exp", NodeCostKind::Transcendental },
+        { L"Log", NodeCostKind::Transcendental },
+        { L"Sigmoid", NodeCostKind::Transcendental },
+        { L"StableSigmoid", NodeCostKind::Transcendental },
+        { L"Tanh", NodeCostKind::Transcendental },
+        { L"Sqrt", NodeCostKind::Transcendental },
+        { L"Pow", NodeCostKind::Transcendental },
+        { L"Softmax", NodeCostKind::Transcendental },
+        { L"LogSoftmax", NodeCostKind::Transcendental },
+        { L"LogPlus", NodeCostKind::Transcendental },
+        { L"ExponentialLinearUnit", NodeCostKind::Transcendental },
+        { L"Cosine", NodeCostKind::Transcendental },
+        { L"Sin", NodeCostKind::Transcendental },
+        { L"Tan", NodeCostKind::Transcendental },
+        { L"Acos", NodeCostKind::Transcendental },
+        { L"Asin", NodeCostKind::Transcendental },
+        { L"Atan", NodeCostKind::Transcendental },
+        { L"Cosh", NodeCostKind::Transcendental },
+        { L"Sinh", NodeCostKind::Transcendental },
+        { L"Asinh", NodeCostKind::Transcendental },
+        { L"Atanh", NodeCostKind::Transcendental },
+
+        { L"Pooling", NodeCostKind::Reduction },
+        { L"MaxUnpooling", NodeCostKind::Reduction },
+        { L"ROIPooling", NodeCostKind::Reduction },
+        { L"ReduceElements", NodeCostKind::Reduction },
+        { L"SumColumnElements", NodeCostKind::Reduction },
+        { L"CrossEntropyWithSoftmax", NodeCostKind::Reduction },
+        { L"ClassificationError", NodeCostKind::Reduction },
+        { L"SquareError", NodeCostKind::Reduction },
+        { L"Logistic", NodeCostKind::Reduction },
+        { L"CosDistance", NodeCostKind::Reduction },
+        { L"MatrixL2Reg", NodeCostKind::Reduction },
+
+        { L"BatchNormalization", NodeCostKind::Normalization },
+
+        { L"Reshape", NodeCostKind::DataMovement },
+        { L"Slice", NodeCostKind::DataMovement },
+        { L"RowStack", NodeCostKind::DataMovement },
+        { L"RowRepeat", NodeCostKind::DataMovement },
+        { L"TransposeDimensions", NodeCostKind::DataMovement },
+        { L"Crop", NodeCostKind::DataMovement },
+        { L"PastValue", NodeCostKind::DataMovement },
+        { L"FutureValue", NodeCostKind::DataMovement },
+        { L"GatherPacked", NodeCostKind::DataMovement },
+        { L"ScatterPacked", NodeCostKind::DataMovement },
+        { L"PackedIndex", NodeCostKind::DataMovement },
+        { L"Where", NodeCostKind::DataMovement },
+        { L"ReconcileDynamicAxis", NodeCostKind::DataMovement },
+        { L"ToSequence", NodeCostKind::DataMovement },
+        { L"ToSequenceLike", NodeCostKind::DataMovement },
+        { L"UnpackSequence", NodeCostKind::DataMovement },
+        { L"Pass", NodeCostKind::DataMovement },
+        { L"StopGradient", NodeCostKind::DataMovement },
+        { L"Assign", NodeCostKind::DataMovement },
+        { L"Cast", NodeCostKind::DataMovement },
+    };
+
+    auto kind = kinds.find(operationName);
+    return kind == kinds.end() ? NodeCostKind::Elementwise : kind->second;
+}
+
+// Number of columns that a call over the frame range processes.
+static double NumColumns(const ComputationNodeBase& node, const FrameRange& fr)
+{
+    if (!node.HasMBLayout())
+        return 1;
+
+    if (fr.IsAllFrames())
+        return (double)node.GetSampleMatrixNumCols();
+
+    double parallelSequences = fr.seqIndex == SIZE_MAX ? (double)node.GetNumParallelSequences() : 1;
+    return parallelSequences * fr.m_timeRange;
+}
+
+NodeCostEstimate EstimateNodeCost(const ComputationNodeBase& node, const FrameRange& fr, bool backward, size_t elementSize)
+{
+    double columns = NumColumns(node, fr);
+    double outputSampleElements = (double)node.GetSampleLayout().GetNumElements();
+    double outputElements = outputSampleElements * columns;
+
+    // Inputs without a dynamic axis, such as parameters, are used as a whole by every call.
+    std::vector<double> inputElements(node.GetNumInputs());
+    double totalInputElements = 0;
+    double gradientInputElements = 0;
+    size_t numInputsNeedingGradient = 0;
+    for (size_t i = 0; i < node.GetNumInputs(); i++)
+    {
+        const auto& input = node.Input(i);
+        inputElements[i] = (double)input->GetSampleLayout().GetNumElements() * (input->HasMBLayout() ? columns : 1);
+        totalInputElements += inputElements[i];
+        if (input->NeedsGradient())
+        {
+            gradientInputElements += inputElements[i];
+            numInputsNeedingGradient++;
+        }
+    }
+
+    double flops;
+    switch (GetNodeCostKind(node.OperationName()))
+    {
+    case NodeCostKind::MatrixProduct:
+    {
+        // For [M x K] * [K x N] -> [M x N], the sample sizes multiply to M K * K N = K^2 * M N.
+        double innerDimension = 0;
+        if (node.GetNumInputs() >= 2 && outputSampleElements > 0)
+        {
+            double product = (double)node.Input(0)->GetSampleLayout().GetNumElements() * (double)node.Input(1)->GetSampleLayout().GetNumElements();
+            innerDimension = sqrt(product / outputSampleElements);
+        }
+        else if (node.GetNumInputs() >= 1 && outputSampleElements > 0)
+        {
+            // A recurrent stack: every weight is used once per column.
+            innerDimension = (double)node.Input(0)->GetSampleLayout().GetNumElements() / outputSampleElements;
+        }
+        flops = 2 * innerDimension * outputElements;
+        break;
+    }
+    case NodeCostKind::Convolution:
+    {
+        // Every output element is an inner product with a kernel of (kernel elements / output channels) weights.
+        const auto& outputShape = node.GetSampleLayout();
+        double outputChannels = outputShape.GetRank() > 0 ? (double)outputShape[outputShape.GetRank() - 1] : 1;
+        double kernelElements = node.GetNumInputs() >= 1 ? (double)node.Input(0)->GetSampleLayout().GetNumElements() : 0;
+        flops = 2 * kernelElements / std::max(outputChannels, 1.0) * outputElements;
+        break;
+    }
+    case NodeCostKind::Transcendental:
+        flops = 8 * outputElements;
+        break;
+    case NodeCostKind::Reduction:
+        flops = totalInputElements;
+        break;
+    case NodeCostKind::Normalization:
+        flops = 5 * totalInputElements;
+        break;
+    case NodeCostKind::DataMovement:
+        flops = 0;
+        break;
+    case NodeCostKind::Elementwise:
+    default:
+        flops = outputElements * std::max<size_t>(node.GetNumInputs(), 2) / 2;
+        break;
+    }
+
+    NodeCostEstimate estimate;
+    if (!backward)
+    {
+        // Read the inputs, write the output.
+        estimate.m_flops = flops;
+        estimate.m_bytes = (totalInputElements + outputElements) * elementSize;
+    }
+    else
+    {
+        // Read the output gradient and the inputs, update the input gradients.
+        estimate.m_flops = flops * numInputsNeedingGradient;
+        estimate.m_bytes = (outputElements + totalInputElements + 2 * gradientInputElements) * elementSize;
+    }
+    return estimate;
+}
+
+void SynchronizeDeviceForNodeCost(DEVICEID_TYPE deviceId)
+{
+#ifndef CPUONLY
+    if (deviceId >= 0)
+        cudaDeviceSynchronize();
+#else
+    UNUSED(deviceId);
+#endif
+}
+
+// -----------------------------------------------------------------------
+// report
+// -----------------------------------------------------------------------
+
+// Values of a phase of a node per minibatch, and derived rates.
+struct NodeCostSummary
+{
+    double m_seconds;
+    double m_flops;
+    double m_bytes;
+
+    NodeCostSummary(const NodeCostStatistics& forward, const NodeCostStatistics& backward, size_t numMinibatches)
+    {
+        double scale = 1.0 / std::max<size_t>(numMinibatches, 1);
+        m_seconds = (forward.m_seconds + backward.m_seconds) * scale;
+        m_flops = (forward.m_flops + backward.m_flops) * scale;
+        m_bytes = (forward.m_bytes + backward.m_bytes) * scale;
+    }
+
+    double GFlopsPerSecond() const { return m_seconds > 0 ? m_flops / m_seconds * 1e-9 : 0; }
+    double GBytesPerSecond() const { return m_seconds > 0 ? m_bytes / m_seconds * 1e-9 : 0; }
+    double Intensity() const { return m_bytes > 0 ? m_flops / m_bytes : 0; }
+
+    // Attainable GFLOP/s at this arithmetic intensity, and the resource that limits it.
+    double Roof(const NodeCostRoofline& roofline) const { return std::min(roofline.m_peakGFlops, Intensity() * roofline.m_peakGBps); }
+    bool IsMemoryBound(const NodeCostRoofline& roofline) const { return Intensity() * roofline.m_peakGBps < roofline.m_peakGFlops; }
+
+    // Fraction of the roof that is reached; for nodes without arithmetic, the fraction of the memory bandwidth.
+    double Efficiency(const NodeCostRoofline& roofline) const
+    {
+        if (m_flops == 0)
+            return GBytesPerSecond() / roofline.m_peakGBps;
+        double roof = Roof(roofline);
+        return roof > 0 ? GFlopsPerSecond() / roof : 0;
+    }
+};
+
+static void SortByTotalTime(std::vector<NodeCostReportEntry>& entries)
+{
+    std::stable_sort(entries.begin(), entries.end(), [](const NodeCostReportEntry& a, const NodeCostReportEntry& b)
+    {
+        return a.m_forward.m_seconds + a.m_backward.m_seconds > b.m_forward.m_seconds + b.m_backward.m_seconds;
+    });
+}
+
+static double TotalSeconds(const std::vector<NodeCostReportEntry>& entries)
+{
+    double seconds = 0;
+    for (const auto& entry : entries)
+        seconds += entry.m_forward.m_seconds + entry.m_backward.m_seconds;
+    return seconds;
+}
+
+void PrintNodeCostReport(FILE* f, std::vector<NodeCostReportEntry> entries, size_t numMinibatches, const NodeCostRoofline& roofline)
+{
+    SortByTotalTime(entries);
+    double totalSeconds = TotalSeconds(entries);
+    bool hasRoofline = roofline.m_peakGFlops > 0 && roofline.m_peakGBps > 0;
+
+    fprintf(f, "\nNode cost report: %d nodes, %d minibatches, %.3f ms per minibatch", (int)entries.size(), (int)numMinibatches,
+            totalSeconds * 1000 / std::max<size_t>(numMinibatches, 1));
+    if (hasRoofline)
+        fprintf(f, ", roofline for %.1f GFLOP/s and %.1f GB/s (ridge at %.2f FLOP/byte)", roofline.m_peakGFlops, roofline.m_peakGBps, roofline.m_peakGFlops / roofline.m_peakGBps);
+    fprintf(f, "\n\n");
+
+    fprintf(f, "%-30s %-22s %7s %10s %10s %10s %10s %10s %9s %9s %10s", "Node", "Operation", "Time%", "Fwd ms", "Bwd ms", "MFLOP", "MB moved", "FLOP/B", "GFLOP/s", "GB/s", "Matrix MB");
+    if (hasRoofline)
+        fprintf(f, " %7s %6s", "Bound", "Roof%");
+    fprintf(f, "\n");
+
+    double scale = 1.0 / std::max<size_t>(numMinibatches, 1);
+    for (const auto& entry : entries)
+    {
+        NodeCostSummary summary(entry.m_forward, entry.m_backward, numMinibatches);
+        fprintf(f, "%-30ls %-22ls %6.2f%% %10.3f %10.3f %10.3f %10.3f %10.3f %9.2f %9.2f %10.2f",
+                entry.m_nodeName.c_str(),
+                entry.m_operationName.c_str(),
+                totalSeconds > 0 ? 100 * (entry.m_forward.m_seconds + entry.m_backward.m_seconds) / totalSeconds : 0.0,
+                entry.m_forward.m_seconds * scale * 1000,
+                entry.m_backward.m_seconds * scale * 1000,
+                summary.m_flops * 1e-6,
+                summary.m_bytes * 1e-6,
+                summary.Intensity(),
+                summary.GFlopsPerSecond(),
+                summary.GBytesPerSecond(),
+                std::max(entry.m_forward.m_matrixBytes, entry.m_backward.m_matrixBytes) / (1024.0 * 1024.0));
+        if (hasRoofline)
+            fprintf(f, " %7s %5.1f%%", summary.IsMemoryBound(roofline) ? "memory" : "compute", 100 * summary.Efficiency(roofline));
+        fprintf(f, "\n");
+    }
+    fprintf(f, "\n");
+}
+
+static std::string JsonString(const std::wstring& str)
+{
+    std::string json = "\"";
+    for (char c : ToLegacyString(ToUTF8(str)))
+    {
+        if (c == '"' || c == '\\')
+            json += '\\';
+        if ((unsigned char)c < 0x20)
+            json += ' ';
+        else
+            json += c;
+    }
+    return json + "\"";
+}
+
+static void WriteNodeCostPhase(FILE* f, const char* phase, const NodeCostStatistics& statistics, double scale)
+{
+    fprintf(f, "\"%s\": {\"calls\": %.3f, \"seconds\": %.9g, \"flops\": %.9g, \"bytes\": %.9g, \"matrixBytes\": %llu}",
+            phase,
+            statistics.m_calls * scale,
+            statistics.m_seconds * scale,
+            statistics.m_flops * scale,
+            statistics.m_bytes * scale,
+            (unsigned long long)statistics.m_matrixBytes);
+}
+
+void WriteNodeCostReport(const std::wstring& fileName, std::vector<NodeCostReportEntry> entries, size_t numMinibatches, const NodeCostRoofline& roofline)
+{
+    SortByTotalTime(entries);
+    double totalSeconds = TotalSeconds(entries);
+    bool hasRoofline = roofline.m_peakGFlops > 0 && roofline.m_peakGBps > 0;
+
+    FILE* f = _wfopen(fileName.c_str(), L"wt");
+    if (f == nullptr)
+        RuntimeError("WriteNodeCostReport: Cannot create file '%ls'.", fileName.c_str());
+
+    // All values are per minibatch.
+    fprintf(f, "{\n  \"minibatches\": %d,\n  \"peakGFlops\": %.9g,\n  \"peakGBps\": %.9g,\n  \"nodes\": [", (int)numMinibatches, roofline.m_peakGFlops, roofline.m_peakGBps);
+    double scale = 1.0 / std::max<size_t>(numMinibatches, 1);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const auto& entry = entries[i];
+        NodeCostSummary summary(entry.m_forward, entry.m_backward, numMinibatches);
+        fprintf(f, "%s\n    {\"name\": %s, \"operation\": %s, \"timeFraction\": %.6f, ",
+                i == 0 ? "" : ",",
+                JsonString(entry.m_nodeName).c_str(),
+                JsonString(entry.m_operationName).c_str(),
+                totalSeconds > 0 ? (entry.m_forward.m_seconds + entry.m_backward.m_seconds) / totalSeconds : 0.0);
+        WriteNodeCostPhase(f, "forward", entry.m_forward, scale);
+        fprintf(f, ", ");
+        WriteNodeCostPhase(f, "backward", entry.m_backward, scale);
+        fprintf(f, ", \"intensity\": %.9g, \"gflopsPerSecond\": %.9g, \"gbytesPerSecond\": %.9g",
+                summary.Intensity(), summary.GFlopsPerSecond(), summary.GBytesPerSecond());
+        if (hasRoofline)
+            fprintf(f, ", \"bound\": \"%s\", \"rooflineEfficiency\": %.6f", summary.IsMemoryBound(roofline) ? "memory" : "compute", summary.Efficiency(roofline));
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    if (ferror(f) || fclose(f) != 0)
+        RuntimeError("WriteNodeCostReport: Error writing file '%ls'.", fileName.c_str());
+}
+
+}}}
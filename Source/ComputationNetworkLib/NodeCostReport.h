@@ -0,0 +1,74 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// NodeCostReport.h -- per-node cost accounting (wall time, FLOP and byte estimates, matrix memory) and
+// the roofline report built from it. Enabled with Globals::SetNodeCostProfiling().
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "CommonMatrix.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class ComputationNodeBase;
+class FrameRange;
+
+// Cost of one phase (forward or backward) of a node, accumulated over all calls while node cost profiling is enabled.
+// For nodes in recurrent loops, every time step is a call.
+struct NodeCostStatistics
+{
+    size_t m_calls = 0;
+    double m_seconds = 0;        // wall time, with the device synchronized before and after each call
+    double m_flops = 0;          // estimated floating point operations
+    double m_bytes = 0;          // estimated bytes read and written in the matrices of the node and its inputs
+    size_t m_matrixBytes = 0;    // largest size of the value and gradient buffers of the node after a call
+};
+
+// Estimated cost of a single call.
+struct NodeCostEstimate
+{
+    double m_flops;
+    double m_bytes;
+};
+
+// Estimates the FLOPs and bytes moved by one forward or backward call of the node over the given frame range,
+// from the operation type and the tensor shapes of the node and its inputs. The estimates are first order:
+// matrix products and convolutions count 2 operations per multiply-add, elementwise operations count 1
+// (transcendental functions a few) per output element, and reductions 1 per input element. Backprop counts the
+// forward cost once per input that needs a gradient.
+NodeCostEstimate EstimateNodeCost(const ComputationNodeBase& node, const FrameRange& fr, bool backward, size_t elementSize);
+
+// Waits until the device has finished all queued work, so wall times can be attributed to single nodes.
+void SynchronizeDeviceForNodeCost(DEVICEID_TYPE deviceId);
+
+// One line of the report: the costs of a node, per minibatch.
+struct NodeCostReportEntry
+{
+    std::wstring m_nodeName;
+    std::wstring m_operationName;
+    NodeCostStatistics m_forward;
+    NodeCostStatistics m_backward;
+};
+
+// Peak performance of the device, for the roofline. Zero means unknown.
+struct NodeCostRoofline
+{
+    double m_peakGFlops = 0;
+    double m_peakGBps = 0;
+};
+
+// Prints the entries, most expensive first, with their share of the total time, achieved GFLOP/s and GB/s,
+// arithmetic intensity and, if the peaks are known, whether they are bound by compute or memory and how close
+// they get to the roofline. Costs are divided by the number of minibatches.
+void PrintNodeCostReport(FILE* f, std::vector<NodeCostReportEntry> entries, size_t numMinibatches, const NodeCostRoofline& roofline);
+
+// Writes the same information as JSON, for further analysis.
+void WriteNodeCostReport(const std::wstring& fileName, std::vector<NodeCostReportEntry> entries, size_t numMinibatches, const NodeCostRoofline& roofline);
+
+}}}
@@ -37,7 +37,7 @@ enum GradientOperationType
 };
 
 template <class ElemType, ElementWiseOperator opForward, ElementWiseOperator opBackward, GradientOperationType opType>
-class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IdentityTransformerNode
+class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IdentityTransformerNode, public IElementwiseOperation
 {
     typedef ComputationNode<ElemType> Base;
     UsingComputationNodeMembers;
@@ -101,6 +101,15 @@ public:
     }
 
     virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return (opType != noGradient) ? ParentGradientOptimization::Overwrite : ParentGradientOptimization::None; }
+
+    virtual ElementWiseOperator ElementwiseForwardOp() const override { return opForward; }
+
+    virtual ElementWiseOperator ElementwiseGradientOp(size_t /*inputIndex*/, int& operand) const override
+    {
+        GradientOperationType opTypeHolder = opType;  // preventing pragma warning C4127
+        operand = opTypeHolder == binaryWithInputGradient ? 0 : opTypeHolder == binaryWithOutputGradient ? OutputOperand : NoOperand;
+        return opTypeHolder == noGradient ? opNone : opBackward;
+    }
 };
 
 #define UnaryElementWiseWithOpCodeNodeBaseMembers UsingComputationNodeMembersBoilerplate;
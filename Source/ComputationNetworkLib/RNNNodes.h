@@ -25,6 +25,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 // -----------------------------------------------------------------------
 // OptimizedRNNStack (weights, data)
+// Runs on cuDNN on the GPU. On the CPU, CPURNNExecutor evaluates the same
+// parameter layout, but only forward (inference) is supported there.
 // -----------------------------------------------------------------------
 
 template <class ElemType>
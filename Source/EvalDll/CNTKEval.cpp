@@ -55,6 +55,12 @@ void CNTKEvalBase<ElemType>::CreateNetwork(const std::string& networkDescription
     {
         LogicError("Unable to construct network from description");
     }
+
+    // optionally evaluate the products with weight matrices in integer arithmetic, e.g. quantizedTimes=int8
+    wstring quantizedTimes = config(L"quantizedTimes", L"");
+    if (!quantizedTimes.empty())
+        this->m_net->EnableQuantizedTimesInference(QuantizedPrecisionFromString(quantizedTimes),
+                                                   config(L"quantizedTimesBitShiftA", (size_t) 0), config(L"quantizedTimesBitShiftB", (size_t) 0));
 }
 
 
@@ -0,0 +1,211 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUFusedElementwise.cpp -- blocked, multithreaded interpreter for fused elementwise expressions (see CPUFusedElementwise.h)
+//
+
+#include "stdafx.h"
+#include "CPUFusedElementwise.h"
+#include "File.h"
+#include "TensorOps.h"
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// number of elements that are taken through all steps of a program together; the values of a few dozen steps
+// for a block stay in the L1 cache
+static const size_t s_blockSize = 256;
+
+// below this many elements, an expression is evaluated on one thread
+static const size_t s_minParallelElements = 1 << 14;
+
+static bool IsUnaryOp(ElementWiseOperator op)
+{
+    switch (op)
+    {
+#define CaseUnaryOp(oper) case ElementWiseOperator::op##oper: return true
+    ForAllUnaryOps(CaseUnaryOp);
+#undef CaseUnaryOp
+    default: return false;
+    }
+}
+
+static bool IsBinaryOp(ElementWiseOperator op)
+{
+    switch (op)
+    {
+#define CaseBinaryOp(oper) case ElementWiseOperator::op##oper: return true
+    ForAllBinaryOps(CaseBinaryOp);
+#undef CaseBinaryOp
+    default: return false;
+    }
+}
+
+void ValidateFusedElementwiseProgram(const std::vector<FusedElementwiseStep>& program, size_t numInputs)
+{
+    if (program.empty())
+        InvalidArgument("FusedElementwise: The program has no steps.");
+
+    for (size_t k = 0; k < program.size(); k++)
+    {
+        const auto& step = program[k];
+        size_t numSlots = numInputs + k; // slots that are available to the step
+        if ((step.m_numArgs == 1 && !IsUnaryOp(step.m_op)) || (step.m_numArgs == 2 && !IsBinaryOp(step.m_op)) || step.m_numArgs < 1 || step.m_numArgs > 2)
+            InvalidArgument("FusedElementwise: Step %d has operator %d, which does not take %d arguments.", (int)k, (int)step.m_op, (int)step.m_numArgs);
+
+        for (size_t j = 0; j < step.m_numArgs; j++)
+        {
+            if (step.m_args[j] >= numSlots)
+                InvalidArgument("FusedElementwise: Argument %d of step %d refers to slot %d, which is not computed yet.", (int)j, (int)k, (int)step.m_args[j]);
+
+            auto gradientOp = step.m_gradientOps[j];
+            auto gradientOperand = step.m_gradientOperands[j];
+            if (gradientOp == ElementWiseOperator::opNone)
+                continue;
+            if (gradientOperand == FusedElementwiseStep::NoOperand ? !IsUnaryOp(gradientOp) : !IsBinaryOp(gradientOp))
+                InvalidArgument("FusedElementwise: The gradient operator %d of argument %d of step %d has the wrong number of arguments.", (int)gradientOp, (int)j, (int)k);
+            if (gradientOperand != FusedElementwiseStep::NoOperand && gradientOperand > numSlots)
+                InvalidArgument("FusedElementwise: The gradient of argument %d of step %d refers to slot %d, which is not computed yet.", (int)j, (int)k, (int)gradientOperand);
+        }
+    }
+}
+
+// out[i] = op(a[i]) or op(a[i], b[i]); the operator has been validated
+template <class ElemType>
+static void ApplyToBlock(ElementWiseOperator op, size_t n, const ElemType* a, const ElemType* b, ElemType* out)
+{
+    switch (op)
+    {
+#define CaseUnaryOp(oper) case ElementWiseOperator::op##oper: for (size_t i = 0; i < n; i++) out[i] = Op##oper(a[i]); break
+    ForAllUnaryOps(CaseUnaryOp);
+#undef CaseUnaryOp
+#define CaseBinaryOp(oper) case ElementWiseOperator::op##oper: for (size_t i = 0; i < n; i++) out[i] = Op##oper(a[i], b[i]); break
+    ForAllBinaryOps(CaseBinaryOp);
+#undef CaseBinaryOp
+    default: break;
+    }
+}
+
+// Computes the values of all steps for the n elements starting at 'begin'. 'values' has a block for each step,
+// except for the last step if 'result' is given, which then receives its values.
+template <class ElemType>
+static void ForwardBlock(const std::vector<FusedElementwiseStep>& program, const std::vector<const ElemType*>& inputs, size_t begin, size_t n,
+                         ElemType* values, ElemType* result, std::vector<const ElemType*>& slots)
+{
+    auto numInputs = inputs.size();
+    for (size_t i = 0; i < numInputs; i++)
+        slots[i] = inputs[i] + begin;
+
+    for (size_t k = 0; k < program.size(); k++)
+    {
+        const auto& step = program[k];
+        ElemType* out = (result && k + 1 == program.size()) ? result + begin : values + k * s_blockSize;
+        ApplyToBlock(step.m_op, n, slots[step.m_args[0]], step.m_numArgs > 1 ? slots[step.m_args[1]] : nullptr, out);
+        slots[numInputs + k] = out;
+    }
+}
+
+template <class ElemType>
+void CPUFusedElementwiseForward(const std::vector<FusedElementwiseStep>& program, size_t numElements,
+                                const std::vector<const ElemType*>& inputs, ElemType* result)
+{
+    ValidateFusedElementwiseProgram(program, inputs.size());
+
+    auto numBlocks = (numElements + s_blockSize - 1) / s_blockSize;
+#pragma omp parallel if (numElements >= s_minParallelElements)
+    {
+        std::vector<ElemType> values(program.size() * s_blockSize);
+        std::vector<const ElemType*> slots(inputs.size() + program.size());
+#pragma omp for schedule(static)
+        for (long long block = 0; block < (long long)numBlocks; block++)
+        {
+            size_t begin = block * s_blockSize;
+            ForwardBlock(program, inputs, begin, std::min(s_blockSize, numElements - begin), values.data(), result, slots);
+        }
+    }
+}
+
+template <class ElemType>
+void CPUFusedElementwiseBackward(const std::vector<FusedElementwiseStep>& program, size_t numElements,
+                                 const std::vector<const ElemType*>& inputs, const ElemType* outputGradient,
+                                 size_t inputIndex, ElemType beta, ElemType* inputGradient)
+{
+    auto numInputs = inputs.size();
+    ValidateFusedElementwiseProgram(program, numInputs);
+    if (inputIndex >= numInputs)
+        InvalidArgument("FusedElementwise: Input index %d is out of range.", (int)inputIndex);
+
+    // the slots whose value depends on the input; the gradient flows back only through those
+    auto numSlots = numInputs + program.size();
+    std::vector<bool> dependsOnInput(numSlots, false);
+    dependsOnInput[inputIndex] = true;
+    for (size_t k = 0; k < program.size(); k++)
+    {
+        const auto& step = program[k];
+        for (size_t j = 0; j < step.m_numArgs; j++)
+            dependsOnInput[numInputs + k] = dependsOnInput[numInputs + k] || dependsOnInput[step.m_args[j]];
+    }
+
+    auto numBlocks = (numElements + s_blockSize - 1) / s_blockSize;
+#pragma omp parallel if (numElements >= s_minParallelElements)
+    {
+        std::vector<ElemType> values(program.size() * s_blockSize);
+        std::vector<ElemType> gradients(numSlots * s_blockSize);
+        std::vector<ElemType> term(s_blockSize);
+        std::vector<const ElemType*> slots(numSlots);
+#pragma omp for schedule(static)
+        for (long long block = 0; block < (long long)numBlocks; block++)
+        {
+            size_t begin = block * s_blockSize;
+            size_t n = std::min(s_blockSize, numElements - begin);
+            ForwardBlock(program, inputs, begin, n, values.data(), (ElemType*)nullptr, slots);
+
+            for (size_t s = 0; s < numSlots; s++)
+            {
+                if (dependsOnInput[s])
+                    std::fill(gradients.begin() + s * s_blockSize, gradients.begin() + s * s_blockSize + n, (ElemType)0);
+            }
+
+            for (size_t k = program.size(); k-- > 0;)
+            {
+                if (!dependsOnInput[numInputs + k])
+                    continue;
+
+                const auto& step = program[k];
+                const ElemType* gradient = (k + 1 == program.size()) ? outputGradient + begin : &gradients[(numInputs + k) * s_blockSize];
+                for (size_t j = 0; j < step.m_numArgs; j++)
+                {
+                    auto arg = step.m_args[j];
+                    if (!dependsOnInput[arg] || step.m_gradientOps[j] == ElementWiseOperator::opNone)
+                        continue;
+
+                    auto operand = step.m_gradientOperands[j];
+                    ApplyToBlock(step.m_gradientOps[j], n, gradient, operand == FusedElementwiseStep::NoOperand ? nullptr : slots[operand], term.data());
+                    ElemType* argGradient = &gradients[arg * s_blockSize];
+                    for (size_t i = 0; i < n; i++)
+                        argGradient[i] += term[i];
+                }
+            }
+
+            const ElemType* g = &gradients[inputIndex * s_blockSize];
+            ElemType* out = inputGradient + begin;
+            if (beta == (ElemType)0)
+                std::copy(g, g + n, out);
+            else
+            {
+                for (size_t i = 0; i < n; i++)
+                    out[i] = beta * out[i] + g[i];
+            }
+        }
+    }
+}
+
+template void CPUFusedElementwiseForward<float>(const std::vector<FusedElementwiseStep>&, size_t, const std::vector<const float*>&, float*);
+template void CPUFusedElementwiseForward<double>(const std::vector<FusedElementwiseStep>&, size_t, const std::vector<const double*>&, double*);
+template void CPUFusedElementwiseForward<half>(const std::vector<FusedElementwiseStep>&, size_t, const std::vector<const half*>&, half*);
+template void CPUFusedElementwiseBackward<float>(const std::vector<FusedElementwiseStep>&, size_t, const std::vector<const float*>&, const float*, size_t, float, float*);
+template void CPUFusedElementwiseBackward<double>(const std::vector<FusedElementwiseStep>&, size_t, const std::vector<const double*>&, const double*, size_t, double, double*);
+template void CPUFusedElementwiseBackward<half>(const std::vector<FusedElementwiseStep>&, size_t, const std::vector<const half*>&, const half*, size_t, half, half*);
+
+}}}
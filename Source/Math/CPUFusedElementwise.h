@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUFusedElementwise.h -- evaluation of an expression of several elementwise operations in one pass over memory
+// (used by FusedElementwiseNode)
+//
+#pragma once
+
+#include "CommonMatrix.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// One operation of a fused elementwise expression. The values of an expression with n inputs are held in slots:
+// slots 0..n-1 are the inputs, and step k of the program writes slot n+k. The last step computes the result.
+struct FusedElementwiseStep
+{
+    static const size_t NoOperand = SIZE_MAX;
+
+    ElementWiseOperator m_op;             // a unary or binary operator (see ForAllUnaryOps/ForAllBinaryOps)
+    size_t m_numArgs;                     // 1 or 2
+    size_t m_args[2];                     // slots of the arguments
+
+    // How the gradient of the step flows to argument j: not at all if m_gradientOps[j] is opNone, otherwise as
+    // m_gradientOps[j](gradient) or, if m_gradientOperands[j] is a slot, as m_gradientOps[j](gradient, value of that slot).
+    // The slot may be that of the step itself, for gradients computed from the output.
+    ElementWiseOperator m_gradientOps[2];
+    size_t m_gradientOperands[2];
+};
+
+// Throws if the program is not well-formed for the given number of inputs.
+MATH_API void ValidateFusedElementwiseProgram(const std::vector<FusedElementwiseStep>& program, size_t numInputs);
+
+// result = program(inputs), for numElements elements at the same positions of all inputs and the result.
+// The elements are processed in blocks that fit into the L1 cache, in parallel, and all steps are applied to a block
+// before moving to the next one, so that each input is read and the result is written only once.
+template <class ElemType>
+MATH_API void CPUFusedElementwiseForward(const std::vector<FusedElementwiseStep>& program, size_t numElements,
+                                         const std::vector<const ElemType*>& inputs, ElemType* result);
+
+// inputGradient = beta * inputGradient + d program / d inputs[inputIndex] * outputGradient.
+// The intermediate values are recomputed from the inputs, block by block, rather than kept from the forward pass.
+template <class ElemType>
+MATH_API void CPUFusedElementwiseBackward(const std::vector<FusedElementwiseStep>& program, size_t numElements,
+                                          const std::vector<const ElemType*>& inputs, const ElemType* outputGradient,
+                                          size_t inputIndex, ElemType beta, ElemType* inputGradient);
+
+}}}
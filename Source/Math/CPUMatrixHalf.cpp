@@ -113,6 +113,13 @@ void CPUMatrix<half>::AveragePoolingBackward(const CPUMatrix<int>& mpRowCol, con
     RuntimeError("half AveragePoolingBackward not supported.");
 }
 
+template <>
+void CPUMatrix<half>::RNNForward(const CPUMatrix<half>& inputX, const CPUMatrix<half>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame,
+                                 const RnnAttributes& rnnAttributes, CPUMatrix<half>& reserve, CPUMatrix<half>& workspace)
+{
+    RuntimeError("half RNNForward not supported.");
+}
+
 // explicit instantiations, due to CPUMatrix being too big and causing VS2015 cl crash.
 template class MATH_API CPUMatrix<half>;
 template<> int CPUMatrix<half>::m_optimizationFlags = 0;
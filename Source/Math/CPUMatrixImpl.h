@@ -12,6 +12,7 @@
 
 #include "CPUMatrix.h"
 #include "TensorOps.h"
+#include "CPURNN.h"
 #include <assert.h>
 #include <stdexcept>
 #include <omp.h>
@@ -5131,6 +5132,34 @@ void CPUMatrix<ElemType>::BatchNormalizationBackward(const CPUMatrix<ElemType>&
     RuntimeError("Batch normalization training on CPU is not yet implemented.");
 }
 
+#pragma region RNN Functions
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame,
+                                     const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    UNUSED(reserve); // only needed for training
+    CPURNNExecutor<ElemType>(xDim, yDim, rnnAttributes).ForwardCore(paramW, inputX, *this, numSequencesForFrame, rnnAttributes, workspace);
+}
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNBackwardData(const CPUMatrix<ElemType>& outputDY, const CPUMatrix<ElemType>& paramW, CPUMatrix<ElemType>& outputDX, const RnnAttributes& rnnAttributes,
+                                          CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    UNUSED(outputDY); UNUSED(paramW); UNUSED(outputDX); UNUSED(rnnAttributes); UNUSED(reserve); UNUSED(workspace);
+    RuntimeError("OptimizedRNNStack training on CPU is not yet implemented.");
+}
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNBackwardWeights(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& outputY, CPUMatrix<ElemType>& dw, const RnnAttributes& rnnAttributes,
+                                             CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    UNUSED(inputX); UNUSED(outputY); UNUSED(dw); UNUSED(rnnAttributes); UNUSED(reserve); UNUSED(workspace);
+    RuntimeError("OptimizedRNNStack training on CPU is not yet implemented.");
+}
+
+#pragma endregion RNN Functions
+
 
 #pragma region Static BLAS Functions
 
@@ -5216,6 +5245,8 @@ void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix
         // TODO: support transpose product
         if (mklTransA == CBLAS_TRANSPOSE::CblasTrans || mklTransB == CBLAS_TRANSPOSE::CblasTrans)
             LogicError("Quantized multiplier currently doesn't support transpose.");
+        if (alpha != 1 || beta != 0)
+            LogicError("Quantized multiplier currently only supports assigning the product (alpha = 1, beta = 0).");
 
         pQuantizedMultiplier->Multiply(m, n, k, a.Data(), b.Data(), c.Data());
     }
@@ -6508,19 +6539,65 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
     }
 };
 
-// Calculate alpha in forward-backward calculation. equation (6), (7) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// GPU x dimension corresponds to utterances, y dimension corresponds to phone sequence in each utterance
+// Working arrays of the CPU CTC forward-backward for one utterance. Each thread keeps one set that only grows,
+// so that a minibatch does not allocate once the arrays have reached the size of the longest label sequence.
+template<class ElemType>
+struct CTCWorkspace
+{
+    std::vector<size_t> labels;         // label of each position of the label sequence
+    std::vector<ElemType> emission;     // log probability of the label of each position at the current frame
+    std::vector<char> alphaSkip;        // alpha_{t-1}(s-2) contributes to alpha_t(s)
+    std::vector<char> betaSkip;         // beta_{t+1}(s+2) contributes to beta_t(s)
+    std::vector<LONG64> lastFrame;      // last frame allowed by the delay constraint
+
+    void Resize(size_t phoneNum)
+    {
+        labels.resize(phoneNum);
+        emission.resize(phoneNum);
+        alphaSkip.resize(phoneNum);
+        betaSkip.resize(phoneNum);
+        lastFrame.resize(phoneNum);
+    }
+};
+
+template<class ElemType>
+CTCWorkspace<ElemType>& _ctcWorkspace()
+{
+    static thread_local CTCWorkspace<ElemType> workspace;
+    return workspace;
+}
+
+// log(exp(a) + exp(b) + exp(c)) without branches, so that loops over label positions can be vectorized
+template<class ElemType>
+inline ElemType _logAdd3(ElemType a, ElemType b, ElemType c)
+{
+    ElemType m = std::max(a, std::max(b, c));
+    return m + log_(exp_(a - m) + exp_(b - m) + exp_(c - m));
+}
+
+// Gathers the log probabilities of the labels of positions [1, phoneNum - 2] at one frame.
+template<class ElemType>
+inline void _gatherEmission(const ElemType* probFrame, CTCWorkspace<ElemType>& ws, const size_t phoneNum)
+{
+    for (size_t s = 1; s + 1 < phoneNum; s++)
+        ws.emission[s] = ws.labels[s] != SIZE_MAX ? probFrame[ws.labels[s]] : (ElemType) 0;
+}
+
+// Forward-backward of one utterance, equations (6), (7), (10), (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
+// The recursion runs over all frames of the utterance; at each frame all label positions are updated at once from the
+// previous frame, i.e. from the previous column of alpha or the next column of beta, which are contiguous in s.
+// Writes alpha and beta of the frames of the utterance, the total score log p(l|x) into beta(0, first frame) and the
+// log posteriors of the labels into CTCscore. Utterances occupy disjoint columns, so they can be processed in parallel.
 // prob (input): the posterior output from the network
-// alpha (output): alpha for forward-backward calculation.
+// alphaScore, betaScore (output): alpha and beta for forward-backward calculation
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance
 // phoneBound (input): phone boundary (frame index) of each phone for each utterance in this minibatch, each col is one utterance
+// uttId (input): the utterance to process
 // uttToChanInd (input):  map from utterance ID to minibatch channel ID. We need this because each channel may contain more than one utterance.
 // uttFrameNum (input): the frame number of each utterance. The size of this vector =  the number of all utterances in this minibatch
 // uttBeginFrame(input): the position of the first frame of each utterance in the minibatch channel. We need this because each channel may contain more than one utterance.
 // uttPhoneNum (input): the phone number of each utterance. The size of this vector =  the number of all utterances in this minibatch
 // numChannels (input): channel number in this minibatch
-// uttNum (input): number of utterances
-// t (input): time stamp to process
 // maxPhoneNum (input): the max number of phones between utterances
 // totalPhoneNum (input): the total number of phones of all utterances
 // blankTokenId (input): id of the CTC blank token
@@ -6529,280 +6606,143 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
 //      Setting this parameter smaller will result in shorted delay between label output during decoding.
 //      delayConstraint=-1 means no constraint
 template<class ElemType>
-void _assignAlphaScore(
+ElemType _assignUtteranceCTCScore(
+    ElemType *CTCscore,
     const ElemType *prob,
     ElemType *alphaScore,
-    ElemType *phoneSeq,
-    ElemType *phoneBound,
-    const std::vector<size_t>& uttToChanInd,
-    const std::vector<size_t>& uttFrameNum,
-    const std::vector<size_t>& uttBeginFrame,
-    const std::vector<size_t>& uttPhoneNum,
-    size_t numChannels,
-    const size_t uttNum,
-    const size_t  t,
-    const size_t maxPhoneNum, // Maximum length of utterance in this MB
-    const size_t totalPhoneNum, // Total number of phones
-    const size_t blankTokenId,
-    const int delayConstraint)
-{
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
-
-        // Number of phones and frames in this utterance
-        size_t frameNum = uttFrameNum[uttId];
-        if (t >= frameNum) continue;
-
-        size_t phoneNum = uttPhoneNum[uttId];
-
-#pragma omp parallel for
-        for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
-            // Index of the label in the sequence
-
-            // Current and previous phone indices in phoneSeq matrix
-            size_t labelid = uttId*maxPhoneNum + phoneSeqId;
-
-            // Actual current phone label
-            size_t phoneId = (size_t)(phoneSeq[labelid]);
-
-            // Index of the current frame in minibatch
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-
-            // Index of probability of observing phoneId at frame timeId
-            size_t probId = timeId*totalPhoneNum + phoneId;
-
-            size_t alphaId = maxPhoneNum* timeId + phoneSeqId; // alpha_t(s)
-
-            if (t == 0)
-            {
-                // Initialize recursion
-                if (phoneSeqId == 1 || phoneSeqId == 2)
-                {
-                    alphaScore[alphaId] = prob[probId];
-                }
-            }
-            else
-            {
-                if (phoneSeqId >= 1)
-                {
-                    size_t timeId_1 = timeId - numChannels; // Index corresponding to (t-1)
-                    size_t alphaId_0 = maxPhoneNum* timeId_1 + phoneSeqId; // alpha_{t-1}(s)
-                    size_t alphaId_1 = alphaId_0 - 1; // alpha_{t-1}(s-1)
-                    size_t alphaId_2 = alphaId_0 - 2; // alpha_{t-1}(s-2)
-                    ElemType x = LZERO;
-
-                    ElemType ascore;
-                    if (phoneSeqId > 2)
-                    {
-                        size_t labelid_2 = labelid - 2;
-                        // if current label is not blank and not equal prev non-blank label
-                        if ((size_t)(phoneSeq[labelid]) != blankTokenId && phoneId != (size_t)(phoneSeq[labelid_2]))
-                        {
-                            x = LogAdd(x, alphaScore[alphaId_2]);
-                        }
-                    }
-
-                    if (phoneSeqId > 1)
-                    {
-                        x = LogAdd(x, alphaScore[alphaId_1]);
-                    }
-
-                    x = LogAdd(x, alphaScore[alphaId_0]);
-
-                    if (phoneId != SIZE_MAX)
-                        ascore = prob[probId]; // Probability of observing given label at given time
-                    else
-                        ascore = 0;
-                    alphaScore[alphaId] = (ElemType)x + ascore;
-                    if (delayConstraint != -1)
-                    {
-                        size_t labelid_r = labelid + 2;
-                        size_t phoneBoundId_r = (size_t)(phoneBound[labelid_r]);
-                        if (phoneId == blankTokenId)
-                        {
-                            // only constraint right side
-                            if (t > phoneBoundId_r + delayConstraint - 1)
-                                alphaScore[alphaId] = LZERO;
-                        }
-                        else if (phoneId != blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint)
-                                alphaScore[alphaId] = LZERO;
-                        }
-                    }
-                }
-
-            }
-        }
-    }
-}
-
-// Calculate beta in forward-backward calculation, equation (10), (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
-template<class ElemType>
-void _assignBetaScore(
-    const ElemType *prob,
     ElemType *betaScore,
-    ElemType *phoneSeq,
-    ElemType *phoneBound,
+    const ElemType *phoneSeq,
+    const ElemType *phoneBound,
+    const size_t uttId,
     const std::vector<size_t>& uttToChanInd,
     const std::vector<size_t>& uttFrameNum,
     const std::vector<size_t>& uttBeginFrame,
     const std::vector<size_t>& uttPhoneNum,
     const size_t numChannels,
-    const size_t uttNum,
-    const long  t,
     const size_t maxPhoneNum,
     const size_t totalPhoneNum,
     const size_t blankTokenId,
     const int delayConstraint)
 {
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
-
-        // Number of phones and frames in this utterance
-        size_t frameNum = uttFrameNum[uttId];
-        if (t >= frameNum) continue;
-
-        size_t phoneNum = uttPhoneNum[uttId];
+    const size_t frameNum = uttFrameNum[uttId];
+    const size_t phoneNum = uttPhoneNum[uttId];
+    const size_t chanId = uttToChanInd[uttId];
+    const size_t beginFrame = uttBeginFrame[uttId];
+    const ElemType zero = (ElemType) LZERO;
 
-#pragma omp parallel for
-        for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
-
-            size_t labelid = uttId*maxPhoneNum + phoneSeqId;
-            size_t labelid_2 = labelid + 2;
-            size_t phoneId = (LONG64)(phoneSeq[labelid]);
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-            size_t probId = timeId*totalPhoneNum + phoneId;
-            size_t betaid = maxPhoneNum* timeId + phoneSeqId;
-            size_t timeId_1 = timeId + numChannels;
-            size_t betaid_0 = maxPhoneNum* timeId_1 + phoneSeqId;
-            size_t betaid_1 = betaid_0 + 1;
-            size_t betaid_2 = betaid_0 + 2;
+    auto timeIdOf = [=](size_t t) { return (t + beginFrame) * numChannels + chanId; };
 
-            if (t == frameNum - 1)
-            {
-                if (phoneSeqId == phoneNum - 3 || phoneSeqId == phoneNum - 2)
-                {
-                    betaScore[betaid] = prob[probId];
-                }
-            }
-            else
-            {
-                if (phoneSeqId >= 1)
-                {
-                    ElemType x = LZERO;
-                    ElemType ascore;
-                    if (phoneSeqId < phoneNum - 3)
-                    {
-                        if (phoneSeq[labelid] != blankTokenId && phoneId != phoneSeq[labelid_2])
-                        {
-                            x = LogAdd(x, betaScore[betaid_2]);
-                        }
-                    }
+    CTCWorkspace<ElemType>& ws = _ctcWorkspace<ElemType>();
+    ws.Resize(phoneNum);
+    const ElemType* uttPhoneSeq = phoneSeq + uttId * maxPhoneNum;
+    const ElemType* uttPhoneBound = phoneBound + uttId * maxPhoneNum;
+    // the first and last positions hold no label
+    ws.labels[0] = ws.labels[phoneNum - 1] = SIZE_MAX;
+    for (size_t s = 1; s + 1 < phoneNum; s++)
+        ws.labels[s] = (size_t)(uttPhoneSeq[s]);
+    for (size_t s = 0; s < phoneNum; s++)
+    {
+        // if current label is not blank and not equal prev (alpha) or next (beta) non-blank label
+        ws.alphaSkip[s] = s > 2 && ws.labels[s] != blankTokenId && ws.labels[s] != ws.labels[s - 2];
+        ws.betaSkip[s] = s + 3 < phoneNum && ws.labels[s] != blankTokenId && ws.labels[s] != ws.labels[s + 2];
+        if (delayConstraint != -1)
+        {
+            // The constraint is given by the boundary of the next non-blank label; the last blank has none
+            // and uses the end of the utterance, which is stored at the last position.
+            LONG64 bound = (LONG64)uttPhoneBound[std::min(s + 2, phoneNum - 1)];
+            ws.lastFrame[s] = bound + delayConstraint - (ws.labels[s] == blankTokenId ? 1 : 0);
+        }
+    }
 
-                    if (phoneSeqId < phoneNum - 2)
-                    {
-                        x = LogAdd(x, betaScore[betaid_1]);
-                    }
+    // alpha
+    for (size_t t = 0; t < frameNum; t++)
+    {
+        size_t timeId = timeIdOf(t);
+        _gatherEmission(prob + timeId * totalPhoneNum, ws, phoneNum);
+        ElemType* cur = alphaScore + maxPhoneNum * timeId;
+        const ElemType* emission = ws.emission.data();
+        if (t == 0)
+        {
+            // Initialize recursion
+            for (size_t s = 1; s + 1 < phoneNum && s <= 2; s++)
+                cur[s] = emission[s];
+            continue;
+        }
 
-                    x = LogAdd(x, betaScore[betaid_0]);
+        const ElemType* prev = alphaScore + maxPhoneNum * (timeId - numChannels);
+        const char* skip = ws.alphaSkip.data();
+        cur[1] = LogAdd(zero, prev[1]) + emission[1];
+        if (phoneNum > 3)
+            cur[2] = LogAdd(prev[1], prev[2]) + emission[2];
+        for (size_t s = 3; s + 1 < phoneNum; s++)
+            cur[s] = _logAdd3(prev[s], prev[s - 1], skip[s] ? prev[s - 2] : zero) + emission[s];
 
-                    if (phoneId != SIZE_MAX)
-                        ascore = prob[probId];
-                    else
-                        ascore = 0;
-                    betaScore[betaid] = (ElemType)x + ascore;
-                    if (delayConstraint != -1)
-                    {
-                        size_t phoneBoundId_r = (size_t)(phoneBound[labelid_2]);
-                        if (phoneId == blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint - 1)
-                                betaScore[betaid] = LZERO;
-                        }
-                        else if (phoneId != blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint)
-                                betaScore[betaid] = LZERO;
-                        }
-                    }
-                }
-            }
+        if (delayConstraint != -1)
+        {
+            for (size_t s = 1; s + 1 < phoneNum; s++)
+                cur[s] = (LONG64)t > ws.lastFrame[s] ? zero : cur[s];
         }
     }
-}
 
-// Calculate CTC score. equation (8) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-template<class ElemType>
-void _assignTotalScore(ElemType *betaScore,
-    std::vector<ElemType>& totalScore,
-    const size_t uttNum,
-    const std::vector<size_t>& uttToChanInd,
-    const std::vector<size_t>& uttBeginFrame,
-    const size_t numChannels,
-    const size_t maxPhoneNum)
-{
-#pragma omp parallel for
-    for (int uttId = 0; uttId < uttNum; uttId++) {
-        if (uttId < uttNum)
+    // beta
+    for (LONG64 t = (LONG64)frameNum - 1; t >= 0; t--)
+    {
+        size_t timeId = timeIdOf(t);
+        _gatherEmission(prob + timeId * totalPhoneNum, ws, phoneNum);
+        ElemType* cur = betaScore + maxPhoneNum * timeId;
+        const ElemType* emission = ws.emission.data();
+        if (t == (LONG64)frameNum - 1)
         {
-            LONG64 alphaId_0 = (uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum;
+            for (size_t s = std::max<size_t>(phoneNum, 4) - 3; s + 1 < phoneNum; s++)
+                cur[s] = emission[s];
+            continue;
+        }
+
+        const ElemType* next = betaScore + maxPhoneNum * (timeId + numChannels);
+        const char* skip = ws.betaSkip.data();
+        for (size_t s = 1; s + 3 < phoneNum; s++)
+            cur[s] = _logAdd3(next[s], next[s + 1], skip[s] ? next[s + 2] : zero) + emission[s];
+        if (phoneNum > 3)
+            cur[phoneNum - 3] = LogAdd(next[phoneNum - 3], next[phoneNum - 2]) + emission[phoneNum - 3];
+        cur[phoneNum - 2] = LogAdd(zero, next[phoneNum - 2]) + emission[phoneNum - 2];
 
-            betaScore[alphaId_0] = LogAdd(betaScore[alphaId_0 + 1], betaScore[alphaId_0 + 2]);
-            totalScore[uttId] = betaScore[alphaId_0];
+        if (delayConstraint != -1)
+        {
+            for (size_t s = 1; s + 1 < phoneNum; s++)
+                cur[s] = t > ws.lastFrame[s] ? zero : cur[s];
         }
     }
-}
 
-// Calculate derivative, equation (15) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
-template<class ElemType>
-void _assignCTCScore(
-    ElemType *CTCscore,
-    ElemType *prob,
-    ElemType *alphaScore,
-    ElemType *betaScore,
-    ElemType *phoneSeq,
-    const size_t uttNum,
-    const std::vector<size_t>& uttToChanInd,
-    const std::vector<size_t>& uttBeginFrame,
-    const std::vector<size_t>& uttPhoneNum,
-    const std::vector<size_t>& uttFrameNum,
-    const size_t numChannels,
-    const size_t maxPhoneNum,
-    const size_t totalPhoneNum)
-{
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
-#pragma omp parallel for
-        for (int t = 0; t < uttFrameNum[uttId]; t++) {
-            size_t phoneNum = uttPhoneNum[uttId];
-            size_t alphaId_0 = (uttBeginFrame[uttId] * numChannels + uttToChanInd[uttId]) * maxPhoneNum;
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-            ElemType P_lx = betaScore[alphaId_0];
+    // total score, equation (8)
+    ElemType* beta0 = betaScore + maxPhoneNum * timeIdOf(0);
+    beta0[0] = LogAdd(beta0[1], beta0[2]);
+    const ElemType P_lx = beta0[0];
 
-            for (int s = 1; s < phoneNum - 1; s++)
-            {
-                long phoneId = phoneSeq[uttId*maxPhoneNum + s];
-                size_t alphaId = maxPhoneNum* timeId + s;
-                size_t probId = timeId*totalPhoneNum + phoneId;
-
-                if (phoneId != SIZE_MAX)
-                {
-                    ElemType logoccu = alphaScore[alphaId] + betaScore[alphaId] - prob[probId] - (ElemType)P_lx;
-                    CTCscore[probId] = LogAdd(CTCscore[probId], logoccu);
-                }
-            }
+    // derivative, equation (15)
+    for (size_t t = 0; t < frameNum; t++)
+    {
+        size_t timeId = timeIdOf(t);
+        const ElemType* probFrame = prob + timeId * totalPhoneNum;
+        ElemType* scoreFrame = CTCscore + timeId * totalPhoneNum;
+        const ElemType* alpha = alphaScore + maxPhoneNum * timeId;
+        const ElemType* beta = betaScore + maxPhoneNum * timeId;
 
-            for (int s = 0; s < totalPhoneNum; s++)
+        // positions may share a label, so the accumulation into the label rows stays sequential
+        for (size_t s = 1; s + 1 < phoneNum; s++)
+        {
+            size_t phoneId = ws.labels[s];
+            if (phoneId != SIZE_MAX)
             {
-                size_t probId = timeId*totalPhoneNum + s;
-                ElemType logoccu = CTCscore[probId];
-                if (logoccu < LZERO)
-                    CTCscore[probId] = 0.0f;
-                else
-                    CTCscore[probId] = exp(logoccu);
+                ElemType logoccu = alpha[s] + beta[s] - probFrame[phoneId] - P_lx;
+                scoreFrame[phoneId] = LogAdd(scoreFrame[phoneId], logoccu);
             }
         }
+
+        for (size_t s = 0; s < totalPhoneNum; s++)
+            scoreFrame[s] = scoreFrame[s] < zero ? (ElemType) 0 : exp_(scoreFrame[s]);
     }
+
+    return P_lx;
 }
 
 template<class ElemType>
@@ -6821,23 +6761,26 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignCTCScore(
         // Max number of phones in utterances in this minibatch
         size_t maxPhoneNum = phoneSeq.GetNumRows();
 
-        for (size_t t = 0; t < maxFrameNum; t++)
-        {
-            _assignAlphaScore(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
-                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
-
-        for (LONG64 t = maxFrameNum - 1; t >= 0; t--)
+        // Utterances are independent; each one runs its full recursion on one thread.
+        std::vector<ElemType> scores(uttNum);
+        std::exception_ptr error; // first exception thrown by any of the threads
+#pragma omp parallel for schedule(dynamic)
+        for (int utt = 0; utt < (int) uttNum; utt++)
         {
-            _assignBetaScore(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
-                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+            try
+            {
+                scores[utt] = _assignUtteranceCTCScore(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), utt, uttToChanInd,
+                    uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+            }
+            catch (...)
+            {
+#pragma omp critical(ctcscoreerror)
+                if (!error)
+                    error = std::current_exception();
+            }
         }
-
-        std::vector<ElemType> scores(uttNum);
-        _assignTotalScore(beta.Data(), scores, uttNum, uttToChanInd, uttBeginFrame, numParallelSequences, maxPhoneNum);
-
-        _assignCTCScore(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), uttNum, uttToChanInd,
-            uttBeginFrame, uttPhoneNum, uttFrameNum, numParallelSequences, maxPhoneNum, totalPhoneNum);
+        if (error)
+            std::rethrow_exception(error);
 
         totalScore(0, 0) = 0.0;
         for (size_t utt = 0; utt < uttNum; utt++)
@@ -0,0 +1,95 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUQuantizedGemm.cpp -- blocking, threading and runtime dispatch of the quantized GEMM (see CPUQuantizedGemm.h)
+//
+
+#include "stdafx.h"
+#include "CPUQuantizedGemm.h"
+#include "CPUQuantizedGemmKernels.h"
+#include "CPUTensorSimd.h"
+#include <algorithm>
+#include <limits.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// below this many multiply-adds, a product is not worth spreading across threads
+static const double s_minParallelWork = 1 << 20;
+
+// number of columns of B that are multiplied with a block of rows of A in one task
+static const size_t s_columnsPerTile = 16;
+
+// a block of rows of A should fit comfortably into the L1 cache while it is multiplied with the columns of B
+static const size_t s_rowBlockBytes = 16 * 1024;
+
+// scalar versions of the kernels, for CPUs without AVX2
+template <class T>
+static void DotProductsScalar(size_t numRows, size_t k, const T* rows, size_t ldRows, const T* x, size_t /*flushInterval*/, float* out)
+{
+    for (size_t r = 0; r < numRows; r++)
+    {
+        const T* row = rows + r * ldRows;
+        long long sum = 0;
+        for (size_t l = 0; l < k; l++)
+            sum += (int)row[l] * (int)x[l];
+        out[r] = (float)sum;
+    }
+}
+
+static const CPUQuantizedGemmKernels s_scalarKernels = { &DotProductsScalar<short>, &DotProductsScalar<signed char> };
+
+static const CPUQuantizedGemmKernels& GetKernels()
+{
+    static const CPUQuantizedGemmKernels* kernels = []() -> const CPUQuantizedGemmKernels*
+    {
+        auto level = GetSupportedCPUSimdLevel();
+        if ((level == CPUSimdLevel::AVX2 || level == CPUSimdLevel::AVX512) && GetCPUQuantizedGemmKernelsAVX2())
+            return GetCPUQuantizedGemmKernelsAVX2();
+        return &s_scalarKernels;
+    }();
+    return *kernels;
+}
+
+template <class T>
+static void QuantizedGemm(void (*dotProducts)(size_t, size_t, const T*, size_t, const T*, size_t, float*),
+                          size_t m, size_t n, size_t k, const T* packedA, int maxAbsA, const T* b, int maxAbsB, float* c)
+{
+    if (m == 0 || n == 0)
+        return;
+
+    // a pair of products must fit into a 32-bit integer; we can keep adding pairs as long as the sum cannot overflow
+    const long long maxPairSum = 2LL * std::max(maxAbsA, 1) * std::max(maxAbsB, 1);
+    if (maxPairSum > INT_MAX)
+        InvalidArgument("CPUQuantizedGemm: Quantized values exceed the supported range (max |A| = %d, max |B| = %d).", maxAbsA, maxAbsB);
+    const size_t flushInterval = (size_t)(INT_MAX / maxPairSum);
+
+    // the product is computed in tiles of rowBlock rows of A times s_columnsPerTile columns of B
+    const size_t rowBlock = std::max((size_t)4, s_rowBlockBytes / (std::max(k, (size_t)1) * sizeof(T)) / 4 * 4);
+    const size_t numRowBlocks = (m + rowBlock - 1) / rowBlock;
+    const size_t numColumnBlocks = (n + s_columnsPerTile - 1) / s_columnsPerTile;
+    const int numTiles = (int)(numRowBlocks * numColumnBlocks);
+
+#pragma omp parallel for schedule(dynamic) if ((double)m * n * k >= s_minParallelWork && numTiles > 1)
+    for (int tile = 0; tile < numTiles; tile++)
+    {
+        const size_t firstRow = (tile % numRowBlocks) * rowBlock;
+        const size_t firstColumn = (tile / numRowBlocks) * s_columnsPerTile;
+        const size_t numRows = std::min(rowBlock, m - firstRow);
+        const size_t endColumn = std::min(firstColumn + s_columnsPerTile, n);
+        for (size_t j = firstColumn; j < endColumn; j++)
+            dotProducts(numRows, k, packedA + firstRow * k, k, b + j * k, flushInterval, c + j * m + firstRow);
+    }
+}
+
+void CPUQuantizedGemm(size_t m, size_t n, size_t k, const short* packedA, int maxAbsA, const short* b, int maxAbsB, float* c)
+{
+    QuantizedGemm(GetKernels().dotProducts16, m, n, k, packedA, maxAbsA, b, maxAbsB, c);
+}
+
+void CPUQuantizedGemm(size_t m, size_t n, size_t k, const signed char* packedA, int maxAbsA, const signed char* b, int maxAbsB, float* c)
+{
+    QuantizedGemm(GetKernels().dotProducts8, m, n, k, packedA, maxAbsA, b, maxAbsB, c);
+}
+
+}}}
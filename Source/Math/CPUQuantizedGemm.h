@@ -0,0 +1,24 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUQuantizedGemm.h -- multithreaded, vectorized product of two int16 or int8 matrices (used by QuantizedMultiplier)
+//
+#pragma once
+
+#include "CommonMatrix.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// C[m x n] = A[m x k] * B[k x n] for matrices of quantized values, computed in integer arithmetic and returned as float.
+//  - A is packed row by row: row i starts at packedA + i * k (see QuantizedMultiplier::PackA()).
+//  - B is column-major, which is how CNTK stores activations: column j starts at b + j * k.
+//  - C is column-major with leading dimension m.
+// maxAbsA and maxAbsB are bounds on the magnitude of the values in A and B. They determine for how many steps the
+// products can be summed in 32-bit integers before the partial sums are moved to floating point.
+// The values -32768 (int16) and -128 (int8) must not occur; the symmetric quantizers never produce them.
+// The instruction set (AVX2 or scalar) is chosen at runtime.
+MATH_API void CPUQuantizedGemm(size_t m, size_t n, size_t k, const short* packedA, int maxAbsA, const short* b, int maxAbsB, float* c);
+MATH_API void CPUQuantizedGemm(size_t m, size_t n, size_t k, const signed char* packedA, int maxAbsA, const signed char* b, int maxAbsB, float* c);
+
+}}}
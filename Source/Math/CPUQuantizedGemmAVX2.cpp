@@ -0,0 +1,110 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUQuantizedGemmAVX2.cpp -- AVX2 versions of the integer dot-product kernels behind the quantized GEMM.
+// This file is compiled with AVX2 and FMA code generation enabled (see Makefile and Math.vcxproj), and must only be
+// entered after checking the CPU (see CPUQuantizedGemm.cpp). Do not include stdafx.h or any other CNTK/STL header here.
+//
+
+#include "CPUQuantizedGemmKernels.h"
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+
+#include <immintrin.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace {
+
+// loads 16 consecutive values as 16-bit integers (int8 values are sign-extended)
+inline __m256i Load16(const short* p)       { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline __m256i Load16(const signed char* p) { return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+
+inline float HorizontalSum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// dot products of NumRows rows with x; x is loaded once for all rows
+template <size_t NumRows, class T>
+void DotProductBlock(size_t k, const T* rows, size_t ldRows, const T* x, size_t flushInterval, float* out)
+{
+    const size_t kVec = k - k % 16;
+    const size_t flushLength = flushInterval * 16; // one _mm256_madd_epi16() adds one pair of products to each 32-bit lane
+
+    __m256 acc[NumRows];
+    for (size_t q = 0; q < NumRows; q++)
+        acc[q] = _mm256_setzero_ps();
+
+    for (size_t begin = 0; begin < kVec; begin += flushLength)
+    {
+        const size_t end = kVec - begin > flushLength ? begin + flushLength : kVec;
+        __m256i sum[NumRows];
+        for (size_t q = 0; q < NumRows; q++)
+            sum[q] = _mm256_setzero_si256();
+        for (size_t l = begin; l < end; l += 16)
+        {
+            __m256i xv = Load16(x + l);
+            for (size_t q = 0; q < NumRows; q++)
+                sum[q] = _mm256_add_epi32(sum[q], _mm256_madd_epi16(Load16(rows + q * ldRows + l), xv));
+        }
+        for (size_t q = 0; q < NumRows; q++)
+            acc[q] = _mm256_add_ps(acc[q], _mm256_cvtepi32_ps(sum[q]));
+    }
+
+    for (size_t q = 0; q < NumRows; q++)
+    {
+        long long tail = 0;
+        for (size_t l = kVec; l < k; l++)
+            tail += (int)rows[q * ldRows + l] * (int)x[l];
+        out[q] = HorizontalSum(acc[q]) + (float)tail;
+    }
+}
+
+template <class T>
+void DotProducts(size_t numRows, size_t k, const T* rows, size_t ldRows, const T* x, size_t flushInterval, float* out)
+{
+    const size_t rowsPerBlock = 4;
+    size_t r = 0;
+    for (; r + rowsPerBlock <= numRows; r += rowsPerBlock)
+        DotProductBlock<rowsPerBlock>(k, rows + r * ldRows, ldRows, x, flushInterval, out + r);
+    for (; r < numRows; r++)
+        DotProductBlock<1>(k, rows + r * ldRows, ldRows, x, flushInterval, out + r);
+}
+
+void DotProducts16(size_t numRows, size_t k, const short* rows, size_t ldRows, const short* x, size_t flushInterval, float* out)
+{
+    DotProducts(numRows, k, rows, ldRows, x, flushInterval, out);
+}
+
+void DotProducts8(size_t numRows, size_t k, const signed char* rows, size_t ldRows, const signed char* x, size_t flushInterval, float* out)
+{
+    DotProducts(numRows, k, rows, ldRows, x, flushInterval, out);
+}
+
+}
+
+const CPUQuantizedGemmKernels* GetCPUQuantizedGemmKernelsAVX2()
+{
+    static const CPUQuantizedGemmKernels kernels = { &DotProducts16, &DotProducts8 };
+    return &kernels;
+}
+
+}}}
+
+#else // compiler cannot generate AVX2 code for this target
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+const CPUQuantizedGemmKernels* GetCPUQuantizedGemmKernelsAVX2()
+{
+    return nullptr;
+}
+
+}}}
+
+#endif
@@ -0,0 +1,31 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUQuantizedGemmKernels.h -- interface between the quantized GEMM driver (CPUQuantizedGemm.cpp) and the
+// instruction-set specific integer dot-product kernels (CPUQuantizedGemmAVX2.cpp).
+//
+// Like CPUTensorSimdKernels.h, this header is included by a translation unit that is compiled with
+// instruction-set specific compiler flags, and must therefore stay free of CNTK and STL headers.
+//
+#pragma once
+
+#include <stddef.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Integer dot-product kernels for one instruction set.
+// Each computes out[r] = sum_{l < k} x[l] * rows[r * ldRows + l] for 0 <= r < numRows.
+// Products are summed exactly in 32-bit integers, and the partial sums are added to float accumulators after
+// at most flushInterval pairs of products per 32-bit lane, which the caller chooses such that they cannot overflow.
+struct CPUQuantizedGemmKernels
+{
+    void (*dotProducts16)(size_t numRows, size_t k, const short* rows, size_t ldRows, const short* x, size_t flushInterval, float* out);
+    void (*dotProducts8)(size_t numRows, size_t k, const signed char* rows, size_t ldRows, const signed char* x, size_t flushInterval, float* out);
+};
+
+// Returns nullptr if the kernels were not compiled for the instruction set (e.g. on non-x86 builds).
+// The caller must check the CPU for support before using them.
+const CPUQuantizedGemmKernels* GetCPUQuantizedGemmKernelsAVX2();
+
+}}}
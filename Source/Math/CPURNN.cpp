@@ -0,0 +1,240 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "CPURNN.h"
+#include <algorithm>
+#include <math.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// below this many gate values per frame, the fused nonlinearity pass is not worth spreading across threads
+static const size_t s_minParallelStepSize = 4096;
+
+template <class ElemType>
+static inline ElemType RNNSigmoid(ElemType x)
+{
+    // written so that exp() never overflows
+    if (x >= 0)
+        return 1 / (1 + exp(-x));
+    ElemType e = exp(x);
+    return e / (1 + e);
+}
+
+template <class ElemType>
+CPURNNExecutor<ElemType>::CPURNNExecutor(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes)
+    : m_rnnAttributes(rnnAttributes), m_xDim(xDim), m_yDim(yDim)
+{
+    const wstring& op = m_rnnAttributes.m_recurrentOp;
+    if      (op == wstring(L"lstm"))    { m_cellType = CellType::LSTM;    m_numGates = 4; }
+    else if (op == wstring(L"gru"))     { m_cellType = CellType::GRU;     m_numGates = 3; }
+    else if (op == wstring(L"rnnReLU")) { m_cellType = CellType::RNNReLU; m_numGates = 1; }
+    else if (op == wstring(L"rnnTanh")) { m_cellType = CellType::RNNTanh; m_numGates = 1; }
+    else InvalidArgument("Unknown cell type '%ls'. Supported values are 'lstm', 'gru', 'rnnReLU', 'rnnTanh'.", op.c_str());
+
+    const size_t hiddenSize = m_rnnAttributes.m_hiddenSize;
+    m_numDirections = m_rnnAttributes.m_bidirectional ? 2 : 1;
+    if (m_yDim != m_numDirections * hiddenSize)
+        InvalidArgument("CPURNNExecutor: Output leading dimension must be twice hidden size for bidirectional networks");
+
+    // The parameter blob is laid out the way cuDNN lays it out for CUDNN_LINEAR_INPUT:
+    //  - first the weights of all layers; for each layer and direction the input weights, then the recurrent weights,
+    //  - then the biases of all layers; for each layer and direction the input bias, then the recurrent bias.
+    // Each weight matrix holds numGates*hiddenSize rows of cuDNN's row-major matrix one after another, which makes it
+    // a column-major [inputDim x numGates*hiddenSize] matrix W such that W^T x gives the gate pre-activations.
+    const size_t gateDim = m_numGates * hiddenSize;
+    size_t offset = 0;
+    size_t inputDim = m_xDim;
+    for (size_t layer = 0; layer < m_rnnAttributes.m_numLayers; layer++)
+    {
+        for (size_t dir = 0; dir < m_numDirections; dir++)
+        {
+            LayerParameters p;
+            p.inputDim = inputDim;
+            p.w = offset;
+            p.r = p.w + inputDim * gateDim;
+            offset = p.r + hiddenSize * gateDim;
+            m_layers.push_back(p);
+        }
+        inputDim = m_yDim; // next layer continues on the (spliced) output of this one
+    }
+    for (auto& p : m_layers)
+    {
+        p.bw = offset;
+        p.br = p.bw + gateDim;
+        offset = p.br + gateDim;
+    }
+    m_numParameters = offset;
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardCore(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+                                           const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& workspace)
+{
+    // test that the RNN shape is correct
+    if (!(m_rnnAttributes == rnnAttributes))
+        LogicError("RNN Layout has changed during processing");
+    if (weightsW.GetNumElements() != m_numParameters)
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", (long)m_numParameters, (long)weightsW.GetNumElements());
+    if (inputX.GetNumRows() != m_xDim)
+        InvalidArgument("CPURNNExecutor: Input has %d rows, but the RNN was set up for %d.", (int)inputX.GetNumRows(), (int)m_xDim);
+
+    // column offset of every frame in the packed data
+    const size_t numFrames = numSequencesForFrame.size();
+    vector<size_t> frameOffsets(numFrames + 1, 0);
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        if (t > 0 && numSequencesForFrame[t] > numSequencesForFrame[t - 1])
+            InvalidArgument("CPURNNExecutor: Sequences must be packed longest first.");
+        frameOffsets[t + 1] = frameOffsets[t] + numSequencesForFrame[t];
+    }
+    const size_t numCols = frameOffsets[numFrames];
+    if (inputX.GetNumCols() != numCols)
+        InvalidArgument("CPURNNExecutor: Input has %d columns, but the sequence layout describes %d.", (int)inputX.GetNumCols(), (int)numCols);
+
+    outputY.RequireSize(m_yDim, numCols);
+    if (numCols == 0)
+        return;
+
+    // carve the workspace into
+    //  - the gate pre-activations of all frames for one layer/direction,
+    //  - the recurrent contribution for one frame, and the hidden and cell state of all sequences, and
+    //  - two buffers for the output of intermediate layers (layer l reads one and writes the other)
+    const size_t hiddenSize = m_rnnAttributes.m_hiddenSize;
+    const size_t numLayers = m_rnnAttributes.m_numLayers;
+    const size_t gateDim = m_numGates * hiddenSize;
+    const size_t maxSequences = numSequencesForFrame[0];
+    const size_t gatesSize = gateDim * numCols;
+    const size_t recurrentSize = gateDim * maxSequences;
+    const size_t stateSize = hiddenSize * maxSequences;
+    const size_t layerOutputSize = numLayers > 1 ? m_yDim * numCols : 0;
+    workspace.RequireSize(gatesSize + recurrentSize + 2 * stateSize + 2 * layerOutputSize, 1);
+
+    ElemType* gates = workspace.Data();
+    ElemType* recurrent = gates + gatesSize;
+    ElemType* h = recurrent + recurrentSize;
+    ElemType* c = h + stateSize;
+    ElemType* layerOutputs[2] = { c + stateSize, c + stateSize + layerOutputSize };
+
+    const ElemType* weights = weightsW.Data();
+    const ElemType* layerInput = inputX.Data();
+    for (size_t layer = 0; layer < numLayers; layer++)
+    {
+        ElemType* layerOutput = layer + 1 == numLayers ? outputY.Data() : layerOutputs[layer % 2];
+        for (size_t dir = 0; dir < m_numDirections; dir++)
+        {
+            const LayerParameters& p = m_layers[layer * m_numDirections + dir];
+
+            // input projection of all frames in one GEMM: gates = W^T x
+            CPUMatrix<ElemType> w(p.inputDim, gateDim, const_cast<ElemType*>(weights) + p.w, matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType> x(p.inputDim, numCols, const_cast<ElemType*>(layerInput), matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType> g(gateDim, numCols, gates, matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, w, true, x, false, 0, g);
+
+            ForwardDirection(weights, p, /*reverse=*/dir == 1, numSequencesForFrame, frameOffsets, gates, recurrent, h, c, layerOutput, dir * hiddenSize);
+        }
+        layerInput = layerOutput;
+    }
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardDirection(const ElemType* weights, const LayerParameters& layer, bool reverse,
+                                                const vector<size_t>& numSequencesForFrame, const vector<size_t>& frameOffsets,
+                                                const ElemType* gates, ElemType* recurrent, ElemType* h, ElemType* c,
+                                                ElemType* output, size_t outputRowOffset) const
+{
+    const size_t hiddenSize = m_rnnAttributes.m_hiddenSize;
+    const size_t gateDim = m_numGates * hiddenSize;
+    const size_t numFrames = numSequencesForFrame.size();
+    const size_t maxSequences = numSequencesForFrame[0];
+
+    // Sequence j always sits in column j of its frames, so column j of h and c carries its state from frame to frame.
+    // Going backwards, shorter sequences join later, and find their state columns still at the initial zero.
+    std::fill(h, h + hiddenSize * maxSequences, (ElemType)0);
+    std::fill(c, c + hiddenSize * maxSequences, (ElemType)0);
+
+    CPUMatrix<ElemType> r(hiddenSize, gateDim, const_cast<ElemType*>(weights) + layer.r, matrixFlagDontOwnBuffer);
+    const ElemType* bw = weights + layer.bw;
+    const ElemType* br = weights + layer.br;
+
+    for (size_t step = 0; step < numFrames; step++)
+    {
+        const size_t t = reverse ? numFrames - 1 - step : step;
+        const size_t numSequences = numSequencesForFrame[t];
+        if (numSequences == 0)
+            continue;
+
+        // recurrent contribution R^T h of the active sequences (h is still all zero in the first step)
+        if (step == 0)
+            std::fill(recurrent, recurrent + gateDim * numSequences, (ElemType)0);
+        else
+        {
+            CPUMatrix<ElemType> hPrev(hiddenSize, numSequences, h, matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType> rec(gateDim, numSequences, recurrent, matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, r, true, hPrev, false, 0, rec);
+        }
+
+        // fused biases, nonlinearities and state update
+        const ElemType* x = gates + frameOffsets[t] * gateDim;
+        ElemType* y = output + frameOffsets[t] * m_yDim + outputRowOffset;
+#pragma omp parallel for if (numSequences * gateDim >= s_minParallelStepSize)
+        for (long j = 0; j < (long)numSequences; j++)
+            ForwardStep(x + j * gateDim, recurrent + j * gateDim, bw, br, h + j * hiddenSize, c + j * hiddenSize, y + j * m_yDim);
+    }
+}
+
+// one cell update for one sequence, following the cuDNN definitions of the cells
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardStep(const ElemType* x, const ElemType* rec, const ElemType* bw, const ElemType* br,
+                                           ElemType* h, ElemType* c, ElemType* y) const
+{
+    const size_t n = m_rnnAttributes.m_hiddenSize;
+    switch (m_cellType)
+    {
+    case CellType::LSTM:
+        for (size_t k = 0; k < n; k++)
+        {
+            ElemType i = RNNSigmoid(x[k]         + rec[k]         + bw[k]         + br[k]);
+            ElemType f = RNNSigmoid(x[n + k]     + rec[n + k]     + bw[n + k]     + br[n + k]);
+            ElemType g =      tanh (x[2 * n + k] + rec[2 * n + k] + bw[2 * n + k] + br[2 * n + k]);
+            ElemType o = RNNSigmoid(x[3 * n + k] + rec[3 * n + k] + bw[3 * n + k] + br[3 * n + k]);
+            c[k] = f * c[k] + i * g;
+            h[k] = o * tanh(c[k]);
+            y[k] = h[k];
+        }
+        break;
+    case CellType::GRU:
+        for (size_t k = 0; k < n; k++)
+        {
+            ElemType rg = RNNSigmoid(x[k]     + rec[k]     + bw[k]     + br[k]);
+            ElemType z  = RNNSigmoid(x[n + k] + rec[n + k] + bw[n + k] + br[n + k]);
+            // cuDNN applies the reset gate after the recurrent bias
+            ElemType hc = tanh(x[2 * n + k] + bw[2 * n + k] + rg * (rec[2 * n + k] + br[2 * n + k]));
+            h[k] = (1 - z) * hc + z * h[k];
+            y[k] = h[k];
+        }
+        break;
+    case CellType::RNNReLU:
+        for (size_t k = 0; k < n; k++)
+        {
+            ElemType a = x[k] + rec[k] + bw[k] + br[k];
+            h[k] = a > 0 ? a : 0;
+            y[k] = h[k];
+        }
+        break;
+    case CellType::RNNTanh:
+        for (size_t k = 0; k < n; k++)
+        {
+            h[k] = tanh(x[k] + rec[k] + bw[k] + br[k]);
+            y[k] = h[k];
+        }
+        break;
+    }
+}
+
+template class CPURNNExecutor<float>;
+template class CPURNNExecutor<double>;
+
+}}}
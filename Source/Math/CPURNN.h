@@ -0,0 +1,75 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPURNN.h -- CPU implementation of the fused RNN stack behind OptimizedRNNStack (the CPU counterpart of CuDnnRNN)
+//
+
+#pragma once
+
+#include "CPUMatrix.h"
+#include "RNNCommon.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// CPURNNExecutor evaluates an LSTM/GRU/ReLU-RNN/tanh-RNN stack, uni- or bidirectional, from the same parameter
+// blob and the same packed data layout that CuDnnRNNExecutor uses, so that models trained on the GPU can be run on the CPU.
+//
+// Data are packed frame by frame: the columns of frame t hold the numSequencesForFrame[t] sequences that are still
+// active at that frame, longest sequence first (see OptimizedRNNStackNode::PackSequencesForCuDNN()).
+//
+// For each layer and direction, the input projection of all frames is computed by a single GEMM up front. The time loop
+// then only does the (much smaller) recurrent GEMM per frame, followed by one fused pass that adds the biases, applies
+// the gate nonlinearities and updates the cell and hidden state.
+//
+// Only inference is implemented. Training an OptimizedRNNStack still requires a GPU.
+template <class ElemType>
+class CPURNNExecutor
+{
+public:
+    CPURNNExecutor(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes);
+
+    // outputY = RNN(inputX); workspace is resized as needed and may be reused across calls
+    void ForwardCore(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+                     const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& workspace);
+
+    size_t GetNumParameters() const { return m_numParameters; }
+
+private:
+    enum class CellType
+    {
+        LSTM,    // gates i, f, c', o (cuDNN order)
+        GRU,     // gates r, z, h' (cuDNN order)
+        RNNReLU,
+        RNNTanh
+    };
+
+    // offsets of one layer/direction into the parameter blob
+    struct LayerParameters
+    {
+        size_t inputDim;
+        size_t w;  // input weights,     [inputDim x numGates*hiddenSize]
+        size_t r;  // recurrent weights, [hiddenSize x numGates*hiddenSize]
+        size_t bw; // input bias,        [numGates*hiddenSize]
+        size_t br; // recurrent bias,    [numGates*hiddenSize]
+    };
+
+    void ForwardDirection(const ElemType* weights, const LayerParameters& layer, bool reverse,
+                          const vector<size_t>& numSequencesForFrame, const vector<size_t>& frameOffsets,
+                          const ElemType* gates, ElemType* recurrent, ElemType* h, ElemType* c,
+                          ElemType* output, size_t outputRowOffset) const;
+
+    void ForwardStep(const ElemType* x, const ElemType* rec, const ElemType* bw, const ElemType* br,
+                     ElemType* h, ElemType* c, ElemType* y) const;
+
+    RnnAttributes m_rnnAttributes;
+    size_t m_xDim, m_yDim;
+    CellType m_cellType;
+    size_t m_numGates;
+    size_t m_numDirections;
+    std::vector<LayerParameters> m_layers; // indexed by layer * m_numDirections + direction
+    size_t m_numParameters;
+};
+
+}}}
@@ -926,7 +926,113 @@ void CPUSparseMatrix<ElemType>::Reset()
     SetBlockIdShift(0);
 }
 
+template <class ElemType>
+shared_ptr<const CPUSparseTransposedIndex> CPUSparseMatrix<ElemType>::GetTransposedIndex() const
+{
+    if (GetFormat() != matrixFormatSparseCSC)
+        NOT_IMPLEMENTED;
+
+    const CPUSPARSE_INDEX_TYPE* colStarts = SecondaryIndexLocation();
+    const CPUSPARSE_INDEX_TYPE* rowIndices = MajorIndexLocation();
+    const size_t numCols = GetNumCols();
+    const size_t numNonzeros = colStarts[numCols] - colStarts[0];
+
+    // the cached index is still valid if the nonzero structure is the same as the one it was built for
+    auto cached = GetTransposedIndexCache();
+    if (cached && cached->numRows == GetNumRows() && cached->cscColStarts.size() == numCols + 1 && cached->cscRowIndices.size() == numNonzeros)
+    {
+        bool sameStructure = equal(cached->cscRowIndices.begin(), cached->cscRowIndices.end(), rowIndices);
+        for (size_t j = 0; sameStructure && j <= numCols; j++)
+            sameStructure = cached->cscColStarts[j] == colStarts[j] - colStarts[0];
+        if (sameStructure)
+            return cached;
+    }
+
+    auto index = make_shared<CPUSparseTransposedIndex>();
+    index->numRows = GetNumRows();
+    index->cscColStarts.resize(numCols + 1);
+    for (size_t j = 0; j <= numCols; j++)
+        index->cscColStarts[j] = colStarts[j] - colStarts[0];
+    index->cscRowIndices.assign(rowIndices, rowIndices + numNonzeros);
+
+    // sort the nonzeros by row; the stable sort keeps them in column order within each row
+    vector<CPUSPARSE_INDEX_TYPE>& positions = index->nzPositions;
+    positions.resize(numNonzeros);
+    for (size_t p = 0; p < numNonzeros; p++)
+        positions[p] = (CPUSPARSE_INDEX_TYPE)p;
+    stable_sort(positions.begin(), positions.end(), [rowIndices](CPUSPARSE_INDEX_TYPE a, CPUSPARSE_INDEX_TYPE b) { return rowIndices[a] < rowIndices[b]; });
+
+    vector<CPUSPARSE_INDEX_TYPE> columnOfPosition(numNonzeros);
+    for (size_t j = 0; j < numCols; j++)
+        for (CPUSPARSE_INDEX_TYPE p = index->cscColStarts[j]; p < index->cscColStarts[j + 1]; p++)
+            columnOfPosition[p] = (CPUSPARSE_INDEX_TYPE)j;
+
+    index->columns.resize(numNonzeros);
+    for (size_t q = 0; q < numNonzeros; q++)
+    {
+        const CPUSPARSE_INDEX_TYPE row = rowIndices[positions[q]];
+        index->columns[q] = columnOfPosition[positions[q]];
+        if (index->rows.empty() || index->rows.back() != row)
+        {
+            index->rows.push_back(row);
+            index->rowStarts.push_back((CPUSPARSE_INDEX_TYPE)q);
+        }
+    }
+    index->rowStarts.push_back((CPUSPARSE_INDEX_TYPE)numNonzeros);
+
+    SetTransposedIndexCache(index);
+    return index;
+}
+
+// below this many multiply-adds, a sparse-dense product is computed on a single thread
+static const double s_minParallelSparseWork = 1 << 16;
+
+// the rows of an output column are updated in blocks of this size, so that a block stays in the L1 cache while all nonzeros contributing to it are added
+static const size_t s_sparseRowBlockBytes = 16 * 1024;
+
+// number of output columns that one thread computes at a time in sparse * dense products
+static const size_t s_sparseColumnsPerTask = 4;
+
+// y[i] += a * x[i * incx] for 0 <= i < n
+template <class ElemType>
+static inline void SparseAxpy(size_t n, ElemType a, const ElemType* x, size_t incx, ElemType* y)
+{
+    if (incx == 1)
+    {
+        for (size_t i = 0; i < n; i++)
+            y[i] += a * x[i];
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+            y[i] += a * x[i * incx];
+    }
+}
+
+// Adds a sparse linear combination of dense vectors to the output column c[0..numRows):
+//     c += alpha * sum_{begin <= p < end} values[positions[p]] * x(inner[p])
+// where x(i) is the vector whose elements are dense[i * vectorStride + r * elementStride]. A null 'positions' stands for positions[p] = p.
+template <class ElemType>
+static void AccumulateSparseCombination(size_t numRows, ElemType alpha, const ElemType* values, const CPUSPARSE_INDEX_TYPE* inner, const CPUSPARSE_INDEX_TYPE* positions, size_t begin, size_t end,
+                                        const ElemType* dense, size_t vectorStride, size_t elementStride, ElemType* c)
+{
+    const size_t rowBlock = s_sparseRowBlockBytes / sizeof(ElemType);
+    for (size_t firstRow = 0; firstRow < numRows; firstRow += rowBlock)
+    {
+        const size_t blockRows = min(rowBlock, numRows - firstRow);
+        for (size_t p = begin; p < end; p++)
+        {
+            const ElemType val = alpha * values[positions ? positions[p] : p];
+            SparseAxpy(blockRows, val, dense + inner[p] * vectorStride + firstRow * elementStride, elementStride, c + firstRow);
+        }
+    }
+}
+
 // Implements product of one sparse and one dense matrix updating a third dense matrix. Input matrices are optionally transposed.
+// The work is distributed over the columns of the output, such that no two threads write to the same output column:
+//  - dense * CSC:   output column j is the combination of the dense vectors selected by sparse column j.
+//  - dense * CSC^T: output column j is the combination selected by sparse row j, which is enumerated with the CSR index (GetTransposedIndex()).
+//  - CSC * dense:   output columns are computed in groups, each group traversing all nonzeros of the sparse matrix.
 // NOTE: The only for using a class template instead of a function template was that I couldn't make the function template compile.
 template <class ElemType, bool denseTimesSparse /* false means SparseTimesDense */, bool transposeA, bool transposeB>
 class MultiplyDenseAndSparse{
@@ -985,47 +1091,71 @@ public:
         // * Initialized the output matrix c
 
         // Now do the actual multiplication.
-        ElemType* valueBuffer = sparse.Buffer() + *sparse.SecondaryIndexLocation(); // Points to the value buffer of the current view (i.e. buffer containing values of non-zero elements).
-        int* rowIndexBuffer = sparse.MajorIndexLocation();                          // Points to the index buffer of the current view (i.e. buffer containing indices of non-zero elements).
-        size_t iNonzero = 0;                                                           // Number of nonzero elements handled so far for current slice view.
-        int numPreviosNonzero = sparse.SecondaryIndexLocation()[0];                 // Total number of nonzero values handled in previous slices.
+        // All positions below are relative to the current slice view.
+        const ElemType* valueBuffer = sparse.Buffer() + *sparse.SecondaryIndexLocation(); // Points to the value buffer of the current view (i.e. buffer containing values of non-zero elements).
+        const CPUSPARSE_INDEX_TYPE* rowIndexBuffer = sparse.MajorIndexLocation();         // Points to the index buffer of the current view (i.e. buffer containing indices of non-zero elements).
+        const CPUSPARSE_INDEX_TYPE* colStarts = sparse.SecondaryIndexLocation();           // Start of each column, counted from the beginning of the buffers of the full matrix.
+        const size_t numNonzeros = colStarts[sparse.GetNumCols()] - colStarts[0];
+        const bool parallel = (double)numNonzeros * outerDimensionDense >= s_minParallelSparseWork;
+
+        ElemType* cData = c.Data();
+        const size_t ldc = c.GetNumRows();
+        const ElemType* denseData = dense.Data();
+        const size_t ldDense = dense.GetNumRows();
+
+        if (denseTimesSparse)
+        {
+            // Each nonzero (inner, outer) of the sparse factor adds a multiple of row/column 'inner' of the dense factor to column 'outer' of c.
+            const size_t vectorStride  = transposeA ? 1 : ldDense;
+            const size_t elementStride = transposeA ? ldDense : 1;
 
-        // Loop over columns of the sparse matrix
-        for (size_t colSparse = 0; colSparse < sparse.GetNumCols(); colSparse++)
+            if (!transposeB) // one output column per sparse column
+            {
+                const int numCols = (int)sparse.GetNumCols();
+#pragma omp parallel for schedule(dynamic, 16) if (parallel)
+                for (int col = 0; col < numCols; col++)
+                    AccumulateSparseCombination(m, alpha, valueBuffer, rowIndexBuffer, (const CPUSPARSE_INDEX_TYPE*) nullptr, colStarts[col] - colStarts[0], colStarts[col + 1] - colStarts[0],
+                                                denseData, vectorStride, elementStride, cData + col * ldc);
+            }
+            else // one output column per sparse row
+            {
+                auto transposedIndex = sparse.GetTransposedIndex();
+                const CPUSparseTransposedIndex& index = *transposedIndex;
+                const int numRows = (int)index.rows.size();
+#pragma omp parallel for schedule(dynamic, 16) if (parallel)
+                for (int i = 0; i < numRows; i++)
+                    AccumulateSparseCombination(m, alpha, valueBuffer, index.columns.data(), index.nzPositions.data(), index.rowStarts[i], index.rowStarts[i + 1],
+                                                denseData, vectorStride, elementStride, cData + index.rows[i] * ldc);
+            }
+        }
+        else
         {
-            size_t numNonzeroInSparseCol = sparse.SecondaryIndexLocation()[colSparse + 1] - numPreviosNonzero;
-            // Loop over the nonzero rows of the current column of the sparse matrix
-            for (; iNonzero < numNonzeroInSparseCol; iNonzero++)
+            // Each thread computes a group of output columns, so all threads traverse the sparse matrix, but only read from it.
+            const int numTasks = (int)((n + s_sparseColumnsPerTask - 1) / s_sparseColumnsPerTask);
+#pragma omp parallel for schedule(dynamic) if (parallel && numTasks > 1)
+            for (int task = 0; task < numTasks; task++)
             {
-                size_t rowSparse = rowIndexBuffer[iNonzero]; // RowLocation
-                ElemType sparseVal = valueBuffer[iNonzero];
-
-                // Determine the index of the 'outer' dimension of the sparse matrix and the common inner index.
-                size_t outerIndexSparse;
-                size_t innerIndex;
-                // Below if-statements are evaluated at compile time.
-                if      ( denseTimesSparse && !transposeB) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
-                else if ( denseTimesSparse &&  transposeB) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse && !transposeA) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse &&  transposeA) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
-
-                // Loop over the outer index of the dense matrix
-                for (size_t outerIndexDense = 0; outerIndexDense < outerDimensionDense; outerIndexDense++)
+                const size_t firstCol = task * s_sparseColumnsPerTask;
+                const size_t endCol = min(firstCol + s_sparseColumnsPerTask, n);
+                for (size_t colSparse = 0; colSparse < sparse.GetNumCols(); colSparse++)
                 {
-                    // Determine the row index of the dense input matrix.
-                    // Below if-statements are evaluated at compile time.
-                    ElemType denseVal;
-                    if      ( denseTimesSparse && !transposeA) denseVal = dense(outerIndexDense,      innerIndex);
-                    else if ( denseTimesSparse &&  transposeA) denseVal = dense(     innerIndex, outerIndexDense);
-                    else if (!denseTimesSparse && !transposeB) denseVal = dense(     innerIndex, outerIndexDense);
-                    else if (!denseTimesSparse &&  transposeB) denseVal = dense(outerIndexDense,      innerIndex);
-
-
-                    // Update matrix c.
-                    if (denseTimesSparse)
-                        c(outerIndexDense, outerIndexSparse) += alpha * denseVal * sparseVal;
-                    else /*Sparse times dense */
-                        c(outerIndexSparse, outerIndexDense) += alpha * denseVal * sparseVal;
+                    for (size_t p = colStarts[colSparse] - colStarts[0]; p < colStarts[colSparse + 1] - colStarts[0]; p++)
+                    {
+                        const size_t rowSparse = rowIndexBuffer[p];
+                        const ElemType sparseVal = alpha * valueBuffer[p];
+
+                        // Determine the index of the 'outer' dimension of the sparse matrix and the common inner index.
+                        // Below if-statements are evaluated at compile time.
+                        size_t outerIndexSparse, innerIndex;
+                        if (!transposeA) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
+                        else             { outerIndexSparse = colSparse; innerIndex = rowSparse; }
+
+                        for (size_t j = firstCol; j < endCol; j++)
+                        {
+                            const ElemType denseVal = transposeB ? denseData[j + innerIndex * ldDense] : denseData[innerIndex + j * ldDense];
+                            cData[outerIndexSparse + j * ldc] += sparseVal * denseVal;
+                        }
+                    }
                 }
             }
         }
@@ -1116,13 +1246,23 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             col2BlockId[c.GetBlockIds()[blockId]] = blockId;
         }
 
+        // Column j of the result is lhs times row j of rhs, so we enumerate the nonzeros of rhs by row (CSR order).
+        // Each row then updates its own block of the result, and the rows can be processed in parallel.
+        auto transposedIndex = rhs.GetTransposedIndex();
+        const CPUSparseTransposedIndex& index = *transposedIndex;
+        const int numRows = (int)index.rows.size();
+
+        vector<size_t> rowBlockIds(numRows);
         size_t blockSizeCurr = blockSizePrev;
-        for (size_t rhsNz = 0; rhsNz < rhs.NzCount(); rhsNz++)
+        for (int i = 0; i < numRows; i++)
         {
-            size_t resultCol = rhs.MajorIndexLocation()[rhsNz];
-            if (col2BlockId.find(resultCol) == col2BlockId.end())
+            size_t resultCol = index.rows[i];
+            auto iter = col2BlockId.find(resultCol);
+            if (iter != col2BlockId.end())
+                rowBlockIds[i] = iter->second;
+            else
             {
-                col2BlockId[resultCol] = blockSizeCurr;
+                rowBlockIds[i] = blockSizeCurr;
                 c.GetBlockIds()[blockSizeCurr] = resultCol;
                 blockSizeCurr ++;
             }
@@ -1135,23 +1275,13 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             memset(c.Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
         }
 
-        for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
+        const ElemType* values = rhs.Buffer() + *rhs.SecondaryIndexLocation(); // values of the current slice view
+        const bool parallel = (double)index.columns.size() * m >= s_minParallelSparseWork;
+#pragma omp parallel for schedule(dynamic, 16) if (parallel)
+        for (int i = 0; i < numRows; i++)
         {
-            size_t start = rhs.SecondaryIndexLocation()[rhsCol];
-            size_t end = rhs.SecondaryIndexLocation()[rhsCol + 1];
-
-            for (size_t p = start; p < end; p++)
-            {
-                size_t rhsRow = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
-
-                ElemType* results = c.Buffer() + col2BlockId[rhsRow] * m;
-                #pragma omp parallel for
-                for (int lhsRow = 0; lhsRow < (int)m; lhsRow++)
-                {
-                    results[lhsRow] += alpha * lhs((size_t)lhsRow, rhsCol) * val;
-                }
-            }
+            AccumulateSparseCombination(m, alpha, values, index.columns.data(), index.nzPositions.data(), index.rowStarts[i], index.rowStarts[i + 1],
+                                        lhs.Data(), lhs.GetNumRows(), (size_t)1, c.Buffer() + rowBlockIds[i] * m);
         }
     }
     else if (transposeA && !transposeB)
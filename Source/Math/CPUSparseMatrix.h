@@ -21,6 +21,23 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Row-major (CSR) index of the nonzero structure of a CSC matrix (see CPUSparseMatrix::GetTransposedIndex()).
+// Products that consume a CSC matrix row by row, like the weight gradient dense * CSC^T, use it to give each row
+// of the sparse matrix (i.e. each column of the result) to exactly one thread instead of scattering writes into the result.
+// It refers to the values by their position, so it stays valid as long as only the values of the matrix change.
+struct CPUSparseTransposedIndex
+{
+    // nonzero structure the index was built for: column starts (relative to the first nonzero of the view) and row indices
+    size_t numRows;
+    std::vector<CPUSPARSE_INDEX_TYPE> cscColStarts;
+    std::vector<CPUSPARSE_INDEX_TYPE> cscRowIndices;
+
+    std::vector<CPUSPARSE_INDEX_TYPE> rows;        // the rows that have nonzeros, in increasing order
+    std::vector<CPUSPARSE_INDEX_TYPE> rowStarts;   // the nonzeros of rows[i] are [rowStarts[i], rowStarts[i + 1]) in the arrays below
+    std::vector<CPUSPARSE_INDEX_TYPE> columns;     // column of each nonzero
+    std::vector<CPUSPARSE_INDEX_TYPE> nzPositions; // position of each nonzero in NzValues()
+};
+
 template <class ElemType>
 class MATH_API CPUSparseMatrix : public BaseMatrix<ElemType>
 {
@@ -41,6 +58,8 @@ class MATH_API CPUSparseMatrix : public BaseMatrix<ElemType>
     using Base::SetCompIndex;
     using Base::GetUnCompIndex;
     using Base::SetUnCompIndex;
+    using Base::GetTransposedIndexCache;
+    using Base::SetTransposedIndexCache;
     using Base::GetCompIndexSize;
     using Base::SetCompIndexSize;
     using Base::GetColIdx;
@@ -358,6 +377,11 @@ public:
     {
         return (GetFormat() & matrixFormatRowMajor) ? MajorIndexSize() : SecondaryIndexSize();
     } // actual number of bytes in use
+
+    // Returns the CSR index of this CSC matrix (view). It is cached with the storage, and rebuilt when the nonzero
+    // structure has changed since it was built. The returned index is immutable and stays valid while it is held, so
+    // concurrent readers of matrices sharing the storage may call this; they may then build the index more than once.
+    std::shared_ptr<const CPUSparseTransposedIndex> GetTransposedIndex() const;
 };
 
 typedef CPUSparseMatrix<float> CPUSingleSparseMatrix;
@@ -0,0 +1,411 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorSimd.cpp -- runtime dispatch of CPU tensor ops to the vectorized kernels (see CPUTensorSimd.h)
+//
+
+#include "stdafx.h"
+#include "CPUTensorSimd.h"
+#include "CPUTensorSimdKernels.h"
+#include "CPUMatrix.h"
+#include <omp.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// CPU detection
+// -----------------------------------------------------------------------
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_SIMD_DETECTION_SUPPORTED
+
+static void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (unsigned int)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// which register states the OS saves on context switches (XCR0)
+static unsigned long long GetXCR0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+static CPUSimdLevel DetectCPUSimdLevel()
+{
+    CPUSimdLevel level = CPUSimdLevel::None;
+#ifdef CPU_SIMD_DETECTION_SUPPORTED
+    unsigned int regs[4];
+    CpuId(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 7)
+        return level;
+
+    CpuId(1, 0, regs);
+    bool hasFMA     = (regs[2] & (1u << 12)) != 0;
+    bool hasOSXSAVE = (regs[2] & (1u << 27)) != 0;
+    bool hasAVX     = (regs[2] & (1u << 28)) != 0;
+    if (!hasFMA || !hasOSXSAVE || !hasAVX)
+        return level;
+
+    unsigned long long xcr0 = GetXCR0();
+    if ((xcr0 & 0x6) != 0x6) // XMM and YMM state
+        return level;
+
+    CpuId(7, 0, regs);
+    bool hasAVX2    = (regs[1] & (1u << 5)) != 0;
+    bool hasAVX512F = (regs[1] & (1u << 16)) != 0;
+    if (hasAVX2 && GetCPUTensorSimdKernelsAVX2())
+        level = CPUSimdLevel::AVX2;
+    if (hasAVX512F && (xcr0 & 0xe6) == 0xe6 && // opmask and ZMM state
+        GetCPUTensorSimdKernelsAVX512())
+        level = CPUSimdLevel::AVX512;
+#endif
+    return level;
+}
+
+CPUSimdLevel GetSupportedCPUSimdLevel()
+{
+    static const CPUSimdLevel level = DetectCPUSimdLevel();
+    return level;
+}
+
+// kernels to use, or nullptr if the vectorized code path is disabled or not supported
+static const CPUTensorSimdKernels* GetActiveKernels()
+{
+    if (!(CPUMatrix<float>::GetOptimizationFlags() & CPUMatrix<float>::OPT_SIMD_TENSOR_OPS))
+        return nullptr;
+
+    switch (GetSupportedCPUSimdLevel())
+    {
+    case CPUSimdLevel::AVX512: return GetCPUTensorSimdKernelsAVX512();
+    case CPUSimdLevel::AVX2:   return GetCPUTensorSimdKernelsAVX2();
+    default:                   return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------
+// mapping of ElementWiseOperator to the vectorized subset
+// -----------------------------------------------------------------------
+
+static SimdOp UnarySimdOp(ElementWiseOperator op)
+{
+    switch (op)
+    {
+    case ElementWiseOperator::opCopy:            return SimdOp::Copy;
+    case ElementWiseOperator::opNegate:          return SimdOp::Negate;
+    case ElementWiseOperator::opAbs:             return SimdOp::Abs;
+    case ElementWiseOperator::opSqr:             return SimdOp::Sqr;
+    case ElementWiseOperator::opSqrt:            return SimdOp::Sqrt;
+    case ElementWiseOperator::opExp:             return SimdOp::Exp;
+    case ElementWiseOperator::opLinearRectifier: return SimdOp::LinearRectifier;
+    case ElementWiseOperator::opSigmoid:         return SimdOp::Sigmoid;
+    case ElementWiseOperator::opStableSigmoid:   return SimdOp::StableSigmoid;
+    case ElementWiseOperator::opTanh:            return SimdOp::Tanh;
+    default:                                     return SimdOp::None;
+    }
+}
+
+static SimdOp BinarySimdOp(ElementWiseOperator op)
+{
+    switch (op)
+    {
+    case ElementWiseOperator::opSum:                return SimdOp::Sum;
+    case ElementWiseOperator::opDifference:         return SimdOp::Difference;
+    case ElementWiseOperator::opElementwiseProduct: return SimdOp::ElementwiseProduct;
+    case ElementWiseOperator::opMax:                return SimdOp::Max;
+    case ElementWiseOperator::opMin:                return SimdOp::Min;
+    case ElementWiseOperator::opSqrOfDifference:    return SimdOp::SqrOfDifference;
+    case ElementWiseOperator::opElementwiseProductWithSigmoidDerivativeFromOutput:         return SimdOp::ElementwiseProductWithSigmoidDerivativeFromOutput;
+    case ElementWiseOperator::opElementwiseProductWithTanhDerivativeFromOutput:            return SimdOp::ElementwiseProductWithTanhDerivativeFromOutput;
+    case ElementWiseOperator::opElementwiseProductWithLinearRectifierDerivativeFromOutput: return SimdOp::ElementwiseProductWithLinearRectifierDerivativeFromOutput;
+    default:                                        return SimdOp::None;
+    }
+}
+
+static SimdOp TernarySimdOp(ElementWiseOperator op)
+{
+    switch (op)
+    {
+    case ElementWiseOperator::opCond:                            return SimdOp::Cond;
+    case ElementWiseOperator::opClip:                            return SimdOp::Clip;
+    case ElementWiseOperator::opElementwiseProductWithExpOfDiff: return SimdOp::ElementwiseProductWithExpOfDiff;
+    default:                                                     return SimdOp::None;
+    }
+}
+
+static SimdOp ReductionSimdOp(ElementWiseOperator reductionOp)
+{
+    switch (reductionOp)
+    {
+    case ElementWiseOperator::opSum:    return SimdOp::Sum;
+    case ElementWiseOperator::opMax:    return SimdOp::Max;
+    case ElementWiseOperator::opMin:    return SimdOp::Min;
+    case ElementWiseOperator::opLogSum: return SimdOp::LogSum;
+    default:                            return SimdOp::None;
+    }
+}
+
+// -----------------------------------------------------------------------
+// iteration over the tensor, and parallelization
+// -----------------------------------------------------------------------
+
+// Number of elements below which we don't parallelize, and the size of the work items we parallelize over.
+// Unlike the scalar loops, which always 'omp parallel for' over the innermost dimension, this keeps small
+// tensors single-threaded where the OpenMP overhead would dominate.
+static const size_t s_simdGrainSize = 16384; // multiple of all vector widths
+
+// vector widths are at most this; shorter innermost dimensions are left to the scalar code
+static const size_t s_minSimdRowLength = 16;
+
+// element offsets of the element at linear index 'index' over dims [firstDim, dims.size())
+template <size_t N>
+static void OffsetsOfIndex(size_t index, const SmallVector<size_t>& dims, const array<SmallVector<ptrdiff_t>, N>& strides, size_t firstDim, array<ptrdiff_t, N>& offsets)
+{
+    offsets.fill(0);
+    for (size_t k = firstDim; k < dims.size(); k++)
+    {
+        size_t coord = index % dims[k];
+        index /= dims[k];
+        for (size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
+            offsets[i] += (ptrdiff_t)coord * strides[i][k];
+    }
+}
+
+static size_t NumElements(const SmallVector<size_t>& dims, size_t firstDim = 0)
+{
+    size_t n = 1;
+    for (size_t k = firstDim; k < dims.size(); k++)
+        n *= dims[k];
+    return n;
+}
+
+// Runs 'workFn(item)' for all items in [0, numItems), in parallel if the total work is large enough.
+template <typename WorkFn>
+static void ForAllWorkItems(size_t numItems, size_t totalElements, const WorkFn& workFn)
+{
+    if (numItems > 1 && totalElements >= s_simdGrainSize && omp_get_max_threads() > 1)
+    {
+#pragma omp parallel for schedule(static)
+        for (int item = 0; item < (int)numItems; item++)
+            workFn((size_t)item);
+    }
+    else
+    {
+        for (size_t item = 0; item < numItems; item++)
+            workFn(item);
+    }
+}
+
+// Elementwise op: calls rowFn(pointers, n) for contiguous pieces of the innermost dimension (split into work items of
+// at most s_simdGrainSize elements) and all combinations of the outer dimensions.
+// The caller has checked that dimension 0 is contiguous in the output and contiguous or broadcast in the inputs.
+template <size_t N, typename RowFn>
+static void ForAllRows(const array<float*, N>& pointers, const SmallVector<size_t>& dims, const array<SmallVector<ptrdiff_t>, N>& strides, const RowFn& rowFn)
+{
+    size_t rowLength = dims[0];
+    size_t numRows = NumElements(dims, 1);
+    size_t chunksPerRow = (rowLength + s_simdGrainSize - 1) / s_simdGrainSize;
+    ForAllWorkItems(numRows * chunksPerRow, numRows * rowLength, [&](size_t item)
+    {
+        size_t row = item / chunksPerRow;
+        size_t begin = (item % chunksPerRow) * s_simdGrainSize;
+        size_t n = min(s_simdGrainSize, rowLength - begin);
+        array<ptrdiff_t, N> offsets;
+        OffsetsOfIndex(row, dims, strides, 1, offsets);
+        array<float*, N> p;
+        for (size_t i = 0; i < N; i++)
+            p[i] = pointers[i] + offsets[i] + (ptrdiff_t)begin * strides[i][0];
+        rowFn(p, n);
+    });
+}
+
+// Checks whether an elementwise op (no reduction) has the shape the kernels expect.
+template <size_t N>
+static bool IsVectorizableElementwise(const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides, const SmallVector<size_t>& reducingOpDims)
+{
+    if (!reducingOpDims.empty() || regularOpDims.empty() || regularOpDims[0] < s_minSimdRowLength)
+        return false;
+    if (regularStrides[N - 1][0] != 1) // output
+        return false;
+    for (size_t i = 0; i < N - 1; i++) // inputs
+        if (regularStrides[i][0] != 0 && regularStrides[i][0] != 1)
+            return false;
+    return true;
+}
+
+template <size_t N>
+static array<float*, N> ApplyOffsets(const array<float*, N>& pointers, const array<size_t, N>& offsets)
+{
+    array<float*, N> p;
+    for (size_t i = 0; i < N; i++)
+        p[i] = pointers[i] + offsets[i];
+    return p;
+}
+
+// -----------------------------------------------------------------------
+// reductions (unary only)
+// -----------------------------------------------------------------------
+
+static float ScaleAndCombine(double aggregate, float beta, const float* pout, float alpha)
+{
+    // same as the scalar code: aggregate is rounded to ElemType first
+    float val = (float)aggregate * alpha;
+    if (beta != 0)
+        val += beta * *pout;
+    return val;
+}
+
+static bool ReduceSimd(const CPUTensorSimdKernels& kernels, float beta, const array<float*, 2>& pointers, float alpha, SimdOp reductionOp,
+                       const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+                       const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides)
+{
+    if (reducingOpDims.size() != 1)
+        return false;
+    size_t reductionLength = reducingOpDims[0];
+    float* pa = pointers[0];
+    float* po = pointers[1];
+
+    // reduction over a contiguous dimension, e.g. ReduceSum() over the vector of each sample
+    if (reducingStrides[0][0] == 1)
+    {
+        if (reductionLength < s_minSimdRowLength)
+            return false;
+        size_t numOutputs = NumElements(regularOpDims);
+        if (numOutputs == 1 && reductionOp != SimdOp::LogSum && reductionLength >= 2 * s_simdGrainSize)
+        {
+            // a single long reduction: reduce chunks in parallel, then combine
+            size_t numChunks = (reductionLength + s_simdGrainSize - 1) / s_simdGrainSize;
+            vector<double> partial(numChunks);
+            ForAllWorkItems(numChunks, reductionLength, [&](size_t chunk)
+            {
+                size_t begin = chunk * s_simdGrainSize;
+                partial[chunk] = kernels.reduce(reductionOp, min(s_simdGrainSize, reductionLength - begin), pa + begin);
+            });
+            double aggregate = partial[0];
+            for (size_t chunk = 1; chunk < numChunks; chunk++)
+            {
+                if (reductionOp == SimdOp::Sum)
+                    aggregate += partial[chunk];
+                else if (reductionOp == SimdOp::Max)
+                    aggregate = partial[chunk] > aggregate ? partial[chunk] : aggregate;
+                else
+                    aggregate = partial[chunk] < aggregate ? partial[chunk] : aggregate;
+            }
+            *po = ScaleAndCombine(aggregate, beta, po, alpha);
+            return true;
+        }
+        ForAllWorkItems(numOutputs, numOutputs * reductionLength, [&](size_t index)
+        {
+            array<ptrdiff_t, 2> offsets;
+            OffsetsOfIndex(index, regularOpDims, regularStrides, 0, offsets);
+            float* pout = po + offsets[1];
+            *pout = ScaleAndCombine(kernels.reduce(reductionOp, reductionLength, pa + offsets[0]), beta, pout, alpha);
+        });
+        return true;
+    }
+
+    // reduction across columns, e.g. the gradient of a bias: each output element sums a row of the input
+    if (reductionOp != SimdOp::LogSum &&
+        regularOpDims.size() == 1 && regularOpDims[0] >= s_minSimdRowLength &&
+        regularStrides[0][0] == 1 && regularStrides[1][0] == 1)
+    {
+        size_t numRows = regularOpDims[0];
+        ptrdiff_t columnStride = reducingStrides[0][0];
+        // work items of about s_simdGrainSize input elements, in whole vectors
+        size_t rowsPerItem = max(s_minSimdRowLength, (s_simdGrainSize / reductionLength + s_minSimdRowLength - 1) / s_minSimdRowLength * s_minSimdRowLength);
+        size_t numItems = (numRows + rowsPerItem - 1) / rowsPerItem;
+        ForAllWorkItems(numItems, numRows * reductionLength, [&](size_t item)
+        {
+            size_t begin = item * rowsPerItem;
+            kernels.reduceColumns(reductionOp, min(rowsPerItem, numRows - begin), reductionLength, beta, pa + begin, columnStride, po + begin, alpha);
+        });
+        return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------
+// entry points from CPUMatrixTensorOpImpl()
+// -----------------------------------------------------------------------
+
+bool CPUTensorOpSimd(float beta, const array<float*, 2>& pointers, float alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                     const array<size_t, 2>& offsets,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides)
+{
+    const CPUTensorSimdKernels* kernels = GetActiveKernels();
+    if (!kernels)
+        return false;
+
+    if (!reducingOpDims.empty())
+    {
+        SimdOp simdReductionOp = ReductionSimdOp(reductionOp);
+        if (op != ElementWiseOperator::opCopy || simdReductionOp == SimdOp::None)
+            return false;
+        return ReduceSimd(*kernels, beta, ApplyOffsets(pointers, offsets), alpha, simdReductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    }
+
+    SimdOp simdOp = UnarySimdOp(op);
+    if (simdOp == SimdOp::None || !IsVectorizableElementwise(regularOpDims, regularStrides, reducingOpDims))
+        return false;
+    ForAllRows(ApplyOffsets(pointers, offsets), regularOpDims, regularStrides, [&](const array<float*, 2>& p, size_t n)
+    {
+        kernels->unary(simdOp, n, beta, p[0], regularStrides[0][0], p[1], alpha);
+    });
+    return true;
+}
+
+bool CPUTensorOpSimd(float beta, const array<float*, 3>& pointers, float alpha, ElementWiseOperator op, ElementWiseOperator /*reductionOp*/,
+                     const array<size_t, 3>& offsets,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& /*reducingStrides*/)
+{
+    const CPUTensorSimdKernels* kernels = GetActiveKernels();
+    SimdOp simdOp = BinarySimdOp(op);
+    if (!kernels || simdOp == SimdOp::None || !IsVectorizableElementwise(regularOpDims, regularStrides, reducingOpDims))
+        return false;
+    ForAllRows(ApplyOffsets(pointers, offsets), regularOpDims, regularStrides, [&](const array<float*, 3>& p, size_t n)
+    {
+        kernels->binary(simdOp, n, beta, p[0], regularStrides[0][0], p[1], regularStrides[1][0], p[2], alpha);
+    });
+    return true;
+}
+
+bool CPUTensorOpSimd(float beta, const array<float*, 4>& pointers, float alpha, ElementWiseOperator op, ElementWiseOperator /*reductionOp*/,
+                     const array<size_t, 4>& offsets,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& /*reducingStrides*/)
+{
+    const CPUTensorSimdKernels* kernels = GetActiveKernels();
+    SimdOp simdOp = TernarySimdOp(op);
+    if (!kernels || simdOp == SimdOp::None || !IsVectorizableElementwise(regularOpDims, regularStrides, reducingOpDims))
+        return false;
+    ForAllRows(ApplyOffsets(pointers, offsets), regularOpDims, regularStrides, [&](const array<float*, 4>& p, size_t n)
+    {
+        kernels->ternary(simdOp, n, beta, p[0], regularStrides[0][0], p[1], regularStrides[1][0], p[2], regularStrides[2][0], p[3], alpha);
+    });
+    return true;
+}
+
+}}}
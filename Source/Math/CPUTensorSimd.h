@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorSimd.h -- explicitly vectorized (AVX2/AVX-512) paths for the CPU tensor ops
+//
+// CPUMatrixTensorOpImpl() tries these before falling back to the generic, lambda-based TensorOpIteration loops.
+// They handle the common cases that dominate training time:
+//  - elementwise unary/binary/ternary ops whose innermost dimension is contiguous in the output and
+//    contiguous or broadcast in each input (e.g. Sigmoid, adding a bias, the ReLU gradient), and
+//  - Sum/Max/Min/LogSum reductions over a contiguous dimension, and Sum/Max/Min reductions across columns
+//    (e.g. the bias gradient).
+// The instruction set is chosen at runtime from what the CPU supports. Only float is vectorized; the
+// generic template below makes the call a no-op for the other element types.
+//
+#pragma once
+
+#include "CommonMatrix.h"
+#include "TensorShape.h"
+#include <array>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class CPUSimdLevel
+{
+    None,   // scalar code only
+    AVX2,   // AVX2 + FMA, 8 floats per vector
+    AVX512, // AVX-512F, 16 floats per vector
+};
+
+// best instruction set that both this CPU/OS and the build support (determined once)
+CPUSimdLevel GetSupportedCPUSimdLevel();
+
+// Each of these returns true if it performed the operation, and false if the caller must fall back to the scalar code.
+template <class ElemType, size_t N>
+inline bool CPUTensorOpSimd(ElemType /*beta*/, const array<ElemType*, N>& /*pointers*/, ElemType /*alpha*/, ElementWiseOperator /*op*/, ElementWiseOperator /*reductionOp*/,
+                            const array<size_t, N>& /*offsets*/,
+                            const SmallVector<size_t>& /*regularOpDims*/, const array<SmallVector<ptrdiff_t>, N>& /*regularStrides*/,
+                            const SmallVector<size_t>& /*reducingOpDims*/, const array<SmallVector<ptrdiff_t>, N>& /*reducingStrides*/)
+{
+    return false;
+}
+
+bool CPUTensorOpSimd(float beta, const array<float*, 2>& pointers, float alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                     const array<size_t, 2>& offsets,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides);
+
+bool CPUTensorOpSimd(float beta, const array<float*, 3>& pointers, float alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                     const array<size_t, 3>& offsets,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides);
+
+bool CPUTensorOpSimd(float beta, const array<float*, 4>& pointers, float alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                     const array<size_t, 4>& offsets,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+
+}}}
@@ -0,0 +1,94 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorSimdAVX2.cpp -- AVX2/FMA versions of the vectorized tensor-op kernels.
+// This file is compiled with AVX2 and FMA code generation enabled (see Makefile and Math.vcxproj), and must only be
+// entered after checking the CPU (see CPUTensorSimd.cpp). Do not include stdafx.h or any other CNTK/STL header here.
+//
+
+#include "CPUTensorSimdKernels.h"
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+
+#include <immintrin.h>
+#include "CPUTensorSimdKernelsImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace {
+
+// vector traits for 8 floats
+struct VecAVX2
+{
+    typedef __m256 Vec;
+    typedef __m256 Mask;
+    static const size_t Width = 8;
+
+    static Vec Load(const float* p)            { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Vec v)         { _mm256_storeu_ps(p, v); }
+    static Vec Set1(float x)                   { return _mm256_set1_ps(x); }
+    static Vec Zero()                          { return _mm256_setzero_ps(); }
+
+    static Vec Add(Vec a, Vec b)               { return _mm256_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b)               { return _mm256_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b)               { return _mm256_mul_ps(a, b); }
+    static Vec Div(Vec a, Vec b)               { return _mm256_div_ps(a, b); }
+    static Vec FMAdd(Vec a, Vec b, Vec c)      { return _mm256_fmadd_ps(a, b, c); } // a * b + c
+    static Vec Max(Vec a, Vec b)               { return _mm256_max_ps(a, b); }      // a > b ? a : b
+    static Vec Min(Vec a, Vec b)               { return _mm256_min_ps(a, b); }      // a < b ? a : b
+    static Vec Sqrt(Vec a)                     { return _mm256_sqrt_ps(a); }
+    static Vec Neg(Vec a)                      { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static Vec Abs(Vec a)                      { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static Vec CopySign(Vec mag, Vec sign)     { return _mm256_or_ps(Abs(mag), _mm256_and_ps(sign, _mm256_set1_ps(-0.0f))); }
+    static Vec Round(Vec a)                    { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Vec Floor(Vec a)                    { return _mm256_round_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    // 2^n for integral n within the normal exponent range
+    static Vec Pow2n(Vec n)                    { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23)); }
+
+    static Mask Gt(Vec a, Vec b)               { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask Lt(Vec a, Vec b)               { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask NotZero(Vec a)                 { return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_UQ); } // NaN counts as true, like in C
+    static Vec Select(Mask m, Vec t, Vec f)    { return _mm256_blendv_ps(f, t, m); }
+
+    // accumulation of floats in double precision
+    struct DoubleAcc { __m256d lo, hi; };
+    static DoubleAcc DoubleZero()              { DoubleAcc acc = { _mm256_setzero_pd(), _mm256_setzero_pd() }; return acc; }
+    static void DoubleAdd(DoubleAcc& acc, Vec v)
+    {
+        acc.lo = _mm256_add_pd(acc.lo, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        acc.hi = _mm256_add_pd(acc.hi, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+    static double DoubleSum(const DoubleAcc& acc)
+    {
+        double buffer[4];
+        _mm256_storeu_pd(buffer, _mm256_add_pd(acc.lo, acc.hi));
+        return (buffer[0] + buffer[1]) + (buffer[2] + buffer[3]);
+    }
+    static Vec DoubleToFloat(const DoubleAcc& acc)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(acc.lo)), _mm256_cvtpd_ps(acc.hi), 1);
+    }
+};
+
+}
+
+const CPUTensorSimdKernels* GetCPUTensorSimdKernelsAVX2()
+{
+    return SimdKernels::MakeCPUTensorSimdKernels<VecAVX2>();
+}
+
+}}}
+
+#else // compiler cannot generate AVX2 code for this target
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+const CPUTensorSimdKernels* GetCPUTensorSimdKernelsAVX2()
+{
+    return nullptr;
+}
+
+}}}
+
+#endif
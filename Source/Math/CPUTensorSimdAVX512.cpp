@@ -0,0 +1,103 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorSimdAVX512.cpp -- AVX-512 versions of the vectorized tensor-op kernels.
+// This file is compiled with AVX-512F code generation enabled (see Makefile and Math.vcxproj), and must only be
+// entered after checking the CPU (see CPUTensorSimd.cpp). Do not include stdafx.h or any other CNTK/STL header here.
+//
+
+#include "CPUTensorSimdKernels.h"
+
+#if defined(__AVX512F__)
+
+#if defined(__GNUC__) && !defined(__clang__)
+// gcc 12 falsely reports the _mm512_undefined_*() placeholders inside the AVX-512 intrinsics as uninitialized (gcc bug 105593)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#include "CPUTensorSimdKernelsImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace {
+
+// vector traits for 16 floats; only AVX-512F instructions are used
+struct VecAVX512
+{
+    typedef __m512 Vec;
+    typedef __mmask16 Mask;
+    static const size_t Width = 16;
+
+    static Vec Load(const float* p)            { return _mm512_loadu_ps(p); }
+    static void Store(float* p, Vec v)         { _mm512_storeu_ps(p, v); }
+    static Vec Set1(float x)                   { return _mm512_set1_ps(x); }
+    static Vec Zero()                          { return _mm512_setzero_ps(); }
+
+    static Vec Add(Vec a, Vec b)               { return _mm512_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b)               { return _mm512_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b)               { return _mm512_mul_ps(a, b); }
+    static Vec Div(Vec a, Vec b)               { return _mm512_div_ps(a, b); }
+    static Vec FMAdd(Vec a, Vec b, Vec c)      { return _mm512_fmadd_ps(a, b, c); } // a * b + c
+    static Vec Max(Vec a, Vec b)               { return _mm512_max_ps(a, b); }      // a > b ? a : b
+    static Vec Min(Vec a, Vec b)               { return _mm512_min_ps(a, b); }      // a < b ? a : b
+    static Vec Sqrt(Vec a)                     { return _mm512_sqrt_ps(a); }
+    // bitwise float ops (and/or/xor) need AVX-512DQ, so these go through the integer domain
+    static Vec Neg(Vec a)                      { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32((int)0x80000000))); }
+    static Vec Abs(Vec a)                      { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x7fffffff))); }
+    static Vec CopySign(Vec mag, Vec sign)
+    {
+        return _mm512_castsi512_ps(_mm512_ternarylogic_epi32(_mm512_castps_si512(mag), _mm512_castps_si512(sign), _mm512_set1_epi32(0x7fffffff), 0xe4)); // (mag & mask) | (sign & ~mask)
+    }
+    static Vec Round(Vec a)                    { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Vec Floor(Vec a)                    { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    // 2^n for integral n within the normal exponent range
+    static Vec Pow2n(Vec n)                    { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvttps_epi32(n), _mm512_set1_epi32(127)), 23)); }
+
+    static Mask Gt(Vec a, Vec b)               { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static Mask Lt(Vec a, Vec b)               { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static Mask NotZero(Vec a)                 { return _mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_NEQ_UQ); } // NaN counts as true, like in C
+    static Vec Select(Mask m, Vec t, Vec f)    { return _mm512_mask_blend_ps(m, f, t); }
+
+    // accumulation of floats in double precision
+    struct DoubleAcc { __m512d lo, hi; };
+    static DoubleAcc DoubleZero()              { DoubleAcc acc = { _mm512_setzero_pd(), _mm512_setzero_pd() }; return acc; }
+    static void DoubleAdd(DoubleAcc& acc, Vec v)
+    {
+        acc.lo = _mm512_add_pd(acc.lo, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+        acc.hi = _mm512_add_pd(acc.hi, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1))));
+    }
+    static double DoubleSum(const DoubleAcc& acc)
+    {
+        double buffer[8];
+        _mm512_storeu_pd(buffer, _mm512_add_pd(acc.lo, acc.hi));
+        return ((buffer[0] + buffer[1]) + (buffer[2] + buffer[3])) + ((buffer[4] + buffer[5]) + (buffer[6] + buffer[7]));
+    }
+    static Vec DoubleToFloat(const DoubleAcc& acc)
+    {
+        __m512d lo = _mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(acc.lo)));
+        return _mm512_castpd_ps(_mm512_insertf64x4(lo, _mm256_castps_pd(_mm512_cvtpd_ps(acc.hi)), 1));
+    }
+};
+
+}
+
+const CPUTensorSimdKernels* GetCPUTensorSimdKernelsAVX512()
+{
+    return SimdKernels::MakeCPUTensorSimdKernels<VecAVX512>();
+}
+
+}}}
+
+#else // compiler cannot generate AVX-512 code for this target
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+const CPUTensorSimdKernels* GetCPUTensorSimdKernelsAVX512()
+{
+    return nullptr;
+}
+
+}}}
+
+#endif
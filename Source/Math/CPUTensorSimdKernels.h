@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorSimdKernels.h -- interface between the SIMD tensor-op dispatcher (CPUTensorSimd.cpp) and the
+// instruction-set specific kernels (CPUTensorSimdAVX2.cpp, CPUTensorSimdAVX512.cpp).
+//
+// The kernel translation units are compiled with instruction-set specific compiler flags. To keep code
+// compiled for those instruction sets from leaking into the rest of the library (e.g. through an inline
+// function that the linker happens to pick from that translation unit), this header, and everything the
+// kernels include, must stay free of CNTK and STL headers.
+//
+#pragma once
+
+#include <stddef.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// The subset of ElementWiseOperator that has vectorized kernels.
+// The dispatcher maps ElementWiseOperator to this; anything not listed here takes the scalar path.
+enum class SimdOp : int
+{
+    None,
+    // unary
+    Copy, Negate, Abs, Sqr, Sqrt, Exp, LinearRectifier, Sigmoid, StableSigmoid, Tanh,
+    // binary
+    Sum, Difference, ElementwiseProduct, Max, Min, SqrOfDifference,
+    ElementwiseProductWithSigmoidDerivativeFromOutput, ElementwiseProductWithTanhDerivativeFromOutput,
+    ElementwiseProductWithLinearRectifierDerivativeFromOutput,
+    // ternary
+    Cond, Clip, ElementwiseProductWithExpOfDiff,
+    // reductions (only used as reduction op)
+    LogSum
+};
+
+// Vectorized kernels for one instruction set, all for float.
+// Elementwise kernels compute o[i] = alpha * op(a[i], ...) + beta * o[i] for 0 <= i < n (o[i] is not read if beta == 0).
+// The stride of an input is either 1 (contiguous) or 0 (the single value is broadcast); the output is always contiguous.
+struct CPUTensorSimdKernels
+{
+    void (*unary)(SimdOp op, size_t n, float beta, const float* a, ptrdiff_t strideA, float* o, float alpha);
+    void (*binary)(SimdOp op, size_t n, float beta, const float* a, ptrdiff_t strideA, const float* b, ptrdiff_t strideB, float* o, float alpha);
+    void (*ternary)(SimdOp op, size_t n, float beta, const float* a, ptrdiff_t strideA, const float* b, ptrdiff_t strideB, const float* c, ptrdiff_t strideC, float* o, float alpha);
+
+    // Reduces n contiguous values with reductionOp (Sum, Max, Min or LogSum).
+    // Sums are accumulated in double, like the scalar code does.
+    double (*reduce)(SimdOp reductionOp, size_t n, const float* a);
+
+    // Reduces across columns: o[i] = alpha * reduce_j(a[i + j * columnStride]) + beta * o[i] for 0 <= i < n, 0 <= j < numColumns.
+    // reductionOp is Sum, Max or Min.
+    void (*reduceColumns)(SimdOp reductionOp, size_t n, size_t numColumns, float beta, const float* a, ptrdiff_t columnStride, float* o, float alpha);
+};
+
+// Return nullptr if the kernels were not compiled for the instruction set (e.g. on non-x86 builds).
+// The caller must check the CPU for support before using them.
+const CPUTensorSimdKernels* GetCPUTensorSimdKernelsAVX2();
+const CPUTensorSimdKernels* GetCPUTensorSimdKernelsAVX512();
+
+}}}
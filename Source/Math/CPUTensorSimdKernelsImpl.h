@@ -0,0 +1,402 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorSimdKernelsImpl.h -- instruction-set independent implementation of the vectorized tensor-op kernels.
+// It is included by the instruction-set specific translation units, each of which provides a vector traits class V
+// with the primitive operations, and then instantiates the kernels through MakeCPUTensorSimdKernels<V>().
+// See CPUTensorSimdKernels.h for why nothing but C headers may be included here.
+//
+#pragma once
+
+#include "CPUTensorSimdKernels.h"
+#include <math.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace SimdKernels {
+
+// -----------------------------------------------------------------------
+// vectorized math functions
+// -----------------------------------------------------------------------
+
+// exp(x), Cephes-style: x = n * ln(2) + r with |r| <= ln(2)/2, exp(r) by polynomial, then scaled by 2^n.
+// Accurate to about 2 ulp. Overflows to +inf and underflows to 0 like expf(); NaN is propagated.
+template <class V>
+static inline typename V::Vec Exp(typename V::Vec x)
+{
+    typedef typename V::Vec Vec;
+    // note: operand order matters so that NaN passes through (max/min return their second operand if unordered)
+    x = V::Min(V::Set1(89.0f), V::Max(V::Set1(-104.0f), x));
+    Vec n = V::Round(V::Mul(x, V::Set1(1.44269504088896341f)));
+    // r = x - n * ln(2), with ln(2) split into two parts for precision
+    Vec r = V::FMAdd(n, V::Set1(-0.693359375f), x);
+    r = V::FMAdd(n, V::Set1(2.12194440e-4f), r);
+    Vec p = V::Set1(1.9875691500e-4f);
+    p = V::FMAdd(p, r, V::Set1(1.3981999507e-3f));
+    p = V::FMAdd(p, r, V::Set1(8.3334519073e-3f));
+    p = V::FMAdd(p, r, V::Set1(4.1665795894e-2f));
+    p = V::FMAdd(p, r, V::Set1(1.6666665459e-1f));
+    p = V::FMAdd(p, r, V::Set1(5.0000001201e-1f));
+    p = V::FMAdd(p, V::Mul(r, r), V::Add(r, V::Set1(1.0f)));
+    // scale by 2^n in two steps, so that results near the overflow and underflow limits are correct
+    Vec n1 = V::Floor(V::Mul(n, V::Set1(0.5f)));
+    Vec n2 = V::Sub(n, n1);
+    return V::Mul(V::Mul(p, V::Pow2n(n1)), V::Pow2n(n2));
+}
+
+template <class V>
+static inline typename V::Vec Sigmoid(typename V::Vec x)
+{
+    // same (numerically not ideal) formulation as the scalar Sigmoid() in TensorOps.h
+    return V::Div(V::Set1(1.0f), V::Add(Exp<V>(V::Neg(x)), V::Set1(1.0f)));
+}
+
+template <class V>
+static inline typename V::Vec StableSigmoid(typename V::Vec x)
+{
+    typename V::Vec q = Exp<V>(V::Neg(V::Abs(x)));
+    typename V::Vec numer = V::Select(V::Gt(x, V::Zero()), V::Set1(1.0f), q);
+    return V::Div(numer, V::Add(V::Set1(1.0f), q));
+}
+
+template <class V>
+static inline typename V::Vec Tanh(typename V::Vec x)
+{
+    typedef typename V::Vec Vec;
+    Vec ax = V::Abs(x);
+    // large |x|: tanh(|x|) = (1 - exp(-2|x|)) / (1 + exp(-2|x|))
+    Vec e = Exp<V>(V::Mul(ax, V::Set1(-2.0f)));
+    Vec large = V::Div(V::Sub(V::Set1(1.0f), e), V::Add(V::Set1(1.0f), e));
+    large = V::CopySign(large, x);
+    // small |x|: odd polynomial (Cephes tanhf), which avoids the cancellation in 1 - exp(-2|x|)
+    Vec z = V::Mul(x, x);
+    Vec p = V::Set1(-5.70498872745e-3f);
+    p = V::FMAdd(p, z, V::Set1(2.06390887954e-2f));
+    p = V::FMAdd(p, z, V::Set1(-5.37397155531e-2f));
+    p = V::FMAdd(p, z, V::Set1(1.33314422036e-1f));
+    p = V::FMAdd(p, z, V::Set1(-3.33332819422e-1f));
+    Vec small = V::FMAdd(V::Mul(p, z), x, x);
+    return V::Select(V::Lt(ax, V::Set1(0.625f)), small, large);
+}
+
+// -----------------------------------------------------------------------
+// elementwise loops
+// -----------------------------------------------------------------------
+
+// An input of an elementwise op: either contiguous (stride 1) or a broadcast scalar (stride 0).
+template <class V>
+struct Operand
+{
+    const float* m_data;
+    bool m_broadcast;
+    typename V::Vec m_value; // the broadcast value
+
+    Operand(const float* data, ptrdiff_t stride)
+        : m_data(data), m_broadcast(stride == 0), m_value(V::Set1(*data))
+    {}
+
+    typename V::Vec Load(size_t i) const
+    {
+        return m_broadcast ? m_value : V::Load(m_data + i);
+    }
+
+    // loads the last, partial vector
+    typename V::Vec LoadPartial(size_t i, size_t count) const
+    {
+        if (m_broadcast)
+            return m_value;
+        float buffer[V::Width] = {};
+        for (size_t k = 0; k < count; k++)
+            buffer[k] = m_data[i + k];
+        return V::Load(buffer);
+    }
+};
+
+template <class V>
+static inline typename V::Vec ScaleAndCombine(typename V::Vec val, float beta, const float* pout, float alpha)
+{
+    // same order of operations as the scalar TensorOpIteration: val *= alpha; val += beta * out
+    if (alpha != 1)
+        val = V::Mul(val, V::Set1(alpha));
+    if (beta != 0)
+        val = V::FMAdd(V::Set1(beta), V::Load(pout), val);
+    return val;
+}
+
+// Loop over all elements, computing o = alpha * compute(i) + beta * o.
+// 'compute' takes the element offset and the number of valid elements (Width except for the tail) and returns the op result.
+template <class V, typename ComputeFn>
+static inline void ElementwiseLoop(size_t n, float beta, float* o, float alpha, const ComputeFn& compute)
+{
+    const size_t W = V::Width;
+    size_t i = 0;
+    for (; i + W <= n; i += W)
+        V::Store(o + i, ScaleAndCombine<V>(compute(i, W), beta, o + i, alpha));
+    if (i < n)
+    {
+        size_t count = n - i;
+        float buffer[V::Width] = {};
+        for (size_t k = 0; k < count; k++)
+            buffer[k] = o[i + k];
+        V::Store(buffer, ScaleAndCombine<V>(compute(i, count), beta, buffer, alpha));
+        for (size_t k = 0; k < count; k++)
+            o[i + k] = buffer[k];
+    }
+}
+
+template <class V, typename OPFN>
+static inline void UnaryLoop(size_t n, float beta, const Operand<V>& a, float* o, float alpha, const OPFN& opfn)
+{
+    ElementwiseLoop<V>(n, beta, o, alpha, [&](size_t i, size_t count)
+    {
+        return opfn(count == V::Width ? a.Load(i) : a.LoadPartial(i, count));
+    });
+}
+
+template <class V, typename OPFN>
+static inline void BinaryLoop(size_t n, float beta, const Operand<V>& a, const Operand<V>& b, float* o, float alpha, const OPFN& opfn)
+{
+    ElementwiseLoop<V>(n, beta, o, alpha, [&](size_t i, size_t count)
+    {
+        if (count == V::Width)
+            return opfn(a.Load(i), b.Load(i));
+        else
+            return opfn(a.LoadPartial(i, count), b.LoadPartial(i, count));
+    });
+}
+
+template <class V, typename OPFN>
+static inline void TernaryLoop(size_t n, float beta, const Operand<V>& a, const Operand<V>& b, const Operand<V>& c, float* o, float alpha, const OPFN& opfn)
+{
+    ElementwiseLoop<V>(n, beta, o, alpha, [&](size_t i, size_t count)
+    {
+        if (count == V::Width)
+            return opfn(a.Load(i), b.Load(i), c.Load(i));
+        else
+            return opfn(a.LoadPartial(i, count), b.LoadPartial(i, count), c.LoadPartial(i, count));
+    });
+}
+
+// -----------------------------------------------------------------------
+// kernels
+// -----------------------------------------------------------------------
+
+template <class V>
+static void Unary(SimdOp op, size_t n, float beta, const float* pa, ptrdiff_t strideA, float* o, float alpha)
+{
+    typedef typename V::Vec Vec;
+    Operand<V> a(pa, strideA);
+    switch (op)
+    {
+    case SimdOp::Copy:            return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return x; });
+    case SimdOp::Negate:          return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return V::Neg(x); });
+    case SimdOp::Abs:             return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return V::Abs(x); });
+    case SimdOp::Sqr:             return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return V::Mul(x, x); });
+    case SimdOp::Sqrt:            return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return V::Sqrt(V::Max(x, V::Zero())); }); // clips to 0 like the scalar Sqrt()
+    case SimdOp::Exp:             return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return Exp<V>(x); });
+    case SimdOp::LinearRectifier: return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return V::Max(x, V::Zero()); });
+    case SimdOp::Sigmoid:         return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return Sigmoid<V>(x); });
+    case SimdOp::StableSigmoid:   return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return StableSigmoid<V>(x); });
+    case SimdOp::Tanh:            return UnaryLoop<V>(n, beta, a, o, alpha, [](Vec x) { return Tanh<V>(x); });
+    default: break; // the dispatcher only passes ops of the right arity
+    }
+}
+
+template <class V>
+static void Binary(SimdOp op, size_t n, float beta, const float* pa, ptrdiff_t strideA, const float* pb, ptrdiff_t strideB, float* o, float alpha)
+{
+    typedef typename V::Vec Vec;
+    Operand<V> a(pa, strideA);
+    Operand<V> b(pb, strideB);
+    switch (op)
+    {
+    case SimdOp::Sum:                return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Add(x, y); });
+    case SimdOp::Difference:         return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Sub(x, y); });
+    case SimdOp::ElementwiseProduct: return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Mul(x, y); });
+    case SimdOp::Max:                return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Max(x, y); });
+    case SimdOp::Min:                return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Min(x, y); });
+    case SimdOp::SqrOfDifference:    return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { Vec d = V::Sub(x, y); return V::Mul(d, d); });
+    case SimdOp::ElementwiseProductWithSigmoidDerivativeFromOutput:
+        return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Mul(x, V::Mul(y, V::Sub(V::Set1(1.0f), y))); });
+    case SimdOp::ElementwiseProductWithTanhDerivativeFromOutput:
+        return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Mul(x, V::Sub(V::Set1(1.0f), V::Mul(y, y))); });
+    case SimdOp::ElementwiseProductWithLinearRectifierDerivativeFromOutput:
+        return BinaryLoop<V>(n, beta, a, b, o, alpha, [](Vec x, Vec y) { return V::Select(V::Gt(y, V::Zero()), x, V::Zero()); });
+    default: break;
+    }
+}
+
+template <class V>
+static void Ternary(SimdOp op, size_t n, float beta, const float* pa, ptrdiff_t strideA, const float* pb, ptrdiff_t strideB, const float* pc, ptrdiff_t strideC, float* o, float alpha)
+{
+    typedef typename V::Vec Vec;
+    Operand<V> a(pa, strideA);
+    Operand<V> b(pb, strideB);
+    Operand<V> c(pc, strideC);
+    switch (op)
+    {
+    case SimdOp::Cond: // a ? b : c
+        return TernaryLoop<V>(n, beta, a, b, c, o, alpha, [](Vec x, Vec y, Vec z) { return V::Select(V::NotZero(x), y, z); });
+    case SimdOp::Clip: // clip c to [a, b]
+        return TernaryLoop<V>(n, beta, a, b, c, o, alpha, [](Vec x, Vec y, Vec z) { return V::Select(V::Lt(z, x), x, V::Select(V::Gt(z, y), y, z)); });
+    case SimdOp::ElementwiseProductWithExpOfDiff: // a * exp(b - c)
+        return TernaryLoop<V>(n, beta, a, b, c, o, alpha, [](Vec x, Vec y, Vec z) { return V::Mul(x, Exp<V>(V::Sub(y, z))); });
+    default: break;
+    }
+}
+
+template <class V>
+static double HorizontalMax(typename V::Vec v)
+{
+    float buffer[V::Width];
+    V::Store(buffer, v);
+    double result = buffer[0];
+    for (size_t k = 1; k < V::Width; k++)
+        result = buffer[k] > result ? buffer[k] : result;
+    return result;
+}
+
+template <class V>
+static double HorizontalMin(typename V::Vec v)
+{
+    float buffer[V::Width];
+    V::Store(buffer, v);
+    double result = buffer[0];
+    for (size_t k = 1; k < V::Width; k++)
+        result = buffer[k] < result ? buffer[k] : result;
+    return result;
+}
+
+template <class V>
+static double Reduce(SimdOp reductionOp, size_t n, const float* a)
+{
+    typedef typename V::Vec Vec;
+    const size_t W = V::Width;
+    size_t i = 0;
+    double result;
+    switch (reductionOp)
+    {
+    case SimdOp::Sum:
+    {
+        typename V::DoubleAcc acc = V::DoubleZero();
+        for (; i + W <= n; i += W)
+            V::DoubleAdd(acc, V::Load(a + i));
+        result = V::DoubleSum(acc);
+        for (; i < n; i++)
+            result += a[i];
+        return result;
+    }
+    case SimdOp::Max:
+    case SimdOp::LogSum:
+    {
+        if (n < W)
+        {
+            result = a[0];
+            for (i = 1; i < n; i++)
+                result = a[i] > result ? a[i] : result;
+        }
+        else
+        {
+            Vec acc = V::Load(a);
+            for (i = W; i + W <= n; i += W)
+                acc = V::Max(V::Load(a + i), acc);
+            result = HorizontalMax<V>(acc);
+            for (; i < n; i++)
+                result = a[i] > result ? a[i] : result;
+        }
+        if (reductionOp == SimdOp::Max)
+            return result;
+        // log(sum(exp(a))) = max + log(sum(exp(a - max)))
+        if (result - result != 0) // all -inf, or some +inf (or NaN)
+            return result;
+        float maxValue = (float)result;
+        Vec vmax = V::Set1(maxValue);
+        typename V::DoubleAcc acc = V::DoubleZero();
+        for (i = 0; i + W <= n; i += W)
+            V::DoubleAdd(acc, Exp<V>(V::Sub(V::Load(a + i), vmax)));
+        double sum = V::DoubleSum(acc);
+        for (; i < n; i++)
+            sum += exp((double)a[i] - maxValue);
+        return maxValue + log(sum);
+    }
+    case SimdOp::Min:
+    {
+        if (n < W)
+        {
+            result = a[0];
+            for (i = 1; i < n; i++)
+                result = a[i] < result ? a[i] : result;
+            return result;
+        }
+        Vec acc = V::Load(a);
+        for (i = W; i + W <= n; i += W)
+            acc = V::Min(V::Load(a + i), acc);
+        result = HorizontalMin<V>(acc);
+        for (; i < n; i++)
+            result = a[i] < result ? a[i] : result;
+        return result;
+    }
+    default:
+        return 0;
+    }
+}
+
+template <class V>
+static void ReduceColumns(SimdOp reductionOp, size_t n, size_t numColumns, float beta, const float* a, ptrdiff_t columnStride, float* o, float alpha)
+{
+    typedef typename V::Vec Vec;
+    const size_t W = V::Width;
+    size_t i = 0;
+    for (; i + W <= n; i += W)
+    {
+        const float* pa = a + i;
+        Vec val;
+        if (reductionOp == SimdOp::Sum)
+        {
+            typename V::DoubleAcc acc = V::DoubleZero();
+            for (size_t j = 0; j < numColumns; j++, pa += columnStride)
+                V::DoubleAdd(acc, V::Load(pa));
+            val = V::DoubleToFloat(acc);
+        }
+        else
+        {
+            val = V::Load(pa);
+            pa += columnStride;
+            if (reductionOp == SimdOp::Max)
+                for (size_t j = 1; j < numColumns; j++, pa += columnStride)
+                    val = V::Max(V::Load(pa), val);
+            else
+                for (size_t j = 1; j < numColumns; j++, pa += columnStride)
+                    val = V::Min(V::Load(pa), val);
+        }
+        V::Store(o + i, ScaleAndCombine<V>(val, beta, o + i, alpha));
+    }
+    // remaining rows one by one
+    for (; i < n; i++)
+    {
+        const float* pa = a + i;
+        double aggregate = *pa;
+        for (size_t j = 1; j < numColumns; j++)
+        {
+            pa += columnStride;
+            if (reductionOp == SimdOp::Sum)
+                aggregate += *pa;
+            else if (reductionOp == SimdOp::Max)
+                aggregate = *pa > aggregate ? *pa : aggregate;
+            else
+                aggregate = *pa < aggregate ? *pa : aggregate;
+        }
+        float val = (float)aggregate * alpha;
+        if (beta != 0)
+            val += beta * o[i];
+        o[i] = val;
+    }
+}
+
+template <class V>
+static const CPUTensorSimdKernels* MakeCPUTensorSimdKernels()
+{
+    static const CPUTensorSimdKernels kernels = { &Unary<V>, &Binary<V>, &Ternary<V>, &Reduce<V>, &ReduceColumns<V> };
+    return &kernels;
+}
+
+}}}}
@@ -254,6 +254,8 @@ enum MatrixFlags
     matrixFlagSetValueOnDevice = 1 << bitPosSetValueOnDevice, // SetValue() call has a buffer that is already on the device
 };
 
+struct CPUSparseTransposedIndex; // defined in CPUSparseMatrix.h
+
 // -----------------------------------------------------------------------
 // BaseMatrixStorage -- base class for all matrix types (CPU, GPU) x (dense, sparse)
 // -----------------------------------------------------------------------
@@ -287,6 +289,8 @@ public:
 
     void ReleaseMemory()
     {
+        SetTransposedIndexCache(nullptr);
+
         if (!m_externalBuffer)
         {
             if (m_computeDevice < 0)
@@ -389,6 +393,9 @@ protected:
 
     CPUSPARSE_INDEX_TYPE* GetUnCompIndex() const { return m_unCompIndex; }
     void SetUnCompIndex(CPUSPARSE_INDEX_TYPE* parray) { m_unCompIndex = parray; }
+    // the index is replaced as a whole, atomically, so that concurrent readers of the storage can use it
+    std::shared_ptr<const CPUSparseTransposedIndex> GetTransposedIndexCache() const { return std::atomic_load(&m_transposedIndex); }
+    void SetTransposedIndexCache(const std::shared_ptr<const CPUSparseTransposedIndex>& index) const { std::atomic_store(&m_transposedIndex, index); }
     
     CPUSPARSE_INDEX_TYPE* GetCompIndex() const { return m_compIndex; }
     void SetCompIndex(CPUSPARSE_INDEX_TYPE* parray) { m_compIndex = parray; }
@@ -415,6 +422,7 @@ protected:
         m_compIndex                = nullptr; // begin ids of col/row in CSC/CSR format
         m_blockIds                 = nullptr; // block ids
         m_blockIdShift             = 0; // used to get efficient slice, actual col = blockIds[j] - m_blockIdShift
+        m_transposedIndex          = nullptr; // CSR index of a CSC matrix, built on demand
     }
 
 protected:
@@ -460,6 +468,7 @@ protected:
     size_t* m_blockIds;    // block ids
     size_t m_blockIdShift; // used to get efficient slice, actual col = blockIds[j] - m_blockIdShift
 
+    mutable std::shared_ptr<const CPUSparseTransposedIndex> m_transposedIndex; // see CPUSparseMatrix::GetTransposedIndex()
 };
 
 // -----------------------------------------------------------------------
@@ -583,6 +592,8 @@ protected:
 
     CPUSPARSE_INDEX_TYPE* GetUnCompIndex() const { return m_sob->GetUnCompIndex(); }
     void SetUnCompIndex(CPUSPARSE_INDEX_TYPE* parray) { m_sob->SetUnCompIndex(parray); }
+    std::shared_ptr<const CPUSparseTransposedIndex> GetTransposedIndexCache() const { return m_sob->GetTransposedIndexCache(); }
+    void SetTransposedIndexCache(const std::shared_ptr<const CPUSparseTransposedIndex>& index) const { m_sob->SetTransposedIndexCache(index); }
     
     CPUSPARSE_INDEX_TYPE* GetCompIndex() const { return m_sob->GetCompIndex(); }
     void SetCompIndex(CPUSPARSE_INDEX_TYPE* parray) { m_sob->SetCompIndex(parray); }
@@ -1151,6 +1151,562 @@ public:
     }
 };
 
+//------------------------------------------------------------------
+// Dimensions of a plain 2D convolution on CPU: [W x H x C] input, K kernels of [X x Y x C], full sharing,
+// no dilation and a single group. This is the configuration covered by the direct and Winograd engines below.
+//------------------------------------------------------------------
+struct Conv2DDims
+{
+    int inW, inH, inC;
+    int outW, outH, outK;
+    int kernelW, kernelH;
+    int strideW, strideH;
+    int padW, padH; // input coordinate of the first kernel cell for output (0, 0) is (-padW, -padH)
+
+    // Returns false if the geometry is not a plain 2D convolution.
+    static bool FromGeometry(const ConvolveGeometry& g, Conv2DDims& dims)
+    {
+        const auto& inT = g.InputShape();
+        const auto& kernT = g.KernelShape();
+        const auto& outT = g.OutputShape();
+        if (inT.GetRank() != 3 || kernT.GetRank() != 3 || outT.GetRank() != 3 || g.Groups() != 1)
+            return false;
+        if (find(begin(g.Sharing()), end(g.Sharing()), false) != end(g.Sharing()))
+            return false;
+        for (size_t i = 0; i < 3; i++)
+        {
+            if (g.GetDilation(i) != 1)
+                return false;
+        }
+        // Kernels must span all input channels, and there must be a single output position along the channel axis.
+        if (kernT[2] != inT[2] || g.GetMapCount(0) != 1 || g.GetMapCount(1) != 1 || outT[2] != g.GetMapCount(2) || g.GetLowerPad(2) != 0)
+            return false;
+
+        dims.inW = (int)inT[0];
+        dims.inH = (int)inT[1];
+        dims.inC = (int)inT[2];
+        dims.outW = (int)outT[0];
+        dims.outH = (int)outT[1];
+        dims.outK = (int)outT[2];
+        dims.kernelW = (int)kernT[0];
+        dims.kernelH = (int)kernT[1];
+        dims.strideW = (int)g.GetStride(0);
+        dims.strideH = (int)g.GetStride(1);
+        dims.padW = g.GetLowerPad(0);
+        dims.padH = g.GetLowerPad(1);
+        return true;
+    }
+};
+
+//------------------------------------------------------------------
+// Direct convolution engine implementation.
+// Computes the forward pass straight from the input without unrolling it, which saves the [XYC x NW'H'] buffer
+// of the GEMM engine. Each task computes one output row of a block of MapBlock feature maps. In the interior of the
+// row, where all kernel cells fall inside the image, outputs are computed in register tiles of MapBlock maps by
+// XBlock positions, so that every input cell loaded is used MapBlock times. The borders are accumulated row by row.
+// Backward passes and pooling are inherited from the GEMM engine.
+//------------------------------------------------------------------
+template <class ElemType>
+class DirectConvolutionEngine : public GemmConvolutionEngine<ElemType>
+{
+public:
+    using Base = GemmConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    DirectConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)
+    {
+    }
+
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry)
+    {
+        Conv2DDims dims;
+        return deviceId < 0 && Conv2DDims::FromGeometry(*geometry, dims);
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+
+    // Size of the register tiles: feature maps by output positions.
+    static const int MapBlock = 4;
+    static const int XBlock = 8;
+
+    void EnsureCompatible() override
+    {
+        Base::EnsureCompatible();
+        if (!IsSupported(m_deviceId, m_geometry))
+            LogicError("Direct convolution engine supports only 2D convolutions with full sharing, no dilation and a single group. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    // out[x, y, k] = sum_{i, j, c} in[x * strideW + i - padW, y * strideH + j - padH, c] * kernel[i, j, c, k],
+    // where out-of-range input cells are zero.
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& /*workspace*/) override
+    {
+        Conv2DDims d;
+        Conv2DDims::FromGeometry(*m_geometry, d);
+
+        const int batchSize = (int)in.GetNumCols();
+        const int numMapBlocks = (d.outK + MapBlock - 1) / MapBlock;
+        const int numTasks = batchSize * numMapBlocks * d.outH;
+        const size_t inSize = (size_t)d.inW * d.inH * d.inC;
+        const size_t outSize = (size_t)d.outW * d.outH * d.outK;
+        const size_t kernelSize = (size_t)d.kernelW * d.kernelH * d.inC;
+        const ElemType* inData = in.Data();
+        const ElemType* kernelData = kernel.Data();
+        ElemType* outData = out.Data();
+
+        // Interior of an output row: all x in [interiorBegin, interiorEnd) read only input cells inside the image.
+        // It is covered by whole register tiles up to tiledEnd; the rest of the row is handled as border.
+        const int interiorBegin = d.padW > 0 ? (d.padW + d.strideW - 1) / d.strideW : 0;
+        const int interiorEnd = d.inW - d.kernelW + d.padW < 0 ? 0 : min(d.outW, (d.inW - d.kernelW + d.padW) / d.strideW + 1);
+        const int numTiles = interiorEnd > interiorBegin ? (interiorEnd - interiorBegin) / XBlock : 0;
+        const int tiledEnd = interiorBegin + numTiles * XBlock;
+
+#pragma omp parallel for schedule(static) if ((double)numTasks * d.outW * kernelSize >= (1 << 16))
+        for (int task = 0; task < numTasks; task++)
+        {
+            const int y = task % d.outH;
+            const int mapBlock = (task / d.outH) % numMapBlocks;
+            const int sample = task / (d.outH * numMapBlocks);
+            const int firstMap = mapBlock * MapBlock;
+            const int numMaps = min((int)MapBlock, d.outK - firstMap);
+            const ElemType* inSample = inData + sample * inSize;
+            const ElemType* kernels = kernelData + firstMap * kernelSize;
+
+            // Kernel rows that fall inside the image for this output row.
+            const int jBegin = max(0, d.padH - y * d.strideH);
+            const int jEnd = min(d.kernelH, d.inH + d.padH - y * d.strideH);
+
+            ElemType* outRows[MapBlock];
+            for (int q = 0; q < numMaps; q++)
+                outRows[q] = outData + sample * outSize + ((size_t)(firstMap + q) * d.outH + y) * d.outW;
+
+            if (numMaps == MapBlock)
+            {
+                for (int tile = 0; tile < numTiles; tile++)
+                {
+                    const int x0 = interiorBegin + tile * XBlock;
+                    const ElemType* tileIn = inSample + (y * d.strideH - d.padH) * d.inW + x0 * d.strideW - d.padW;
+                    if (d.strideW == 1)
+                        ComputeTile<1>(d, tileIn, kernels, kernelSize, jBegin, jEnd, outRows, x0);
+                    else
+                        ComputeTile<0>(d, tileIn, kernels, kernelSize, jBegin, jEnd, outRows, x0);
+                }
+                AccumulateBorder<MapBlock>(d, inSample, y, kernels, kernelSize, jBegin, jEnd, outRows, 0, interiorBegin < tiledEnd ? interiorBegin : d.outW);
+                if (interiorBegin < tiledEnd)
+                    AccumulateBorder<MapBlock>(d, inSample, y, kernels, kernelSize, jBegin, jEnd, outRows, tiledEnd, d.outW);
+            }
+            else
+            {
+                for (int q = 0; q < numMaps; q++)
+                    AccumulateBorder<1>(d, inSample, y, kernels + q * kernelSize, kernelSize, jBegin, jEnd, outRows + q, 0, d.outW);
+            }
+        }
+    }
+
+    // Computes outRows[q][x0 + p] for a register tile of MapBlock maps by XBlock positions.
+    // in points to the input cell for kernel cell (0, 0), channel 0 of output x0; all cells read must be inside the image.
+    // StrideW is the horizontal stride if it is known at compile time (so that the input loads vectorize), or 0.
+    template <int StrideW>
+    static void ComputeTile(const Conv2DDims& d, const ElemType* in, const ElemType* kernels, size_t kernelSize, int jBegin, int jEnd, ElemType* const* outRows, int x0)
+    {
+        ElemType acc[MapBlock][XBlock] = {};
+        const size_t planeSize = (size_t)d.inW * d.inH;
+        for (int c = 0; c < d.inC; c++)
+        {
+            for (int j = jBegin; j < jEnd; j++)
+            {
+                const ElemType* inRow = in + c * planeSize + j * d.inW;
+                const ElemType* weights = kernels + ((size_t)c * d.kernelH + j) * d.kernelW;
+                for (int i = 0; i < d.kernelW; i++)
+                {
+                    ElemType v[XBlock];
+                    for (int p = 0; p < XBlock; p++)
+                        v[p] = inRow[p * (StrideW ? StrideW : d.strideW) + i];
+                    for (int q = 0; q < MapBlock; q++)
+                    {
+                        const ElemType w = weights[q * kernelSize + i];
+                        for (int p = 0; p < XBlock; p++)
+                            acc[q][p] += w * v[p];
+                    }
+                }
+            }
+        }
+        for (int q = 0; q < MapBlock; q++)
+            for (int p = 0; p < XBlock; p++)
+                outRows[q][x0 + p] = acc[q][p];
+    }
+
+    // Computes outRows[q][x] for xBegin <= x < xEnd and 0 <= q < NumMaps, skipping kernel cells outside the image.
+    template <int NumMaps>
+    static void AccumulateBorder(const Conv2DDims& d, const ElemType* inSample, int y, const ElemType* kernels, size_t kernelSize, int jBegin, int jEnd,
+                                 ElemType* const* outRows, int xBegin, int xEnd)
+    {
+        if (xBegin >= xEnd)
+            return;
+        for (int q = 0; q < NumMaps; q++)
+            std::fill(outRows[q] + xBegin, outRows[q] + xEnd, (ElemType)0);
+
+        for (int c = 0; c < d.inC; c++)
+        {
+            for (int j = jBegin; j < jEnd; j++)
+            {
+                const ElemType* inRow = inSample + ((size_t)c * d.inH + y * d.strideH + j - d.padH) * d.inW;
+                for (int i = 0; i < d.kernelW; i++)
+                {
+                    // Range of x for which the input cell x * strideW + i - padW is inside the image.
+                    const int offset = i - d.padW;
+                    const int first = max(xBegin, offset >= 0 ? 0 : (-offset + d.strideW - 1) / d.strideW);
+                    const int last = d.inW - 1 - offset < 0 ? 0 : min(xEnd, (d.inW - 1 - offset) / d.strideW + 1);
+                    ElemType w[NumMaps];
+                    for (int q = 0; q < NumMaps; q++)
+                        w[q] = kernels[q * kernelSize + ((size_t)c * d.kernelH + j) * d.kernelW + i];
+                    for (int x = first; x < last; x++)
+                    {
+                        const ElemType v = inRow[x * d.strideW + offset];
+                        for (int q = 0; q < NumMaps; q++)
+                            outRows[q][x] += w[q] * v;
+                    }
+                }
+            }
+        }
+    }
+};
+
+//------------------------------------------------------------------
+// Winograd convolution engine implementation.
+// Computes 3x3 stride-1 convolutions with the minimal filtering algorithm F(m x m, 3 x 3) (Lavin & Gray, 2015),
+// with output tiles of m = 2 or m = 4. Every (m + 2) x (m + 2) input tile and every kernel is transformed into the
+// Winograd domain, where the convolution becomes (m + 2)^2 independent [K x C] * [C x tiles] matrix products.
+// The transformed inputs and outputs take (m + 2)^2 / m^2 times the size of input and output,
+// compared to the 9 times the input size of the GEMM engine's unrolled input.
+// F(4x4, 3x3) needs 4 times fewer multiplications than direct convolution, F(2x2, 3x3) 2.25 times,
+// but F(4x4, 3x3) is numerically less accurate. Backward passes and pooling are inherited from the GEMM engine.
+//------------------------------------------------------------------
+template <int TileSize>
+struct WinogradTransform;
+
+// Transform matrices for F(2x2, 3x3).
+template <>
+struct WinogradTransform<2>
+{
+    static const int Alpha = 4;
+    static const double BT[Alpha][Alpha];
+    static const double G[Alpha][3];
+    static const double AT[2][Alpha];
+};
+
+const double WinogradTransform<2>::BT[4][4] = { { 1, 0, -1, 0 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { 0, 1, 0, -1 } };
+const double WinogradTransform<2>::G[4][3] = { { 1, 0, 0 }, { 0.5, 0.5, 0.5 }, { 0.5, -0.5, 0.5 }, { 0, 0, 1 } };
+const double WinogradTransform<2>::AT[2][4] = { { 1, 1, 1, 0 }, { 0, 1, -1, -1 } };
+
+// Transform matrices for F(4x4, 3x3).
+template <>
+struct WinogradTransform<4>
+{
+    static const int Alpha = 6;
+    static const double BT[Alpha][Alpha];
+    static const double G[Alpha][3];
+    static const double AT[4][Alpha];
+};
+
+const double WinogradTransform<4>::BT[6][6] = { { 4, 0, -5, 0, 1, 0 }, { 0, -4, -4, 1, 1, 0 }, { 0, 4, -4, -1, 1, 0 },
+                                                { 0, -2, -1, 2, 1, 0 }, { 0, 2, -1, -2, 1, 0 }, { 0, 4, 0, -5, 0, 1 } };
+const double WinogradTransform<4>::G[6][3] = { { 1.0 / 4, 0, 0 }, { -1.0 / 6, -1.0 / 6, -1.0 / 6 }, { -1.0 / 6, 1.0 / 6, -1.0 / 6 },
+                                               { 1.0 / 24, 1.0 / 12, 1.0 / 6 }, { 1.0 / 24, -1.0 / 12, 1.0 / 6 }, { 0, 0, 1 } };
+const double WinogradTransform<4>::AT[4][6] = { { 1, 1, 1, 1, 1, 0 }, { 0, 1, -1, 2, -2, 0 }, { 0, 1, 1, 4, 4, 0 }, { 0, 1, -1, 8, -8, 1 } };
+
+template <class ElemType, int TileSize>
+class WinogradConvolutionEngine : public GemmConvolutionEngine<ElemType>
+{
+public:
+    using Base = GemmConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    WinogradConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)
+    {
+    }
+
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry)
+    {
+        Conv2DDims dims;
+        return deviceId < 0 && Conv2DDims::FromGeometry(*geometry, dims) &&
+               dims.kernelW == 3 && dims.kernelH == 3 && dims.strideW == 1 && dims.strideH == 1;
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_maxTempMemSizeInSamples;
+
+    using Transform = WinogradTransform<TileSize>;
+    static const int Alpha = Transform::Alpha;
+
+    void EnsureCompatible() override
+    {
+        Base::EnsureCompatible();
+        if (!IsSupported(m_deviceId, m_geometry))
+            LogicError("Winograd convolution engine supports only 2D 3x3 convolutions with stride 1, full sharing, no dilation and a single group. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    // The workspace holds, one after the other:
+    // 1. Transformed kernels U: Alpha^2 matrices of [C x K].
+    // 2. Transformed input tiles V: Alpha^2 matrices of [C x T], where T is the number of tiles in a sub-batch.
+    // 3. Products M = U^T * V: Alpha^2 matrices of [K x T], which are transformed back to output tiles.
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        Conv2DDims d;
+        Conv2DDims::FromGeometry(*m_geometry, d);
+
+        size_t batchSize = in.GetNumCols();
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+
+        const int tilesW = (d.outW + TileSize - 1) / TileSize;
+        const int tilesH = (d.outH + TileSize - 1) / TileSize;
+        const size_t tilesPerSample = (size_t)tilesW * tilesH;
+        const size_t numPoints = Alpha * Alpha;
+        const size_t C = d.inC;
+        const size_t K = d.outK;
+        const size_t kernTranSize = numPoints * C * K;
+        const size_t maxTiles = tilesPerSample * subBatchSize;
+        workspace.Resize(1, kernTranSize + numPoints * (C + K) * maxTiles);
+
+        // 1. Transform kernels: U[p, c, k] = (G g G^T)[p], where g is the 3x3 kernel of map k for input channel c.
+        ElemType* kernTran = workspace.Data();
+        const ElemType* kernelData = kernel.Data();
+#pragma omp parallel for
+        for (int ck = 0; ck < (int)(C * K); ck++)
+        {
+            const size_t c = ck % C;
+            const size_t k = ck / C;
+            ElemType g[3][3];
+            for (int j = 0; j < 3; j++)
+                for (int i = 0; i < 3; i++)
+                    g[j][i] = kernelData[k * 9 * C + (c * 3 + j) * 3 + i];
+            ElemType u[Alpha][Alpha];
+            TransformTile(Transform::G, g, u);
+            for (size_t p = 0; p < numPoints; p++)
+                kernTran[(p * K + k) * C + c] = u[p / Alpha][p % Alpha];
+        }
+
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            const size_t numTiles = tilesPerSample * curBatchSize;
+            const size_t inSize = in.GetNumRows();
+            const size_t outSize = out.GetNumRows();
+            const ElemType* inData = in.ColumnSlice(start, curBatchSize).Data();
+            ElemType* outData = out.ColumnSlice(start, curBatchSize).Data();
+            ElemType* inTran = workspace.Data() + kernTranSize;
+            ElemType* outTran = inTran + numPoints * C * numTiles;
+
+            // 2. Transform input tiles: V[p, c, t] = (B^T d B)[p], where d is the (zero padded) input tile t of channel c.
+#pragma omp parallel for
+            for (int t = 0; t < (int)numTiles; t++)
+            {
+                const size_t sample = t / tilesPerSample;
+                const int tileY = (int)(t % tilesPerSample) / tilesW;
+                const int tileX = (int)(t % tilesPerSample) % tilesW;
+                const int x0 = tileX * TileSize - d.padW;
+                const int y0 = tileY * TileSize - d.padH;
+                for (size_t c = 0; c < C; c++)
+                {
+                    const ElemType* inPlane = inData + sample * inSize + c * d.inH * d.inW;
+                    ElemType tile[Alpha][Alpha];
+                    for (int j = 0; j < Alpha; j++)
+                    {
+                        const int y = y0 + j;
+                        for (int i = 0; i < Alpha; i++)
+                        {
+                            const int x = x0 + i;
+                            tile[j][i] = (y >= 0 && y < d.inH && x >= 0 && x < d.inW) ? inPlane[y * d.inW + x] : 0;
+                        }
+                    }
+                    ElemType v[Alpha][Alpha];
+                    TransformTile(Transform::BT, tile, v);
+                    for (size_t p = 0; p < numPoints; p++)
+                        inTran[(p * numTiles + t) * C + c] = v[p / Alpha][p % Alpha];
+                }
+            }
+
+            // 3. Multiply in the Winograd domain: M[p] = U[p]^T * V[p] -> [K x T].
+            for (size_t p = 0; p < numPoints; p++)
+            {
+                auto u = workspace.ColumnSlice(p * C * K, C * K);
+                u.Reshape(C, K);
+                auto v = workspace.ColumnSlice(kernTranSize + p * C * numTiles, C * numTiles);
+                v.Reshape(C, numTiles);
+                auto m = workspace.ColumnSlice(kernTranSize + numPoints * C * numTiles + p * K * numTiles, K * numTiles);
+                m.Reshape(K, numTiles);
+                Mat::Multiply(u, true, v, false, m);
+            }
+
+            // 4. Transform back to output tiles: (A^T M A), clipped to the output.
+#pragma omp parallel for
+            for (int t = 0; t < (int)numTiles; t++)
+            {
+                const size_t sample = t / tilesPerSample;
+                const int tileY = (int)(t % tilesPerSample) / tilesW;
+                const int tileX = (int)(t % tilesPerSample) % tilesW;
+                const int x0 = tileX * TileSize;
+                const int y0 = tileY * TileSize;
+                const int tileW = min(TileSize, d.outW - x0);
+                const int tileH = min(TileSize, d.outH - y0);
+                for (size_t k = 0; k < K; k++)
+                {
+                    ElemType m[Alpha][Alpha];
+                    for (size_t p = 0; p < numPoints; p++)
+                        m[p / Alpha][p % Alpha] = outTran[(p * numTiles + t) * K + k];
+                    ElemType y[TileSize][TileSize];
+                    TransformTile(Transform::AT, m, y);
+                    ElemType* outPlane = outData + sample * outSize + k * d.outH * d.outW;
+                    for (int j = 0; j < tileH; j++)
+                        for (int i = 0; i < tileW; i++)
+                            outPlane[(y0 + j) * d.outW + x0 + i] = y[j][i];
+                }
+            }
+        }
+    }
+
+    // y = L x L^T for a square tile x.
+    template <int Rows, int Cols>
+    static void TransformTile(const double (&l)[Rows][Cols], const ElemType (&x)[Cols][Cols], ElemType (&y)[Rows][Rows])
+    {
+        ElemType lx[Rows][Cols];
+        for (int i = 0; i < Rows; i++)
+        {
+            for (int j = 0; j < Cols; j++)
+            {
+                ElemType sum = 0;
+                for (int q = 0; q < Cols; q++)
+                    sum += (ElemType)l[i][q] * x[q][j];
+                lx[i][j] = sum;
+            }
+        }
+        for (int i = 0; i < Rows; i++)
+        {
+            for (int j = 0; j < Rows; j++)
+            {
+                ElemType sum = 0;
+                for (int q = 0; q < Cols; q++)
+                    sum += lx[i][q] * (ElemType)l[j][q];
+                y[i][j] = sum;
+            }
+        }
+    }
+};
+
+//------------------------------------------------------------------
+// Autotuning convolution engine.
+// Holds a set of CPU engines that all support the geometry, times their forward pass on the first minibatch
+// and uses the fastest one from then on. Like the cuDNN engine, it tunes again when a larger minibatch comes in.
+// Backward passes and pooling go to the selected engine, all of which inherit them from the GEMM engine.
+//------------------------------------------------------------------
+template <class ElemType>
+class AutotunedConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+    using Candidate = std::pair<std::string, std::unique_ptr<Base>>;
+
+public:
+    AutotunedConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad,
+                               std::vector<Candidate>&& candidates, const std::wstring& logPrefix)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad),
+        m_candidates(std::move(candidates)), m_selected(0), m_tunedBatchSize(0), m_logPrefix(logPrefix)
+    {
+        assert(!m_candidates.empty());
+    }
+
+    void SetmMaxTempMemSizeInSamples(const size_t maxTempMemSizeInSamples) override
+    {
+        Base::SetmMaxTempMemSizeInSamples(maxTempMemSizeInSamples);
+        for (auto& candidate : m_candidates)
+            candidate.second->SetmMaxTempMemSizeInSamples(maxTempMemSizeInSamples);
+    }
+
+protected:
+    using Base::m_geometry;
+
+    // Each candidate checks compatibility and initializes itself when it is called.
+    void EnsureCompatible() override {}
+    void EnsureConvolutionInitialized() override {}
+    void EnsurePoolingInitialized() override {}
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        if (in.GetNumCols() > m_tunedBatchSize)
+            Autotune(in, kernel, out, workspace);
+        else
+            Selected().Forward(in, kernel, out, workspace);
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) override
+    {
+        Selected().BackwardData(srcGrad, kernel, grad, accumulateGradient, workspace);
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) override
+    {
+        Selected().BackwardKernel(srcGrad, in, kernelGrad, accumulateGradient, allowReuse, workspace);
+    }
+
+    void ForwardPoolingCore(const Mat& in, Mat& out) override
+    {
+        Selected().ForwardPooling(in, out);
+    }
+
+    void BackwardPoolingCore(const Mat& out, const Mat& srcGrad, const Mat& in, Mat& grad, bool accumulateGradient) override
+    {
+        Selected().BackwardPooling(out, srcGrad, in, grad, accumulateGradient);
+    }
+
+    void MaxUnpoolingCore(const Mat& out, const Mat& poolIn, Mat& in) override
+    {
+        Selected().MaxUnpooling(out, poolIn, in);
+    }
+
+private:
+    Base& Selected() { return *m_candidates[m_selected].second; }
+
+    // Runs every candidate once to warm it up (and to allocate its workspace) and once more to time it.
+    // The output of the last run is left in out, so this call also performs the forward pass.
+    void Autotune(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace)
+    {
+        std::vector<double> seconds(m_candidates.size());
+        for (size_t i = 0; i < m_candidates.size(); i++)
+        {
+            auto& engine = *m_candidates[i].second;
+            engine.Forward(in, kernel, out, workspace);
+            auto begin = std::chrono::steady_clock::now();
+            engine.Forward(in, kernel, out, workspace);
+            seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        }
+        m_selected = (size_t)(std::min_element(seconds.begin(), seconds.end()) - seconds.begin());
+        m_tunedBatchSize = in.GetNumCols();
+        if (m_selected != m_candidates.size() - 1)
+            Selected().Forward(in, kernel, out, workspace);
+
+        if (GetMathLibTraceLevel() > 0)
+        {
+            fprintf(stderr, "%lsautotuned convolution engine for minibatch size %d:", m_logPrefix.c_str(), (int)m_tunedBatchSize);
+            for (size_t i = 0; i < m_candidates.size(); i++)
+                fprintf(stderr, " %s %.3f ms%s", m_candidates[i].first.c_str(), seconds[i] * 1000, i == m_selected ? " (selected)" : "");
+            fprintf(stderr, ".\n");
+        }
+    }
+
+    std::vector<Candidate> m_candidates;
+    size_t m_selected;
+    size_t m_tunedBatchSize;
+    std::wstring m_logPrefix;
+};
+
 template <class ElemType>
 std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
                                                                                  ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
@@ -1191,6 +1747,49 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
 
     if (geometry->Groups() == 1)
     {
+        // Plain 2D convolutions on CPU can be computed by several engines. Which one is fastest depends on the
+        // geometry, the minibatch size and the machine, so let the autotuning engine time them on the first minibatch.
+        // The Winograd and direct engines round differently from GEMM, so they are only candidates if they are
+        // enabled explicitly (see ConvolutionEngineKind::AllWithAutotuning).
+        // Autotuning is skipped if deterministic algorithms are requested, as the choice could differ between runs.
+        if (poolKind == PoolKind::None && deviceId < 0 && imageLayout == ImageLayoutKind::CHW)
+        {
+            std::vector<typename AutotunedConvolutionEngine<ElemType>::Candidate> candidates;
+            auto addCandidate = [&](const char* name, std::unique_ptr<ConvolutionEngine<ElemType>>&& engine)
+            {
+                candidates.push_back(std::make_pair(std::string(name), std::move(engine)));
+            };
+            bool useGemm = isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry);
+            if (useGemm)
+                addCandidate("GEMM", std::make_unique<GemmConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad));
+            if (!(useGemm && forceDeterministicAlgorithms))
+            {
+                if (isEnabled(ConvolutionEngineKind::Direct) && DirectConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
+                    addCandidate("direct", std::make_unique<DirectConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad));
+                if (isEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType, 2>::IsSupported(deviceId, geometry))
+                {
+                    addCandidate("Winograd F(2x2,3x3)", std::make_unique<WinogradConvolutionEngine<ElemType, 2>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad));
+                    addCandidate("Winograd F(4x4,3x3)", std::make_unique<WinogradConvolutionEngine<ElemType, 4>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad));
+                }
+            }
+
+            if (candidates.size() > 1)
+            {
+                if (GetMathLibTraceLevel() > 0)
+                    fprintf(stderr, "%lsusing autotuned CPU convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+                return std::make_unique<AutotunedConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad,
+                                                                               std::move(candidates), logPrefix);
+            }
+            if (candidates.size() == 1 && !useGemm)
+            {
+                if (GetMathLibTraceLevel() > 0)
+                    fprintf(stderr, "%lsusing %s convolution engine for geometry: %s.\n", logPrefix.c_str(), candidates[0].first.c_str(), engStr.c_str());
+
+                return std::move(candidates[0].second);
+            }
+        }
+
         if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
         {
             if (GetMathLibTraceLevel() > 0)
@@ -22,8 +22,13 @@ enum class ConvolutionEngineKind
     CuDnn     = 1 << 1, // cuDNN, works only for 2D/3D convos with full sharing.
     Legacy    = 1 << 2, // Legacy, for backwards compatibility. REVIEW alexeyk: implement sparse version and remove Legacy altogether.
     Gemm      = 1 << 3, // Uses convolution unrolling+GEMM technique. Works only for convos with full sharing.
+    Winograd  = 1 << 4, // CPU only, Winograd F(2x2,3x3)/F(4x4,3x3). Works only for 2D 3x3 stride-1 convos with full sharing.
+    Direct    = 1 << 5, // CPU only, direct convolution without unrolling. Works only for 2D convos with full sharing.
 
-    All       = Reference | CuDnn | Legacy | Gemm
+    // The CPU engines above round differently from GEMM, so they are only used when enabled explicitly.
+    All       = Reference | CuDnn | Legacy | Gemm,
+    // All engines; CPU convolutions are then autotuned among GEMM, Winograd and direct.
+    AllWithAutotuning = All | Winograd | Direct
 };
 
 enum class PoolKind
@@ -68,7 +73,7 @@ public:
     DISABLE_COPY_AND_MOVE(ConvolutionEngine);
 
     // REVIEW alexeyk: This is not enough as there should be invalidation of auto-tuner state in cuDNN engine. Fine for now if it works.
-    void SetmMaxTempMemSizeInSamples(const size_t maxTempMemSizeInSamples)
+    virtual void SetmMaxTempMemSizeInSamples(const size_t maxTempMemSizeInSamples)
     {
         m_maxTempMemSizeInSamples = maxTempMemSizeInSamples;
     }
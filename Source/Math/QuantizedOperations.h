@@ -4,86 +4,278 @@
 //
 #pragma once
 #include "Quantizers.h"
+#include "CPUQuantizedGemm.h"
+#include <map>
+#include <mutex>
+#include <tuple>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Integer type that QuantizedMultiplier quantizes both matrices to
+enum class QuantizedPrecision
+{
+    Int16, // SymmetricQuantizer<ElemType, short>
+    Int8   // SymmetricQuantizer<ElemType, signed char>; half the memory traffic of Int16, at a lower precision
+};
+
+inline QuantizedPrecision QuantizedPrecisionFromString(const std::wstring& precision)
+{
+    if (precision == L"int16")
+        return QuantizedPrecision::Int16;
+    if (precision != L"int8")
+        InvalidArgument("Unknown quantized precision '%ls'. Supported values are 'int8' and 'int16'.", precision.c_str());
+    return QuantizedPrecision::Int8;
+}
+
+// How much quantization changed a matrix, e.g. the weights of a model (see QuantizedMultiplier::SetConstantA())
+struct QuantizationError
+{
+    double maxAbsValue;      // largest magnitude in the original matrix
+    double maxAbsError;      // largest absolute difference between original and de-quantized values
+    double relativeRmsError; // RMS of the differences, relative to the RMS of the original values
+};
 
 // Quantized product of two dense matrices A and B, where each matrix has its own quantizer.
 // This class handles quantization of both matrices, product and de-quantization of the result.
+// The product itself is computed by CPUQuantizedGemm(), for which A is kept packed row by row.
 // Other implementations should inherit from this class or extract common methods to the base class and inherit from the base.
 template <class ElemType>
 class QuantizedMultiplier
 {
-    // Quantizers for matrices A and B
-    shared_ptr<QuantizerBase<ElemType, short>> m_pQuantizerA;
-    shared_ptr<QuantizerBase<ElemType, short>> m_pQuantizerB;
+    // Quantizer and quantized values of one of the matrices
+    template <class QuantizedType>
+    struct Operand
+    {
+        shared_ptr<QuantizerBase<ElemType, QuantizedType>> quantizer;
+        vector<QuantizedType> values; // A: packed row by row; B: column-major, as given
+        size_t numRows = 0;
+        int maxAbs = 0;               // largest magnitude in values
+        bool isValid = false;         // values hold the current matrix (only tracked for constant matrices)
+    };
 
-    // Placeholders for quantized matrices A and B
-    vector<short> m_pMatA, m_pMatB;
+    QuantizedPrecision m_precision;
+    // A is held by pointer, so that multipliers with the same constant A can share its quantized values (see ShareConstantA())
+    shared_ptr<Operand<short>> m_a16;
+    shared_ptr<Operand<signed char>> m_a8;
+    Operand<short> m_b16;
+    Operand<signed char> m_b8;
+    size_t m_bitShiftA; // of the symmetric quantizer of A; SIZE_MAX if A has a quantizer given by the caller, which cannot be shared
+    bool m_isAShared;   // the quantized A is shared with other multipliers, so it must not be modified in place
 
     // Whether matrices A and B are constant (i.e. weights)
-    // If the matrix is constant, the size of the underlying container for quatized values will be preserved for
+    // If the matrix is constant, it is quantized only once, and the quantized values are preserved for
     // the lifespan of the object
     bool m_isAConstant;
     bool m_isBConstant;
 
-    bool m_firstPass;
+    // product before de-quantization if ElemType is not float
+    vector<float> m_product;
 
 public: 
     QuantizedMultiplier(shared_ptr<QuantizerBase<ElemType, short>> pQuantizerA, bool isAConstant, shared_ptr<QuantizerBase<ElemType, short>> pQuantizerB, bool isBConstant) :
-        m_pQuantizerA(pQuantizerA), m_pQuantizerB(pQuantizerB), m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
+        m_precision(QuantizedPrecision::Int16), m_a16(make_shared<Operand<short>>()), m_a8(make_shared<Operand<signed char>>()),
+        m_bitShiftA(SIZE_MAX), m_isAShared(false), m_isAConstant(isAConstant), m_isBConstant(isBConstant)
     {
         if (isAConstant && isBConstant)
             LogicError("Quantized multiplication is applied to two constant matrices -- it is highly inefficient. Better approach is to replace the operation with the resulting matrix.");
+        m_a16->quantizer = pQuantizerA;
+        m_b16.quantizer = pQuantizerB;
     };
     QuantizedMultiplier(shared_ptr<QuantizerBase<ElemType, short>> pQuantizerA, shared_ptr<QuantizerBase<ElemType, short>> pQuantizerB) :
         QuantizedMultiplier(pQuantizerA, false, pQuantizerB, false)
     {
     };
+    // Multiplier with symmetric quantizers of the given precision; see SymmetricQuantizer for bitShiftA and bitShiftB.
+    QuantizedMultiplier(QuantizedPrecision precision, size_t bitShiftA, size_t bitShiftB) :
+        m_precision(precision), m_a16(make_shared<Operand<short>>()), m_a8(make_shared<Operand<signed char>>()),
+        m_bitShiftA(bitShiftA), m_isAShared(false), m_isAConstant(false), m_isBConstant(false)
+    {
+        if (precision == QuantizedPrecision::Int8)
+        {
+            m_a8->quantizer = make_shared<SymmetricQuantizer<ElemType, signed char>>(bitShiftA);
+            m_b8.quantizer = make_shared<SymmetricQuantizer<ElemType, signed char>>(bitShiftB);
+        }
+        else
+        {
+            m_a16->quantizer = make_shared<SymmetricQuantizer<ElemType, short>>(bitShiftA);
+            m_b16.quantizer = make_shared<SymmetricQuantizer<ElemType, short>>(bitShiftB);
+        }
+    }
 
     // A[m,k]*B[k,n] = C[m,n]
     void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
+    {
+        if (m_precision == QuantizedPrecision::Int8)
+            Multiply(m_a8, m_b8, m, n, k, A, B, C);
+        else
+            Multiply(m_a16, m_b16, m, n, k, A, B, C);
+    }
+
+    // Marks A as constant and quantizes it right away, so that the first Multiply() does not have to.
+    // Call this again whenever the values of A change.
+    // Returns how much quantization changed A.
+    QuantizationError SetConstantA(int m, int k, const ElemType* A)
+    {
+        if (m_isBConstant)
+            LogicError("Quantized multiplication is applied to two constant matrices -- it is highly inefficient. Better approach is to replace the operation with the resulting matrix.");
+        m_isAConstant = true;
+        if (m_precision == QuantizedPrecision::Int8)
+            return QuantizeA(m_a8, m, k, A);
+        else
+            return QuantizeA(m_a16, m, k, A);
+    }
+
+    // Makes this multiplier use the constant A that 'other' has quantized with SetConstantA(), instead of a copy of its own.
+    // Multiply() only reads a shared A, so multipliers sharing it can be used concurrently; 'other' must not quantize A again.
+    // If A changes, SetConstantA() quantizes it into a new copy that only this multiplier uses.
+    void ShareConstantA(const QuantizedMultiplier& other)
+    {
+        if (m_precision != other.m_precision || m_bitShiftA != other.m_bitShiftA || m_bitShiftA == SIZE_MAX || !other.m_isAConstant)
+            LogicError("A quantized constant matrix can only be shared between multipliers with symmetric quantizers of the same precision and bit shift.");
+        if (m_isBConstant)
+            LogicError("Quantized multiplication is applied to two constant matrices -- it is highly inefficient. Better approach is to replace the operation with the resulting matrix.");
+        m_isAConstant = true;
+        m_a16 = other.m_a16;
+        m_a8 = other.m_a8;
+        m_isAShared = true;
+    }
+
+    void SetIsAConstant(bool v) { m_isAConstant = v; }
+    void SetIsBConstant(bool v) { m_isBConstant = v; }
+    QuantizedPrecision GetPrecision() const { return m_precision; }
+
+private:
+    template <class QuantizedType>
+    void Multiply(shared_ptr<Operand<QuantizedType>>& pa, Operand<QuantizedType>& b, int m, int n, int k, const ElemType* A, const ElemType* B, ElemType* C)
     {
         // Quantize
-        if (!m_isAConstant || m_firstPass)
+        if (!m_isAConstant || !pa->isValid || pa->numRows != (size_t)m || pa->values.size() != (size_t)m * k)
+            QuantizeA(pa, m, k, A);
+        const auto& a = *pa;
+
+        if (!m_isBConstant || !b.isValid || b.numRows != (size_t)k || b.values.size() != (size_t)n * k)
+        {
+            // B is column-major, i.e. each of its columns is contiguous, which is what CPUQuantizedGemm() expects
+            b.values.resize((size_t)n * k);
+            ArrayRef<QuantizedType> refMatB(b.values.data(), b.values.size());
+            b.quantizer->Quantize(ArrayRef<ElemType>(const_cast<ElemType*>(B), b.values.size()), refMatB);
+            b.numRows = k;
+            b.maxAbs = MaxAbs(b.values);
+            b.isValid = true;
+        }
+
+        // Do multiply
+        const size_t mn = (size_t)m * n;
+        float* product = std::is_same<ElemType, float>::value ? reinterpret_cast<float*>(C) : nullptr;
+        if (!product)
         {
-            m_pMatA.resize(m*k);
-            ArrayRef<short> refMatA(m_pMatA.data(), m_pMatA.size());
-            m_pQuantizerA->Quantize(ArrayRef<ElemType>(A, m_pMatA.size()), refMatA);
+            m_product.resize(mn);
+            product = m_product.data();
         }
-        
-        if (!m_isBConstant || m_firstPass)
+        CPUQuantizedGemm(m, n, k, a.values.data(), a.maxAbs, b.values.data(), b.maxAbs, product);
+        if (product != reinterpret_cast<float*>(C))
         {
-            m_pMatB.resize(n*k);
-            ArrayRef<short> refMatB(m_pMatB.data(), m_pMatB.size());
-            m_pQuantizerB->Quantize(ArrayRef<ElemType>(B, m_pMatB.size()), refMatB);
+            for (size_t i = 0; i < mn; i++)
+                C[i] = (ElemType)product[i];
         }
 
-        m_firstPass = false;
+        // De-quantize
+        b.quantizer->Dequantize(C, C, mn);
+        a.quantizer->Dequantize(C, C, mn);
+    }
 
-        // Do multiply
-        // Naive inefficient product, just for demonstation
-        // TODO: replace with an efficient version, e.g. IPG, block multiplier, Eigen, gemmlowp, etc.
-        for (size_t i = 0; i < m; i++)
-            for (size_t j = 0; j < n; j++)
+    // Quantizes the column-major A and packs it row by row
+    template <class QuantizedType>
+    QuantizationError QuantizeA(shared_ptr<Operand<QuantizedType>>& pa, int m, int k, const ElemType* A)
+    {
+        if (m_isAShared) // other multipliers still read the shared values
+        {
+            pa = make_shared<Operand<QuantizedType>>();
+            pa->quantizer = make_shared<SymmetricQuantizer<ElemType, QuantizedType>>(m_bitShiftA);
+            m_isAShared = false;
+        }
+        auto& a = *pa;
+
+        const size_t size = (size_t)m * k;
+        vector<QuantizedType> columnMajor(size);
+        ArrayRef<QuantizedType> refMatA(columnMajor.data(), size);
+        a.quantizer->Quantize(ArrayRef<ElemType>(const_cast<ElemType*>(A), size), refMatA);
+
+        a.values.resize(size);
+        for (size_t l = 0; l < (size_t)k; l++)
+            for (size_t i = 0; i < (size_t)m; i++)
+                a.values[i * k + l] = columnMajor[i + l * m];
+        a.numRows = m;
+        a.maxAbs = MaxAbs(a.values);
+        a.isValid = true;
+
+        if (!m_isAConstant) // only worth measuring for weights
+            return QuantizationError();
+
+        vector<ElemType> dequantized(columnMajor.begin(), columnMajor.end());
+        a.quantizer->Dequantize(dequantized.data(), dequantized.data(), size);
+        QuantizationError error = {};
+        double sumSqr = 0, sumSqrError = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            double diff = fabs((double)dequantized[i] - (double)A[i]);
+            error.maxAbsValue = std::max(error.maxAbsValue, fabs((double)A[i]));
+            error.maxAbsError = std::max(error.maxAbsError, diff);
+            sumSqr += (double)A[i] * A[i];
+            sumSqrError += diff * diff;
+        }
+        error.relativeRmsError = sumSqr > 0 ? sqrt(sumSqrError / sumSqr) : 0;
+        return error;
+    }
+
+    template <class QuantizedType>
+    static int MaxAbs(const vector<QuantizedType>& values)
+    {
+        int maxAbs = 0;
+        for (auto v : values)
+            maxAbs = std::max(maxAbs, abs((int)v));
+        return maxAbs;
+    }
+};
+
+// Quantized constant matrices (weights) shared by the multipliers of several networks that use the same weights, e.g. the
+// evaluation contexts of one model, so that each matrix is quantized, and held in memory, once (see QuantizedMultiplier::ShareConstantA()).
+// Thread-safe. A matrix is identified by the memory that holds it, so its values must not change while the cache is in use.
+class QuantizedWeightsCache
+{
+    struct Entry
+    {
+        shared_ptr<const void> multiplier; // QuantizedMultiplier<ElemType> that has quantized the matrix, and is only used to share it
+        QuantizationError error;
+    };
+
+    std::mutex m_mutex;
+    std::map<std::tuple<const void*, int, int, size_t, QuantizedPrecision, size_t>, Entry> m_entries;
+
+public:
+    // Returns a new multiplier whose constant A[m,k] is shared with the other multipliers returned for it, quantizing A if it is
+    // not in the cache yet. 'error' is set to how much quantization changed A.
+    template <class ElemType>
+    shared_ptr<QuantizedMultiplier<ElemType>> CreateMultiplier(QuantizedPrecision precision, size_t bitShiftA, size_t bitShiftB, int m, int k, const ElemType* A, QuantizationError& error)
+    {
+        shared_ptr<const QuantizedMultiplier<ElemType>> quantizedA;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& entry = m_entries[std::make_tuple((const void*)A, m, k, sizeof(ElemType), precision, bitShiftA)];
+            if (!entry.multiplier)
             {
-                int dotProduct=0;
-                for (size_t l = 0; l < k; l++)
-                {
-                    // CNTK is using column-major storage
-                    dotProduct += m_pMatA[i + l*m] * m_pMatB[l + k*j];
-                }
-                C[i + j*m] = (ElemType)dotProduct;
+                auto multiplier = make_shared<QuantizedMultiplier<ElemType>>(precision, bitShiftA, 0);
+                entry.error = multiplier->SetConstantA(m, k, A);
+                entry.multiplier = multiplier;
             }
+            quantizedA = static_pointer_cast<const QuantizedMultiplier<ElemType>>(entry.multiplier);
+            error = entry.error;
+        }
 
-        // De-quantize
-        int mn = m*n;
-        m_pQuantizerB->Dequantize(C, C, mn);
-        m_pQuantizerA->Dequantize(C, C, mn);
+        auto multiplier = make_shared<QuantizedMultiplier<ElemType>>(precision, bitShiftA, bitShiftB);
+        multiplier->ShareConstantA(*quantizedA);
+        return multiplier;
     }
-
-    void SetIsAConstant(bool v) { m_isAConstant = v; }
-    void SetIsBConstant(bool v) { m_isBConstant = v; }
 };
 
-}}}
\ No newline at end of file
+}}}
@@ -17,8 +17,13 @@
 #include "fileutil.h"
 #include "TimerUtility.h"
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <stdio.h>
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
@@ -67,10 +72,15 @@ static const FixedEventDesc c_fixedEvtDesc[profilerEvtMax] = {
     { "", profilerEvtSeparator, false },                            // profilerSepSpace2
 
     { "Prefetch Minibatch", profilerEvtTime, false },               // profilerEvtPrefetchMinibatch
+    { "_Read Sequences", profilerEvtTime, false },                  // profilerEvtReadSequences
+    { "_Transform Sequences", profilerEvtTime, false },             // profilerEvtTransformSequences
+    { "_Pack Minibatch", profilerEvtTime, false },                  // profilerEvtPackMinibatch
+    { "Prefetch Transfer", profilerEvtTime, false },                // profilerEvtPrefetchTransfer
+    { "Prefetch Wait", profilerEvtTime, false },                    // profilerEvtPrefetchWait
 };
 
 
-struct FixedEventRecord
+struct EventStats
 {
     int             cnt;          // event count
     long long       sum;          // time (ns) or throughput (kB/s)
@@ -80,15 +90,133 @@ struct FixedEventRecord
     long long       totalBytes;   // used only for throughput events
 };
 
+// Fixed and dynamic events share one id space. The last id collects the dynamic events
+// that do not fit anymore.
+static const int c_maxEvents = 16384;
+static const int c_statsBlockSize = 256;
+static const int c_numStatsBlocks = c_maxEvents / c_statsBlockSize;
+
+//
+// Event record kept in the ring buffer of a thread, for the detail file.
+//
+enum EventRecordKind
+{
+    eventRecordTime = 0,
+    eventRecordFlowBegin,
+    eventRecordFlowStep,
+    eventRecordFlowEnd
+};
+
+struct EventRecord
+{
+    long long           beginClock;
+    long long           endClock;     // same as beginClock for flow events
+    unsigned long long  flowId;       // used only for flow events
+    int                 eventId;
+    int                 kind;         // EventRecordKind
+};
+
 //
-// The custom event record is a variable size datastructure in memory:
-// NULL terminated description string, followed by CustomEventRecord struct
+// A thread that used an event buffer, starting with the given record.
 //
-struct CustomEventRecord
+struct ThreadSegment
 {
-    long long       beginClock;
-    long long       endClock;
-    unsigned int    threadId;
+    unsigned long long  firstRecord;
+    unsigned int        threadId;
+    std::string         threadName;
+};
+
+//
+// Event buffer of a thread. Only the thread that owns the buffer writes to it, so recording needs no lock.
+// ProfilerClose() still has to stop the recording before it reads the buffer: the owner marks the buffer
+// as recording and then checks whether it is closed, while Close() marks it as closed and then waits until
+// it is not recording. Both use sequentially consistent operations, so at least one of them sees the other.
+// When a thread finishes, its buffer is handed to the next thread that records events, which keeps the
+// number of buffers at the number of concurrently recording threads.
+//
+struct ThreadEventBuffer
+{
+    unsigned long long                  capacity;                 // Number of records in the ring buffer
+    std::unique_ptr<EventRecord[]>      records;                  // Ring buffer, allocated on first use
+    std::atomic<unsigned long long>     written;                  // Number of records ever written
+    std::atomic<EventStats*>            stats[c_numStatsBlocks];  // Profiling data for each event, allocated by blocks
+    std::vector<ThreadSegment>          segments;                 // Threads that used this buffer (guarded by g_mutex)
+    std::atomic<bool>                   recording;                // Set by the owner while it records an event
+    std::atomic<bool>                   closed;                   // Set by ProfilerClose()
+
+    ThreadEventBuffer(unsigned long long capacity) : capacity(capacity), written(0), recording(false), closed(false)
+    {
+        for (auto& block : stats)
+            block.store(nullptr);
+    }
+
+    ~ThreadEventBuffer()
+    {
+        ReleaseData();
+    }
+
+    // Free the records and the profiling data. The buffer itself may still be referenced by a recording thread.
+    void ReleaseData()
+    {
+        records.reset();
+        for (auto& block : stats)
+            delete[] block.exchange(nullptr);
+    }
+
+    // Called by the owner around recording an event; the event must not be recorded if BeginRecording() returns false.
+    bool BeginRecording()
+    {
+        recording.store(true);
+        if (!closed.load())
+            return true;
+
+        recording.store(false);
+        return false;
+    }
+
+    void EndRecording()
+    {
+        recording.store(false);
+    }
+
+    // Stops the recording; once it returns, the owner does not write to the buffer any more.
+    void Close()
+    {
+        closed.store(true);
+        while (recording.load())
+            std::this_thread::yield();
+    }
+
+    EventStats& Stats(int eventId)
+    {
+        auto& block = stats[eventId / c_statsBlockSize];
+        EventStats* blockStats = block.load(std::memory_order_relaxed);
+        if (blockStats == nullptr)
+        {
+            blockStats = new EventStats[c_statsBlockSize]();
+            block.store(blockStats, std::memory_order_release);
+        }
+        return blockStats[eventId % c_statsBlockSize];
+    }
+
+    void Append(int kind, int eventId, long long beginClock, long long endClock, unsigned long long flowId)
+    {
+        if (capacity == 0)
+            return;
+
+        if (!records)
+            records.reset(new EventRecord[capacity]);
+
+        // The oldest record is overwritten when the buffer is full.
+        auto index = written.load(std::memory_order_relaxed);
+        auto& record = records[index % capacity];
+        record.beginClock = beginClock;
+        record.endClock = endClock;
+        record.flowId = flowId;
+        record.eventId = eventId;
+        record.kind = kind;
+        written.store(index + 1, std::memory_order_release);
+    }
 };
 
 
@@ -97,16 +225,11 @@ struct CustomEventRecord
 //
 struct ProfilerState
 {
-    bool                    enabled;                     // Profiler enabled (active)
-    bool                    syncGpu;                     // Sync GPU per each profiling event
-    bool                    cudaSyncEnabled;             // Runtime state of CUDA kernel sync
     std::wstring            profilerDir;                 // Directory where reports/logs are saved
     std::wstring            logSuffix;                   // Suffix to append to report/log file names
-    FixedEventRecord        fixedEvents[profilerEvtMax]; // Profiling data for each fixed event
-    bool                    customEventBufferFull;       // Is custom event buffer full?
-    unsigned long long      customEventBufferBytes;      // Number of bytes allocated for the custom event buffer
-    unsigned long long      customEventOffset;           // Offset to current place in buffer
-    unique_ptr<char[]>      customEventBuffer;           // Pointer to custom event buffer
+    unsigned long long      recordsPerThread;            // Number of records in the buffer of each thread
+    std::vector<std::unique_ptr<ThreadEventBuffer>> threadBuffers; // Buffers of all threads that recorded events
+    std::vector<ThreadEventBuffer*> freeThreadBuffers;   // Buffers of finished threads
     long long               startClock;
 };
 
@@ -114,9 +237,58 @@ struct ProfilerState
 // We support one global instance of the profiler
 static unique_ptr<ProfilerState> g_profilerState;
 
-// Mutex controlling access to g_profilerState
+// Mutex controlling access to g_profilerState, except for the thread buffers, and to the event registry
 static std::mutex g_mutex;
 
+// Buffers of closed sessions. A thread that looked up its buffer just before ProfilerClose() may still
+// check whether it is closed, so the buffers are kept until process exit (guarded by g_mutex).
+static std::vector<std::unique_ptr<ThreadEventBuffer>> g_closedThreadBuffers;
+
+// Profiler enabled (active). Recording threads only check this flag, and not g_profilerState, which
+// ProfilerClose() resets while they may still be running; it is false whenever there is no state.
+static std::atomic<bool> g_enabled(false);
+
+// Sync GPU per each profiling event
+static std::atomic<bool> g_syncGpu(false);
+
+// Incremented by ProfilerInit() and ProfilerClose(); a thread looks up its buffer again when it changes
+static std::atomic<unsigned int> g_session(0);
+
+// Source of flow ids
+static std::atomic<unsigned long long> g_nextFlowId(1);
+
+//
+// The buffer of the current thread in the current session. The buffer is handed back when the thread finishes.
+//
+struct ThreadBufferBinding
+{
+    ThreadEventBuffer*  buffer = nullptr;
+    unsigned int        session = 0;
+
+    ~ThreadBufferBinding()
+    {
+        if (buffer == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_profilerState != nullptr && session == g_session.load())
+            g_profilerState->freeThreadBuffers.push_back(buffer);
+    }
+};
+
+static thread_local ThreadBufferBinding t_threadBuffer;
+
+//
+// Dynamic events, registered by description. Descriptions are never removed, so pointers to them stay valid.
+//
+struct EventRegistry
+{
+    std::deque<std::string>                 descriptions;  // Indexed by eventId - profilerEvtMax
+    std::unordered_map<std::string, int>    eventIds;
+};
+
+static EventRegistry g_eventRegistry;
+
 // Forward declarations
 unsigned int GetThreadId();
 
@@ -143,34 +315,35 @@ double TicksSqToSecondsSq(double ticksSq)
 //
 // Initialize all resources to enable profiling.
 // profilerDir: Directory where the profiler logs will be saved.
-// customEventBufferBytes: Size of the custom event buffer.
+// customEventBufferBytes: Size of the event buffer of each recording thread.
 // logSuffix: Suffix string to append to log file names.
 // syncGpu: Wait for GPU to complete processing for each profiling event with syncGpu flag set.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
     const std::wstring& logSuffix, const bool syncGpu)
 {
+    std::lock_guard<std::mutex> lock(g_mutex);
+
     if (g_profilerState != nullptr)
     {
         RuntimeError("Error: ProfilerInit: Profiler already initialized.\n");
     }
-    g_profilerState.reset(new ProfilerState());
-
-    g_profilerState->profilerDir = profilerDir;
-    g_profilerState->logSuffix = logSuffix;
 
-    g_profilerState->customEventBufferFull = false;
-    g_profilerState->customEventBufferBytes = customEventBufferBytes;
-    g_profilerState->customEventOffset = 0ull;
-    g_profilerState->customEventBuffer.reset(new char[customEventBufferBytes]);
+    unique_ptr<ProfilerState> state(new ProfilerState());
+    state->profilerDir = profilerDir;
+    state->logSuffix = logSuffix;
+    state->recordsPerThread = customEventBufferBytes / sizeof(EventRecord);
+    state->startClock = Clock::GetTimeStamp();
 
-    g_profilerState->syncGpu = syncGpu;
-    g_profilerState->enabled = false;
-
-    if (_wmkdir(g_profilerState->profilerDir.c_str()) == -1 && errno != EEXIST)
+    if (_wmkdir(state->profilerDir.c_str()) == -1 && errno != EEXIST)
     {
-        RuntimeError("Error: ProfilerInit: Cannot create directory <%ls>.\n", g_profilerState->profilerDir.c_str());
+        RuntimeError("Error: ProfilerInit: Cannot create directory <%ls>.\n", state->profilerDir.c_str());
     }
+
+    g_profilerState = std::move(state);
+    g_enabled = false;
+    g_syncGpu = syncGpu;
+    g_session++;
 }
 
 //
@@ -184,72 +357,168 @@ void PERF_PROFILER_API ProfilerEnable(bool enable)
     if (g_profilerState == nullptr)
         return;
 
-    g_profilerState->enabled = enable;
-
-    if (enable)
-    {
-        g_profilerState->startClock = Clock::GetTimeStamp();
-    }
+    g_enabled = enable;
 }
 
 
 //
-// Internal helper functions to record fixed and custom profiling events.
+// Internal helper functions to find the buffer of the calling thread, and to record events in it.
 //
-void ProfilerTimeRecordFixedEvent(const int eventId, const long long beginClock, const long long endClock)
+ThreadEventBuffer* GetThreadBuffer()
 {
+    auto& binding = t_threadBuffer;
+    if (binding.session == g_session.load(std::memory_order_acquire))
+        return binding.buffer;
+
     std::lock_guard<std::mutex> lock(g_mutex);
 
-    if (!g_profilerState->enabled)
-        return;
+    binding.session = g_session.load();
+    binding.buffer = nullptr;
+    if (g_profilerState == nullptr)
+        return nullptr;
 
-    long long delta = endClock - beginClock;
-    if (g_profilerState->fixedEvents[eventId].cnt == 0)
+    auto& state = *g_profilerState;
+    if (!state.freeThreadBuffers.empty())
+    {
+        binding.buffer = state.freeThreadBuffers.back();
+        state.freeThreadBuffers.pop_back();
+    }
+    else
     {
-        g_profilerState->fixedEvents[eventId].min = delta;
-        g_profilerState->fixedEvents[eventId].max = delta;
+        state.threadBuffers.emplace_back(new ThreadEventBuffer(state.recordsPerThread));
+        binding.buffer = state.threadBuffers.back().get();
     }
-    g_profilerState->fixedEvents[eventId].min = std::min(delta, g_profilerState->fixedEvents[eventId].min);
-    g_profilerState->fixedEvents[eventId].max = std::max(delta, g_profilerState->fixedEvents[eventId].max);
-    g_profilerState->fixedEvents[eventId].sum += delta;
-    g_profilerState->fixedEvents[eventId].sumsq += (double)delta * (double)delta;
-    g_profilerState->fixedEvents[eventId].cnt++;
+
+    binding.buffer->segments.push_back(ThreadSegment{ binding.buffer->written.load(), GetThreadId(), std::string() });
+    return binding.buffer;
 }
 
-void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long beginClock, const long long endClock)
+void ProfilerUpdateStats(EventStats& stats, long long value)
 {
-    std::lock_guard<std::mutex> lock(g_mutex);
+    if (stats.cnt == 0)
+    {
+        stats.min = value;
+        stats.max = value;
+    }
+    stats.min = std::min(value, stats.min);
+    stats.max = std::max(value, stats.max);
+    stats.sum += value;
+    stats.sumsq += (double)value * (double)value;
+    stats.cnt++;
+}
+
+void ProfilerTimeRecord(const int eventId, const long long beginClock, const long long endClock)
+{
+    if (!g_enabled.load(std::memory_order_relaxed))
+        return;
+
+    if (eventId < 0 || eventId >= c_maxEvents)
+        return;
+
+    auto buffer = GetThreadBuffer();
+    if (buffer == nullptr)
+        return;
+
+    if (!buffer->BeginRecording())
+        return;
+
+    ProfilerUpdateStats(buffer->Stats(eventId), endClock - beginClock);
+    buffer->Append(eventRecordTime, eventId, beginClock, endClock, 0);
+    buffer->EndRecording();
+}
+
+void ProfilerFlowRecord(const int kind, const unsigned long long flowId, const int eventId)
+{
+    if (!g_enabled.load(std::memory_order_relaxed))
+        return;
+
+    if (eventId < 0 || eventId >= c_maxEvents)
+        return;
+
+    auto buffer = GetThreadBuffer();
+    if (buffer == nullptr)
+        return;
+
+    long long clock = Clock::GetTimeStamp();
 
-    if (!g_profilerState->enabled)
+    if (!buffer->BeginRecording())
         return;
 
-    auto eventDescriptionBytes = strlen(eventDescription) + 1;
-    auto requiredBufferBytes = eventDescriptionBytes + sizeof(CustomEventRecord);
-    if ((g_profilerState->customEventOffset + requiredBufferBytes) > g_profilerState->customEventBufferBytes)
+    buffer->Append(kind, eventId, clock, clock, flowId);
+    buffer->EndRecording();
+}
+
+
+//
+// Register a dynamic event, and return its id.
+// storedDescription receives the registered description, which stays valid for the lifetime of the process.
+//
+int ProfilerRegisterEvent(const char* eventDescription, const char** storedDescription)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    auto& registry = g_eventRegistry;
+    auto it = registry.eventIds.find(eventDescription);
+    if (it == registry.eventIds.end())
     {
-        if (!g_profilerState->customEventBufferFull)
+        int eventId = profilerEvtMax + (int)registry.descriptions.size();
+        if (eventId < c_maxEvents - 1)
         {
-            fprintf(stderr, "Warning: Performance Profiler: Buffer is full, no more events will be recorded.\n");
-            g_profilerState->customEventBufferFull = true;
+            registry.descriptions.push_back(eventDescription);
         }
-        return;
+        else
+        {
+            if (eventId == c_maxEvents - 1)
+            {
+                fprintf(stderr, "Warning: Performance Profiler: Too many events, further events will be recorded as 'Other Events'.\n");
+                registry.descriptions.push_back("Other Events");
+            }
+            eventId = c_maxEvents - 1;
+        }
+        it = registry.eventIds.insert(std::make_pair(std::string(eventDescription), eventId)).first;
     }
 
-    strcpy(g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset, eventDescription);
-    g_profilerState->customEventOffset += eventDescriptionBytes;
+    if (storedDescription)
+        *storedDescription = registry.descriptions[it->second - profilerEvtMax].c_str();
+    return it->second;
+}
 
-    CustomEventRecord eventRecord;
-    eventRecord.beginClock = beginClock;
-    eventRecord.endClock = endClock;
-    eventRecord.threadId = GetThreadId();
+int PERF_PROFILER_API ProfilerRegisterEvent(const char* eventDescription)
+{
+    return ProfilerRegisterEvent(eventDescription, nullptr);
+}
 
-    memcpy(g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset, &eventRecord, sizeof(CustomEventRecord));
-    g_profilerState->customEventOffset += sizeof(CustomEventRecord);
+//
+// Find the id of a dynamic event by its description. Descriptions are typically string literals,
+// so the ids are cached per thread by pointer. Since the memory of a description may be reused for
+// a different one, the cached entry is only used if the description is still the same.
+//
+int ProfilerLookUpEvent(const char* eventDescription)
+{
+    struct CachedEvent
+    {
+        int         eventId;
+        const char* description;
+    };
+    static thread_local std::unordered_map<const char*, CachedEvent> cache;
+
+    auto it = cache.find(eventDescription);
+    if (it != cache.end() && strcmp(it->second.description, eventDescription) == 0)
+        return it->second.eventId;
+
+    // Callers that pass a different pointer every time would otherwise grow the cache without bounds.
+    if (cache.size() >= 4096)
+        cache.clear();
+
+    CachedEvent event;
+    event.eventId = ProfilerRegisterEvent(eventDescription, &event.description);
+    cache[eventDescription] = event;
+    return event.eventId;
 }
 
 
 //
-// Measure either a fixed or custom event time.
+// Measure either a fixed or dynamic event time.
 // ProfilerTimeBegin() returns a stateId that is passed to ProfilerTimeEnd().
 // If ProfilerTimeEnd() is not called, the event is not recorded.
 //
@@ -261,26 +530,62 @@ long long PERF_PROFILER_API ProfilerTimeBegin()
 
 void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const int eventId)
 {
-    // A nullptr state indicates that the profiler is globally disabled, and not initialized
-    if (g_profilerState == nullptr)
+    if (!g_enabled.load(std::memory_order_relaxed))
         return;
 
-    if (c_fixedEvtDesc[eventId].syncGpu)
+    if (eventId >= 0 && eventId < profilerEvtMax && c_fixedEvtDesc[eventId].syncGpu)
         ProfilerSyncGpu();
 
-    long long endClock = Clock::GetTimeStamp();
-    ProfilerTimeRecordFixedEvent(eventId, stateId, endClock);
-    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, stateId, endClock);
+    ProfilerTimeRecord(eventId, stateId, Clock::GetTimeStamp());
 }
 
 
 void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const char* eventDescription)
 {
-    // A nullptr state indicates that the profiler is globally disabled, and not initialized
-    if (g_profilerState == nullptr)
+    long long endClock = Clock::GetTimeStamp();
+
+    if (!g_enabled.load(std::memory_order_relaxed))
+        return;
+
+    ProfilerTimeRecord(ProfilerLookUpEvent(eventDescription), stateId, endClock);
+}
+
+
+//
+// Connect events on different threads in the detail log.
+//
+unsigned long long PERF_PROFILER_API ProfilerNewFlowId()
+{
+    return g_nextFlowId++;
+}
+
+void PERF_PROFILER_API ProfilerFlowBegin(const unsigned long long flowId, const int eventId)
+{
+    ProfilerFlowRecord(eventRecordFlowBegin, flowId, eventId);
+}
+
+void PERF_PROFILER_API ProfilerFlowStep(const unsigned long long flowId, const int eventId)
+{
+    ProfilerFlowRecord(eventRecordFlowStep, flowId, eventId);
+}
+
+void PERF_PROFILER_API ProfilerFlowEnd(const unsigned long long flowId, const int eventId)
+{
+    ProfilerFlowRecord(eventRecordFlowEnd, flowId, eventId);
+}
+
+
+//
+// Name the calling thread in the detail log.
+//
+void PERF_PROFILER_API ProfilerSetThreadName(const char* threadName)
+{
+    auto buffer = GetThreadBuffer();
+    if (buffer == nullptr)
         return;
 
-    ProfilerTimeRecordToBuffer(eventDescription, stateId, Clock::GetTimeStamp());
+    std::lock_guard<std::mutex> lock(g_mutex);
+    buffer->segments.back().threadName = threadName;
 }
 
 
@@ -291,15 +596,10 @@ void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const char* even
 void PERF_PROFILER_API ProfilerSyncGpu()
 {
 #ifndef CPUONLY
-    // A nullptr state indicates that the profiler is globally disabled, and not initialized
-    if (g_profilerState == nullptr)
-        return;
-
-    if(!g_profilerState->enabled)
+    if (!g_enabled || !g_syncGpu)
         return;
 
-    if (g_profilerState->syncGpu)
-        cudaDeviceSynchronize();
+    cudaDeviceSynchronize();
 #endif
 }
 
@@ -319,32 +619,27 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
 {
     long long endClock = Clock::GetTimeStamp();
 
-    // A nullptr state indicates that the profiler is globally disabled, and not initialized
-    if (g_profilerState == nullptr)
+    if (!g_enabled.load(std::memory_order_relaxed))
         return;
 
-    std::lock_guard<std::mutex> lock(g_mutex);
-
-    if (!g_profilerState->enabled)
+    auto beginClock = stateId;
+    if (endClock == beginClock || eventId < 0 || eventId >= profilerEvtMax)
         return;
 
-    auto beginClock = stateId;
-    if (endClock == beginClock)
+    auto buffer = GetThreadBuffer();
+    if (buffer == nullptr)
         return;
 
     // Use kB rather than bytes to prevent overflow
     long long kBytesPerSec = Clock::GetTicksPerSecond() * bytes / 1000 / (endClock - beginClock);
-    if (g_profilerState->fixedEvents[eventId].cnt == 0)
-    {
-        g_profilerState->fixedEvents[eventId].min = kBytesPerSec;
-        g_profilerState->fixedEvents[eventId].max = kBytesPerSec;
-    }
-    g_profilerState->fixedEvents[eventId].min = std::min(kBytesPerSec, g_profilerState->fixedEvents[eventId].min);
-    g_profilerState->fixedEvents[eventId].max = std::max(kBytesPerSec, g_profilerState->fixedEvents[eventId].max);
-    g_profilerState->fixedEvents[eventId].sum += kBytesPerSec;
-    g_profilerState->fixedEvents[eventId].sumsq += (double)kBytesPerSec * (double)kBytesPerSec;
-    g_profilerState->fixedEvents[eventId].totalBytes += bytes;
-    g_profilerState->fixedEvents[eventId].cnt++;
+
+    if (!buffer->BeginRecording())
+        return;
+
+    auto& stats = buffer->Stats(eventId);
+    ProfilerUpdateStats(stats, kBytesPerSec);
+    stats.totalBytes += bytes;
+    buffer->EndRecording();
 }
 
 
@@ -357,6 +652,15 @@ void PERF_PROFILER_API ProfilerClose()
     if (g_profilerState == nullptr)
         return;
 
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    // Threads stop recording, and drop their buffers. A thread may still be in the middle of recording
+    // an event, so wait for it; once closed, nothing is written to the buffer.
+    g_enabled = false;
+    g_session++;
+    for (auto& buffer : g_profilerState->threadBuffers)
+        buffer->Close();
+
     // Get current time as yyyy-mm-dd_hh-mm-ss
     time_t currentTime;
     time(&currentTime);
@@ -372,6 +676,11 @@ void PERF_PROFILER_API ProfilerClose()
     fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_detail_" + g_profilerState->logSuffix + L".json";
     ProfilerGenerateDetailFile(fileName);
 
+    for (auto& buffer : g_profilerState->threadBuffers)
+    {
+        buffer->ReleaseData();
+        g_closedThreadBuffers.push_back(std::move(buffer));
+    }
     g_profilerState.reset();
 }
 
@@ -404,6 +713,111 @@ unsigned int GetProcessId()
 #endif
 }
 
+//
+// Description of a fixed or dynamic event. Must be called with g_mutex held.
+//
+const char* EventDescription(int eventId)
+{
+    if (eventId < profilerEvtMax)
+        return c_fixedEvtDesc[eventId].eventDescription;
+
+    return g_eventRegistry.descriptions[eventId - profilerEvtMax].c_str();
+}
+
+//
+// Sum up the profiling data of all threads, indexed by event id.
+//
+std::vector<EventStats> ProfilerMergeStats()
+{
+    std::vector<EventStats> merged(profilerEvtMax + g_eventRegistry.descriptions.size(), EventStats());
+    for (const auto& buffer : g_profilerState->threadBuffers)
+    {
+        for (size_t eventId = 0; eventId < merged.size(); eventId++)
+        {
+            const EventStats* blockStats = buffer->stats[eventId / c_statsBlockSize].load(std::memory_order_acquire);
+            if (blockStats == nullptr)
+            {
+                eventId += c_statsBlockSize - 1 - eventId % c_statsBlockSize;
+                continue;
+            }
+
+            const auto& stats = blockStats[eventId % c_statsBlockSize];
+            if (stats.cnt == 0)
+                continue;
+
+            auto& total = merged[eventId];
+            total.min = total.cnt == 0 ? stats.min : std::min(total.min, stats.min);
+            total.max = total.cnt == 0 ? stats.max : std::max(total.max, stats.max);
+            total.cnt += stats.cnt;
+            total.sum += stats.sum;
+            total.sumsq += stats.sumsq;
+            total.totalBytes += stats.totalBytes;
+        }
+    }
+    return merged;
+}
+
+//
+// Print one line of the summary report.
+//
+void ProfilerPrintTimeStats(FILE* f, const char* description, int descriptionWidth, const EventStats& stats)
+{
+    fprintfOrDie(f, "%-*s: ", descriptionWidth, description);
+
+    char str[32];
+
+    double mean = TicksToSeconds(stats.sum) / stats.cnt;
+    FormatTimeStr(str, sizeof(str), mean);
+    fprintfOrDie(f, "%s ", str);
+
+    double sum = TicksToSeconds(stats.sum);
+    double sumsq = TicksSqToSecondsSq(stats.sumsq);
+    double stdDev = sumsq - (pow(sum, 2.0) / stats.cnt);
+    if (stdDev < 0.0) stdDev = 0.0;
+    stdDev = sqrt(stdDev / (double)stats.cnt);
+    FormatTimeStr(str, sizeof(str), stdDev);
+    fprintfOrDie(f, "%s ", str);
+
+    FormatTimeStr(str, sizeof(str), TicksToSeconds(stats.min));
+    fprintfOrDie(f, "%s ", str);
+
+    FormatTimeStr(str, sizeof(str), TicksToSeconds(stats.max));
+    fprintfOrDie(f, "%s ", str);
+
+    fprintfOrDie(f, "%16d ", stats.cnt);
+
+    FormatTimeStr(str, sizeof(str), TicksToSeconds(stats.sum));
+    fprintfOrDie(f, "%s", str);
+}
+
+void ProfilerPrintThroughputStats(FILE* f, const char* description, int descriptionWidth, const EventStats& stats)
+{
+    fprintfOrDie(f, "%-*s: ", descriptionWidth, description);
+
+    char str[32];
+
+    double mean = ((double)stats.sum / (double)stats.cnt);
+    FormatThroughputStr(str, sizeof(str), mean);
+    fprintfOrDie(f, "%s ", str);
+
+    double stdDev = stats.sumsq - (pow((double)stats.sum, 2.0) / (double)stats.cnt);
+    if (stdDev < 0.0) stdDev = 0.0;
+    stdDev = sqrt(stdDev / (double)stats.cnt);
+    FormatThroughputStr(str, sizeof(str), stdDev);
+    fprintfOrDie(f, "%s ", str);
+
+    FormatThroughputStr(str, sizeof(str), (double)stats.min);
+    fprintfOrDie(f, "%s ", str);
+
+    FormatThroughputStr(str, sizeof(str), (double)stats.max);
+    fprintfOrDie(f, "%s ", str);
+
+    fprintfOrDie(f, "%16d ", stats.cnt);
+
+    FormatBytesStr(str, sizeof(str), stats.totalBytes);
+    fprintfOrDie(f, "%s", str);
+}
+
 //
 // Generate summary report.
 //
@@ -415,6 +829,8 @@ void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo)
         RuntimeError("Error: ProfilerGenerateReport: Cannot create file <%ls>.\n", fileName.c_str());
     }
 
+    auto stats = ProfilerMergeStats();
+
     fprintfOrDie(f, "CNTK Performance Profiler Summary Report\n\n");
     char timeStr[32];
     strftime(timeStr, sizeof(timeStr), "%Y/%m/%d %H:%M:%S", timeInfo);
@@ -429,66 +845,18 @@ void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo)
         switch (c_fixedEvtDesc[evtIdx].eventType)
         {
         case profilerEvtTime:
-            if (g_profilerState->fixedEvents[evtIdx].cnt > 0)
+            if (stats[evtIdx].cnt > 0)
             {
                 printLine = true;
-                fprintfOrDie(f, "%-26s: ", c_fixedEvtDesc[evtIdx].eventDescription);
-
-                char str[32];
-
-                double mean = TicksToSeconds(g_profilerState->fixedEvents[evtIdx].sum) / g_profilerState->fixedEvents[evtIdx].cnt;
-                FormatTimeStr(str, sizeof(str), mean);
-                fprintfOrDie(f, "%s ", str);
-
-                double sum = TicksToSeconds(g_profilerState->fixedEvents[evtIdx].sum);
-                double sumsq = TicksSqToSecondsSq(g_profilerState->fixedEvents[evtIdx].sumsq);
-                double stdDev = sumsq - (pow(sum, 2.0) / g_profilerState->fixedEvents[evtIdx].cnt);
-                if (stdDev < 0.0) stdDev = 0.0;
-                stdDev = sqrt(stdDev / (double)g_profilerState->fixedEvents[evtIdx].cnt);
-                FormatTimeStr(str, sizeof(str), stdDev);
-                fprintfOrDie(f, "%s ", str);
-
-                FormatTimeStr(str, sizeof(str), TicksToSeconds(g_profilerState->fixedEvents[evtIdx].min));
-                fprintfOrDie(f, "%s ", str);
-
-                FormatTimeStr(str, sizeof(str), TicksToSeconds(g_profilerState->fixedEvents[evtIdx].max));
-                fprintfOrDie(f, "%s ", str);
-
-                fprintfOrDie(f, "%16d ", g_profilerState->fixedEvents[evtIdx].cnt);
-
-                FormatTimeStr(str, sizeof(str), TicksToSeconds(g_profilerState->fixedEvents[evtIdx].sum));
-                fprintfOrDie(f, "%s", str);
+                ProfilerPrintTimeStats(f, c_fixedEvtDesc[evtIdx].eventDescription, 26, stats[evtIdx]);
             }
             break;
 
         case profilerEvtThroughput:
-            if (g_profilerState->fixedEvents[evtIdx].cnt > 0)
+            if (stats[evtIdx].cnt > 0)
             {
                 printLine = true;
-                fprintfOrDie(f, "%-26s: ", c_fixedEvtDesc[evtIdx].eventDescription);
-
-                char str[32];
-
-                double mean = ((double)g_profilerState->fixedEvents[evtIdx].sum / (double)g_profilerState->fixedEvents[evtIdx].cnt);
-                FormatThroughputStr(str, sizeof(str), mean);
-                fprintfOrDie(f, "%s ", str);
-
-                double stdDev = g_profilerState->fixedEvents[evtIdx].sumsq - (pow((double)g_profilerState->fixedEvents[evtIdx].sum, 2.0) / (double)g_profilerState->fixedEvents[evtIdx].cnt);
-                if (stdDev < 0.0) stdDev = 0.0;
-                stdDev = sqrt(stdDev / (double)g_profilerState->fixedEvents[evtIdx].cnt);
-                FormatThroughputStr(str, sizeof(str), stdDev);
-                fprintfOrDie(f, "%s ", str);
-
-                FormatThroughputStr(str, sizeof(str), (double)g_profilerState->fixedEvents[evtIdx].min);
-                fprintfOrDie(f, "%s ", str);
-
-                FormatThroughputStr(str, sizeof(str), (double)g_profilerState->fixedEvents[evtIdx].max);
-                fprintfOrDie(f, "%s ", str);
-
-                fprintfOrDie(f, "%16d ", g_profilerState->fixedEvents[evtIdx].cnt);
-
-                FormatBytesStr(str, sizeof(str), g_profilerState->fixedEvents[evtIdx].totalBytes);
-                fprintfOrDie(f, "%s", str);
+                ProfilerPrintThroughputStats(f, c_fixedEvtDesc[evtIdx].eventDescription, 26, stats[evtIdx]);
             }
             break;
         
@@ -501,6 +869,29 @@ void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo)
         if (printLine) fprintfOrDie(f, "\n");
     }
 
+    // Dynamic events, such as the forward and backward passes of the nodes, most expensive first.
+    std::vector<int> dynamicEvents;
+    int descriptionWidth = 26;
+    for (int evtIdx = profilerEvtMax; evtIdx < (int)stats.size(); evtIdx++)
+    {
+        if (stats[evtIdx].cnt > 0)
+        {
+            dynamicEvents.push_back(evtIdx);
+            descriptionWidth = std::max(descriptionWidth, (int)strlen(EventDescription(evtIdx)));
+        }
+    }
+    std::stable_sort(dynamicEvents.begin(), dynamicEvents.end(), [&stats](int a, int b) { return stats[a].sum > stats[b].sum; });
+
+    if (!dynamicEvents.empty())
+    {
+        fprintfOrDie(f, "\nDynamic Events\n\n");
+        for (auto evtIdx : dynamicEvents)
+        {
+            ProfilerPrintTimeStats(f, EventDescription(evtIdx), descriptionWidth, stats[evtIdx]);
+            fprintfOrDie(f, "\n");
+        }
+    }
+
     fclose(f);
 }
 
@@ -540,6 +931,34 @@ void FormatBytesStr(char* str, size_t strLen, long long bytes)
 
 
 
+//
+// Escape a string for a JSON string literal.
+//
+std::string JsonEscape(const std::string& str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (unsigned char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += (char)c;
+        }
+        else if (c < 0x20)
+        {
+            char code[8];
+            sprintf_s(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+        {
+            escaped += (char)c;
+        }
+    }
+    return escaped;
+}
+
 //
 // Generate detail event file in chrome://tracing format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview#heading=h.yr703knxre9f)
 //
@@ -553,36 +972,80 @@ void ProfilerGenerateDetailFile(const std::wstring& fileName)
 
     fprintfOrDie(f, "[\n");
 
-    char* eventPtr = g_profilerState->customEventBuffer.get();
+    // Descriptions are escaped once per event.
+    std::vector<std::string> descriptions(profilerEvtMax + g_eventRegistry.descriptions.size());
+    for (size_t eventId = 0; eventId < descriptions.size(); eventId++)
+        descriptions[eventId] = JsonEscape(EventDescription((int)eventId));
 
     bool firstRecord = true;
     unsigned int pid = GetProcessId();
-    while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
-    {
-        char* descriptionStr = eventPtr;
-        eventPtr += strlen(descriptionStr) + 1;
-
-        CustomEventRecord* eventRecord = (CustomEventRecord*)eventPtr;
-        eventPtr += sizeof(CustomEventRecord);
-
-        fprintfOrDie(f, "%s  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"PERF\", \"ph\":\"B\", \"ts\":%llu}",
-            firstRecord ? "" : ",\n",
-            pid,
-            eventRecord->threadId,
-            descriptionStr,
-            (unsigned long long)(1000000.0 * TicksToSeconds(eventRecord->beginClock - g_profilerState->startClock)));
-
-        firstRecord = false;
-        fprintfOrDie(f, ",\n  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"PERF\", \"ph\":\"E\", \"ts\":%llu}",
-            pid,
-            eventRecord->threadId,
-            descriptionStr,
-            (unsigned long long)(1000000.0 * TicksToSeconds(eventRecord->endClock - g_profilerState->startClock)));
+    unsigned long long overwrittenRecords = 0;
+    for (const auto& buffer : g_profilerState->threadBuffers)
+    {
+        for (const auto& segment : buffer->segments)
+        {
+            if (segment.threadName.empty())
+                continue;
+
+            fprintfOrDie(f, "%s  {\"pid\":%u, \"tid\":%u, \"name\":\"thread_name\", \"ph\":\"M\", \"args\":{\"name\":\"%s\"}}",
+                firstRecord ? "" : ",\n",
+                pid,
+                segment.threadId,
+                JsonEscape(segment.threadName).c_str());
+            firstRecord = false;
+        }
+
+        auto written = buffer->written.load(std::memory_order_acquire);
+        auto first = written > buffer->capacity ? written - buffer->capacity : 0;
+        overwrittenRecords += first;
+
+        size_t segmentIndex = 0;
+        for (auto index = first; index < written; index++)
+        {
+            while (segmentIndex + 1 < buffer->segments.size() && buffer->segments[segmentIndex + 1].firstRecord <= index)
+                segmentIndex++;
+
+            const auto& eventRecord = buffer->records[index % buffer->capacity];
+            unsigned int tid = buffer->segments[segmentIndex].threadId;
+            double ts = 1000000.0 * TicksToSeconds(eventRecord.beginClock - g_profilerState->startClock);
+
+            if (eventRecord.kind == eventRecordTime)
+            {
+                fprintfOrDie(f, "%s  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"PERF\", \"ph\":\"X\", \"ts\":%.3f, \"dur\":%.3f}",
+                    firstRecord ? "" : ",\n",
+                    pid,
+                    tid,
+                    descriptions[eventRecord.eventId].c_str(),
+                    ts,
+                    1000000.0 * TicksToSeconds(eventRecord.endClock - eventRecord.beginClock));
+            }
+            else
+            {
+                // Flow events bind to the enclosing event of their thread.
+                const char* phase = eventRecord.kind == eventRecordFlowBegin ? "s" : (eventRecord.kind == eventRecordFlowStep ? "t" : "f");
+                fprintfOrDie(f, "%s  {\"pid\":%u, \"tid\":%u, \"name\":\"%s\", \"cat\":\"FLOW\", \"ph\":\"%s\", \"id\":%llu, \"ts\":%.3f%s}",
+                    firstRecord ? "" : ",\n",
+                    pid,
+                    tid,
+                    descriptions[eventRecord.eventId].c_str(),
+                    phase,
+                    eventRecord.flowId,
+                    ts,
+                    eventRecord.kind == eventRecordFlowEnd ? ", \"bp\":\"e\"" : "");
+            }
+            firstRecord = false;
+        }
     }
 
     fprintfOrDie(f, "\n]\n");
 
     fclose(f);
+
+    if (overwrittenRecords > 0)
+    {
+        fprintf(stderr, "Warning: Performance Profiler: %llu events were overwritten because the buffers were full, only the most recent events are in the detail file.\n",
+            overwrittenRecords);
+    }
 }
 
 
@@ -4,18 +4,21 @@
 //
 // Real-time thread-safe profiler that generates a summary report and a detail profile log.
 // The profiler is highly performant and lightweight. Profiling a single event introduces an overhead
-// of approximately 100 ns.
+// of approximately 100 ns, and recording threads never wait for each other.
 //
 // Profiler Usage
 //
 // To initialize and tear down the profiler, call ProfilerInit() and ProfilerClose(). The scoped
-// object, ProfilerContext can also be used for managing the lifetime of the profiler. The profiler
-// works by accumulating events in a pre-allocated buffer, up until the buffer is full. At the
-// time when the profiler is torn down, a summary report and a detailed log file is written to disk.
+// object, ProfilerContext can also be used for managing the lifetime of the profiler. Each thread
+// that records events gets its own ring buffer, which keeps the most recent events when it is full.
+// Buffers of finished threads are reused by new threads. At the time when the profiler is torn down,
+// a summary report and a detailed log file in Chrome trace format (chrome://tracing, Perfetto) are
+// written to disk.
 //
-// When profiling code, two types of events can be used - fixed or custom. A fixed event is
-// predefined in the ProfilerEvents enum and by the FixedEventDesc struct. A custom event is
-// simply a string.
+// When profiling code, two types of events can be used - fixed or dynamic. A fixed event is
+// predefined in the ProfilerEvents enum and by the FixedEventDesc struct. A dynamic event is
+// registered by name with ProfilerRegisterEvent(), or recorded by name directly. Both appear in
+// the summary report.
 //
 // To profile a section of code, call ProfilerTimeBegin() and ProfilerTimeEnd(), or the scoped
 // object ScopeProfile. When the GPU sync flag is set in the FixedEventDesc and in ProfilerInit(),
@@ -26,6 +29,10 @@
 // and ProfilerThroughputEnd() calls should be used. The throughput APIs can only be used
 // with fixed events.
 //
+// Work that is handed over between threads, such as a prefetched minibatch, can be followed in the
+// detail log with flow events: ProfilerFlowBegin(), ProfilerFlowStep() and ProfilerFlowEnd() draw an
+// arrow between the events that enclose them on the respective threads.
+//
 // CNTK specifics
 //
 // The profiler is turned off during the very first epoch to avoid polluting profile data with
@@ -79,6 +86,11 @@ enum ProfilerEvents
 
     // Data reader events
     profilerEvtPrefetchMinibatch,           // Prefetching the next minibatch in a background thread
+    profilerEvtReadSequences,               // Getting the sequences of a minibatch from the randomizer and deserializers
+    profilerEvtTransformSequences,          // Applying the transforms to the sequences of a minibatch
+    profilerEvtPackMinibatch,               // Packing the sequences into the minibatch buffers
+    profilerEvtPrefetchTransfer,            // Filling the input matrices with a prefetched minibatch in a background thread
+    profilerEvtPrefetchWait,                // Waiting for a prefetched minibatch in GetMinibatch()
 
     profilerEvtMax
 };
@@ -87,7 +99,7 @@ enum ProfilerEvents
 //
 // Initialize all resources to enable profiling.
 // profilerDir: Directory where the profiler logs will be saved.
-// customEventBufferBytes: Bytes to allocate for the custom event buffer.
+// customEventBufferBytes: Bytes to allocate for the event buffer of each recording thread.
 // logSuffix: Suffix string to append to log files.
 // syncGpu: Wait for GPU to complete processing for each profiling event.
 //
@@ -104,7 +116,15 @@ void PERF_PROFILER_API ProfilerEnable(bool enable);
 
 
 //
-// Measure either a fixed or custom event time.
+// Register a dynamic event, and return its id. Ids are stable for the lifetime of the process,
+// and registering the same description again returns the same id. The id can be cached by
+// the caller and passed to ProfilerTimeEnd(), which avoids the name lookup.
+//
+int PERF_PROFILER_API ProfilerRegisterEvent(const char* eventDescription);
+
+
+//
+// Measure either a fixed or dynamic event time.
 // ProfilerTimeBegin() returns a stateId that is passed to ProfilerTimeEnd().
 // If ProfilerTimeEnd() is not called, the event is not recorded.
 //
@@ -112,6 +132,24 @@ long long PERF_PROFILER_API ProfilerTimeBegin();
 void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const int eventId);
 void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const char* eventDescription);
 
+
+//
+// Connect events on different threads in the detail log.
+// ProfilerNewFlowId() returns a process-wide unique flow id. ProfilerFlowBegin() is called inside the
+// producing event, ProfilerFlowStep() inside intermediate ones, and ProfilerFlowEnd() inside the consuming
+// event. The eventId names the flow.
+//
+unsigned long long PERF_PROFILER_API ProfilerNewFlowId();
+void PERF_PROFILER_API ProfilerFlowBegin(const unsigned long long flowId, const int eventId);
+void PERF_PROFILER_API ProfilerFlowStep(const unsigned long long flowId, const int eventId);
+void PERF_PROFILER_API ProfilerFlowEnd(const unsigned long long flowId, const int eventId);
+
+
+//
+// Name the calling thread in the detail log.
+//
+void PERF_PROFILER_API ProfilerSetThreadName(const char* threadName);
+
 //
 // Conditionally sync the GPU if the syncGPU flag is set. This only needs to be excplicitly
 // called for custom events.
@@ -66,6 +66,8 @@ namespace CNTK {
 
         m_filepath = Microsoft::MSR::CNTK::ToFixedWStringFromMultiByte(config(L"file"));
         m_keepDataInMemory = config(L"keepDataInMemory", false);
+        m_chunkCacheFilepath = (std::wstring)config(L"chunkCacheFile", L"");
+        m_chunkCacheMaxResidentBytes = config(L"chunkCacheMaxResidentBytes", g_4GB);
 
         m_randomizationWindow = GetRandomizationWindowFromConfig(config);
         m_sampleBasedRandomizationWindow = config(L"sampleBasedRandomizationWindow", false);
@@ -35,6 +35,10 @@ public:
 
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    const wstring& GetChunkCacheFilePath() const { return m_chunkCacheFilepath; }
+
+    size_t GetChunkCacheMaxResidentBytes() const { return m_chunkCacheMaxResidentBytes; }
+
     DataType GetElementType() const { return m_elementType; }
 
     DISABLE_COPY_AND_MOVE(BinaryConfigHelper);
@@ -49,6 +53,8 @@ private:
     bool m_sampleBasedRandomizationWindow;
     unsigned int m_traceLevel;
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    std::wstring m_chunkCacheFilepath; // if not empty, deserialized chunks are spilled to this file and memory-mapped from it
+    size_t m_chunkCacheMaxResidentBytes; // how much of the spilled chunks are kept referenced in memory
 };
 
 }
@@ -31,7 +31,13 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
     {
         m_deserializer = shared_ptr<DataDeserializer>(new BinaryChunkDeserializer(configHelper));
 
-        if (configHelper.ShouldKeepDataInMemory())
+        if (!configHelper.GetChunkCacheFilePath().empty())
+        {
+            m_deserializer = shared_ptr<DataDeserializer>(new ChunkCache(m_deserializer, configHelper.GetChunkCacheFilePath(),
+                                                                         configHelper.GetChunkCacheMaxResidentBytes(), configHelper.GetFilePath()));
+            log << " | caching chunks on disk";
+        }
+        else if (configHelper.ShouldKeepDataInMemory())
         {
             m_deserializer = shared_ptr<DataDeserializer>(new ChunkCache(m_deserializer));
             log << " | keeping data in memory";
@@ -34,7 +34,9 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
         else
             m_deserializer = make_shared<TextParser<double>>(corpus, configHelper, true);
 
-        if (configHelper.ShouldKeepDataInMemory())
+        if (!configHelper.GetChunkCacheFilePath().empty())
+            m_deserializer = make_shared<ChunkCache>(m_deserializer, configHelper.GetChunkCacheFilePath(), configHelper.GetChunkCacheMaxResidentBytes(), configHelper.GetFilePath());
+        else if (configHelper.ShouldKeepDataInMemory())
             m_deserializer = make_shared<ChunkCache>(m_deserializer);
 
         size_t window = configHelper.GetRandomizationWindow();
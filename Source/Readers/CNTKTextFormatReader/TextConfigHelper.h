@@ -39,8 +39,14 @@ public:
 
     size_t GetChunkSize() const { return m_chunkSizeBytes; }
 
+    unsigned int GetNumParsingThreads() const { return m_numParsingThreads; }
+
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    const wstring& GetChunkCacheFilePath() const { return m_chunkCacheFilepath; }
+
+    size_t GetChunkCacheMaxResidentBytes() const { return m_chunkCacheMaxResidentBytes; }
+
     bool IsInFrameMode() const { return m_frameMode; }
 
     DataType GetDataType() const { return m_elementType; }
@@ -60,9 +66,12 @@ private:
     unsigned int m_traceLevel;
     size_t m_chunkSizeBytes; // chunks size in bytes
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    std::wstring m_chunkCacheFilepath; // if not empty, deserialized chunks are spilled to this file and memory-mapped from it
+    size_t m_chunkCacheMaxResidentBytes; // how much of the spilled chunks are kept referenced in memory
     bool m_frameMode; // if true, the maximum expected sequence length in the dataset is one sample.
     bool m_cacheIndex; // When true, the index will be loaded from a cache file it if exists.
                        // If cache does not exist, the index, once created, will be written out to a file.
+    unsigned int m_numParsingThreads; // number of threads that parse a chunk (0 = the OpenMP default)
 };
 
 }
@@ -7,10 +7,14 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <cfloat>
-#include "BufferedFileReader.h"
+#include <omp.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include "IndexBuilder.h"
 #include "TextParser.h"
 #include "TextReaderConstants.h"
+#include "ExceptionCapture.h"
 #include "File.h"
 
 #define isSign(c) ((c == '-' || c == '+'))
@@ -37,6 +41,155 @@ enum State
     Exponent
 };
 
+// below this size, a chunk is parsed on the calling thread
+static const size_t s_minParallelParsingBytes = 1024 * 1024;
+
+// Returns the position of the first name prefix or row delimiter in [begin, end), or end if there is none.
+// Compares 16 characters at a time where SSE2 is available.
+static const char* FindNamePrefixOrRowDelimiter(const char* begin, const char* end)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i prefix = _mm_set1_epi8(NAME_PREFIX);
+    const __m128i rowDelimiter = _mm_set1_epi8(ROW_DELIMITER);
+    for (; end - begin >= 16; begin += 16)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, prefix), _mm_cmpeq_epi8(chars, rowDelimiter)));
+        if (mask != 0)
+        {
+#ifdef _MSC_VER
+            unsigned long first;
+            _BitScanForward(&first, mask);
+            return begin + first;
+#else
+            return begin + __builtin_ctz(mask);
+#endif
+        }
+    }
+#endif
+    for (; begin != end; ++begin)
+    {
+        if (*begin == NAME_PREFIX || *begin == ROW_DELIMITER)
+            return begin;
+    }
+    return end;
+}
+
+// Reads a run of decimal digits as number = number * 10 + digit, the same recurrence the state machine in
+// TryReadRealNumber() uses. The first 15 digits are accumulated in an integer: their value is below 2^53,
+// so all intermediate results are exact either way, and the integer arithmetic is much cheaper.
+static const char* ReadDigits(const char* p, const char* end, double& number, size_t& numDigits)
+{
+    const char* begin = p;
+    uint64_t integer = 0;
+    for (; p != end && IsDigit(*p) && p - begin < 15; ++p)
+        integer = integer * 10 + (*p - '0');
+
+    number = static_cast<double>(integer);
+    for (; p != end && IsDigit(*p); ++p)
+        number = number * 10 + (*p - '0');
+
+    numDigits = p - begin;
+    return p;
+}
+
+// Returns 10^n, computed as a product of tens like the state machine in TryReadRealNumber() does
+// (the powers up to 10^22 are exact, and are taken from a table).
+static double PowerOfTen(size_t n)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const size_t numPowers = sizeof(powers) / sizeof(powers[0]);
+    if (n < numPowers)
+        return powers[n];
+
+    double result = powers[numPowers - 1];
+    for (size_t i = numPowers - 1; i < n; ++i)
+        result *= 10;
+    return result;
+}
+
+// Fast path of TryReadRealNumber() for the common case of a well-formed number that is followed
+// by another character of the same sequence. Performs the same floating point operations as the state
+// machine in TryReadRealNumber(), so that both produce identical values. Returns the position following
+// the number, or nullptr if the input must go through the state machine (malformed numbers, which need
+// a warning, and numbers that run up to the end of the sequence).
+static const char* TryParseRealNumber(const char* p, const char* end, double& value)
+{
+    bool negative = false;
+    if (p != end && isSign(*p))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p == end || !IsDigit(*p))
+        return nullptr;
+
+    double number, coefficient;
+    size_t numDigits;
+    p = ReadDigits(p, end, number, numDigits);
+    if (p == end)
+        return nullptr;
+
+    if (*p == '.')
+    {
+        if (++p == end)
+            return nullptr;
+
+        if (!IsDigit(*p))
+        {
+            value = negative ? -number : number;
+            return p;
+        }
+
+        coefficient = number;
+        p = ReadDigits(p, end, number, numDigits);
+        if (p == end)
+            return nullptr;
+
+        coefficient += (number / PowerOfTen(numDigits));
+        if (!isE(*p))
+        {
+            value = negative ? -coefficient : coefficient;
+            return p;
+        }
+
+        if (negative)
+            coefficient = -coefficient;
+    }
+    else if (isE(*p))
+    {
+        coefficient = negative ? -number : number;
+    }
+    else
+    {
+        value = negative ? -number : number;
+        return p;
+    }
+
+    // skip the letter E, read the exponent
+    ++p;
+    negative = false;
+    if (p != end && isSign(*p))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p == end || !IsDigit(*p))
+        return nullptr;
+
+    p = ReadDigits(p, end, number, numDigits);
+    if (p == end)
+        return nullptr;
+
+    value = coefficient * pow(10.0, negative ? -number : number);
+    return p;
+}
+
 template <class ElemType>
 class TextParser<ElemType>::TextDataChunk : public Chunk, public std::enable_shared_from_this<Chunk>
 {
@@ -69,6 +222,7 @@ TextParser(corpus, helper.GetFilePath(), helper.GetStreams(), primary)
     SetMaxAllowedErrors(helper.GetMaxAllowedErrors());
     SetChunkSize(helper.GetChunkSize());
     SetSkipSequenceIds(helper.ShouldSkipSequenceIds());
+    SetNumParsingThreads(helper.GetNumParsingThreads());
 
     SetCacheIndex(helper.ShouldCacheIndex());
 
@@ -82,7 +236,6 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_streamDescriptors(streams),
     m_filename(filename),
     m_file(nullptr),
-    m_fileReader(nullptr),
     m_streamInfos(streams.size()),
     m_index(nullptr),
     m_chunkSizeBytes(0),
@@ -91,6 +244,7 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_numAllowedErrors(0),
     m_skipSequenceIds(false),
     m_numRetries(5),
+    m_numParsingThreads(0),
     m_corpus(corpus),
     m_useMaximumAsSequenceLength(true),
     m_cacheIndex(false)
@@ -140,8 +294,6 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     }
 
     assert(m_maxAliasLength > 0);
-
-    m_scratch = unique_ptr<char[]>(new char[m_maxAliasLength + 1]);
 }
 
 template <class ElemType>
@@ -197,8 +349,6 @@ void TextParser<ElemType>::Initialize()
         }
 
         m_index = builder.Build();
-
-        m_fileReader = std::make_shared<BufferedFileReader>(BUFFER_SIZE, *m_file);
     });
 
     assert(m_index != nullptr);
@@ -266,12 +416,6 @@ ChunkPtr TextParser<ElemType>::GetChunk(ChunkIdType chunkId)
 
     attempt(m_numRetries, [this, &textChunk, &chunkDescriptor]()
     {
-        if (m_file->CheckError())
-        {
-            m_file.reset(new FileWrapper(m_filename, L"rbS"));
-            m_file->CheckIsOpenOrDie();
-        }
-
         LoadChunk(textChunk, chunkDescriptor);
     });
 
@@ -281,35 +425,82 @@ ChunkPtr TextParser<ElemType>::GetChunk(ChunkIdType chunkId)
 template <class ElemType>
 void TextParser<ElemType>::LoadChunk(TextChunkPtr& chunk, const ChunkDescriptor& descriptor)
 {
-    chunk->m_sequenceMap.resize(descriptor.NumberOfSequences());
-    for (size_t sequenceIndex = 0; sequenceIndex < descriptor.NumberOfSequences(); ++sequenceIndex)
+    // The whole chunk is read into memory with a single read. Every chunk gets its own file handle,
+    // so several chunks can be loaded at the same time (e.g., by a prefetching randomizer).
+    vector<char> buffer(descriptor.SizeInBytes());
+    if (!buffer.empty())
     {
-        const auto& sequenceDescriptor = descriptor.Sequences()[sequenceIndex];
-        chunk->m_sequenceMap[sequenceIndex] = LoadSequence(sequenceDescriptor, descriptor.StartOffset());
+        auto file = FileWrapper::OpenOrDie(m_filename, L"rbS");
+        file.SeekOrDie(descriptor.StartOffset(), SEEK_SET);
+        file.ReadOrDie(buffer.data(), buffer.size(), 1);
     }
+
+    const auto& sequences = descriptor.Sequences();
+    chunk->m_sequenceMap.resize(sequences.size());
+
+    const int numThreads = m_numParsingThreads > 0 ? (int)m_numParsingThreads : omp_get_max_threads();
+    if (numThreads <= 1 || sequences.size() <= 1 || buffer.size() < s_minParallelParsingBytes)
+    {
+        for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
+            chunk->m_sequenceMap[sequenceIndex] = LoadSequence(sequences[sequenceIndex], buffer, descriptor.StartOffset());
+        return;
+    }
+
+    // Sequences are independent of each other, parse them in parallel.
+    // Once a sequence has failed, there is no point in parsing the rest of the chunk.
+    std::atomic<bool> failed(false);
+    ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic, 16) num_threads(numThreads)
+    for (int sequenceIndex = 0; sequenceIndex < (int)sequences.size(); ++sequenceIndex)
+    {
+        if (failed)
+            continue;
+
+        capture.SafeRun([this, &chunk, &sequences, &buffer, &descriptor, &failed](int i)
+        {
+            try
+            {
+                chunk->m_sequenceMap[i] = LoadSequence(sequences[i], buffer, descriptor.StartOffset());
+            }
+            catch (...)
+            {
+                failed = true;
+                throw;
+            }
+        }, sequenceIndex);
+    }
+    capture.RethrowIfHappened();
 }
 
 template <class ElemType>
 void TextParser<ElemType>::IncrementNumberOfErrorsOrDie()
 {
-    if (m_numAllowedErrors == 0)
+    unsigned int numAllowedErrors = m_numAllowedErrors;
+    do
     {
-        PrintWarningNotification();
-        RuntimeError("Reached the maximum number of allowed errors"
-            " while reading the input file (%ls).",
-            m_filename.c_str());
-    }
-    --m_numAllowedErrors;
+        if (numAllowedErrors == 0)
+        {
+            PrintWarningNotification();
+            RuntimeError("Reached the maximum number of allowed errors"
+                " while reading the input file (%ls).",
+                m_filename.c_str());
+        }
+    } while (!m_numAllowedErrors.compare_exchange_weak(numAllowedErrors, numAllowedErrors - 1));
 }
 
 template <class ElemType>
-typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence(const SequenceDescriptor& sequenceDsc, size_t chunkOffsetInFile)
+typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence(const SequenceDescriptor& sequenceDsc,
+    const vector<char>& chunkBuffer, size_t chunkOffsetInFile)
 {
-    size_t fileOffset = sequenceDsc.OffsetInChunk() + chunkOffsetInFile;
+    if ((size_t)sequenceDsc.OffsetInChunk() + sequenceDsc.SizeInBytes() > chunkBuffer.size())
+        RuntimeError("Sequence (id = %" PRIu64 ") lies outside of its chunk in the input file (%ls).",
+            sequenceDsc.m_key, m_filename.c_str());
 
-    m_fileReader->SetFileOffset(fileOffset);
-
-    size_t bytesToRead = sequenceDsc.SizeInBytes();
+    Cursor input;
+    input.m_chunkBegin = chunkBuffer.data();
+    input.m_chunkOffset = chunkOffsetInFile;
+    input.m_position = input.m_chunkBegin + sequenceDsc.OffsetInChunk();
+    input.m_end = input.m_position + sequenceDsc.SizeInBytes();
 
     SequenceBuffer sequence;
 
@@ -329,9 +520,9 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
 
     size_t numRowsRead = 0, expectedRowCount = sequenceDsc.m_numberOfSamples;
     size_t rowNumber = 1;
-    while(bytesToRead)
+    while (input.CanRead())
     {
-        if ((TryReadRow(sequence, bytesToRead)))
+        if ((TryReadRow(sequence, input)))
         {
             ++numRowsRead;
         }
@@ -344,7 +535,7 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
                     " while loading sequence (id = %" PRIu64 ") %ls.\n",
                     rowNumber,
                     sequenceDsc.m_key,
-                    GetFileInfo().c_str());
+                    GetFileInfo(input).c_str());
             }
             IncrementNumberOfErrorsOrDie();
         }
@@ -358,7 +549,7 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
             " expected for the current sequence (id = %" PRIu64 ") %ls,"
             " but only read %" PRIu64 " out of %" PRIu64 " expected rows.\n",
             sequenceDsc.m_key,
-            GetFileInfo().c_str(), numRowsRead, expectedRowCount);
+            GetFileInfo(input).c_str(), numRowsRead, expectedRowCount);
 
     }
 
@@ -372,7 +563,7 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
         {
             fprintf(stderr,
                 "ERROR: Input ('%ls') is empty in sequence (id = %" PRIu64 ") %ls.\n",
-                m_streams[i].m_name.c_str(), sequenceDsc.m_key, GetFileInfo().c_str());
+                m_streams[i].m_name.c_str(), sequenceDsc.m_key, GetFileInfo(input).c_str());
             hasEmptyInputs = true;
         }
 
@@ -392,7 +583,7 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
                     "WARNING: Input ('%ls') contains more samples than expected"
                     " (%u vs. %" PRIu64 ") for sequence (id = %" PRIu64 ") %ls.\n",
                     m_streams[i].m_name.c_str(), sequence[i]->m_numberOfSamples,
-                    expectedRowCount, sequenceDsc.m_key, GetFileInfo().c_str());
+                    expectedRowCount, sequenceDsc.m_key, GetFileInfo(input).c_str());
             }
         }
         
@@ -416,7 +607,7 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
                 "WARNING: Number of samples for sequence (id = %" PRIu64 ") %ls"
                 " is less than expected (%u vs. %" PRIu64 ").\n",
                 sequenceDsc.m_key,
-                GetFileInfo().c_str(), overallSequenceLength, expectedRowCount);
+                GetFileInfo(input).c_str(), overallSequenceLength, expectedRowCount);
         }
         IncrementNumberOfErrorsOrDie();
     }
@@ -426,7 +617,7 @@ typename TextParser<ElemType>::SequenceBuffer TextParser<ElemType>::LoadSequence
         fprintf(stderr,
             "INFO: Finished loading sequence (id = %" PRIu64 ") %ls,"
             " successfully read %" PRIu64 " out of expected %" PRIu64 " rows.\n",
-            sequenceDsc.m_key, GetFileInfo().c_str(), numRowsRead, expectedRowCount);
+            sequenceDsc.m_key, GetFileInfo(input).c_str(), numRowsRead, expectedRowCount);
     }
 
     FillSequenceMetadata(sequence, { sequenceDsc.m_key, 0 });
@@ -452,38 +643,36 @@ void TextParser<ElemType>::FillSequenceMetadata(SequenceBuffer& sequenceData, co
 }
 
 template <class ElemType>
-bool TextParser<ElemType>::TryReadRow(SequenceBuffer& sequence, size_t& bytesToRead)
+bool TextParser<ElemType>::TryReadRow(SequenceBuffer& sequence, Cursor& input)
 {
-    while (bytesToRead && CanRead() && IsDigit(m_fileReader->Peek()))
+    while (input.CanRead() && IsDigit(input.Peek()))
     {
         // skip sequence ids
-        m_fileReader->Pop();
-        --bytesToRead;
+        input.Pop();
     }
 
     size_t numSampleRead = 0;
 
-    while (bytesToRead && CanRead())
+    while (input.CanRead())
     {
-        char c = m_fileReader->Peek();
+        char c = input.Peek();
 
         if (c == ROW_DELIMITER)
         {
             // found the end of row, skip the delimiter, return.
-            m_fileReader->Pop();
-            --bytesToRead;
+            input.Pop();
 
             if (numSampleRead == 0 && ShouldWarn())
             {
                 fprintf(stderr,
-                    "WARNING: Empty input row %ls.\n", GetFileInfo().c_str());
+                    "WARNING: Empty input row %ls.\n", GetFileInfo(input).c_str());
             }
             else if (numSampleRead > m_streams.size() && ShouldWarn())
             {
                 fprintf(stderr,
                     "WARNING: Input row %ls contains more"
                     " samples than expected (%" PRIu64 " vs. %" PRIu64 ").\n",
-                    GetFileInfo().c_str(), numSampleRead, m_streams.size());
+                    GetFileInfo(input).c_str(), numSampleRead, m_streams.size());
             }
 
             return numSampleRead > 0;
@@ -492,19 +681,18 @@ bool TextParser<ElemType>::TryReadRow(SequenceBuffer& sequence, size_t& bytesToR
         if (isColumnDelimiter(c))
         {
             // skip column (input) delimiters.
-            m_fileReader->Pop();
-            --bytesToRead;
+            input.Pop();
             continue;
         }
 
-        if (TryReadSample(sequence, bytesToRead))
+        if (TryReadSample(sequence, input))
         {
             numSampleRead++;
         }
         else
         {
             // skip over until the next sample/end of row
-            SkipToNextInput(bytesToRead);
+            SkipToNextInput(input);
         }
     }
 
@@ -513,47 +701,45 @@ bool TextParser<ElemType>::TryReadRow(SequenceBuffer& sequence, size_t& bytesToR
         fprintf(stderr,
             "WARNING: Exhausted all input expected for the current sequence"
             " while reading an input row %ls."
-            " Possibly, a trailing newline is missing.\n", GetFileInfo().c_str());
+            " Possibly, a trailing newline is missing.\n", GetFileInfo(input).c_str());
     }
 
-    // Return true when we've consumed all expected input.
-    return bytesToRead == 0;
+    // We've consumed all expected input.
+    return true;
 }
 
 // Reads one sample (an pipe-prefixed input identifier followed by a list of values)
 template <class ElemType>
-bool TextParser<ElemType>::TryReadSample(SequenceBuffer& sequence, size_t& bytesToRead)
+bool TextParser<ElemType>::TryReadSample(SequenceBuffer& sequence, Cursor& input)
 {
     // prefix check.
-    if (m_fileReader->Peek() != NAME_PREFIX)
+    if (input.Peek() != NAME_PREFIX)
     {
         if (ShouldWarn())
         {
             fprintf(stderr,
                 "WARNING: Unexpected character('%c') in place of a name prefix ('%c')"
                 " in an input name %ls.\n",
-                m_fileReader->Peek(), NAME_PREFIX, GetFileInfo().c_str());
+                input.Peek(), NAME_PREFIX, GetFileInfo(input).c_str());
         }
         IncrementNumberOfErrorsOrDie();
         return false;
     }
 
     // skip name prefix
-    m_fileReader->Pop();
-    --bytesToRead;
+    input.Pop();
 
-    if (bytesToRead && CanRead() && m_fileReader->Peek() == ESCAPE_SYMBOL)
+    if (input.CanRead() && input.Peek() == ESCAPE_SYMBOL)
     {
         // A vertical bar followed by the number sign (|#) is treated as an escape sequence, 
         // everything that follows is ignored until the next vertical bar or the end of 
         // row, whichever comes first.
-        m_fileReader->Pop();
-        --bytesToRead;
+        input.Pop();
         return false;
     }
 
     size_t id;
-    if (!TryGetInputId(id, bytesToRead))
+    if (!TryGetInputId(id, input))
     {
         return false;
     }
@@ -566,7 +752,7 @@ bool TextParser<ElemType>::TryReadSample(SequenceBuffer& sequence, size_t& bytes
         vector<ElemType>& values = data->m_buffer;
         size_t size = values.size();
         assert(size % stream.m_sampleShape.Dimensions()[0] == 0);
-        if (!TryReadDenseSample(values, stream.m_sampleShape.Dimensions()[0], bytesToRead))
+        if (!TryReadDenseSample(values, stream.m_sampleShape.Dimensions()[0], input))
         {
             // expected a dense sample, but was not able to fully read it, ignore it.
             if (values.size() != size)
@@ -587,7 +773,7 @@ bool TextParser<ElemType>::TryReadSample(SequenceBuffer& sequence, size_t& bytes
         vector<SparseIndexType>& indices = data->m_indicesBuffer;
         assert(values.size() == indices.size());
         size_t size = values.size();
-        if (!TryReadSparseSample(values, indices, stream.m_sampleShape.Dimensions()[0], bytesToRead))
+        if (!TryReadSparseSample(values, indices, stream.m_sampleShape.Dimensions()[0], input))
         {
             // expected a sparse sample, but something went south, ignore it.
             if (values.size() != size)
@@ -615,22 +801,23 @@ bool TextParser<ElemType>::TryReadSample(SequenceBuffer& sequence, size_t& bytes
 }
 
 template <class ElemType>
-bool TextParser<ElemType>::TryGetInputId(size_t& id, size_t& bytesToRead)
+bool TextParser<ElemType>::TryGetInputId(size_t& id, Cursor& input)
 {
-    char* scratchIndex = m_scratch.get();
+    // the name is parsed in place, directly from the chunk buffer
+    const char* nameBegin = input.m_position;
 
-    for (; bytesToRead && CanRead(); m_fileReader->Pop(), --bytesToRead)
+    for (; input.CanRead(); input.Pop())
     {
-        unsigned char c = m_fileReader->Peek();
+        unsigned char c = input.Peek();
 
         // stop as soon as there's a value delimiter, an input prefix
         // or a non-printable character (e.g., newline, carriage return).
         if (isValueDelimiter(c) || c == NAME_PREFIX || isNonPrintable(c))
         {
-            size_t size = scratchIndex - m_scratch.get();
+            size_t size = input.m_position - nameBegin;
             if (size)
             {
-                string name(m_scratch.get(), size);
+                string name(nameBegin, size);
                 auto it = m_aliasToIdMap.find(name);
                 if (it != m_aliasToIdMap.end())
                 {
@@ -643,7 +830,7 @@ bool TextParser<ElemType>::TryGetInputId(size_t& id, size_t& bytesToRead)
                     fprintf(stderr,
                         "INFO: Skipping unknown input ('%s') %ls. "
                         "Input name '%s' was not specified in the reader config section.\n",
-                        name.c_str(), GetFileInfo().c_str(), name.c_str());
+                        name.c_str(), GetFileInfo(input).c_str(), name.c_str());
                 }
 
                 // return false here to skip this input, but do not call IncrementNumberOfErrorsOrDie()
@@ -655,46 +842,33 @@ bool TextParser<ElemType>::TryGetInputId(size_t& id, size_t& bytesToRead)
                 fprintf(stderr,
                     "WARNING: Input name prefix ('%c') is followed by"
                     " an invalid character ('%c') %ls.\n",
-                    NAME_PREFIX, c, GetFileInfo().c_str());
+                    NAME_PREFIX, c, GetFileInfo(input).c_str());
             }
 
             break;
         }
-        else if (scratchIndex < (m_scratch.get() + m_maxAliasLength))
-        {
-            *scratchIndex = c;
-            ++scratchIndex;
-        }
-        else
+        else if ((size_t)(input.m_position - nameBegin) >= m_maxAliasLength)
         {
             // the current string length is already equal to the maximum expected length,
             // yet it's not followed by a delimiter.
             if (m_traceLevel >= Info)
             {
-                string namePrefix(m_scratch.get(), m_maxAliasLength);
+                string namePrefix(nameBegin, m_maxAliasLength);
                 fprintf(stderr,
                     "INFO: Skipping unknown input %ls. "
                     "Input name (with the %" PRIu64 "-character prefix '%s') "
                     "exceeds the maximum expected length (%" PRIu64 ").\n",
-                    GetFileInfo().c_str(), m_maxAliasLength, namePrefix.c_str(), m_maxAliasLength);
+                    GetFileInfo(input).c_str(), m_maxAliasLength, namePrefix.c_str(), m_maxAliasLength);
             }
             return false;
         }
     }
 
-    if (ShouldWarn()) {
-        if (bytesToRead == 0)
-        {
-            fprintf(stderr,
-                "WARNING: Exhausted all input expected for the current sequence"
-                " while reading an input name %ls.\n", GetFileInfo().c_str());
-        }
-        else if (!CanRead()) 
-        {
-            fprintf(stderr,
-                "WARNING: Expected %" PRIu64 " more bytes, but no more input is available for the current sequence"
-                " while reading an input name %ls.\n", bytesToRead, GetFileInfo().c_str());
-        }
+    if (ShouldWarn() && !input.CanRead())
+    {
+        fprintf(stderr,
+            "WARNING: Exhausted all input expected for the current sequence"
+            " while reading an input name %ls.\n", GetFileInfo(input).c_str());
     }
     
     // Sequence ends with a dangling input id.
@@ -703,20 +877,19 @@ bool TextParser<ElemType>::TryGetInputId(size_t& id, size_t& bytesToRead)
 }
 
 template <class ElemType>
-bool TextParser<ElemType>::TryReadDenseSample(vector<ElemType>& values, size_t sampleSize, size_t& bytesToRead)
+bool TextParser<ElemType>::TryReadDenseSample(vector<ElemType>& values, size_t sampleSize, Cursor& input)
 {
     size_t counter = 0;
     ElemType value;
 
-    while (bytesToRead && CanRead())
+    while (input.CanRead())
     {
-        char c = m_fileReader->Peek();
+        char c = input.Peek();
 
         if (isValueDelimiter(c))
         {
             // skip value delimiters
-            m_fileReader->Pop();
-            --bytesToRead;
+            input.Pop();
             continue;
         }
 
@@ -730,7 +903,7 @@ bool TextParser<ElemType>::TryReadDenseSample(vector<ElemType>& values, size_t s
                     fprintf(stderr,
                         "WARNING: Dense sample (size = %" PRIu64 ") %ls"
                         " exceeds the expected size (%" PRIu64 ").\n",
-                        counter, GetFileInfo().c_str(), sampleSize);
+                        counter, GetFileInfo(input).c_str(), sampleSize);
                 }
                 return false;
             }
@@ -744,7 +917,7 @@ bool TextParser<ElemType>::TryReadDenseSample(vector<ElemType>& values, size_t s
                     fprintf(stderr,
                         "WARNING: A dense sample %ls has a sparse suffix "
                         "(expected size = %" PRIu64 ", actual size = %" PRIu64 ").\n",
-                        GetFileInfo().c_str(), sampleSize, counter);
+                        GetFileInfo(input).c_str(), sampleSize, counter);
                 }
                 for (; counter < sampleSize; ++counter)
                 {
@@ -755,7 +928,7 @@ bool TextParser<ElemType>::TryReadDenseSample(vector<ElemType>& values, size_t s
             return true;
         }
 
-        if (!TryReadRealNumber(value, bytesToRead))
+        if (!TryReadRealNumber(value, input))
         {
             // bail out.
             return false;
@@ -767,41 +940,31 @@ bool TextParser<ElemType>::TryReadDenseSample(vector<ElemType>& values, size_t s
 
     if (ShouldWarn())
     {
-        if (bytesToRead == 0)
-        {
-            fprintf(stderr,
-                "WARNING: Exhausted all input expected for the current sequence"
-                " while reading a dense sample %ls.\n", GetFileInfo().c_str());
-        }
-        else if (!CanRead())
-        {
-            fprintf(stderr,
-                "WARNING: Expected %" PRIu64 " more bytes, but no more input is available for the current sequence"
-                " while reading a dense sample %ls.\n", bytesToRead, GetFileInfo().c_str());
-        }
+        fprintf(stderr,
+            "WARNING: Exhausted all input expected for the current sequence"
+            " while reading a dense sample %ls.\n", GetFileInfo(input).c_str());
     }
 
-    // If we've consumed all expected input, return true when we've successfully read
+    // We've consumed all expected input, return true when we've successfully read
     // at least a single value
-    return bytesToRead > 0 || counter > 0;
+    return counter > 0;
 }
 
 template <class ElemType>
 bool TextParser<ElemType>::TryReadSparseSample(std::vector<ElemType>& values, std::vector<SparseIndexType>& indices,
-    size_t sampleSize, size_t& bytesToRead)
+    size_t sampleSize, Cursor& input)
 {
     size_t index = 0;
     ElemType value;
 
-    while (bytesToRead && CanRead())
+    while (input.CanRead())
     {
-        char c = m_fileReader->Peek();
+        char c = input.Peek();
 
         if (isValueDelimiter(c))
         {
             // skip value delimiters
-            m_fileReader->Pop();
-            --bytesToRead;
+            input.Pop();
             continue;
         }
 
@@ -813,7 +976,7 @@ bool TextParser<ElemType>::TryReadSparseSample(std::vector<ElemType>& values, st
         }
 
         // read next sparse index
-        if (!TryReadUint64(index, bytesToRead))
+        if (!TryReadUint64(index, input))
         {
             // bail out.
             return false;
@@ -826,14 +989,14 @@ bool TextParser<ElemType>::TryReadSparseSample(std::vector<ElemType>& values, st
                 fprintf(stderr,
                     "WARNING: Sparse index value (%" PRIu64 ") %ls"
                     " exceeds the maximum expected value (%" PRIu64 ").\n",
-                    index, GetFileInfo().c_str(), sampleSize - 1);
+                    index, GetFileInfo(input).c_str(), sampleSize - 1);
             }
             // bail out.
             return false;
         }
 
         // an index must be followed by a delimiter
-        c = m_fileReader->Peek();
+        c = input.Peek();
         if (c != INDEX_DELIMITER)
         {
             if (ShouldWarn())
@@ -842,17 +1005,16 @@ bool TextParser<ElemType>::TryReadSparseSample(std::vector<ElemType>& values, st
                     "WARNING: Unexpected character('%c')"
                     " in place of the index delimiter ('%c')"
                     " after a sparse value index (%" PRIu64 ") %ls.\n",
-                    c, INDEX_DELIMITER, index, GetFileInfo().c_str());
+                    c, INDEX_DELIMITER, index, GetFileInfo(input).c_str());
             }
             return false;
         }
 
         // skip index delimiter
-        m_fileReader->Pop();
-        --bytesToRead;
+        input.Pop();
 
         // read the corresponding value
-        if (!TryReadRealNumber(value, bytesToRead))
+        if (!TryReadRealNumber(value, input))
         {
             // bail out.
             return false;
@@ -863,48 +1025,32 @@ bool TextParser<ElemType>::TryReadSparseSample(std::vector<ElemType>& values, st
     }
 
     if (ShouldWarn())
-    { 
-        if (bytesToRead == 0)
-        {
-            fprintf(stderr,
-                "WARNING: Exhausted all input expected for the current sequence"
-                " while reading a sparse sample %ls.\n", GetFileInfo().c_str());
-        }
-        else if (!CanRead())
-        {
-            fprintf(stderr,
-                "WARNING: Expected %" PRIu64 " more bytes, but no more input is available for the current sequence"
-                " while reading a sparse sample %ls.\n", bytesToRead, GetFileInfo().c_str());
-        }
+    {
+        fprintf(stderr,
+            "WARNING: Exhausted all input expected for the current sequence"
+            " while reading a sparse sample %ls.\n", GetFileInfo(input).c_str());
     }
 
-    // If we've consumed all expected input, return true when we've successfully read
+    // We've consumed all expected input, return true when we've successfully read
     // at least a single value
-    return bytesToRead > 0 || values.size() > 0;
+    return values.size() > 0;
 }
 
 template <class ElemType>
-void TextParser<ElemType>::SkipToNextInput(size_t& bytesToRead)
+void TextParser<ElemType>::SkipToNextInput(Cursor& input)
 {
-    for (; bytesToRead && CanRead(); m_fileReader->Pop(), --bytesToRead)
-    {
-        char c = m_fileReader->Peek();
-        // skip everything until we hit either an input marker or the end of row.
-        if (c == NAME_PREFIX || c == ROW_DELIMITER)
-        {
-            return;
-        }
-    }
+    // skip everything until we hit either an input marker or the end of row.
+    input.m_position = FindNamePrefixOrRowDelimiter(input.m_position, input.m_end);
 }
 
 template <class ElemType>
-bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
+bool TextParser<ElemType>::TryReadUint64(size_t& value, Cursor& input)
 {
     value = 0;
     bool found = false;
-    for (; bytesToRead && CanRead(); m_fileReader->Pop(), --bytesToRead)
+    for (; input.CanRead(); input.Pop())
     {
-        char c = m_fileReader->Peek();
+        char c = input.Peek();
 
         if (!IsDigit(c))
         {
@@ -912,7 +1058,7 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
             {
                 fprintf(stderr,
                     "WARNING: Expected a uint64 value, but none found %ls.\n", 
-                    GetFileInfo().c_str());
+                    GetFileInfo(input).c_str());
             }
 
             return found;
@@ -928,7 +1074,7 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
             {
                 fprintf(stderr,
                     "WARNING: Overflow while reading a uint64 value %ls.\n",
-                    GetFileInfo().c_str());
+                    GetFileInfo(input).c_str());
             }
 
             return false;
@@ -938,18 +1084,9 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 
     if (ShouldWarn())
     {
-        if (bytesToRead == 0) {
-            fprintf(stderr,
-                "WARNING: Exhausted all input expected for the current sequence"
-                " while reading a uint64 value %ls.\n", GetFileInfo().c_str());
-        }
-        else if (!CanRead())
-        {
-            fprintf(stderr,
-                "WARNING: Expected %" PRIu64 " more bytes, but no more input is available for the current sequence"
-                " while reading a uint64 value %ls.\n", bytesToRead, GetFileInfo().c_str());
-        }
-        
+        fprintf(stderr,
+            "WARNING: Exhausted all input expected for the current sequence"
+            " while reading a uint64 value %ls.\n", GetFileInfo(input).c_str());
     }
     
     // A well-formed input cannot end with a uint64 value.
@@ -959,22 +1096,31 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 
 
 // TODO: better precision (at the moment we're at parity with UCIFast)?
-// Assumes that bytesToRead is greater than the number of characters 
+// Assumes that the number of bytes left in the sequence is greater than the number of characters
 // in the string representation of the floating point number
 // (i.e., the string is followed by one of the delimiters)
-// Post condition: m_pos points to the first character that 
+// Post condition: the cursor points to the first character that 
 // cannot be parsed as part of a floating point number.
 // Returns true if parsing was successful.
 template <class ElemType>
-bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRead)
+bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, Cursor& input)
 {
+    double result;
+    const char* next = TryParseRealNumber(input.m_position, input.m_end, result);
+    if (next != nullptr)
+    {
+        value = static_cast<ElemType>(result);
+        input.m_position = next;
+        return true;
+    }
+
     State state = State::Init;
     double coefficient = .0, number = .0, divider = .0;
     bool negative = false;
 
-    for (; bytesToRead && CanRead(); m_fileReader->Pop(), --bytesToRead)
+    for (; input.CanRead(); input.Pop())
     {
-        char c = m_fileReader->Peek();
+        char c = input.Peek();
 
         switch (state)
         {
@@ -997,7 +1143,7 @@ bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRea
                     fprintf(stderr,
                         "WARNING: Unexpected character ('%c')"
                         " in a floating point value %ls.\n",
-                        c, GetFileInfo().c_str());
+                        c, GetFileInfo(input).c_str());
                 }
                 return false;
             }
@@ -1016,7 +1162,7 @@ bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRea
                     fprintf(stderr,
                         "WARNING: A sign symbol is followed by an invalid character('%c')"
                         " in a floating point value %ls.\n",
-                        c, GetFileInfo().c_str());
+                        c, GetFileInfo(input).c_str());
                 }
                 return false;
             }
@@ -1100,7 +1246,7 @@ bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRea
                     fprintf(stderr,
                         "WARNING: An exponent symbol is followed by"
                         " an invalid character('%c')"
-                        " in a floating point value %ls.\n", c, GetFileInfo().c_str());
+                        " in a floating point value %ls.\n", c, GetFileInfo(input).c_str());
                 }
                 return false;
             }
@@ -1119,7 +1265,7 @@ bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRea
                     fprintf(stderr,
                         "WARNING: An exponent sign symbol followed by"
                         " an unexpected character('%c')"
-                        " in a floating point value %ls.\n", c, GetFileInfo().c_str());
+                        " in a floating point value %ls.\n", c, GetFileInfo(input).c_str());
                 }
                 return false;
             }
@@ -1143,56 +1289,44 @@ bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRea
             {
                 fprintf(stderr,
                     "WARNING: Reached an invalid state while reading a floating point value %ls.\n",
-                    GetFileInfo().c_str());
+                    GetFileInfo(input).c_str());
             }
             return false;
         }
     }
 
     // We've run out of input, see if we're in a valid state
-    if (bytesToRead == 0)
+    if (ShouldWarn())
     {
-        if (ShouldWarn())
-        {
-            fprintf(stderr,
-                "WARNING: Exhausted all input expected for the current sequence"
-                " while reading an input row %ls."
-                " Possibly, a trailing newline is missing.\n", GetFileInfo().c_str());
-        }
-
-        switch (state)
-        {
-        case IntegralPart:
-        case Period:
-            value = static_cast<ElemType>((negative) ? -number : number);
-            return true;
-        case FractionalPart:
-            coefficient += (number / divider);
-            value = static_cast<ElemType>((negative) ? -coefficient : coefficient);
-            return true;
-        case Exponent:
-            double exponent = (negative) ? -number : number;
-            value = static_cast<ElemType>(coefficient * pow(10.0, exponent));
-            return true;
-        }
+        fprintf(stderr,
+            "WARNING: Exhausted all input expected for the current sequence"
+            " while reading an input row %ls."
+            " Possibly, a trailing newline is missing.\n", GetFileInfo(input).c_str());
+    }
 
-        // The floating point number we're reading is malformed.
-        if (ShouldWarn())
-        {
-            fprintf(stderr,
-                "WARNING: Reached an invalid state while reading a floating point value %ls.\n",
-                GetFileInfo().c_str());
-        }
-        return false;
+    switch (state)
+    {
+    case IntegralPart:
+    case Period:
+        value = static_cast<ElemType>((negative) ? -number : number);
+        return true;
+    case FractionalPart:
+        coefficient += (number / divider);
+        value = static_cast<ElemType>((negative) ? -coefficient : coefficient);
+        return true;
+    case Exponent:
+        double exponent = (negative) ? -number : number;
+        value = static_cast<ElemType>(coefficient * pow(10.0, exponent));
+        return true;
     }
 
+    // The floating point number we're reading is malformed.
     if (ShouldWarn())
     {
         fprintf(stderr,
-            "WARNING: Expected %" PRIu64 " more bytes, but no more input is available for the current sequence"
-            " while reading an input row %ls.\n", bytesToRead, GetFileInfo().c_str());
+            "WARNING: Reached an invalid state while reading a floating point value %ls.\n",
+            GetFileInfo(input).c_str());
     }
-
     return false;
 }
 
@@ -1232,23 +1366,17 @@ void TextParser<ElemType>::SetCacheIndex(bool value)
     m_cacheIndex = value;
 }
 
-template<class ElemType>
-inline bool TextParser<ElemType>::CanRead()
-{
-    return !m_fileReader->Empty();
-}
-
 template <class ElemType>
-int64_t TextParser<ElemType>::GetFileOffset() const
+void TextParser<ElemType>::SetNumParsingThreads(unsigned int numThreads)
 {
-    return m_fileReader->GetFileOffset();
+    m_numParsingThreads = numThreads;
 }
 
 template <class ElemType>
-std::wstring TextParser<ElemType>::GetFileInfo()
+std::wstring TextParser<ElemType>::GetFileInfo(const Cursor& input)
 {
     std::wstringstream info;
-    info << L"at offset " << GetFileOffset() << L" in the input file (" << m_filename << L")";
+    info << L"at offset " << input.GetFileOffset() << L" in the input file (" << m_filename << L")";
     return info.str();
 }
 
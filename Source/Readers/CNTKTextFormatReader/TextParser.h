@@ -10,6 +10,7 @@
 #include "TextConfigHelper.h"
 #include "Index.h"
 #include "CorpusDescriptor.h"
+#include <atomic>
 
 namespace CNTK {
 
@@ -17,7 +18,6 @@ template <class ElemType>
 class CNTKTextFormatReaderTestRunner;
 
 class FileWrapper;
-class BufferedFileReader;
 
 // TODO: more details when tracing warnings
 // (e.g., buffer content around the char that triggered the warning)
@@ -106,9 +106,30 @@ private:
         Info = 2
     };
 
+    // A read position inside the in-memory copy of a chunk. Every thread that parses
+    // sequences of the chunk has its own cursor, so that the parsing methods below
+    // can run concurrently.
+    struct Cursor
+    {
+        const char* m_position;   // the next character to parse
+        const char* m_end;        // end of the current sequence
+        const char* m_chunkBegin; // beginning of the chunk buffer
+        size_t m_chunkOffset;     // file offset of the chunk buffer
+
+        // Returns true if the current sequence has more input.
+        bool CanRead() const { return m_position != m_end; }
+
+        char Peek() const { return *m_position; }
+
+        void Pop() { ++m_position; }
+
+        size_t BytesLeft() const { return m_end - m_position; }
+
+        size_t GetFileOffset() const { return m_chunkOffset + (m_position - m_chunkBegin); }
+    };
+
     const std::wstring m_filename;
     std::shared_ptr<FileWrapper> m_file;
-    std::shared_ptr<BufferedFileReader> m_fileReader;
 
     // An internal structure to assist with copying from input stream buffers into
     // into sequence data in a proper format.
@@ -121,20 +142,20 @@ private:
 
     std::shared_ptr<Index> m_index;
 
-    unique_ptr<char[]> m_scratch; // local buffer for string parsing
-
     // Indicates if the sequence length is computed as the maximum 
     // of number of samples across all streams (inputs).
     bool m_useMaximumAsSequenceLength;
 
     size_t m_chunkSizeBytes;
     unsigned int m_traceLevel;
-    bool m_hadWarnings;
-    unsigned int m_numAllowedErrors;
+    std::atomic<bool> m_hadWarnings;
+    std::atomic<unsigned int> m_numAllowedErrors; // shared by all threads that parse the input
     bool m_skipSequenceIds;
     bool m_cacheIndex;
     unsigned int m_numRetries; // specifies the number of times an unsuccessful
                                // file operation should be repeated (default value is 5).
+    unsigned int m_numParsingThreads; // number of threads that parse the sequences of a chunk
+                                      // (0 = the OpenMP default, 1 = parse on the calling thread).
 
     // Corpus descriptor.
     CorpusDescriptorPtr m_corpus;
@@ -147,45 +168,41 @@ private:
     // have been swallowed.
     void PrintWarningNotification();
 
-    int64_t GetFileOffset() const;
-
-    void SkipToNextInput(size_t& bytesToRead);
+    void SkipToNextInput(Cursor& input);
 
     // Returns a string containing input file information (current offset, file name, etc.),
     // which can be included as a part of the trace/log message.
-    std::wstring GetFileInfo();
+    std::wstring GetFileInfo(const Cursor& input);
 
     // Reads an alias/name and converts it to an internal stream id (= stream index).
-    bool TryGetInputId(size_t& id, size_t& bytesToRead);
+    bool TryGetInputId(size_t& id, Cursor& input);
 
-    bool TryReadRealNumber(ElemType& value, size_t& bytesToRead);
+    bool TryReadRealNumber(ElemType& value, Cursor& input);
 
-    bool TryReadUint64(size_t& value, size_t& bytesToRead);
+    bool TryReadUint64(size_t& value, Cursor& input);
 
     // Reads dense sample values into the provided vector.
-    bool TryReadDenseSample(std::vector<ElemType>& values, size_t sampleSize, size_t& bytesToRead);
+    bool TryReadDenseSample(std::vector<ElemType>& values, size_t sampleSize, Cursor& input);
 
     // Reads sparse sample values and corresponding indices into the provided vectors.
     bool TryReadSparseSample(std::vector<ElemType>& values, std::vector<SparseIndexType>& indices,
-        size_t sampleSize, size_t& bytesToRead);
+        size_t sampleSize, Cursor& input);
 
     // Reads one sample (an input identifier followed by a list of values)
-    bool TryReadSample(SequenceBuffer& sequence, size_t& bytesToRead);
+    bool TryReadSample(SequenceBuffer& sequence, Cursor& input);
 
     // Reads one whole row (terminated by a row delimiter) of samples
-    bool TryReadRow(SequenceBuffer& sequence, size_t& bytesToRead);
-
-    // Returns true if there's still data available.
-    bool inline CanRead();
+    bool TryReadRow(SequenceBuffer& sequence, Cursor& input);
 
     // Returns true if the trace level is greater or equal to 'Warning'
     bool inline ShouldWarn() { m_hadWarnings = true; return m_traceLevel >= Warning; }
 
-    // Given a descriptor and the file offset of the containing chunk,
-    // retrieves the data for the corresponding sequence from the file.
-    SequenceBuffer LoadSequence(const SequenceDescriptor& descriptor, size_t chunkOffset);
+    // Given a descriptor and the in-memory copy of the containing chunk,
+    // parses the data of the corresponding sequence.
+    SequenceBuffer LoadSequence(const SequenceDescriptor& descriptor, const std::vector<char>& chunkBuffer, size_t chunkOffset);
 
-    // Given a descriptor, retrieves the data for the corresponding chunk from the file.
+    // Given a descriptor, reads the corresponding chunk from the file and parses its sequences
+    // (in parallel, if the chunk is large enough).
     void LoadChunk(TextChunkPtr& chunk, const ChunkDescriptor& descriptor);
 
     // Fills some metadata members to be conformant to the exposed SequenceData interface.
@@ -203,6 +220,8 @@ private:
 
     void SetCacheIndex(bool value);
 
+    void SetNumParsingThreads(unsigned int numThreads);
+
     friend class CNTKTextFormatReaderTestRunner<ElemType>;
 
     DISABLE_COPY_AND_MOVE(TextParser);
@@ -25,6 +25,7 @@
 #include "V2Dependencies.h"
 #include "LTNoRandomizer.h"
 #include "LTTumblingWindowRandomizer.h"
+#include "MultiProcessSequenceEnumerator.h"
 
 namespace CNTK {
 
@@ -180,6 +181,43 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         ? m_sequenceEnumerator
         : std::make_shared<TransformController>(m_transforms, m_sequenceEnumerator, multiThreadedDeserialization);
 
+    // Optionally moving deserialization and transformations into worker processes.
+    size_t numWorkerProcesses = config(L"numWorkerProcesses", (size_t)0);
+    if (numWorkerProcesses > 0)
+    {
+#ifdef _WIN32
+        fprintf(stderr, "WARNING: numWorkerProcesses is not supported on Windows, deserializing in the training process.\n");
+#else
+        if (isActionWrite || m_packingMode == PackingMode::truncated)
+            InvalidArgument("numWorkerProcesses is not supported with truncated BPTT or in the write action.");
+
+        size_t sharedMemorySizeInMB = config(L"workerSharedMemorySizeInMB", (size_t)64);
+        size_t prefetchDepth = config(L"workerPrefetchDepth", (size_t)2);
+
+        // Each worker creates the same pipeline from the config, in-process and single-threaded.
+        // The reader object is kept alive by the returned enumerator.
+        auto factory = [config](size_t workerIndex) -> SequenceEnumeratorPtr
+        {
+            ConfigParameters workerConfig = config;
+            workerConfig.Insert("numWorkerProcesses", "0");
+            workerConfig.Insert("multiThreadedDeserialization", "false");
+            workerConfig.Insert("numParsingThreads", "1");
+            workerConfig.Insert("workerProcessIndex", std::to_string(workerIndex));
+            auto reader = std::make_shared<CompositeDataReader>(workerConfig);
+            return SequenceEnumeratorPtr(reader, reader->m_sequenceEnumerator.get());
+        };
+
+        // The LT randomizers of the simple interface move through the local timeline.
+        m_sequenceEnumerator = std::make_shared<MultiProcessSequenceEnumerator>(
+            m_sequenceEnumerator->GetStreamDescriptions(),
+            numWorkerProcesses,
+            factory,
+            !composable,
+            sharedMemorySizeInMB * 1024 * 1024,
+            prefetchDepth);
+#endif
+    }
+
     // TODO: Output stream descriptions - this should come from the network so that we can check 
     // that input matches what the network expects (including tensor shape, etc.).
     std::vector<StreamInformation> outputStreams = m_sequenceEnumerator->GetStreamDescriptions();
@@ -244,6 +282,7 @@ bool CompositeDataReader::CreateDeserializers(const ConfigParameters& readerConf
     assert(m_deserializers.empty());
 
     auto traceLevel = readerConfig.Find("traceLevel");
+    auto workerProcessIndex = readerConfig.Find("workerProcessIndex");
     bool composable = true;
 
     bool primary = true;  // Currently, the first deserializer becomes primary - it drives chunking.
@@ -258,6 +297,11 @@ bool CompositeDataReader::CreateDeserializers(const ConfigParameters& readerConf
             p.Insert("traceLevel", traceLevel);
         }
 
+        if (!workerProcessIndex.empty())
+        {
+            p.Insert("workerProcessIndex", workerProcessIndex);
+        }
+
         composable &= p(L"composable", true);
         DataDeserializerPtr d = CreateDeserializer(p, primary);
         primary = false;
@@ -322,6 +366,14 @@ void CompositeDataReader::CreateTransforms(const ConfigParameters& deserializerC
             ConfigParameters p = transforms[j];
             p.Insert("precision", deserializerConfig("precision"));
 
+            // Worker processes should not apply the same random augmentations.
+            if (deserializerConfig.ExistsCurrent("workerProcessIndex"))
+            {
+                size_t workerIndex = deserializerConfig("workerProcessIndex");
+                unsigned int seed = p(L"seed", 0u);
+                p.Insert("seed", std::to_string(seed + (workerIndex << 16)));
+            }
+
             TransformerPtr transformer = CreateTransformer(p, defaultModule, std::wstring());
             m_transforms.push_back(Transformation{ transformer, inputName });
         }
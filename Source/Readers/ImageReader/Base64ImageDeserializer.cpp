@@ -113,6 +113,15 @@ namespace CNTK {
             }
             else
             {
+                if (m_deserializer.m_scaledDecoding)
+                {
+                    auto encoded = std::make_shared<EncodedImage>();
+                    encoded->m_data.assign(decodedImage.begin(), decodedImage.end());
+                    encoded->m_grayscale = m_deserializer.m_grayscale;
+                    if (m_deserializer.PopulateSequenceData(encoded, classId, copyId, { sequence.m_key, 0 }, result))
+                        return;
+                }
+
                 image = cv::imdecode(decodedImage, m_deserializer.m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
             }
 
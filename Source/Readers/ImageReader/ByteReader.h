@@ -26,6 +26,9 @@ public:
     virtual void Register(const MultiMap& sequences) = 0;
     virtual cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) = 0;
 
+    // Reads the compressed image without decoding it.
+    virtual void ReadBytes(size_t seqId, const std::string& path, std::vector<unsigned char>& bytes) = 0;
+
     DISABLE_COPY_AND_MOVE(ByteReader);
 };
 
@@ -37,6 +40,7 @@ public:
 
     void Register(const MultiMap&) override {}
     cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) override;
+    void ReadBytes(size_t seqId, const std::string& path, std::vector<unsigned char>& bytes) override;
 
     std::string m_expandDirectory;
 };
@@ -49,6 +53,7 @@ public:
 
     void Register(const std::map<std::string, std::vector<size_t>>& sequences) override;
     cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) override;
+    void ReadBytes(size_t seqId, const std::string& path, std::vector<unsigned char>& bytes) override;
 
 private:
     using ZipPtr = std::unique_ptr<zip_t, void(*)(zip_t*)>;
@@ -36,7 +36,20 @@ public:
         assert(sequenceIndex == 0 && sequenceIndex == m_description.m_indexInChunk);
         UNUSED(sequenceIndex);
 
-        auto cvImage = m_deserializer.ReadImage(m_description.m_key.m_sequence, m_description.m_path, m_deserializer.m_grayscale);
+        cv::Mat cvImage;
+        if (m_deserializer.m_scaledDecoding)
+        {
+            auto encoded = std::make_shared<EncodedImage>();
+            encoded->m_grayscale = m_deserializer.m_grayscale;
+            m_deserializer.ReadImageBytes(m_description.m_key.m_sequence, m_description.m_path, encoded->m_data);
+            if (m_deserializer.PopulateSequenceData(encoded, m_description.m_classId, m_description.m_copyId, m_description.m_key, result))
+                return;
+
+            cvImage = cv::imdecode(encoded->m_data, m_deserializer.m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+        }
+        else
+            cvImage = m_deserializer.ReadImage(m_description.m_key.m_sequence, m_description.m_path, m_deserializer.m_grayscale);
+
         if (!cvImage.data)
             RuntimeError("Cannot open file '%s'", m_description.m_path.c_str());
 
@@ -290,6 +303,17 @@ cv::Mat ImageDataDeserializer::ReadImage(size_t seqId, const std::string& path,
     return (*r).second->Read(seqId, path, grayscale);
 }
 
+void ImageDataDeserializer::ReadImageBytes(size_t seqId, const std::string& path, std::vector<unsigned char>& bytes)
+{
+    assert(!path.empty());
+
+    ImageDataDeserializer::SeqReaderMap::const_iterator r;
+    if (m_readers.empty() || (r = m_readers.find(seqId)) == m_readers.end())
+        m_defaultReader->ReadBytes(seqId, path, bytes);
+    else
+        (*r).second->ReadBytes(seqId, path, bytes);
+}
+
 cv::Mat FileByteReader::Read(size_t, const std::string& seqPath, bool grayscale)
 {
     assert(!seqPath.empty());
@@ -298,6 +322,27 @@ cv::Mat FileByteReader::Read(size_t, const std::string& seqPath, bool grayscale)
     return cv::imread(path, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
 }
 
+void FileByteReader::ReadBytes(size_t, const std::string& seqPath, std::vector<unsigned char>& bytes)
+{
+    assert(!seqPath.empty());
+    auto path = Expand3Dots(seqPath, m_expandDirectory);
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        RuntimeError("Cannot open file '%s'", path.c_str());
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bytes.resize(size < 0 ? 0 : (size_t)size);
+    size_t read = bytes.empty() ? 0 : fread(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    if (size < 0 || read != bytes.size())
+        RuntimeError("Cannot read file '%s'", path.c_str());
+}
+
 bool ImageDataDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
 {
     auto index = m_keyToSequence.find(key.m_sequence);
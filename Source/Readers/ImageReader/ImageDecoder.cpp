@@ -0,0 +1,251 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include "Basics.h"
+#include "ImageDecoder.h"
+#ifdef USE_LIBJPEG_TURBO
+#include <setjmp.h>
+#include <stdio.h>
+#include <jpeglib.h>
+#endif
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// Whether the payload of an APP1 segment is EXIF data with an orientation tag other than the default (1).
+static bool HasExifOrientation(const unsigned char* data, size_t size)
+{
+    static const unsigned char exif[] = { 'E', 'x', 'i', 'f', 0, 0 };
+    if (size < sizeof(exif) + 8 || memcmp(data, exif, sizeof(exif)) != 0)
+        return false;
+
+    // A TIFF header follows: the byte order, 42 and the offset of the first image file directory.
+    const unsigned char* tiff = data + sizeof(exif);
+    size_t tiffSize = size - sizeof(exif);
+    bool littleEndian = tiff[0] == 'I' && tiff[1] == 'I';
+    if (!littleEndian && !(tiff[0] == 'M' && tiff[1] == 'M'))
+        return false;
+
+    auto read16 = [&](size_t offset) -> uint32_t
+    {
+        return littleEndian ? tiff[offset] | (tiff[offset + 1] << 8) : (tiff[offset] << 8) | tiff[offset + 1];
+    };
+    auto read32 = [&](size_t offset) -> uint32_t
+    {
+        return littleEndian ? read16(offset) | (read16(offset + 2) << 16) : (read16(offset) << 16) | read16(offset + 2);
+    };
+
+    size_t directory = read32(4);
+    if (directory + 2 > tiffSize)
+        return false;
+
+    // Entries of 12 bytes: the tag, the type, the count and the value, here a short in the first two bytes.
+    size_t count = read16(directory);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t entry = directory + 2 + 12 * i;
+        if (entry + 12 > tiffSize)
+            return false;
+
+        if (read16(entry) == 0x0112)
+            return read16(entry + 8) != 1;
+    }
+    return false;
+}
+
+bool ReadJpegHeader(const unsigned char* data, size_t size, int& width, int& height, int& components)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+
+    // Walk the markers up to the frame header, which precedes the first scan.
+    size_t pos = 2;
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xFF)
+            return false;
+
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) // Fill byte.
+        {
+            pos++;
+            continue;
+        }
+
+        // Markers without a payload.
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+        {
+            pos += 2;
+            continue;
+        }
+
+        size_t length = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+        if (length < 2 || pos + 2 + length > size)
+            return false;
+
+        // OpenCV rotates images with an EXIF orientation on decoding, which a decoded region would not be.
+        if (marker == 0xE1 && HasExifOrientation(data + pos + 4, length - 2))
+            return false;
+
+        bool isFrameHeader = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isFrameHeader)
+        {
+            // Lossless frames and 12 bit samples are not supported.
+            bool lossless = (marker & 3) == 3;
+            if (lossless || length < 8 || data[pos + 4] != 8)
+                return false;
+
+            height = (data[pos + 5] << 8) | data[pos + 6];
+            width = (data[pos + 7] << 8) | data[pos + 8];
+            components = data[pos + 9];
+            return width > 0 && height > 0;
+        }
+
+        if (marker == 0xDA || marker == 0xD9) // Start of scan or end of image without a frame header.
+            return false;
+
+        pos += 2 + length;
+    }
+    return false;
+}
+
+int SelectJpegScaleDenominator(int width, int height, int minWidth, int minHeight)
+{
+    for (int denominator = 8; denominator > 1; denominator /= 2)
+    {
+        // The decoder rounds the scaled dimensions up.
+        if ((width + denominator - 1) / denominator >= minWidth && (height + denominator - 1) / denominator >= minHeight)
+            return denominator;
+    }
+    return 1;
+}
+
+void NarrowImageRegion(int& x, int& y, int& width, int& height, bool& flip,
+                       int cropX, int cropY, int cropWidth, int cropHeight, bool cropFlip)
+{
+    // A crop of the flipped region is the mirrored crop of the region.
+    if (flip)
+        cropX = width - cropX - cropWidth;
+
+    x += cropX;
+    y += cropY;
+    width = cropWidth;
+    height = cropHeight;
+    flip = flip != cropFlip;
+}
+
+#ifdef USE_LIBJPEG_TURBO
+
+bool IsScaledJpegDecodingSupported()
+{
+    return true;
+}
+
+// libjpeg reports errors through a callback that must not return, so we jump back into DecodeJpegRegion.
+struct JpegErrorManager
+{
+    jpeg_error_mgr m_base;
+    jmp_buf m_jump;
+    char m_message[JMSG_LENGTH_MAX];
+};
+
+static void OnJpegError(j_common_ptr info)
+{
+    auto error = reinterpret_cast<JpegErrorManager*>(info->err);
+    (*info->err->format_message)(info, error->m_message);
+    longjmp(error->m_jump, 1);
+}
+
+DecodedImageRegion DecodeJpegRegion(const unsigned char* data, size_t size, bool grayscale, int denominator,
+                                    int x, int y, int width, int height, std::vector<unsigned char>& buffer)
+{
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 || (denominator != 1 && denominator != 2 && denominator != 4 && denominator != 8))
+        LogicError("DecodeJpegRegion: invalid region (%d, %d, %d, %d) or scale 1/%d.", x, y, width, height, denominator);
+
+    jpeg_decompress_struct info;
+    JpegErrorManager error;
+    info.err = jpeg_std_error(&error.m_base);
+    error.m_base.error_exit = OnJpegError;
+
+    // No objects with destructors may be created between here and the end of the decoding.
+    if (setjmp(error.m_jump))
+    {
+        jpeg_destroy_decompress(&info);
+        RuntimeError("Cannot decode the JPEG image: %s", error.m_message);
+    }
+
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, const_cast<unsigned char*>(data), (unsigned long)size);
+    jpeg_read_header(&info, TRUE);
+
+    info.out_color_space = grayscale ? JCS_GRAYSCALE : JCS_EXT_BGR;
+    info.scale_num = 1;
+    info.scale_denom = denominator;
+    jpeg_start_decompress(&info);
+
+    // The region in the scaled image.
+    JDIMENSION left = (JDIMENSION)(x / denominator);
+    JDIMENSION top = (JDIMENSION)(y / denominator);
+    JDIMENSION right = std::min(info.output_width, (JDIMENSION)((x + width + denominator - 1) / denominator));
+    JDIMENSION bottom = std::min(info.output_height, (JDIMENSION)((y + height + denominator - 1) / denominator));
+    if (left >= right || top >= bottom)
+    {
+        jpeg_destroy_decompress(&info);
+        LogicError("DecodeJpegRegion: the region (%d, %d, %d, %d) is outside of the image.", x, y, width, height);
+    }
+
+    // The decoder widens the columns to whole blocks on the left. On the right, we decode one more column,
+    // otherwise the upsampled chroma of the last column would differ from a decode of the whole image.
+    JDIMENSION firstColumn = left;
+    JDIMENSION columnCount = std::min(right + 1, info.output_width) - left;
+    if (columnCount < info.output_width)
+        jpeg_crop_scanline(&info, &firstColumn, &columnCount);
+
+    size_t stride = (size_t)info.output_width * info.output_components;
+    size_t rowCount = bottom - top;
+    if (buffer.size() < stride * rowCount)
+        buffer.resize(stride * rowCount);
+
+    if (top > 0)
+        jpeg_skip_scanlines(&info, top);
+
+    while (info.output_scanline < bottom)
+    {
+        JSAMPROW row = buffer.data() + (info.output_scanline - top) * stride;
+        jpeg_read_scanlines(&info, &row, 1);
+    }
+
+    DecodedImageRegion result;
+    result.m_channels = info.output_components;
+    result.m_data = buffer.data() + (left - firstColumn) * result.m_channels;
+    result.m_width = (int)(right - left);
+    result.m_height = (int)rowCount;
+    result.m_stride = stride;
+
+    // The rows below the region are never decoded.
+    jpeg_destroy_decompress(&info);
+    return result;
+}
+
+#else
+
+bool IsScaledJpegDecodingSupported()
+{
+    return false;
+}
+
+DecodedImageRegion DecodeJpegRegion(const unsigned char*, size_t, bool, int, int, int, int, int, std::vector<unsigned char>&)
+{
+    LogicError("DecodeJpegRegion: the image reader was built without libjpeg-turbo.");
+}
+
+#endif
+
+}
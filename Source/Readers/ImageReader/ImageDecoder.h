@@ -0,0 +1,51 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ImageDecoder.h -- decoding of a region of a JPEG image at a reduced scale (libjpeg-turbo)
+//
+
+#pragma once
+
+#include <vector>
+
+namespace CNTK {
+
+// Pixels of a decoded region: rows of m_width * m_channels bytes (BGR or grayscale), m_stride bytes apart.
+// m_data points into the buffer that was passed to DecodeJpegRegion().
+struct DecodedImageRegion
+{
+    unsigned char* m_data;
+    int m_width;
+    int m_height;
+    int m_channels;
+    size_t m_stride;
+};
+
+// Whether the reader was built with libjpeg-turbo, i.e. whether DecodeJpegRegion() can be used.
+bool IsScaledJpegDecodingSupported();
+
+// Reads the dimensions and the number of color components from the frame header of a JPEG image,
+// without decoding it. Returns false if the data is not a (supported) JPEG image; images with an EXIF
+// orientation other than the default are not supported, because OpenCV rotates them on decoding.
+bool ReadJpegHeader(const unsigned char* data, size_t size, int& width, int& height, int& components);
+
+// Returns the largest of the denominators 8, 4, 2 and 1 such that a width x height region,
+// scaled down by it, still has at least minWidth x minHeight pixels.
+int SelectJpegScaleDenominator(int width, int height, int minWidth, int minHeight);
+
+// Narrows the region (x, y, width, height) of an image, which is to be flipped horizontally after decoding if flip is set,
+// to the crop (cropX, cropY, cropWidth, cropHeight), which is to be flipped if cropFlip is set. The crop is given in
+// the coordinates of the region as it looks after decoding and flipping, so that cropping the decoded region gives the
+// same pixels as decoding the narrowed one.
+void NarrowImageRegion(int& x, int& y, int& width, int& height, bool& flip,
+                       int cropX, int cropY, int cropWidth, int cropHeight, bool cropFlip);
+
+// Decodes the region (x, y, width, height) of a JPEG image, scaled down by 1 / denominator in the DCT domain.
+// The region is given in full-resolution coordinates. Only the rows of the region are decoded, and only
+// the blocks covering its columns are transformed. The pixels are written to the buffer, which is
+// only reallocated if it is too small, so it can be reused across images.
+DecodedImageRegion DecodeJpegRegion(const unsigned char* data, size_t size, bool grayscale, int denominator,
+                                    int x, int y, int width, int height, std::vector<unsigned char>& buffer);
+
+}
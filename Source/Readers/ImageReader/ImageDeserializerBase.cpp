@@ -12,6 +12,7 @@
 #include "ImageTransformers.h"
 #include "SequenceData.h"
 #include "ImageUtil.h"
+#include "ImageDecoder.h"
 
 namespace CNTK {
 
@@ -20,7 +21,7 @@ using namespace Microsoft::MSR::CNTK;
     ImageDeserializerBase::ImageDeserializerBase() 
         : DataDeserializerBase(true),
           m_precision(DataType::Float),
-          m_grayscale(false), m_verbosity(0), m_multiViewCrop(false)
+          m_grayscale(false), m_verbosity(0), m_multiViewCrop(false), m_scaledDecoding(false)
     {}
 
     ImageDeserializerBase::ImageDeserializerBase(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
@@ -74,6 +75,13 @@ using namespace Microsoft::MSR::CNTK;
         // TODO: multiview should be done on the level of randomizer/transformers - it is responsiblity of the
         // TODO: randomizer to collect how many copies each transform needs and request same sequence several times.
         m_multiViewCrop = config(L"multiViewCrop", false);
+
+        m_scaledDecoding = config(L"scaledDecoding", false);
+        if (m_scaledDecoding && !IsScaledJpegDecodingSupported())
+        {
+            fprintf(stderr, "WARNING: scaledDecoding requires the image reader to be built with libjpeg-turbo, images will be decoded at full resolution.\n");
+            m_scaledDecoding = false;
+        }
     }
 
     void ImageDeserializerBase::PopulateSequenceData(
@@ -114,4 +122,37 @@ using namespace Microsoft::MSR::CNTK;
         label->m_numberOfSamples = 1;
         result.push_back(label);
     }
+
+    bool ImageDeserializerBase::PopulateSequenceData(
+        EncodedImagePtr image,
+        size_t classId,
+        size_t copyId,
+        const SequenceKey& sequenceKey,
+        std::vector<SequenceDataPtr>& result)
+    {
+        int width, height, components;
+        if (!ReadJpegHeader(image->m_data.data(), image->m_data.size(), width, height, components) ||
+            (components != 1 && components != 3))
+            return false;
+
+        auto imageData = make_shared<ImageSequenceData>();
+        ImageDimensions dimensions(width, height, image->m_grayscale ? 1 : 3);
+        auto dims = dimensions.AsTensorShape(HWC).GetDims();
+
+        imageData->m_sampleShape = NDShape(std::vector<size_t>(dims.begin(), dims.end()));
+        imageData->m_encoded = image;
+        imageData->m_region = cv::Rect(0, 0, width, height);
+        imageData->m_copyIndex = static_cast<uint8_t>(copyId);
+        imageData->m_numberOfSamples = 1;
+        imageData->m_elementType = DataType::UChar;
+        imageData->m_isValid = true;
+        imageData->m_key = sequenceKey;
+        result.push_back(imageData);
+
+        auto label = std::make_shared<CategorySequenceData>(m_streams.back().m_sampleLayout);
+        m_labelGenerator->CreateLabelFor(classId, *label);
+        label->m_numberOfSamples = 1;
+        result.push_back(label);
+        return true;
+    }
 }
@@ -12,6 +12,9 @@
 
 namespace CNTK {
 
+    struct EncodedImage;
+    typedef std::shared_ptr<EncodedImage> EncodedImagePtr;
+
     // Base class of image deserializers.
     class ImageDeserializerBase : public DataDeserializerBase
     {
@@ -31,6 +34,11 @@ namespace CNTK {
     protected:
         void PopulateSequenceData(cv::Mat image, size_t classId, size_t sequenceId, const SequenceKey& sequenceKey, std::vector<SequenceDataPtr>& result);
 
+        // Same for a JPEG image whose decoding is deferred to the transformers. Returns false, without adding
+        // anything to the result, if it is not a JPEG image that can be decoded in this way; the caller then
+        // decodes it with OpenCV.
+        bool PopulateSequenceData(EncodedImagePtr image, size_t classId, size_t sequenceId, const SequenceKey& sequenceKey, std::vector<SequenceDataPtr>& result);
+
         // A helper class for generation of type specific labels (currently float/double only).
         LabelGeneratorPtr m_labelGenerator;
 
@@ -49,6 +57,10 @@ namespace CNTK {
         // Flag indicating whether to generate images for multi crop.
         bool m_multiViewCrop;
 
+        // Flag indicating whether decoding of JPEG images is deferred to the transformers,
+        // so that the crop and scale transformers can decode only the needed region at a reduced scale.
+        bool m_scaledDecoding;
+
         // Corpus descriptor.
         CorpusDescriptorPtr m_corpus;
     };
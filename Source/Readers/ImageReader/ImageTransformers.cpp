@@ -16,11 +16,36 @@
 #include "SequenceData.h"
 #include "ImageUtil.h"
 #include "ImageDeserializerBase.h"
+#include "ImageDecoder.h"
 
 namespace CNTK {
 
 using namespace Microsoft::MSR::CNTK;
 
+cv::Mat ImageSequenceData::DecodeRegion(std::vector<unsigned char>& buffer, int minWidth, int minHeight) const
+{
+    assert(m_encoded);
+    int denominator = SelectJpegScaleDenominator(m_region.width, m_region.height, minWidth, minHeight);
+    auto region = DecodeJpegRegion(m_encoded->m_data.data(), m_encoded->m_data.size(), m_encoded->m_grayscale, denominator,
+                                   m_region.x, m_region.y, m_region.width, m_region.height, buffer);
+    return cv::Mat(region.m_height, region.m_width, region.m_channels == 1 ? CV_8UC1 : CV_8UC3, region.m_data, region.m_stride);
+}
+
+void ImageSequenceData::Decode()
+{
+    if (!m_encoded)
+        return;
+
+    std::vector<unsigned char> buffer;
+    cv::Mat image = DecodeRegion(buffer, m_region.width, m_region.height).clone();
+    if (m_flip)
+        cv::flip(image, image, 1);
+
+    m_image = image;
+    m_encoded.reset();
+    m_flip = false;
+}
+
 // Transforms a single sequence as open cv dense image. Called once per sequence.
 SequenceDataPtr ImageTransformerBase::Transform(SequenceDataPtr sequence, int indexInBatch)
 {
@@ -29,14 +54,31 @@ SequenceDataPtr ImageTransformerBase::Transform(SequenceDataPtr sequence, int in
         RuntimeError("Unexpected sequence provided");
 
     auto result = std::make_shared<ImageSequenceData>();
-    Apply(inputSequence->m_copyIndex, inputSequence->m_image, indexInBatch);
+    if (!inputSequence->m_encoded || !ApplyEncoded(inputSequence->m_copyIndex, *inputSequence, indexInBatch))
+    {
+        inputSequence->Decode();
+        Apply(inputSequence->m_copyIndex, inputSequence->m_image, indexInBatch);
+    }
 
     result->m_image = inputSequence->m_image;
+    result->m_encoded = inputSequence->m_encoded;
+    result->m_region = inputSequence->m_region;
+    result->m_flip = inputSequence->m_flip;
     result->m_numberOfSamples = inputSequence->m_numberOfSamples;
-    result->m_elementType = GetDataTypeFromOpenCVType(inputSequence->m_image.depth());
     result->m_copyIndex = inputSequence->m_copyIndex;
     result->m_key = inputSequence->m_key;
 
+    // An encoded image is decoded to 8 bit BGR or grayscale.
+    if (result->m_encoded)
+    {
+        result->m_elementType = DataType::UChar;
+        ImageDimensions outputDimensions(result->m_region.width, result->m_region.height, result->m_encoded->m_grayscale ? 1 : 3);
+        auto dims = outputDimensions.AsTensorShape(HWC).GetDims();
+        result->m_sampleShape = NDShape(std::vector<size_t>(dims.begin(), dims.end()));
+        return result;
+    }
+
+    result->m_elementType = GetDataTypeFromOpenCVType(inputSequence->m_image.depth());
     ImageDimensions outputDimensions(inputSequence->m_image.cols, inputSequence->m_image.rows, inputSequence->m_image.channels());
     auto dims = outputDimensions.AsTensorShape(HWC).GetDims();
     result->m_sampleShape = NDShape(std::vector<size_t>(dims.begin(), dims.end()));
@@ -125,25 +167,23 @@ StreamInformation CropTransformer::Transform(const StreamInformation& inputStrea
     return m_outputStream;
 }
 
-void CropTransformer::Apply(uint8_t copyId, cv::Mat &mat, int indexInBatch)
+void CropTransformer::GetCrop(uint8_t copyId, int rows, int cols, std::mt19937 &rng, cv::Rect& rect, bool& flip)
 {
-    auto seed = GetSeed();
-    auto rng = m_rngs.at_or_create(indexInBatch, [seed](int offset) { return std::make_unique<std::mt19937>(seed + offset); });
     int viewIndex = m_cropType == CropType::MultiView10 ? (int)(copyId % ImageDeserializerBase::NumMultiViewCopies) : 0;
 
     switch (m_cropType)
     {
     case CropType::Center: 
-        mat = mat(GetCropRectCenter(mat.rows, mat.cols, *rng));
+        rect = GetCropRectCenter(rows, cols, rng);
         break; 
     case CropType::RandomSide: 
-        mat = mat(GetCropRectRandomSide(mat.rows, mat.cols, *rng)); 
+        rect = GetCropRectRandomSide(rows, cols, rng);
         break; 
     case CropType::RandomArea: 
-        mat = mat(GetCropRectRandomArea(mat.rows, mat.cols, *rng));
+        rect = GetCropRectRandomArea(rows, cols, rng);
         break;
     case CropType::MultiView10: 
-        mat = mat(GetCropRectMultiView10(viewIndex, mat.rows, mat.cols, *rng));
+        rect = GetCropRectMultiView10(viewIndex, rows, cols, rng);
         break; 
     default: 
         RuntimeError("Invalid crop type."); 
@@ -151,8 +191,20 @@ void CropTransformer::Apply(uint8_t copyId, cv::Mat &mat, int indexInBatch)
     }
 
     // for MultiView10 m_hFlip is false, hence the first 5 will be unflipped, the later 5 will be flipped
-    if ((m_hFlip && boost::random::bernoulli_distribution<>()(*rng)) ||
-        viewIndex >= 5)
+    flip = (m_hFlip && boost::random::bernoulli_distribution<>()(rng)) || viewIndex >= 5;
+}
+
+void CropTransformer::Apply(uint8_t copyId, cv::Mat &mat, int indexInBatch)
+{
+    auto seed = GetSeed();
+    auto rng = m_rngs.at_or_create(indexInBatch, [seed](int offset) { return std::make_unique<std::mt19937>(seed + offset); });
+
+    cv::Rect rect;
+    bool flip;
+    GetCrop(copyId, mat.rows, mat.cols, *rng, rect, flip);
+
+    mat = mat(rect);
+    if (flip)
     {
         cv::flip(mat, mat, 1);
     }
@@ -160,6 +212,24 @@ void CropTransformer::Apply(uint8_t copyId, cv::Mat &mat, int indexInBatch)
     m_rngs.assignTo(indexInBatch, std::move(rng));
 }
 
+// Narrows the region to decode, drawing the same random numbers as Apply().
+bool CropTransformer::ApplyEncoded(uint8_t copyId, ImageSequenceData& image, int indexInBatch)
+{
+    auto seed = GetSeed();
+    auto rng = m_rngs.at_or_create(indexInBatch, [seed](int offset) { return std::make_unique<std::mt19937>(seed + offset); });
+
+    cv::Rect rect;
+    bool flip;
+    GetCrop(copyId, image.m_region.height, image.m_region.width, *rng, rect, flip);
+
+    // The crop is chosen on the region as it will look after a pending flip.
+    auto& region = image.m_region;
+    NarrowImageRegion(region.x, region.y, region.width, region.height, image.m_flip, rect.x, rect.y, rect.width, rect.height, flip);
+
+    m_rngs.assignTo(indexInBatch, std::move(rng));
+    return true;
+}
+
 CropTransformer::RatioJitterType
 CropTransformer::ParseJitterType(const std::string &src)
 {
@@ -368,58 +438,78 @@ StreamInformation ScaleTransformer::Transform(const StreamInformation& inputStre
     return m_outputStream;
 }
 
-void ScaleTransformer::Apply(uint8_t, cv::Mat &mat, int /* indexInBatch */)
+cv::Size ScaleTransformer::GetResizedSize(int width, int height) const
 {
     if (m_scaleMode == ScaleMode::Fill)
-    { // warp the image to the given target size
-        cv::resize(mat, mat, cv::Size((int)m_imgWidth, (int)m_imgHeight), 0, 0, m_interp);
+        return cv::Size((int)m_imgWidth, (int)m_imgHeight);
+
+    // which dimension is our scaled one?
+    bool scaleW;
+    if (m_scaleMode == ScaleMode::Crop)
+        scaleW = width < height; // in "crop" mode we resize the smaller side
+    else
+        scaleW = width > height; // else we resize the larger side
+
+    size_t targetW, targetH;
+    if (scaleW)
+    {
+        targetW = (size_t)m_imgWidth;
+        targetH = (size_t)round(height * m_imgWidth / (double)width);
     }
     else
     {
-        int height = mat.rows;
-        int width = mat.cols;
-
-        // which dimension is our scaled one?
-        bool scaleW;
-        if (m_scaleMode == ScaleMode::Crop)
-            scaleW = width < height; // in "crop" mode we resize the smaller side
-        else
-            scaleW = width > height; // else we resize the larger side
+        targetH = (size_t)m_imgHeight;
+        targetW = (size_t)round(width * m_imgHeight / (double)height);
+    }
+    return cv::Size((int)targetW, (int)targetH);
+}
 
-        size_t targetW, targetH;
-        if (scaleW)
-        {
-            targetW = (size_t)m_imgWidth;
-            targetH = (size_t)round(height * m_imgWidth / (double)width);
-        }
-        else
-        {
-            targetH = (size_t)m_imgHeight;
-            targetW = (size_t)round(width * m_imgHeight / (double)height);
-        }
+void ScaleTransformer::Scale(const cv::Mat& from, cv::Mat& to, bool flip)
+{
+    cv::resize(from, to, GetResizedSize(from.cols, from.rows), 0, 0, m_interp);
+    if (flip)
+        cv::flip(to, to, 1);
 
-        cv::resize(mat, mat, cv::Size((int)targetW, (int)targetH), 0, 0, m_interp);
+    if (m_scaleMode == ScaleMode::Crop)
+    { // crop the overlap
+        size_t xOff = max((size_t)0, (to.cols - m_imgWidth) / 2);
+        size_t yOff = max((size_t)0, (to.rows - m_imgHeight) / 2);
+        to = to(cv::Rect((int)xOff, (int)yOff, (int)m_imgWidth, (int)m_imgHeight));
+    }
+    else if (m_scaleMode == ScaleMode::Pad)
+    { // center it and pad the rest
+        size_t hdiff = max((size_t)0, (m_imgHeight - to.rows) / 2);
+        size_t wdiff = max((size_t)0, (m_imgWidth - to.cols) / 2);
 
-        if (m_scaleMode == ScaleMode::Crop)
-        { // crop the overlap
-            size_t xOff = max((size_t)0, (targetW - m_imgWidth) / 2);
-            size_t yOff = max((size_t)0, (targetH - m_imgHeight) / 2);
-            mat = mat(cv::Rect((int)xOff, (int)yOff, (int)m_imgWidth, (int)m_imgHeight));
-        }
-        else
-        { // ScaleMode::PAD --> center it and pad the rest
-            size_t hdiff = max((size_t)0, (m_imgHeight - mat.rows) / 2);
-            size_t wdiff = max((size_t)0, (m_imgWidth - mat.cols) / 2);
-
-            size_t top = hdiff;
-            size_t bottom = m_imgHeight - top - mat.rows;
-            size_t left = wdiff;
-            size_t right = m_imgWidth - left - mat.cols;
-            cv::copyMakeBorder(mat, mat, (int)top, (int)bottom, (int)left, (int)right, m_borderType, cv::Scalar(m_padValue, m_padValue, m_padValue));
-        }
+        size_t top = hdiff;
+        size_t bottom = m_imgHeight - top - to.rows;
+        size_t left = wdiff;
+        size_t right = m_imgWidth - left - to.cols;
+        cv::copyMakeBorder(to, to, (int)top, (int)bottom, (int)left, (int)right, m_borderType, cv::Scalar(m_padValue, m_padValue, m_padValue));
     }
 }
 
+void ScaleTransformer::Apply(uint8_t, cv::Mat &mat, int /* indexInBatch */)
+{
+    Scale(mat, mat, false);
+}
+
+// Decodes the region at the smallest scale that is not below the resized size, and resizes it right away.
+bool ScaleTransformer::ApplyEncoded(uint8_t, ImageSequenceData& image, int /* indexInBatch */)
+{
+    cv::Size size = GetResizedSize(image.m_region.width, image.m_region.height);
+    auto buffer = m_decodeBuffers.pop_or_create([]() { return std::vector<unsigned char>(); });
+
+    cv::Mat scaled;
+    Scale(image.DecodeRegion(buffer, size.width, size.height), scaled, image.m_flip);
+    m_decodeBuffers.push(std::move(buffer));
+
+    image.m_image = scaled;
+    image.m_encoded.reset();
+    image.m_flip = false;
+    return true;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 MeanTransformer::MeanTransformer(const ConfigParameters& config) : ImageTransformerBase(config)
@@ -499,6 +589,8 @@ SequenceDataPtr TransposeTransformer::Transform(SequenceDataPtr sequence, int in
     if (inputSequence == nullptr)
         RuntimeError("Currently Transpose transform only works with images.");
 
+    inputSequence->Decode();
+
     DataType elementType = m_inputStream.m_elementType != DataType::Unknown ?
         m_inputStream.m_elementType :
         sequence->m_elementType;
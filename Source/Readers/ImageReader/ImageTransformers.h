@@ -20,6 +20,14 @@
 
 namespace CNTK {
 
+// A compressed JPEG image.
+struct EncodedImage
+{
+    std::vector<unsigned char> m_data;
+    bool m_grayscale;                // Whether the image is decoded to grayscale.
+};
+typedef std::shared_ptr<EncodedImage> EncodedImagePtr;
+
 // Sequence data that is used for images.
 struct ImageSequenceData : DenseSequenceData
 {
@@ -28,8 +36,23 @@ struct ImageSequenceData : DenseSequenceData
     uint8_t  m_copyIndex;            // Index of the copy. Used in i.e. Multicrop,
                                      // when deserializer provides several copies of the same sequence.
 
+    // With scaledDecoding, the deserializer defers decoding of JPEG images, and m_image stays empty until
+    // a transformer needs the pixels. The crop transformer only narrows m_region, so that the scale
+    // transformer can decode the region directly at a reduced resolution.
+    EncodedImagePtr m_encoded;
+    cv::Rect m_region;               // Region of the encoded image, in full-resolution coordinates.
+    bool m_flip = false;             // Whether the region is to be flipped horizontally after decoding.
+
+    // Decodes the region of the encoded image into the buffer, scaled down as far as it stays at least
+    // minWidth x minHeight pixels. Returns a view of the buffer, not flipped yet.
+    cv::Mat DecodeRegion(std::vector<unsigned char>& buffer, int minWidth, int minHeight) const;
+
+    // Decodes the region of the encoded image at full resolution into m_image, if it is still encoded.
+    void Decode();
+
     const void* GetDataBuffer() override
     {
+        Decode();
         if (!m_image.isContinuous())
         {
             // According to the contract, dense sequence data 
@@ -81,6 +104,13 @@ protected:
     // The only function that should be redefined by the inherited classes.
     virtual void Apply(uint8_t copyId, cv::Mat &from, int indexInBatch) = 0;
 
+    // Transformers that can work on an image whose decoding is deferred (see ImageSequenceData::m_encoded)
+    // redefine this function. Returns false if the image has to be decoded and passed to Apply() instead.
+    virtual bool ApplyEncoded(uint8_t /*copyId*/, ImageSequenceData& /*image*/, int /*indexInBatch*/)
+    {
+        return false;
+    }
+
     Microsoft::MSR::CNTK::conc_vector<std::unique_ptr<std::mt19937>> m_rngs;
 };
 
@@ -95,6 +125,10 @@ public:
 
 private:
     void Apply(uint8_t copyId, cv::Mat &mat, int indexInBatch) override;
+    bool ApplyEncoded(uint8_t copyId, ImageSequenceData& image, int indexInBatch) override;
+
+    // Chooses the crop of a rows x cols image and whether to flip it.
+    void GetCrop(uint8_t copyId, int rows, int cols, std::mt19937 &rng, cv::Rect& rect, bool& flip);
 
 private:
     enum class RatioJitterType
@@ -151,6 +185,15 @@ private:
     };
     void Apply(uint8_t copyId, cv::Mat &mat, int indexInBatch) override;
 
+    // Decodes the region of the image just large enough for the target size, then scales it.
+    bool ApplyEncoded(uint8_t copyId, ImageSequenceData& image, int indexInBatch) override;
+
+    // Size the image is resized to, before the "crop" or "pad" step.
+    cv::Size GetResizedSize(int width, int height) const;
+
+    // Scales from into to, flipping the resized image if requested.
+    void Scale(const cv::Mat& from, cv::Mat& to, bool flip);
+
     size_t m_imgWidth;
     size_t m_imgHeight;
     size_t m_imgChannels;
@@ -159,6 +202,9 @@ private:
     int m_interp;
     int m_borderType;
     int m_padValue;
+
+    // Buffers for the decoded regions of encoded images.
+    Microsoft::MSR::CNTK::conc_stack<std::vector<unsigned char>> m_decodeBuffers;
 };
 
 // Mean transformation.
@@ -92,6 +92,17 @@ void ZipByteReader::Register(const MultiMap& sequences)
 }
 
 cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscale)
+{
+    auto contents = m_workspace.pop_or_create([]() { return vector<unsigned char>(); });
+    ReadBytes(seqId, path, contents);
+
+    cv::Mat img = cv::imdecode(contents, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+    assert(nullptr != img.data);
+    m_workspace.push(std::move(contents));
+    return img;
+}
+
+void ZipByteReader::ReadBytes(size_t seqId, const std::string& path, std::vector<unsigned char>& contents)
 {
     // Find index of the file in .zip file.
     auto r = m_seqIdToIndex.find(seqId);
@@ -101,9 +112,7 @@ cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscal
     zip_uint64_t index = std::get<0>((*r).second);
     zip_uint64_t size = std::get<1>((*r).second);
 
-    auto contents = m_workspace.pop_or_create([size]() { return vector<unsigned char>(size); });
-    if (contents.size() < size)
-        contents.resize(size);
+    contents.resize(size);
     auto zipFile = m_zips.pop_or_create([this]() { return OpenZip(); });
     attempt(5, [&zipFile, &contents, &path, index, seqId, size]()
     {
@@ -134,11 +143,6 @@ cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscal
         }
     });
     m_zips.push(std::move(zipFile));
-
-    cv::Mat img = cv::imdecode(contents, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
-    assert(nullptr != img.data);
-    m_workspace.push(std::move(contents));
-    return img;
 }
 }
 
@@ -6,20 +6,531 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "ChunkCache.h"
+#include "SequenceData.h"
+#include "EnvironmentUtil.h"
+#ifdef _WIN32
+#include <io.h>
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace CNTK {
 
+using namespace std;
+
+// Layout of the cache file (all records are 8-byte aligned, so that the data in a mapping is properly aligned):
+//   file header | per stream: StreamRecord | chunk record | chunk record | ...
+// Chunk records are appended in the order the chunks are first seen. Each one is a ChunkRecordHeader
+// followed by the payload: the number of sequences, and for every sequence a SequenceRecord followed,
+// for every stream, by a SequenceStreamRecord and its data:
+//   dense: numberOfSamples * sampleSize elements
+//   sparse: nnz counts (one per sample), indices, values (totalNnzCount elements)
+// A record is committed by writing the magic of its header after the payload has been written. The file is truncated
+// after the last committed record when it is opened, so that a record that was not completely written (e.g. the process
+// was killed) is dropped, and no leftover bytes of it can follow the next record.
+
+static const uint64_t s_chunkCacheMagic = 0x45484341434b4843; // 'CHKCACHE'
+static const uint32_t s_chunkCacheVersion = 2;
+static const uint32_t s_chunkRecordMagic = 0x4b4e4843;        // 'CHNK'
+
+struct ChunkCacheFileHeader
+{
+    uint64_t m_magic;
+    uint32_t m_version;
+    uint32_t m_numberOfStreams;
+    uint64_t m_numberOfChunks;
+    uint64_t m_numberOfSequences;
+};
+
+struct StreamRecord
+{
+    uint32_t m_storageFormat;
+    uint32_t m_elementType;
+    uint64_t m_sampleSize;
+};
+
+struct ChunkRecordHeader
+{
+    uint32_t m_magic; // s_chunkRecordMagic once the record is complete, 0 before
+    uint32_t m_chunkId;
+    uint64_t m_payloadSize;
+};
+
+struct SequenceRecord
+{
+    uint64_t m_indexInChunk;
+    uint64_t m_keySequence;
+    uint32_t m_keySample;
+    uint32_t m_unused;
+};
+
+struct SequenceStreamRecord
+{
+    uint32_t m_isValid;
+    uint32_t m_numberOfSamples;
+    uint32_t m_totalNnzCount;
+    uint32_t m_unused;
+};
+
+static inline size_t AlignTo8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+static void Append(vector<char>& buffer, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+    buffer.resize(AlignTo8(buffer.size()), 0);
+}
+
+template <class T>
+static void Append(vector<char>& buffer, const T& value)
+{
+    Append(buffer, &value, sizeof(T));
+}
+
+static bool TruncateFile(FILE* file, uint64_t size)
+{
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), (__int64)size) == 0;
+#else
+    return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+// A read-only (copy-on-write) mapping of a region of the cache file.
+class MappedRegion
+{
+public:
+    MappedRegion(FILE* file, uint64_t offset, size_t size)
+        : m_base(nullptr), m_mappedSize(0), m_data(nullptr)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        uint64_t alignedOffset = offset - offset % info.dwAllocationGranularity;
+        m_mappedSize = (size_t)(offset - alignedOffset) + size;
+
+        HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+        HANDLE mapping = CreateFileMappingW(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mapping == NULL)
+            RuntimeError("ChunkCache: failed to create a mapping of the cache file (error %d).", (int)GetLastError());
+        m_base = MapViewOfFile(mapping, FILE_MAP_COPY, (DWORD)(alignedOffset >> 32), (DWORD)(alignedOffset & 0xFFFFFFFF), m_mappedSize);
+        CloseHandle(mapping); // the view keeps the mapping alive
+        if (m_base == NULL)
+            RuntimeError("ChunkCache: failed to map %zu bytes of the cache file (error %d).", m_mappedSize, (int)GetLastError());
+#else
+        uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+        uint64_t alignedOffset = offset - offset % pageSize;
+        m_mappedSize = (size_t)(offset - alignedOffset) + size;
+
+        m_base = mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), (off_t)alignedOffset);
+        if (m_base == MAP_FAILED)
+            RuntimeError("ChunkCache: failed to map %zu bytes of the cache file: %s.", m_mappedSize, strerror(errno));
+#endif
+        m_data = static_cast<char*>(m_base) + (offset - alignedOffset);
+    }
+
+    ~MappedRegion()
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_base);
+#else
+        munmap(m_base, m_mappedSize);
+#endif
+    }
+
+    char* Data() const { return m_data; }
+
+private:
+    void* m_base;
+    size_t m_mappedSize;
+    char* m_data;
+
+    DISABLE_COPY_AND_MOVE(MappedRegion);
+};
+
+// Dense sequence pointing into a mapped chunk record.
+struct MappedDenseSequenceData : DenseSequenceData
+{
+    MappedDenseSequenceData(const NDShape& sampleShape, const void* data, unsigned int numberOfSamples)
+        : DenseSequenceData(numberOfSamples), m_sampleShape(sampleShape), m_data(data)
+    {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const void* m_data;
+};
+
+// Sparse sequence pointing into a mapped chunk record.
+struct MappedSparseSequenceData : SparseSequenceData
+{
+    MappedSparseSequenceData(const NDShape& sampleShape, const void* data, unsigned int numberOfSamples)
+        : SparseSequenceData(numberOfSamples), m_sampleShape(sampleShape), m_data(data)
+    {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const void* m_data;
+};
+
+// Chunk served from a mapping of its record in the cache file. Sequences returned by this chunk
+// keep the mapping alive through their holding buffer.
+class MappedChunk : public Chunk
+{
+public:
+    MappedChunk(const shared_ptr<MappedRegion>& region, const vector<StreamInformation>& streams)
+        : m_region(region), m_streams(streams)
+    {
+        const char* position = region->Data();
+        uint64_t numberOfSequences = *reinterpret_cast<const uint64_t*>(position);
+        position += sizeof(uint64_t);
+
+        for (uint64_t i = 0; i < numberOfSequences; ++i)
+        {
+            auto sequence = reinterpret_cast<const SequenceRecord*>(position);
+            if (m_sequences.size() <= sequence->m_indexInChunk)
+                m_sequences.resize(sequence->m_indexInChunk + 1, nullptr);
+            m_sequences[sequence->m_indexInChunk] = position;
+
+            position += sizeof(SequenceRecord);
+            for (const auto& stream : m_streams)
+                position += StreamDataSize(stream, *reinterpret_cast<const SequenceStreamRecord*>(position));
+        }
+    }
+
+    // Size of a stream record including its header and the following data.
+    static size_t StreamDataSize(const StreamInformation& stream, const SequenceStreamRecord& record)
+    {
+        size_t size = sizeof(SequenceStreamRecord);
+        size_t elementSize = DataTypeSize(stream.m_elementType);
+        if (stream.m_storageFormat == StorageFormat::Dense)
+            size += AlignTo8(record.m_numberOfSamples * stream.m_sampleLayout.TotalSize() * elementSize);
+        else
+        {
+            size += AlignTo8(record.m_numberOfSamples * sizeof(SparseIndexType));
+            size += AlignTo8(record.m_totalNnzCount * sizeof(SparseIndexType));
+            size += AlignTo8(record.m_totalNnzCount * elementSize);
+        }
+        return size;
+    }
+
+    void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+    {
+        if (sequenceIndex >= m_sequences.size() || m_sequences[sequenceIndex] == nullptr)
+            RuntimeError("ChunkCache: sequence %zu not found in the cached chunk.", sequenceIndex);
+
+        const char* position = m_sequences[sequenceIndex];
+        auto sequence = reinterpret_cast<const SequenceRecord*>(position);
+        position += sizeof(SequenceRecord);
+
+        for (const auto& stream : m_streams)
+        {
+            auto record = reinterpret_cast<const SequenceStreamRecord*>(position);
+            const char* data = position + sizeof(SequenceStreamRecord);
+            position += StreamDataSize(stream, *record);
+
+            if (!record->m_isValid)
+            {
+                result.push_back(InvalidSequenceData::Instance());
+                continue;
+            }
+
+            SequenceDataPtr sequenceData;
+            if (stream.m_storageFormat == StorageFormat::Dense)
+            {
+                sequenceData = make_shared<MappedDenseSequenceData>(stream.m_sampleLayout, data, record->m_numberOfSamples);
+            }
+            else
+            {
+                auto nnzCounts = reinterpret_cast<const SparseIndexType*>(data);
+                data += AlignTo8(record->m_numberOfSamples * sizeof(SparseIndexType));
+                auto indices = reinterpret_cast<const SparseIndexType*>(data);
+                data += AlignTo8(record->m_totalNnzCount * sizeof(SparseIndexType));
+
+                auto sparse = make_shared<MappedSparseSequenceData>(stream.m_sampleLayout, data, record->m_numberOfSamples);
+                sparse->m_nnzCounts.assign(nnzCounts, nnzCounts + record->m_numberOfSamples);
+                sparse->m_totalNnzCount = record->m_totalNnzCount;
+                sparse->m_indices = const_cast<SparseIndexType*>(indices); // the mapping is copy-on-write
+                sequenceData = sparse;
+            }
+
+            sequenceData->m_elementType = stream.m_elementType;
+            sequenceData->m_key = SequenceKey(sequence->m_keySequence, sequence->m_keySample);
+            sequenceData->m_holdingBuffer = shared_ptr<uint8_t>(m_region, reinterpret_cast<uint8_t*>(m_region->Data()));
+            result.push_back(sequenceData);
+        }
+    }
+
+private:
+    shared_ptr<MappedRegion> m_region;
+    const vector<StreamInformation>& m_streams; // owned by the cache
+    vector<const char*> m_sequences;            // sequence records, indexed by the index in chunk
+};
+
+ChunkCache::ChunkCache(DataDeserializerPtr deserializer, const wstring& cacheFile, size_t maxResidentBytes, const wstring& sourceFile)
+    : m_deserializer(deserializer),
+    m_cacheFilename(cacheFile),
+    m_streams(deserializer->StreamInfos()),
+    m_endOfValidData(0),
+    m_residentBytes(0),
+    m_maxResidentBytes(maxResidentBytes)
+{
+    for (const auto& stream : m_streams)
+    {
+        if (stream.m_isBinary)
+            RuntimeError("ChunkCache: stream '%ls' is binary, it cannot be cached on disk.", stream.m_name.c_str());
+    }
+
+    // The chunks seen by each worker are different, so each worker keeps its own cache file.
+    if (Microsoft::MSR::CNTK::EnvironmentUtil::GetTotalNumberOfMPINodes() > 1)
+        m_cacheFilename += L".rank" + to_wstring(Microsoft::MSR::CNTK::EnvironmentUtil::GetLocalMPINodeRank());
+
+    if (!TryOpenCacheFile(sourceFile))
+        CreateCacheFile();
+}
+
+// Opens an existing cache file if it is up to date and matches the deserializer, and collects its chunk records.
+bool ChunkCache::TryOpenCacheFile(const wstring& sourceFile)
+{
+    if (!sourceFile.empty() && !msra::files::fuptodate(m_cacheFilename, sourceFile, /*inputrequired=*/false))
+        return false;
+
+    auto file = make_shared<FileWrapper>(m_cacheFilename, L"r+b");
+    if (!file->IsOpen())
+        return false;
+
+    auto chunks = m_deserializer->ChunkInfos();
+    uint64_t numberOfSequences = 0;
+    for (const auto& chunk : chunks)
+        numberOfSequences += chunk.m_numberOfSequences;
+
+    ChunkCacheFileHeader header;
+    if (!file->TryRead(header) ||
+        header.m_magic != s_chunkCacheMagic ||
+        header.m_version != s_chunkCacheVersion ||
+        header.m_numberOfStreams != m_streams.size() ||
+        header.m_numberOfChunks != chunks.size() ||
+        header.m_numberOfSequences != numberOfSequences)
+        return false;
+
+    for (const auto& stream : m_streams)
+    {
+        StreamRecord record;
+        if (!file->TryRead(record) ||
+            record.m_storageFormat != (uint32_t)stream.m_storageFormat ||
+            record.m_elementType != (uint32_t)stream.m_elementType ||
+            record.m_sampleSize != stream.m_sampleLayout.TotalSize())
+            return false;
+    }
+
+    uint64_t fileSize = file->Filesize();
+    uint64_t position = file->TellOrDie();
+    ChunkRecordHeader record;
+    while (position + sizeof(ChunkRecordHeader) <= fileSize && file->TryRead(record))
+    {
+        if (record.m_magic != s_chunkRecordMagic || record.m_chunkId >= chunks.size())
+            break; // not committed, or not a record
+
+        uint64_t payloadOffset = position + sizeof(ChunkRecordHeader);
+        if (payloadOffset + record.m_payloadSize > fileSize)
+            break; // incomplete record
+
+        m_cachedChunks[record.m_chunkId] = CachedChunkLocation{ payloadOffset, record.m_payloadSize };
+        position = payloadOffset + record.m_payloadSize;
+        if (!file->TrySeek(position, SEEK_SET))
+            break;
+    }
+
+    // new records are appended here; drop whatever follows, so that it is not mistaken for (a part of) a record later
+    if (position < fileSize && !TruncateFile(file->File(), position))
+        return false;
+
+    m_endOfValidData = position;
+    m_cacheFile = file;
+    return true;
+}
+
+void ChunkCache::CreateCacheFile()
+{
+    m_cachedChunks.clear();
+    m_cacheFile = make_shared<FileWrapper>(FileWrapper::OpenOrDie(m_cacheFilename, L"w+b"));
+
+    auto chunks = m_deserializer->ChunkInfos();
+    ChunkCacheFileHeader header = {};
+    header.m_magic = s_chunkCacheMagic;
+    header.m_version = s_chunkCacheVersion;
+    header.m_numberOfStreams = (uint32_t)m_streams.size();
+    header.m_numberOfChunks = chunks.size();
+    for (const auto& chunk : chunks)
+        header.m_numberOfSequences += chunk.m_numberOfSequences;
+
+    vector<char> buffer;
+    Append(buffer, header);
+    for (const auto& stream : m_streams)
+    {
+        StreamRecord record = {};
+        record.m_storageFormat = (uint32_t)stream.m_storageFormat;
+        record.m_elementType = (uint32_t)stream.m_elementType;
+        record.m_sampleSize = stream.m_sampleLayout.TotalSize();
+        Append(buffer, record);
+    }
+
+    m_cacheFile->WriteOrDie(buffer.data(), 1, buffer.size());
+    m_cacheFile->FlushOrDie();
+    m_endOfValidData = buffer.size();
+}
+
+// Serializes all sequences of the chunk and appends them as a new record to the cache file.
+void ChunkCache::WriteChunk(ChunkIdType chunkId, const ChunkPtr& chunk)
+{
+    vector<SequenceInfo> sequenceInfos;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequenceInfos);
+
+    vector<char> payload;
+    Append(payload, (uint64_t)sequenceInfos.size());
+
+    vector<SequenceDataPtr> data;
+    for (const auto& info : sequenceInfos)
+    {
+        data.clear();
+        chunk->GetSequence(info.m_indexInChunk, data);
+        if (data.size() != m_streams.size())
+            RuntimeError("ChunkCache: chunk %u returned %zu streams, expected %zu.", chunkId, data.size(), m_streams.size());
+
+        SequenceRecord sequence = {};
+        sequence.m_indexInChunk = info.m_indexInChunk;
+        sequence.m_keySequence = info.m_key.m_sequence;
+        sequence.m_keySample = info.m_key.m_sample;
+        Append(payload, sequence);
+
+        for (size_t i = 0; i < m_streams.size(); ++i)
+        {
+            const auto& stream = m_streams[i];
+            const auto& sequenceData = data[i];
+            size_t elementSize = DataTypeSize(stream.m_elementType);
+
+            SequenceStreamRecord record = {};
+            record.m_isValid = sequenceData->m_isValid ? 1 : 0;
+            if (!sequenceData->m_isValid)
+            {
+                Append(payload, record);
+                continue;
+            }
+
+            record.m_numberOfSamples = sequenceData->m_numberOfSamples;
+            if (stream.m_storageFormat == StorageFormat::Dense)
+            {
+                Append(payload, record);
+                Append(payload, sequenceData->GetDataBuffer(), record.m_numberOfSamples * stream.m_sampleLayout.TotalSize() * elementSize);
+            }
+            else
+            {
+                auto sparse = static_pointer_cast<SparseSequenceData>(sequenceData);
+                record.m_totalNnzCount = sparse->m_totalNnzCount;
+                Append(payload, record);
+                Append(payload, sparse->m_nnzCounts.data(), record.m_numberOfSamples * sizeof(SparseIndexType));
+                Append(payload, sparse->m_indices, record.m_totalNnzCount * sizeof(SparseIndexType));
+                Append(payload, sparse->GetDataBuffer(), record.m_totalNnzCount * elementSize);
+            }
+        }
+    }
+
+    ChunkRecordHeader header = {};
+    header.m_chunkId = chunkId;
+    header.m_payloadSize = payload.size();
+
+    // The record is committed by its magic, which is only written once the payload is in the file.
+    // A failure to write only costs us the caching of this chunk.
+    bool written = m_cacheFile->TrySeek(m_endOfValidData, SEEK_SET) &&
+                   m_cacheFile->TryWrite(header) &&
+                   m_cacheFile->TryWrite(payload.data(), 1, payload.size()) &&
+                   m_cacheFile->TryFlush();
+    header.m_magic = s_chunkRecordMagic;
+    written = written &&
+              m_cacheFile->TrySeek(m_endOfValidData, SEEK_SET) &&
+              m_cacheFile->TryWrite(header) &&
+              m_cacheFile->TryFlush();
+    if (!written)
+    {
+        fprintf(stderr, "WARNING: ChunkCache: failed to write chunk %u to '%ls'.\n", chunkId, m_cacheFilename.c_str());
+        return;
+    }
+
+    m_cachedChunks[chunkId] = CachedChunkLocation{ m_endOfValidData + sizeof(ChunkRecordHeader), payload.size() };
+    m_endOfValidData += sizeof(ChunkRecordHeader) + payload.size();
+}
+
+ChunkPtr ChunkCache::MapChunk(const CachedChunkLocation& location)
+{
+    auto region = make_shared<MappedRegion>(m_cacheFile->File(), location.m_offset, (size_t)location.m_size);
+    return make_shared<MappedChunk>(region, m_streams);
+}
+
+// Keeps a reference to the chunk, dropping the least recently used chunks to stay within the budget.
+void ChunkCache::MakeResident(ChunkIdType chunkId, const ChunkPtr& chunk, size_t sizeInBytes)
+{
+    m_lru.push_front(chunkId);
+    m_residentChunks[chunkId] = ResidentChunk{ chunk, sizeInBytes, m_lru.begin() };
+    m_residentBytes += sizeInBytes;
+
+    while (m_residentBytes > m_maxResidentBytes && !m_lru.empty())
+    {
+        auto victim = m_residentChunks.find(m_lru.back());
+        m_residentBytes -= victim->second.m_sizeInBytes;
+        m_residentChunks.erase(victim);
+        m_lru.pop_back();
+    }
+}
+
 ChunkPtr ChunkCache::GetChunk(ChunkIdType chunkId)
 {
-    auto it = m_chunkMap.find(chunkId);
-    if (it != m_chunkMap.end())
+    if (!m_cacheFile)
+    {
+        auto it = m_chunkMap.find(chunkId);
+        if (it != m_chunkMap.end())
+        {
+            return it->second;
+        }
+
+        ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
+        m_chunkMap[chunkId] = chunk;
+
+        return chunk;
+    }
+
+    lock_guard<mutex> guard(m_lock);
+
+    auto resident = m_residentChunks.find(chunkId);
+    if (resident != m_residentChunks.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, resident->second.m_lruPosition);
+        return resident->second.m_chunk;
+    }
+
+    ChunkPtr chunk;
+    auto cached = m_cachedChunks.find(chunkId);
+    if (cached != m_cachedChunks.end())
+    {
+        chunk = MapChunk(cached->second);
+    }
+    else
     {
-        return it->second;
+        chunk = m_deserializer->GetChunk(chunkId);
+        WriteChunk(chunkId, chunk);
+        cached = m_cachedChunks.find(chunkId);
+        if (cached == m_cachedChunks.end())
+            return chunk; // could not be written, not tracked either
     }
- 
-    ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
-    m_chunkMap[chunkId] = chunk;
- 
+
+    MakeResident(chunkId, chunk, (size_t)cached->second.m_size);
     return chunk;
 }
 
@@ -6,22 +6,35 @@
 #pragma once
 
 #include <map>
+#include <list>
+#include <mutex>
 #include "DataDeserializer.h"
+#include "FileWrapper.h"
 
 namespace CNTK {
 
 // A cache to store the complete dataset (all chunks) in memory. The caching can
-// be switched on/off by a boolean flag in the reader config section, independent 
-// of the randomization and chunking parameters. The caching should only be enabled 
+// be switched on/off by a boolean flag in the reader config section, independent
+// of the randomization and chunking parameters. The caching should only be enabled
 // when the whole dataset fits in memory.
 // Implemented as a wrapping proxy around a deserializer that stores pointers to
 // all chunks it sees in an internal map.
+//
+// When constructed with a cache file, the chunks are instead spilled to disk in their
+// deserialized form the first time they are seen. Later requests for the chunk (in later
+// epochs, or in later runs, as long as the cache file is newer than the source file)
+// are served from a memory mapping of the cache file; the returned sequences point
+// directly into the mapping. At most maxResidentBytes worth of chunks are additionally
+// kept referenced by the cache (least recently used ones are dropped first); the rest
+// is up to the OS page cache.
 class ChunkCache : public DataDeserializer
 {
 public:
 
     ChunkCache(DataDeserializerPtr deserializer) : m_deserializer(deserializer) { }
 
+    ChunkCache(DataDeserializerPtr deserializer, const std::wstring& cacheFile, size_t maxResidentBytes, const std::wstring& sourceFile = L"");
+
     virtual std::vector<StreamInformation> StreamInfos() override
     {
         return m_deserializer->StreamInfos();
@@ -46,10 +59,45 @@ public:
     virtual ChunkPtr GetChunk(ChunkIdType chunkId);
 
 private:
+    // Location of a chunk record in the cache file.
+    struct CachedChunkLocation
+    {
+        uint64_t m_offset; // offset of the record payload
+        uint64_t m_size;   // size of the record payload in bytes
+    };
+
+    // Resident chunk, as tracked by the LRU list.
+    struct ResidentChunk
+    {
+        ChunkPtr m_chunk;
+        size_t m_sizeInBytes;
+        std::list<ChunkIdType>::iterator m_lruPosition;
+    };
+
+    bool TryOpenCacheFile(const std::wstring& sourceFile);
+    void CreateCacheFile();
+    void WriteChunk(ChunkIdType chunkId, const ChunkPtr& chunk);
+    ChunkPtr MapChunk(const CachedChunkLocation& location);
+    void MakeResident(ChunkIdType chunkId, const ChunkPtr& chunk, size_t sizeInBytes);
+
     // A map of currently loaded chunks
     std::map<size_t, ChunkPtr> m_chunkMap;
     DataDeserializerPtr m_deserializer;
 
+    // Members below are only used when spilling to disk.
+    std::wstring m_cacheFilename;
+    std::shared_ptr<FileWrapper> m_cacheFile;
+    std::vector<StreamInformation> m_streams;
+    std::map<ChunkIdType, CachedChunkLocation> m_cachedChunks;
+    uint64_t m_endOfValidData;
+
+    std::map<ChunkIdType, ResidentChunk> m_residentChunks;
+    std::list<ChunkIdType> m_lru; // most recently used chunk in front
+    size_t m_residentBytes;
+    size_t m_maxResidentBytes;
+
+    std::mutex m_lock;
+
     DISABLE_COPY_AND_MOVE(ChunkCache);
 };
 
@@ -0,0 +1,1072 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#define __STDC_FORMAT_MACROS
+
+#include <inttypes.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <omp.h>
+#include <thread>
+#include "MultiProcessSequenceEnumerator.h"
+#include "SequenceData.h"
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace CNTK {
+
+using namespace std;
+
+// Every worker has a shared mapping with two single producer, single consumer rings: commands go from the
+// training process to the worker, answers go back. A ring is a sequence of records, each an 8-byte size
+// followed by the payload (8-byte aligned). A record that does not fit before the end of the ring is preceded
+// by a skip record that fills the rest of it. Positions only grow; the offset in the ring is position % capacity.
+//
+// Command payload: type, followed by
+//   StartEpoch: the epoch configuration
+//   SetConfiguration: the reader configuration
+//   SetState: the state
+//   GetNext: global and local sample counts
+// Answer payload: type, followed by
+//   Ack: the state of the worker enumerator
+//   Error: the message
+//   Sequences: end of sweep/epoch flags, the state, the number of streams and sequences, and for every stream and
+//   every sequence a SequenceHeader, the dimensions of the sample shape, and the data:
+//     dense: numberOfSamples * sampleSize elements
+//     sparse: nnz counts (one per sample), indices, values (totalNnzCount elements)
+
+enum class CommandType : uint32_t
+{
+    StartEpoch,
+    SetConfiguration,
+    SetState,
+    GetNext,
+};
+
+enum class AnswerType : uint32_t
+{
+    Ack,
+    Error,
+    Sequences,
+};
+
+struct SequenceHeader
+{
+    uint32_t m_isValid;
+    uint32_t m_numberOfSamples;
+    uint32_t m_totalNnzCount;
+    uint32_t m_rank;
+    uint64_t m_keySequence;
+    uint32_t m_keySample;
+    uint32_t m_unused;
+};
+
+static const uint64_t s_skipRecord = 1ull << 63;
+static const size_t s_commandRingSize = 1024 * 1024;
+static const size_t s_minAnswerRingSize = 64 * 1024;
+
+static inline size_t AlignTo8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+// Spins for a while, then backs off to sleeping. Calls check() once in a while, to find out whether the other side is gone.
+template <class Condition>
+static void WaitFor(Condition condition, const function<void()>& check)
+{
+    for (size_t attempt = 0; !condition(); ++attempt)
+    {
+        if (attempt < 100)
+        {
+            this_thread::yield();
+            continue;
+        }
+
+        this_thread::sleep_for(chrono::microseconds(attempt < 1000 ? 20 : 200));
+        if (attempt % 64 == 0)
+            check();
+    }
+}
+
+// Writes 8-byte aligned values. With a null buffer it only measures, so that a record can be
+// sized first and then written in place into the ring.
+class RecordWriter
+{
+public:
+    RecordWriter(char* buffer = nullptr) : m_buffer(buffer), m_size(0) {}
+
+    void Write(const void* data, size_t size)
+    {
+        if (m_buffer)
+        {
+            memcpy(m_buffer + m_size, data, size);
+            memset(m_buffer + m_size + size, 0, AlignTo8(size) - size);
+        }
+        m_size += AlignTo8(size);
+    }
+
+    template <class T>
+    void Write(const T& value)
+    {
+        Write(&value, sizeof(T));
+    }
+
+    void Write(const wstring& value)
+    {
+        Write<uint64_t>(value.size());
+        Write(value.data(), value.size() * sizeof(wchar_t));
+    }
+
+    void Write(const string& value)
+    {
+        Write<uint64_t>(value.size());
+        Write(value.data(), value.size());
+    }
+
+    void Write(const map<wstring, size_t>& state)
+    {
+        Write<uint64_t>(state.size());
+        for (const auto& p : state)
+        {
+            Write(p.first);
+            Write<uint64_t>(p.second);
+        }
+    }
+
+    void Write(const ReaderConfiguration& config)
+    {
+        Write<uint64_t>(config.m_numberOfWorkers);
+        Write<uint64_t>(config.m_workerRank);
+        Write<uint64_t>(config.m_minibatchSizeInSamples);
+        Write<uint64_t>(config.m_truncationSize);
+        Write<uint64_t>(config.m_rightSplice);
+        Write<uint64_t>(config.m_maxErrors);
+        Write<uint32_t>(config.m_allowMinibatchesToCrossSweepBoundaries ? 1 : 0);
+    }
+
+    void Write(const EpochConfiguration& config)
+    {
+        Write(static_cast<const ReaderConfiguration&>(config));
+        Write<uint64_t>(config.m_totalEpochSizeInSamples);
+        Write<uint64_t>(config.m_totalEpochSizeInSweeps);
+        Write<uint64_t>(config.m_epochIndex);
+    }
+
+    size_t Size() const { return m_size; }
+
+private:
+    char* m_buffer;
+    size_t m_size;
+};
+
+class RecordReader
+{
+public:
+    RecordReader(const char* data) : m_position(data) {}
+
+    const char* Skip(size_t size)
+    {
+        const char* result = m_position;
+        m_position += AlignTo8(size);
+        return result;
+    }
+
+    template <class T>
+    T Read()
+    {
+        T value;
+        memcpy(&value, Skip(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    wstring ReadWString()
+    {
+        size_t length = (size_t)Read<uint64_t>();
+        auto data = reinterpret_cast<const wchar_t*>(Skip(length * sizeof(wchar_t)));
+        return wstring(data, data + length);
+    }
+
+    string ReadString()
+    {
+        size_t length = (size_t)Read<uint64_t>();
+        const char* data = Skip(length);
+        return string(data, data + length);
+    }
+
+    map<wstring, size_t> ReadState()
+    {
+        map<wstring, size_t> state;
+        size_t size = (size_t)Read<uint64_t>();
+        for (size_t i = 0; i < size; ++i)
+        {
+            wstring key = ReadWString();
+            state[key] = (size_t)Read<uint64_t>();
+        }
+        return state;
+    }
+
+    void Read(ReaderConfiguration& config)
+    {
+        config.m_numberOfWorkers = (size_t)Read<uint64_t>();
+        config.m_workerRank = (size_t)Read<uint64_t>();
+        config.m_minibatchSizeInSamples = (size_t)Read<uint64_t>();
+        config.m_truncationSize = (size_t)Read<uint64_t>();
+        config.m_rightSplice = (size_t)Read<uint64_t>();
+        config.m_maxErrors = (size_t)Read<uint64_t>();
+        config.m_allowMinibatchesToCrossSweepBoundaries = Read<uint32_t>() != 0;
+    }
+
+    void Read(EpochConfiguration& config)
+    {
+        Read(static_cast<ReaderConfiguration&>(config));
+        config.m_totalEpochSizeInSamples = (size_t)Read<uint64_t>();
+        config.m_totalEpochSizeInSweeps = (size_t)Read<uint64_t>();
+        config.m_epochIndex = (size_t)Read<uint64_t>();
+    }
+
+private:
+    const char* m_position;
+};
+
+struct RingHeader
+{
+    atomic<uint64_t> m_head; // end of the written records, advanced by the producer
+    char m_padding0[64 - sizeof(atomic<uint64_t>)];
+    atomic<uint64_t> m_tail; // end of the released records, advanced by the consumer
+    char m_padding1[64 - sizeof(atomic<uint64_t>)];
+};
+
+// A single producer, single consumer ring of variable sized records in shared memory.
+// Records are read and released in order.
+class SharedRing
+{
+public:
+    SharedRing() : m_header(nullptr), m_data(nullptr), m_capacity(0), m_readPosition(0) {}
+
+    void Initialize(RingHeader* header, char* data, size_t capacity)
+    {
+        m_header = new (header) RingHeader();
+        m_header->m_head = 0;
+        m_header->m_tail = 0;
+        if (!m_header->m_head.is_lock_free())
+            LogicError("MultiProcessSequenceEnumerator: 64-bit atomics are not lock free on this platform.");
+
+        m_data = data;
+        m_capacity = capacity;
+        m_readPosition = 0;
+    }
+
+    size_t MaxRecordSize() const
+    {
+        return m_capacity - sizeof(uint64_t);
+    }
+
+    // Returns the space for a record of the given size, waiting until it is released by the consumer.
+    char* Reserve(size_t size, const function<void()>& check)
+    {
+        size_t recordSize = sizeof(uint64_t) + AlignTo8(size);
+        if (recordSize > m_capacity)
+            LogicError("SharedRing: a record of %" PRIu64 " bytes does not fit into the ring.", (uint64_t)size);
+
+        uint64_t head = m_header->m_head.load(memory_order_relaxed);
+        size_t offset = (size_t)(head % m_capacity);
+        if (offset + recordSize > m_capacity)
+        {
+            // Not enough space before the end of the ring, skipping to the beginning.
+            size_t rest = m_capacity - offset;
+            WaitFor([&]() { return m_capacity - (head - m_header->m_tail.load(memory_order_acquire)) >= rest; }, check);
+            *reinterpret_cast<uint64_t*>(m_data + offset) = s_skipRecord | (rest - sizeof(uint64_t));
+            head += rest;
+            m_header->m_head.store(head, memory_order_release);
+            offset = 0;
+        }
+
+        WaitFor([&]() { return m_capacity - (head - m_header->m_tail.load(memory_order_acquire)) >= recordSize; }, check);
+        *reinterpret_cast<uint64_t*>(m_data + offset) = AlignTo8(size);
+        return m_data + offset + sizeof(uint64_t);
+    }
+
+    // Publishes the record written into the last reserved space.
+    void Commit()
+    {
+        uint64_t head = m_header->m_head.load(memory_order_relaxed);
+        uint64_t size = *reinterpret_cast<const uint64_t*>(m_data + head % m_capacity);
+        m_header->m_head.store(head + sizeof(uint64_t) + size, memory_order_release);
+    }
+
+    // Gets the next record if there is one; end is the position to release it with.
+    bool TryRead(const char*& record, uint64_t& end)
+    {
+        uint64_t head = m_header->m_head.load(memory_order_acquire);
+        while (m_readPosition < head)
+        {
+            size_t offset = (size_t)(m_readPosition % m_capacity);
+            uint64_t size = *reinterpret_cast<const uint64_t*>(m_data + offset);
+            m_readPosition += sizeof(uint64_t) + (size & ~s_skipRecord);
+            if (size & s_skipRecord)
+                continue;
+
+            record = m_data + offset + sizeof(uint64_t);
+            end = m_readPosition;
+            return true;
+        }
+        return false;
+    }
+
+    // Gives the space up to the given position back to the producer.
+    void Release(uint64_t end)
+    {
+        m_header->m_tail.store(end, memory_order_release);
+    }
+
+private:
+    RingHeader* m_header;
+    char* m_data;
+    size_t m_capacity;
+    uint64_t m_readPosition; // consumer side only
+};
+
+// Shared memory, rings and process of a single worker. Created before the worker is forked,
+// so both processes use the same object at the same address.
+class WorkerChannel : public enable_shared_from_this<WorkerChannel>
+{
+public:
+    WorkerChannel(size_t answerRingSize)
+        : m_memory(nullptr), m_memorySize(0), m_pid(-1), m_parentPid(-1)
+    {
+#ifdef _WIN32
+        UNUSED(answerRingSize);
+        RuntimeError("MultiProcessSequenceEnumerator: worker processes are not supported on Windows.");
+#else
+        answerRingSize = AlignTo8(answerRingSize);
+        m_memorySize = 2 * sizeof(RingHeader) + s_commandRingSize + answerRingSize;
+        m_memory = mmap(nullptr, m_memorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (m_memory == MAP_FAILED)
+            RuntimeError("MultiProcessSequenceEnumerator: failed to allocate %" PRIu64 " bytes of shared memory: %s.", (uint64_t)m_memorySize, strerror(errno));
+
+        char* memory = static_cast<char*>(m_memory);
+        auto headers = reinterpret_cast<RingHeader*>(memory);
+        m_commands.Initialize(headers, memory + 2 * sizeof(RingHeader), s_commandRingSize);
+        m_answers.Initialize(headers + 1, memory + 2 * sizeof(RingHeader) + s_commandRingSize, answerRingSize);
+#endif
+    }
+
+    ~WorkerChannel()
+    {
+        Terminate();
+#ifndef _WIN32
+        if (m_memory)
+            munmap(m_memory, m_memorySize);
+#endif
+    }
+
+    // Forks the worker process, which runs the given function and exits.
+    void Start(const function<void()>& worker)
+    {
+#ifndef _WIN32
+        // Otherwise the worker would inherit (and eventually write out) whatever is buffered.
+        fflush(stdout);
+        fflush(stderr);
+
+        m_parentPid = getpid();
+        pid_t pid = fork();
+        if (pid < 0)
+            RuntimeError("MultiProcessSequenceEnumerator: failed to start a worker process: %s.", strerror(errno));
+
+        if (pid == 0)
+        {
+            // Only the forking thread exists in the worker, but the OpenMP runtime (libgomp) still believes it owns
+            // the thread pool of the training process, and the first parallel region with more than one thread
+            // hangs. Workers are therefore single-threaded: no parallel region is ever active in them, regardless
+            // of num_threads clauses, and code that sizes its work by omp_get_max_threads() sees a single thread.
+            omp_set_num_threads(1);
+            omp_set_max_active_levels(0);
+
+            // The worker watches its parent while it waits (see CheckParent()), and exits when it is gone.
+            int exitCode = 0;
+            try
+            {
+                worker();
+            }
+            catch (const exception& e)
+            {
+                fprintf(stderr, "MultiProcessSequenceEnumerator: worker process failed: %s\n", e.what());
+                exitCode = 1;
+            }
+
+            // Do not run the destructors and exit handlers of the training process.
+            fflush(stderr);
+            _exit(exitCode);
+        }
+        m_pid = pid;
+#else
+        UNUSED(worker);
+#endif
+    }
+
+    // Workers hold no state worth flushing, so they are simply killed.
+    void Terminate()
+    {
+#ifndef _WIN32
+        if (m_pid > 0)
+        {
+            kill(m_pid, SIGKILL);
+            waitpid(m_pid, nullptr, 0);
+            m_pid = -1;
+        }
+#endif
+    }
+
+    // Training process side.
+
+    void SendCommand(const vector<char>& command)
+    {
+        if (command.size() > m_commands.MaxRecordSize())
+            RuntimeError("MultiProcessSequenceEnumerator: a command of %" PRIu64 " bytes is too big.", (uint64_t)command.size());
+
+        char* record = m_commands.Reserve(command.size(), [this]() { CheckWorker(); });
+        memcpy(record, command.data(), command.size());
+        m_commands.Commit();
+    }
+
+    // Waits for the next answer. The answer stays valid (and its space in the ring is not reused)
+    // as long as the returned holder is alive.
+    shared_ptr<uint8_t> ReceiveAnswer()
+    {
+        const char* record = nullptr;
+        uint64_t end = 0;
+        WaitFor([&]() { return m_answers.TryRead(record, end); }, [this]() { CheckWorker(); });
+
+        {
+            lock_guard<mutex> lock(m_releaseLock);
+            m_pendingAnswers.push_back(make_pair(end, false));
+        }
+
+        auto self = shared_from_this();
+        return shared_ptr<uint8_t>((uint8_t*)record, [self, end](uint8_t*) { self->ReleaseAnswer(end); });
+    }
+
+    void CheckWorker()
+    {
+#ifndef _WIN32
+        int status = 0;
+        if (m_pid > 0 && waitpid(m_pid, &status, WNOHANG) == m_pid)
+        {
+            pid_t pid = m_pid;
+            m_pid = -1;
+            RuntimeError("MultiProcessSequenceEnumerator: worker process %d exited unexpectedly (status %d).", (int)pid, status);
+        }
+#endif
+    }
+
+    // Worker process side.
+
+    void ReceiveCommand(const char*& record, uint64_t& end)
+    {
+        WaitFor([&]() { return m_commands.TryRead(record, end); }, [this]() { CheckParent(); });
+    }
+
+    void ReleaseCommand(uint64_t end)
+    {
+        m_commands.Release(end);
+    }
+
+    // Writes an answer directly into the ring; write is called twice, first to measure the answer.
+    void SendAnswer(const function<void(RecordWriter&)>& write)
+    {
+        RecordWriter measure;
+        write(measure);
+        if (measure.Size() > m_answers.MaxRecordSize())
+        {
+            SendError("an answer of " + to_string(measure.Size()) + " bytes does not fit into the shared memory of the worker (" +
+                      to_string(m_answers.MaxRecordSize()) + " bytes); increase workerSharedMemorySizeInMB.");
+            return;
+        }
+
+        RecordWriter writer(m_answers.Reserve(measure.Size(), [this]() { CheckParent(); }));
+        write(writer);
+        assert(writer.Size() == measure.Size());
+        m_answers.Commit();
+    }
+
+    void SendError(const string& message)
+    {
+        // The ring is large enough for an error message (see s_minAnswerRingSize), if needed a truncated one.
+        size_t maxLength = m_answers.MaxRecordSize() - 2 * sizeof(uint64_t);
+        string text = message.substr(0, maxLength);
+        SendAnswer([&](RecordWriter& w)
+        {
+            w.Write(AnswerType::Error);
+            w.Write(text);
+        });
+    }
+
+    void CheckParent()
+    {
+#ifndef _WIN32
+        if (getppid() != m_parentPid)
+            _exit(1);
+#endif
+    }
+
+private:
+    // Answers are released in any order, but the ring space can only be given back in order.
+    void ReleaseAnswer(uint64_t end)
+    {
+        lock_guard<mutex> lock(m_releaseLock);
+        for (auto& p : m_pendingAnswers)
+        {
+            if (p.first == end)
+            {
+                p.second = true;
+                break;
+            }
+        }
+
+        uint64_t released = 0;
+        while (!m_pendingAnswers.empty() && m_pendingAnswers.front().second)
+        {
+            released = m_pendingAnswers.front().first;
+            m_pendingAnswers.pop_front();
+        }
+
+        if (released)
+            m_answers.Release(released);
+    }
+
+    void* m_memory;
+    size_t m_memorySize;
+    SharedRing m_commands;
+    SharedRing m_answers;
+
+    int m_pid;
+    int m_parentPid;
+
+    mutex m_releaseLock;
+    deque<pair<uint64_t, bool>> m_pendingAnswers; // end of the answer, whether it was released
+
+    DISABLE_COPY_AND_MOVE(WorkerChannel);
+};
+
+// Sequences pointing into an answer in the ring.
+struct SharedDenseSequenceData : DenseSequenceData
+{
+    SharedDenseSequenceData(const NDShape& sampleShape, const void* data, unsigned int numberOfSamples)
+        : DenseSequenceData(numberOfSamples), m_sampleShape(sampleShape), m_data(data)
+    {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const void* m_data;
+};
+
+struct SharedSparseSequenceData : SparseSequenceData
+{
+    SharedSparseSequenceData(const NDShape& sampleShape, const void* data, unsigned int numberOfSamples)
+        : SparseSequenceData(numberOfSamples), m_sampleShape(sampleShape), m_data(data)
+    {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const void* m_data;
+};
+
+static void WriteSequences(RecordWriter& w, const Sequences& sequences, const vector<StreamInformation>& streams, const map<wstring, size_t>& state)
+{
+    w.Write(AnswerType::Sequences);
+    w.Write<uint32_t>((sequences.m_endOfSweep ? 1 : 0) | (sequences.m_endOfEpoch ? 2 : 0));
+    w.Write(state);
+
+    const auto& data = sequences.m_data;
+    w.Write<uint64_t>(data.size());
+    w.Write<uint64_t>(data.empty() ? 0 : data.front().size());
+    for (size_t streamIndex = 0; streamIndex < data.size(); ++streamIndex)
+    {
+        const auto& stream = streams[streamIndex];
+        size_t elementSize = DataTypeSize(stream.m_elementType);
+        for (const auto& sequence : data[streamIndex])
+        {
+            SequenceHeader header = {};
+            header.m_isValid = sequence->m_isValid ? 1 : 0;
+            header.m_keySequence = sequence->m_key.m_sequence;
+            header.m_keySample = sequence->m_key.m_sample;
+            if (!sequence->m_isValid)
+            {
+                w.Write(header);
+                continue;
+            }
+
+            const NDShape& shape = sequence->GetSampleShape();
+            header.m_numberOfSamples = sequence->m_numberOfSamples;
+            header.m_rank = (uint32_t)shape.Rank();
+            if (stream.m_storageFormat == StorageFormat::Dense)
+            {
+                w.Write(header);
+                for (size_t d = 0; d < shape.Rank(); ++d)
+                    w.Write<uint64_t>(shape[d]);
+                w.Write(sequence->GetDataBuffer(), sequence->m_numberOfSamples * shape.TotalSize() * elementSize);
+            }
+            else
+            {
+                auto sparse = static_pointer_cast<SparseSequenceData>(sequence);
+                header.m_totalNnzCount = sparse->m_totalNnzCount;
+                w.Write(header);
+                for (size_t d = 0; d < shape.Rank(); ++d)
+                    w.Write<uint64_t>(shape[d]);
+                w.Write(sparse->m_nnzCounts.data(), sparse->m_nnzCounts.size() * sizeof(SparseIndexType));
+                w.Write(sparse->m_indices, sparse->m_totalNnzCount * sizeof(SparseIndexType));
+                w.Write(sparse->GetDataBuffer(), sparse->m_totalNnzCount * elementSize);
+            }
+        }
+    }
+}
+
+// Appends the sequences of an answer to the result; the sequences keep the answer alive.
+static void ReadSequences(RecordReader& r, const shared_ptr<uint8_t>& answer, const vector<StreamInformation>& streams, Sequences& result)
+{
+    size_t numberOfStreams = (size_t)r.Read<uint64_t>();
+    size_t numberOfSequences = (size_t)r.Read<uint64_t>();
+    if (numberOfStreams == 0)
+        return;
+
+    if (numberOfStreams != streams.size())
+        LogicError("MultiProcessSequenceEnumerator: a worker returned %d streams, expected %d.", (int)numberOfStreams, (int)streams.size());
+
+    result.m_data.resize(numberOfStreams);
+    for (size_t streamIndex = 0; streamIndex < numberOfStreams; ++streamIndex)
+    {
+        const auto& stream = streams[streamIndex];
+        size_t elementSize = DataTypeSize(stream.m_elementType);
+        auto& output = result.m_data[streamIndex];
+        output.reserve(output.size() + numberOfSequences);
+        for (size_t i = 0; i < numberOfSequences; ++i)
+        {
+            auto header = r.Read<SequenceHeader>();
+            if (!header.m_isValid)
+            {
+                output.push_back(InvalidSequenceData::Instance());
+                continue;
+            }
+
+            vector<size_t> dimensions(header.m_rank);
+            for (auto& d : dimensions)
+                d = (size_t)r.Read<uint64_t>();
+            NDShape shape(dimensions);
+
+            SequenceDataPtr sequence;
+            if (stream.m_storageFormat == StorageFormat::Dense)
+            {
+                const char* data = r.Skip(header.m_numberOfSamples * shape.TotalSize() * elementSize);
+                sequence = make_shared<SharedDenseSequenceData>(shape, data, header.m_numberOfSamples);
+            }
+            else
+            {
+                auto nnzCounts = reinterpret_cast<const SparseIndexType*>(r.Skip(header.m_numberOfSamples * sizeof(SparseIndexType)));
+                auto indices = reinterpret_cast<const SparseIndexType*>(r.Skip(header.m_totalNnzCount * sizeof(SparseIndexType)));
+                const char* data = r.Skip(header.m_totalNnzCount * elementSize);
+
+                auto sparse = make_shared<SharedSparseSequenceData>(shape, data, header.m_numberOfSamples);
+                sparse->m_nnzCounts.assign(nnzCounts, nnzCounts + header.m_numberOfSamples);
+                sparse->m_indices = const_cast<SparseIndexType*>(indices);
+                sparse->m_totalNnzCount = header.m_totalNnzCount;
+                sequence = sparse;
+            }
+
+            sequence->m_elementType = stream.m_elementType;
+            sequence->m_key = SequenceKey(header.m_keySequence, header.m_keySample);
+            sequence->m_holdingBuffer = answer;
+            output.push_back(sequence);
+        }
+    }
+}
+
+// Main loop of a worker process: executes commands until the training process goes away.
+static void RunWorker(WorkerChannel& channel, const MultiProcessSequenceEnumerator::EnumeratorFactory& factory, size_t workerIndex)
+{
+    SequenceEnumeratorPtr enumerator;
+    vector<StreamInformation> streams;
+    try
+    {
+        enumerator = factory(workerIndex);
+        streams = enumerator->GetStreamDescriptions();
+        auto state = enumerator->GetState();
+        channel.SendAnswer([&](RecordWriter& w)
+        {
+            w.Write(AnswerType::Ack);
+            w.Write(state);
+        });
+    }
+    catch (const exception& e)
+    {
+        channel.SendError(string("failed to create the enumerator: ") + e.what());
+        enumerator = nullptr;
+    }
+
+    for (;;)
+    {
+        const char* record = nullptr;
+        uint64_t end = 0;
+        channel.ReceiveCommand(record, end);
+
+        try
+        {
+            if (!enumerator)
+                RuntimeError("the enumerator of the worker could not be created.");
+
+            RecordReader r(record);
+            auto type = r.Read<CommandType>();
+            if (type == CommandType::GetNext)
+            {
+                size_t globalSampleCount = (size_t)r.Read<uint64_t>();
+                size_t localSampleCount = (size_t)r.Read<uint64_t>();
+                channel.ReleaseCommand(end);
+
+                // Nothing is asked from this worker this time (local timeline with fewer samples than workers).
+                Sequences sequences;
+                if (localSampleCount != 0)
+                    sequences = enumerator->GetNextSequences(globalSampleCount, localSampleCount);
+
+                auto state = enumerator->GetState();
+                channel.SendAnswer([&](RecordWriter& w) { WriteSequences(w, sequences, streams, state); });
+                continue;
+            }
+
+            switch (type)
+            {
+            case CommandType::StartEpoch:
+            {
+                EpochConfiguration config;
+                r.Read(config);
+                enumerator->StartEpoch(config);
+                break;
+            }
+            case CommandType::SetConfiguration:
+            {
+                ReaderConfiguration config;
+                r.Read(config);
+                enumerator->SetConfiguration(config);
+                break;
+            }
+            case CommandType::SetState:
+                enumerator->SetState(r.ReadState());
+                break;
+            default:
+                LogicError("unknown command %d.", (int)type);
+            }
+            channel.ReleaseCommand(end);
+
+            auto state = enumerator->GetState();
+            channel.SendAnswer([&](RecordWriter& w)
+            {
+                w.Write(AnswerType::Ack);
+                w.Write(state);
+            });
+        }
+        catch (const exception& e)
+        {
+            channel.ReleaseCommand(end);
+            channel.SendError(e.what());
+        }
+    }
+}
+
+MultiProcessSequenceEnumerator::MultiProcessSequenceEnumerator(
+    const vector<StreamInformation>& streams,
+    size_t numberOfWorkers,
+    EnumeratorFactory factory,
+    bool localTimeline,
+    size_t sharedMemorySizePerWorker,
+    size_t prefetchDepth)
+    : m_streams(streams),
+      m_localTimeline(localTimeline),
+      m_prefetchDepth(max<size_t>(prefetchDepth, 1)),
+      m_requestIndex(0)
+{
+    if (numberOfWorkers == 0)
+        InvalidArgument("MultiProcessSequenceEnumerator: the number of worker processes must be positive.");
+
+    if (sharedMemorySizePerWorker < s_minAnswerRingSize)
+        InvalidArgument("MultiProcessSequenceEnumerator: the shared memory of a worker must be at least %d bytes.", (int)s_minAnswerRingSize);
+
+    for (const auto& s : m_streams)
+    {
+        if (s.m_isBinary)
+            InvalidArgument("MultiProcessSequenceEnumerator: binary stream '%ls' is not supported with worker processes.", s.m_name.c_str());
+    }
+
+    // All channels are created first, so that every worker is started with the same view of the shared memory.
+    for (size_t i = 0; i < numberOfWorkers; ++i)
+        m_workers.push_back(make_shared<WorkerChannel>(sharedMemorySizePerWorker));
+
+    for (size_t i = 0; i < numberOfWorkers; ++i)
+    {
+        WorkerChannel& channel = *m_workers[i];
+        channel.Start([&channel, &factory, i]() { RunWorker(channel, factory, i); });
+    }
+
+    // Waiting until the workers have created their enumerators.
+    m_workerStates.resize(numberOfWorkers);
+    m_endOfEpochReached.resize(numberOfWorkers, false);
+    string errors;
+    for (size_t i = 0; i < numberOfWorkers; ++i)
+    {
+        auto answer = m_workers[i]->ReceiveAnswer();
+        RecordReader r((const char*)answer.get());
+        auto type = r.Read<AnswerType>();
+        if (type == AnswerType::Error)
+            errors += "\n  worker " + to_string(i) + ": " + r.ReadString();
+        else
+            m_workerStates[i] = r.ReadState();
+    }
+
+    if (!errors.empty())
+        RuntimeError("MultiProcessSequenceEnumerator: worker processes failed to start:%s", errors.c_str());
+}
+
+MultiProcessSequenceEnumerator::~MultiProcessSequenceEnumerator()
+{
+    // The shared memory stays mapped as long as there are sequences pointing into it.
+    for (auto& w : m_workers)
+        w->Terminate();
+}
+
+pair<size_t, size_t> MultiProcessSequenceEnumerator::WorkerSampleCounts(const Request& request, size_t requestIndex, size_t worker) const
+{
+    if (!m_localTimeline)
+        return make_pair(request.m_globalSampleCount, request.m_localSampleCount);
+
+    // Splitting local samples, the remainder goes to different workers in turn.
+    size_t numberOfWorkers = m_workers.size();
+    size_t share = request.m_localSampleCount / numberOfWorkers;
+    if ((worker + numberOfWorkers - requestIndex % numberOfWorkers) % numberOfWorkers < request.m_localSampleCount % numberOfWorkers)
+        share++;
+    return make_pair(request.m_globalSampleCount, share);
+}
+
+void MultiProcessSequenceEnumerator::IssueRequest(const Request& request)
+{
+    size_t requestIndex = m_requestIndex + m_outstanding.size();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        auto counts = WorkerSampleCounts(request, requestIndex, i);
+        RecordWriter measure;
+        measure.Write(CommandType::GetNext);
+        measure.Write<uint64_t>(counts.first);
+        measure.Write<uint64_t>(counts.second);
+
+        vector<char> command(measure.Size());
+        RecordWriter w(command.data());
+        w.Write(CommandType::GetNext);
+        w.Write<uint64_t>(counts.first);
+        w.Write<uint64_t>(counts.second);
+        m_workers[i]->SendCommand(command);
+    }
+    m_outstanding.push_back(request);
+}
+
+void MultiProcessSequenceEnumerator::DropOutstandingRequests(bool rollBack)
+{
+    if (m_outstanding.empty())
+        return;
+
+    for (; !m_outstanding.empty(); m_outstanding.pop_front())
+    {
+        for (auto& w : m_workers)
+            w->ReceiveAnswer();
+    }
+
+    // Speculative answers have moved the workers ahead of what was consumed.
+    if (rollBack)
+        Broadcast([this](size_t worker, RecordWriter& w)
+        {
+            w.Write(CommandType::SetState);
+            w.Write(m_workerStates[worker]);
+        });
+}
+
+void MultiProcessSequenceEnumerator::Broadcast(const function<void(size_t worker, RecordWriter& w)>& write)
+{
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        RecordWriter measure;
+        write(i, measure);
+        vector<char> command(measure.Size());
+        RecordWriter w(command.data());
+        write(i, w);
+        m_workers[i]->SendCommand(command);
+    }
+
+    string errors;
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        auto answer = m_workers[i]->ReceiveAnswer();
+        RecordReader r((const char*)answer.get());
+        auto type = r.Read<AnswerType>();
+        if (type == AnswerType::Error)
+            errors += "\n  worker " + to_string(i) + ": " + r.ReadString();
+        else
+            m_workerStates[i] = r.ReadState();
+    }
+
+    if (!errors.empty())
+        RuntimeError("MultiProcessSequenceEnumerator: worker processes failed:%s", errors.c_str());
+}
+
+// Worker i of the rank r out of R workers is the rank r * N + i out of R * N.
+template <class Configuration>
+static Configuration WorkerConfiguration(const Configuration& config, size_t worker, size_t numberOfWorkers)
+{
+    Configuration result = config;
+    result.m_numberOfWorkers = max<size_t>(config.m_numberOfWorkers, 1) * numberOfWorkers;
+    result.m_workerRank = config.m_workerRank * numberOfWorkers + worker;
+    return result;
+}
+
+void MultiProcessSequenceEnumerator::StartEpoch(const EpochConfiguration& config)
+{
+    DropOutstandingRequests(/*rollBack =*/ false);
+    Broadcast([&](size_t worker, RecordWriter& w)
+    {
+        w.Write(CommandType::StartEpoch);
+        w.Write(WorkerConfiguration(config, worker, m_workers.size()));
+    });
+
+    m_requestIndex = 0;
+    fill(m_endOfEpochReached.begin(), m_endOfEpochReached.end(), false);
+}
+
+void MultiProcessSequenceEnumerator::SetConfiguration(const ReaderConfiguration& config)
+{
+    DropOutstandingRequests(/*rollBack =*/ true);
+    Broadcast([&](size_t worker, RecordWriter& w)
+    {
+        w.Write(CommandType::SetConfiguration);
+        w.Write(WorkerConfiguration(config, worker, m_workers.size()));
+    });
+}
+
+wstring MultiProcessSequenceEnumerator::StateKeySuffix(size_t worker) const
+{
+    // In the global timeline all workers are at the same position.
+    if (!m_localTimeline || worker == 0)
+        return wstring();
+    return L".worker" + to_wstring(worker);
+}
+
+// In the local timeline the split of the samples depends on the request index, so it is a part of the state.
+static const wstring s_requestIndexProperty = L"workerProcessRequestIndex";
+
+map<wstring, size_t> MultiProcessSequenceEnumerator::GetState()
+{
+    map<wstring, size_t> state = m_workerStates.front();
+    if (m_localTimeline)
+        state[s_requestIndexProperty] = m_requestIndex;
+
+    for (size_t i = 1; i < m_workers.size(); ++i)
+    {
+        wstring suffix = StateKeySuffix(i);
+        if (suffix.empty())
+            continue;
+
+        for (const auto& p : m_workerStates[i])
+            state[p.first + suffix] = p.second;
+    }
+    return state;
+}
+
+void MultiProcessSequenceEnumerator::SetState(const map<wstring, size_t>& state)
+{
+    DropOutstandingRequests(/*rollBack =*/ false);
+    Broadcast([&](size_t worker, RecordWriter& w)
+    {
+        // Taking the keys of this worker, or the original keys if there are none (i.e. only the position is set).
+        map<wstring, size_t> workerState;
+        wstring suffix = StateKeySuffix(worker);
+        for (const auto& p : state)
+        {
+            if (!suffix.empty() && p.first.size() > suffix.size() &&
+                p.first.compare(p.first.size() - suffix.size(), suffix.size(), suffix) == 0)
+                workerState[p.first.substr(0, p.first.size() - suffix.size())] = p.second;
+        }
+
+        if (workerState.empty())
+        {
+            for (const auto& p : state)
+            {
+                if (p.first.find(L".worker") == wstring::npos && p.first != s_requestIndexProperty)
+                    workerState.insert(p);
+            }
+        }
+
+        w.Write(CommandType::SetState);
+        w.Write(workerState);
+    });
+
+    auto requestIndex = state.find(s_requestIndexProperty);
+    m_requestIndex = requestIndex != state.end() ? requestIndex->second : 0;
+    fill(m_endOfEpochReached.begin(), m_endOfEpochReached.end(), false);
+}
+
+Sequences MultiProcessSequenceEnumerator::GetNextSequences(size_t globalSampleCount, size_t localSampleCount)
+{
+    Request request{ globalSampleCount, localSampleCount };
+    if (!m_outstanding.empty() &&
+        (m_outstanding.front().m_globalSampleCount != globalSampleCount || m_outstanding.front().m_localSampleCount != localSampleCount))
+    {
+        DropOutstandingRequests(/*rollBack =*/ true);
+    }
+
+    bool endOfEpoch = all_of(m_endOfEpochReached.begin(), m_endOfEpochReached.end(), [](bool b) { return b; });
+    if (m_outstanding.empty())
+        IssueRequest(request);
+
+    // Keeping the workers busy while this request is consumed.
+    while (!endOfEpoch && m_outstanding.size() < m_prefetchDepth)
+        IssueRequest(request);
+
+    Sequences result;
+    string errors;
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        auto answer = m_workers[i]->ReceiveAnswer();
+        RecordReader r((const char*)answer.get());
+        auto type = r.Read<AnswerType>();
+        if (type == AnswerType::Error)
+        {
+            errors += "\n  worker " + to_string(i) + ": " + r.ReadString();
+            continue;
+        }
+
+        uint32_t flags = r.Read<uint32_t>();
+        result.m_endOfSweep |= (flags & 1) != 0;
+        if (flags & 2)
+            m_endOfEpochReached[i] = true;
+
+        m_workerStates[i] = r.ReadState();
+        ReadSequences(r, answer, m_streams, result);
+    }
+
+    m_outstanding.pop_front();
+    m_requestIndex++;
+
+    if (!errors.empty())
+        RuntimeError("MultiProcessSequenceEnumerator: worker processes failed to get sequences:%s", errors.c_str());
+
+    result.m_endOfEpoch = all_of(m_endOfEpochReached.begin(), m_endOfEpochReached.end(), [](bool b) { return b; });
+    return result;
+}
+
+}
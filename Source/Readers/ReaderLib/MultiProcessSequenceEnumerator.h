@@ -0,0 +1,116 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include "SequenceEnumerator.h"
+
+namespace CNTK {
+
+class WorkerChannel;
+typedef std::shared_ptr<WorkerChannel> WorkerChannelPtr;
+
+class RecordWriter;
+
+// A sequence enumerator that moves deserialization and transformation out of the training process.
+//
+// Each of the N local worker processes builds its own copy of the enumerator chain (deserializers, randomizer
+// and transformers) through the factory, and runs it as an additional distributed worker: worker i of the
+// training process with rank r out of R is rank r * N + i out of R * N. The worker processes therefore see
+// disjoint sets of chunks (or sequences, depending on the randomizer), which together form the set of this rank.
+// The union of their answers is returned by GetNextSequences().
+//
+// Workers publish the sequences into a shared memory ring buffer (one per worker), and the returned sequences
+// point directly into the ring: the packer reads them without an intermediate copy. The space is given back
+// to the worker when the last reference to the sequences of the answer goes away.
+//
+// Workers run up to prefetchDepth requests ahead, assuming the sample counts do not change. If they do, the
+// speculative answers are dropped and the workers are rolled back to the state of the last consumed answer.
+//
+// There are two ways to split a request among the workers:
+//   - global timeline (BlockRandomizer, NoRandomizer): every worker gets the same request, so all of them move
+//     through the global timeline in lockstep. The local sample count is not split and acts per worker.
+//   - local timeline (LT* randomizers): the local sample count is split among the workers.
+//
+// Worker processes are forked, so this is only available on Linux. Workers must not use the GPU, and they run
+// single-threaded: OpenMP parallel regions are disabled in them, since the OpenMP runtime does not survive fork().
+class MultiProcessSequenceEnumerator : public SequenceEnumerator
+{
+public:
+    // Creates the enumerator chain of the worker with the given index. Called in the worker process.
+    typedef std::function<SequenceEnumeratorPtr(size_t workerIndex)> EnumeratorFactory;
+
+    MultiProcessSequenceEnumerator(
+        const std::vector<StreamInformation>& streams,
+        size_t numberOfWorkers,
+        EnumeratorFactory factory,
+        bool localTimeline,
+        size_t sharedMemorySizePerWorker,
+        size_t prefetchDepth = 2);
+
+    ~MultiProcessSequenceEnumerator();
+
+    std::vector<StreamInformation> GetStreamDescriptions() const override
+    {
+        return m_streams;
+    }
+
+    void StartEpoch(const EpochConfiguration& config) override;
+    void SetConfiguration(const ReaderConfiguration& config) override;
+
+    // The state of worker 0 is stored under the original keys. In local timeline mode, states of
+    // the other workers are stored under the keys suffixed with ".worker<index>".
+    void SetState(const std::map<std::wstring, size_t>& state) override;
+    std::map<std::wstring, size_t> GetState() override;
+
+    Sequences GetNextSequences(size_t globalSampleCount, size_t localSampleCount) override;
+
+private:
+    struct Request
+    {
+        size_t m_globalSampleCount;
+        size_t m_localSampleCount;
+    };
+
+    // Sample counts of the request with the given index for the given worker.
+    std::pair<size_t, size_t> WorkerSampleCounts(const Request& request, size_t requestIndex, size_t worker) const;
+
+    // Sends the next request to all workers.
+    void IssueRequest(const Request& request);
+
+    // Waits for and drops the answers of all outstanding requests. With rollBack, the workers are
+    // moved back to the state after the last consumed answer.
+    void DropOutstandingRequests(bool rollBack);
+
+    // Sends a command to all workers and waits for their acknowledgments.
+    void Broadcast(const std::function<void(size_t worker, RecordWriter& command)>& write);
+
+    std::wstring StateKeySuffix(size_t worker) const;
+
+    std::vector<StreamInformation> m_streams;
+    bool m_localTimeline;
+    size_t m_prefetchDepth;
+
+    std::vector<WorkerChannelPtr> m_workers;
+
+    // State of each worker after the last consumed answer.
+    std::vector<std::map<std::wstring, size_t>> m_workerStates;
+
+    // Whether a worker reported the end of the current epoch.
+    std::vector<bool> m_endOfEpochReached;
+
+    // Requests sent to the workers whose answers have not been consumed yet, oldest first.
+    std::deque<Request> m_outstanding;
+
+    // Index of the next request to be consumed since the last StartEpoch/SetState.
+    size_t m_requestIndex;
+
+    DISABLE_COPY_AND_MOVE(MultiProcessSequenceEnumerator);
+};
+
+}
@@ -42,13 +42,18 @@ inline TensorShape AsTensorShape(const NDShape& viewShape)
 template <class ElemType>
 ReaderShim<ElemType>::ReaderShim() :
     m_deviceId(CPUDEVICE),
-    m_dataTransferers(2, DataTransfererPtr()),
-    m_currentDataTransferIndex(0),
+    m_prefetch(true),
+    m_prefetchDepth(s_defaultPrefetchDepth),
+    m_verbosity(0),
+    m_prefetchRunning(false),
+    m_stopPrefetching(false),
     m_endOfEpoch(false),
     m_endOfSweep(false),
     m_reader(nullptr),
     m_factory(nullptr)
 {
+    m_prefetchSlots.resize(m_prefetchDepth);
+    ResetPrefetchStatistics();
 }
 
 template <class ElemType>
@@ -71,10 +76,12 @@ void ReaderShim<ElemType>::Init(const ConfigParameters& config)
     intargvector numberOfuttsPerMinibatchForAllEpochs =
         config(L"nbruttsineachrecurrentiter", ConfigParameters::Array(intargvector(vector<int> { 1 })));
 
-    bool prefetch = config(L"prefetch", true);
-    // if prefetch - launching asynchronously,
-    // otherwise deferring - synchronous execution during .get() call
-    m_launchType = prefetch ? launch::async : launch::deferred;
+    // if prefetch - reading and transferring minibatches on background threads, up to prefetchDepth minibatches ahead,
+    // otherwise - synchronous execution in GetMinibatch()
+    m_prefetch = config(L"prefetch", true);
+    m_prefetchDepth = m_prefetch ? std::max(1, (int)config(L"prefetchDepth", (int)s_defaultPrefetchDepth)) : 1;
+    m_prefetchSlots.resize(m_prefetchDepth);
+    m_verbosity = config(L"verbosity", 0);
 
     m_numParallelSequences = numberOfuttsPerMinibatchForAllEpochs[0];
 
@@ -122,14 +129,8 @@ void ReaderShim<ElemType>::SetCurrentSamplePosition(size_t currentSamplePosition
     if (GetCurrentSamplePosition() == currentSamplePosition)
         return;
 
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.wait();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads; minibatches prefetched from the old position are dropped.
+    StopPrefetching();
 
     // Set current position.
     std::map<std::wstring, size_t> state;
@@ -143,14 +144,8 @@ void ReaderShim<ElemType>::SetCurrentSamplePosition(size_t currentSamplePosition
 template <class ElemType>
 void ReaderShim<ElemType>::SetConfiguration(const ReaderConfiguration& config, const std::map<std::wstring, int>& inputDescriptions)
 {
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.get();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads. The reader is rewound to the last minibatch returned by GetMinibatch() below.
+    StopPrefetching();
 
     m_reader->SetConfiguration(config, inputDescriptions);
     m_reader->SetState(m_currentState);
@@ -160,13 +155,7 @@ template <class ElemType>
 void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const std::unordered_set<InputStreamDescription>& inputs)
 {
     // For adaptive minibatch, make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.get();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    StopPrefetching();
 
     // Now we can be sure, no prefetch thread is running and there are no outstanding memcopies.
     // Let's check that requested devices are ok and see whether we need to change our data transferers.
@@ -186,45 +175,46 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
     {
         // Device changed. Let's change the data transferers.
         m_deviceId = deviceId;
-        m_dataTransferers.clear();
-        // We need two in order to support two operations in flight.
-        m_dataTransferers.push_back(m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId));
-        m_dataTransferers.push_back(m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId));
+        for (auto& slot : m_prefetchSlots)
+            slot.m_dataTransferer = nullptr;
     }
 
-    // Let's create the buffers for the prefetch thread.
-    std::map<std::wstring, int> inputDescriptions;
-    for (const auto& i : inputs)
+    // Let's create the buffers for the prefetch slots.
+    // Each slot has its own data transferer in order to support one operation in flight per slot.
+    for (auto& slot : m_prefetchSlots)
     {
-        inputDescriptions[i.GetStreamName()] = i.GetDeviceId();
-        // Creating buffers with the same properties the network expects.
-        m_prefetchBuffers[i.GetStreamName()] = StreamPrefetchBuffer
+        if (!slot.m_dataTransferer && m_deviceId != CPUDEVICE)
+            slot.m_dataTransferer = CreatePrefetchDataTransferer(m_deviceId);
+
+        for (const auto& i : inputs)
         {
-            std::make_shared<Matrix<ElemType>>(0, 0, i.GetDeviceId(), i.GetMatrixType(), i.GetMatrixFormat()),
-            std::make_shared<MBLayout>(),
-            NDShape::Unknown()
-        };
+            // Creating buffers with the same properties the network expects.
+            slot.m_buffers[i.GetStreamName()] = StreamPrefetchBuffer
+            {
+                std::make_shared<Matrix<ElemType>>(0, 0, i.GetDeviceId(), i.GetMatrixType(), i.GetMatrixFormat()),
+                std::make_shared<MBLayout>(),
+                NDShape::Unknown()
+            };
+        }
     }
 
+    // All slots have the same buffers. The reader stage reads their names from this list rather than from a slot,
+    // which may be owned by another stage at the time.
+    m_prefetchedStreams.clear();
+    for (const auto& b : m_prefetchSlots.front().m_buffers)
+        m_prefetchedStreams.push_back(b.first);
+
+    std::map<std::wstring, int> inputDescriptions;
+    for (const auto& i : inputs)
+        inputDescriptions[i.GetStreamName()] = i.GetDeviceId();
+
+    ResetPrefetchStatistics();
     m_endOfEpoch = false;
     m_reader->StartEpoch(config, inputDescriptions);
 
     m_currentState = m_reader->GetState();
 }
 
-template <class ElemType>
-void ReaderShim<ElemType>::StartAsyncPrefetching()
-{
-    auto localCurrentDataTransferIndex = m_currentDataTransferIndex;
-    // Starting the prefetch task. There is always a single async read in flight.
-    // When the network requests a new minibatch, we wait for the current async to finish, swap the buffers
-    // and kick off the new prefetch.
-    m_prefetchTask = std::async(m_launchType, [this, localCurrentDataTransferIndex]()
-    {
-        return PrefetchMinibatch(localCurrentDataTransferIndex);
-    });
-}
-
 string EnumerateInputs(const unordered_map<wstring, size_t>& nameToStreamId)
 {
     // TODO use boost::algorithm::join, boost::adapters::transformed, make this a generic function
@@ -266,53 +256,85 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         }
     }
 
-    if (!m_prefetchTask.valid())
-        StartAsyncPrefetching();
+    size_t slotIndex = GetNextPrefetchedSlot();
+    auto& slot = m_prefetchSlots[slotIndex];
 
-    auto result = m_prefetchTask.get();
+    // Hand the slot back to the pipeline when we are done with it.
+    auto releaseSlot = MakeScopeExit([this, slotIndex]()
+    {
+        if (m_prefetchRunning)
+        {
+            std::lock_guard<std::mutex> lock(m_prefetchMutex);
+            m_freeSlots.push_back(slotIndex);
+            m_prefetchCondition.notify_all();
+        }
+    });
+
+    if (slot.m_error)
+    {
+        StopPrefetching();
+        std::rethrow_exception(slot.m_error);
+    }
 
     // Ok, prefetch is done.
+    auto result = slot.m_result;
 
     // Let's update our sample position.
-    m_currentState = m_reader->GetState();
+    m_currentState = slot.m_readerState;
 
     m_endOfEpoch = result.m_isEndOfEpoch;
     m_endOfSweep = result.m_isEndOfSweep;
+    if (m_endOfEpoch)
+    {
+        // The pipeline has stopped after this minibatch.
+        StopPrefetching();
+        if (m_verbosity > 0)
+            PrintPrefetchStatistics();
+    }
+
     if (m_endOfEpoch && !result.m_isDataAvailable)
     {
         // No data and end of epoch, simply return.
         return false;
     }
 
-    // Remember current data transfer, async memcpy for it already started on the prefetch thread.
-    auto currentDataTransferIndex = m_currentDataTransferIndex;
-
-    matrices.m_getKeyById = m_getKeyById;
+    matrices.m_getKeyById = slot.m_getKeyById;
+    m_getKeyById = slot.m_getKeyById;
 
-    // Let's update the current data transferer.
-    m_currentDataTransferIndex = (m_currentDataTransferIndex + 1) % 2;
-
-    // Record an event that prefetch can wait on to ensure that prior compute has finished.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->RecordComputeStreamSyncPoint();
+    // The buffers were created by StartEpoch for the inputs it was given; look them up without inserting.
+    std::vector<StreamPrefetchBuffer*> buffers;
+    for (const auto& mx : matrices)
+    {
+        auto buffer = slot.m_buffers.find(mx.first);
+        if (buffer == slot.m_buffers.end())
+            LogicError("Input '%ls' was not requested when the epoch was started.", mx.first.c_str());
+        buffers.push_back(&buffer->second);
+    }
 
     // We have some data - let's swap the matrices.
     // We cannot simply change pointers because it seems they are remembered deeper in the network.
-    for (auto i = matrices.begin(); i != matrices.end(); ++i)
+    auto buffer = buffers.begin();
+    for (auto i = matrices.begin(); i != matrices.end(); ++i, ++buffer)
     {
-        std::swap(i->second.GetMatrix<ElemType>(), *m_prefetchBuffers[i->first].m_matrix);
+        std::swap(i->second.GetMatrix<ElemType>(), *(*buffer)->m_matrix);
 
         // Resetting layouts.
         i->second.pMBLayout->Init(1, 0);
     }
 
+    // The slot now holds the matrices of the previous minibatch.
+    // Record an event that prefetch can wait on to ensure that prior compute has finished before they are overwritten.
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->RecordComputeStreamSyncPoint();
+
     // a map to generate error messages when checking layout constraints.
     map<wstring, wstring> layoutToInputMap;
 
     // Let's now check the layouts and throw if the same layout is being assigned twice.
-    for (auto i = matrices.begin(); i != matrices.end(); ++i)
+    buffer = buffers.begin();
+    for (auto i = matrices.begin(); i != matrices.end(); ++i, ++buffer)
     {
-        auto streamLayout = m_prefetchBuffers[i->first].m_mbLayout;
+        auto streamLayout = (*buffer)->m_mbLayout;
         auto& layout = i->second.pMBLayout;
         if (layout->GetNumCols() == 0) // just initialized, let's take the layout of the reader.
         {
@@ -329,7 +351,7 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         }
 
         // Check sample shape.
-        const auto& sampleShape = m_prefetchBuffers[i->first].m_sampleShape;
+        const auto& sampleShape = (*buffer)->m_sampleShape;
         if (i->second.sampleLayout.size() == 0 || AsNDShape(i->second.sampleLayout).IsUnknown()) // Not set.
         {
             i->second.sampleLayout = AsTensorShape(sampleShape);
@@ -345,16 +367,6 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     // So pick up the first one.
     m_numParallelSequences = matrices.begin()->second.pMBLayout->GetNumParallelSequences();
 
-    // It is time to issue the next prefetch.
-    if (!m_endOfEpoch)
-    {
-        StartAsyncPrefetching();
-    }
-
-    // Let's wait till the previous memcopy has finished.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForCopyCPUToGPU();
-
     return result.m_isDataAvailable;
 }
 
@@ -384,52 +396,277 @@ void FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t n
 }
 
 template <class ElemType>
-typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t currentDataTransferIndex)
+typename ReaderShim<ElemType>::ReadResult ReaderShim<ElemType>::ReadMinibatch()
 {
     PROFILE_SCOPE(profilerEvtPrefetchMinibatch);
 
+    ReadResult read;
+    try
+    {
+        read.m_minibatch = m_reader->ReadMinibatch();
+        read.m_readerState = m_reader->GetState();
+
+        for (const auto& name : m_prefetchedStreams)
+        {
+            if (m_streams[m_nameToStreamId.at(name)].m_sampleLayout.IsUnknown())
+            {
+                // Sample layout can be lazily updated on the first minibatch, so let reread it.
+                // In the future we should use NDShape for the sequence instead of sample.
+                m_streams = m_reader->GetStreamDescriptions();
+                break;
+            }
+        }
+        read.m_streams = m_streams;
+
+#ifndef CNTK_UWP
+        // Follow the minibatch through the prefetch stages in the profiler's detail log.
+        if (m_prefetch)
+        {
+            read.m_flowId = ProfilerNewFlowId();
+            ProfilerFlowBegin(read.m_flowId, profilerEvtPrefetchMinibatch);
+        }
+#endif
+    }
+    catch (...)
+    {
+        read.m_error = std::current_exception();
+    }
+    return read;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::FillSlot(PrefetchSlot& slot, ReadResult& read)
+{
+    PROFILE_SCOPE(profilerEvtPrefetchTransfer);
+
+    const Minibatch& minibatch = read.m_minibatch;
+    slot.m_error = read.m_error;
+    slot.m_readerState = std::move(read.m_readerState);
+    slot.m_getKeyById = minibatch.m_getKeyById;
+    slot.m_result = PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, !minibatch.m_data.empty() };
+    slot.m_flowId = read.m_flowId;
+#ifndef CNTK_UWP
+    if (slot.m_flowId)
+        ProfilerFlowStep(slot.m_flowId, profilerEvtPrefetchMinibatch);
+#endif
+
     // Resetting layouts.
-    for (auto& mx : m_prefetchBuffers)
+    for (auto& mx : slot.m_buffers)
         mx.second.m_mbLayout = std::make_shared<MBLayout>();
 
-    Minibatch minibatch = m_reader->ReadMinibatch();
-
     // If there is no data we can simply return.
-    if (minibatch.m_data.empty())
-        return PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, false };
+    if (slot.m_error || minibatch.m_data.empty())
+        return;
+
+    try
+    {
+        // Ok we have some data. Let's load it to GPU.
+        // But before we need to make sure that corresponding compute has already finished from the last iteration.
 
-    // Ok we have some data. Let's load it to GPU.
-    // But before we need to make sure that corresponding compute has already finished from the last iteration.
+        // We need to make sure that the compute using the matrices of this slot is finished before we start prefetch.
+        if (slot.m_dataTransferer)
+            slot.m_dataTransferer->WaitForSyncPointOnAssignStreamAsync();
 
-    // We need to make sure that the compute for the current transfer is finished before we start prefetch.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForSyncPointOnAssignStreamAsync();
+        for (auto& mx : slot.m_buffers)
+        {
+            size_t streamId = m_nameToStreamId.at(mx.first);
+            const auto& stream = minibatch.m_data[streamId];
+            mx.second.m_mbLayout = stream->m_layout;
+            mx.second.m_sampleShape = stream->m_sampleShape;
 
-    m_getKeyById = minibatch.m_getKeyById;
+            size_t sampleSize = read.m_streams[streamId].m_sampleLayout.TotalSize();
+            FillMatrixFromStream(read.m_streams[streamId].m_storageFormat, mx.second.m_matrix.get(), sampleSize, stream, slot.m_dataTransferer.get());
+        }
 
-    for (auto& mx : m_prefetchBuffers)
+        // The packer reuses the memory of this minibatch once the reader has read the next one,
+        // so the copy has to finish before the slot is handed on.
+        if (slot.m_dataTransferer)
+        {
+            slot.m_dataTransferer->RecordCPUToGPUCopy();
+            slot.m_dataTransferer->WaitForCopyCPUToGPU();
+        }
+    }
+    catch (...)
     {
-        size_t streamId = m_nameToStreamId[mx.first];
-        const auto& stream = minibatch.m_data[streamId];
-        mx.second.m_mbLayout = stream->m_layout;
-        mx.second.m_sampleShape = stream->m_sampleShape;
+        slot.m_error = std::current_exception();
+    }
+}
 
-        if (m_streams[streamId].m_sampleLayout.IsUnknown())
+static double SecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::ReaderStageLoop()
+{
+    auto& statistics = m_stageStatistics[ReadStage];
+    for (;;)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        ReadResult read = ReadMinibatch();
+        statistics.m_busySeconds += SecondsSince(startTime);
+        statistics.m_numMinibatches++;
+
+        bool isLast = read.IsLast();
+
+        // Hand the minibatch over to the transfer stage. The next one can only be read once the transfer stage
+        // has taken this one, i.e. has finished with the previous one, whose buffer the packer will reuse.
+        std::unique_lock<std::mutex> lock(m_prefetchMutex);
+        m_pendingRead.reset(new ReadResult(std::move(read)));
+        m_prefetchCondition.notify_all();
+        if (isLast)
+            return;
+
+        startTime = std::chrono::steady_clock::now();
+        m_prefetchCondition.wait(lock, [this] { return m_stopPrefetching || !m_pendingRead; });
+        statistics.m_blockedSeconds += SecondsSince(startTime);
+        if (m_stopPrefetching)
+            return;
+    }
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::TransferStageLoop()
+{
+    auto& statistics = m_stageStatistics[TransferStage];
+    for (;;)
+    {
+        std::unique_ptr<ReadResult> read;
+        size_t slotIndex;
         {
-            // Sample layout can be lazily updated on the first minibatch, so let reread it.
-            // In the future we should use NDShape for the sequence instead of sample.
-            m_streams = m_reader->GetStreamDescriptions();
+            std::unique_lock<std::mutex> lock(m_prefetchMutex);
+            auto startTime = std::chrono::steady_clock::now();
+            m_prefetchCondition.wait(lock, [this] { return m_stopPrefetching || m_pendingRead; });
+            statistics.m_starvedSeconds += SecondsSince(startTime);
+
+            startTime = std::chrono::steady_clock::now();
+            m_prefetchCondition.wait(lock, [this] { return m_stopPrefetching || !m_freeSlots.empty(); });
+            statistics.m_blockedSeconds += SecondsSince(startTime);
+            if (m_stopPrefetching)
+                return;
+
+            read = std::move(m_pendingRead);
+            slotIndex = m_freeSlots.front();
+            m_freeSlots.pop_front();
+            m_prefetchCondition.notify_all();
         }
 
-        size_t sampleSize = m_streams[streamId].m_sampleLayout.TotalSize();
-        FillMatrixFromStream(m_streams[streamId].m_storageFormat, mx.second.m_matrix.get(), sampleSize, stream, m_dataTransferers[currentDataTransferIndex].get());
+        auto startTime = std::chrono::steady_clock::now();
+        FillSlot(m_prefetchSlots[slotIndex], *read);
+        statistics.m_busySeconds += SecondsSince(startTime);
+        statistics.m_numMinibatches++;
+
+        std::lock_guard<std::mutex> lock(m_prefetchMutex);
+        m_readySlots.push_back(slotIndex);
+        m_prefetchCondition.notify_all();
+        if (read->IsLast())
+            return;
+    }
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::StartAsyncPrefetching()
+{
+    if (!m_prefetch || m_prefetchRunning)
+        return;
+
+    m_freeSlots.clear();
+    for (size_t i = 0; i < m_prefetchSlots.size(); i++)
+        m_freeSlots.push_back(i);
+    m_readySlots.clear();
+    m_pendingRead.reset();
+    m_stopPrefetching = false;
+
+    m_prefetchRunning = true;
+    m_readerThread = std::thread([this]
+    {
+#ifndef CNTK_UWP
+        ProfilerSetThreadName("Reader Prefetch");
+#endif
+        ReaderStageLoop();
+    });
+    m_transferThread = std::thread([this]
+    {
+#ifndef CNTK_UWP
+        ProfilerSetThreadName("Reader Transfer");
+#endif
+        TransferStageLoop();
+    });
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::StopPrefetching()
+{
+    if (!m_prefetchRunning)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_prefetchMutex);
+        m_stopPrefetching = true;
+        m_prefetchCondition.notify_all();
     }
 
-    // Let's record that we started the copy, so that the main thread can wait afterwards.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->RecordCPUToGPUCopy();
+    // The stages finish the minibatch they are working on, including outstanding copies.
+    m_readerThread.join();
+    m_transferThread.join();
 
-    return PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, true };
+    m_pendingRead.reset();
+    m_readySlots.clear();
+    m_freeSlots.clear();
+    m_prefetchRunning = false;
+}
+
+template <class ElemType>
+size_t ReaderShim<ElemType>::GetNextPrefetchedSlot()
+{
+    auto& statistics = m_stageStatistics[ConsumerStage];
+    statistics.m_numMinibatches++;
+    if (!m_prefetch)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        ReadResult read = ReadMinibatch();
+        FillSlot(m_prefetchSlots.front(), read);
+        statistics.m_starvedSeconds += SecondsSince(startTime);
+        return 0;
+    }
+
+    StartAsyncPrefetching();
+
+    PROFILE_SCOPE(profilerEvtPrefetchWait);
+    std::unique_lock<std::mutex> lock(m_prefetchMutex);
+    auto startTime = std::chrono::steady_clock::now();
+    m_prefetchCondition.wait(lock, [this] { return !m_readySlots.empty(); });
+    statistics.m_starvedSeconds += SecondsSince(startTime);
+
+    size_t slotIndex = m_readySlots.front();
+    m_readySlots.pop_front();
+#ifndef CNTK_UWP
+    if (m_prefetchSlots[slotIndex].m_flowId)
+        ProfilerFlowEnd(m_prefetchSlots[slotIndex].m_flowId, profilerEvtPrefetchMinibatch);
+#endif
+    return slotIndex;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::ResetPrefetchStatistics()
+{
+    for (auto& statistics : m_stageStatistics)
+        statistics = PrefetchStageStatistics{ 0, 0.0, 0.0, 0.0 };
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::PrintPrefetchStatistics() const
+{
+    const auto& read = m_stageStatistics[ReadStage];
+    const auto& transfer = m_stageStatistics[TransferStage];
+    const auto& consumer = m_stageStatistics[ConsumerStage];
+    fprintf(stderr, "ReaderShim: %d minibatches, prefetch depth %d: "
+                    "read %.3fs busy, %.3fs blocked; transfer %.3fs busy, %.3fs starved, %.3fs blocked; GetMinibatch %.3fs starved.\n",
+            (int)consumer.m_numMinibatches, m_prefetch ? (int)m_prefetchDepth : 0,
+            read.m_busySeconds, read.m_blockedSeconds,
+            transfer.m_busySeconds, transfer.m_starvedSeconds, transfer.m_blockedSeconds,
+            consumer.m_starvedSeconds);
 }
 
 template <class ElemType>
@@ -474,14 +711,8 @@ void ReaderShim<ElemType>::SetState(const std::map<std::wstring, size_t>& state)
     if (m_currentState == state)
         return;
 
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.wait();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads; minibatches prefetched from the old position are dropped.
+    StopPrefetching();
 
     // Set current position.
     m_reader->SetState(state);
@@ -10,7 +10,11 @@
 
 #include <unordered_map>
 #include <string>
-#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include "DataReader.h"
 #include "Reader.h"
 
@@ -37,7 +41,10 @@ public:
     explicit ReaderShim(ReaderFactory factory);
     explicit ReaderShim(ReaderPtr reader);
 
-    virtual ~ReaderShim() { }
+    virtual ~ReaderShim()
+    {
+        StopPrefetching();
+    }
 
     virtual void Init(const Microsoft::MSR::ScriptableObjects::IConfigRecord& /*config*/) override
     {
@@ -48,14 +55,7 @@ public:
     virtual void Destroy() override
     {
         // Make sure there are no outstanding reads.
-        // Future destructor does not wait as of 2013 so probably it is not in VS2013:
-        // More info can be found here http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3679.html.
-        if (m_prefetchTask.valid())
-        {
-            // If there are some, give them time to finish.
-            m_prefetchTask.wait_for(std::chrono::seconds(60));
-            // TODO: if the prefetch is still valid, print a warning here!
-        }
+        StopPrefetching();
 
         delete this;
     }
@@ -116,8 +116,18 @@ public:
 
 private:
 
+    // Prefetching runs as a pipeline of two stages on dedicated threads:
+    //  - the reader stage calls m_reader->ReadMinibatch(), i.e. deserializes, transforms and packs the next minibatch;
+    //  - the transfer stage fills the matrices of a free prefetch slot from it, copying the data to the device.
+    // Filled slots are queued for GetMinibatch(), which swaps their matrices into the network.
+    // Up to m_prefetchDepth minibatches are prefetched, and the reader stage runs at most one minibatch ahead
+    // of the transfer stage, because the packer reuses its buffers every other minibatch.
     void StartAsyncPrefetching();
 
+    // Stops the pipeline and discards all prefetched minibatches.
+    // The reader is left at an arbitrary position; callers reset its state.
+    void StopPrefetching();
+
     struct PrefetchResult
     {
         bool m_isEndOfSweep;
@@ -125,9 +135,54 @@ private:
         bool m_isDataAvailable;
     };
 
-    PrefetchResult PrefetchMinibatch(size_t currentDataTransferIndex);
+    // Output of the reader stage.
+    struct ReadResult
+    {
+        Minibatch m_minibatch;
+        std::map<std::wstring, size_t> m_readerState; // reader state after this minibatch
+        std::vector<StreamInformation> m_streams;     // stream descriptions as of this minibatch
+        std::exception_ptr m_error;
+        unsigned long long m_flowId = 0;              // connects the stages of this minibatch in the profiler
+
+        // Last minibatch of the epoch, or failure; the pipeline stops after it.
+        bool IsLast() const { return m_error || m_minibatch.m_endOfEpoch || m_minibatch.m_data.empty(); }
+    };
+
+    // Data structure required for prefetch.
+    struct StreamPrefetchBuffer
+    {
+        std::shared_ptr<MSR_CNTK::Matrix<ElemType>> m_matrix;
+        MSR_CNTK::MBLayoutPtr m_mbLayout;
+        NDShape m_sampleShape;
+    };
+
+    // One prefetched minibatch, output of the transfer stage.
+    struct PrefetchSlot
+    {
+        // Buffers where the transfer stage puts the data to.
+        // When the main thread enters GetMinibatch it swaps the matrices from these buffers,
+        // and waits if memCpy is still in progress.
+        std::unordered_map<std::wstring, StreamPrefetchBuffer> m_buffers;
+
+        // Data transfer operations of this slot.
+        MSR_CNTK::DataTransfererPtr m_dataTransferer;
+
+        PrefetchResult m_result;
+        std::map<std::wstring, size_t> m_readerState;
+        std::function<std::string(size_t)> m_getKeyById;
+        std::exception_ptr m_error;
+        unsigned long long m_flowId = 0;
+    };
+
+    ReadResult ReadMinibatch();
+    void FillSlot(PrefetchSlot& slot, ReadResult& read);
+
+    void ReaderStageLoop();
+    void TransferStageLoop();
+
+    // Returns the index of the next prefetched slot; reads it synchronously if prefetch is disabled.
+    size_t GetNextPrefetchedSlot();
 
-    std::future<PrefetchResult> m_prefetchTask;
     ReaderPtr m_reader;
     ReaderFactory m_factory;
     bool m_endOfEpoch;
@@ -137,34 +192,47 @@ private:
 
     std::unordered_map<std::wstring, size_t> m_nameToStreamId;
 
+    // Only changed by the reader stage while prefetching.
     std::vector<StreamInformation> m_streams;
-    launch m_launchType;
 
-    // Data structure required for prefetch.
-    struct StreamPrefetchBuffer
+    // Whether minibatches are prefetched in the background, and how many (config key prefetchDepth).
+    static const size_t s_defaultPrefetchDepth = 2;
+    bool m_prefetch;
+    size_t m_prefetchDepth;
+    int m_verbosity;
+
+    std::vector<PrefetchSlot> m_prefetchSlots;
+    std::vector<std::wstring> m_prefetchedStreams; // names of the buffers of every slot, only changed by StartEpoch
+
+    // Pipeline state, guarded by m_prefetchMutex.
+    std::mutex m_prefetchMutex;
+    std::condition_variable m_prefetchCondition;
+    std::thread m_readerThread;
+    std::thread m_transferThread;
+    bool m_prefetchRunning;
+    bool m_stopPrefetching;
+    std::unique_ptr<ReadResult> m_pendingRead; // read, but not yet taken by the transfer stage
+    std::deque<size_t> m_freeSlots;
+    std::deque<size_t> m_readySlots;
+
+    // Time spent by the stages of the prefetch pipeline in the current epoch.
+    // A stage is starved when it waits for its input, and blocked when it waits for room to pass on its output.
+    struct PrefetchStageStatistics
     {
-        std::shared_ptr<MSR_CNTK::Matrix<ElemType>> m_matrix;
-        MSR_CNTK::MBLayoutPtr m_mbLayout;
-        NDShape m_sampleShape;
+        size_t m_numMinibatches;
+        double m_busySeconds;
+        double m_starvedSeconds;
+        double m_blockedSeconds;
     };
 
-    // Intermediate buffer where the prefetch thread puts its data to.
-    // When the main thread enters GetMinibatch it swaps the matrices from this buffer,
-    // triggers the next prefetch and waits if memCpy is still in progress.
-    std::unordered_map<std::wstring, StreamPrefetchBuffer> m_prefetchBuffers;
-
-    // Alternating data transfer operations. In the current version these are only two - 
-    // currently waiting on the main thread and the one that can be started by the prefetch thread 
-    // in the meantime.
-    std::vector<MSR_CNTK::DataTransfererPtr> m_dataTransferers;
+    enum PrefetchStage { ReadStage, TransferStage, ConsumerStage, NumPrefetchStages };
+    PrefetchStageStatistics m_stageStatistics[NumPrefetchStages];
+    void ResetPrefetchStatistics();
+    void PrintPrefetchStatistics() const;
 
     // Id to key mapping.
     std::function<std::string(size_t)> m_getKeyById;
 
-    // Current data transfer. Flips 0 and 1.
-    // Can be changed only from the main thread with no ongoing prefetch.
-    size_t m_currentDataTransferIndex; 
-
     // Device id.
     int m_deviceId;
 
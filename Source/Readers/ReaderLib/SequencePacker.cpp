@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #include "SequencePacker.h"
 #include "ReaderUtil.h"
+#include "PerformanceProfiler.h"
 
 namespace CNTK {
 
@@ -60,6 +61,8 @@ Minibatch SequencePacker::ReadMinibatch()
     auto sequences = m_sequenceEnumerator->GetNextSequences(m_globalMinibatchSizeInSamples, m_localMinibatchSizeInSamples);
     const auto& batch = sequences.m_data;
 
+    PROFILE_SCOPE(profilerEvtPackMinibatch);
+
     Minibatch minibatch(sequences.m_endOfSweep, sequences.m_endOfEpoch);
     if (batch.empty())
         return minibatch;
@@ -10,6 +10,7 @@
 #include "Transformer.h"
 #include "SequenceEnumerator.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
 
 namespace CNTK {
 
@@ -75,13 +76,22 @@ public:
     // applying transformers to particular streams.
     virtual Sequences GetNextSequences(size_t globalSampleCount, size_t localSampleCount) override
     {
+        using namespace Microsoft::MSR::CNTK;
+
         assert(m_sequenceProvider != nullptr);
-        Sequences sequences = m_sequenceProvider->GetNextSequences(globalSampleCount, localSampleCount);
+        Sequences sequences;
+        {
+            PROFILE_SCOPE(profilerEvtReadSequences);
+            sequences = m_sequenceProvider->GetNextSequences(globalSampleCount, localSampleCount);
+        }
+
         if (sequences.m_data.empty())
         {
             return sequences;
         }
 
+        PROFILE_SCOPE(profilerEvtTransformSequences);
+
         if (m_multiThreadedDeserialization)
         {
             ExceptionCapture capture;
@@ -19,6 +19,11 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) = 0;
 
+    // Called during backprop when the gradient with the given index (into the list passed to AggregateGradients()) is final,
+    // before AggregateGradients() is called for the minibatch. Aggregators may start to reduce it right away.
+    virtual void GradientReady(size_t /*gradientIndex*/)
+    {}
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
@@ -642,6 +642,12 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                       i + 1, learnRatePerSample, MomentumPerMB(momentumPerSample, actualMinibatchSize), momentumAsTimeConstant);
         }
 
+        if (m_nodeCostReport)
+        {
+            net->ResetNodeCostStatistics();
+            Globals::SetNodeCostProfiling(true);
+        }
+
         EpochCriterion epochCriterion; // criterion values are returned in this
         std::vector<EpochCriterion> epochEvalErrors(evaluationNodes.size());
         totalMBsSeen += TrainOneEpoch(net,
@@ -677,6 +683,18 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         for (size_t j = 0; j < epochEvalErrors.size(); j++)
             epochEvalErrors[j].LogCriterion(evaluationNodes[j]->NodeName());
         fprintf(stderr, "totalSamplesSeen = %zu; learningRatePerSample = %.8g; epochTime=%.6gs\n", totalTrainingSamplesSeen, learnRatePerSample, epochTime);
+
+        if (m_nodeCostReport)
+        {
+            Globals::SetNodeCostProfiling(false);
+
+            NodeCostRoofline roofline;
+            roofline.m_peakGFlops = m_nodeCostPeakGFlops;
+            roofline.m_peakGBps = m_nodeCostPeakGBps;
+            net->PrintNodeCostReport(roofline);
+            if (!m_nodeCostReportFile.empty() && ((m_mpi == nullptr) || m_mpi->IsMainNode()))
+                net->WriteNodeCostReport(msra::strfun::wstrprintf(L"%ls.%d", m_nodeCostReportFile.c_str(), (int)i + 1), roofline);
+        }
 #if 0
         // TODO: This was only printed if >1 eval criterion. Why? Needed?
         LOGPRINTF(stderr, "Finished Epoch[%2d of %d]:     Criterion Node [%ls] Per Sample = %.8g\n",
@@ -1034,6 +1052,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     }
 
     std::vector<Matrix<ElemType>*> learnParamsGradients;
+    std::unordered_map<ComputationNodeBasePtr, size_t> learnParamsGradientIndex; // [parameter node] -> index into learnParamsGradients
     Profiler profiler(m_numMBsToCUDAProfile);
 
     // resetting this, so profiling is performed for one epoch only
@@ -1255,8 +1274,26 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 // ===========================================================
 
                 if (learnRatePerSample > 0.01 * m_minLearnRate) // only compute gradient when learning rate is large enough
+                {
+                    // Without sub-minibatches, the gradient of a parameter is final as soon as backprop has passed it,
+                    // so the aggregator may start to reduce it while backprop continues.
+                    bool notifyGradientAggregator = useGradientAggregation && actualNumSubminibatches == 1 && !learnParamsGradientIndex.empty();
+                    if (notifyGradientAggregator)
+                    {
+                        net->SetParameterGradientReadyCallback([this, &learnParamsGradientIndex](const ComputationNodeBasePtr& node)
+                        {
+                            auto iter = learnParamsGradientIndex.find(node);
+                            if (iter != learnParamsGradientIndex.end())
+                                m_distGradAgg->GradientReady(iter->second);
+                        });
+                    }
+
                     net->Backprop(criterionNodes[0]);
 
+                    if (notifyGradientAggregator)
+                        net->SetParameterGradientReadyCallback(nullptr);
+                }
+
                 // house-keeping for sub-minibatching
                 if (actualNumSubminibatches > 1)
                     smbDispatcher.DoneWithCurrentSubMinibatch(ismb); // page state out
@@ -1320,6 +1357,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                             currParamsGradient->Resize(currParamsValues->GetNumRows(), currParamsValues->GetNumCols());
                         }
 
+                        learnParamsGradientIndex[*nodeIter] = learnParamsGradients.size();
                         learnParamsGradients.push_back(currParamsGradient);
                     }
                 }
@@ -2290,9 +2328,12 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
         if (traceLevel > 0)
             fprintf(stderr, "Initializing dataParallelSGD with FP%d aggregation.\n", numGradientBits);
         if (Globals::UseV2Aggregator()) // Currently used to check V2 against baselines.
+        {
+            ::CNTK::Internal::SetMPIAllReduceAlgorithm(MPIAllReduceAlgorithmName(m_allReduceAlgorithm));
             m_distGradAgg = std::make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, ::CNTK::MPICommunicator(m_packThresholdSizeInBytes));
+        }
         else
-            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes);
+            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes, m_gradientBucketSizeInBytes, m_allReduceAlgorithm);
     }
 
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
@@ -2923,6 +2964,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numSubminiBatches = configSGD(L"numSubminibatches", (size_t) 1);
 
     m_packThresholdSizeInBytes = configSGD(L"packThresholdSizeInKB", DEFAULT_PACK_THRESHOLD_SIZE_IN_KB) * 1024;
+    m_gradientBucketSizeInBytes = configSGD(L"gradientBucketSizeInKB", DEFAULT_GRADIENT_BUCKET_SIZE_IN_KB) * 1024;
 
     if (configAALR.Exists(L"numMiniBatch4LRSearch"))
     {
@@ -2993,6 +3035,13 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_seqGammarCalcWP = configSGD(L"seqGammarWordPen", 0.0);
     m_disableRegInBatchNormalization = configSGD(L"disableRegInBatchNormalization", false);
 
+    // Per-node cost report: time, estimated FLOPs and bytes of every node. Peaks of the device, if given, add the roofline.
+    // Note: this synchronizes the device around every node, so it slows down training on GPUs.
+    m_nodeCostReport = configSGD(L"nodeCostReport", false);
+    m_nodeCostReportFile = static_cast<std::wstring>(configSGD(L"nodeCostReportFile", L""));
+    m_nodeCostPeakGFlops = configSGD(L"nodeCostPeakGFlops", 0.0);
+    m_nodeCostPeakGBps = configSGD(L"nodeCostPeakGBps", 0.0);
+
     m_dropoutRates = configSGD(L"dropoutRate", ConfigRecordType::Array(doubleargvector(vector<double>{0.0})));
     m_batchNormalizationTimeConstant = configSGD(L"batchNormalizationTimeConstant", ConfigRecordType::Array(doubleargvector(vector<double>{0})));
     m_batchNormalizationBlendTimeConstant = configSGD(L"batchNormalizationBlendTimeConstant", ConfigRecordType::Array(doubleargvector(vector<double>{0})));
@@ -3140,6 +3189,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = vector<int>{8 * (int)sizeofElemType}; // means no quantization
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_allReduceAlgorithm = MPIAllReduceAlgorithm::Default;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
@@ -3173,6 +3223,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_numGradientBits = configDataParallelSGD(L"gradientBits", ConfigRecordType::Array(intargvector(vector<int>{defaultGradientBits})));
             m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
             m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+            m_allReduceAlgorithm = ParseMPIAllReduceAlgorithm(configDataParallelSGD(L"allReduceAlgorithm", L"mpi"));
             for (size_t i = 0; i < m_numGradientBits.size(); i++)
             {
                 if (m_numGradientBits[i] < 1 || m_numGradientBits[i] > defaultGradientBits)
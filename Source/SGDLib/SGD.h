@@ -232,6 +232,8 @@ protected:
 
     // Threshold size in bytes for single gradient to do packing
     size_t m_packThresholdSizeInBytes;
+    // Maximum size in bytes of a run of adjacent gradients that is reduced with one MPI call
+    size_t m_gradientBucketSizeInBytes;
 
     LearningRateSearchAlgorithm m_autoLearnRateSearchType;
 
@@ -310,6 +312,7 @@ protected:
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    MPIAllReduceAlgorithm m_allReduceAlgorithm;
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
@@ -344,6 +347,12 @@ protected:
     // true: disable Regularization
     // false: enable Regularization (default)
     bool m_disableRegInBatchNormalization;
+
+    // per-node cost report (see NodeCostReport.h), printed after every epoch and optionally written as JSON
+    bool m_nodeCostReport;
+    std::wstring m_nodeCostReportFile;
+    double m_nodeCostPeakGFlops;
+    double m_nodeCostPeakGBps;
 };
 
 template <class ElemType>
@@ -16,6 +16,7 @@
 #include "GPUDataTransferer.h"
 #include "TimerUtility.h"
 #include "MatrixQuantizerImpl.h"
+#include "GradientBuckets.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -25,9 +26,11 @@ class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
     UsingIDistGradAggregatorMembers;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace, size_t packThresholdSizeInBytes = DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES)
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace, size_t packThresholdSizeInBytes = DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES,
+                             size_t gradientBucketSizeInBytes = DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES, MPIAllReduceAlgorithm allReduceAlgorithm = MPIAllReduceAlgorithm::Default)
         : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace),
-        m_iterationCount(0), m_packThresholdSizeInBytes(packThresholdSizeInBytes)
+        m_iterationCount(0), m_packThresholdSizeInBytes(packThresholdSizeInBytes), m_gradientBucketSizeInBytes(gradientBucketSizeInBytes), m_overlapBuckets(false), m_numBucketsStarted(0),
+        m_allReduceAlgorithm(allReduceAlgorithm)
     {}
 
     ~SimpleDistGradAggregator()
@@ -135,7 +138,59 @@ public:
         }
     }
 
+    // Starts the reduction of a bucket as soon as all its gradients are ready, if the gradients are on the CPU.
+    void GradientReady(size_t gradientIndex) override
+    {
+        if (!m_overlapBuckets || gradientIndex >= m_bucketOfGradient.size())
+            return;
+
+        size_t bucket = m_bucketOfGradient[gradientIndex];
+        if (bucket == (size_t)-1 || m_pendingGradientsOfBucket[bucket] == 0)
+            return;
+
+        m_pendingGradientsOfBucket[bucket]--;
+
+        // MPI requires all workers to start collective operations in the same order, so the buckets are started in the order of their addresses
+        while (m_numBucketsStarted < m_buckets.size() && m_pendingGradientsOfBucket[m_numBucketsStarted] == 0)
+            StartBucketReduction(m_numBucketsStarted++);
+    }
+
 private:
+    // The matrix to reduce for an entry of m_gradientIndexToAggregate: a gradient, the packing buffer (-1), or a bucket (indices following the gradients).
+    Matrix<ElemType>* AggregationMatrix(const std::vector<Matrix<ElemType>*>& gradients, size_t i) const
+    {
+        if (i == (size_t)-1)
+            return m_aggregationBuffer.get();
+        else if (i >= gradients.size())
+            return m_buckets[i - gradients.size()].get();
+        else
+            return gradients[i];
+    }
+
+    void StartBucketReduction(size_t bucket)
+    {
+        ElemType* data = m_buckets[bucket]->Data();
+        if (m_allReduceAlgorithm != MPIAllReduceAlgorithm::Default)
+        {
+            m_mpi->AllReduce(static_cast<ElemType*>(MPI_IN_PLACE), data, m_buckets[bucket]->GetNumElements(), MPI_SUM, m_allReduceAlgorithm);
+            m_bucketRequests[bucket] = MPI_REQUEST_NULL;
+            return;
+        }
+
+        m_mpi->Iallreduce(MPI_IN_PLACE, data, m_buckets[bucket]->GetNumElements(), MPIWrapper::GetDataType(data), MPI_SUM, &m_bucketRequests[bucket]) || MpiFail("MPI_Iallreduce");
+    }
+
+    void ResetBucketState()
+    {
+        m_pendingGradientsOfBucket.assign(m_buckets.size(), 0);
+        for (size_t bucket : m_bucketOfGradient)
+        {
+            if (bucket != (size_t)-1)
+                m_pendingGradientsOfBucket[bucket]++;
+        }
+        m_numBucketsStarted = 0;
+    }
+
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
         assert(deviceID >= 0);
@@ -175,9 +230,43 @@ private:
                 m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
             }
 
+            // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                if (gradients[i]->GetMatrixType() != DENSE)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+            }
+
+            // Gradients that are adjacent in memory, e.g. because the network allocated them in one buffer, are reduced in place
+            // as buckets, without packing. With async aggregation the gradients are swapped with buffered ones, so they can't be used.
+            m_bucketOfGradient.assign(gradients.size(), (size_t)-1);
+            if (!m_useAsyncAggregation)
+            {
+                std::vector<std::pair<const void*, size_t>> buffers;
+                for (size_t i = 0; i < gradients.size(); i++)
+                    buffers.push_back(std::make_pair((const void*)gradients[i]->Data(), sizeof(ElemType) * gradients[i]->GetNumElements()));
+
+                for (const auto& bucket : FormGradientBuckets(buffers, m_gradientBucketSizeInBytes))
+                {
+                    m_buckets.push_back(std::make_unique<Matrix<ElemType>>(1, bucket.m_sizeInBytes / sizeof(ElemType), (ElemType*)bucket.m_data, deviceId, matrixFlagDontOwnBuffer));
+                    for (size_t i : bucket.m_items)
+                        m_bucketOfGradient[i] = m_buckets.size() - 1;
+                }
+                m_bucketRequests.resize(m_buckets.size());
+                ResetBucketState();
+
+                // On the CPU, buckets are reduced with non-blocking MPI calls that can be started during backprop (see GradientReady()).
+                // The other all-reduce algorithms are blocking, so they are not started during backprop.
+                m_overlapBuckets = !m_buckets.empty() && (deviceId == CPUDEVICE) && !m_nccl->IsSupported() && (m_mpi->UseGpuGdr() == 0) &&
+                                   (m_allReduceAlgorithm == MPIAllReduceAlgorithm::Default);
+            }
+
             size_t packedGradientsSizeInElements = 0;
             for (size_t i = 0; i < gradients.size(); i++)
             {
+                if (m_bucketOfGradient[i] != (size_t)-1)
+                    continue;
+
                 if (!m_useAsyncAggregation && sizeof(ElemType) * gradients[i]->GetNumElements() <= m_packThresholdSizeInBytes)
                 {
                     packedGradientsSizeInElements += gradients[i]->GetNumElements();
@@ -188,10 +277,6 @@ private:
                     m_gradientIndexToAggregate.push_back(i);
                 }
 
-                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
-                if (gradients[i]->GetMatrixType() != DENSE)
-                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
-
                 if (m_useAsyncAggregation)
                     m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
             }
@@ -211,7 +296,8 @@ private:
                 // Reuse "@param m_gradientIndexToAggregate" for following code, if no continous buffer allocated
                 for (size_t i = 0; i < gradients.size(); i++)
                 {
-                    m_gradientIndexToAggregate.push_back(i);
+                    if (m_bucketOfGradient[i] == (size_t)-1)
+                        m_gradientIndexToAggregate.push_back(i);
                 }
             }
             else
@@ -220,13 +306,16 @@ private:
                 m_gradientIndexToAggregate.insert(m_gradientIndexToAggregate.begin(), 1, (size_t)-1);
             }
 
+            // The buckets come first, in the order in which GradientReady() starts them
+            for (size_t bucket = 0; bucket < m_buckets.size(); bucket++)
+                m_gradientIndexToAggregate.insert(m_gradientIndexToAggregate.begin() + bucket, gradients.size() + bucket);
+
             if (ShouldCopyDataToCPU(deviceId))
             {
                 for (size_t i : m_gradientIndexToAggregate)
                 {
                     m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId,
-                        (i == -1) ? packedGradientsSizeInElements : gradients[i]->GetNumElements()));
+                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, AggregationMatrix(gradients, i)->GetNumElements()));
                 }
             }
 
@@ -279,6 +368,10 @@ private:
             for (int i = 0; i < headerCPU->numEvalNode; ++i)
                 assert(headerCPU->evalErrors[i].first == 0 && headerCPU->evalErrors[i].second == 0);
 
+            // Buckets are only started early by backprop, which always has samples
+            if (m_numBucketsStarted > 0)
+                LogicError("Gradient aggregation: buckets were reduced during backprop, but no samples were processed.");
+
             // If the current node did not process any samples, the gradients should be zero'd
             for (size_t i = 0; i < numGradMatrices; ++i)
                 gradients[i]->SetValue(0);
@@ -328,22 +421,14 @@ private:
             // non-GDR && GPU && non-NCCL: need to copy data from GPU to CPU
             if ((m_mpi->UseGpuGdr() == 0) && (deviceId != CPUDEVICE) && !m_nccl->IsSupported())
             {
-                Matrix<ElemType>* gpuCopyBuffer = m_aggregationBuffer.get();
-
                 ElemType* reductionBuffer;
                 // currentGradientIndex will load the index from m_gradientIndexToAggregate
                 size_t currentGradientIndex = m_gradientIndexToAggregate[0];
                 size_t nextGradientIndex = 0; // 0 is for initialization only
                 // Get the first Gradient, and do async D-to-H copy
-                if (currentGradientIndex != -1)
-                {
-                    gpuCopyBuffer = gradients[currentGradientIndex];
-                }
-                else
-                {
-                    // currentGradientIndex == -1, first element is for packed gradients, which should not be with AsyncAggregation
-                    assert(m_useAsyncAggregation == false);
-                }
+                // (packed gradients and buckets, which are not used with AsyncAggregation, come first)
+                Matrix<ElemType>* gpuCopyBuffer = AggregationMatrix(gradients, currentGradientIndex);
+                assert(!m_useAsyncAggregation || gpuCopyBuffer == gradients[currentGradientIndex]);
                 // First sync_g_to_c_copy
                 // TODO: we need a CopyGPUToCPUSync
                 #ifndef CPUONLY
@@ -357,15 +442,7 @@ private:
                     if (i < numGradientIndex)
                     {
                         nextGradientIndex = m_gradientIndexToAggregate[i];
-                        if (nextGradientIndex != -1)
-                        {
-                            gpuCopyBuffer = gradients[nextGradientIndex];
-                        }
-                        else
-                        {
-                            // currentGradientIndex == -1, first element is for packed gradients, which should not be with AsyncAggregation
-                            assert(m_useAsyncAggregation == false);
-                        }
+                        gpuCopyBuffer = AggregationMatrix(gradients, nextGradientIndex);
                         // Async D-to-H copy (next gradient)
                         m_gpuDataTransferers[gpuToCpuIndex]->CopyGPUToCPUAsync(gpuCopyBuffer->Data(), gpuCopyBuffer->GetNumElements(), m_intermediateCPUBuffers[gpuToCpuIndex].get());
                     }
@@ -374,13 +451,12 @@ private:
                     
                     // Allreduce
                     reductionBuffer = m_intermediateCPUBuffers[allReduceIndex].get();
-                    m_mpi->AllReduce(reductionBuffer, (currentGradientIndex == -1) ? m_aggregationBuffer->GetNumElements() : gradients[currentGradientIndex]->GetNumElements());
+                    Matrix<ElemType>* currentMatrix = AggregationMatrix(gradients, currentGradientIndex);
+                    m_mpi->AllReduce(static_cast<ElemType*>(MPI_IN_PLACE), reductionBuffer, currentMatrix->GetNumElements(), MPI_SUM, m_allReduceAlgorithm);
 
                     // Create async H-to-G copy
                     cpuToGpuIndex = allReduceIndex;
-                    m_gpuDataTransferers[cpuToGpuIndex]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[cpuToGpuIndex].get(),
-                        (currentGradientIndex == -1) ? m_aggregationBuffer->GetNumElements() : gradients[currentGradientIndex]->GetNumElements(),
-                        (currentGradientIndex == -1) ? m_aggregationBuffer->Data() : gradients[currentGradientIndex]->Data());
+                    m_gpuDataTransferers[cpuToGpuIndex]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[cpuToGpuIndex].get(), currentMatrix->GetNumElements(), currentMatrix->Data());
                     allReduceIndex = gpuToCpuIndex;
                     gpuToCpuIndex ++;
                     currentGradientIndex = nextGradientIndex;
@@ -392,19 +468,31 @@ private:
                 ElemType* reductionBuffer;
                 for (size_t i : m_gradientIndexToAggregate)
                 {
-                    allReduceRequests.push_back(MPI_Request());
-                    reductionBuffer = (i == -1)? m_aggregationBuffer->Data() : gradients[i]->Data();
+                    Matrix<ElemType>* reductionMatrix = AggregationMatrix(gradients, i);
+                    reductionBuffer = reductionMatrix->Data();
                     // CPU
                     if (m_mpi->UseGpuGdr() == 0)
                     {
-                        m_mpi->Iallreduce(MPI_IN_PLACE, reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements(),
-                            MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, &allReduceRequests.back()) || MpiFail("MPI_Iallreduce");
+                        // Buckets have their own requests; those that were started during backprop are in flight already
+                        if (i != (size_t)-1 && i >= gradients.size())
+                        {
+                            if (i - gradients.size() == m_numBucketsStarted)
+                                StartBucketReduction(m_numBucketsStarted++);
+                            continue;
+                        }
+
+                        allReduceRequests.push_back(MPI_REQUEST_NULL);
+                        if (m_allReduceAlgorithm != MPIAllReduceAlgorithm::Default)
+                            m_mpi->AllReduce(static_cast<ElemType*>(MPI_IN_PLACE), reductionBuffer, reductionMatrix->GetNumElements(), MPI_SUM, m_allReduceAlgorithm);
+                        else
+                            m_mpi->Iallreduce(MPI_IN_PLACE, reductionBuffer, reductionMatrix->GetNumElements(),
+                                MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, &allReduceRequests.back()) || MpiFail("MPI_Iallreduce");
                         allReduceIndex++;
                     }
                     // GDR && GPU
                     else if (deviceId != CPUDEVICE)
                     {
-                        m_mpi->AllReduce(reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements());
+                        m_mpi->AllReduce(reductionBuffer, reductionMatrix->GetNumElements());
                     }
                 }
             } 
@@ -413,7 +501,7 @@ private:
                 std::vector<Matrix<ElemType>*> ncclReduceGradients;
                 for (size_t i : m_gradientIndexToAggregate)
                 {
-                    ncclReduceGradients.push_back((i == -1) ? m_aggregationBuffer.get() : gradients[i]);
+                    ncclReduceGradients.push_back(AggregationMatrix(gradients, i));
                 }
                 m_nccl->AllReduce(ncclReduceGradients);
             }
@@ -462,7 +550,13 @@ private:
             {
                 m_mpi->Wait(&allReduceRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
             }
+
+            for (size_t i = 0; i < m_numBucketsStarted; i++)
+            {
+                m_mpi->Wait(&m_bucketRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            }
         }
+        ResetBucketState();
 
         // Copy data back to the packed gradients from the continous buffer
         offset = 0;
@@ -509,6 +603,19 @@ private:
     std::vector<size_t> m_packedGradientsIndex;
     std::vector<size_t> m_gradientIndexToAggregate;
 
+    // Runs of gradients that are adjacent in memory (see FormGradientBuckets()) are reduced in place instead, each with a single MPI call.
+    // The buckets are views of the memory of their gradients.
+    const size_t m_gradientBucketSizeInBytes;
+    std::vector<std::unique_ptr<Matrix<ElemType>>> m_buckets;
+    std::vector<size_t> m_bucketOfGradient;         // index of the bucket of each gradient, or -1
+    std::vector<size_t> m_pendingGradientsOfBucket; // number of gradients of each bucket that are not ready yet in the current minibatch
+    std::vector<MPI_Request> m_bucketRequests;
+    bool m_overlapBuckets;                          // buckets may be started from GradientReady()
+    size_t m_numBucketsStarted;                     // buckets 0..m_numBucketsStarted-1 are being reduced in the current minibatch
+
+    // Algorithm of the MPI all-reduce of the gradients on the CPU; the algorithms other than the default one are blocking.
+    const MPIAllReduceAlgorithm m_allReduceAlgorithm;
+
     int m_syncStatsTrace;
 
     // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
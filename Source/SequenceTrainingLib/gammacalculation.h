@@ -8,6 +8,7 @@
 #include "Matrix.h"
 #include "CUDAPageLockedMemAllocator.h"
 
+#include <exception>
 #include <memory>
 #include <vector>
 
@@ -99,9 +100,6 @@ public:
     {
         // check total frame number to be added ?
         // int deviceid = loglikelihood.GetDeviceId();
-        size_t boundaryframenum;
-        std::vector<size_t> validframes; // [s] cursor pointing to next utterance begin within a single parallel sequence [s]
-        validframes.assign(samplesInRecurrentStep, 0);
         ElemType objectValue = 0.0;
         // convert from Microsoft::MSR::CNTK::Matrix to  msra::math::ssematrixbase
         size_t numrows = loglikelihood.GetNumRows();
@@ -118,134 +116,63 @@ public:
         if (doreferencealign)
             labels.SetValue((ElemType)(0.0f));
 
-        size_t T = numcols / samplesInRecurrentStep; // number of time steps in minibatch
-        if (samplesInRecurrentStep > 1)
-        {
-            assert(extrauttmap.size() == lattices.size());
-            assert(T == pMBLayout->GetNumTimeSteps());
-        }
+        // determine where each utterance is located in the minibatch
+        std::vector<utterancelayout> layouts;
+        getutterancelayouts(lattices, samplesInRecurrentStep, pMBLayout, extrauttmap, numcols, layouts);
 
-        size_t mapi = 0; // parallel-sequence index for utterance [i]
-        // cal gamma for each utterance
-        size_t ts = 0;
-        for (size_t i = 0; i < lattices.size(); i++)
+        if (!parallellattice.enabled())
         {
-            const size_t numframes = lattices[i]->getnumframes();
-
-            msra::dbn::matrixstripe predstripe(pred, ts, numframes);           // logLLs for this utterance
-            msra::dbn::matrixstripe dengammasstripe(dengammas, ts, numframes); // denominator gammas
-
-            if (samplesInRecurrentStep == 1) // no sequence parallelism
+            // CPU: the lattices are independent, so we process the utterances of the minibatch concurrently.
+            // Copying between the CNTK matrices and the SSE matrices uses shared buffers and stays sequential.
+            // With a single utterance, the parallel region is inactive, so the per-edge loops inside forwardbackward() run in parallel instead.
+            for (size_t i = 0; i < lattices.size(); i++)
+                copyloglikelihoods(loglikelihood, layouts[i], samplesInRecurrentStep, tempmatrix);
+
+            std::vector<double> numavlogps(lattices.size());
+            std::vector<double> denavlogps(lattices.size());
+            std::exception_ptr error; // first exception thrown by any of the threads
+#pragma omp parallel for schedule(dynamic) if (lattices.size() > 1)
+            for (int i = 0; i < (int) lattices.size(); i++)
             {
-                tempmatrix = loglikelihood.ColumnSlice(ts, numframes);
-                // if (m_deviceid == CPUDEVICE)
-                {
-                    CopyFromCNTKMatrixToSSEMatrix(tempmatrix, numframes, predstripe);
-                }
-
-                if (m_deviceid != CPUDEVICE)
-                    parallellattice.setloglls(tempmatrix);
-            }
-            else // multiple parallel sequences
-            {
-                // get number of frames for the utterance
-                mapi = extrauttmap[i]; // parallel-sequence index; in case of >1 utterance within this parallel sequence, this is in order of concatenation
-
-                // scan MBLayout for end of utterance
-                size_t mapframenum = SIZE_MAX; // duration of utterance [i] as determined from MBLayout
-                for (size_t t = validframes[mapi]; t < T; t++)
-                {
-                    // TODO: Adapt this to new MBLayout, m_sequences would be easier to work off.
-                    if (pMBLayout->IsEnd(mapi, t))
-                    {
-                        mapframenum = t - validframes[mapi] + 1;
-                        break;
-                    }
-                }
-
-                // must match the explicit information we get from the reader
-                if (numframes != mapframenum)
-                    LogicError("gammacalculation: IsEnd() not working, numframes (%d) vs. mapframenum (%d)", (int) numframes, (int) mapframenum);
-                assert(numframes == mapframenum);
-
-                if (numframes > tempmatrix.GetNumCols())
-                    tempmatrix.Resize(numrows, numframes);
-
-                Microsoft::MSR::CNTK::Matrix<ElemType> loglikelihoodForCurrentParallelUtterance = loglikelihood.ColumnSlice(mapi + (validframes[mapi] * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
-                tempmatrix.CopyColumnsStrided(loglikelihoodForCurrentParallelUtterance, numframes, samplesInRecurrentStep, 1);
-
-                // if (doreferencealign || m_deviceid == CPUDEVICE)
+                try
                 {
-                    CopyFromCNTKMatrixToSSEMatrix(tempmatrix, numframes, predstripe);
+                    denavlogps[i] = forwardbackwardutterance(*lattices[i], layouts[i], uids, boundaries, doreferencealign, numavlogps[i]);
                 }
-
-                if (m_deviceid != CPUDEVICE)
+                catch (...)
                 {
-                    parallellattice.setloglls(tempmatrix);
+#pragma omp critical(gammacalculationerror)
+                    if (!error)
+                        error = std::current_exception();
                 }
             }
+            if (error)
+                std::rethrow_exception(error);
 
-            array_ref<size_t> uidsstripe(&uids[ts], numframes);
-
-            if (doreferencealign)
-            {
-                boundaryframenum = numframes;
-            }
-            else
-                boundaryframenum = 0;
-            array_ref<size_t> boundariesstripe(&boundaries[ts], boundaryframenum);
-
-            double numavlogp = 0;
-            foreach_column (t, dengammasstripe) // we do not allocate memory for numgamma now, should be the same as numgammasstripe
+            for (size_t i = 0; i < lattices.size(); i++)
             {
-                const size_t s = uidsstripe[t];
-                numavlogp += predstripe(s, t) / amf;
+                objectValue += (ElemType)((numavlogps[i] - denavlogps[i]) * layouts[i].numframes);
+                copygammas(gammafromlattice, layouts[i], samplesInRecurrentStep, tempmatrix);
+                if (doreferencealign)
+                    setreferencelabels(labels, layouts[i], uids, samplesInRecurrentStep);
+                fprintf(stderr, "dengamma value %f\n", denavlogps[i]);
             }
-            numavlogp /= numframes;
-
-            // auto_timer dengammatimer;
-            double denavlogp = lattices[i]->second.forwardbackward(parallellattice,
-                                                                   (const msra::math::ssematrixbase&) predstripe, (const msra::asr::simplesenonehmm&) m_hset,
-                                                                   (msra::math::ssematrixbase&) dengammasstripe, (msra::math::ssematrixbase&) gammasbuffer /*empty, not used*/,
-                                                                   lmf, wp, amf, boostmmifactor, seqsMBRmode, uidsstripe, boundariesstripe);
-
-            objectValue += (ElemType)((numavlogp - denavlogp) * numframes);
-
-            if (samplesInRecurrentStep == 1)
-            {
-                tempmatrix = gammafromlattice.ColumnSlice(ts, numframes);
-            }
-
-            // copy gamma to tempmatrix
-            if (m_deviceid == CPUDEVICE)
+        }
+        else
+        {
+            // GPU: the lattice state holds a single utterance at a time
+            for (size_t i = 0; i < lattices.size(); i++)
             {
-                CopyFromSSEMatrixToCNTKMatrix(dengammas, numrows, numframes, tempmatrix, gammafromlattice.GetDeviceId());
-            }
-            else
-                parallellattice.getgamma(tempmatrix);
+                copyloglikelihoods(loglikelihood, layouts[i], samplesInRecurrentStep, tempmatrix);
 
-            // set gamma for multi channel
-            if (samplesInRecurrentStep > 1)
-            {
-                Microsoft::MSR::CNTK::Matrix<ElemType> gammaFromLatticeForCurrentParallelUtterance = gammafromlattice.ColumnSlice(mapi + (validframes[mapi] * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
-                gammaFromLatticeForCurrentParallelUtterance.CopyColumnsStrided(tempmatrix, numframes, 1, samplesInRecurrentStep);
-            }
+                double numavlogp = 0;
+                double denavlogp = forwardbackwardutterance(*lattices[i], layouts[i], uids, boundaries, doreferencealign, numavlogp);
+                objectValue += (ElemType)((numavlogp - denavlogp) * layouts[i].numframes);
 
-            if (doreferencealign)
-            {
-                for (size_t nframe = 0; nframe < numframes; nframe++)
-                {
-                    size_t uid = uidsstripe[nframe];
-                    if (samplesInRecurrentStep > 1)
-                        labels(uid, (nframe + validframes[mapi]) * samplesInRecurrentStep + mapi) = 1.0;
-                    else
-                        labels(uid, ts + nframe) = 1.0;
-                }
+                copygammas(gammafromlattice, layouts[i], samplesInRecurrentStep, tempmatrix);
+                if (doreferencealign)
+                    setreferencelabels(labels, layouts[i], uids, samplesInRecurrentStep);
+                fprintf(stderr, "dengamma value %f\n", denavlogp);
             }
-            if (samplesInRecurrentStep > 1)
-                validframes[mapi] += numframes; // advance the cursor within the parallel sequence
-            fprintf(stderr, "dengamma value %f\n", denavlogp);
-            ts += numframes;
         }
         functionValues.SetValue(objectValue);
     }
@@ -276,8 +203,8 @@ public:
         const size_t numRows = prob.GetNumRows();
         const size_t numCols = prob.GetNumCols();
         m_deviceid = prob.GetDeviceId();
-        Microsoft::MSR::CNTK::Matrix<ElemType> matrixPhoneSeqs(CPUDEVICE);
-        Microsoft::MSR::CNTK::Matrix<ElemType> matrixPhoneBounds(CPUDEVICE);
+        auto& matrixPhoneSeqs = GetCTCBuffer(m_ctcPhoneSeqs, CPUDEVICE);
+        auto& matrixPhoneBounds = GetCTCBuffer(m_ctcPhoneBounds, CPUDEVICE);
         std::vector<std::vector<size_t>> allUttPhoneSeqs;
         std::vector<std::vector<size_t>> allUttPhoneBounds;
         int maxPhoneNum = 0;
@@ -370,12 +297,12 @@ public:
         matrixPhoneBounds.TransferFromDeviceToDevice(CPUDEVICE, m_deviceid);
 
         // compute alpha, beta and CTC scores
-        Microsoft::MSR::CNTK::Matrix<ElemType> alpha(m_deviceid);
-        Microsoft::MSR::CNTK::Matrix<ElemType> beta(m_deviceid);
+        auto& alpha = GetCTCBuffer(m_ctcAlpha, m_deviceid);
+        auto& beta = GetCTCBuffer(m_ctcBeta, m_deviceid);
         CTCPosterior.AssignCTCScore(prob, alpha, beta, matrixPhoneSeqs, matrixPhoneBounds, totalScore, uttToChanInd, uttBeginFrame,
             uttFrameNum, uttPhoneNum, numParallelSequences, mbsize, blankTokenId, delayConstraint, /*isColWise=*/true );
         
-        Microsoft::MSR::CNTK::Matrix<ElemType> rowSum(m_deviceid);
+        auto& rowSum = GetCTCBuffer(m_ctcRowSum, m_deviceid);
         rowSum.Resize(1, numCols);
 
         // Normalize the CTC scores
@@ -384,6 +311,171 @@ public:
     }
 
 private:
+    // location of an utterance of the minibatch
+    struct utterancelayout
+    {
+        size_t ts;        // first column in pred and dengammas, and first entry in uids and boundaries
+        size_t numframes;
+        size_t mapi;      // parallel-sequence index (if more than one parallel sequence)
+        size_t tbegin;    // first time step within the parallel sequence
+    };
+
+    // Determines the location of each utterance: with sequence parallelism, an utterance occupies every
+    // samplesInRecurrentStep-th column of the minibatch, starting at the end of the previous utterance of the same parallel sequence.
+    static void getutterancelayouts(const std::vector<std::shared_ptr<const msra::dbn::latticepair>>& lattices, size_t samplesInRecurrentStep,
+                                    const std::shared_ptr<Microsoft::MSR::CNTK::MBLayout>& pMBLayout, const std::vector<size_t>& extrauttmap,
+                                    size_t numcols, std::vector<utterancelayout>& layouts)
+    {
+        std::vector<size_t> validframes; // [s] cursor pointing to next utterance begin within a single parallel sequence [s]
+        validframes.assign(samplesInRecurrentStep, 0);
+
+        size_t T = numcols / samplesInRecurrentStep; // number of time steps in minibatch
+        if (samplesInRecurrentStep > 1)
+        {
+            assert(extrauttmap.size() == lattices.size());
+            assert(T == pMBLayout->GetNumTimeSteps());
+        }
+
+        layouts.resize(lattices.size());
+        size_t ts = 0;
+        for (size_t i = 0; i < lattices.size(); i++)
+        {
+            const size_t numframes = lattices[i]->getnumframes();
+            auto& layout = layouts[i];
+            layout.ts = ts;
+            layout.numframes = numframes;
+            layout.mapi = 0;
+            layout.tbegin = 0;
+
+            if (samplesInRecurrentStep > 1) // multiple parallel sequences
+            {
+                // get number of frames for the utterance
+                size_t mapi = extrauttmap[i]; // parallel-sequence index; in case of >1 utterance within this parallel sequence, this is in order of concatenation
+
+                // scan MBLayout for end of utterance
+                size_t mapframenum = SIZE_MAX; // duration of utterance [i] as determined from MBLayout
+                for (size_t t = validframes[mapi]; t < T; t++)
+                {
+                    // TODO: Adapt this to new MBLayout, m_sequences would be easier to work off.
+                    if (pMBLayout->IsEnd(mapi, t))
+                    {
+                        mapframenum = t - validframes[mapi] + 1;
+                        break;
+                    }
+                }
+
+                // must match the explicit information we get from the reader
+                if (numframes != mapframenum)
+                    LogicError("gammacalculation: IsEnd() not working, numframes (%d) vs. mapframenum (%d)", (int) numframes, (int) mapframenum);
+                assert(numframes == mapframenum);
+
+                layout.mapi = mapi;
+                layout.tbegin = validframes[mapi];
+                validframes[mapi] += numframes; // advance the cursor within the parallel sequence
+            }
+            ts += numframes;
+        }
+    }
+
+    // Copies the loglikelihoods of an utterance into its stripe of pred and, on the GPU, into the lattice state.
+    void copyloglikelihoods(const Microsoft::MSR::CNTK::Matrix<ElemType>& loglikelihood, const utterancelayout& layout, size_t samplesInRecurrentStep,
+                            Microsoft::MSR::CNTK::Matrix<ElemType>& tempmatrix)
+    {
+        const size_t numframes = layout.numframes;
+        msra::dbn::matrixstripe predstripe(pred, layout.ts, numframes); // logLLs for this utterance
+
+        if (samplesInRecurrentStep == 1) // no sequence parallelism
+        {
+            tempmatrix = loglikelihood.ColumnSlice(layout.ts, numframes);
+        }
+        else // multiple parallel sequences
+        {
+            if (numframes > tempmatrix.GetNumCols())
+                tempmatrix.Resize(loglikelihood.GetNumRows(), numframes);
+
+            Microsoft::MSR::CNTK::Matrix<ElemType> loglikelihoodForCurrentParallelUtterance = loglikelihood.ColumnSlice(layout.mapi + (layout.tbegin * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
+            tempmatrix.CopyColumnsStrided(loglikelihoodForCurrentParallelUtterance, numframes, samplesInRecurrentStep, 1);
+        }
+
+        // if (doreferencealign || m_deviceid == CPUDEVICE)
+        {
+            CopyFromCNTKMatrixToSSEMatrix(tempmatrix, numframes, predstripe);
+        }
+
+        if (m_deviceid != CPUDEVICE)
+            parallellattice.setloglls(tempmatrix);
+    }
+
+    // Runs the lattice forward-backward of an utterance, writing its denominator gammas into its stripe of dengammas.
+    // Returns the average lattice log-likelihood, and the average log-likelihood of the reference alignment in numavlogp.
+    // Only touches the stripes of the utterance, so different utterances can be processed concurrently on the CPU.
+    double forwardbackwardutterance(const msra::dbn::latticepair& latticepair, const utterancelayout& layout,
+                                    std::vector<size_t>& uids, std::vector<size_t>& boundaries, bool doreferencealign, double& numavlogp)
+    {
+        const size_t numframes = layout.numframes;
+        msra::dbn::matrixstripe predstripe(pred, layout.ts, numframes);           // logLLs for this utterance
+        msra::dbn::matrixstripe dengammasstripe(dengammas, layout.ts, numframes); // denominator gammas
+
+        array_ref<size_t> uidsstripe(&uids[layout.ts], numframes);
+        size_t boundaryframenum = doreferencealign ? numframes : 0;
+        array_ref<size_t> boundariesstripe(&boundaries[layout.ts], boundaryframenum);
+
+        numavlogp = 0;
+        foreach_column (t, dengammasstripe) // we do not allocate memory for numgamma now, should be the same as numgammasstripe
+        {
+            const size_t s = uidsstripe[t];
+            numavlogp += predstripe(s, t) / amf;
+        }
+        numavlogp /= numframes;
+
+        // gammasbuffer is shared by all utterances; it is not used on the CPU
+        // auto_timer dengammatimer;
+        return latticepair.second.forwardbackward(parallellattice,
+                                                  (const msra::math::ssematrixbase&) predstripe, (const msra::asr::simplesenonehmm&) m_hset,
+                                                  (msra::math::ssematrixbase&) dengammasstripe, (msra::math::ssematrixbase&) gammasbuffer /*empty, not used*/,
+                                                  lmf, wp, amf, boostmmifactor, seqsMBRmode, uidsstripe, boundariesstripe);
+    }
+
+    // Copies the denominator gammas of an utterance into gammafromlattice.
+    void copygammas(Microsoft::MSR::CNTK::Matrix<ElemType>& gammafromlattice, const utterancelayout& layout, size_t samplesInRecurrentStep,
+                    Microsoft::MSR::CNTK::Matrix<ElemType>& tempmatrix)
+    {
+        const size_t numframes = layout.numframes;
+        if (samplesInRecurrentStep == 1)
+        {
+            tempmatrix = gammafromlattice.ColumnSlice(layout.ts, numframes);
+        }
+
+        // copy gamma to tempmatrix
+        if (m_deviceid == CPUDEVICE)
+        {
+            msra::dbn::matrixstripe dengammasstripe(dengammas, layout.ts, numframes);
+            CopyFromSSEMatrixToCNTKMatrix(dengammasstripe, dengammas.rows(), numframes, tempmatrix, gammafromlattice.GetDeviceId());
+        }
+        else
+            parallellattice.getgamma(tempmatrix);
+
+        // set gamma for multi channel
+        if (samplesInRecurrentStep > 1)
+        {
+            Microsoft::MSR::CNTK::Matrix<ElemType> gammaFromLatticeForCurrentParallelUtterance = gammafromlattice.ColumnSlice(layout.mapi + (layout.tbegin * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
+            gammaFromLatticeForCurrentParallelUtterance.CopyColumnsStrided(tempmatrix, numframes, 1, samplesInRecurrentStep);
+        }
+    }
+
+    // Sets the one-hot labels of the reference alignment of an utterance.
+    static void setreferencelabels(Microsoft::MSR::CNTK::Matrix<ElemType>& labels, const utterancelayout& layout, const std::vector<size_t>& uids, size_t samplesInRecurrentStep)
+    {
+        for (size_t nframe = 0; nframe < layout.numframes; nframe++)
+        {
+            size_t uid = uids[layout.ts + nframe];
+            if (samplesInRecurrentStep > 1)
+                labels(uid, (nframe + layout.tbegin) * samplesInRecurrentStep + layout.mapi) = 1.0;
+            else
+                labels(uid, layout.ts + nframe) = 1.0;
+        }
+    }
+
     // Helper methods for copying between ssematrix objects and CNTK matrices
     void CopyFromCNTKMatrixToSSEMatrix(const Microsoft::MSR::CNTK::Matrix<ElemType>& src, size_t numCols, msra::math::ssematrixbase& dest)
     {
@@ -511,6 +603,23 @@ protected:
     bool seqsMBRmode;
 
 private:
+    // Returns the buffer, which is (re)created if it does not exist yet or is on another device.
+    static Microsoft::MSR::CNTK::Matrix<ElemType>& GetCTCBuffer(std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>>& buffer, int deviceId)
+    {
+        if (!buffer || buffer->GetDeviceId() != deviceId)
+            buffer.reset(new Microsoft::MSR::CNTK::Matrix<ElemType>(deviceId));
+        return *buffer;
+    }
+
+    // Buffers of doCTC(), kept across minibatches so that they are only reallocated when the minibatch grows.
+    // The phone sequences and boundaries are built on the CPU; if the network runs on a GPU, they are moved
+    // there and recreated for the next minibatch.
+    std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_ctcAlpha;
+    std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_ctcBeta;
+    std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_ctcRowSum;
+    std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_ctcPhoneSeqs;
+    std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_ctcPhoneBounds;
+
     std::unique_ptr<Microsoft::MSR::CNTK::CUDAPageLockedMemAllocator> m_cudaAllocator;
     std::shared_ptr<ElemType> m_intermediateCUDACopyBuffer;
     size_t m_intermediateCUDACopyBufferSize;
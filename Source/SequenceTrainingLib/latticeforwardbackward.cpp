@@ -15,6 +15,7 @@
 #include <unordered_map>
 #include <list>
 #include <stdexcept>
+#include <exception>
 
 using namespace std;
 
@@ -517,6 +518,13 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
     logbetas.assign(nodes.size(), LOGZERO);
     logbetas.back() = 0.0f;
 
+    // the edge scores do not depend on the alphas and betas; compute them once for both passes,
+    // in a loop the compiler can vectorize, so that the passes only do the log-adds
+    std::vector<double> edgescores(edges.size());
+    const int numedges = (int) edges.size();
+    for (int j = 0; j < numedges; j++)
+        edgescores[j] = (edges[j].l * lmf + wp + edgeacscores[j]) / amf; // note: edgeacscores[j] == LOGZERO if edge was pruned
+
     // --- sMBR version
 
     if (sMBRmode)
@@ -528,6 +536,22 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
         std::vector<double> logaccbetas(nodes.size(), LOGZERO);  // [i] likewise
         std::vector<double> logframescorrectedge(edges.size());  // raw counts of correct frames in each edge
 
+        // count the correct frames of each edge; the edges are independent, so this runs in parallel
+#pragma omp parallel for schedule(static, 256)
+        for (int j = 0; j < numedges; j++)
+        {
+            if (islogzero(edgeacscores[j])) // indicates that this edge is pruned
+                continue;
+            const auto &e = edges[j];
+            size_t ts = nodes[e.S].t;
+            size_t te = nodes[e.E].t;
+            const auto edgealignment = thisedgealignments[j];
+            size_t framescorrect = 0; // count raw number of correct frames
+            for (size_t t = ts; t < te; t++)
+                framescorrect += (edgealignment[t - ts] == uids[t]);
+            logframescorrectedge[j] = (framescorrect > 0) ? log((double) framescorrect) : LOGZERO; // remember for backward pass
+        }
+
         // forward pass
         foreach_index (j, edges)
         {
@@ -535,16 +559,10 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
                 continue;
             const auto &e = edges[j];
             const double inscore = logalphas[e.S];
-            const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf;
+            const double edgescore = edgescores[j];
             const double pathscore = inscore + edgescore;
             logadd(logalphas[e.E], pathscore);
 
-            size_t ts = nodes[e.S].t;
-            size_t te = nodes[e.E].t;
-            size_t framescorrect = 0; // count raw number of correct frames
-            for (size_t t = ts; t < te; t++)
-                framescorrect += (thisedgealignments[j][t - ts] == uids[t]);
-            logframescorrectedge[j] = (framescorrect > 0) ? log((double) framescorrect) : LOGZERO; // remember for backward pass
             double loginaccs = logaccalphas[e.S] - logalphas[e.S];
             logadd(loginaccs, logframescorrectedge[j]);
             double logpathacc = loginaccs + logalphas[e.S] + edgescore;
@@ -568,7 +586,7 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
                 continue;
             const auto &e = edges[j];
             const double inscore = logbetas[e.E];
-            const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf;
+            const double edgescore = edgescores[j];
             const double pathscore = inscore + edgescore;
             logadd(logbetas[e.S], pathscore);
 
@@ -610,7 +628,7 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
     {
         const auto &e = edges[j];
         const double inscore = logalphas[e.S];
-        const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf; // note: edgeacscores[j] == LOGZERO if edge was pruned
+        const double edgescore = edgescores[j];
         const double pathscore = inscore + edgescore;
         logadd(logalphas[e.E], pathscore);
     }
@@ -627,7 +645,7 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
     {
         const auto &e = edges[j];
         const double inscore = logbetas[e.E];
-        const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf;
+        const double edgescore = edgescores[j];
         const double pathscore = inscore + edgescore;
         logadd(logbetas[e.S], pathscore);
 
@@ -952,26 +970,51 @@ void lattice::forwardbackwardalign(parallelstate &parallelstate,
             parallelstate.getedgeacscores(edgeacscoresgpu);
             parallelstate.copyalignments(thisedgealignmentsgpu);
         }
-        foreach_index (j, edges)
+
+        // The edges are independent (each has its own abcs matrix and alignment range), so they are processed in parallel.
+        // The alignment storage is allocated up front, since edgealignments::operator[] would do that lazily on first use.
+        thisedgealignments.getalignmentsbuffer().resize(thisedgealignments.getalignoffsets().back());
+        std::exception_ptr error; // first exception thrown by any of the threads
+        const int numedges = (int) edges.size();
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int j = 0; j < numedges; j++)
         {
-            const edgeinfowithscores &e = edges[j];
-            const size_t ts = nodes[e.S].t;
-            const size_t te = nodes[e.E].t;
-            if (ts == te) // dummy !NULL edge at end
-                edgeacscores[j] = 0.0f;
-            else
+            try
             {
-                const auto &aligntokens = getaligninfo(j); // get alignment tokens
-                const auto edgeLLs = msra::math::ssematrixstriperef<msra::math::ssematrixbase>(const_cast<msra::math::ssematrixbase &>(logLLs), ts, te - ts);
-                if (minlogpp > LOGZERO && origlogpps[j] < minlogpp)
-                    edgeacscores[j] = LOGZERO; // will kill word level forwardbackward hypothesis
-                else if (softalignstates)
-                    edgeacscores[j] = forwardbackwardedge(aligntokens, hset, edgeLLs, *abcs[j], j);
+                const edgeinfowithscores &e = edges[j];
+                const size_t ts = nodes[e.S].t;
+                const size_t te = nodes[e.E].t;
+                if (ts == te) // dummy !NULL edge at end
+                    edgeacscores[j] = 0.0f;
                 else
-                    edgeacscores[j] = alignedge(aligntokens, hset, edgeLLs, *abcs[j], j, returnsenoneids, thisedgealignments[j]);
+                {
+                    const auto &aligntokens = getaligninfo(j); // get alignment tokens
+                    const auto edgeLLs = msra::math::ssematrixstriperef<msra::math::ssematrixbase>(const_cast<msra::math::ssematrixbase &>(logLLs), ts, te - ts);
+                    if (minlogpp > LOGZERO && origlogpps[j] < minlogpp)
+                        edgeacscores[j] = LOGZERO; // will kill word level forwardbackward hypothesis
+                    else if (softalignstates)
+                        edgeacscores[j] = forwardbackwardedge(aligntokens, hset, edgeLLs, *abcs[j], j);
+                    else
+                        edgeacscores[j] = alignedge(aligntokens, hset, edgeLLs, *abcs[j], j, returnsenoneids, thisedgealignments[j]);
+                }
             }
-            if (cpuverification)
+            catch (...)
             {
+#pragma omp critical(forwardbackwardalignerror)
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+
+        if (cpuverification) // compare with the GPU results
+        {
+            foreach_index (j, edges)
+            {
+                const edgeinfowithscores &e = edges[j];
+                const size_t ts = nodes[e.S].t;
+                const size_t te = nodes[e.E].t;
                 const auto &aligntokens = getaligninfo(j); // get alignment tokens
                 bool edgehassil = false;
                 foreach_index (i, aligntokens)
@@ -1059,7 +1102,10 @@ void lattice::mmierrorsignal(parallelstate &parallelstate, double minlogpp, cons
         return;
     }
 
-    for (size_t j = 0; j < (errorsignal).cols(); j++)
+    // the loops over the whole matrix are done in parallel over the frames
+    const int numframes = (int) errorsignal.cols();
+#pragma omp parallel for
+    for (int j = 0; j < numframes; j++)
         for (size_t i = 0; i < (errorsignal).rows(); i++)
             errorsignal(i, j) = VIRGINLOGZERO; // set to zero  --note: may be in-place with logLLs, which now get overwritten
 
@@ -1130,8 +1176,10 @@ void lattice::mmierrorsignal(parallelstate &parallelstate, double minlogpp, cons
     fprintf(stderr, "forwardbackward: %.3f%% non-zero state posteriors\n", 100.0f - nonzerostates * 100.0f / errorsignal.rows() / errorsignal.cols());
 
     // convert to non-log posterior  --that's what we return
-    foreach_coord (i, j, errorsignal)
-        errorsignal(i, j) = expf(errorsignal(i, j));
+#pragma omp parallel for
+    for (int j = 0; j < numframes; j++)
+        for (size_t i = 0; i < (errorsignal).rows(); i++)
+            errorsignal(i, j) = expf(errorsignal(i, j));
 }
 
 // compute ground truth's score
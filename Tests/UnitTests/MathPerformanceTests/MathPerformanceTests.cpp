@@ -9,6 +9,7 @@
 //#include "Windows.h"
 #include "Matrix.h"
 #include "CPUMatrix.h"
+#include "CPUTensorSimd.h"
 #include "TensorView.h"
 #include "Sequences.h"
 #include <chrono>
@@ -279,6 +280,63 @@ struct TensorTest
     }
 };
 
+// Benchmark of the vectorized CPU tensor-op kernels (CPUTensorSimd.h) against the scalar loops they replace,
+// for the elementwise ops and reductions that dominate training of feed-forward networks.
+// Each op runs once with CPUMatrix<float>::OPT_SIMD_TENSOR_OPS cleared (before) and once with it set (after),
+// and the two results are compared.
+template <class ElemType>
+void ElementwiseTensorOpSimdBenchmark(size_t layerDim, size_t minibatchSize, int repetitions)
+{
+    cout << "Vectorized tensor ops, layer " << layerDim << " x minibatch " << minibatchSize << ", CPU SIMD level " << (int)GetSupportedCPUSimdLevel() << endl;
+
+    mt19937 rng(1);
+    uniform_real_distribution<float> nd(-3, 3);
+    auto createTensor = [&](const TensorShape& shape)
+    {
+        vector<ElemType> init(shape.GetNumElements());
+        generate(begin(init), end(init), [&] { return (ElemType)nd(rng); });
+        return TensorView<ElemType>(make_shared<Matrix<ElemType>>(init.size(), 1, init.data(), CPUDEVICE), shape);
+    };
+    let layerShape = TensorShape(layerDim, minibatchSize);
+    let a = createTensor(layerShape);
+    let b = createTensor(layerShape);
+    let bias = createTensor(TensorShape(layerDim));
+    auto layerResult = createTensor(layerShape);
+    auto biasResult = createTensor(TensorShape(layerDim));
+    auto columnResult = createTensor(TensorShape(1, minibatchSize));
+
+    let flags = CPUMatrix<float>::GetOptimizationFlags();
+    auto benchmark = [&](const char* what, TensorView<ElemType>& result, double tolerance, const function<void()>& fn)
+    {
+        double seconds[2];
+        vector<Matrix<ElemType>> results;
+        for (int simd = 0; simd < 2; simd++)
+        {
+            CPUMatrix<float>::SetOptimizationFlags(simd ? (flags | CPUMatrix<float>::OPT_SIMD_TENSOR_OPS) : (flags & ~CPUMatrix<float>::OPT_SIMD_TENSOR_OPS));
+            fn(); // warm up
+            auto start = chrono::high_resolution_clock::now();
+            for (int i = 0; i < repetitions; i++)
+                fn();
+            seconds[simd] = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count() / repetitions;
+            results.push_back(result.GetSOB().DeepClone());
+        }
+        let isSame = results[0].IsEqualTo(results[1], (ElemType)tolerance);
+        fprintf(stdout, "  %-36s before %9.3f ms  after %9.3f ms  speedup %5.2fx%s\n", what, seconds[0] * 1000, seconds[1] * 1000,
+                seconds[0] / seconds[1], isSame ? "" : "  RESULTS DIFFER");
+    };
+
+    benchmark("Sigmoid",                     layerResult,  1e-5, [&] { layerResult.AssignSigmoidOf(a); });
+    benchmark("Tanh",                        layerResult,  1e-5, [&] { layerResult.AssignTanhOf(a); });
+    benchmark("ReLU",                        layerResult,  0,    [&] { layerResult.AssignLinearRectifierOf(a); });
+    benchmark("bias addition (broadcasting)", layerResult, 0,    [&] { layerResult.AssignSumOf(a, bias); });
+    benchmark("Sigmoid gradient",            layerResult,  1e-5, [&] { layerResult.AssignElementwiseProductWithSigmoidDerivativeFromOutputOf(a, b); });
+    benchmark("bias gradient (Sum reduction)", biasResult, 1e-3, [&] { biasResult.DoCopyOf(0, layerResult, 1); });
+    benchmark("ReduceMax over layer",        columnResult, 0,    [&] { columnResult.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opMax); });
+    benchmark("ReduceLogSum over layer",     columnResult, 1e-4, [&] { columnResult.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opLogSum); });
+
+    CPUMatrix<float>::SetOptimizationFlags(flags);
+}
+
 template <class ElemType>
 void MandSTest(int count, int devId)
 {
@@ -338,6 +396,9 @@ void MandSTest(int count, int devId)
 
 int wmain()
 {
+    ElementwiseTensorOpSimdBenchmark<float>(2048, 256, 20);
+    ElementwiseTensorOpSimdBenchmark<float>(512, 64, 200);
+
     // MandSTest<float>(100, 2);
 
     /*cout<<endl<<"********************Matrix SquareMultiplyAndWeightedAdd10TimesAvg TEST********************"<<endl;
@@ -1215,6 +1215,99 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixGatherFromTarget, RandomSeedFixture)
     BOOST_CHECK(m2.IsEqualTo(expect, 1e-6));
 }
 
+// Probability of a label sequence by summing over all frame alignments, for checking the CTC forward-backward
+static double BruteForceCTCProbability(const DMatrix& logProb, size_t channel, size_t numChannels, size_t numFrames, size_t blank, const std::vector<size_t>& labels)
+{
+    size_t numClasses = logProb.GetNumRows();
+    std::vector<size_t> path(numFrames, 0);
+    double total = 0;
+    for (;;)
+    {
+        std::vector<size_t> collapsed;
+        double logp = 0;
+        for (size_t t = 0; t < numFrames; t++)
+        {
+            logp += logProb(path[t], t * numChannels + channel);
+            if (path[t] != blank && (t == 0 || path[t] != path[t - 1]))
+                collapsed.push_back(path[t]);
+        }
+        if (collapsed == labels)
+            total += exp(logp);
+
+        size_t t = 0;
+        while (t < numFrames && ++path[t] == numClasses)
+            path[t++] = 0;
+        if (t == numFrames)
+            return total;
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixCTCScore, RandomSeedFixture)
+{
+    const size_t numClasses = 3, blank = 2, numChannels = 2, numFrames = 5;
+    const double lzero = LZERO;
+
+    // channel 0 holds one utterance of 5 frames, channel 1 one of 3 frames starting at frame 1
+    std::vector<size_t> uttToChanInd = { 0, 1 }, uttBeginFrame = { 0, 1 }, uttFrameNum = { 5, 3 };
+    std::vector<std::vector<size_t>> labels = { { 0, 1 }, { 0, 0 } };
+
+    DMatrix logProb(numClasses, numChannels * numFrames);
+    logProb.SetUniformRandomValue(0.1, 1.0, IncrementCounter());
+    for (size_t j = 0; j < logProb.GetNumCols(); j++)
+    {
+        double sum = 0;
+        for (size_t i = 0; i < numClasses; i++)
+            sum += logProb(i, j);
+        for (size_t i = 0; i < numClasses; i++)
+            logProb(i, j) = log(logProb(i, j) / sum);
+    }
+
+    // label sequences with blanks, in the layout built by GammaCalculation::doCTC()
+    std::vector<size_t> uttPhoneNum;
+    size_t maxPhoneNum = 0;
+    for (const auto& l : labels)
+    {
+        uttPhoneNum.push_back(2 * l.size() + 3);
+        maxPhoneNum = std::max(maxPhoneNum, uttPhoneNum.back());
+    }
+    DMatrix phoneSeq(maxPhoneNum, labels.size()), phoneBound(maxPhoneNum, labels.size());
+    phoneSeq.SetValue(0);
+    phoneBound.SetValue(0);
+    for (size_t u = 0; u < labels.size(); u++)
+    {
+        phoneSeq(0, u) = phoneSeq(uttPhoneNum[u] - 1, u) = (double) SIZE_MAX;
+        for (size_t s = 1; s + 1 < uttPhoneNum[u]; s++)
+            phoneSeq(s, u) = (double) (s % 2 ? blank : labels[u][s / 2 - 1]);
+        phoneBound(uttPhoneNum[u] - 2, u) = phoneBound(uttPhoneNum[u] - 1, u) = (double) uttFrameNum[u];
+    }
+
+    DMatrix alpha(maxPhoneNum, logProb.GetNumCols()), beta(maxPhoneNum, logProb.GetNumCols()), posterior(numClasses, logProb.GetNumCols());
+    alpha.SetValue(lzero);
+    beta.SetValue(lzero);
+    posterior.SetValue(lzero);
+    DMatrix totalScore(1, 1);
+    posterior.AssignCTCScore(logProb, alpha, beta, phoneSeq, phoneBound, totalScore, uttToChanInd, uttBeginFrame, uttFrameNum,
+                             uttPhoneNum, numChannels, numFrames, blank, /*delayConstraint=*/-1, /*isColWise=*/true);
+
+    double expectedScore = 0;
+    for (size_t u = 0; u < labels.size(); u++)
+    {
+        DMatrix uttLogProb = logProb.ColumnSlice(uttBeginFrame[u] * numChannels, uttFrameNum[u] * numChannels);
+        expectedScore -= log(BruteForceCTCProbability(uttLogProb, uttToChanInd[u], numChannels, uttFrameNum[u], blank, labels[u]));
+
+        // the label posteriors of each frame sum to 1
+        for (size_t t = 0; t < uttFrameNum[u]; t++)
+        {
+            size_t j = (uttBeginFrame[u] + t) * numChannels + uttToChanInd[u];
+            double sum = 0;
+            for (size_t i = 0; i < numClasses; i++)
+                sum += posterior(i, j);
+            BOOST_CHECK_CLOSE(sum, 1.0, 1e-6);
+        }
+    }
+    BOOST_CHECK_CLOSE(totalScore(0, 0), expectedScore, 1e-6);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -195,6 +195,172 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixOneHot, RandomSeedFixture)
     BOOST_CHECK(sm3(4, 3) == 1);
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndWeightedAddParallel, RandomSeedFixture)
+{
+    // large enough for the products to be computed on multiple threads
+    const size_t k = 300;
+    const size_t n = 120;
+    const size_t m = 64;
+
+    DenseMatrix dmSparse(k, n);
+    dmSparse.SetUniformRandomValue(-9, 1, IncrementCounter());
+    dmSparse.InplaceTruncateBottom(0);
+
+    SparseMatrix sm(MatrixFormat::matrixFormatSparseCSC, k, n, 0);
+    foreach_coord(row, col, dmSparse)
+    {
+        if (dmSparse(row, col) != 0)
+        {
+            sm.SetValue(row, col, dmSparse(row, col));
+        }
+    }
+
+    // test the full matrix as well as a slice view
+    const size_t start = 17;
+    const size_t numCols = 70;
+    SparseMatrix smSlice = sm.ColumnSlice(start, numCols);
+    DenseMatrix dmSlice = dmSparse.ColumnSlice(start, numCols);
+
+    for (int slice = 0; slice < 2; slice++)
+    {
+        const SparseMatrix& s = slice ? smSlice : sm;
+        const DenseMatrix& d = slice ? dmSlice : dmSparse;
+        for (int transposeDense = 0; transposeDense < 2; transposeDense++)
+        {
+            for (int transposeSparse = 0; transposeSparse < 2; transposeSparse++)
+            {
+                // dense * sparse
+                const size_t inner = transposeSparse ? d.GetNumCols() : d.GetNumRows();
+                DenseMatrix a = transposeDense ? DenseMatrix(inner, m) : DenseMatrix(m, inner);
+                a.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+                const size_t outer = transposeSparse ? d.GetNumRows() : d.GetNumCols();
+                DenseMatrix expected(m, outer);
+                expected.SetUniformRandomValue(-1, 1, IncrementCounter());
+                DenseMatrix actual(expected);
+
+                DenseMatrix::MultiplyAndWeightedAdd(0.5, a, !!transposeDense, d, !!transposeSparse, 2, expected);
+                SparseMatrix::MultiplyAndWeightedAdd(0.5, a, !!transposeDense, s, !!transposeSparse, 2, actual);
+                BOOST_CHECK(actual.IsEqualTo(expected, c_epsilonFloatE4));
+
+                // sparse * dense
+                DenseMatrix b = transposeDense ? DenseMatrix(m, inner) : DenseMatrix(inner, m);
+                b.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+                DenseMatrix expected2(outer, m);
+                DenseMatrix actual2(outer, m);
+                DenseMatrix::MultiplyAndWeightedAdd(1, d, !transposeSparse, b, !!transposeDense, 0, expected2);
+                SparseMatrix::MultiplyAndWeightedAdd(1, s, !transposeSparse, b, !!transposeDense, 0, actual2);
+                BOOST_CHECK(actual2.IsEqualTo(expected2, c_epsilonFloatE4));
+            }
+        }
+
+        // dense * sparse^T accumulated into a sparse block-column matrix, as used for the gradient of an embedding
+        DenseMatrix a(m, d.GetNumCols());
+        a.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+        DenseMatrix expected(m, d.GetNumRows());
+        expected.SetValue(0);
+        SparseMatrix actual(MatrixFormat::matrixFormatSparseBlockCol, m, d.GetNumRows(), 0);
+        for (int pass = 0; pass < 2; pass++)
+        {
+            DenseMatrix::MultiplyAndWeightedAdd(1, a, false, d, true, 1, expected);
+            SparseMatrix::MultiplyAndAdd(1, a, false, s, true, actual);
+        }
+        foreach_coord(row, col, expected)
+        {
+            BOOST_CHECK(abs(actual(row, col) - expected(row, col)) < c_epsilonFloatE4);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixTransposedIndex, RandomSeedFixture)
+{
+    const size_t m = 40;
+    const size_t n = 30;
+
+    DenseMatrix dm(m, n);
+    dm.SetUniformRandomValue(-4, 1, IncrementCounter());
+    dm.InplaceTruncateBottom(0);
+    dm(m - 1, n - 1) = 0; // set below to change the structure
+
+    SparseMatrix sm(MatrixFormat::matrixFormatSparseCSC, m, n, 0);
+    foreach_coord(row, col, dm)
+    {
+        if (dm(row, col) != 0)
+        {
+            sm.SetValue(row, col, dm(row, col));
+        }
+    }
+
+    // enumerating the nonzeros by row must visit each of them once, in row-major order
+    auto index = sm.GetTransposedIndex();
+    BOOST_CHECK_EQUAL(index->rowStarts.size(), index->rows.size() + 1);
+    BOOST_CHECK_EQUAL((size_t)index->rowStarts.back(), sm.NzCount());
+    DenseMatrix rebuilt(m, n);
+    rebuilt.SetValue(0);
+    for (size_t i = 0; i < index->rows.size(); i++)
+    {
+        BOOST_CHECK(i == 0 || index->rows[i] > index->rows[i - 1]);
+        for (auto q = index->rowStarts[i]; q < index->rowStarts[i + 1]; q++)
+        {
+            BOOST_CHECK(q == index->rowStarts[i] || index->columns[q] > index->columns[q - 1]);
+            BOOST_CHECK_EQUAL(rebuilt(index->rows[i], index->columns[q]), 0);
+            rebuilt(index->rows[i], index->columns[q]) = sm.NzValues()[index->nzPositions[q]];
+        }
+    }
+    BOOST_CHECK(rebuilt.IsEqualTo(dm, c_epsilonFloatE4));
+
+    // the index is reused as long as the structure is the same, and rebuilt when it changes
+    BOOST_CHECK(sm.GetTransposedIndex() == index);
+    sm.SetValue(m - 1, n - 1, 5);
+    auto index2 = sm.GetTransposedIndex();
+    BOOST_CHECK(index2 != index);
+    BOOST_CHECK_EQUAL(index2->rows.back(), (CPUSPARSE_INDEX_TYPE)(m - 1));
+    BOOST_CHECK_EQUAL((size_t)index2->rowStarts.back(), sm.NzCount());
+
+    // the index held by a caller is not affected by the rebuild
+    BOOST_CHECK_EQUAL((size_t)index->rowStarts.back(), sm.NzCount() - 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixTransposedIndexConcurrentSlices, RandomSeedFixture)
+{
+    const size_t m = 40;
+    const size_t n = 30;
+
+    DenseMatrix dm(m, n);
+    dm.SetUniformRandomValue(-4, 1, IncrementCounter());
+    dm.InplaceTruncateBottom(0);
+
+    SparseMatrix sm(MatrixFormat::matrixFormatSparseCSC, m, n, 0);
+    foreach_coord(row, col, dm)
+    {
+        if (dm(row, col) != 0)
+        {
+            sm.SetValue(row, col, dm(row, col));
+        }
+    }
+
+    // two column slices share the storage, and with it the cached index, so concurrent callers
+    // keep replacing each other's index; each must still get a complete index of its own slice
+    const SparseMatrix slices[2] = { sm.ColumnSlice(0, n / 2), sm.ColumnSlice(n / 2, n - n / 2) };
+    size_t expectedNzCounts[2];
+    for (int s = 0; s < 2; s++)
+        expectedNzCounts[s] = slices[s].NzCount();
+
+    const int numCalls = 200;
+    int numErrors = 0;
+#pragma omp parallel for num_threads(4) reduction(+ : numErrors)
+    for (int call = 0; call < numCalls; call++)
+    {
+        const SparseMatrix& slice = slices[call % 2];
+        auto index = slice.GetTransposedIndex();
+        if ((size_t)index->rowStarts.back() != expectedNzCounts[call % 2] || index->cscColStarts.size() != slice.GetNumCols() + 1)
+            numErrors++;
+    }
+    BOOST_CHECK_EQUAL(numErrors, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -283,6 +283,87 @@ BOOST_AUTO_TEST_CASE(ConvolutionForward)
     }
 }
 
+// The Winograd, direct and autotuned CPU engines are checked against the CPU reference engine, so this test does not need a GPU.
+// Without autotuning, the CPU engine must give exactly the results of the GEMM engine.
+BOOST_AUTO_TEST_CASE(ConvolutionForwardCPUEngines)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    std::vector<ConvolveGeometryPtr> geometries = GenerateConvTestConfigs();
+    // ResNet-like 3x3 convolutions with several channels, with and without padding.
+    for (bool pad : {false, true})
+    {
+        geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(11, 9, 8),
+            TensorShape(3, 3, 8), TensorShape(6), TensorShape(1, 1, 8),
+            ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{pad, pad, false},
+            TensorShape(0), TensorShape(0)));
+    }
+    // Explicit asymmetric padding.
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(9, 7, 4),
+        TensorShape(3, 3, 4), TensorShape(5), TensorShape(1, 1, 4),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(1, 2, 0), TensorShape(1, 0, 0)));
+
+    for (auto engKind : {ConvolutionEngineKind::Direct, ConvolutionEngineKind::Winograd, ConvolutionEngineKind::AllWithAutotuning, ConvolutionEngineKind::All})
+    {
+        for (size_t maxTempMem : {0, 2})
+        {
+            for (const auto& g : geometries)
+            {
+                const auto& kernT = g->KernelShape();
+                bool isWinogradGeometry = g->InputShape().GetRank() == 3 && kernT[0] == 3 && kernT[1] == 3 && g->GetStride(0) == 1 && g->GetStride(1) == 1;
+                // Engines that do not support a geometry refuse it in Create.
+                if (engKind == ConvolutionEngineKind::Winograd && !isWinogradGeometry)
+                    continue;
+                if (engKind == ConvolutionEngineKind::Direct && g->InputShape().GetRank() != 3)
+                    continue;
+
+                bool exact = engKind == ConvolutionEngineKind::All;
+                auto baseEng = exact ? ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Gemm)
+                                     : ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+                auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, engKind);
+
+                size_t n = batchSizeG(rng);
+                vec buf(g->InputShape().GetNumElements() * n);
+                std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+                SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), CPUDEVICE, matrixFlagNormal);
+
+                size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+                buf.resize(g->KernelShape().GetNumElements() * mapCount);
+                std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+                SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), CPUDEVICE, matrixFlagNormal);
+
+                size_t crowOut = g->OutputShape().GetNumElements();
+                SingleMatrix out(crowOut, n, CPUDEVICE);
+                out.SetValue(std::numeric_limits<float>::quiet_NaN());
+                SingleMatrix outB(crowOut, n, CPUDEVICE);
+
+                SingleMatrix workspace(CPUDEVICE);
+                SingleMatrix workspaceB(CPUDEVICE);
+
+                // The second call runs with the engine chosen by the autotuner in the first one.
+                for (int pass = 0; pass < 2; pass++)
+                {
+                    testEng->Forward(in, kernel, out, workspace);
+                    baseEng->Forward(in, kernel, outB, workspaceB);
+
+                    std::stringstream tmsg;
+                    tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", Engine: " << (int)engKind << ", MaxTempMem: " << maxTempMem << ", Pass: " << pass;
+                    std::string emsg;
+
+                    BOOST_REQUIRE_MESSAGE(!out.HasNan("out"), "out has NaNs, " << tmsg.str());
+                    // Winograd F(4x4, 3x3) is less accurate than the other algorithms.
+                    float relErr = exact ? 0 : Err<float>::Rel * 100;
+                    float absErr = exact ? 0 : Err<float>::Abs * 1000;
+                    BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr, absErr), "out are not equal, " << tmsg.str() << ". " << emsg);
+                }
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(ConvolutionBackwardData)
 {
     std::mt19937 rng(0);
@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "../../../Source/Math/QuantizedOperations.h"
 #include "../../../Source/Math/Helpers.h"
+#include <random>
 
 using namespace Microsoft::MSR::CNTK;
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -50,6 +51,137 @@ BOOST_FIXTURE_TEST_CASE(MultiplyIntToShort, RandomSeedFixture)
         BOOST_CHECK_EQUAL(round(C_upd[i]), C_expected_upd[i]);
 }
 
+// Column-major reference product in double precision
+static std::vector<double> ReferenceProduct(int m, int n, int k, const std::vector<float>& A, const std::vector<float>& B)
+{
+    std::vector<double> C(m * n, 0);
+    for (int j = 0; j < n; j++)
+        for (int l = 0; l < k; l++)
+            for (int i = 0; i < m; i++)
+                C[i + j * m] += (double)A[i + l * m] * B[l + j * k];
+    return C;
+}
+
+BOOST_FIXTURE_TEST_CASE(QuantizedGemmIsExact, RandomSeedFixture)
+{
+    // sizes that exercise the vectorized blocks as well as all remainders; values cover the full quantized range
+    const size_t m = 37, n = 19, k = 301;
+    std::mt19937 rng(IncrementCounter());
+    std::uniform_int_distribution<int> dist16(-32767, 32767), dist8(-127, 127);
+
+    std::vector<short> a16(m * k), b16(k * n);
+    std::vector<signed char> a8(m * k), b8(k * n);
+    for (size_t i = 0; i < a16.size(); i++) { a16[i] = (short)dist16(rng); a8[i] = (signed char)dist8(rng); }
+    for (size_t i = 0; i < b16.size(); i++) { b16[i] = (short)dist16(rng); b8[i] = (signed char)dist8(rng); }
+
+    std::vector<float> c16(m * n), c8(m * n);
+    CPUQuantizedGemm(m, n, k, a16.data(), 32767, b16.data(), 32767, c16.data());
+    CPUQuantizedGemm(m, n, k, a8.data(), 127, b8.data(), 127, c8.data());
+
+    for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < n; j++)
+        {
+            long long ref16 = 0, absSum16 = 0, ref8 = 0;
+            for (size_t l = 0; l < k; l++)
+            {
+                ref16 += a16[i * k + l] * b16[j * k + l];
+                absSum16 += abs(a16[i * k + l] * b16[j * k + l]);
+                ref8 += a8[i * k + l] * b8[j * k + l];
+            }
+            // int8 sums stay below 2^24 and are exact in float; int16 partial sums are rounded when added in float
+            BOOST_CHECK_LE(fabs(c16[i + j * m] - (double)ref16), 1e-5 * absSum16);
+            BOOST_CHECK_EQUAL(c8[i + j * m], (float)ref8);
+        }
+}
+
+BOOST_FIXTURE_TEST_CASE(MultiplyInt8AndInt16, RandomSeedFixture)
+{
+    const int m = 70, n = 33, k = 129;
+    std::mt19937 rng(IncrementCounter());
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    std::vector<float> A(m * k), B(k * n), C(m * n);
+    for (auto& v : A) v = dist(rng);
+    for (auto& v : B) v = dist(rng);
+
+    for (auto precision : { QuantizedPrecision::Int16, QuantizedPrecision::Int8 })
+    {
+        // error of a single quantized value, relative to the largest magnitude
+        const double quantizationStep = precision == QuantizedPrecision::Int8 ? 1.0 / 127 : 1.0 / 32767;
+
+        QuantizedMultiplier<float> mult(precision, 0, 0);
+        auto error = mult.SetConstantA(m, k, A.data());
+        BOOST_CHECK_LE(error.maxAbsError, error.maxAbsValue * quantizationStep / 2 * 1.001);
+        BOOST_CHECK_GT(error.relativeRmsError, 0);
+        BOOST_CHECK_LT(error.relativeRmsError, quantizationStep);
+
+        // the result is within the accumulated quantization error of both matrices
+        const double tolerance = 2 * sqrt((double)k) * quantizationStep;
+        mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+        auto expected = ReferenceProduct(m, n, k, A, B);
+        for (size_t i = 0; i < C.size(); i++)
+            BOOST_REQUIRE_SMALL(C[i] - expected[i], tolerance);
+
+        // new weights take effect once they are quantized again
+        std::vector<float> A2(A.rbegin(), A.rend());
+        mult.SetConstantA(m, k, A2.data());
+        mult.Multiply(m, n, k, A2.data(), B.data(), C.data());
+        expected = ReferenceProduct(m, n, k, A2, B);
+        for (size_t i = 0; i < C.size(); i++)
+            BOOST_REQUIRE_SMALL(C[i] - expected[i], tolerance);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(QuantizedWeightsCacheSharesWeights, RandomSeedFixture)
+{
+    const int m = 70, n = 33, k = 129;
+    std::mt19937 rng(IncrementCounter());
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    std::vector<float> A(m * k), B(k * n);
+    for (auto& v : A) v = dist(rng);
+    for (auto& v : B) v = dist(rng);
+
+    QuantizedMultiplier<float> reference(QuantizedPrecision::Int8, 1, 0);
+    auto referenceError = reference.SetConstantA(m, k, A.data());
+    std::vector<float> expected(m * n);
+    reference.Multiply(m, n, k, A.data(), B.data(), expected.data());
+
+    // the multipliers of the same weights share one quantized copy, and give the same results as a multiplier of their own
+    QuantizedWeightsCache cache;
+    std::vector<shared_ptr<QuantizedMultiplier<float>>> multipliers;
+    for (int i = 0; i < 4; i++)
+    {
+        QuantizationError error;
+        multipliers.push_back(cache.CreateMultiplier(QuantizedPrecision::Int8, 1, 0, m, k, A.data(), error));
+        BOOST_CHECK_EQUAL(error.maxAbsError, referenceError.maxAbsError);
+        BOOST_CHECK_EQUAL(error.relativeRmsError, referenceError.relativeRmsError);
+    }
+
+    // they can be used concurrently; a shared quantized copy is only read
+    std::vector<std::vector<float>> results(multipliers.size(), std::vector<float>(m * n));
+#pragma omp parallel for num_threads(4)
+    for (int i = 0; i < (int)multipliers.size(); i++)
+        multipliers[i]->Multiply(m, n, k, A.data(), B.data(), results[i].data());
+    for (const auto& C : results)
+        BOOST_CHECK(C == expected);
+
+    // new weights of one multiplier are quantized into a copy of its own
+    std::vector<float> A2(A.rbegin(), A.rend());
+    std::vector<float> C(m * n);
+    multipliers[0]->SetConstantA(m, k, A2.data());
+    multipliers[0]->Multiply(m, n, k, A2.data(), B.data(), C.data());
+    auto expected2 = ReferenceProduct(m, n, k, A2, B);
+    for (size_t i = 0; i < C.size(); i++)
+        BOOST_REQUIRE_SMALL(C[i] - expected2[i], 2 * sqrt((double)k) / 127);
+    multipliers[1]->Multiply(m, n, k, A.data(), B.data(), C.data());
+    BOOST_CHECK(C == expected);
+
+    // a different precision is a different quantized copy
+    QuantizationError error;
+    auto multiplier16 = cache.CreateMultiplier(QuantizedPrecision::Int16, 1, 0, m, k, A.data(), error);
+    BOOST_CHECK_LT(error.maxAbsError, referenceError.maxAbsError);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,161 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include "../../../Source/Math/Matrix.h"
+#include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/RNNCommon.h"
+#include "common.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+using vec = std::vector<float>;
+
+// Straightforward evaluation of one layer/direction of an RNN stack for a single sequence,
+// reading the weights from the cuDNN parameter layout. x and the result are [dim x numFrames], column-major.
+static std::vector<double> ReferenceRNNDirection(const std::wstring& op, const vec& w, size_t wOffset, size_t rOffset, size_t bwOffset, size_t brOffset,
+                                                 size_t inputDim, size_t hiddenSize, const std::vector<double>& x, size_t numFrames, bool reverse)
+{
+    const size_t numGates = op == L"lstm" ? 4 : op == L"gru" ? 3 : 1;
+    const size_t gateDim = numGates * hiddenSize;
+    auto sigmoid = [](double v) { return 1 / (1 + std::exp(-v)); };
+    std::vector<double> h(hiddenSize, 0), c(hiddenSize, 0), y(hiddenSize * numFrames);
+    for (size_t step = 0; step < numFrames; step++)
+    {
+        size_t t = reverse ? numFrames - 1 - step : step;
+        std::vector<double> xw(gateDim), rh(gateDim);
+        for (size_t row = 0; row < gateDim; row++)
+        {
+            xw[row] = w[bwOffset + row];
+            for (size_t k = 0; k < inputDim; k++)
+                xw[row] += w[wOffset + row * inputDim + k] * x[t * inputDim + k];
+            rh[row] = w[brOffset + row];
+            for (size_t k = 0; k < hiddenSize; k++)
+                rh[row] += w[rOffset + row * hiddenSize + k] * h[k];
+        }
+        const size_t n = hiddenSize;
+        for (size_t k = 0; k < n; k++)
+        {
+            if (op == L"lstm")
+            {
+                c[k] = sigmoid(xw[n + k] + rh[n + k]) * c[k] + sigmoid(xw[k] + rh[k]) * std::tanh(xw[2 * n + k] + rh[2 * n + k]);
+                h[k] = sigmoid(xw[3 * n + k] + rh[3 * n + k]) * std::tanh(c[k]);
+            }
+            else if (op == L"gru")
+            {
+                double r = sigmoid(xw[k] + rh[k]);
+                double z = sigmoid(xw[n + k] + rh[n + k]);
+                h[k] = (1 - z) * std::tanh(xw[2 * n + k] + r * rh[2 * n + k]) + z * h[k];
+            }
+            else if (op == L"rnnReLU")
+                h[k] = std::max(0.0, xw[k] + rh[k]);
+            else
+                h[k] = std::tanh(xw[k] + rh[k]);
+        }
+        std::copy(h.begin(), h.end(), y.begin() + t * hiddenSize);
+    }
+    return y;
+}
+
+BOOST_AUTO_TEST_SUITE(RNNSuite)
+
+BOOST_AUTO_TEST_CASE(OptimizedRNNStackForwardCPU)
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+
+    const size_t inputDim = 7;
+    const size_t hiddenSize = 9;
+    const size_t numLayers = 2;
+    // packed longest first, as OptimizedRNNStackNode does it
+    const std::vector<size_t> seqLengths = { 6, 4, 4, 1 };
+
+    for (auto op : { L"lstm", L"gru", L"rnnReLU", L"rnnTanh" })
+    {
+        for (bool bidirectional : { false, true })
+        {
+            RnnAttributes attributes(bidirectional, numLayers, hiddenSize, op, -1);
+            const size_t numDirections = bidirectional ? 2 : 1;
+            const size_t numGates = std::wstring(op) == L"lstm" ? 4 : std::wstring(op) == L"gru" ? 3 : 1;
+            const size_t outputDim = numDirections * hiddenSize;
+            auto numParameters = attributes.GetNumParameters(inputDim);
+
+            vec weights(numParameters.first * numParameters.second);
+            for (auto& v : weights)
+                v = dist(rng);
+
+            std::vector<std::vector<double>> sequences;
+            for (auto len : seqLengths)
+            {
+                sequences.push_back(std::vector<double>(inputDim * len));
+                for (auto& v : sequences.back())
+                    v = 4 * dist(rng);
+            }
+
+            // pack frame by frame
+            std::vector<size_t> numSequencesForFrame(seqLengths[0], 0);
+            vec packed;
+            for (size_t t = 0; t < seqLengths[0]; t++)
+                for (size_t s = 0; s < seqLengths.size() && seqLengths[s] > t; s++)
+                {
+                    numSequencesForFrame[t]++;
+                    packed.insert(packed.end(), sequences[s].begin() + t * inputDim, sequences[s].begin() + (t + 1) * inputDim);
+                }
+            const size_t numCols = packed.size() / inputDim;
+
+            SingleMatrix paramW(numParameters.first, numParameters.second, weights.data(), CPUDEVICE, matrixFlagNormal);
+            SingleMatrix inputX(inputDim, numCols, packed.data(), CPUDEVICE, matrixFlagNormal);
+            SingleMatrix outputY(outputDim, numCols, CPUDEVICE);
+            SingleMatrix reserve(CPUDEVICE);
+            SingleMatrix workspace(CPUDEVICE);
+            outputY.RNNForward(inputX, paramW, inputDim, outputDim, numSequencesForFrame, attributes, reserve, workspace);
+
+            // reference: all weights come first, then all biases (see CPURNNExecutor)
+            std::vector<size_t> wOffsets, rOffsets, bOffsets;
+            size_t offset = 0;
+            for (size_t layer = 0, dim = inputDim; layer < numLayers; layer++, dim = outputDim)
+                for (size_t dir = 0; dir < numDirections; dir++)
+                {
+                    wOffsets.push_back(offset);
+                    offset += numGates * hiddenSize * dim;
+                    rOffsets.push_back(offset);
+                    offset += numGates * hiddenSize * hiddenSize;
+                }
+            for (size_t i = 0; i < numLayers * numDirections; i++, offset += 2 * numGates * hiddenSize)
+                bOffsets.push_back(offset);
+            BOOST_REQUIRE_EQUAL(offset, weights.size());
+
+            std::unique_ptr<float[]> result(outputY.CopyToArray());
+            for (size_t s = 0; s < seqLengths.size(); s++)
+            {
+                std::vector<double> x = sequences[s];
+                for (size_t layer = 0, dim = inputDim; layer < numLayers; layer++, dim = outputDim)
+                {
+                    std::vector<double> y(outputDim * seqLengths[s]);
+                    for (size_t dir = 0; dir < numDirections; dir++)
+                    {
+                        size_t i = layer * numDirections + dir;
+                        auto yDir = ReferenceRNNDirection(op, weights, wOffsets[i], rOffsets[i], bOffsets[i], bOffsets[i] + numGates * hiddenSize,
+                                                          dim, hiddenSize, x, seqLengths[s], dir == 1);
+                        for (size_t t = 0; t < seqLengths[s]; t++)
+                            std::copy(yDir.begin() + t * hiddenSize, yDir.begin() + (t + 1) * hiddenSize, y.begin() + t * outputDim + dir * hiddenSize);
+                    }
+                    x = y;
+                }
+                // sequence s sits in column s of each of its frames
+                for (size_t t = 0, col = s; t < seqLengths[s]; col += numSequencesForFrame[t], t++)
+                    for (size_t k = 0; k < outputDim; k++)
+                        BOOST_REQUIRE_MESSAGE(AreEqual(result[col * outputDim + k], (float)x[t * outputDim + k], 1e-4f, 1e-5f),
+                                              "mismatch for " << std::string(op, op + wcslen(op)) << (bidirectional ? " (bidirectional)" : "") << " at frame " << t << " of sequence " << s);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
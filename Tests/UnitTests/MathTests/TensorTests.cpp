@@ -6,6 +6,8 @@
 //
 #include "stdafx.h"
 #include "TensorView.h"
+#include "CPUMatrix.h"
+#include "CPUFusedElementwise.h"
 #include "Sequences.h"
 #include "TensorTestsHelper.h"
 
@@ -101,6 +103,93 @@ BOOST_AUTO_TEST_CASE(OldRnnForwardProp)
     TestOldRnnForwardPropSRP<float>();
 }
 
+// The vectorized CPU kernels (CPUTensorSimd.h) must give the same results as the scalar code.
+// Odd sizes exercise the partial vectors at the end of each row.
+BOOST_AUTO_TEST_CASE(CPUSimdTensorOpsMatchScalar)
+{
+    Test::TensorTest<float> tensorTester;
+    let layerShape = TensorShape{ 77, 19 };
+    let a = tensorTester.CreateTensor(layerShape, 1, CPUDEVICE);
+    let b = tensorTester.CreateTensor(layerShape, 2, CPUDEVICE);
+    let bias = tensorTester.CreateTensor(TensorShape{ 77 }, 3, CPUDEVICE);
+    auto layerResult = tensorTester.CreateTensor(layerShape, 4, CPUDEVICE);
+    auto biasResult = tensorTester.CreateTensor(TensorShape{ 77 }, 5, CPUDEVICE);
+    auto columnResult = tensorTester.CreateTensor(TensorShape{ 1, 19 }, 6, CPUDEVICE);
+
+    let flags = CPUMatrix<float>::GetOptimizationFlags();
+    // both passes start from the same output, since some operations (beta != 0) add to it
+    auto compare = [&](TensorView<float>& result, double tolerance, const function<void()>& fn)
+    {
+        let initialResult = result.GetSOB().DeepClone();
+        CPUMatrix<float>::SetOptimizationFlags(flags & ~CPUMatrix<float>::OPT_SIMD_TENSOR_OPS);
+        fn();
+        let scalarResult = result.GetSOB().DeepClone();
+        result.GetSOB().AssignValuesOf(initialResult);
+        CPUMatrix<float>::SetOptimizationFlags(flags | CPUMatrix<float>::OPT_SIMD_TENSOR_OPS);
+        fn();
+        BOOST_CHECK(result.GetSOB().IsEqualTo(scalarResult, (float)tolerance));
+    };
+
+    compare(layerResult, 1e-6, [&] { layerResult.AssignSigmoidOf(a); });
+    compare(layerResult, 1e-6, [&] { layerResult.AssignTanhOf(a); });
+    compare(layerResult, 1e-6, [&] { layerResult.AssignExpOf(a); });
+    compare(layerResult, 0,    [&] { layerResult.AssignLinearRectifierOf(a); });
+    compare(layerResult, 1e-6, [&] { layerResult.DoSumOf(0.5f, a, bias, 2.0f); });
+    compare(layerResult, 1e-6, [&] { layerResult.AssignElementwiseProductWithTanhDerivativeFromOutputOf(a, b); });
+    compare(biasResult,  1e-5, [&] { biasResult.DoCopyOf(0, a, 1); });
+    compare(columnResult, 0,   [&] { columnResult.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opMax); });
+    compare(columnResult, 1e-5, [&] { columnResult.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opLogSum); });
+
+    CPUMatrix<float>::SetOptimizationFlags(flags);
+}
+
+// A fused program (CPUFusedElementwise.h) must compute the same values and gradients as the separate operations.
+// y = tanh(a .* b + a); the size is not a multiple of the block size and large enough to run in parallel.
+BOOST_AUTO_TEST_CASE(CPUFusedElementwiseMatchesSeparateOps)
+{
+    const size_t n = 40000;
+    const size_t none = FusedElementwiseStep::NoOperand;
+    std::vector<FusedElementwiseStep> program = {
+        // slot 2 = a .* b
+        { ElementWiseOperator::opElementwiseProduct, 2, { 0, 1 }, { ElementWiseOperator::opElementwiseProduct, ElementWiseOperator::opElementwiseProduct }, { 1, 0 } },
+        // slot 3 = slot 2 + a
+        { ElementWiseOperator::opSum, 2, { 2, 0 }, { ElementWiseOperator::opCopy, ElementWiseOperator::opCopy }, { none, none } },
+        // slot 4 = tanh(slot 3), whose gradient is computed from the output
+        { ElementWiseOperator::opTanh, 1, { 3, 0 }, { ElementWiseOperator::opElementwiseProductWithTanhDerivativeFromOutput, ElementWiseOperator::opNone }, { 4, none } },
+    };
+
+    std::vector<float> a(n), b(n), outputGradient(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = (float)((int)(i % 17) - 8) / 8;
+        b[i] = (float)((int)(i % 13) - 6) / 4;
+        outputGradient[i] = (float)((int)(i % 7) - 3);
+    }
+    std::vector<const float*> inputs = { a.data(), b.data() };
+
+    std::vector<float> result(n);
+    CPUFusedElementwiseForward(program, n, inputs, result.data());
+
+    std::vector<float> gradientA(n, 1.0f), gradientB(n, 5.0f);
+    CPUFusedElementwiseBackward(program, n, inputs, outputGradient.data(), 0, 1.0f, gradientA.data()); // accumulates
+    CPUFusedElementwiseBackward(program, n, inputs, outputGradient.data(), 1, 0.0f, gradientB.data()); // overwrites
+
+    bool match = true;
+    for (size_t i = 0; i < n; i++)
+    {
+        float y = std::tanh(a[i] * b[i] + a[i]);
+        float g = outputGradient[i] * (1 - y * y);
+        match = match && std::abs(result[i] - y) < 1e-6f &&
+                std::abs(gradientA[i] - (1 + g * (b[i] + 1))) < 1e-5f &&
+                std::abs(gradientB[i] - g * a[i]) < 1e-5f;
+    }
+    BOOST_CHECK(match);
+
+    // a step must not use a slot that is computed later
+    program[0].m_args[1] = 3;
+    BOOST_CHECK_THROW(CPUFusedElementwiseForward(program, n, inputs, result.data()), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(Half_MathTensorTests)
@@ -0,0 +1,141 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetworkBuilder.h"
+#include "Globals.h"
+#include "TestHelpers.h"
+#include <map>
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+static const float c_epsilonFloatE5 = 0.00001f;
+
+// Builds
+//   t = Tanh(x .* x + y)     -- a group of three nodes; t has two consumers, so it is the root of its group
+//   z = Sigmoid(t - w)       -- a group of two nodes; z is an output node, so it is not fused into c
+//   c = z + t .* y           -- a group of two nodes, with the inputs z, t and y
+// and compiles it with elementwise node fusion turned on or off.
+static ComputationNetworkPtr BuildElementwiseFusionTestNetwork(bool fuse)
+{
+    auto net = make_shared<ComputationNetwork>(c_deviceId);
+    ComputationNetworkBuilder<float> builder(*net);
+
+    auto x = builder.CreateLearnableParameter(L"x", 4, 3);
+    auto y = builder.CreateLearnableParameter(L"y", 4, 3);
+    auto w = builder.CreateLearnableParameter(L"w", 4, 3);
+    net->InitLearnableParameters(x, L"uniform", 1, /*randomSeed=*/1);
+    net->InitLearnableParameters(y, L"uniform", 1, /*randomSeed=*/2);
+    net->InitLearnableParameters(w, L"uniform", 1, /*randomSeed=*/3);
+
+    auto t = builder.Tanh(builder.Plus(builder.ElementTimes(x, x, L"xx"), y, L"s"), L"t");
+    auto z = builder.Sigmoid(builder.Minus(t, w, L"m"), L"z");
+    auto c = builder.Plus(z, builder.ElementTimes(t, y, L"e"), L"c");
+    net->AddToNodeGroup(L"output", z);
+    net->AddToNodeGroup(L"criterion", c);
+
+    bool wasEnabled = Globals::ShouldFuseElementwiseNodes();
+    Globals::SetElementwiseNodeFusion(fuse);
+    net->CompileNetwork();
+    Globals::SetElementwiseNodeFusion(wasEnabled);
+    return net;
+}
+
+static vector<float> ToVector(const Matrix<float>& m)
+{
+    return vector<float>(m.Data(), m.Data() + m.GetNumElements());
+}
+
+// Runs forward and backward from c, and returns the values of t, z and c, and the gradients of x, y and w.
+static map<wstring, vector<float>> RunElementwiseFusionTestNetwork(const ComputationNetworkPtr& net)
+{
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+
+    auto c = net->GetNodeFromName(L"c");
+    net->AllocateAllMatrices({}, { net->GetNodeFromName(L"t"), net->GetNodeFromName(L"z") }, c);
+    net->StartEvaluateMinibatchLoop(c);
+    net->ForwardProp(c);
+
+    map<wstring, vector<float>> results;
+    for (auto name : { L"t", L"z", L"c" })
+        results[name] = ToVector(dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(name))->Value());
+
+    net->Backprop(c);
+    for (auto name : { L"x", L"y", L"w" })
+        results[name] = ToVector(dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(name))->Gradient());
+    return results;
+}
+
+static void CheckSameResults(const map<wstring, vector<float>>& expected, const map<wstring, vector<float>>& actual)
+{
+    for (const auto& iter : expected)
+    {
+        const auto& values = actual.at(iter.first);
+        BOOST_REQUIRE_EQUAL(values.size(), iter.second.size());
+        BOOST_CHECK_MESSAGE(AreEqual(iter.second.data(), values.data(), values.size(), c_epsilonFloatE5),
+                            "Values of " << Microsoft::MSR::CNTK::ToLegacyString(Microsoft::MSR::CNTK::ToUTF8(iter.first)) << " differ");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(ElementwiseFusionTestSuite)
+
+BOOST_AUTO_TEST_CASE(ElementwiseFusionRewritesNetwork)
+{
+    auto unfused = BuildElementwiseFusionTestNetwork(/*fuse=*/false);
+    auto fused = BuildElementwiseFusionTestNetwork(/*fuse=*/true);
+
+    BOOST_CHECK_EQUAL(unfused->GetTotalNumberOfNodes(), 10);
+    BOOST_CHECK_EQUAL(fused->GetTotalNumberOfNodes(), 6);
+
+    // the roots keep their names, the inner nodes are gone
+    for (auto name : { L"t", L"z", L"c" })
+        BOOST_CHECK(fused->GetNodeFromName(name)->OperationName() == L"FusedElementwise");
+    for (auto name : { L"xx", L"s", L"m", L"e" })
+        BOOST_CHECK(!fused->NodeNameExists(name));
+
+    // the node groups refer to the fused nodes
+    BOOST_REQUIRE_EQUAL(fused->OutputNodes().size(), 1);
+    BOOST_CHECK(fused->OutputNodes()[0] == fused->GetNodeFromName(L"z"));
+    BOOST_REQUIRE_EQUAL(fused->FinalCriterionNodes().size(), 1);
+    BOOST_CHECK(fused->FinalCriterionNodes()[0] == fused->GetNodeFromName(L"c"));
+
+    // c is computed from z, t and y; x is used twice by x .* x but is a single input of t
+    BOOST_CHECK_EQUAL(fused->GetNodeFromName(L"c")->GetNumInputs(), 3);
+    BOOST_CHECK_EQUAL(fused->GetNodeFromName(L"t")->GetNumInputs(), 2);
+
+    CheckSameResults(RunElementwiseFusionTestNetwork(unfused), RunElementwiseFusionTestNetwork(fused));
+}
+
+BOOST_AUTO_TEST_CASE(ElementwiseFusionSavesUnfusedNetwork)
+{
+    auto fused = BuildElementwiseFusionTestNetwork(/*fuse=*/true);
+    auto expected = RunElementwiseFusionTestNetwork(BuildElementwiseFusionTestNetwork(/*fuse=*/false));
+
+    const wstring modelPath = L"ElementwiseFusionTest.dnn";
+    fused->Save(modelPath);
+    auto loaded = ComputationNetwork::CreateFromFile<float>(c_deviceId, modelPath);
+    remove(Microsoft::MSR::CNTK::ToLegacyString(Microsoft::MSR::CNTK::ToUTF8(modelPath)).c_str());
+
+    // the model does not contain fused nodes
+    BOOST_CHECK_EQUAL(loaded->GetTotalNumberOfNodes(), 10);
+    for (const auto& node : loaded->GetAllNodes())
+        BOOST_CHECK(node->OperationName() != L"FusedElementwise");
+    BOOST_CHECK(loaded->GetNodeFromName(L"xx")->OperationName() == L"ElementTimes");
+    BOOST_CHECK(loaded->GetNodeFromName(L"t")->OperationName() == L"Tanh");
+
+    CheckSameResults(expected, RunElementwiseFusionTestNetwork(loaded));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,300 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "Sequences.h"
+#include "gammacalculation.h"
+#include "fileutil.h"
+#include <memory>
+#include <omp.h>
+#include <random>
+#include <vector>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+using msra::lattices::lattice;
+
+static const size_t c_numUnits = 3;
+static const size_t c_numSenones = 3 * c_numUnits;
+
+// The units sil, a and b, each a left-to-right HMM of three states; unit u uses the senones 3u, 3u + 1 and 3u + 2.
+// The HMMs point to the transition matrix of the set, so a copy of the set must not outlive it.
+static void CreateTestHmmSet(msra::asr::simplesenonehmm& hset)
+{
+    static const char* names[c_numUnits] = { "sil", "a", "b" };
+
+    hset.transPs.resize(1);
+    auto& transP = hset.transPs[0];
+    transP.resize(3);
+    for (int from = -1; from < 3; from++)
+        for (size_t to = 0; to <= 3; to++)
+            transP(from, to) = -1e30f;
+    transP(-1, 0) = 0;
+    for (int from = 0; from < 3; from++)
+    {
+        transP(from, from) = logf(0.6f);
+        transP(from, from + 1) = logf(0.4f);
+    }
+    hset.transPmap["lr3"] = 0;
+
+    for (size_t u = 0; u < c_numUnits; u++)
+    {
+        msra::asr::simplesenonehmm::hmm hmm;
+        hmm.name = names[u];
+        hmm.transP = &hset.transPs[0];
+        hmm.transPindex = 0;
+        hmm.numstates = 3;
+        for (size_t s = 0; s < 3; s++)
+        {
+            hmm.senoneids[s] = (unsigned short) (3 * u + s);
+            hset.statenames.push_back(string(names[u]) + "_s" + to_string(s + 2));
+            hset.senoneid2transPindex.push_back(0);
+            hset.senoneid2stateindex.push_back((int) s);
+        }
+        hset.symmap[names[u]] = u;
+        hset.hmms.push_back(hmm);
+    }
+}
+
+// Builds a lattice with nodes 3 or 4 frames apart, and edges from every node to the next node and to the one after that.
+// The edges have random units and LM scores. The lattice goes through the V1 file format, the only way to construct one.
+static void CreateTestLattice(lattice& L, size_t numSegments, unsigned int seed)
+{
+    mt19937 rng(seed);
+    vector<msra::lattices::nodeinfo> nodes(1, msra::lattices::nodeinfo(0));
+    for (size_t i = 0; i < numSegments; i++)
+        nodes.push_back(msra::lattices::nodeinfo(nodes.back().t + 3 + rng() % 2));
+
+    // edges are sorted by end node, then by start node
+    vector<msra::lattices::edgeinfowithscores> edges;
+    vector<msra::lattices::aligninfo> align;
+    auto addEdge = [&](size_t S, size_t E)
+    {
+        edges.push_back(msra::lattices::edgeinfowithscores(S, E, 0.0f, -(float) (rng() % 50) / 10, align.size()));
+        for (size_t i = S; i < E; i++)
+            align.push_back(msra::lattices::aligninfo(rng() % c_numUnits, nodes[i + 1].t - nodes[i].t));
+    };
+    for (size_t E = 1; E <= numSegments; E++)
+    {
+        if (E >= 2)
+            addEdge(E - 2, E);
+        addEdge(E - 1, E);
+    }
+
+    lattice::header_v1_v2 info;
+    info.numnodes = nodes.size();
+    info.numedges = edges.size();
+    info.numframes = nodes.back().t;
+
+    const wstring path = L"LatticeForwardBackwardTest.lat";
+    FILE* f = fopenOrDie(path, L"wb");
+    fputTag(f, "LAT ");
+    fputint(f, 1);
+    fwriteOrDie(&info, sizeof(info), 1, f);
+    fputTag(f, "NODE");
+    fputint(f, (int) nodes.size());
+    fwriteOrDie(nodes, f);
+    fputTag(f, "EDGE");
+    fputint(f, (int) edges.size());
+    fwriteOrDie(edges, f);
+    fputTag(f, "ALIG");
+    fputint(f, (int) align.size());
+    fwriteOrDie(align, f);
+    fputTag(f, "END ");
+    fcloseOrDie(f);
+
+    const vector<size_t> idmap { 0, 1, 2 };
+    f = fopenOrDie(path, L"rb");
+    L.fread(f, idmap, /*spunit=*/SIZE_MAX);
+    fcloseOrDie(f);
+    _wunlink(path.c_str());
+}
+
+static vector<float> RandomVector(size_t size, float min, float max, unsigned int seed)
+{
+    mt19937 rng(seed);
+    uniform_real_distribution<float> distribution(min, max);
+    vector<float> values(size);
+    for (auto& value : values)
+        value = distribution(rng);
+    return values;
+}
+
+static vector<size_t> RandomSenones(size_t numFrames, unsigned int seed)
+{
+    mt19937 rng(seed);
+    vector<size_t> uids(numFrames);
+    for (auto& uid : uids)
+        uid = rng() % c_numSenones;
+    return uids;
+}
+
+// Sets the number of OpenMP threads for the lifetime of the object.
+class ScopedNumThreads
+{
+    int m_previous;
+
+public:
+    ScopedNumThreads(int numThreads)
+        : m_previous(omp_get_max_threads())
+    {
+        omp_set_num_threads(numThreads);
+    }
+    ~ScopedNumThreads()
+    {
+        omp_set_num_threads(m_previous);
+    }
+};
+
+// The parallel runs use more threads than there are utterances, and enough edges (about 600)
+// that the statically scheduled per-edge loops are split across the threads.
+static const int c_numParallelThreads = 4;
+static const size_t c_numSegments = 300;
+
+struct LatticeForwardBackwardResult
+{
+    double m_value;
+    vector<float> m_posteriors; // column-major
+};
+
+static LatticeForwardBackwardResult RunLatticeForwardBackward(const lattice& L, const msra::asr::simplesenonehmm& hset, const msra::dbn::matrix& logLLs,
+                                                              vector<size_t> uids, bool sMBRmode, int numThreads)
+{
+    ScopedNumThreads threads(numThreads);
+
+    msra::dbn::matrix result(logLLs.rows(), logLLs.cols());
+    msra::dbn::matrix errorsignalbuf;
+    lattice::parallelstate parallelstate; // not enabled, i.e. the CPU implementation
+    LatticeForwardBackwardResult output;
+    output.m_value = L.forwardbackward(parallelstate, logLLs, hset, result, errorsignalbuf,
+                                       /*lmf=*/14.0f, /*wp=*/0.0f, /*amf=*/14.0f, /*boostingfactor=*/0.0f, sMBRmode,
+                                       array_ref<size_t>(uids.data(), uids.size()));
+    for (size_t j = 0; j < result.cols(); j++)
+        for (size_t i = 0; i < result.rows(); i++)
+            output.m_posteriors.push_back(result(i, j));
+    return output;
+}
+
+BOOST_AUTO_TEST_SUITE(LatticeForwardBackwardTestSuite)
+
+// The edge alignments, the sMBR correct-frame counts and the MMI posteriors are computed in parallel loops
+// whose iterations are independent, so they must give exactly the serial results.
+BOOST_AUTO_TEST_CASE(LatticeForwardBackwardParallelMatchesSerial)
+{
+    msra::asr::simplesenonehmm hset;
+    CreateTestHmmSet(hset);
+    lattice L;
+    CreateTestLattice(L, c_numSegments, /*seed=*/1);
+    BOOST_REQUIRE_GT(L.getnumedges(), 512u);
+
+    const size_t numFrames = L.getnumframes();
+    auto values = RandomVector(c_numSenones * numFrames, -10.0f, 0.0f, /*seed=*/2);
+    msra::dbn::matrix logLLs(c_numSenones, numFrames);
+    for (size_t j = 0; j < numFrames; j++)
+        for (size_t i = 0; i < c_numSenones; i++)
+            logLLs(i, j) = values[j * c_numSenones + i];
+    auto uids = RandomSenones(numFrames, /*seed=*/3);
+
+    for (bool sMBRmode : { false, true })
+    {
+        auto serial = RunLatticeForwardBackward(L, hset, logLLs, uids, sMBRmode, 1);
+        auto parallel = RunLatticeForwardBackward(L, hset, logLLs, uids, sMBRmode, c_numParallelThreads);
+
+        BOOST_CHECK_EQUAL(serial.m_value, parallel.m_value);
+        BOOST_CHECK_MESSAGE(serial.m_posteriors == parallel.m_posteriors, (sMBRmode ? "sMBR" : "MMI") << " error signals differ");
+
+        // the MMI state posteriors of every frame sum up to 1
+        if (!sMBRmode)
+        {
+            for (size_t j = 0; j < numFrames; j++)
+            {
+                double sum = 0;
+                for (size_t i = 0; i < c_numSenones; i++)
+                    sum += serial.m_posteriors[j * c_numSenones + i];
+                BOOST_REQUIRE_CLOSE(sum, 1.0, 0.01);
+            }
+        }
+    }
+}
+
+struct GammaCalculationResult
+{
+    float m_objective;
+    vector<float> m_gammas;
+};
+
+static GammaCalculationResult RunGammaCalculation(const msra::asr::simplesenonehmm& hset, vector<shared_ptr<const msra::dbn::latticepair>> lattices,
+                                                  const vector<float>& logLikelihoods, vector<size_t> uids, bool sMBRmode, int numThreads)
+{
+    ScopedNumThreads threads(numThreads);
+
+    msra::lattices::GammaCalculation<float> gammaCalculation;
+    gammaCalculation.init(hset, CPUDEVICE);
+    msra::lattices::SeqGammarCalParam parameters;
+    parameters.sMBRmode = sMBRmode;
+    gammaCalculation.SetGammarCalculationParams(parameters);
+
+    const size_t numFrames = uids.size();
+    Matrix<float> objective(1, 1, CPUDEVICE);
+    Matrix<float> logLikelihood(c_numSenones, numFrames, const_cast<float*>(logLikelihoods.data()), CPUDEVICE);
+    Matrix<float> labels(c_numSenones, numFrames, CPUDEVICE);
+    Matrix<float> gammas(c_numSenones, numFrames, CPUDEVICE);
+    gammas.SetValue(0);
+    vector<size_t> boundaries(numFrames, 0);
+    vector<size_t> extrauttmap;
+    gammaCalculation.calgammaformb(objective, lattices, logLikelihood, labels, gammas, uids, boundaries,
+                                   /*samplesInRecurrentStep=*/1, /*pMBLayout=*/MBLayoutPtr(), extrauttmap, /*doreferencealign=*/false);
+
+    GammaCalculationResult result;
+    result.m_objective = objective.Get00Element();
+    result.m_gammas.assign(gammas.Data(), gammas.Data() + gammas.GetNumElements());
+    return result;
+}
+
+// With several utterances in a minibatch, the utterances are processed in parallel, each writing its own stripe of the gammas.
+BOOST_AUTO_TEST_CASE(GammaCalculationParallelUtterancesMatchSerial)
+{
+    msra::asr::simplesenonehmm hset;
+    CreateTestHmmSet(hset);
+
+    vector<shared_ptr<const msra::dbn::latticepair>> lattices;
+    size_t numFrames = 0;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        auto latticePair = make_shared<msra::dbn::latticepair>();
+        CreateTestLattice(latticePair->second, c_numSegments / 3 + 10 * i, /*seed=*/10 + i);
+        numFrames += latticePair->getnumframes();
+        lattices.push_back(latticePair);
+    }
+
+    auto logLikelihoods = RandomVector(c_numSenones * numFrames, -10.0f, 0.0f, /*seed=*/4);
+    auto uids = RandomSenones(numFrames, /*seed=*/5);
+
+    for (bool sMBRmode : { false, true })
+    {
+        auto serial = RunGammaCalculation(hset, lattices, logLikelihoods, uids, sMBRmode, 1);
+        auto parallel = RunGammaCalculation(hset, lattices, logLikelihoods, uids, sMBRmode, c_numParallelThreads);
+
+        BOOST_CHECK_EQUAL(serial.m_objective, parallel.m_objective);
+        BOOST_CHECK_MESSAGE(serial.m_gammas == parallel.m_gammas, (sMBRmode ? "sMBR" : "MMI") << " gammas differ");
+
+        // every utterance got its gammas
+        for (size_t j = 0; j < numFrames; j++)
+        {
+            bool hasGamma = false;
+            for (size_t i = 0; i < c_numSenones; i++)
+                hasGamma |= serial.m_gammas[j * c_numSenones + i] != 0;
+            BOOST_REQUIRE_MESSAGE(hasGamma, "No gammas for frame " << j);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,112 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include "GradientBuckets.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+BOOST_AUTO_TEST_SUITE(MatrixPoolTestSuite)
+
+BOOST_AUTO_TEST_CASE(MatrixPoolMinibatchSizeReplanTest)
+{
+    MatrixPool pool;
+    pool.Reset();
+
+    shared_ptr<Matrix<float>> a, b, c, p;
+
+    // step counter: each request and each release is one step
+    pool.RequestAllocate<float>(c_deviceId, &a, 10, /*mbScale=*/true, /*isWorkSpace=*/false);    // 0
+    pool.RequestAllocate<float>(c_deviceId, &b, 10, /*mbScale=*/true, /*isWorkSpace=*/false);    // 1
+    pool.RequestRelease<float>(&a);                                                              // 2
+    pool.RequestAllocate<float>(c_deviceId, &c, 1000, /*mbScale=*/false, /*isWorkSpace=*/false); // 3
+    pool.RequestRelease<float>(&b);                                                              // 4
+    pool.RequestRelease<float>(&c);                                                              // 5
+    pool.RequestAllocate<float>(c_deviceId, &p, 1, /*mbScale=*/true, /*isWorkSpace=*/false);     // 6, never released
+
+    // initial plan from the per-sample estimates
+    pool.OptimizedMemoryAllocation();
+    BOOST_CHECK(a == c);
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(pool.GetPlannedMinibatchNumCols(), 0);
+
+    // with 1000 columns per minibatch, 'c' is the smallest request; it is packed together with 'a' and 'p'
+    auto pinned = p;
+    BOOST_CHECK(pool.UpdateMinibatchSize(1000));
+    BOOST_CHECK(p == pinned); // never released, so it keeps its matrix
+    BOOST_CHECK(a == p);
+    BOOST_CHECK(c == p);
+    BOOST_CHECK(b != p);
+    BOOST_CHECK_EQUAL(pool.GetPlannedMinibatchNumCols(), 1000);
+    BOOST_CHECK_EQUAL(pool.GetPlannedBytes(), 2 * 10 * 1000 * sizeof(float));
+
+    // a smaller minibatch does not trigger a new plan
+    auto previousA = a;
+    BOOST_CHECK(!pool.UpdateMinibatchSize(500));
+    BOOST_CHECK(a == previousA);
+}
+
+BOOST_AUTO_TEST_CASE(MatrixPoolContiguousAllocateTest)
+{
+    MatrixPool pool;
+    pool.Reset();
+
+    shared_ptr<Matrix<float>> a, b, c;
+    pool.RequestContiguousAllocate<float>(c_deviceId, &a, 3, 4);
+    pool.RequestContiguousAllocate<float>(c_deviceId, &b, 5, 1);
+    pool.RequestContiguousAllocate<float>(c_deviceId, &c, 2, 2);
+    pool.AllocateContiguousMatrices();
+
+    BOOST_CHECK_EQUAL(a->GetNumRows(), 3);
+    BOOST_CHECK_EQUAL(a->GetNumCols(), 4);
+    BOOST_CHECK_EQUAL(b->GetNumRows(), 5);
+    BOOST_CHECK_EQUAL(c->GetNumCols(), 2);
+
+    // the matrices directly follow each other, in request order
+    BOOST_CHECK(b->Data() == a->Data() + 12);
+    BOOST_CHECK(c->Data() == b->Data() + 5);
+
+    // and are grouped into buckets of adjacent gradients, in address order
+    vector<pair<const void*, size_t>> buffers = {
+        { c->Data(), 4 * sizeof(float) }, { a->Data(), 12 * sizeof(float) }, { b->Data(), 5 * sizeof(float) } };
+    auto buckets = FormGradientBuckets(buffers, 1024);
+    BOOST_REQUIRE_EQUAL(buckets.size(), 1);
+    BOOST_CHECK(buckets[0].m_data == (const char*)a->Data());
+    BOOST_CHECK_EQUAL(buckets[0].m_sizeInBytes, 21 * sizeof(float));
+    BOOST_CHECK(buckets[0].m_items == vector<size_t>({ 1, 2, 0 }));
+
+    // the bucket size limits the runs; a run of a single gradient is no bucket
+    buckets = FormGradientBuckets(buffers, 17 * sizeof(float));
+    BOOST_REQUIRE_EQUAL(buckets.size(), 1);
+    BOOST_CHECK(buckets[0].m_items == vector<size_t>({ 1, 2 }));
+
+    // the gradient of a parameter shared by several nodes is requested once per node, but gets one slot
+    MatrixPool sharedPool;
+    sharedPool.Reset();
+    shared_ptr<Matrix<float>> shared, other;
+    sharedPool.RequestContiguousAllocate<float>(c_deviceId, &shared, 3, 4);
+    sharedPool.RequestContiguousAllocate<float>(c_deviceId, &shared, 3, 4);
+    sharedPool.RequestContiguousAllocate<float>(c_deviceId, &other, 5, 1);
+    sharedPool.RequestContiguousAllocate<float>(c_deviceId, &shared, 3, 4);
+    sharedPool.AllocateContiguousMatrices();
+
+    BOOST_CHECK(other->Data() == shared->Data() + 12);
+    buffers = { { shared->Data(), 12 * sizeof(float) }, { other->Data(), 5 * sizeof(float) } };
+    buckets = FormGradientBuckets(buffers, 1024);
+    BOOST_REQUIRE_EQUAL(buckets.size(), 1);
+    BOOST_CHECK_EQUAL(buckets[0].m_sizeInBytes, 17 * sizeof(float));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
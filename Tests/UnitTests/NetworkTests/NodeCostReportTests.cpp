@@ -0,0 +1,126 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetworkBuilder.h"
+#include "../../../Source/ComputationNetworkLib/NodeCostReport.h"
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+BOOST_AUTO_TEST_SUITE(NodeCostReportTestSuite)
+
+// h = w * x with w [2 x 3] and x [3 x 4], where x is constant; s = h + b with b [2 x 4].
+BOOST_AUTO_TEST_CASE(EstimateNodeCostOfTimesAndPlus)
+{
+    auto net = make_shared<ComputationNetwork>(c_deviceId);
+    ComputationNetworkBuilder<float> builder(*net);
+
+    auto w = builder.CreateLearnableParameter(L"w", 2, 3);
+    auto x = builder.CreateLearnableParameter(L"x", 3, 4);
+    auto b = builder.CreateLearnableParameter(L"b", 2, 4);
+    x->SetLearningRateMultiplier(0);
+    auto h = builder.Times(w, x, 1, L"h");
+    auto s = builder.Plus(h, b, L"s");
+    net->AddToNodeGroup(L"output", s);
+    net->CompileNetwork();
+
+    BOOST_REQUIRE(h->NeedsGradient());
+    BOOST_REQUIRE(!x->NeedsGradient());
+
+    // 2 operations for each of the 3 multiply-adds of the 8 output elements. The backward pass computes
+    // the gradient of w only; it reads the 8 output gradients and the 6 + 12 inputs, and updates the 6 gradients of w.
+    auto times = EstimateNodeCost(*h, FrameRange(), /*backward=*/false, sizeof(float));
+    BOOST_CHECK_EQUAL(times.m_flops, 2 * 3 * 8);
+    BOOST_CHECK_EQUAL(times.m_bytes, (6 + 12 + 8) * sizeof(float));
+    times = EstimateNodeCost(*h, FrameRange(), /*backward=*/true, sizeof(float));
+    BOOST_CHECK_EQUAL(times.m_flops, 2 * 3 * 8);
+    BOOST_CHECK_EQUAL(times.m_bytes, (8 + 6 + 12 + 2 * 6) * sizeof(float));
+
+    // An addition per output element, in the backward pass once for each of the two inputs.
+    auto plus = EstimateNodeCost(*s, FrameRange(), /*backward=*/false, sizeof(double));
+    BOOST_CHECK_EQUAL(plus.m_flops, 8);
+    BOOST_CHECK_EQUAL(plus.m_bytes, (8 + 8 + 8) * sizeof(double));
+    plus = EstimateNodeCost(*s, FrameRange(), /*backward=*/true, sizeof(double));
+    BOOST_CHECK_EQUAL(plus.m_flops, 2 * 8);
+    BOOST_CHECK_EQUAL(plus.m_bytes, (8 + 8 + 8 + 2 * (8 + 8)) * sizeof(double));
+}
+
+static NodeCostStatistics CreateNodeCostStatistics(size_t calls, double seconds, double flops, double bytes, size_t matrixBytes)
+{
+    NodeCostStatistics statistics;
+    statistics.m_calls = calls;
+    statistics.m_seconds = seconds;
+    statistics.m_flops = flops;
+    statistics.m_bytes = bytes;
+    statistics.m_matrixBytes = matrixBytes;
+    return statistics;
+}
+
+static string ReadNodeCostReport(const vector<NodeCostReportEntry>& entries, size_t numMinibatches, const NodeCostRoofline& roofline)
+{
+    const wstring fileName = L"NodeCostReportTest.json";
+    WriteNodeCostReport(fileName, entries, numMinibatches, roofline);
+
+    auto narrowFileName = Microsoft::MSR::CNTK::ToLegacyString(Microsoft::MSR::CNTK::ToUTF8(fileName));
+    ostringstream contents;
+    contents << ifstream(narrowFileName).rdbuf();
+    remove(narrowFileName.c_str());
+    return contents.str();
+}
+
+BOOST_AUTO_TEST_CASE(WriteNodeCostReportFormat)
+{
+    NodeCostReportEntry times { L"h", L"Times", CreateNodeCostStatistics(4, 0.004, 192, 416, 32), CreateNodeCostStatistics(4, 0.002, 192, 608, 64) };
+    NodeCostReportEntry plus { L"a\"b", L"Plus", CreateNodeCostStatistics(2, 0.006, 16, 192, 32), CreateNodeCostStatistics(2, 0.006, 32, 448, 64) };
+    NodeCostRoofline roofline;
+    roofline.m_peakGFlops = 100;
+    roofline.m_peakGBps = 10;
+
+    // The values are per minibatch, the most expensive node comes first, and the names are escaped.
+    BOOST_CHECK_EQUAL(ReadNodeCostReport({ times, plus }, 2, roofline),
+        "{\n"
+        "  \"minibatches\": 2,\n"
+        "  \"peakGFlops\": 100,\n"
+        "  \"peakGBps\": 10,\n"
+        "  \"nodes\": [\n"
+        "    {\"name\": \"a\\\"b\", \"operation\": \"Plus\", \"timeFraction\": 0.666667, "
+        "\"forward\": {\"calls\": 1.000, \"seconds\": 0.003, \"flops\": 8, \"bytes\": 96, \"matrixBytes\": 32}, "
+        "\"backward\": {\"calls\": 1.000, \"seconds\": 0.003, \"flops\": 16, \"bytes\": 224, \"matrixBytes\": 64}, "
+        "\"intensity\": 0.075, \"gflopsPerSecond\": 4e-06, \"gbytesPerSecond\": 5.33333333e-05, \"bound\": \"memory\", \"rooflineEfficiency\": 0.000005},\n"
+        "    {\"name\": \"h\", \"operation\": \"Times\", \"timeFraction\": 0.333333, "
+        "\"forward\": {\"calls\": 2.000, \"seconds\": 0.002, \"flops\": 96, \"bytes\": 208, \"matrixBytes\": 32}, "
+        "\"backward\": {\"calls\": 2.000, \"seconds\": 0.001, \"flops\": 96, \"bytes\": 304, \"matrixBytes\": 64}, "
+        "\"intensity\": 0.375, \"gflopsPerSecond\": 6.4e-05, \"gbytesPerSecond\": 0.000170666667, \"bound\": \"memory\", \"rooflineEfficiency\": 0.000017}\n"
+        "  ]\n"
+        "}\n");
+
+    // Without known peaks, there is no roofline classification.
+    BOOST_CHECK_EQUAL(ReadNodeCostReport({ times }, 2, NodeCostRoofline()),
+        "{\n"
+        "  \"minibatches\": 2,\n"
+        "  \"peakGFlops\": 0,\n"
+        "  \"peakGBps\": 0,\n"
+        "  \"nodes\": [\n"
+        "    {\"name\": \"h\", \"operation\": \"Times\", \"timeFraction\": 1.000000, "
+        "\"forward\": {\"calls\": 2.000, \"seconds\": 0.002, \"flops\": 96, \"bytes\": 208, \"matrixBytes\": 32}, "
+        "\"backward\": {\"calls\": 2.000, \"seconds\": 0.001, \"flops\": 96, \"bytes\": 304, \"matrixBytes\": 64}, "
+        "\"intensity\": 0.375, \"gflopsPerSecond\": 6.4e-05, \"gbytesPerSecond\": 0.000170666667}\n"
+        "  ]\n"
+        "}\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -47,6 +47,16 @@ namespace CNTK {
         {
             m_chunk = m_parser.GetChunk(0);
         }
+
+        void SetNumParsingThreads(unsigned int numThreads)
+        {
+            m_parser.SetNumParsingThreads(numThreads);
+        }
+
+        void SetTraceLevel(unsigned int traceLevel)
+        {
+            m_parser.SetTraceLevel(traceLevel);
+        }
     };
 }
 
@@ -86,6 +96,8 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_Simple_dense)
     };
     test({});
     test({ L"defMBSize=true" });
+    test({ L"prefetchDepth=4" });
+    test({ L"prefetch=false" });
 };
 
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_Simple_dense_single_stream)
@@ -320,6 +332,35 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_100x1_1_dense)
     test({ L"defMBSize=true" });
 };
 
+// 100 identical single sample sequences, read through the on-disk chunk cache.
+// The cache must not change the data, so the output is compared against the 100x1 control.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_100x1_dense_chunk_cache)
+{
+    auto test = [this](const vector<wstring>& parameters)
+    {
+        HelperRunReaderTest<double>(
+            testDataPath() + "/Config/CNTKTextFormatReader/dense.cntk",
+            testDataPath() + "/Control/CNTKTextFormatReader/100x1_1_dense.txt",
+            testDataPath() + "/Control/CNTKTextFormatReader/100x1_1_dense_Output.txt",
+            "100x1_chunkCache",
+            "reader",
+            10,      // epoch size
+            1,       // mb size
+            10,      // num epochs
+            1,       // num feature streams
+            1,       // num label streams
+            0,       // subset number
+            1,       // number of subsets
+            false, false, true,
+            parameters);
+    };
+
+    // the first run fills the cache file, the second one reads everything from it
+    test({});
+    test({});
+    test({ L"defMBSize=true" });
+};
+
 // 100 identical single sample sequences
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_100x1_2_dense)
 {
@@ -903,6 +944,72 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_extra_input_should_be_ignored)
     }
 };
 
+// A chunk large enough to be parsed on several threads must give the same result as the serial parser.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_parallel_parsing)
+{
+    vector<StreamDescriptor> streams(2);
+    streams[0].m_alias = "A";
+    streams[0].m_name = L"A";
+    streams[0].m_storageFormat = StorageFormat::Dense;
+    streams[0].m_sampleDimension = 3;
+
+    streams[1].m_alias = "B";
+    streams[1].m_name = L"B";
+    streams[1].m_storageFormat = StorageFormat::SparseCSC;
+    streams[1].m_sampleDimension = 100;
+
+    const size_t numSequences = 20000;
+    string filename = "parallel_parsing.txt";
+    {
+        std::ofstream file;
+        file.open(filename, std::ofstream::out);
+        for (size_t i = 0; i < numSequences; ++i)
+        {
+            file << i << " |A " << i << " " << -0.5 * i << " " << i << "e-3 |B " << i % 100 << ":" << 0.25 * i << "\n";
+            file << i << " |A 1.5 -2.5 3.5\t|# a comment |B\n";
+        }
+    }
+
+    auto loadChunk = [&](unsigned int numThreads)
+    {
+        CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0);
+        testRunner.SetNumParsingThreads(numThreads);
+        testRunner.SetTraceLevel(1); // warnings only
+        testRunner.LoadChunk();
+        return testRunner.m_chunk;
+    };
+
+    auto serial = loadChunk(1);
+    auto parallel = loadChunk(4);
+    boost::filesystem::remove(filename);
+
+    for (size_t i = 0; i < numSequences; ++i)
+    {
+        vector<SequenceDataPtr> expected, actual;
+        serial->GetSequence(i, expected);
+        parallel->GetSequence(i, actual);
+        BOOST_REQUIRE_EQUAL(expected.size(), 2);
+        BOOST_REQUIRE_EQUAL(actual.size(), 2);
+
+        BOOST_REQUIRE_EQUAL(expected[0]->m_numberOfSamples, 2);
+        BOOST_REQUIRE_EQUAL(actual[0]->m_numberOfSamples, 2);
+        auto expectedDense = reinterpret_cast<const double*>(expected[0]->GetDataBuffer());
+        auto actualDense = reinterpret_cast<const double*>(actual[0]->GetDataBuffer());
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(expectedDense, expectedDense + 6, actualDense, actualDense + 6);
+        BOOST_REQUIRE_CLOSE(expectedDense[1], -0.5 * i, 1e-5);
+        BOOST_REQUIRE_CLOSE(expectedDense[2], i * 1e-3, 1e-5);
+        BOOST_REQUIRE_EQUAL(expectedDense[5], 3.5);
+
+        auto expectedSparse = static_pointer_cast<SparseSequenceData>(expected[1]);
+        auto actualSparse = static_pointer_cast<SparseSequenceData>(actual[1]);
+        BOOST_REQUIRE_EQUAL(expectedSparse->m_totalNnzCount, 1);
+        BOOST_REQUIRE_EQUAL(actualSparse->m_totalNnzCount, 1);
+        BOOST_REQUIRE_EQUAL(expectedSparse->m_indices[0], actualSparse->m_indices[0]);
+        BOOST_REQUIRE_EQUAL(actualSparse->m_indices[0], i % 100);
+        BOOST_REQUIRE_EQUAL(*reinterpret_cast<const double*>(actualSparse->GetDataBuffer()), 0.25 * i);
+    }
+};
+
 // 100 sequences with N samples for each of 3 inputs, where N is chosen at random
 // from [1, 100] for each sequence
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_100x100x3)
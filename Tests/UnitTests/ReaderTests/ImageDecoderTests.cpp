@@ -0,0 +1,367 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include "../../../Source/Readers/ImageReader/ImageDecoder.h"
+#ifdef USE_LIBJPEG_TURBO
+#include <stdio.h>
+#include <jpeglib.h>
+#endif
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+using namespace ::CNTK;
+
+// The start of a baseline JPEG image, up to the start of its first scan:
+// SOI, APP0 (JFIF), SOF0 (8 bit, 300 x 200, 3 components), SOS.
+static vector<unsigned char> CreateJpegHeader()
+{
+    return vector<unsigned char> {
+        0xFF, 0xD8,
+        0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+        0xFF, 0xC0, 0x00, 0x11, 0x08, 0x00, 0xC8, 0x01, 0x2C, 0x03,
+        0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01,
+        0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00
+    };
+}
+
+static const size_t c_frameHeaderOffset = 20;
+
+static bool ReadJpegHeader(const vector<unsigned char>& data, int& width, int& height, int& components)
+{
+    return ::CNTK::ReadJpegHeader(data.data(), data.size(), width, height, components);
+}
+
+BOOST_AUTO_TEST_SUITE(ImageDecoderTestSuite)
+
+BOOST_AUTO_TEST_CASE(ReadJpegHeaderOfValidImage)
+{
+    int width = 0, height = 0, components = 0;
+    BOOST_REQUIRE(ReadJpegHeader(CreateJpegHeader(), width, height, components));
+    BOOST_CHECK_EQUAL(width, 300);
+    BOOST_CHECK_EQUAL(height, 200);
+    BOOST_CHECK_EQUAL(components, 3);
+
+    // Fill bytes may precede a marker.
+    auto data = CreateJpegHeader();
+    data.insert(data.begin() + c_frameHeaderOffset, { 0xFF, 0xFF });
+    width = height = components = 0;
+    BOOST_REQUIRE(ReadJpegHeader(data, width, height, components));
+    BOOST_CHECK_EQUAL(width, 300);
+    BOOST_CHECK_EQUAL(height, 200);
+
+    // A progressive frame has the same header.
+    data = CreateJpegHeader();
+    data[c_frameHeaderOffset + 1] = 0xC2;
+    BOOST_CHECK(ReadJpegHeader(data, width, height, components));
+}
+
+BOOST_AUTO_TEST_CASE(ReadJpegHeaderOfTruncatedImage)
+{
+    auto data = CreateJpegHeader();
+    int width, height, components;
+
+    // The frame header ends 39 bytes into the image; every shorter prefix must be rejected.
+    const size_t frameHeaderEnd = c_frameHeaderOffset + 2 + 0x11;
+    for (size_t size = 0; size < frameHeaderEnd; ++size)
+        BOOST_CHECK_MESSAGE(!::CNTK::ReadJpegHeader(data.data(), size, width, height, components), "Prefix of " << size << " bytes");
+    BOOST_CHECK(::CNTK::ReadJpegHeader(data.data(), frameHeaderEnd, width, height, components));
+}
+
+BOOST_AUTO_TEST_CASE(ReadJpegHeaderOfUnsupportedImage)
+{
+    int width, height, components;
+
+    // Not a JPEG image.
+    vector<unsigned char> png { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    BOOST_CHECK(!ReadJpegHeader(png, width, height, components));
+
+    // Lossless frame.
+    auto data = CreateJpegHeader();
+    data[c_frameHeaderOffset + 1] = 0xC3;
+    BOOST_CHECK(!ReadJpegHeader(data, width, height, components));
+
+    // 12 bit samples.
+    data = CreateJpegHeader();
+    data[c_frameHeaderOffset + 4] = 12;
+    BOOST_CHECK(!ReadJpegHeader(data, width, height, components));
+
+    // Zero height, i.e. defined by a DNL marker.
+    data = CreateJpegHeader();
+    data[c_frameHeaderOffset + 5] = data[c_frameHeaderOffset + 6] = 0;
+    BOOST_CHECK(!ReadJpegHeader(data, width, height, components));
+
+    // A scan without a frame header.
+    data = CreateJpegHeader();
+    data.erase(data.begin() + c_frameHeaderOffset, data.begin() + c_frameHeaderOffset + 2 + 0x11);
+    BOOST_CHECK(!ReadJpegHeader(data, width, height, components));
+
+    // A marker segment whose length runs past the end of the data.
+    data = CreateJpegHeader();
+    data[5] = 0x60;
+    BOOST_CHECK(!ReadJpegHeader(data, width, height, components));
+}
+
+// An APP1 segment with EXIF data whose first image file directory only holds an orientation tag.
+static vector<unsigned char> CreateExifSegment(unsigned char orientation, bool littleEndian)
+{
+    if (littleEndian)
+        return vector<unsigned char> {
+            0xFF, 0xE1, 0x00, 0x22, 'E', 'x', 'i', 'f', 0x00, 0x00,
+            'I', 'I', 0x2A, 0x00, 0x08, 0x00, 0x00, 0x00,
+            0x01, 0x00, 0x12, 0x01, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, orientation, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00
+        };
+
+    return vector<unsigned char> {
+        0xFF, 0xE1, 0x00, 0x22, 'E', 'x', 'i', 'f', 0x00, 0x00,
+        'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+        0x00, 0x01, 0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, orientation, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00
+    };
+}
+
+BOOST_AUTO_TEST_CASE(ReadJpegHeaderWithExifOrientation)
+{
+    int width, height, components;
+    for (bool littleEndian : { false, true })
+    {
+        // The default orientation needs no rotation.
+        auto data = CreateJpegHeader();
+        auto exif = CreateExifSegment(1, littleEndian);
+        data.insert(data.begin() + c_frameHeaderOffset, exif.begin(), exif.end());
+        BOOST_CHECK(ReadJpegHeader(data, width, height, components));
+
+        // Any other orientation is applied by OpenCV, so the image is not supported.
+        for (unsigned char orientation = 2; orientation <= 8; ++orientation)
+        {
+            data = CreateJpegHeader();
+            exif = CreateExifSegment(orientation, littleEndian);
+            data.insert(data.begin() + c_frameHeaderOffset, exif.begin(), exif.end());
+            BOOST_CHECK_MESSAGE(!ReadJpegHeader(data, width, height, components), "Orientation " << (int)orientation);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SelectJpegScaleDenominatorBoundaries)
+{
+    // The scaled dimensions are rounded up: ceil(57 / 8) = 8, ceil(56 / 8) = 7.
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 8, 8), 8);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(57, 57, 8, 8), 8);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(56, 56, 8, 8), 4);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 9, 8), 4);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 8, 9), 4);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 16, 16), 4);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 17, 16), 2);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 32, 32), 2);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(64, 64, 33, 32), 1);
+
+    // A region smaller than the target is decoded at full scale.
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(10, 10, 10, 10), 1);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(10, 10, 11, 10), 1);
+    BOOST_CHECK_EQUAL(SelectJpegScaleDenominator(2, 2, 1, 1), 8);
+}
+
+BOOST_AUTO_TEST_CASE(NarrowImageRegionComposesCropsAndFlips)
+{
+    int x = 10, y = 20, width = 100, height = 50;
+    bool flip = false;
+
+    NarrowImageRegion(x, y, width, height, flip, 5, 6, 40, 30, false);
+    BOOST_CHECK_EQUAL(x, 15);
+    BOOST_CHECK_EQUAL(y, 26);
+    BOOST_CHECK_EQUAL(width, 40);
+    BOOST_CHECK_EQUAL(height, 30);
+    BOOST_CHECK(!flip);
+
+    NarrowImageRegion(x, y, width, height, flip, 5, 0, 20, 30, true);
+    BOOST_CHECK_EQUAL(x, 20);
+    BOOST_CHECK_EQUAL(width, 20);
+    BOOST_CHECK(flip);
+
+    // With a pending flip, the left edge of the crop is at the right edge of the region.
+    NarrowImageRegion(x, y, width, height, flip, 2, 1, 10, 10, false);
+    BOOST_CHECK_EQUAL(x, 28);
+    BOOST_CHECK_EQUAL(y, 27);
+    BOOST_CHECK(flip);
+
+    NarrowImageRegion(x, y, width, height, flip, 0, 0, 4, 4, true);
+    BOOST_CHECK_EQUAL(x, 34);
+    BOOST_CHECK(!flip);
+}
+
+#ifdef USE_LIBJPEG_TURBO
+
+// Pixels of an image, with rows of width * channels bytes and no padding.
+struct TestImage
+{
+    int m_width;
+    int m_height;
+    int m_channels;
+    vector<unsigned char> m_pixels;
+
+    unsigned char At(int x, int y, int c) const
+    {
+        return m_pixels[((size_t)y * m_width + x) * m_channels + c];
+    }
+
+    TestImage Crop(int x, int y, int width, int height, bool flip) const
+    {
+        TestImage result { width, height, m_channels, vector<unsigned char>((size_t)width * height * m_channels) };
+        for (int row = 0; row < height; ++row)
+            for (int column = 0; column < width; ++column)
+                for (int c = 0; c < m_channels; ++c)
+                    result.m_pixels[((size_t)row * width + column) * m_channels + c] = At(x + (flip ? width - 1 - column : column), y + row, c);
+        return result;
+    }
+};
+
+// Encodes a color image with a pattern that differs in every row and column, and with dimensions
+// that are not a multiple of the (subsampled) block size.
+static vector<unsigned char> CreateTestJpeg(int width, int height)
+{
+    jpeg_compress_struct info;
+    jpeg_error_mgr error;
+    info.err = jpeg_std_error(&error);
+    jpeg_create_compress(&info);
+
+    unsigned char* data = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&info, &data, &size);
+
+    info.image_width = width;
+    info.image_height = height;
+    info.input_components = 3;
+    info.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, 90, TRUE);
+    jpeg_start_compress(&info, TRUE);
+
+    vector<unsigned char> row((size_t)width * 3);
+    while (info.next_scanline < info.image_height)
+    {
+        int y = (int)info.next_scanline;
+        for (int x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = (unsigned char)(x * 255 / width);
+            row[x * 3 + 1] = (unsigned char)(y * 255 / height);
+            row[x * 3 + 2] = (unsigned char)((x * 7 + y * 13) % 256);
+        }
+        JSAMPROW rowPointer = row.data();
+        jpeg_write_scanlines(&info, &rowPointer, 1);
+    }
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+
+    vector<unsigned char> result(data, data + size);
+    free(data);
+    return result;
+}
+
+static TestImage Decode(const vector<unsigned char>& jpeg, int denominator, int x, int y, int width, int height)
+{
+    vector<unsigned char> buffer;
+    auto region = DecodeJpegRegion(jpeg.data(), jpeg.size(), /*grayscale=*/false, denominator, x, y, width, height, buffer);
+
+    TestImage result { region.m_width, region.m_height, region.m_channels, {} };
+    for (int row = 0; row < region.m_height; ++row)
+    {
+        auto begin = region.m_data + row * region.m_stride;
+        result.m_pixels.insert(result.m_pixels.end(), begin, begin + region.m_width * region.m_channels);
+    }
+    return result;
+}
+
+static void CheckSamePixels(const TestImage& expected, const TestImage& actual, const string& what)
+{
+    BOOST_REQUIRE_MESSAGE(actual.m_width == expected.m_width && actual.m_height == expected.m_height && actual.m_channels == expected.m_channels,
+                          what << ": " << actual.m_width << "x" << actual.m_height << "x" << actual.m_channels << " pixels instead of "
+                               << expected.m_width << "x" << expected.m_height << "x" << expected.m_channels);
+    BOOST_CHECK_MESSAGE(actual.m_pixels == expected.m_pixels, what << ": pixels differ");
+}
+
+static const int c_testJpegWidth = 83;
+static const int c_testJpegHeight = 61;
+
+BOOST_AUTO_TEST_CASE(ReadJpegHeaderOfEncodedImage)
+{
+    auto jpeg = CreateTestJpeg(c_testJpegWidth, c_testJpegHeight);
+
+    int width, height, components;
+    BOOST_REQUIRE(::CNTK::ReadJpegHeader(jpeg.data(), jpeg.size(), width, height, components));
+    BOOST_CHECK_EQUAL(width, c_testJpegWidth);
+    BOOST_CHECK_EQUAL(height, c_testJpegHeight);
+    BOOST_CHECK_EQUAL(components, 3);
+}
+
+BOOST_AUTO_TEST_CASE(DecodeJpegRegionMatchesFullDecode)
+{
+    BOOST_REQUIRE(IsScaledJpegDecodingSupported());
+    auto jpeg = CreateTestJpeg(c_testJpegWidth, c_testJpegHeight);
+
+    for (int denominator : { 1, 2, 4, 8 })
+    {
+        auto full = Decode(jpeg, denominator, 0, 0, c_testJpegWidth, c_testJpegHeight);
+        BOOST_REQUIRE_EQUAL(full.m_width, (c_testJpegWidth + denominator - 1) / denominator);
+        BOOST_REQUIRE_EQUAL(full.m_height, (c_testJpegHeight + denominator - 1) / denominator);
+
+        // Regions at the corners, in the middle, and across block boundaries.
+        const vector<array<int, 4>> regions {
+            { 0, 0, 16, 16 }, { 1, 1, 15, 7 }, { 17, 9, 33, 24 }, { 40, 30, 43, 31 }, { 0, 32, 83, 29 }, { 82, 60, 1, 1 }
+        };
+        for (const auto& r : regions)
+        {
+            // The scaled region covers every full-resolution pixel of the region.
+            int left = r[0] / denominator;
+            int top = r[1] / denominator;
+            int right = min(full.m_width, (r[0] + r[2] + denominator - 1) / denominator);
+            int bottom = min(full.m_height, (r[1] + r[3] + denominator - 1) / denominator);
+
+            ostringstream what;
+            what << "Region (" << r[0] << ", " << r[1] << ", " << r[2] << ", " << r[3] << ") at scale 1/" << denominator;
+            CheckSamePixels(full.Crop(left, top, right - left, bottom - top, false), Decode(jpeg, denominator, r[0], r[1], r[2], r[3]), what.str());
+        }
+    }
+}
+
+// Two random crops with flips, as applied by CropTransformer::ApplyEncoded, must give the pixels
+// of the full image cropped and flipped twice.
+BOOST_AUTO_TEST_CASE(DecodeNarrowedRegionMatchesCropOfFullDecode)
+{
+    auto jpeg = CreateTestJpeg(c_testJpegWidth, c_testJpegHeight);
+    auto full = Decode(jpeg, 1, 0, 0, c_testJpegWidth, c_testJpegHeight);
+
+    for (bool firstFlip : { false, true })
+    {
+        for (bool secondFlip : { false, true })
+        {
+            auto expected = full.Crop(7, 5, 60, 50, firstFlip);
+            expected = expected.Crop(11, 3, 35, 40, false);
+            if (secondFlip)
+                expected = expected.Crop(0, 0, expected.m_width, expected.m_height, true);
+
+            int x = 0, y = 0, width = c_testJpegWidth, height = c_testJpegHeight;
+            bool flip = false;
+            NarrowImageRegion(x, y, width, height, flip, 7, 5, 60, 50, firstFlip);
+            NarrowImageRegion(x, y, width, height, flip, 11, 3, 35, 40, secondFlip);
+
+            auto decoded = Decode(jpeg, 1, x, y, width, height);
+            ostringstream what;
+            what << "Flips " << firstFlip << ", " << secondFlip;
+            CheckSamePixels(expected, decoded.Crop(0, 0, decoded.m_width, decoded.m_height, flip), what.str());
+        }
+    }
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,161 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "../../../Source/PerformanceProfilerDll/PerformanceProfiler.h"
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Returns the content of the profiler output file in the directory whose name contains the given part.
+static string ReadProfilerFile(const boost::filesystem::path& directory, const string& namePart)
+{
+    for (boost::filesystem::directory_iterator i(directory), end; i != end; ++i)
+    {
+        if (i->path().filename().string().find(namePart) == string::npos)
+            continue;
+
+        ifstream file(i->path().string());
+        stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    BOOST_FAIL("No profiler file '" << namePart << "' in " << directory.string());
+    return string();
+}
+
+static size_t CountOccurrences(const string& text, const string& part)
+{
+    size_t count = 0;
+    for (auto pos = text.find(part); pos != string::npos; pos = text.find(part, pos + part.size()))
+        count++;
+    return count;
+}
+
+static string ThreadName(size_t thread)
+{
+    return "ProfilerTest.Thread" + to_string(thread);
+}
+
+BOOST_AUTO_TEST_SUITE(PerformanceProfilerTestSuite)
+
+BOOST_AUTO_TEST_CASE(RecordEventsFromSeveralThreads)
+{
+    auto directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("cntk-profiler-%%%%-%%%%");
+    const size_t numThreads = 8;
+    const size_t eventsPerThread = 1000;
+
+    ProfilerInit(directory.wstring(), 1024 * 1024, L"test", false);
+    ProfilerEnable(true);
+
+    // Every thread records a shared event and an event of its own, which is named after the thread.
+    int sharedEvent = ProfilerRegisterEvent("ProfilerTest.Shared");
+    vector<thread> threads;
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([=]()
+        {
+            auto name = ThreadName(t);
+            ProfilerSetThreadName(name.c_str());
+            int ownEvent = ProfilerRegisterEvent(name.c_str());
+            for (size_t i = 0; i < eventsPerThread; ++i)
+            {
+                ProfilerTimeEnd(ProfilerTimeBegin(), sharedEvent);
+                ProfilerTimeEnd(ProfilerTimeBegin(), ownEvent);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+    ProfilerClose();
+
+    // The detail file has every event, with the id of the thread that recorded it.
+    auto detail = ReadProfilerFile(directory, "_detail_test");
+    BOOST_CHECK_EQUAL(CountOccurrences(detail, "\"name\":\"ProfilerTest.Shared\", \"cat\":\"PERF\", \"ph\":\"X\""), numThreads * eventsPerThread);
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        auto name = ThreadName(t);
+        auto metadata = detail.find("\"ph\":\"M\", \"args\":{\"name\":\"" + name + "\"}");
+        BOOST_REQUIRE_MESSAGE(metadata != string::npos, "No name record for " << name);
+
+        auto tidStart = detail.rfind("\"tid\":", metadata);
+        auto tid = detail.substr(tidStart, detail.find(',', tidStart) - tidStart);
+        BOOST_CHECK_EQUAL(CountOccurrences(detail, "\"name\":\"" + name + "\", \"cat\":\"PERF\""), eventsPerThread);
+        BOOST_CHECK_EQUAL(CountOccurrences(detail, tid + ", \"name\":\"" + name + "\", \"cat\":\"PERF\""), eventsPerThread);
+    }
+
+    // The summary report adds up the events of all threads.
+    auto summary = ReadProfilerFile(directory, "_summary_test");
+    auto line = summary.find("ProfilerTest.Shared");
+    BOOST_REQUIRE(line != string::npos);
+    auto sharedStats = summary.substr(line, summary.find('\n', line) - line);
+    char count[32];
+    sprintf(count, "%16d ", (int)(numThreads * eventsPerThread));
+    BOOST_CHECK_MESSAGE(sharedStats.find(count) != string::npos, sharedStats);
+
+    boost::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_CASE(CloseWhileThreadsRecordEvents)
+{
+    auto directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("cntk-profiler-%%%%-%%%%");
+    const size_t numThreads = 4;
+
+    // A small buffer, so that the threads also overwrite records while the profiler closes.
+    ProfilerInit(directory.wstring(), 64 * 1024, L"test", false);
+    ProfilerEnable(true);
+
+    int sharedEvent = ProfilerRegisterEvent("ProfilerTest.Shared");
+    atomic<bool> stop(false);
+    atomic<size_t> recording(0);
+    vector<thread> threads;
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            ProfilerSetThreadName("ProfilerTest.Recorder");
+            bool first = true;
+            while (!stop)
+            {
+                auto flowId = ProfilerNewFlowId();
+                ProfilerFlowBegin(flowId, sharedEvent);
+                ProfilerTimeEnd(ProfilerTimeBegin(), sharedEvent);
+                ProfilerFlowEnd(flowId, sharedEvent);
+                if (first)
+                    recording++;
+                first = false;
+            }
+        });
+    }
+
+    while (recording < numThreads)
+        this_thread::yield();
+    ProfilerClose();
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+
+    // The detail file is complete, and holds events of every thread.
+    auto detail = ReadProfilerFile(directory, "_detail_test");
+    BOOST_CHECK(detail.size() > 4 && detail.compare(detail.size() - 3, 3, "\n]\n") == 0);
+    BOOST_CHECK_EQUAL(CountOccurrences(detail, "\"args\":{\"name\":\"ProfilerTest.Recorder\"}"), numThreads);
+    BOOST_CHECK(CountOccurrences(detail, "\"name\":\"ProfilerTest.Shared\", \"cat\":\"PERF\"") >= numThreads);
+
+    boost::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -5,6 +5,7 @@
 
 #include "stdafx.h"
 #include <numeric>
+#include <omp.h>
 #include <random>
 #include <set>
 #include "NoRandomizer.h"
@@ -18,6 +19,8 @@
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
 #include "BufferedFileReader.h"
+#include "MultiProcessSequenceEnumerator.h"
+#include "ChunkCache.h"
 
 #pragma warning(push)
 // disable warning about possible mod 0 operation in uniform_int_distribution
@@ -1078,6 +1081,293 @@ BOOST_AUTO_TEST_CASE(LTNoRandomizerCheckNoDuplicateSequence)
     }
 }
 
+#ifndef _WIN32
+// Reads up to maxMinibatches minibatches (stopping at the end of the epoch), returning the values of the sequences in each.
+static vector<multiset<float>> ReadMinibatches(SequenceEnumeratorPtr enumerator, size_t sampleCount, size_t maxMinibatches = SIZE_MAX)
+{
+    vector<multiset<float>> minibatches;
+    for (size_t i = 0; i < maxMinibatches; ++i)
+    {
+        Sequences sequences = enumerator->GetNextSequences(sampleCount, sampleCount);
+        multiset<float> minibatch;
+        if (!sequences.m_data.empty())
+        {
+            for (const auto& s : sequences.m_data[0])
+                minibatch.insert(*static_cast<const float*>(s->GetDataBuffer()));
+        }
+        minibatches.push_back(minibatch);
+
+        if (sequences.m_endOfEpoch)
+            break;
+    }
+    return minibatches;
+}
+
+BOOST_AUTO_TEST_CASE(MultiProcessSequenceEnumeratorGlobalTimeline)
+{
+    const size_t numChunks = 10;
+    const size_t numSequencesPerChunk = 5;
+    const size_t numWorkers = 2;
+    const size_t minibatchSize = 7;
+
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data);
+    auto createRandomizer = [&]() -> SequenceEnumeratorPtr
+    {
+        return make_shared<BlockRandomizer>(0, 2 * numSequencesPerChunk, mockDeserializer, true, false);
+    };
+
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = minibatchSize;
+    config.m_totalEpochSizeInSamples = data.size();
+    config.m_epochIndex = 0;
+
+    // Worker processes have to return together what the same number of distributed workers would.
+    vector<multiset<float>> expected;
+    for (size_t w = 0; w < numWorkers; ++w)
+    {
+        auto randomizer = createRandomizer();
+        EpochConfiguration workerConfig = config;
+        workerConfig.m_numberOfWorkers = numWorkers;
+        workerConfig.m_workerRank = w;
+        randomizer->StartEpoch(workerConfig);
+
+        auto minibatches = ReadMinibatches(randomizer, minibatchSize);
+        expected.resize(max(expected.size(), minibatches.size()));
+        for (size_t i = 0; i < minibatches.size(); ++i)
+            expected[i].insert(minibatches[i].begin(), minibatches[i].end());
+    }
+
+    auto enumerator = make_shared<MultiProcessSequenceEnumerator>(mockDeserializer->StreamInfos(), numWorkers,
+        [&](size_t) { return createRandomizer(); }, /*localTimeline =*/ false, /*sharedMemorySizePerWorker =*/ 1024 * 1024);
+    enumerator->StartEpoch(config);
+
+    auto actual = ReadMinibatches(enumerator, minibatchSize);
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    multiset<float> all;
+    for (size_t i = 0; i < actual.size(); ++i)
+    {
+        BOOST_CHECK(actual[i] == expected[i]);
+        all.insert(actual[i].begin(), actual[i].end());
+    }
+    BOOST_CHECK(all == multiset<float>(data.begin(), data.end()));
+
+    // Prefetched minibatches are dropped when the state is restored or the minibatch size changes.
+    enumerator->StartEpoch(config);
+    ReadMinibatches(enumerator, minibatchSize, 3);
+    auto state = enumerator->GetState();
+    auto rest = ReadMinibatches(enumerator, minibatchSize);
+    BOOST_CHECK(rest == vector<multiset<float>>(expected.begin() + 3, expected.end()));
+
+    enumerator->SetState(state);
+    BOOST_CHECK(ReadMinibatches(enumerator, minibatchSize) == rest);
+
+    enumerator->SetState(state);
+    ReadMinibatches(enumerator, minibatchSize, 1);
+    size_t total = 0;
+    for (const auto& m : ReadMinibatches(enumerator, 1))
+        total += m.size();
+    BOOST_CHECK_EQUAL(total, data.size() - accumulate(expected.begin(), expected.begin() + 4, (size_t)0,
+        [](size_t sum, const multiset<float>& m) { return sum + m.size(); }));
+}
+
+BOOST_AUTO_TEST_CASE(MultiProcessSequenceEnumeratorLocalTimeline)
+{
+    const size_t numChunks = 4;
+    const size_t numSequencesPerChunk = 10;
+    const size_t numWorkers = 3;
+    const size_t minibatchSize = 4;
+
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data);
+
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = minibatchSize;
+    config.m_totalEpochSizeInSamples = data.size();
+    config.m_totalEpochSizeInSweeps = 1;
+    config.m_epochIndex = 0;
+
+    // The worker processes split the local samples, so that a sweep returns every sequence once.
+    auto enumerator = make_shared<MultiProcessSequenceEnumerator>(mockDeserializer->StreamInfos(), numWorkers,
+        [&](size_t) { return make_shared<LTNoRandomizer>(mockDeserializer); }, /*localTimeline =*/ true, /*sharedMemorySizePerWorker =*/ 1024 * 1024);
+    enumerator->StartEpoch(config);
+
+    auto minibatches = ReadMinibatches(enumerator, minibatchSize, 2);
+    auto state = enumerator->GetState();
+    BOOST_CHECK(state.find(L"baseSampleCount.worker2") != state.end());
+
+    auto rest = ReadMinibatches(enumerator, minibatchSize);
+    multiset<float> all;
+    for (const auto& m : minibatches)
+        all.insert(m.begin(), m.end());
+    for (const auto& m : rest)
+    {
+        BOOST_CHECK_LE(m.size(), minibatchSize);
+        all.insert(m.begin(), m.end());
+    }
+    BOOST_CHECK(all == multiset<float>(data.begin(), data.end()));
+
+    enumerator->SetState(state);
+    BOOST_CHECK(ReadMinibatches(enumerator, minibatchSize) == rest);
+}
+
+// The OpenMP thread pool of the training process does not survive fork(), so the workers must not start parallel regions.
+BOOST_AUTO_TEST_CASE(MultiProcessSequenceEnumeratorSingleThreadedWorkers)
+{
+    const size_t numChunks = 2;
+    const size_t numSequencesPerChunk = 3;
+
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data);
+
+    // Makes sure the pool of the training process has threads when the workers are forked.
+    int numThreads = 0;
+#pragma omp parallel num_threads(4)
+#pragma omp master
+    numThreads = omp_get_num_threads();
+    BOOST_REQUIRE_GT(numThreads, 1);
+
+    auto enumerator = make_shared<MultiProcessSequenceEnumerator>(mockDeserializer->StreamInfos(), 2,
+        [&](size_t) -> SequenceEnumeratorPtr
+        {
+            int numWorkerThreads = 0;
+#pragma omp parallel num_threads(4)
+#pragma omp master
+            numWorkerThreads = omp_get_num_threads();
+            if (numWorkerThreads != 1 || omp_get_max_threads() != 1)
+                RuntimeError("a parallel region in a worker process ran with %d threads.", numWorkerThreads);
+            return make_shared<LTNoRandomizer>(mockDeserializer);
+        }, /*localTimeline =*/ true, /*sharedMemorySizePerWorker =*/ 1024 * 1024);
+
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = data.size();
+    config.m_totalEpochSizeInSamples = data.size();
+    config.m_totalEpochSizeInSweeps = 1;
+    config.m_epochIndex = 0;
+    enumerator->StartEpoch(config);
+
+    multiset<float> all;
+    for (const auto& m : ReadMinibatches(enumerator, data.size()))
+        all.insert(m.begin(), m.end());
+    BOOST_CHECK(all == multiset<float>(data.begin(), data.end()));
+
+    // The training process itself is not affected.
+#pragma omp parallel num_threads(4)
+#pragma omp master
+    numThreads = omp_get_num_threads();
+    BOOST_CHECK_GT(numThreads, 1);
+}
+#endif
+
+// MockDeserializer with a known sample shape, which the chunk cache needs to serialize the sequences.
+class MockScalarDeserializer : public MockDeserializer
+{
+public:
+    MockScalarDeserializer(size_t numChunks, size_t numSequencesPerChunks, const vector<float>& data)
+        : MockDeserializer(numChunks, numSequencesPerChunks, data)
+    {}
+
+    vector<StreamInformation> StreamInfos() override
+    {
+        auto streams = MockDeserializer::StreamInfos();
+        for (auto& stream : streams)
+            stream.m_sampleLayout = NDShape({ 1 });
+        return streams;
+    }
+};
+
+static vector<float> ReadCachedChunk(ChunkCache& cache, ChunkIdType chunkId, size_t numSequencesPerChunk)
+{
+    vector<float> values;
+    vector<SequenceDataPtr> sequences;
+    auto chunk = cache.GetChunk(chunkId);
+    for (size_t i = chunkId * numSequencesPerChunk; i < (chunkId + 1) * numSequencesPerChunk; i++)
+    {
+        sequences.clear();
+        chunk->GetSequence(i, sequences);
+        BOOST_REQUIRE_EQUAL(sequences.size(), 1);
+        values.push_back(*static_cast<const float*>(sequences[0]->GetDataBuffer()));
+    }
+    return values;
+}
+
+static uint64_t CacheFileSize(const string& fileName)
+{
+    FILE* file = fopen(fileName.c_str(), "rb");
+    BOOST_REQUIRE(file != nullptr);
+    fseek(file, 0, SEEK_END);
+    uint64_t size = (uint64_t)ftell(file);
+    fclose(file);
+    return size;
+}
+
+static void AppendToCacheFile(const string& fileName, const void* data, size_t size)
+{
+    FILE* file = fopen(fileName.c_str(), "ab");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE_EQUAL(fwrite(data, 1, size, file), size);
+    fclose(file);
+}
+
+// Records that were not completely written by an earlier run, or are not records at all, must not be served,
+// and must not be mistaken for records once new, shorter records are written after them.
+BOOST_AUTO_TEST_CASE(ChunkCacheOnDiskIgnoresIncompleteRecords)
+{
+    const size_t numChunks = 3;
+    const size_t numSequencesPerChunk = 4;
+    const wstring cacheFile = L"ChunkCacheTest.cache";
+    const string narrowCacheFile = "ChunkCacheTest.cache";
+
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto expected = [&](ChunkIdType chunkId) { return vector<float>(data.begin() + chunkId * numSequencesPerChunk, data.begin() + (chunkId + 1) * numSequencesPerChunk); };
+
+    uint64_t sizeWithChunk0;
+    {
+        ChunkCache cache(make_shared<MockScalarDeserializer>(numChunks, numSequencesPerChunk, data), cacheFile, 0);
+        BOOST_CHECK(ReadCachedChunk(cache, 0, numSequencesPerChunk) == expected(0));
+        sizeWithChunk0 = CacheFileSize(narrowCacheFile);
+    }
+
+    // a long record that was never committed, e.g. because the process was killed while writing it
+    vector<uint32_t> leftover(1024, 0x4b4e4843);
+    leftover[0] = 0;
+    leftover[1] = 1;
+    AppendToCacheFile(narrowCacheFile, leftover.data(), leftover.size() * sizeof(uint32_t));
+
+    uint64_t sizeWithChunk1;
+    {
+        ChunkCache cache(make_shared<MockScalarDeserializer>(numChunks, numSequencesPerChunk, data), cacheFile, 0);
+        BOOST_CHECK_EQUAL(CacheFileSize(narrowCacheFile), sizeWithChunk0);
+        BOOST_CHECK(ReadCachedChunk(cache, 1, numSequencesPerChunk) == expected(1));
+        sizeWithChunk1 = CacheFileSize(narrowCacheFile);
+    }
+
+    // a committed record header with a chunk id the deserializer does not have
+    const uint32_t badRecord[4] = { 0x4b4e4843, (uint32_t)numChunks, 0, 0 };
+    AppendToCacheFile(narrowCacheFile, badRecord, sizeof(badRecord));
+
+    {
+        // chunks 0 and 1 are served from the file, which is not written to
+        ChunkCache cache(make_shared<MockScalarDeserializer>(numChunks, numSequencesPerChunk, data), cacheFile, 0);
+        BOOST_CHECK(ReadCachedChunk(cache, 0, numSequencesPerChunk) == expected(0));
+        BOOST_CHECK(ReadCachedChunk(cache, 1, numSequencesPerChunk) == expected(1));
+        BOOST_CHECK_EQUAL(CacheFileSize(narrowCacheFile), sizeWithChunk1);
+        BOOST_CHECK(ReadCachedChunk(cache, 2, numSequencesPerChunk) == expected(2));
+    }
+
+    remove(narrowCacheFile.c_str());
+}
+
 BOOST_AUTO_TEST_CASE(DefaultCorpusDescriptor)
 {
     const int seed = 13;
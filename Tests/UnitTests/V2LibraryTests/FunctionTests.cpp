@@ -1200,6 +1200,95 @@ void TestMatMul(const DeviceDescriptor& device)
     }
 }
 
+void TestCloneForInference(const DeviceDescriptor& device)
+{
+    auto countOps = [](FunctionPtr function, const std::wstring& opName)
+    {
+        size_t count = 0;
+        function->PreorderTraverse([&count, &opName](const FunctionPtr& f) { if (f->OpName() == opName) count++; });
+        return count;
+    };
+
+    auto constantOf = [&device](const NDShape& shape, std::vector<float> data, const std::wstring& name)
+    {
+        return Constant(MakeSharedObject<NDArrayView>(shape, data, /*readOnly=*/true)->DeepClone(device), name);
+    };
+
+    // Times, bias, non-spatial BatchNormalization, Dropout and ReLU, plus the result of a computation on Constants.
+    const size_t inputDim = 6, outputDim = 4;
+    auto features = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto timesParam = Parameter(NDArrayView::RandomUniform<float>({ outputDim, inputDim }, -0.5, 0.5, 1, device));
+    auto biasParam = Parameter(NDArrayView::RandomUniform<float>({ outputDim }, -0.5, 0.5, 2, device));
+    auto dense = BatchNormalization(Plus(Times(timesParam, features), biasParam),
+                                    Parameter(NDArrayView::RandomUniform<float>({ outputDim }, 0.5, 1.5, 3, device)),
+                                    Parameter(NDArrayView::RandomUniform<float>({ outputDim }, -0.5, 0.5, 4, device)),
+                                    constantOf({ outputDim }, { 0.1f, -0.2f, 0.3f, 0.05f }, L"mean"),
+                                    constantOf({ outputDim }, { 0.5f, 2.0f, 1.5f, 0.25f }, L"variance"),
+                                    Constant::Scalar(100.0f), /*spatial=*/false);
+    auto constantTerm = ElementTimes(constantOf({ outputDim }, { 1.0f, 2.0f, 3.0f, 4.0f }, L"constantTerm"), Constant::Scalar(0.5f));
+    auto z = Plus(ReLU(Dropout(dense, 0.5)), constantTerm, L"z");
+
+    // Convolution followed by spatial BatchNormalization.
+    const size_t numInputChannels = 2, numOutputChannels = 3;
+    auto image = InputVariable({ 5, 5, numInputChannels }, DataType::Float, L"image");
+    auto kernel = Parameter(NDArrayView::RandomUniform<float>({ 3, 3, numInputChannels, numOutputChannels }, -0.5, 0.5, 5, device));
+    auto y = BatchNormalization(Convolution(kernel, image, { 1, 1, numInputChannels }),
+                                Parameter(NDArrayView::RandomUniform<float>({ numOutputChannels }, 0.5, 1.5, 6, device)),
+                                Parameter(NDArrayView::RandomUniform<float>({ numOutputChannels }, -0.5, 0.5, 7, device)),
+                                constantOf({ numOutputChannels }, { 0.2f, -0.1f, 0.4f }, L"convMean"),
+                                constantOf({ numOutputChannels }, { 1.5f, 0.5f, 3.0f }, L"convVariance"),
+                                Constant::Scalar(100.0f), /*spatial=*/true, 0, 0, 0.00001, /*useCuDNNEngine=*/false, false, L"y");
+
+    auto model = Combine({ z, y });
+    auto optimized = model->CloneForInference(device);
+
+    BOOST_TEST(countOps(optimized, L"BatchNormalization") == 0);
+    BOOST_TEST(countOps(optimized, L"Dropout") == 0);
+    BOOST_TEST(countOps(optimized, L"ElementTimes") == 0);
+    BOOST_TEST(optimized->Parameters().empty());
+
+    const size_t batchSize = 3;
+    std::vector<float> featuresData(inputDim * batchSize), imageData(image.Shape().TotalSize() * batchSize);
+    for (size_t i = 0; i < featuresData.size(); ++i)
+        featuresData[i] = (float)rand() / RAND_MAX - 0.5f;
+    for (size_t i = 0; i < imageData.size(); ++i)
+        imageData[i] = (float)rand() / RAND_MAX - 0.5f;
+
+    auto evaluate = [&](const FunctionPtr& function, const std::wstring& outputName)
+    {
+        auto arguments = function->Arguments();
+        std::unordered_map<Variable, ValuePtr> inputs;
+        for (const auto& argument : arguments)
+            inputs[argument] = Value::CreateBatch(argument.Shape(), (argument.Name() == L"features") ? featuresData : imageData, device);
+
+        auto outputs = function->Outputs();
+        auto output = *std::find_if(outputs.begin(), outputs.end(), [&outputName](const Variable& v) { return v.Name() == outputName; });
+        std::unordered_map<Variable, ValuePtr> outputValues = { { output, nullptr } };
+        function->Evaluate(inputs, outputValues, device);
+
+        std::vector<std::vector<float>> sequences;
+        outputValues[output]->CopyVariableValueTo(output, sequences);
+        std::vector<float> result;
+        for (const auto& sequence : sequences)
+            result.insert(result.end(), sequence.begin(), sequence.end());
+        return result;
+    };
+
+    FloatingPointVectorCompare(evaluate(optimized, L"z"), evaluate(model, L"z"), "TestCloneForInference: Output 'z' of the optimized model does not match that of the original model.");
+    FloatingPointVectorCompare(evaluate(optimized, L"y"), evaluate(model, L"y"), "TestCloneForInference: Output 'y' of the optimized model does not match that of the original model.");
+
+    // The optimized model can be saved and loaded like any other.
+    const std::wstring tempModelPath = L"cloneForInference.model";
+    if ((_wunlink(tempModelPath.c_str()) != 0) && (errno != ENOENT))
+        BOOST_ERROR("Error deleting temp model file 'cloneForInference.model'");
+    optimized->Save(tempModelPath);
+    auto loaded = Function::Load(tempModelPath, device);
+    if (_wunlink(tempModelPath.c_str()) != 0)
+        BOOST_ERROR("Error deleting temp model file 'cloneForInference.model'");
+
+    FloatingPointVectorCompare(evaluate(loaded, L"z"), evaluate(model, L"z"), "TestCloneForInference: Output 'z' of the loaded model does not match that of the original model.");
+}
+
 BOOST_AUTO_TEST_SUITE(FunctionSuite)
 
 BOOST_AUTO_TEST_CASE(FindNameInCPU)
@@ -1334,6 +1423,14 @@ BOOST_AUTO_TEST_CASE(MatMul)
         TestMatMul(DeviceDescriptor::GPUDevice(0));
 }
 
+BOOST_AUTO_TEST_CASE(CloneForInference)
+{
+    if (ShouldRunOnCpu())
+        TestCloneForInference(DeviceDescriptor::CPUDevice());
+    if (ShouldRunOnGpu())
+        TestCloneForInference(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }}
@@ -141,6 +141,180 @@ void TestUniversalLearner(size_t numParameters, size_t numMinibatches, const Dev
 
 }
 
+// Runs two copies of the same learner, with and without fused updates, and compares the parameters.
+template <typename ElementType>
+void TestFusedUpdate(const function<LearnerPtr(const vector<Parameter>&)>& createLearner, size_t numMinibatches, const char* name)
+{
+    auto device = DeviceDescriptor::CPUDevice();
+    vector<NDShape> shapes = { { 3 }, { 4, 5 }, { 1 }, { 130, 200 }, { 2, 3, 4 } };
+    vector<Parameter> parameters[2];
+    for (auto& copy : parameters)
+    {
+        for (size_t i = 0; i < shapes.size(); i++)
+            copy.push_back(Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, (unsigned long)i, device), L"parameter_" + to_wstring(i)));
+    }
+
+    LearnerPtr learners[2] = { createLearner(parameters[0]), createLearner(parameters[1]) };
+    auto seed = (unsigned long)rng();
+    for (size_t minibatch = 0; minibatch < numMinibatches; minibatch++)
+    {
+        for (size_t copy = 0; copy < 2; copy++)
+        {
+            unordered_map<Parameter, NDArrayViewPtr> gradientValues;
+            for (size_t i = 0; i < shapes.size(); i++)
+                gradientValues[parameters[copy][i]] = NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, seed + (unsigned long)(minibatch * shapes.size() + i), device);
+
+            Internal::SetFusedLearnerUpdates(copy == 0);
+            learners[copy]->Update(gradientValues, 4, false);
+        }
+    }
+    Internal::SetFusedLearnerUpdates(true);
+
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        auto size = shapes[i].TotalSize();
+        auto fused = parameters[0][i].Value()->DataBuffer<ElementType>();
+        auto unfused = parameters[1][i].Value()->DataBuffer<ElementType>();
+        FloatingPointVectorCompare(vector<ElementType>(fused, fused + size), vector<ElementType>(unfused, unfused + size), name);
+    }
+}
+
+template <typename ElementType>
+void TestFusedLearnerUpdates(size_t numMinibatches)
+{
+    AdditionalLearningOptions regularization;
+    regularization.l1RegularizationWeight = 0.001;
+    regularization.l2RegularizationWeight = 0.01;
+    regularization.gradientClippingThresholdPerSample = 0.05;
+    regularization.gradientClippingWithTruncation = false;
+
+    AdditionalLearningOptions truncation;
+    truncation.gradientClippingThresholdPerSample = 0.1;
+
+    auto learningRate = TrainingParameterPerSampleSchedule<double>(0.05);
+    auto momentum = MomentumAsTimeConstantSchedule(100.0);
+    for (const auto& options : { AdditionalLearningOptions(), regularization, truncation })
+    {
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return SGDLearner(p, learningRate, options); }, numMinibatches,
+                                     "Fused SGD update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return MomentumSGDLearner(p, learningRate, momentum, true, options); }, numMinibatches,
+                                     "Fused momentum SGD update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return NesterovLearner(p, learningRate, momentum, false, options); }, numMinibatches,
+                                     "Fused Nesterov update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return AdaGradLearner(p, learningRate, false, options); }, numMinibatches,
+                                     "Fused AdaGrad update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return RMSPropLearner(p, learningRate, 0.95, 1.2, 0.7, 10.0, 0.001, false, options); }, numMinibatches,
+                                     "Fused RMSProp update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return FSAdaGradLearner(p, learningRate, momentum, true, MomentumAsTimeConstantSchedule(1000.0), options); }, numMinibatches,
+                                     "Fused FSAdaGrad update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return AdamLearner(p, learningRate, momentum, true, MomentumSchedule(0.99, 1), 1e-8, false, options); }, numMinibatches,
+                                     "Fused Adam update does not match");
+        TestFusedUpdate<ElementType>([&](const vector<Parameter>& p) { return AdamLearner(p, learningRate, momentum, true, MomentumSchedule(0.99, 1), 1e-8, true, options); }, numMinibatches,
+                                     "Fused Adamax update does not match");
+    }
+}
+
+// Communicator of two workers, where the other worker always sends the same data as this one.
+// Keeps the last input of Concatenate(), i.e. the (index, value) pairs sent by the sparsified learner.
+class MirroredCommunicator : public DistributedCommunicator
+{
+public:
+    MirroredCommunicator()
+        : m_workers({ { 0, L"host" }, { 1, L"host" } })
+    {
+    }
+
+    const unordered_set<DistributedWorkerDescriptor>& Workers() const override { return m_workers; }
+    const DistributedWorkerDescriptor& CurrentWorker() const override { return *m_workers.find({ 0, L"host" }); }
+
+    void Concatenate(const vector<NDArrayViewPtr>& input, vector<NDArrayViewPtr>& output, const unordered_set<DistributedWorkerDescriptor>&) override
+    {
+        m_sent = input[0]->DeepClone();
+        auto size = input[0]->Shape().TotalSize();
+        output[0] = MakeSharedObject<NDArrayView>(input[0]->GetDataType(), NDShape{ 2 * size }, DeviceDescriptor::CPUDevice());
+        output[0]->SliceView({ 0 }, { size })->CopyFrom(*input[0]);
+        output[0]->SliceView({ size }, { size })->CopyFrom(*input[0]);
+    }
+
+    // the minibatch header is not checked
+    void AggregateInPlace(const vector<NDArrayViewPtr>&, const unordered_set<DistributedWorkerDescriptor>&) override {}
+
+    DistributedCommunicatorPtr SubGroup(const unordered_set<DistributedWorkerDescriptor>&) const override { NOT_IMPLEMENTED; }
+    void Concatenate(const vector<ValuePtr>&, vector<ValuePtr>&, const unordered_set<DistributedWorkerDescriptor>&) override { NOT_IMPLEMENTED; }
+    void Gather(const Dictionary&, vector<DictionaryPtr>&, const unordered_set<DistributedWorkerDescriptor>&) override { NOT_IMPLEMENTED; }
+    void Aggregate(const vector<NDArrayViewPtr>&, vector<NDArrayViewPtr>&, const unordered_set<DistributedWorkerDescriptor>&) override { NOT_IMPLEMENTED; }
+    void Barrier() override {}
+
+    NDArrayViewPtr m_sent;
+
+private:
+    unordered_set<DistributedWorkerDescriptor> m_workers;
+};
+
+// Runs one step of the sparsified learner on 'gradient', checks the pairs sent for each bucket of 4 elements
+// (in any order within the bucket; index -1 for a slot without an entry) and the aggregated gradient of both workers.
+template <typename ElementType>
+void TestSparsifiedStep(const DistributedLearnerPtr& learner, MirroredCommunicator& communicator, const Parameter& parameter,
+                        vector<ElementType> gradient, const vector<vector<pair<ElementType, ElementType>>>& expectedSent,
+                        const vector<ElementType>& expectedAggregated, const char* message)
+{
+    unordered_map<Parameter, NDArrayViewPtr> gradientValues{ { parameter, MakeSharedObject<NDArrayView>(parameter.Shape(), gradient) } };
+    MinibatchInfo info{ false, false, 1,
+                        MakeSharedObject<NDArrayView>(0.0, NDShape{}, DeviceDescriptor::CPUDevice()),
+                        MakeSharedObject<NDArrayView>(0.0, NDShape{}, DeviceDescriptor::CPUDevice()) };
+    learner->Update(gradientValues, info);
+
+    const ElementType* sent = communicator.m_sent->DataBuffer<ElementType>();
+    for (const auto& expectedBucket : expectedSent)
+    {
+        vector<pair<ElementType, ElementType>> bucket;
+        for (size_t j = 0; j < expectedBucket.size(); ++j, sent += 2)
+            bucket.push_back(make_pair(sent[0], sent[1]));
+        sort(bucket.begin(), bucket.end());
+        for (size_t j = 0; j < bucket.size(); ++j)
+        {
+            FloatingPointCompare(bucket[j].first, expectedBucket[j].first, message);
+            FloatingPointCompare(bucket[j].second, expectedBucket[j].second, message);
+        }
+    }
+    BOOST_TEST(sent == communicator.m_sent->DataBuffer<ElementType>() + communicator.m_sent->Shape().TotalSize(), message);
+
+    FloatingPointVectorCompare(gradient, expectedAggregated, message);
+}
+
+template <typename ElementType>
+void TestSparsifiedDistributedLearner()
+{
+    auto device = DeviceDescriptor::CPUDevice();
+    Parameter parameter(NDArrayView::RandomUniform<ElementType>(NDShape{ 8 }, -1.0, 1.0, 1, device), L"parameter");
+    auto communicator = make_shared<MirroredCommunicator>();
+
+    // two buckets of 4 elements; 2 entries are sent from each
+    auto learner = CreateSparsifiedDataParallelDistributedLearner(communicator,
+        SGDLearner({ parameter }, TrainingParameterPerSampleSchedule(0.1)), 0, /*density=*/0.5, /*bucketSize=*/4);
+
+    // step 1: the largest entries are sent, the residual is [0.1, 0, 0.2, 0 | 0, 0.3, 0, 0.05]
+    TestSparsifiedStep<ElementType>(learner, *communicator, parameter,
+        { 0.1f, -3, 0.2f, 1, 5, 0.3f, -0.4f, 0.05f },
+        { { { 1, -3 }, { 3, 1 } }, { { 0, 5 }, { 2, -0.4f } } },
+        { 0, -6, 0, 2, 10, 0, -0.8f, 0 },
+        "Sparsified learner: first step does not match");
+
+    // step 2: the residual is added to the gradient; what remains is [0, 0, 0, 0.02 | 0, 0, 0, 0]
+    TestSparsifiedStep<ElementType>(learner, *communicator, parameter,
+        { 0.15f, 0, 0.1f, 0.02f, 0, 0.1f, 0, 0.01f },
+        { { { 0, 0.25f }, { 2, 0.3f } }, { { 1, 0.4f }, { 3, 0.06f } } },
+        { 0.5f, 0, 0.6f, 0, 0, 0.8f, 0, 0.12f },
+        "Sparsified learner: second step does not match");
+
+    // step 3: only the residual is left to send; slots of zero entries are sent as index -1
+    TestSparsifiedStep<ElementType>(learner, *communicator, parameter,
+        { 0, 0, 0, 0, 0, 0, 0, 0 },
+        { { { -1, 0 }, { 3, 0.02f } }, { { -1, 0 }, { -1, 0 } } },
+        { 0, 0, 0, 0.04f, 0, 0, 0, 0 },
+        "Sparsified learner: third step does not match");
+}
+
 void TestTrainingParametersSchedule()
 {
     LearningRateSchedule schedule1(0.5, 1);
@@ -477,6 +651,21 @@ BOOST_AUTO_TEST_CASE(CreateAndUpdateAdamaxLearner)
     }
 }
 
+BOOST_AUTO_TEST_CASE(FusedUpdatesMatchPerParameterUpdates)
+{
+    if (ShouldRunOnCpu())
+    {
+        TestFusedLearnerUpdates<float>(3);
+        TestFusedLearnerUpdates<double>(3);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SparsifiedDistributedLearnerSelectsAndKeepsResiduals)
+{
+    TestSparsifiedDistributedLearner<float>();
+    TestSparsifiedDistributedLearner<double>();
+}
+
 BOOST_AUTO_TEST_CASE(TestResettingLearningRate)
 {
     NDShape shape = { 1 };
@@ -7,6 +7,7 @@
 #include <functional>
 #include "Common.h"
 #include <numeric>
+#include <thread>
 #include "CNTKLibraryC.h"
 
 using namespace CNTK;
@@ -703,6 +704,147 @@ void ParityCandCppLSTMModel(DeviceDescriptor device, CNTK_DeviceDescriptor cdevi
         RequireClose(result2, cresult2, 0.00001f, 0.01f);
     }
 
+    // Frame mode, with the sequence continued from other threads, as a caller on a thread pool does.
+    {
+        uint32_t s = (uint32_t)inputDim;
+        CNTK_Value frame;
+        frame.data = inputData.data();
+        frame.shape.size = 1;
+        frame.shape.value = &s;
+
+        std::vector<std::vector<float>> resultFrames(numberOfFrames);
+        std::vector<int> codes(numberOfFrames, CNTK_SUCCESS);
+        auto evaluateFrame = [&](size_t i)
+        {
+            auto current = frame;
+            current.data += i * inputDim;
+            bool sequenceFlags[]{ i == 0 };
+            CNTK_Value* outputValues = nullptr;
+            auto status = CNTK_EvaluateSequence(model, argumentInfos, &current, sequenceFlags, numArguments,
+                outputInfos, numOutputs, &outputValues);
+            codes[i] = status.value;
+            if (status.value != CNTK_SUCCESS)
+                return;
+
+            NDShape outputShape(std::vector<size_t>(outputValues[0].shape.value, outputValues[0].shape.value + outputValues[0].shape.size));
+            resultFrames[i].assign(outputValues[0].data, outputValues[0].data + outputShape.TotalSize());
+            for (uint32_t j = 0; j < numOutputs; j++)
+                CNTK_CleanValue(&outputValues[j]);
+            CNTK_ReleaseArray(outputValues);
+        };
+
+        // The first frame on this thread, every other frame on a new thread that has not evaluated before.
+        evaluateFrame(0);
+        for (size_t i = 1; i < numberOfFrames; ++i)
+            std::thread(evaluateFrame, i).join();
+
+        for (size_t i = 0; i < numberOfFrames; ++i)
+            BOOST_REQUIRE_EQUAL(codes[i], CNTK_SUCCESS);
+        RequireClose(result1, CombineVectors({ resultFrames[0], resultFrames[1], resultFrames[2] }), 0.00001f, 0.01f);
+    }
+
+    // Concurrent evaluation on the same model handle.
+    {
+        auto three = std::vector<uint32_t>{ (uint32_t)inputDim, (uint32_t)numberOfFrames };
+        CNTK_Value threeFrames;
+        threeFrames.data = inputData.data();
+        threeFrames.shape.size = 2;
+        threeFrames.shape.value = three.data();
+
+        const size_t numThreads = 4;
+        std::vector<std::vector<float>> cresults(numThreads);
+        std::vector<int> codes(numThreads, CNTK_SUCCESS);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                bool sequenceFlags[]{ true };
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    CNTK_Value* outputValues = nullptr;
+                    auto status = CNTK_EvaluateSequence(model, argumentInfos, &threeFrames, sequenceFlags, numArguments,
+                        outputInfos, numOutputs, &outputValues);
+                    codes[t] = status.value;
+                    if (status.value != CNTK_SUCCESS)
+                        return;
+
+                    NDShape outputShape(std::vector<size_t>(outputValues[0].shape.value, outputValues[0].shape.value + outputValues[0].shape.size));
+                    cresults[t].assign(outputValues[0].data, outputValues[0].data + outputShape.TotalSize());
+                    for (uint32_t i = 0; i < numOutputs; i++)
+                        CNTK_CleanValue(&outputValues[i]);
+                    CNTK_ReleaseArray(outputValues);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            BOOST_REQUIRE_EQUAL(codes[t], CNTK_SUCCESS);
+            RequireClose(result1, cresults[t], 0.00001f, 0.01f);
+        }
+    }
+
+    // Concurrent evaluation in batches, with sequences of different lengths.
+    {
+        CNTK_ModelHandle batched;
+        rc = CNTK_CloneModel(model, CNTK_ModelParameterShare, false, &batched);
+        BOOST_REQUIRE_EQUAL(rc.value, CNTK_SUCCESS);
+
+        const uint32_t numThreads = 4;
+        rc = CNTK_EnableRequestBatching(batched, numThreads, 1000000);
+        BOOST_REQUIRE_EQUAL(rc.value, CNTK_SUCCESS);
+
+        std::vector<std::vector<float>> cresults(numThreads);
+        std::vector<std::vector<uint32_t>> cshapes(numThreads);
+        std::vector<int> codes(numThreads, CNTK_SUCCESS);
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                auto dims = std::vector<uint32_t>{ (uint32_t)inputDim, (uint32_t)(t % 2 == 0 ? numberOfFrames : numberOfFrames - 1) };
+                CNTK_Value frames;
+                frames.data = inputData.data();
+                frames.shape.size = 2;
+                frames.shape.value = dims.data();
+
+                bool sequenceFlags[]{ true };
+                CNTK_Value* outputValues = nullptr;
+                auto status = CNTK_EvaluateSequence(batched, argumentInfos, &frames, sequenceFlags, numArguments,
+                    outputInfos, numOutputs, &outputValues);
+                codes[t] = status.value;
+                if (status.value != CNTK_SUCCESS)
+                    return;
+
+                cshapes[t].assign(outputValues[0].shape.value, outputValues[0].shape.value + outputValues[0].shape.size);
+                NDShape outputShape(std::vector<size_t>(cshapes[t].begin(), cshapes[t].end()));
+                cresults[t].assign(outputValues[0].data, outputValues[0].data + outputShape.TotalSize());
+                for (uint32_t i = 0; i < numOutputs; i++)
+                    CNTK_CleanValue(&outputValues[i]);
+                CNTK_ReleaseArray(outputValues);
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        // The model is causal, so the two frame sequences give the first two frames of the three frame result.
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            BOOST_REQUIRE_EQUAL(codes[t], CNTK_SUCCESS);
+            size_t numFrames = t % 2 == 0 ? numberOfFrames : numberOfFrames - 1;
+            std::vector<uint32_t> expectedShape{ (uint32_t)numOutputClasses, (uint32_t)numFrames, 1 };
+            BOOST_REQUIRE_EQUAL_COLLECTIONS(cshapes[t].begin(), cshapes[t].end(), expectedShape.begin(), expectedShape.end());
+            RequireClose(std::vector<float>(result1.begin(), result1.begin() + numOutputClasses * numFrames), cresults[t], 0.00001f, 0.01f);
+        }
+
+        CNTK_ReleaseModel(batched);
+    }
+
     // Cleanup C code.
     CNTK_ReleaseModel(model);
     CNTK_ReleaseModel(cloned);
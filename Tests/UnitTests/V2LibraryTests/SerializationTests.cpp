@@ -923,6 +923,46 @@ void TestCheckpointingWithStatefulNodesAndExplicitSeeds(const DeviceDescriptor&
     }
 }
 
+void TestMemoryMappedModelLoading(const DeviceDescriptor& device)
+{
+    auto file = L"TestMemoryMappedModelLoading.out";
+    const size_t inputDim = 20;
+    auto inputVar = InputVariable({ inputDim }, DataType::Float, L"features");
+
+    // The frozen layer has Constants, which use the mapped file in place; the other layer has Parameters, which are copied.
+    auto frozenLayer = FullyConnectedLinearLayer(inputVar, 30, device)->Clone(ParameterCloningMethod::Freeze);
+    auto function = FullyConnectedLinearLayer(ReLU(frozenLayer), 5, device, L"output");
+
+    Internal::EnableMappableModelSaving();
+    function->Save(file);
+    Internal::DisableMappableModelSaving();
+
+    Internal::EnableMemoryMappedModelLoading();
+    auto reloadedFunction = Function::Load(file, device);
+    Internal::DisableMemoryMappedModelLoading();
+
+    if (!AreEqual(function, reloadedFunction))
+        BOOST_ERROR("TestMemoryMappedModelLoading: original and memory-mapped functions are not identical.");
+
+    for (const auto& parameter : reloadedFunction->Parameters())
+    {
+        if (parameter.Value()->IsReadOnly())
+            BOOST_ERROR("TestMemoryMappedModelLoading: a Parameter of the memory-mapped function is read-only.");
+    }
+
+    auto inputValue = GenerateSequences<float>({ 1, 3 }, { inputDim }, device, false);
+    std::unordered_map<Variable, ValuePtr> outputs = { { function->Output(), nullptr } };
+    std::unordered_map<Variable, ValuePtr> reloadedOutputs = { { reloadedFunction->Output(), nullptr } };
+    function->Evaluate({ { inputVar, inputValue } }, outputs, device);
+    reloadedFunction->Evaluate({ { reloadedFunction->Arguments()[0], inputValue } }, reloadedOutputs, device);
+
+    std::vector<std::vector<float>> output, reloadedOutput;
+    outputs[function->Output()]->CopyVariableValueTo(function->Output(), output);
+    reloadedOutputs[reloadedFunction->Output()]->CopyVariableValueTo(reloadedFunction->Output(), reloadedOutput);
+    for (size_t i = 0; i < output.size(); ++i)
+        FloatingPointVectorCompare(reloadedOutput[i], output[i], "TestMemoryMappedModelLoading: outputs of the original and memory-mapped functions do not match");
+}
+
 void TestLoadingModelFromMemoryBuffer()
 {
     ifstream modelFileStream("batch.norm.no.sample.count.v2.bin", ifstream::binary);
@@ -1024,6 +1064,11 @@ BOOST_AUTO_TEST_CASE(FunctionSerializationInCPU)
     TestFunctionSerialization(DeviceDescriptor::CPUDevice());
 }
 
+BOOST_AUTO_TEST_CASE(MemoryMappedModelLoadingInCPU)
+{
+    TestMemoryMappedModelLoading(DeviceDescriptor::CPUDevice());
+}
+
 BOOST_AUTO_TEST_CASE(ModelSerializationDuringTrainingInCPU)
 {
     TestModelSerializationDuringTraining(DeviceDescriptor::CPUDevice());
@@ -146,6 +146,17 @@ def set_node_timing(enable):
     '''
     cntk_py.enable_node_timing() if enable else cntk_py.disable_node_timing()
 
+def set_node_cost_profiling(enable):
+    '''
+    Node cost profiling records per-node time, estimated FLOPs and bytes moved,
+    which :meth:`~cntk.train.trainer.Trainer.print_node_cost_report` prints as a roofline report.
+    The device is synchronized around every node, so this slows down training on GPUs.
+
+    Args:
+        enable (bool): whether to enable per-node cost profiling
+    '''
+    cntk_py.enable_node_cost_profiling() if enable else cntk_py.disable_node_cost_profiling()
+
 class _DebugNode(UserFunction):
     '''
     A user function node that exposes a command line interface. With that one can
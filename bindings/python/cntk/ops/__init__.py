@@ -2380,8 +2380,9 @@ def optimized_rnnstack(operand, weights, hidden_size, num_layers,
                        bidirectional=False, recurrent_op='lstm', name=''):
     '''
     An RNN implementation that uses the primitives in cuDNN.
-    If cuDNN is not available it fails. You can use :class:`~cntk.misc.optimized_rnnstack_converter.convert_optimized_rnnstack`
-    to convert a model to GEMM-based implementation when no cuDNN.
+    On the CPU, a native implementation with the same weight layout is used, which supports
+    evaluation only; training requires cuDNN. You can use :class:`~cntk.misc.optimized_rnnstack_converter.convert_optimized_rnnstack`
+    to convert a model to GEMM-based implementation of composite recurrences when no cuDNN.
 
     Args:
         operand: input of the optimized RNN stack.
@@ -196,6 +196,35 @@ def block_momentum_distributed_learner(learner, block_size, block_momentum_as_ti
             reset_sgd_momentum_after_aggregation,
             block_learning_rate)
 
+@typemap
+def sparsified_data_parallel_distributed_learner(learner, density, bucket_size=65536, threshold=0.0, distributed_after=0, use_async_buffered_parameter_update=False):
+    '''
+    Creates a data parallel distributed learner that exchanges only the largest gradient entries.
+
+    The gradients are cut into buckets of ``bucket_size`` elements. From every bucket each worker sends
+    the ``ceil(density * bucket_size)`` entries of largest magnitude (and at least ``threshold``) to all
+    other workers as index/value pairs. The entries that are not sent are accumulated locally and added
+    to the next gradient (error feedback), as with 1-bit SGD.
+
+    Args:
+        learner: a local learner (i.e. sgd)
+        density (float): fraction of the gradient entries sent per bucket, in (0, 1]
+        bucket_size (int): number of gradient elements per bucket
+        threshold (float): entries of smaller magnitude are not sent even if they are among the largest
+        distributed_after (int): number of samples after which distributed training starts
+        use_async_buffered_parameter_update (bool): use async buffered parameter update, currently must be False
+    Returns:
+        a distributed learner instance
+    '''
+    return cntk_py.create_sparsified_data_parallel_distributed_learner(
+        cntk_py.mpicommunicator(),
+        learner,
+        distributed_after,
+        density,
+        bucket_size,
+        threshold,
+        use_async_buffered_parameter_update)
+
 @typemap
 def mpi_communicator():
     '''
@@ -31,6 +31,13 @@ def create_block_momentum_distributed_learner_with_time_constant(learner, distri
         block_momentum_as_time_constant=4096,
         distributed_after=distributed_after)
 
+def create_sparsified_data_parallel_distributed_learner(learner, distributed_after):
+    return distributed.sparsified_data_parallel_distributed_learner(
+        learner=learner,
+        density=0.5,
+        bucket_size=16,
+        distributed_after=distributed_after)
+
 def run_distributed_training(tmpdir, create_func):
 
     in1 = sequence.input_variable(shape=1)
@@ -238,4 +245,7 @@ def test_distributed(tmpdir):
 
     block_momentum_with_time=lambda learner: create_block_momentum_distributed_learner_with_time_constant(learner, 100)
     run_distributed_training(tmpdir, create_func=block_momentum_with_time)
+
+    sparsified_aggregation=lambda learner: create_sparsified_data_parallel_distributed_learner(learner, 0)
+    run_distributed_training(tmpdir, create_func=sparsified_aggregation)
     distributed.Communicator.finalize()
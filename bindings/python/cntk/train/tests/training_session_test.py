@@ -498,6 +498,51 @@ def test_session_restart_from_end_checkpoint(tmpdir, device_id):
     assert(writer.testing_summary_counter == 0)
 
 
+def test_session_async_checkpoints(tmpdir, device_id):
+    device = cntk_device(device_id)
+    writer = MockProgressWriter()
+    t, feature, label = create_sample_model(device, writer)
+    mbs = mb_source(tmpdir, "training", max_samples=INFINITELY_REPEAT)
+
+    input_map = {
+        feature: mbs.streams.features,
+        label: mbs.streams.labels
+    }
+
+    test_dir = str(tmpdir)
+
+    C.training_session(trainer=t, mb_source=mbs,
+        mb_size=4, model_inputs_to_streams=input_map,
+        max_samples=60, progress_frequency=20,
+        checkpoint_config = C.CheckpointConfig(frequency=20, preserve_all=True, async_checkpointing=True,
+                                             filename=str(tmpdir / "async_checkpoint"))
+    ).train(device)
+
+    candidates = [f for f in listdir(test_dir) if isfile(
+        join(test_dir, f)) and f.startswith("async_checkpoint")]
+
+    # all checkpoints have been written by the end of the training
+    assert(len(candidates) == 8)
+    for i in ["0", "1", "2", ""]:
+        assert("async_checkpoint" + i in candidates)
+        assert("async_checkpoint" + i + ".ckp" in candidates)
+
+    writer.minibatch_info = []
+    writer.training_summary_counter = 0
+
+    # restoring from the last checkpoint should not cause any training
+    mbs = mb_source(tmpdir, "training", max_samples=INFINITELY_REPEAT)
+    C.training_session(trainer=t, mb_source=mbs,
+        mb_size=4, model_inputs_to_streams=input_map,
+        max_samples=60, progress_frequency=20,
+        checkpoint_config = C.CheckpointConfig(frequency=20, restore=True, async_checkpointing=True,
+                                             filename=str(tmpdir / "async_checkpoint"))
+    ).train(device)
+
+    assert(len(writer.minibatch_info) == 0)
+    assert(writer.training_summary_counter == 0)
+
+
 def test_session_restart_from_checkpoint_preserve_all(tmpdir, device_id):
     device = cntk_device(device_id)
     writer = MockProgressWriter()
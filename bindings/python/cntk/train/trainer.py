@@ -338,4 +338,16 @@ class Trainer(cntk_py.Trainer):
         Prints per-node average timing per-minibatch for each primitive function
         statistics would reset after print
         '''
-        return super(Trainer, self).print_node_timing()
\ No newline at end of file
+        return super(Trainer, self).print_node_timing()
+
+    def print_node_cost_report(self, file_path='', peak_gflops=0, peak_gbps=0):
+        '''
+        Prints the per-node cost report gathered since
+        :func:`~cntk.debugging.set_node_cost_profiling` was enabled, and resets it.
+
+        Args:
+            file_path (str): if not empty, the report is also written to this file as JSON
+            peak_gflops (float): peak GFLOP/s of the device, for the roofline
+            peak_gbps (float): peak memory bandwidth of the device in GB/s, for the roofline
+        '''
+        return super(Trainer, self).print_node_cost_report(file_path, peak_gflops, peak_gbps)